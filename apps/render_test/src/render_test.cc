@@ -156,6 +156,7 @@ void RenderTest::engineConfiguration(EngineConfiguration &config) {
     config.displayHeight = 900;
     config.displayFullscreen = false;
     config.displayVsync = false;
+    config.textureStreamingBudget = 256 * 1024 * 1024;
 }
 
 /** Initialize the game world. */
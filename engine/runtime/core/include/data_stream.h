@@ -70,6 +70,20 @@ public:
 
     bool readLine(std::string &line);
 
+    /**
+     * Get a pointer to the stream content.
+     *
+     * If the whole content of the stream can be made directly accessible in
+     * memory (e.g. a memory-mapped file), returns a pointer to it. This allows
+     * users which need the whole stream content to avoid copying it into their
+     * own buffer. The content must not be modified through the pointer, and it
+     * remains valid for the lifetime of the stream.
+     *
+     * @return              Pointer to stream content, or null if the stream
+     *                      cannot be accessed directly in memory.
+     */
+    virtual const void *data() { return nullptr; }
+
     /**
      * Specific offset I/O.
      */
@@ -18,17 +18,18 @@
  * @file
  * @brief               Filesystem API.
  *
- * Right now this is just a wrapper for a platform-dependent filesystem
- * implementation. Relative paths are relative to the game base directory.
+ * This is a wrapper for a platform-dependent filesystem implementation, with
+ * support for layering package files on top of it (see core/package.h).
+ * Relative paths are relative to the game base directory.
  *
- * In future, when we support some sort of data packages, we will implement a
- * layered system where package files will be layered on top of the base FS.
- * This would cause relative paths to be resolved into the package files, but
- * absolute paths (for example for user data) would be passed down to the
- * underlying platform FS. Multiple packages will be able to be layered on top
- * of each other, so for example patches could be distributed as a package that
- * only changes the necessary files which would be layered onto the base
- * package.
+ * Package files mounted with mountPackage() are layered on top of the base FS.
+ * This causes relative paths to be resolved into the package files, but
+ * absolute paths (for example for user data) are passed down to the underlying
+ * platform FS. Multiple packages can be layered on top of each other, so for
+ * example patches could be distributed as a package that only changes the
+ * necessary files which would be layered onto the base package. Note that
+ * directories are not merged between layers: a directory which exists in a
+ * package hides the same directory in lower layers.
  */
 
 #pragma once
@@ -131,4 +132,9 @@ namespace Filesystem {
      * @param fullPath      Where to return corresponding absolute path string.
      * @return              Whether successful. */
     extern bool getFullPath(const Path &path, Path &fullPath);
+
+    /** Mount a package on top of the filesystem.
+     * @param path          Path to the package file.
+     * @return              Whether the package was successfully mounted. */
+    extern bool mountPackage(const Path &path);
 }
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               LZ4 compression functions.
+ */
+
+#pragma once
+
+#include "core/core.h"
+
+/**
+ * LZ4 block compression.
+ *
+ * These functions implement compression and decompression of data in the LZ4
+ * block format. The compressor is a simple greedy implementation which favours
+ * simplicity over compression ratio, since it is only intended to be used by
+ * offline tools, while the decompressor is fast enough to be used at runtime.
+ */
+namespace LZ4 {
+    /** Get the maximum compressed size of a block.
+     * @param size          Size of the uncompressed data.
+     * @return              Maximum size of the compressed data. */
+    inline size_t compressBound(size_t size) {
+        return size + (size / 255) + 16;
+    }
+
+    extern size_t compress(const void *src, size_t srcSize, void *dest, size_t destCapacity);
+    extern bool decompress(const void *src, size_t srcSize, void *dest, size_t destSize);
+}
@@ -45,4 +45,14 @@ namespace Math {
     static inline bool intersect(const BoundingBox &box, const Frustum &frustum) {
         return intersect(frustum, box);
     }
+
+    extern bool intersect(const Sphere &sphere, const BoundingBox &box);
+
+    /** Check for intersection between an AABB and a sphere.
+     * @param box           AABB to test.
+     * @param sphere        Sphere to test.
+     * @return              Whether the shapes intersect. */
+    static inline bool intersect(const BoundingBox &box, const Sphere &sphere) {
+        return intersect(sphere, box);
+    }
 }
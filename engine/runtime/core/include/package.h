@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Package file format.
+ *
+ * A package is a single file containing a collection of files, which can be
+ * mounted into the filesystem with Filesystem::mountPackage(). Files within a
+ * package are stored at the same path as they would be relative to the engine
+ * base directory, so mounting a package is transparent to users of the
+ * filesystem.
+ *
+ * The package file is memory-mapped when it is mounted, and uncompressed files
+ * are read directly from the mapping: DataStream::data() on a file opened
+ * from a package returns a pointer into the mapping without any copying. File
+ * data is aligned to the alignment given in the header to allow it to be
+ * passed straight to the GPU.
+ *
+ * The file layout is a PackageHeader, followed by the file data, followed by
+ * an array of PackageEntry structures, followed by a string table containing
+ * the null-terminated paths of the files. All values are little-endian.
+ */
+
+#pragma once
+
+#include "core/filesystem.h"
+#include "core/hash_table.h"
+
+#include <vector>
+
+/** Package file header. */
+struct PackageHeader {
+    char magic[4];                      /**< Magic number (kPackageMagic). */
+    uint32_t version;                   /**< Format version (kPackageVersion). */
+    uint32_t numEntries;                /**< Number of entries in the package. */
+    uint32_t alignment;                 /**< Alignment of file data. */
+    uint64_t entriesOffset;             /**< Offset of the entry array. */
+    uint64_t stringsOffset;             /**< Offset of the string table. */
+    uint64_t stringsSize;               /**< Size of the string table. */
+};
+
+/** Package compression types. */
+enum PackageCompression : uint32_t {
+    kPackageCompressionNone,            /**< Data is uncompressed. */
+    kPackageCompressionLZ4,             /**< Data is an LZ4 block. */
+};
+
+/** Package file entry. */
+struct PackageEntry {
+    uint64_t offset;                    /**< Offset of the file data. */
+    uint64_t size;                      /**< Uncompressed size of the file. */
+    uint64_t storedSize;                /**< Size of the data stored in the package. */
+    uint32_t pathOffset;                /**< Offset of the path in the string table. */
+    uint32_t compression;               /**< Compression type (PackageCompression). */
+};
+
+/** Package magic number. */
+static const char kPackageMagic[4] = { 'O', 'P', 'K', 'G' };
+
+/** Current package format version. */
+static const uint32_t kPackageVersion = 1;
+
+/** Default alignment for data in a package. */
+static const uint32_t kPackageDefaultAlignment = 256;
+
+/** Mounted package. */
+class Package : Noncopyable {
+public:
+    ~Package();
+
+    static Package *open(const Path &path);
+
+    /** @return             Path to the package file. */
+    const Path &path() const { return m_path; }
+
+    File *openFile(const Path &path);
+    Directory *openDirectory(const Path &path);
+    bool exists(const Path &path) const;
+    bool isType(const Path &path, FileType type) const;
+private:
+    Package(const Path &path, File *file);
+
+    bool load();
+private:
+    Path m_path;                        /**< Path to the package file. */
+    std::unique_ptr<File> m_file;       /**< Package file. */
+    const uint8_t *m_data;              /**< Package data (mapped). */
+    uint64_t m_size;                    /**< Size of the package. */
+
+    /** Buffer containing the package if it could not be mapped. */
+    std::unique_ptr<uint8_t[]> m_buffer;
+
+    /** Map from file path to entry. */
+    HashMap<std::string, const PackageEntry *> m_files;
+
+    /** Map from directory path to the entries within the directory. */
+    HashMap<std::string, std::vector<Directory::Entry>> m_directories;
+};
@@ -56,6 +56,21 @@ struct PixelFormat {
         kFloatR32G32,           /**< RG, float, 32 bits per component. */
         kFloatR32,              /**< R, float, 32 bits per component. */
 
+        /**
+         * Block compressed colour formats.
+         *
+         * These store 4x4 blocks of pixels in a fixed number of bytes, so data
+         * sizes must be calculated with imageSize() rather than bytesPerPixel().
+         */
+        kBC1,                   /**< RGB, BC1 (DXT1), 8 bytes per block. */
+        kBC1sRGB,               /**< RGB, BC1 (DXT1), 8 bytes per block, sRGB. */
+        kBC3,                   /**< RGBA, BC3 (DXT5), 16 bytes per block. */
+        kBC3sRGB,               /**< RGBA, BC3 (DXT5), 16 bytes per block, sRGB. */
+        kBC4,                   /**< R, BC4 (RGTC1), 8 bytes per block. */
+        kBC5,                   /**< RG, BC5 (RGTC2), 16 bytes per block. */
+        kBC7,                   /**< RGBA, BC7 (BPTC), 16 bytes per block. */
+        kBC7sRGB,               /**< RGBA, BC7 (BPTC), 16 bytes per block, sRGB. */
+
         /** Depth/stencil formats. */
         kDepth16,               /**< Depth, 16 bits. */
         kDepth32,               /**< Depth, 32 bits. */
@@ -74,8 +89,11 @@ struct PixelFormat {
     static bool isFloat(PixelFormat format);
     static bool isDepth(PixelFormat format);
     static bool isDepthStencil(PixelFormat format);
+    static bool isCompressed(PixelFormat format);
 
     static size_t bytesPerPixel(PixelFormat format);
+    static size_t bytesPerBlock(PixelFormat format);
+    static size_t imageSize(PixelFormat format, uint32_t width, uint32_t height);
 
     static PixelFormat getSRGBEquivalent(PixelFormat format);
     static PixelFormat getNonSRGBEquivalent(PixelFormat format);
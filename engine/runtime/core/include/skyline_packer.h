@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Skyline rectangle packer.
+ */
+
+#pragma once
+
+#include "core/core.h"
+
+#include <vector>
+
+/**
+ * Skyline rectangle packer.
+ *
+ * This class packs rectangles into a fixed area, for example to place images
+ * in a texture atlas. It keeps track of the "skyline", the top edge of the
+ * rectangles packed so far, as a list of horizontal segments. Each rectangle
+ * is placed at the position along the skyline which leaves its top edge
+ * lowest (the bottom-left heuristic). This packs images of similar heights,
+ * such as glyphs, tightly, and is fast enough to be used to add rectangles
+ * incrementally at runtime. Space below the skyline left by a placement is
+ * never reused.
+ */
+class SkylinePacker {
+public:
+    SkylinePacker(uint32_t width, uint32_t height);
+
+    void reset();
+    void grow(uint32_t width, uint32_t height);
+    bool insert(uint32_t width, uint32_t height, uint32_t &outX, uint32_t &outY);
+
+    /** @return             Width of the packing area. */
+    uint32_t width() const { return m_width; }
+    /** @return             Height of the packing area. */
+    uint32_t height() const { return m_height; }
+private:
+    /** Horizontal segment of the skyline. */
+    struct Segment {
+        uint32_t x;                     /**< Start X position. */
+        uint32_t y;                     /**< Height of the skyline along the segment. */
+        uint32_t width;                 /**< Width of the segment. */
+    };
+private:
+    bool fit(size_t index, uint32_t width, uint32_t height, uint32_t &outY) const;
+private:
+    uint32_t m_width;                   /**< Width of the packing area. */
+    uint32_t m_height;                  /**< Height of the packing area. */
+
+    /** Segments of the skyline, in order of X position, covering the width. */
+    std::vector<Segment> m_skyline;
+};
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Filesystem API.
+ *
+ * This implements the layering of mounted packages on top of the platform
+ * filesystem. Relative paths opened for reading are first looked up in the
+ * mounted packages, most recently mounted first, before falling back to the
+ * platform filesystem.
+ */
+
+#include "core/package.h"
+
+#include "platform_filesystem.h"
+
+#include <list>
+
+/**
+ * List of mounted packages, most recently mounted first.
+ *
+ * Packages are only mounted during initialisation and are never unmounted, so
+ * no locking is needed to access the list from other threads.
+ */
+static std::list<std::unique_ptr<Package>> g_packages;
+
+/** Check whether a path could be resolved into a package.
+ * @param path          Path to check.
+ * @return              Whether to search packages for the path. */
+static inline bool usePackages(const Path &path) {
+    return !g_packages.empty() && path.isRelative();
+}
+
+/** Open a file.
+ * @param path          Path to file to open.
+ * @param mode          Mode to open file with (combination of File::Mode
+ *                      flags, defaults to kRead).
+ * @return              Pointer to opened file, or null on failure. */
+File *Filesystem::openFile(const Path &path, unsigned mode) {
+    if (mode == File::kRead && usePackages(path)) {
+        for (auto &package : g_packages) {
+            if (package->isType(path, FileType::kFile))
+                return package->openFile(path);
+        }
+    }
+
+    return PlatformFilesystem::openFile(path, mode);
+}
+
+/** Open a directory.
+ * @param path          Path to directory to open.
+ * @return              Pointer to opened directory, or null on failure. */
+Directory *Filesystem::openDirectory(const Path &path) {
+    if (usePackages(path)) {
+        for (auto &package : g_packages) {
+            Directory *directory = package->openDirectory(path);
+            if (directory)
+                return directory;
+        }
+    }
+
+    return PlatformFilesystem::openDirectory(path);
+}
+
+/** Check if a path exists.
+ * @param path          Path to check.
+ * @return              Whether the path exists. */
+bool Filesystem::exists(const Path &path) {
+    if (usePackages(path)) {
+        for (auto &package : g_packages) {
+            if (package->exists(path))
+                return true;
+        }
+    }
+
+    return PlatformFilesystem::exists(path);
+}
+
+/** Check if a path exists and is a certain type.
+ * @param path          Path to check.
+ * @param type          Type to check for.
+ * @return              Whether the path exists and is the specified type. */
+bool Filesystem::isType(const Path &path, FileType type) {
+    if (usePackages(path)) {
+        for (auto &package : g_packages) {
+            if (package->isType(path, type))
+                return true;
+        }
+    }
+
+    return PlatformFilesystem::isType(path, type);
+}
+
+/**
+ * Mount a package.
+ *
+ * Mounts a package file on top of the filesystem. Files in the package will
+ * take precedence over those in the platform filesystem and in previously
+ * mounted packages. Packages can only be mounted during initialisation, before
+ * any other threads may access the filesystem.
+ *
+ * @param path          Path to the package file.
+ *
+ * @return              Whether the package was successfully mounted.
+ */
+bool Filesystem::mountPackage(const Path &path) {
+    Package *package = Package::open(path);
+    if (!package)
+        return false;
+
+    g_packages.emplace_front(package);
+    return true;
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               LZ4 compression functions.
+ *
+ * Reference:
+ *  - LZ4 Block Format Description
+ *    https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+ */
+
+#include "core/lz4.h"
+
+#include <vector>
+
+/** Minimum length of a match. */
+static const size_t kMinMatch = 4;
+
+/** The last 5 bytes of a block must be literals. */
+static const size_t kLastLiterals = 5;
+
+/** The last match must start at least 12 bytes before the end of a block. */
+static const size_t kMatchStartLimit = 12;
+
+/** Maximum distance back to a match. */
+static const size_t kMaxOffset = 65535;
+
+/** Size of the compressor hash table (log2). */
+static const unsigned kHashLog = 16;
+
+/** Read an unaligned 32-bit value. */
+static inline uint32_t read32(const uint8_t *ptr) {
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+/** Hash a 4-byte sequence for the compressor hash table. */
+static inline uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - kHashLog);
+}
+
+/** Write an LZ4 length extension.
+ * @param out           Output pointer.
+ * @param length        Remaining length (length minus 15). */
+static inline void writeLength(uint8_t *&out, size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+
+    *out++ = static_cast<uint8_t>(length);
+}
+
+/**
+ * Write an LZ4 sequence.
+ *
+ * Writes a sequence consisting of some literals followed by a match. If the
+ * match length is 0, this is the last sequence of the block and only the
+ * literals are written.
+ *
+ * @param out           Output pointer.
+ * @param outEnd        End of the output buffer.
+ * @param literals      Literal data.
+ * @param numLiterals   Number of literals.
+ * @param offset        Offset back to the match.
+ * @param matchLength   Length of the match.
+ *
+ * @return              Whether there was enough space for the sequence.
+ */
+static bool writeSequence(uint8_t *&out,
+                          const uint8_t *outEnd,
+                          const uint8_t *literals,
+                          size_t numLiterals,
+                          size_t offset,
+                          size_t matchLength)
+{
+    size_t required = 1 + numLiterals + (numLiterals / 255) + 1;
+    if (matchLength)
+        required += 2 + ((matchLength - kMinMatch) / 255) + 1;
+
+    if (required > static_cast<size_t>(outEnd - out))
+        return false;
+
+    uint8_t *token = out++;
+
+    *token = static_cast<uint8_t>(std::min(numLiterals, size_t(15)) << 4);
+    if (numLiterals >= 15)
+        writeLength(out, numLiterals - 15);
+
+    memcpy(out, literals, numLiterals);
+    out += numLiterals;
+
+    if (matchLength) {
+        *out++ = static_cast<uint8_t>(offset & 0xff);
+        *out++ = static_cast<uint8_t>(offset >> 8);
+
+        size_t length = matchLength - kMinMatch;
+        *token |= static_cast<uint8_t>(std::min(length, size_t(15)));
+        if (length >= 15)
+            writeLength(out, length - 15);
+    }
+
+    return true;
+}
+
+/**
+ * Compress a block of data.
+ *
+ * Compresses a block of data using the LZ4 block format. Compression can fail
+ * if the destination buffer is not large enough, a buffer of the size given
+ * by compressBound() will always be large enough.
+ *
+ * @param src           Source data.
+ * @param srcSize       Size of the source data.
+ * @param dest          Destination buffer.
+ * @param destCapacity  Size of the destination buffer.
+ *
+ * @return              Size of the compressed data, or 0 on failure.
+ */
+size_t LZ4::compress(const void *src, size_t srcSize, void *dest, size_t destCapacity) {
+    const uint8_t *in     = reinterpret_cast<const uint8_t *>(src);
+    const uint8_t *inEnd  = in + srcSize;
+    uint8_t *out          = reinterpret_cast<uint8_t *>(dest);
+    const uint8_t *outEnd = out + destCapacity;
+
+    /* Start of the literals which have not yet been written. */
+    const uint8_t *anchor = in;
+
+    if (srcSize >= kMatchStartLimit) {
+        /* Table of the last position (plus 1, 0 is empty) at which each hash
+         * of 4 bytes was seen. */
+        std::vector<uint32_t> table(1 << kHashLog, 0);
+
+        const uint8_t *matchLimit = inEnd - kLastLiterals;
+        const uint8_t *startLimit = inEnd - kMatchStartLimit;
+
+        const uint8_t *ip = in;
+        while (ip <= startLimit) {
+            uint32_t sequence = read32(ip);
+            uint32_t hash = hashSequence(sequence);
+            uint32_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(ip - in) + 1;
+
+            if (candidate) {
+                const uint8_t *match = in + candidate - 1;
+
+                if (static_cast<size_t>(ip - match) <= kMaxOffset && read32(match) == sequence) {
+                    /* Extend the match as far as possible. */
+                    const uint8_t *matchEnd = ip + kMinMatch;
+                    const uint8_t *ref = match + kMinMatch;
+                    while (matchEnd < matchLimit && *matchEnd == *ref) {
+                        matchEnd++;
+                        ref++;
+                    }
+
+                    if (!writeSequence(out, outEnd, anchor, ip - anchor, ip - match, matchEnd - ip))
+                        return 0;
+
+                    ip = anchor = matchEnd;
+                    continue;
+                }
+            }
+
+            ip++;
+        }
+    }
+
+    /* Write the remaining literals. */
+    if (!writeSequence(out, outEnd, anchor, inEnd - anchor, 0, 0))
+        return 0;
+
+    return out - reinterpret_cast<uint8_t *>(dest);
+}
+
+/**
+ * Decompress a block of data.
+ *
+ * Decompresses a block of data in the LZ4 block format. The exact size of the
+ * decompressed data must be known. The input is validated, so this is safe to
+ * use on untrusted data.
+ *
+ * @param src           Compressed data.
+ * @param srcSize       Size of the compressed data.
+ * @param dest          Destination buffer.
+ * @param destSize      Size of the decompressed data.
+ *
+ * @return              Whether the data was successfully decompressed.
+ */
+bool LZ4::decompress(const void *src, size_t srcSize, void *dest, size_t destSize) {
+    const uint8_t *in      = reinterpret_cast<const uint8_t *>(src);
+    const uint8_t *inEnd   = in + srcSize;
+    uint8_t *outStart      = reinterpret_cast<uint8_t *>(dest);
+    uint8_t *out           = outStart;
+    const uint8_t *outEnd  = out + destSize;
+
+    /* Read a length extension. */
+    auto readLength =
+        [&] (size_t &length) -> bool {
+            uint8_t byte;
+            do {
+                if (in >= inEnd)
+                    return false;
+
+                byte = *in++;
+                length += byte;
+            } while (byte == 255);
+
+            return true;
+        };
+
+    while (true) {
+        if (in >= inEnd)
+            return false;
+
+        uint8_t token = *in++;
+
+        /* Copy literals. */
+        size_t numLiterals = token >> 4;
+        if (numLiterals == 15 && !readLength(numLiterals))
+            return false;
+
+        if (numLiterals > static_cast<size_t>(inEnd - in) || numLiterals > static_cast<size_t>(outEnd - out))
+            return false;
+
+        memcpy(out, in, numLiterals);
+        in += numLiterals;
+        out += numLiterals;
+
+        /* The last sequence contains only literals. */
+        if (in == inEnd)
+            break;
+
+        if (inEnd - in < 2)
+            return false;
+
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+
+        if (!offset || offset > static_cast<size_t>(out - outStart))
+            return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(matchLength))
+            return false;
+
+        matchLength += kMinMatch;
+        if (matchLength > static_cast<size_t>(outEnd - out))
+            return false;
+
+        /* Matches can overlap the output, so copy byte by byte. */
+        const uint8_t *match = out - offset;
+        for (size_t i = 0; i < matchLength; i++)
+            *out++ = *match++;
+    }
+
+    return out == outEnd;
+}
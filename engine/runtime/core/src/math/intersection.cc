@@ -55,3 +55,14 @@ bool Math::intersect(const Frustum &frustum, const BoundingBox &box) {
 
     return true;
 }
+
+/** Check for intersection between a sphere and an AABB.
+ * @param sphere        Sphere to test.
+ * @param box           AABB to test.
+ * @return              Whether the shapes intersect. */
+bool Math::intersect(const Sphere &sphere, const BoundingBox &box) {
+    /* Compare the distance to the closest point in the box. */
+    const glm::vec3 closest = glm::clamp(sphere.centre, box.minimum, box.maximum);
+    const glm::vec3 offset = closest - sphere.centre;
+    return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+}
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Package file support.
+ *
+ * TODO:
+ *  - The package format is little-endian, we currently assume that the host
+ *    is also little-endian.
+ */
+
+#include "core/lz4.h"
+#include "core/package.h"
+
+#include "platform_filesystem.h"
+
+/** File within a package. */
+class PackageFile : public File {
+public:
+    PackageFile(const uint8_t *data, uint64_t size, std::unique_ptr<uint8_t[]> &&buffer);
+
+    uint64_t size() const override { return m_size; }
+    const void *data() override { return m_data; }
+
+    bool read(void *buf, size_t size) override;
+    bool write(const void *buf, size_t size) override { return false; }
+    bool seek(SeekMode mode, int64_t offset) override;
+    uint64_t offset() const override { return m_offset; }
+
+    bool read(void *buf, size_t size, uint64_t offset) override;
+    bool write(const void *buf, size_t size, uint64_t offset) override { return false; }
+private:
+    const uint8_t *m_data;              /**< File data. */
+    uint64_t m_size;                    /**< Size of the file. */
+    uint64_t m_offset;                  /**< Current offset. */
+
+    /** Buffer containing decompressed data (if compressed). */
+    std::unique_ptr<uint8_t[]> m_buffer;
+};
+
+/** Directory within a package. */
+class PackageDirectory : public Directory {
+public:
+    explicit PackageDirectory(const std::vector<Entry> &entries);
+
+    void reset() override { m_next = 0; }
+    bool next(Entry &entry) override;
+private:
+    const std::vector<Entry> &m_entries;    /**< Entries in the directory. */
+    size_t m_next;                          /**< Index of next entry. */
+};
+
+/** Initialise the file.
+ * @param data          File data.
+ * @param size          Size of the file.
+ * @param buffer        Buffer to take ownership of (if data is not mapped). */
+PackageFile::PackageFile(const uint8_t *data, uint64_t size, std::unique_ptr<uint8_t[]> &&buffer) :
+    m_data   (data),
+    m_size   (size),
+    m_offset (0),
+    m_buffer (std::move(buffer))
+{}
+
+/** Read from the file at the current offset.
+ * @param buf           Buffer to read into.
+ * @param size          Number of bytes to read.
+ * @return              Whether the read was successful. */
+bool PackageFile::read(void *buf, size_t size) {
+    if (!read(buf, size, m_offset))
+        return false;
+
+    m_offset += size;
+    return true;
+}
+
+/** Set the file offset.
+ * @param mode          Seek mode.
+ * @param offset        Offset value.
+ * @return              Whether the seek was successful. */
+bool PackageFile::seek(SeekMode mode, int64_t offset) {
+    int64_t base;
+
+    switch (mode) {
+        case SeekMode::kSeekSet:
+            base = 0;
+            break;
+        case SeekMode::kSeekCurrent:
+            base = m_offset;
+            break;
+        case SeekMode::kSeekEnd:
+            base = m_size;
+            break;
+        default:
+            return false;
+    }
+
+    if (base + offset < 0)
+        return false;
+
+    m_offset = base + offset;
+    return true;
+}
+
+/** Read from the file at the specified offset.
+ * @param buf           Buffer to read into.
+ * @param size          Number of bytes to read.
+ * @param offset        Offset to read from.
+ * @return              Whether the read was successful. */
+bool PackageFile::read(void *buf, size_t size, uint64_t offset) {
+    if (offset > m_size || size > m_size - offset)
+        return false;
+
+    memcpy(buf, m_data + offset, size);
+    return true;
+}
+
+/** Initialise the directory.
+ * @param entries       Entries in the directory. */
+PackageDirectory::PackageDirectory(const std::vector<Entry> &entries) :
+    m_entries (entries),
+    m_next    (0)
+{}
+
+/** Get the next directory entry.
+ * @param entry         Entry to fill in.
+ * @return              True if entry read, false if the end of the directory
+ *                      has been reached. */
+bool PackageDirectory::next(Entry &entry) {
+    if (m_next >= m_entries.size())
+        return false;
+
+    entry = m_entries[m_next++];
+    return true;
+}
+
+/** Initialise the package.
+ * @param path          Path to the package file.
+ * @param file          Opened package file. */
+Package::Package(const Path &path, File *file) :
+    m_path (path),
+    m_file (file),
+    m_data (nullptr),
+    m_size (file->size())
+{}
+
+/** Destroy the package. */
+Package::~Package() {}
+
+/** Open a package.
+ * @param path          Path to the package file.
+ * @return              Opened package, or null on failure. */
+Package *Package::open(const Path &path) {
+    File *file = PlatformFilesystem::openFile(path, File::kRead);
+    if (!file) {
+        logError("Failed to open package '%s'", path.c_str());
+        return nullptr;
+    }
+
+    std::unique_ptr<Package> package(new Package(path, file));
+    if (!package->load())
+        return nullptr;
+
+    return package.release();
+}
+
+/** Load the package index.
+ * @return              Whether the package is valid. */
+bool Package::load() {
+    /* Map the package. If this fails, fall back to reading it into memory. */
+    m_data = reinterpret_cast<const uint8_t *>(m_file->data());
+    if (!m_data) {
+        m_buffer.reset(new uint8_t[m_size]);
+        if (!m_file->read(m_buffer.get(), m_size, 0)) {
+            logError("Failed to read package '%s'", m_path.c_str());
+            return false;
+        }
+
+        m_data = m_buffer.get();
+    }
+
+    if (m_size < sizeof(PackageHeader)) {
+        logError("Package '%s' is invalid (too small)", m_path.c_str());
+        return false;
+    }
+
+    const PackageHeader *header = reinterpret_cast<const PackageHeader *>(m_data);
+
+    if (memcmp(header->magic, kPackageMagic, sizeof(kPackageMagic)) != 0) {
+        logError("Package '%s' is invalid (bad magic)", m_path.c_str());
+        return false;
+    } else if (header->version != kPackageVersion) {
+        logError("Package '%s' has unsupported version %u", m_path.c_str(), header->version);
+        return false;
+    } else if (header->entriesOffset > m_size ||
+               header->entriesOffset % alignof(PackageEntry) != 0 ||
+               header->numEntries > (m_size - header->entriesOffset) / sizeof(PackageEntry) ||
+               header->stringsOffset > m_size ||
+               header->stringsSize > m_size - header->stringsOffset ||
+               (header->stringsSize && m_data[header->stringsOffset + header->stringsSize - 1] != 0))
+    {
+        logError("Package '%s' is invalid (bad index)", m_path.c_str());
+        return false;
+    }
+
+    const PackageEntry *entries = reinterpret_cast<const PackageEntry *>(m_data + header->entriesOffset);
+    const char *strings = reinterpret_cast<const char *>(m_data + header->stringsOffset);
+
+    for (uint32_t i = 0; i < header->numEntries; i++) {
+        const PackageEntry &entry = entries[i];
+
+        if (entry.offset > m_size ||
+            entry.storedSize > m_size - entry.offset ||
+            entry.pathOffset >= header->stringsSize ||
+            entry.compression > kPackageCompressionLZ4 ||
+            (entry.compression == kPackageCompressionNone && entry.storedSize != entry.size))
+        {
+            logError("Package '%s' is invalid (bad entry %u)", m_path.c_str(), i);
+            return false;
+        }
+
+        std::string path(strings + entry.pathOffset);
+        m_files.insert(std::make_pair(path, &entry));
+
+        /* Add the file to its parent directory, and any directories which are
+         * not yet known to their parents. */
+        Path current(path, Path::kNormalized);
+        FileType type = FileType::kFile;
+        while (true) {
+            Path parent = current.directoryName();
+            bool known = m_directories.find(parent.str()) != m_directories.end();
+
+            std::vector<Directory::Entry> &parentEntries = m_directories[parent.str()];
+            parentEntries.emplace_back();
+            parentEntries.back().name = current.fileName();
+            parentEntries.back().type = type;
+
+            if (known || parent.isRoot())
+                break;
+
+            current = parent;
+            type = FileType::kDirectory;
+        }
+    }
+
+    logInfo("Mounted package '%s' (%u files)", m_path.c_str(), header->numEntries);
+    return true;
+}
+
+/** Open a file from the package.
+ * @param path          Path to the file.
+ * @return              Opened file, or null if not found. */
+File *Package::openFile(const Path &path) {
+    auto ret = m_files.find(path.str());
+    if (ret == m_files.end())
+        return nullptr;
+
+    const PackageEntry *entry = ret->second;
+    const uint8_t *data = m_data + entry->offset;
+    std::unique_ptr<uint8_t[]> buffer;
+
+    if (entry->compression == kPackageCompressionLZ4) {
+        buffer.reset(new uint8_t[entry->size]);
+        if (!LZ4::decompress(data, entry->storedSize, buffer.get(), entry->size)) {
+            logError("Failed to decompress '%s' from package '%s'", path.c_str(), m_path.c_str());
+            return nullptr;
+        }
+
+        data = buffer.get();
+    }
+
+    return new PackageFile(data, entry->size, std::move(buffer));
+}
+
+/** Open a directory from the package.
+ * @param path          Path to the directory.
+ * @return              Opened directory, or null if not found. */
+Directory *Package::openDirectory(const Path &path) {
+    auto ret = m_directories.find(path.str());
+    if (ret == m_directories.end())
+        return nullptr;
+
+    return new PackageDirectory(ret->second);
+}
+
+/** Check if a path exists in the package.
+ * @param path          Path to check.
+ * @return              Whether the path exists. */
+bool Package::exists(const Path &path) const {
+    return isType(path, FileType::kFile) || isType(path, FileType::kDirectory);
+}
+
+/** Check if a path exists in the package and is a certain type.
+ * @param path          Path to check.
+ * @param type          Type to check for.
+ * @return              Whether the path exists and is the specified type. */
+bool Package::isType(const Path &path, FileType type) const {
+    switch (type) {
+        case FileType::kFile:
+            return m_files.find(path.str()) != m_files.end();
+        case FileType::kDirectory:
+            return m_directories.find(path.str()) != m_directories.end();
+        default:
+            return false;
+    }
+}
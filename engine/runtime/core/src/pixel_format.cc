@@ -39,6 +39,9 @@ bool PixelFormat::isSRGB(const PixelFormat format) {
     switch (format) {
         case kR8G8B8A8sRGB:
         case kB8G8R8A8sRGB:
+        case kBC1sRGB:
+        case kBC3sRGB:
+        case kBC7sRGB:
             return true;
         default:
             return false;
@@ -90,8 +93,27 @@ bool PixelFormat::isDepthStencil(const PixelFormat format) {
     }
 }
 
+/** Check if a format is a block compressed format.
+ * @param format        Format to check.
+ * @return              Whether the format is a block compressed format. */
+bool PixelFormat::isCompressed(const PixelFormat format) {
+    switch (format) {
+        case kBC1:
+        case kBC1sRGB:
+        case kBC3:
+        case kBC3sRGB:
+        case kBC4:
+        case kBC5:
+        case kBC7:
+        case kBC7sRGB:
+            return true;
+        default:
+            return false;
+    }
+}
+
 /** Get the number of bytes per pixel for a pixel format.
- * @param format        Format to get for.
+ * @param format        Format to get for (must not be compressed).
  * @return              Number of bytes per pixel using the given format. */
 size_t PixelFormat::bytesPerPixel(const PixelFormat format) {
     switch (format) {
@@ -125,6 +147,49 @@ size_t PixelFormat::bytesPerPixel(const PixelFormat format) {
     }
 }
 
+/** Get the number of bytes per 4x4 block for a block compressed format.
+ * @param format        Format to get for (must be compressed).
+ * @return              Number of bytes per block using the given format. */
+size_t PixelFormat::bytesPerBlock(const PixelFormat format) {
+    switch (format) {
+        case kBC1:
+        case kBC1sRGB:
+        case kBC4:
+            return 8;
+        case kBC3:
+        case kBC3sRGB:
+        case kBC5:
+        case kBC7:
+        case kBC7sRGB:
+            return 16;
+        default:
+            unreachable();
+    }
+}
+
+/**
+ * Get the size of image data in a pixel format.
+ *
+ * Gets the number of bytes needed to store an image of the given dimensions in
+ * a pixel format. For block compressed formats, the dimensions are rounded up
+ * to a whole number of blocks.
+ *
+ * @param format        Format to get for.
+ * @param width         Width of the image.
+ * @param height        Height of the image.
+ *
+ * @return              Size of the image data.
+ */
+size_t PixelFormat::imageSize(const PixelFormat format, uint32_t width, uint32_t height) {
+    if (isCompressed(format)) {
+        size_t blocksX = (static_cast<size_t>(width) + 3) / 4;
+        size_t blocksY = (static_cast<size_t>(height) + 3) / 4;
+        return blocksX * blocksY * bytesPerBlock(format);
+    } else {
+        return static_cast<size_t>(width) * height * bytesPerPixel(format);
+    }
+}
+
 /** Given a pixel format, get a sRGB equivalent of it.
  * @param format        Format to convert. */
 PixelFormat PixelFormat::getSRGBEquivalent(PixelFormat format) {
@@ -133,6 +198,12 @@ PixelFormat PixelFormat::getSRGBEquivalent(PixelFormat format) {
             return PixelFormat::kR8G8B8A8sRGB;
         case PixelFormat::kB8G8R8A8:
             return PixelFormat::kB8G8R8A8sRGB;
+        case PixelFormat::kBC1:
+            return PixelFormat::kBC1sRGB;
+        case PixelFormat::kBC3:
+            return PixelFormat::kBC3sRGB;
+        case PixelFormat::kBC7:
+            return PixelFormat::kBC7sRGB;
         default:
             return format;
     }
@@ -146,6 +217,12 @@ PixelFormat PixelFormat::getNonSRGBEquivalent(PixelFormat format) {
             return PixelFormat::kR8G8B8A8;
         case PixelFormat::kB8G8R8A8sRGB:
             return PixelFormat::kB8G8R8A8;
+        case PixelFormat::kBC1sRGB:
+            return PixelFormat::kBC1;
+        case PixelFormat::kBC3sRGB:
+            return PixelFormat::kBC3;
+        case PixelFormat::kBC7sRGB:
+            return PixelFormat::kBC7;
         default:
             return format;
     }
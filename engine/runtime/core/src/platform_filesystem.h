@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Platform filesystem interface.
+ */
+
+#pragma once
+
+#include "core/filesystem.h"
+
+/**
+ * Platform filesystem functions.
+ *
+ * These functions are implemented by the platform-specific code to access the
+ * underlying system filesystem. The public Filesystem functions layer mounted
+ * packages on top of these. See the corresponding Filesystem functions for
+ * documentation.
+ */
+namespace PlatformFilesystem {
+    extern File *openFile(const Path &path, unsigned mode);
+    extern Directory *openDirectory(const Path &path);
+    extern bool exists(const Path &path);
+    extern bool isType(const Path &path, FileType type);
+}
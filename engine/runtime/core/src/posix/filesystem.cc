@@ -19,8 +19,9 @@
  * @brief               POSIX filesystem implementation.
  */
 
-#include "core/filesystem.h"
+#include "../platform_filesystem.h"
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <dirent.h>
@@ -31,10 +32,11 @@
 /** POSIX file implementation. */
 class POSIXFile : public File {
 public:
-    POSIXFile(int fd);
+    POSIXFile(int fd, unsigned mode);
     ~POSIXFile();
 
     uint64_t size() const override;
+    const void *data() override;
 
     bool read(void *buf, size_t size) override;
     bool write(const void *buf, size_t size) override;
@@ -45,6 +47,9 @@ public:
     bool write(const void *buf, size_t size, uint64_t offset) override;
 private:
     int m_fd;                       /**< File descriptor. */
+    unsigned m_mode;                /**< Mode that the file was opened with. */
+    void *m_mapping;                /**< Memory mapping of the file (if mapped). */
+    size_t m_mappingSize;           /**< Size of the mapping. */
 };
 
 /** POSIX directory implementation. */
@@ -60,11 +65,20 @@ private:
 };
 
 /** Initialize the file.
- * @param fd            Opened file descriptor. */
-POSIXFile::POSIXFile(int fd) : m_fd(fd) {}
+ * @param fd            Opened file descriptor.
+ * @param mode          Mode that the file was opened with. */
+POSIXFile::POSIXFile(int fd, unsigned mode) :
+    m_fd          (fd),
+    m_mode        (mode),
+    m_mapping     (nullptr),
+    m_mappingSize (0)
+{}
 
 /** Destroy the file. */
 POSIXFile::~POSIXFile() {
+    if (m_mapping)
+        munmap(m_mapping, m_mappingSize);
+
     close(m_fd);
 }
 
@@ -78,6 +92,35 @@ uint64_t POSIXFile::size() const {
     return st.st_size;
 }
 
+/**
+ * Get a pointer to the file content.
+ *
+ * Maps the whole file into memory on first use. This is only supported for
+ * files which have been opened read-only, and the mapping reflects the file
+ * content at the time that it is created.
+ *
+ * @return              Pointer to file content, or null if unable to map.
+ */
+const void *POSIXFile::data() {
+    if (!m_mapping) {
+        if (m_mode != File::kRead)
+            return nullptr;
+
+        size_t size = this->size();
+        if (!size)
+            return nullptr;
+
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (mapping == MAP_FAILED)
+            return nullptr;
+
+        m_mapping = mapping;
+        m_mappingSize = size;
+    }
+
+    return m_mapping;
+}
+
 /** Read from the file at the current offset.
  * @param buf           Buffer to read into.
  * @param size          Number of bytes to read.
@@ -115,12 +158,12 @@ bool POSIXFile::seek(SeekMode mode, int64_t offset) {
             return false;
     }
 
-    return lseek(m_fd, offset, whence) == 0;
+    return lseek(m_fd, offset, whence) >= 0;
 }
 
 /** @return             Current file offset. */
 uint64_t POSIXFile::offset() const {
-    return lseek(m_fd, SEEK_CUR, 0);
+    return lseek(m_fd, 0, SEEK_CUR);
 }
 
 /** Read from the file at the specified offset.
@@ -191,7 +234,7 @@ bool POSIXDirectory::next(Entry &entry) {
  * @param path          Path to file to open.
  * @param mode          Mode to open file with (combination of File::Mode flags).
  * @return              Pointer to opened file, or null on failure. */
-File *Filesystem::openFile(const Path &path, unsigned mode) {
+File *PlatformFilesystem::openFile(const Path &path, unsigned mode) {
     int flags = 0;
 
     if (mode & File::kRead)
@@ -209,13 +252,13 @@ File *Filesystem::openFile(const Path &path, unsigned mode) {
     if (fd < 0)
         return nullptr;
 
-    return new POSIXFile(fd);
+    return new POSIXFile(fd, mode);
 }
 
 /** Open a directory.
  * @param path          Path to directory.
  * @return              Pointer to opened directory, or null on failure. */
-Directory *Filesystem::openDirectory(const Path &path) {
+Directory *PlatformFilesystem::openDirectory(const Path &path) {
     DIR *dir = opendir(path.c_str());
     if (!dir)
         return nullptr;
@@ -226,7 +269,7 @@ Directory *Filesystem::openDirectory(const Path &path) {
 /** Check if a path exists.
  * @param path          Path to check.
  * @return              Whether the path exists. */
-bool Filesystem::exists(const Path &path) {
+bool PlatformFilesystem::exists(const Path &path) {
     struct stat st;
     return stat(path.c_str(), &st) == 0;
 }
@@ -235,7 +278,7 @@ bool Filesystem::exists(const Path &path) {
  * @param path          Path to check.
  * @param type          Type to check for.
  * @return              Whether the path exists and is the specified type. */
-bool Filesystem::isType(const Path &path, FileType type) {
+bool PlatformFilesystem::isType(const Path &path, FileType type) {
     struct stat st;
     if (stat(path.c_str(), &st) != 0)
         return false;
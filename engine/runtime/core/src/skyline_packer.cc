@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Skyline rectangle packer.
+ */
+
+#include "core/skyline_packer.h"
+
+#include <limits>
+
+/** Initialise the packer with an empty area.
+ * @param width         Width of the packing area.
+ * @param height        Height of the packing area. */
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height) :
+    m_width  (width),
+    m_height (height)
+{
+    reset();
+}
+
+/** Remove all rectangles from the packer. */
+void SkylinePacker::reset() {
+    m_skyline.clear();
+    m_skyline.push_back({0, 0, m_width});
+}
+
+/**
+ * Enlarge the packing area.
+ *
+ * Enlarges the packing area, keeping the rectangles which have already been
+ * packed in the same positions.
+ *
+ * @param width         New width, must not be smaller than the current width.
+ * @param height        New height, must not be smaller than the current height.
+ */
+void SkylinePacker::grow(uint32_t width, uint32_t height) {
+    check(width >= m_width && height >= m_height);
+
+    if (width > m_width) {
+        Segment &last = m_skyline.back();
+        if (last.y == 0) {
+            last.width += width - m_width;
+        } else {
+            m_skyline.push_back({m_width, 0, width - m_width});
+        }
+    }
+
+    m_width  = width;
+    m_height = height;
+}
+
+/** Check whether a rectangle fits at the start of a segment.
+ * @param index         Index of the segment.
+ * @param width         Width of the rectangle.
+ * @param height        Height of the rectangle.
+ * @param outY          Where to store the Y position the rectangle would be
+ *                      placed at, which is the highest point of the skyline
+ *                      underneath it.
+ * @return              Whether the rectangle fits. */
+bool SkylinePacker::fit(size_t index, uint32_t width, uint32_t height, uint32_t &outY) const {
+    uint32_t x = m_skyline[index].x;
+    if (x + width > m_width)
+        return false;
+
+    uint32_t y = 0;
+    uint32_t remaining = width;
+    for (size_t i = index; remaining > 0; i++) {
+        y = std::max(y, m_skyline[i].y);
+        if (y + height > m_height)
+            return false;
+
+        remaining -= std::min(remaining, m_skyline[i].width);
+    }
+
+    outY = y;
+    return true;
+}
+
+/**
+ * Pack a rectangle.
+ *
+ * Finds a position for a rectangle in the packing area and marks the area it
+ * covers as used. Callers which need space between rectangles (e.g. to avoid
+ * filtering from neighbouring images) should include it in the size.
+ *
+ * @param width         Width of the rectangle.
+ * @param height        Height of the rectangle.
+ * @param outX          Where to store the X position of the rectangle.
+ * @param outY          Where to store the Y position of the rectangle.
+ *
+ * @return              Whether there was space for the rectangle.
+ */
+bool SkylinePacker::insert(uint32_t width, uint32_t height, uint32_t &outX, uint32_t &outY) {
+    check(width > 0 && height > 0);
+
+    /* Find the position which leaves the top of the rectangle lowest, using
+     * the width of the segment it is placed on to break ties (a narrower
+     * segment wastes less space). */
+    size_t bestIndex  = m_skyline.size();
+    uint32_t bestTop   = std::numeric_limits<uint32_t>::max();
+    uint32_t bestWidth = std::numeric_limits<uint32_t>::max();
+    uint32_t bestY     = 0;
+
+    for (size_t i = 0; i < m_skyline.size(); i++) {
+        uint32_t y;
+        if (fit(i, width, height, y)) {
+            uint32_t top = y + height;
+            if (top < bestTop || (top == bestTop && m_skyline[i].width < bestWidth)) {
+                bestIndex = i;
+                bestTop   = top;
+                bestWidth = m_skyline[i].width;
+                bestY     = y;
+            }
+        }
+    }
+
+    if (bestIndex == m_skyline.size())
+        return false;
+
+    outX = m_skyline[bestIndex].x;
+    outY = bestY;
+
+    /* Add a segment for the top of the rectangle, and remove the parts of the
+     * following segments that it covers. */
+    m_skyline.insert(m_skyline.begin() + bestIndex, {outX, bestTop, width});
+
+    uint32_t end = outX + width;
+    size_t next = bestIndex + 1;
+    while (next < m_skyline.size() && m_skyline[next].x < end) {
+        Segment &segment = m_skyline[next];
+        uint32_t segmentEnd = segment.x + segment.width;
+
+        if (segmentEnd <= end) {
+            m_skyline.erase(m_skyline.begin() + next);
+        } else {
+            segment.width = segmentEnd - end;
+            segment.x     = end;
+            break;
+        }
+    }
+
+    /* Merge neighbouring segments at the same height. */
+    for (size_t i = 0; i + 1 < m_skyline.size(); ) {
+        if (m_skyline[i].y == m_skyline[i + 1].y) {
+            m_skyline[i].width += m_skyline[i + 1].width;
+            m_skyline.erase(m_skyline.begin() + i + 1);
+        } else {
+            i++;
+        }
+    }
+
+    return true;
+}
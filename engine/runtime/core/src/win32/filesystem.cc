@@ -19,7 +19,7 @@
  * @brief               Win32 filesystem implementation.
  */
 
-#include "core/filesystem.h"
+#include "../platform_filesystem.h"
 
 #define NOMINMAX
 #include <windows.h>
@@ -231,7 +231,7 @@ bool Win32Directory::next(Entry &entry) {
  * @param path          Path to file to open.
  * @param mode          Mode to open file with (combination of File::Mode flags).
  * @return              Pointer to opened file, or null on failure. */
-File *Filesystem::openFile(const Path &path, unsigned mode) {
+File *PlatformFilesystem::openFile(const Path &path, unsigned mode) {
     std::string winPath = path.toPlatform();
 
     DWORD desiredAccess = 0;
@@ -270,7 +270,7 @@ File *Filesystem::openFile(const Path &path, unsigned mode) {
 /** Open a directory.
  * @param path          Path to directory.
  * @return              Pointer to opened directory, or null on failure. */
-Directory *Filesystem::openDirectory(const Path &path) {
+Directory *PlatformFilesystem::openDirectory(const Path &path) {
     if (!isType(path, FileType::kDirectory))
         return nullptr;
 
@@ -280,7 +280,7 @@ Directory *Filesystem::openDirectory(const Path &path) {
 /** Check if a path exists.
  * @param path          Path to check.
  * @return              Whether the path exists. */
-bool Filesystem::exists(const Path &path) {
+bool PlatformFilesystem::exists(const Path &path) {
     std::string winPath = path.toPlatform();
 
     WIN32_FIND_DATA findFileData;
@@ -295,7 +295,7 @@ bool Filesystem::exists(const Path &path) {
  * @param path          Path to check.
  * @param type          Type to check for.
  * @return              Whether the path exists and is the specified type. */
-bool Filesystem::isType(const Path &path, FileType type) {
+bool PlatformFilesystem::isType(const Path &path, FileType type) {
     std::string winPath = path.toPlatform();
 
     DWORD attributes = GetFileAttributes(winPath.c_str());
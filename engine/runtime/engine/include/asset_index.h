@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Asset index.
+ */
+
+#pragma once
+
+#include "core/data_stream.h"
+#include "core/hash_table.h"
+#include "core/path.h"
+
+#include <mutex>
+#include <vector>
+
+/**
+ * Index of the assets within a search path.
+ *
+ * This class maps asset paths within a search path to the files that make up
+ * each asset, so that loading an asset does not need to scan the directory
+ * containing it. The index is built on first use, either from a prebuilt index
+ * file in the root of the search path if one exists (the packer generates one
+ * for each asset directory it packages), or by scanning the whole directory
+ * tree otherwise. If a lookup does not find an asset, the directory
+ * it should be in is rescanned to pick up any newly added files.
+ *
+ * All methods are thread-safe.
+ */
+class AssetIndex : Noncopyable {
+public:
+    /** Files making up an asset. */
+    struct Entry {
+        /** Path to the data file relative to the root (empty if none). */
+        std::string data;
+
+        /** Path to the loader file relative to the root (empty if none). */
+        std::string loader;
+
+        /** Whether multiple data files were found for the asset. */
+        bool multipleData;
+    public:
+        Entry() : multipleData(false) {}
+    };
+
+    /** Name of a prebuilt index file in the root of a search path. */
+    static const char *const kIndexFileName;
+
+    explicit AssetIndex(const Path &root);
+    ~AssetIndex();
+
+    /** @return             Root directory of the index. */
+    const Path &root() const { return m_root; }
+
+    bool lookup(const Path &path, Entry &outEntry);
+    void refresh(const Path &directory);
+
+    bool load(DataStream *stream);
+    bool save(DataStream *stream);
+private:
+    void build();
+    bool deserialise(DataStream *stream);
+    Entry &addEntry(const std::string &path);
+    void rescanDirectory(const Path &directory);
+    void scanDirectory(const Path &directory, bool recursive);
+private:
+    Path m_root;                        /**< Root directory of the index. */
+    bool m_built;                       /**< Whether the index has been built. */
+    std::mutex m_lock;                  /**< Lock for the index. */
+
+    /** Map from asset path (relative to the root) to files. */
+    HashMap<std::string, Entry> m_entries;
+
+    /**
+     * Map from directory (relative to the root) to the paths of the assets in
+     * it, so that rescanning a directory only needs to touch its own entries.
+     */
+    HashMap<std::string, std::vector<std::string>> m_directories;
+};
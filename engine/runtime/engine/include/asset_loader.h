@@ -41,6 +41,9 @@ public:
 
     AssetPtr load(DataStream *data, const char *path);
 
+    bool prepare(DataStream *data, const char *path);
+    AssetPtr finish();
+
     /** @return             Whether the loader requires data. */
     bool requireData() const { return extension() != nullptr; }
 
@@ -48,8 +51,27 @@ public:
 protected:
     AssetLoader() {}
 
-    /** Load the asset.
-     * @return              Pointer to loaded asset, null on failure. */
+    /**
+     * Prepare the asset data.
+     *
+     * Performs any CPU-side work needed to load the asset which does not
+     * depend on other engine state, for example reading and decoding the
+     * source data. This may be called from an asset manager worker thread,
+     * therefore it must not create GPU resources or load other assets. The
+     * default implementation does nothing.
+     *
+     * @return              Whether the data was prepared successfully.
+     */
+    virtual bool prepare() { return true; }
+
+    /**
+     * Load the asset.
+     *
+     * Creates the asset from the data prepared by prepare(). This is always
+     * called on the main thread.
+     *
+     * @return              Pointer to loaded asset, null on failure.
+     */
     virtual AssetPtr load() = 0;
 protected:
     DataStream *m_data;                 /**< Asset data stream (if any). */
@@ -24,11 +24,75 @@
 #include "core/path.h"
 
 #include "engine/asset.h"
+#include "engine/asset_index.h"
 
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 class AssetLoader;
+class DataStream;
+
+/**
+ * Asynchronous asset load request.
+ *
+ * This class is a handle to an asset being loaded asynchronously, returned by
+ * AssetManager::loadAsync(). The load proceeds in the background, and the
+ * handle can be polled for completion, or waited on.
+ */
+class AssetLoadRequest : public Refcounted {
+public:
+    ~AssetLoadRequest();
+
+    /** @return             Path to the asset being loaded. */
+    const std::string &path() const { return m_path; }
+    /** @return             Whether the load has completed (successfully or not). */
+    bool isComplete() const { return m_stage == kComplete; }
+
+    /** @return             Loaded asset, null if not yet complete or failed. */
+    Asset *asset() const { return m_asset; }
+
+    AssetPtr wait();
+private:
+    /** Stage that a request is at. */
+    enum Stage {
+        kOpenStage,                     /**< Locating and reading files (worker). */
+        kPrepareStage,                  /**< Preparing data with the loader (worker). */
+        kComplete,                      /**< Load has completed. */
+    };
+private:
+    explicit AssetLoadRequest(const Path &path);
+private:
+    std::string m_path;                 /**< Path to the asset. */
+    Stage m_stage;                      /**< Current stage of the request. */
+    bool m_succeeded;                   /**< Whether the last stage succeeded. */
+
+    std::string m_type;                 /**< Source file type. */
+    std::unique_ptr<DataStream> m_data; /**< Asset data stream. */
+    bool m_hasLoader;                   /**< Whether a serialised loader exists. */
+
+    /** Loader stream, kept open while its data is mapped. */
+    std::unique_ptr<DataStream> m_loaderData;
+
+    /** Serialised object/loader data. This either points directly into the
+     *  mapped stream data (binary data only), or to m_serialisedBuffer, which
+     *  is null-terminated and can be modified by the serialiser. */
+    const void *m_serialisedData;
+    size_t m_serialisedSize;            /**< Size of serialised data. */
+    std::vector<uint8_t> m_serialisedBuffer;
+
+    ObjectPtr<AssetLoader> m_loader;    /**< Loader for the asset. */
+    AssetPtr m_asset;                   /**< Loaded asset. */
+
+    friend class AssetManager;
+};
+
+/** Type of a pointer to an asset load request. */
+using AssetLoadRequestPtr = ReferencePtr<AssetLoadRequest>;
 
 /**
  * Engine asset manager.
@@ -43,10 +107,29 @@ public:
 
     AssetPtr load(const Path &path);
     template <typename AssetType> TypedAssetPtr<AssetType> load(const Path &path);
+
+    AssetLoadRequestPtr loadAsync(const Path &path);
+
+    void update();
+
+    DataStream *openData(const Path &path) const;
 private:
+    AssetIndex *lookupIndex(const Path &path, AssetIndex::Entry &entry) const;
     Asset *lookupAsset(const Path &path) const;
     void unregisterAsset(Asset *asset);
 
+    bool openAsset(AssetLoadRequest *request) const;
+    bool createLoader(AssetLoadRequest *request);
+    bool prepareAsset(AssetLoadRequest *request) const;
+    bool finishAsset(AssetLoadRequest *request);
+    void addAsset(Asset *asset, const std::string &path);
+    void completeRequest(AssetLoadRequest *request, bool succeeded);
+    void advanceRequest(AssetLoadRequest *request);
+
+    void queueWork(AssetLoadRequest *request);
+    void waitForCompletion();
+    void workerThread();
+
     void explore();
 private:
     /**
@@ -60,8 +143,29 @@ private:
      */
     std::map<std::string, Asset *> m_assets;
 
-    /** Asset search paths. */
-    std::map<std::string, std::string> m_searchPaths;
+    /** Asset search paths, with an index of the assets in each. */
+    std::map<std::string, std::unique_ptr<AssetIndex>> m_searchPaths;
+
+    /**
+     * Map of in-progress asynchronous loads.
+     *
+     * This holds a reference to each request until it is complete, and is used
+     * to ensure that multiple loads of the same asset while it is in progress
+     * share the same request.
+     */
+    std::map<std::string, AssetLoadRequestPtr> m_pendingLoads;
+
+    std::vector<std::thread> m_workers;     /**< Worker threads. */
+    std::mutex m_queueLock;                 /**< Lock for the queues. */
+    std::condition_variable m_workCond;     /**< Signalled when work is queued. */
+    std::condition_variable m_completeCond; /**< Signalled when work completes. */
+    bool m_exiting;                         /**< Whether workers should exit. */
+
+    /** Requests waiting for a worker thread. */
+    std::deque<AssetLoadRequest *> m_workQueue;
+
+    /** Requests which have finished a worker stage, to be handled on the main thread. */
+    std::deque<AssetLoadRequest *> m_completeQueue;
 
     friend class Asset;
     friend class AssetExplorerWindow;
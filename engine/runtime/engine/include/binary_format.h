@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Binary serialisation format.
+ *
+ * This defines the file format used by BinarySerialiser. It is kept separate
+ * from the serialiser class itself so that offline tools can produce binary
+ * serialised data without depending on the engine.
+ *
+ * A file begins with a BinaryHeader. This is followed by the value data, an
+ * array of BinaryObject structures giving the class and property group of each
+ * object in the file (in ID order), and a string table. All names, class
+ * names, string values and asset paths are stored once in the string table and
+ * referred to by index. All values are little-endian, and all offsets are from
+ * the start of the file.
+ *
+ * Each value is a BinaryValueType tag byte followed by its payload:
+ *
+ *  - kBinaryBool: 1 byte.
+ *  - kBinaryInt32/kBinaryUint32/kBinaryFloat: 4 bytes.
+ *  - kBinaryInt64/kBinaryUint64/kBinaryDouble: 8 bytes.
+ *  - kBinaryString/kBinaryAssetRef: 32-bit string index.
+ *  - kBinaryObjectRef: 32-bit object ID.
+ *  - kBinaryNullRef: nothing.
+ *  - kBinaryFloatArray: 32-bit count followed by that many floats. Vectors and
+ *    quaternions are stored this way (quaternions in w, x, y, z order).
+ *  - kBinaryGroup: 32-bit member count and 32-bit offset of a member table,
+ *    which is an array of BinaryMember. The member values precede the table.
+ *  - kBinaryArray: 32-bit element count and 32-bit offset of a table of 32-bit
+ *    element value offsets. The element values precede the table.
+ *
+ * Payloads are not aligned, so must be read with memcpy().
+ */
+
+#pragma once
+
+#include "core/defs.h"
+
+#include <cstring>
+
+/** Binary serialised file header. */
+struct BinaryHeader {
+    char magic[4];                      /**< Magic number (kBinaryMagic). */
+    uint32_t version;                   /**< Format version (kBinaryVersion). */
+    uint32_t numObjects;                /**< Number of objects. */
+    uint32_t objectsOffset;             /**< Offset of the object array. */
+    uint32_t numStrings;                /**< Number of strings. */
+    uint32_t stringsOffset;             /**< Offset of the string table. */
+    uint32_t stringsSize;               /**< Size of the string table. */
+};
+
+/** Binary serialised object entry. */
+struct BinaryObject {
+    uint32_t className;                 /**< String index of the class name. */
+    uint32_t offset;                    /**< Offset of the object's property group. */
+};
+
+/** Binary serialised group member entry. */
+struct BinaryMember {
+    uint32_t name;                      /**< String index of the member name. */
+    uint32_t offset;                    /**< Offset of the member value. */
+};
+
+/** Binary serialised value types. */
+enum BinaryValueType : uint8_t {
+    kBinaryBool,
+    kBinaryInt32,
+    kBinaryUint32,
+    kBinaryInt64,
+    kBinaryUint64,
+    kBinaryFloat,
+    kBinaryDouble,
+    kBinaryString,
+    kBinaryFloatArray,
+    kBinaryGroup,
+    kBinaryArray,
+    kBinaryObjectRef,
+    kBinaryAssetRef,
+    kBinaryNullRef,
+};
+
+/** Binary serialised file magic number. */
+static const char kBinaryMagic[4] = { 'O', 'B', 'I', 'N' };
+
+/** Current binary serialised format version. */
+static const uint32_t kBinaryVersion = 1;
+
+/** Check whether some data is in the binary serialised format.
+ * @param data          Data to check.
+ * @param size          Size of the data.
+ * @return              Whether the data has a binary serialised file header. */
+inline bool isBinarySerialised(const void *data, size_t size) {
+    return size >= sizeof(BinaryHeader) && memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) == 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Binary serialisation class.
+ */
+
+#pragma once
+
+#include "engine/serialiser.h"
+
+/**
+ * Class implementing (de)serialisation using a compact binary format.
+ *
+ * This produces data in the format described in engine/binary_format.h. It is
+ * much smaller and faster to deserialise than JSON, but is not human readable,
+ * so it is intended for cooked assets rather than source assets. Deserialised
+ * objects are identical to those deserialised from the equivalent JSON.
+ */
+class BinarySerialiser : public Serialiser {
+public:
+    BinarySerialiser();
+
+    std::vector<uint8_t> serialise(const Object *object) override;
+    ObjectPtr<Object> deserialise(const void *data, size_t size, const MetaClass &metaClass) override;
+    using Serialiser::deserialise;
+    using Serialiser::deserialiseInSitu;
+
+    bool beginGroup(const char *name) override;
+    void endGroup() override;
+    bool beginArray(const char *name) override;
+    void endArray() override;
+protected:
+    void write(const char *name, const MetaType &type, const void *value) override;
+    bool read(const char *name, const MetaType &type, void *value) override;
+private:
+    uint32_t addObject(const Object *object);
+    ObjectPtr<Object> findObject(uint32_t id, const MetaClass &metaClass);
+
+    struct State;
+    State *m_state;                 /**< State of current operation. */
+};
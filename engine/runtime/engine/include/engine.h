@@ -48,6 +48,9 @@ struct EngineConfiguration {
     uint32_t displayHeight;         /**< Screen height. */
     bool displayFullscreen;         /**< Whether the window should be fullscreen. */
     bool displayVsync;              /**< Whether to synchronize updates with vertical retrace. */
+
+    /** Memory budget for streamed textures in bytes (0 to disable streaming). */
+    uint64_t textureStreamingBudget;
 };
 
 /** Engine statistics. */
@@ -55,11 +58,13 @@ struct EngineStats {
     float fps;                      /**< Number of frames per second. */
     float frameTime;                /**< Last frame time in seconds. */
     unsigned drawCalls;             /**< Number of draw calls in the last frame. */
+    unsigned drawInstances;         /**< Number of instances drawn in the last frame. */
 public:
     EngineStats() :
-        fps       (0),
-        frameTime (0),
-        drawCalls (0)
+        fps           (0),
+        frameTime     (0),
+        drawCalls     (0),
+        drawInstances (0)
     {}
 };
 
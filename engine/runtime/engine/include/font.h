@@ -22,6 +22,7 @@
 #pragma once
 
 #include "core/hash_table.h"
+#include "core/skyline_packer.h"
 
 #include "engine/asset.h"
 #include "engine/texture.h"
@@ -32,37 +33,66 @@ class Font;
 
 /** Structure containing details of a glyph within a font. */
 struct FontGlyph {
+    unsigned page;                      /**< Index of atlas page containing the glyph. */
     unsigned x;                         /**< X position of glyph in texture. */
     unsigned y;                         /**< Y position of glyph in texture. */
     unsigned width;                     /**< Width of the glyph image. */
     unsigned height;                    /**< Height of the glyph image. */
 
     /** Horizontal offset from cursor position to left of glyph image. */
-    unsigned offsetX;
+    int offsetX;
 
-    /** Vertical offset from cursor position to top of glyph image. */
-    unsigned offsetY;
+    /** Vertical offset from top of the line to top of glyph image. */
+    int offsetY;
 
     /** Horizontal distance to advance the cursor to the next glyph position. */
     unsigned advance;
+public:
+    FontGlyph() :
+        page    (0),
+        x       (0),
+        y       (0),
+        width   (0),
+        height  (0),
+        offsetX (0),
+        offsetY (0),
+        advance (0)
+    {}
 };
 
 /** Descriptor for a font variant. */
 struct FontVariantDesc {
     unsigned pointSize;                 /**< Font size. */
 
+    /**
+     * Whether to store glyphs as signed distance fields.
+     *
+     * Glyph images in the atlas of a distance field variant contain the
+     * distance to the edge of the glyph rather than its coverage, which allows
+     * them to be scaled to any size while keeping sharp edges. A single
+     * distance field variant can therefore be used to draw text at all sizes,
+     * with glyph metrics scaled from the variant's point size. See
+     * FontVariant::kDistanceFieldSpread.
+     */
+    bool distanceField;
+
     // TODO: Weight, italic. Not supported at the moment because the Font asset
     // can only load one font file. In future we want to be able to bundle
     // multiple files for different weights etc. into one font asset.
 public:
+    FontVariantDesc() :
+        pointSize     (0),
+        distanceField (false)
+    {}
+
     /** Compare this descriptor with another. */
     bool operator ==(const FontVariantDesc &other) const {
-        return pointSize == other.pointSize;
+        return pointSize == other.pointSize && distanceField == other.distanceField;
     }
 
     /** Get a hash from a font variant descriptor. */
     friend size_t hashValue(const FontVariantDesc &desc) {
-        return hashValue(desc.pointSize);
+        return hashCombine(hashValue(desc.pointSize), desc.distanceField);
     }
 };
 
@@ -71,41 +101,80 @@ public:
  *
  * A font variant is an instantiation of a font asset with specific properties,
  * i.e. size, weight, etc. This is what is actually used to draw with.
+ *
+ * Glyphs are rasterised on demand, the first time they are requested, and
+ * packed into a set of texture atlas pages which grow as needed. The texture
+ * data for new glyphs is kept on the CPU until flush() is called, which
+ * uploads all changes to each page at once. Users should therefore request
+ * all of the glyphs needed for a frame, call flush(), and then draw with the
+ * page textures, which may be different objects from frame to frame.
  */
 class FontVariant {
 public:
+    /**
+     * Range of distances stored in distance field glyphs.
+     *
+     * This is the distance in pixels (at the variant's point size) either side
+     * of the edge of a glyph which is covered by the distance field. Values in
+     * the atlas map the range [-spread, spread] to [0, 1], with 0.5 lying on
+     * the edge and higher values inside the glyph. Glyph images include this
+     * much space around the glyph.
+     */
+    static const unsigned kDistanceFieldSpread = 4;
+
     ~FontVariant();
 
-    /** Get metrics and atlas position information for a glyph.
-     * @param ch            Glyph to look up.
-     * @return              Information for the specified glyph. */
-    const FontGlyph &getGlyph(unsigned char ch) const { return m_glyphs[ch]; }
+    const FontGlyph &getGlyph(uint32_t codepoint);
+
+    void flush();
 
     /** @return             Font that the variant belongs to. */
     Font *font() const { return m_font; }
     /** @return             Point size of the font. */
     unsigned pointSize() const { return m_desc.pointSize; }
-    /** @return             Texture atlas containing glyph data. */
-    Texture2D *texture() const { return m_texture; }
+    /** @return             Whether glyphs are stored as signed distance fields. */
+    bool isDistanceField() const { return m_desc.distanceField; }
+    /** @return             Number of texture atlas pages. */
+    unsigned numPages() const { return m_pages.size(); }
+    /** Get the texture for an atlas page.
+     * @param page          Index of the page.
+     * @return              Texture containing glyph data for the page. */
+    Texture2D *texture(unsigned page) const { return m_pages[page]->texture; }
     /** @return             Vertical distance between rows. */
     unsigned height() const { return m_height; }
     /** @return             Maximum glyph width. */
     unsigned maxWidth() const { return m_maxWidth; }
+private:
+    /** Texture atlas page. */
+    struct Page {
+        Texture2DPtr texture;           /**< Texture containing the page data. */
+        SkylinePacker packer;           /**< Packer for glyph images. */
+        std::vector<uint8_t> pixels;    /**< Copy of the page data. */
+        IntRect dirty;                  /**< Area changed since the last flush. */
+    public:
+        explicit Page(uint32_t size);
+    };
 private:
     FontVariant(Font *font, const FontVariantDesc &desc);
 
     bool load();
+    void setCharSize();
+    void loadGlyph(uint32_t codepoint, FontGlyph &glyph);
+    bool addImage(const uint8_t *image, unsigned width, unsigned height, FontGlyph &glyph);
+    void growPage(Page &page);
 private:
     Font *m_font;                       /**< Font that the variant belongs to. */
     FontVariantDesc m_desc;             /**< Descriptor used to create the font variant. */
-    Texture2DPtr m_texture;             /**< Texture atlas containing glyph data. */
     unsigned m_height;                  /**< Distance from one baseline to the next. */
     unsigned m_maxWidth;                /**< Maximum glyph width. */
     unsigned m_maxAscender;             /**< Maximum distance from baseline to top of glyph. */
     unsigned m_maxDescender;            /**< Maximum distance from baseline to bottom of glyph. */
 
-    /** Array of glyph information. */
-    std::vector<FontGlyph> m_glyphs;
+    /** Glyphs which have been loaded, indexed by codepoint. */
+    HashMap<uint32_t, FontGlyph> m_glyphs;
+
+    /** Texture atlas pages. */
+    std::vector<std::unique_ptr<Page>> m_pages;
 
     friend class Font;
 };
@@ -144,6 +213,9 @@ private:
     size_t m_dataSize;                  /**< TTF file data size. */
     void *m_face;                       /**< FreeType face. */
 
+    /** Variant whose size the face is currently set to. */
+    FontVariant *m_sizedVariant;
+
     /** Variants of the font. */
     HashMap<FontVariantDesc, std::unique_ptr<FontVariant>> m_variants;
 
@@ -29,8 +29,10 @@ public:
     JSONSerialiser();
 
     std::vector<uint8_t> serialise(const Object *object) override;
-    ObjectPtr<Object> deserialise(const std::vector<uint8_t> &data, const MetaClass &metaClass) override;
+    ObjectPtr<Object> deserialise(const void *data, size_t size, const MetaClass &metaClass) override;
+    ObjectPtr<Object> deserialiseInSitu(void *data, size_t size, const MetaClass &metaClass) override;
     using Serialiser::deserialise;
+    using Serialiser::deserialiseInSitu;
 
     bool beginGroup(const char *name) override;
     void endGroup() override;
@@ -33,18 +33,65 @@ class Mesh;
 /** Sub-component of a Mesh. */
 class SubMesh {
 public:
+    /**
+     * Cluster of triangles within a sub-mesh.
+     *
+     * Large sub-meshes may be divided into clusters of triangles which can be
+     * culled individually. Each has a bounding sphere for frustum culling and
+     * a cone bounding the normals of its triangles for back-face culling: all
+     * triangles are back-facing when viewed from a position p for which
+     * dot(normalize(coneApex - p), coneAxis) >= coneCutoff.
+     */
+    struct Cluster {
+        Sphere bounds;                      /**< Bounding sphere. */
+        glm::vec3 coneApex;                 /**< Normal cone apex. */
+        glm::vec3 coneAxis;                 /**< Normal cone axis. */
+        float coneCutoff;                   /**< Normal cone cutoff (>= 1 for no cone). */
+        uint32_t firstIndex;                /**< First index within the sub-mesh's indices. */
+        uint32_t numIndices;                /**< Number of indices. */
+    };
+
     /** @return             Parent mesh. */
     Mesh &parent() const { return m_parent; }
 public:
     /** @return             Number of indices in the sub-mesh. */
     size_t numIndices() const { return m_indices->count(); }
-    /** @return             Current index data for the sub-mesh. */
-    GPUIndexData *indices() const { return m_indices; }
+
+    /** Get the index data for a level of detail.
+     * @param lod           Level of detail (0 is full detail). Not bounds
+     *                      checked.
+     * @return              Index data for the level of detail. */
+    GPUIndexData *indices(size_t lod = 0) const {
+        return (lod == 0) ? m_indices : m_lods[lod - 1].indices;
+    }
 
     void setIndices(GPUIndexDataPtr indices);
     void setIndices(const std::vector<uint16_t> &indices);
     void setIndices(const std::vector<uint32_t> &indices);
 
+    /** @return             Number of levels of detail, including full detail. */
+    size_t numLODs() const { return m_lods.size() + 1; }
+
+    /** Get the error of a level of detail.
+     * @param lod           Level of detail (0 is full detail). Not bounds
+     *                      checked.
+     * @return              Maximum deviation of the level of detail from the
+     *                      full detail geometry, in the mesh's local space. */
+    float lodError(size_t lod) const {
+        return (lod == 0) ? 0.0f : m_lods[lod - 1].error;
+    }
+
+    void addLOD(GPUIndexDataPtr indices, float error);
+
+    /** @return             Clusters of the full detail sub-mesh (may be empty). */
+    const std::vector<Cluster> &clusters() const { return m_clusters; }
+
+    void setClusters(std::vector<Cluster> clusters, std::vector<uint8_t> indexData);
+    void cullClusters(const Frustum &frustum,
+                      const glm::vec4 &viewPosition,
+                      std::vector<uint32_t> &outVisible) const;
+    GPUIndexDataPtr buildClusterIndices(const std::vector<uint32_t> &clusters) const;
+
     size_t material;                        /**< Material index in parent mesh. */
     BoundingBox boundingBox;                /**< Axis-aligned bounding box. */
 private:
@@ -55,8 +102,19 @@ private:
 
     ~SubMesh() {}
 private:
+    /** Simplified level of detail. */
+    struct LOD {
+        GPUIndexDataPtr indices;            /**< Indices into vertex data. */
+        float error;                        /**< Deviation from full detail. */
+    };
+
     Mesh &m_parent;                         /**< Parent mesh. */
     GPUIndexDataPtr m_indices;              /**< Indices into vertex data. */
+    std::vector<LOD> m_lods;                /**< Levels of detail after full detail. */
+    std::vector<Cluster> m_clusters;        /**< Clusters of the full detail sub-mesh. */
+
+    /** CPU copy of the full detail index data, for building culled indices. */
+    std::vector<uint8_t> m_clusterIndexData;
 
     friend class Mesh;
 };
@@ -103,6 +161,21 @@ public:
 
     void setVertices(GPUVertexDataPtr data);
 
+    /**
+     * Get the vertex position transformation.
+     *
+     * Gets the transformation to apply to vertex positions to get the actual
+     * position of a vertex in the mesh's local space. This is used when
+     * positions are stored in a quantised format. Normally this is identity.
+     *
+     * @return              Vertex position transformation.
+     */
+    const glm::mat4 &positionTransform() const { return m_positionTransform; }
+
+    /** Set the vertex position transformation.
+     * @param transform     New transformation. */
+    void setPositionTransform(const glm::mat4 &transform) { m_positionTransform = transform; }
+
     void setNumVertices(size_t count);
 
     bool hasAttribute(VertexAttribute::Semantic semantic,
@@ -157,6 +230,7 @@ private:
     size_t m_numVertices;                   /**< Number of vertices. */
     GPUVertexDataLayoutDesc m_layoutDesc;   /**< Layout descriptor. */
     GPUBufferArray m_buffers;               /**< Array of buffers containing mesh data. */
+    glm::mat4 m_positionTransform;          /**< Vertex position transformation. */
 };
 
 /** Type of a mesh pointer. */
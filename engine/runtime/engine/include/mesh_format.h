@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Cooked mesh format.
+ *
+ * This defines the file format for cooked meshes, as produced by MeshBuilder
+ * (either offline by the meshcook tool, or at load time from source data).
+ * The data is laid out ready for upload to the GPU, so that loading a cooked
+ * mesh requires no processing other than copying the vertex and index data
+ * into GPU buffers.
+ *
+ * A file begins with a MeshHeader. All offsets are from the start of the file,
+ * and all values are little-endian. The file contains:
+ *
+ *  - An array of MeshAttribute structures describing the vertex layout. All
+ *    attributes are interleaved in a single vertex stream.
+ *  - The vertex data, numVertices * vertexStride bytes, aligned to 16 bytes.
+ *  - The index data for all submeshes, either 16-bit or 32-bit depending on
+ *    indexType (a GPUIndexData::Type value), aligned to 4 bytes.
+ *  - An array of MeshSubMesh structures giving the range of the index data
+ *    used by each submesh, along with its material and bounding box.
+ *  - An array of MeshLOD structures giving the range of the index data used
+ *    by each simplified level of detail of the submeshes. All levels of detail
+ *    share the vertex data of the full detail mesh.
+ *  - An array of MeshCluster structures dividing the full detail index data
+ *    of large submeshes into small contiguous clusters of triangles, with
+ *    bounds for culling each cluster individually.
+ *  - A string table holding material names.
+ *
+ * Vertex attributes may be stored in compact formats: normals and tangents as
+ * packed 10:10:10:2 normalised values and texture coordinates as half floats.
+ * Positions may be quantised to 16-bit normalised values relative to the
+ * bounding box of the mesh, in which case the header gives the transformation
+ * needed to get back to the original positions (original = quantised *
+ * positionScale + positionOffset).
+ *
+ * Structures are naturally aligned within the file, so can be accessed in
+ * place when the data is suitably aligned in memory.
+ */
+
+#pragma once
+
+#include "core/math.h"
+
+#include <cstring>
+
+/** Cooked mesh file header. */
+struct MeshHeader {
+    char magic[4];                      /**< Magic number (kMeshMagic). */
+    uint32_t version;                   /**< Format version (kMeshVersion). */
+    uint32_t numVertices;               /**< Number of vertices. */
+    uint32_t vertexStride;              /**< Size of each vertex. */
+    uint32_t verticesOffset;            /**< Offset of the vertex data. */
+    uint32_t numAttributes;             /**< Number of vertex attributes. */
+    uint32_t attributesOffset;          /**< Offset of the attribute array. */
+    uint32_t indexType;                 /**< Type of index elements (GPUIndexData::Type). */
+    uint32_t numIndices;                /**< Total number of indices. */
+    uint32_t indicesOffset;             /**< Offset of the index data. */
+    uint32_t numSubMeshes;              /**< Number of submeshes. */
+    uint32_t subMeshesOffset;           /**< Offset of the submesh array. */
+    uint32_t numLODs;                   /**< Total number of simplified levels of detail. */
+    uint32_t lodsOffset;                /**< Offset of the level of detail array. */
+    uint32_t numClusters;               /**< Total number of clusters. */
+    uint32_t clustersOffset;            /**< Offset of the cluster array. */
+    uint32_t stringsOffset;             /**< Offset of the string table. */
+    uint32_t stringsSize;               /**< Size of the string table. */
+    float positionOffset[3];            /**< Offset to dequantise positions. */
+    float positionScale;                /**< Scale to dequantise positions. */
+};
+
+/** Cooked mesh vertex attribute entry. */
+struct MeshAttribute {
+    uint32_t semantic;                  /**< Attribute semantic (VertexAttribute::Semantic). */
+    uint32_t index;                     /**< Attribute index. */
+    uint32_t type;                      /**< Attribute data type (VertexAttribute::Type). */
+    uint32_t normalised;                /**< Whether fixed-point values are normalised. */
+    uint32_t components;                /**< Number of components. */
+    uint32_t offset;                    /**< Offset of the attribute within a vertex. */
+};
+
+/** Cooked mesh submesh entry. */
+struct MeshSubMesh {
+    uint32_t material;                  /**< Offset of the material name in the string table. */
+    uint32_t firstIndex;                /**< First index in the index data. */
+    uint32_t numIndices;                /**< Number of indices. */
+    float minimum[3];                   /**< Bounding box minimum. */
+    float maximum[3];                   /**< Bounding box maximum. */
+    uint32_t firstLOD;                  /**< First simplified level of detail in the LOD array. */
+    uint32_t numLODs;                   /**< Number of simplified levels of detail. */
+    uint32_t firstCluster;              /**< First cluster in the cluster array. */
+    uint32_t numClusters;               /**< Number of clusters (0 if not clustered). */
+};
+
+/** Cooked mesh level of detail entry. */
+struct MeshLOD {
+    uint32_t firstIndex;                /**< First index in the index data. */
+    uint32_t numIndices;                /**< Number of indices. */
+    float error;                        /**< Geometric error relative to the full detail mesh. */
+};
+
+/**
+ * Cooked mesh cluster entry.
+ *
+ * The normal cone bounds the normals of all triangles in the cluster: every
+ * triangle is back-facing when viewed from a position p for which
+ * dot(normalize(coneApex - p), coneAxis) >= coneCutoff. A cutoff of 1 or
+ * more means the cluster can never be back-face culled.
+ */
+struct MeshCluster {
+    uint32_t firstIndex;                /**< First index in the index data. */
+    uint32_t numIndices;                /**< Number of indices. */
+    float centre[3];                    /**< Bounding sphere centre. */
+    float radius;                       /**< Bounding sphere radius. */
+    float coneApex[3];                  /**< Normal cone apex. */
+    float coneAxis[3];                  /**< Normal cone axis. */
+    float coneCutoff;                   /**< Normal cone cutoff. */
+};
+
+/**
+ * Check whether a mesh cluster may be visible.
+ *
+ * Culls a cluster against a frustum using its bounding sphere, and tests
+ * whether it is entirely back-facing from a view position using its normal
+ * cone (see MeshCluster). This is conservative: a cluster which contains any
+ * visible triangle is never culled. The frustum and view position must be in
+ * the mesh's local space.
+ *
+ * The view position is given in homogeneous coordinates. An orthographic view
+ * has its position at infinity, so it is given with a W of 0 and the viewing
+ * direction in XYZ: every triangle is then seen from the same direction, rather
+ * than from the direction of the view's position.
+ *
+ * @param bounds        Bounding sphere of the cluster.
+ * @param coneApex      Normal cone apex.
+ * @param coneAxis      Normal cone axis.
+ * @param coneCutoff    Normal cone cutoff.
+ * @param frustum       Frustum to cull against.
+ * @param viewPosition  View position (W = 1), or viewing direction for an
+ *                      orthographic view (W = 0).
+ *
+ * @return              Whether the cluster may be visible.
+ */
+static inline bool isMeshClusterVisible(const Sphere &bounds,
+                                        const glm::vec3 &coneApex,
+                                        const glm::vec3 &coneAxis,
+                                        float coneCutoff,
+                                        const Frustum &frustum,
+                                        const glm::vec4 &viewPosition)
+{
+    if (coneCutoff < 1.0f) {
+        const glm::vec3 direction = (viewPosition.w != 0.0f)
+                                        ? glm::normalize(coneApex - glm::vec3(viewPosition))
+                                        : glm::normalize(glm::vec3(viewPosition));
+        if (glm::dot(direction, coneAxis) >= coneCutoff)
+            return false;
+    }
+
+    return Math::intersect(frustum, bounds);
+}
+
+/** Cooked mesh file magic number. */
+static const char kMeshMagic[4] = { 'O', 'M', 'S', 'H' };
+
+/** Current cooked mesh format version. */
+static const uint32_t kMeshVersion = 4;
+
+/** Alignment of the vertex data in a cooked mesh. */
+static const uint32_t kMeshVertexAlignment = 16;
+
+/** Check whether some data is a cooked mesh.
+ * @param data          Data to check.
+ * @param size          Size of the data.
+ * @return              Whether the data has a cooked mesh header. */
+inline bool isCookedMesh(const void *data, size_t size) {
+    return size >= sizeof(MeshHeader) && memcmp(data, kMeshMagic, sizeof(kMeshMagic)) == 0;
+}
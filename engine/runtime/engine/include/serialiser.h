@@ -112,7 +112,9 @@ namespace Detail {
  * An exception to this behaviour is for managed assets. Despite being just
  * objects, if a reference to an object derived from Asset is serialised and
  * the asset is managed, the asset path will be stored. Unmanaged assets will
- * be serialised to the file.
+ * be serialised to the file. When deserialising, loads of all assets referred
+ * to by a file are started asynchronously before any objects are created, and
+ * each reference then only waits for its asset when it is read.
  */
 class Serialiser {
 public:
@@ -135,6 +137,41 @@ public:
      */
     virtual std::vector<uint8_t> serialise(const Object *object) = 0;
 
+    /**
+     * Deserialise an object.
+     *
+     * Deserialises an object previously serialised in the format implemented
+     * by this serialiser instance. The data is not modified, and need not
+     * remain valid after this returns, so it can for example point directly
+     * into a memory-mapped file.
+     *
+     * @param data          Serialised data.
+     * @param size          Size of the serialised data.
+     * @param metaClass     Expected type of the object.
+     *
+     * @return              Pointer to deserialised object, or null on failure.
+     */
+    virtual ObjectPtr<Object> deserialise(const void *data, size_t size, const MetaClass &metaClass) = 0;
+
+    /**
+     * Deserialise an object from modifiable data.
+     *
+     * Behaves the same as deserialise(), but allows the serialiser to modify
+     * the data, so that formats which need to transform it (e.g. JSON, which
+     * is parsed in-situ) do not need to take a copy of it first. The data must
+     * be followed by a null byte, not included in the size. It need not remain
+     * valid after this returns.
+     *
+     * @param data          Serialised data.
+     * @param size          Size of the serialised data.
+     * @param metaClass     Expected type of the object.
+     *
+     * @return              Pointer to deserialised object, or null on failure.
+     */
+    virtual ObjectPtr<Object> deserialiseInSitu(void *data, size_t size, const MetaClass &metaClass) {
+        return deserialise(data, size, metaClass);
+    }
+
     /**
      * Deserialise an object.
      *
@@ -146,7 +183,27 @@ public:
      *
      * @return              Pointer to deserialised object, or null on failure.
      */
-    virtual ObjectPtr<Object> deserialise(const std::vector<uint8_t> &data, const MetaClass &metaClass) = 0;
+    ObjectPtr<Object> deserialise(const std::vector<uint8_t> &data, const MetaClass &metaClass) {
+        return deserialise(data.data(), data.size(), metaClass);
+    }
+
+    /**
+     * Deserialise an object.
+     *
+     * Deserialises an object previously serialised in the format implemented
+     * by this serialiser instance.
+     *
+     * @tparam T            Expected type of the object.
+     * @param data          Serialised data.
+     * @param size          Size of the serialised data.
+     *
+     * @return              Pointer to deserialised object, or null on failure.
+     */
+    template <typename T>
+    ObjectPtr<T> deserialise(const void *data, size_t size) {
+        ObjectPtr<Object> object = deserialise(data, size, T::staticMetaClass);
+        return object.staticCast<T>();
+    }
 
     /**
      * Deserialise an object.
@@ -161,7 +218,24 @@ public:
      */
     template <typename T>
     ObjectPtr<T> deserialise(const std::vector<uint8_t> &data) {
-        ObjectPtr<Object> object = deserialise(data, T::staticMetaClass);
+        return deserialise<T>(data.data(), data.size());
+    }
+
+    /**
+     * Deserialise an object from modifiable data.
+     *
+     * Deserialises an object previously serialised in the format implemented
+     * by this serialiser instance. See the non-template version for details.
+     *
+     * @tparam T            Expected type of the object.
+     * @param data          Serialised data, followed by a null byte.
+     * @param size          Size of the serialised data.
+     *
+     * @return              Pointer to deserialised object, or null on failure.
+     */
+    template <typename T>
+    ObjectPtr<T> deserialiseInSitu(void *data, size_t size) {
+        ObjectPtr<Object> object = deserialiseInSitu(data, size, T::staticMetaClass);
         return object.staticCast<T>();
     }
 
@@ -88,7 +88,16 @@ private:
     friend class Texture2D;
 };
 
-/** Class implementing a 2D texture. */
+struct TextureStream;
+
+/**
+ * Class implementing a 2D texture.
+ *
+ * A 2D texture may have its mip levels streamed (see TextureStreamingManager),
+ * in which case its GPU texture only contains the levels which are currently
+ * resident, and is replaced when they change. The width and height of the
+ * texture are always those of the largest level.
+ */
 class Texture2D : public TextureBase {
 public:
     CLASS();
@@ -107,14 +116,25 @@ public:
 
     RenderTexture *renderTexture();
 
+    void requestResolution(float size);
+
     /** @return             Width of the texture. */
-    uint32_t width() const { return m_gpu->width(); }
+    uint32_t width() const { return m_width; }
     /** @return             Height of the texture. */
-    uint32_t height() const { return m_gpu->height(); }
+    uint32_t height() const { return m_height; }
+    /** @return             Whether the texture's mip levels are streamed. */
+    bool isStreamed() const { return m_stream != nullptr; }
 protected:
     ~Texture2D();
 private:
+    explicit Texture2D(TextureStream *stream);
+private:
+    uint32_t m_width;                   /**< Width of the texture. */
+    uint32_t m_height;                  /**< Height of the texture. */
     RenderTexture *m_renderTexture;     /**< Render target for the texture. */
+    TextureStream *m_stream;            /**< Streaming state, null if not streamed. */
+
+    friend class TextureStreamingManager;
 };
 
 /** Type of a 2D texture pointer. */
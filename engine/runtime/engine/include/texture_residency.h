@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Texture mip residency calculation.
+ */
+
+#pragma once
+
+#include "core/core.h"
+
+#include <vector>
+
+/**
+ * Mip residency state of a streamed texture.
+ *
+ * Streamed textures have a range of mip levels, from the smallest up to some
+ * level, resident in GPU memory. This holds the information needed to decide
+ * which levels should be resident, and is independent of the GPU so that the
+ * decision logic can be used (and tested) on its own. Mip levels are numbered
+ * from 0 for the largest.
+ */
+struct TextureResidency {
+    /** Size of each mip level in bytes. */
+    std::vector<uint64_t> mipSizes;
+
+    /** First of the levels which are always kept resident. */
+    unsigned baseMip;
+
+    /** Largest level which is currently resident. */
+    unsigned residentMip;
+
+    /**
+     * Largest level which was last requested.
+     *
+     * This holds the request made in the last frame in which the texture was
+     * used, so that it is still known after the texture goes out of view.
+     */
+    unsigned requestedMip;
+
+    /** Frame in which the texture was last requested. */
+    uint64_t requestFrame;
+
+    /** Largest level which should be resident, set by calculation. */
+    unsigned targetMip;
+public:
+    TextureResidency(std::vector<uint64_t> inMipSizes, unsigned inBaseMip);
+
+    /** @return             Number of mip levels. */
+    unsigned numMips() const { return mipSizes.size(); }
+
+    void request(unsigned mip, uint64_t frame);
+    uint64_t size(unsigned mip) const;
+};
+
+/** Statistics from a residency calculation. */
+struct TextureResidencyStats {
+    uint64_t requestedSize;             /**< Memory needed for all requested levels. */
+    uint64_t targetSize;                /**< Memory needed for the target levels. */
+    unsigned numLimited;                /**< Textures with fewer levels than requested. */
+public:
+    TextureResidencyStats() :
+        requestedSize (0),
+        targetSize    (0),
+        numLimited    (0)
+    {}
+};
+
+extern void calculateTextureResidency(const std::vector<TextureResidency *> &textures,
+                                      uint64_t budget,
+                                      TextureResidencyStats &outStats);
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Texture streaming manager.
+ */
+
+#pragma once
+
+#include "core/pixel_format.h"
+
+#include "engine/texture_residency.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class Texture2D;
+
+/** Streaming state of a texture. */
+struct TextureStream {
+    /** Texture being streamed, null if destroyed while loading. */
+    Texture2D *texture;
+
+    std::string path;                   /**< Path to the texture asset. */
+    uint64_t dataOffset;                /**< Offset of the largest level in the asset data. */
+    uint32_t width;                     /**< Width of the largest level. */
+    uint32_t height;                    /**< Height of the largest level. */
+    PixelFormat format;                 /**< Format of the texture. */
+
+    TextureResidency residency;         /**< Mip residency state. */
+
+    /** Details of an in-progress change of resident levels. */
+    bool loading;                       /**< Whether a load is in progress. */
+    bool loadSucceeded;                 /**< Whether the data was read successfully. */
+    unsigned loadMip;                   /**< New largest resident level. */
+    unsigned loadEndMip;                /**< First level not being read (already resident). */
+    std::unique_ptr<uint8_t []> loadData;
+
+    TextureStream(std::vector<uint64_t> mipSizes, unsigned baseMip);
+};
+
+/**
+ * Texture streaming manager.
+ *
+ * This class manages the residency of the mip levels of textures whose data
+ * can be read again after loading (currently, DDS textures with pre-built mip
+ * levels). Such textures are loaded with only their smallest levels, and the
+ * renderer records the resolution at which each visible texture is needed
+ * while culling. Once per frame, the manager decides which levels of each
+ * texture should be resident within a memory budget, and reads the levels
+ * needed in the background. When the data is ready, the texture's GPU texture
+ * is replaced with one containing the new set of levels. Levels which remain
+ * resident are copied on the GPU rather than being read again, so evicting
+ * levels does not need any data to be read.
+ */
+class TextureStreamingManager : Noncopyable {
+public:
+    explicit TextureStreamingManager(uint64_t budget);
+    ~TextureStreamingManager();
+
+    /** @return             Memory budget for streamed textures in bytes. */
+    uint64_t budget() const { return m_budget; }
+
+    /** Set the memory budget for streamed textures.
+     * @param budget        New budget in bytes. */
+    void setBudget(uint64_t budget) { m_budget = budget; }
+
+    static unsigned calculateBaseMip(uint32_t width, uint32_t height, unsigned mips);
+
+    Texture2D *createTexture(const std::string &path,
+                             uint64_t dataOffset,
+                             uint32_t width,
+                             uint32_t height,
+                             PixelFormat format,
+                             unsigned mips,
+                             const void *data);
+    void removeTexture(Texture2D *texture);
+
+    void requestResolution(TextureStream *stream, float size);
+
+    void update();
+private:
+    void setResidentMip(TextureStream *stream, unsigned mip, const void *data);
+    void queueLoad(TextureStream *stream, unsigned mip);
+    void completeLoad(TextureStream *stream);
+    void workerThread();
+
+    void explore();
+private:
+    uint64_t m_budget;                      /**< Memory budget in bytes. */
+    uint64_t m_frame;                       /**< Current frame number. */
+
+    std::vector<TextureStream *> m_streams; /**< Textures being streamed. */
+
+    /** Statistics from the last update. */
+    TextureResidencyStats m_stats;
+    uint64_t m_residentSize;                /**< Memory used by resident levels. */
+    unsigned m_numLoading;                  /**< Number of loads in progress. */
+
+    std::thread m_worker;                   /**< Thread for reading texture data. */
+    std::mutex m_queueLock;                 /**< Lock for the queues. */
+    std::condition_variable m_workCond;     /**< Signalled when work is queued. */
+    bool m_exiting;                         /**< Whether the worker should exit. */
+
+    /** Loads waiting for the worker thread. */
+    std::deque<TextureStream *> m_workQueue;
+
+    /** Loads which have been read, to be completed on the main thread. */
+    std::deque<TextureStream *> m_completeQueue;
+
+    friend class TextureStreamingWindow;
+};
+
+extern TextureStreamingManager *g_textureStreamingManager;
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Asset index.
+ *
+ * The serialised form of the index is a JSON object mapping asset paths to an
+ * object giving the files for the asset, for example:
+ *
+ *   {
+ *       "textures/wall": { "data": "textures/wall.tga", "loader": "textures/wall.loader" },
+ *       "worlds/main": { "data": "worlds/main.object" }
+ *   }
+ */
+
+#include "core/filesystem.h"
+
+#include "engine/asset_index.h"
+
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+/** Special file extension for loaders. */
+static const char *const kLoaderFileExtension = "loader";
+
+const char *const AssetIndex::kIndexFileName = "asset_index.json";
+
+/** Initialise the index.
+ * @param root          Root directory of the index. */
+AssetIndex::AssetIndex(const Path &root) :
+    m_root  (root),
+    m_built (false)
+{}
+
+/** Destroy the index. */
+AssetIndex::~AssetIndex() {}
+
+/**
+ * Look up an asset in the index.
+ *
+ * Looks up an asset in the index. If the index has not yet been built, it will
+ * be built first. If the asset is not found, the directory that it should be
+ * in is rescanned in case it has been added since the index was built.
+ *
+ * @param path          Path to the asset relative to the root.
+ * @param outEntry      Where to store entry for the asset.
+ *
+ * @return              Whether the asset was found.
+ */
+bool AssetIndex::lookup(const Path &path, Entry &outEntry) {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (!m_built)
+        build();
+
+    auto ret = m_entries.find(path.str());
+    if (ret == m_entries.end()) {
+        rescanDirectory(path.directoryName());
+
+        ret = m_entries.find(path.str());
+        if (ret == m_entries.end())
+            return false;
+    }
+
+    outEntry = ret->second;
+    return true;
+}
+
+/** Rescan a directory to update its entries in the index.
+ * @param directory     Directory to rescan (relative to the root). */
+void AssetIndex::refresh(const Path &directory) {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (!m_built) {
+        build();
+    } else {
+        rescanDirectory(directory);
+    }
+}
+
+/** Load a serialised index, replacing the current contents.
+ * @param stream        Stream to load from.
+ * @return              Whether the index was loaded successfully. */
+bool AssetIndex::load(DataStream *stream) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return deserialise(stream);
+}
+
+/** Deserialise the index. Lock must be held.
+ * @param stream        Stream to load from.
+ * @return              Whether the index was loaded successfully. */
+bool AssetIndex::deserialise(DataStream *stream) {
+    std::vector<char> data(stream->size());
+    if (!stream->read(&data[0], data.size(), 0)) {
+        logError("Failed to read asset index");
+        return false;
+    }
+
+    rapidjson::Document document;
+    document.Parse(&data[0], data.size());
+    if (document.HasParseError()) {
+        const char *msg = rapidjson::GetParseError_En(document.GetParseError());
+        logError("Parse error in asset index (at %zu): %s", document.GetErrorOffset(), msg);
+        return false;
+    } else if (!document.IsObject()) {
+        logError("Asset index is not an object");
+        return false;
+    }
+
+    m_entries.clear();
+    m_directories.clear();
+
+    for (auto it = document.MemberBegin(); it != document.MemberEnd(); ++it) {
+        const rapidjson::Value &value = it->value;
+
+        if (!value.IsObject() ||
+            (value.HasMember("data") && !value["data"].IsString()) ||
+            (value.HasMember("loader") && !value["loader"].IsString()))
+        {
+            logError("Asset index entry '%s' is invalid", it->name.GetString());
+            m_entries.clear();
+            m_directories.clear();
+            return false;
+        }
+
+        Entry &entry = addEntry(it->name.GetString());
+
+        if (value.HasMember("data"))
+            entry.data = value["data"].GetString();
+        if (value.HasMember("loader"))
+            entry.loader = value["loader"].GetString();
+    }
+
+    m_built = true;
+    return true;
+}
+
+/** Save the index.
+ * @param stream        Stream to write to.
+ * @return              Whether the index was written successfully. */
+bool AssetIndex::save(DataStream *stream) {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (!m_built)
+        build();
+
+    rapidjson::Document document;
+    document.SetObject();
+
+    for (const auto &it : m_entries) {
+        rapidjson::Value value(rapidjson::kObjectType);
+
+        if (!it.second.data.empty())
+            value.AddMember("data", rapidjson::StringRef(it.second.data.c_str()), document.GetAllocator());
+        if (!it.second.loader.empty())
+            value.AddMember("loader", rapidjson::StringRef(it.second.loader.c_str()), document.GetAllocator());
+
+        document.AddMember(rapidjson::StringRef(it.first.c_str()), value, document.GetAllocator());
+    }
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    document.Accept(writer);
+
+    return stream->write(buffer.GetString(), buffer.GetSize());
+}
+
+/** Build the index. Lock must be held. */
+void AssetIndex::build() {
+    m_built = true;
+
+    /* Use a prebuilt index if one exists. */
+    Path indexPath = m_root / kIndexFileName;
+    if (Filesystem::exists(indexPath)) {
+        std::unique_ptr<File> file(Filesystem::openFile(indexPath));
+        if (file) {
+            if (deserialise(file.get())) {
+                logDebug("Loaded asset index '%s' (%zu assets)", indexPath.c_str(), m_entries.size());
+                return;
+            }
+        }
+
+        logWarning("Failed to load asset index '%s', rebuilding", indexPath.c_str());
+    }
+
+    m_entries.clear();
+    m_directories.clear();
+    scanDirectory(Path("."), true);
+
+    logDebug("Built asset index for '%s' (%zu assets)", m_root.c_str(), m_entries.size());
+}
+
+/** Replace the entries for a directory with its current contents. Lock must
+ *  be held.
+ * @param directory     Directory to rescan (relative to the root). */
+void AssetIndex::rescanDirectory(const Path &directory) {
+    /* Remove all existing entries in the directory first, so that we pick up
+     * files being removed as well as added. */
+    auto ret = m_directories.find(directory.str());
+    if (ret != m_directories.end()) {
+        for (const std::string &path : ret->second)
+            m_entries.erase(path);
+
+        m_directories.erase(ret);
+    }
+
+    scanDirectory(directory, false);
+}
+
+/** Get the entry for an asset, adding it if it does not exist. Lock must be
+ *  held.
+ * @param path          Path to the asset relative to the root.
+ * @return              Entry for the asset. */
+AssetIndex::Entry &AssetIndex::addEntry(const std::string &path) {
+    auto ret = m_entries.emplace(path, Entry());
+    if (ret.second)
+        m_directories[Path(path).directoryName().str()].push_back(path);
+
+    return ret.first->second;
+}
+
+/** Scan a directory and add its contents to the index. Lock must be held.
+ * @param directory     Directory to scan (relative to the root).
+ * @param recursive     Whether to scan subdirectories. */
+void AssetIndex::scanDirectory(const Path &directory, bool recursive) {
+    std::unique_ptr<Directory> handle(Filesystem::openDirectory(m_root / directory));
+    if (!handle)
+        return;
+
+    Directory::Entry entry;
+    while (handle->next(entry)) {
+        Path path = directory / entry.name;
+
+        if (entry.type == FileType::kDirectory) {
+            if (recursive)
+                scanDirectory(path, true);
+
+            continue;
+        } else if (entry.type != FileType::kFile) {
+            continue;
+        }
+
+        std::string extension = entry.name.extension();
+        if (extension.empty() || (directory.isRoot() && entry.name.str() == kIndexFileName))
+            continue;
+
+        std::string assetPath = (directory / entry.name.baseFileName()).str();
+
+        Entry &indexEntry = addEntry(assetPath);
+
+        if (extension == kLoaderFileExtension) {
+            indexEntry.loader = path.str();
+        } else {
+            if (!indexEntry.data.empty())
+                indexEntry.multipleData = true;
+
+            indexEntry.data = path.str();
+        }
+    }
+}
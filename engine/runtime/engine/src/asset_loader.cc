@@ -26,8 +26,33 @@
  * @param path          Asset path being loaded.
  * @return              Pointer to loaded asset, null on failure. */
 AssetPtr AssetLoader::load(DataStream *data, const char *path) {
+    if (!prepare(data, path))
+        return nullptr;
+
+    return finish();
+}
+
+/**
+ * Prepare the asset data.
+ *
+ * Performs the first stage of loading the asset, which may be done on a
+ * thread other than the main thread. The data stream and path must remain
+ * valid until finish() has been called.
+ *
+ * @param data          Asset data stream.
+ * @param path          Asset path being loaded.
+ *
+ * @return              Whether the data was prepared successfully.
+ */
+bool AssetLoader::prepare(DataStream *data, const char *path) {
     m_data = data;
     m_path = path;
+    return prepare();
+}
+
+/** Finish loading the asset after a successful call to prepare().
+ * @return              Pointer to loaded asset, null on failure. */
+AssetPtr AssetLoader::finish() {
     return load();
 }
 
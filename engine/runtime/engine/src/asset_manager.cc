@@ -36,13 +36,27 @@
 
 #include "engine/asset_loader.h"
 #include "engine/asset_manager.h"
+#include "engine/binary_format.h"
+#include "engine/binary_serialiser.h"
 #include "engine/debug_manager.h"
 #include "engine/debug_window.h"
 #include "engine/json_serialiser.h"
 
-/** Special file extensions. */
+/** Special file extension for serialised objects. */
 static const char *const kObjectFileExtension = "object";
-static const char *const kLoaderFileExtension = "loader";
+
+/** Create a serialiser for some serialised data.
+ * @param data          Serialised data.
+ * @param size          Size of the data.
+ * @return              Serialiser for the data's format. Cooked data is in the
+ *                      binary format, source data is JSON. */
+static std::unique_ptr<Serialiser> createSerialiser(const void *data, size_t size) {
+    if (isBinarySerialised(data, size)) {
+        return std::make_unique<BinarySerialiser>();
+    } else {
+        return std::make_unique<JSONSerialiser>();
+    }
+}
 
 /** Global asset manager instance. */
 AssetManager *g_assetManager;
@@ -62,19 +76,92 @@ public:
     }
 };
 
+/**
+ * Asynchronous asset load request.
+ */
+
+/** Initialise the request.
+ * @param path          Path to the asset. */
+AssetLoadRequest::AssetLoadRequest(const Path &path) :
+    m_path           (path.str()),
+    m_stage          (kOpenStage),
+    m_succeeded      (false),
+    m_hasLoader      (false),
+    m_serialisedData (nullptr),
+    m_serialisedSize (0)
+{}
+
+/** Destroy the request. */
+AssetLoadRequest::~AssetLoadRequest() {}
+
+/**
+ * Wait for the load to complete.
+ *
+ * Blocks until the load has completed. While waiting, other asynchronous loads
+ * which are ready to progress on the main thread will be handled. Must only be
+ * called on the main thread.
+ *
+ * @return              Loaded asset, or null if the load failed.
+ */
+AssetPtr AssetLoadRequest::wait() {
+    while (m_stage != kComplete)
+        g_assetManager->waitForCompletion();
+
+    return m_asset;
+}
+
+/**
+ * Asset manager.
+ */
+
 /** Initialize the asset manager. */
-AssetManager::AssetManager() {
+AssetManager::AssetManager() :
+    m_exiting (false)
+{
     /* Register asset search paths. */
-    m_searchPaths.insert(std::make_pair("engine", "engine/assets"));
+    m_searchPaths.insert(std::make_pair("engine", std::make_unique<AssetIndex>("engine/assets")));
     std::string gamePath = String::format("apps/%s/assets", Platform::getProgramName().c_str());
     logDebug("Game asset path is '%s'", gamePath.c_str());
-    m_searchPaths.insert(std::make_pair("game", gamePath));
+    m_searchPaths.insert(std::make_pair("game", std::make_unique<AssetIndex>(gamePath)));
+
+    /* Mount asset packages if they have been built. A package is placed
+     * alongside the directory it was built from, and contains paths relative
+     * to the base directory, so it transparently replaces the loose files. This
+     * must be done before any asset loading is started. */
+    for (const auto &searchPath : m_searchPaths) {
+        Path packagePath(searchPath.second->root().str() + ".pkg");
+        if (Filesystem::isType(packagePath, FileType::kFile)) {
+            if (Filesystem::mountPackage(packagePath)) {
+                logInfo("Mounted asset package '%s'", packagePath.c_str());
+            } else {
+                logError("Failed to mount asset package '%s'", packagePath.c_str());
+            }
+        }
+    }
+
+    /* Start worker threads for asynchronous loading, leaving a core free for
+     * the main thread. */
+    unsigned numWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    for (unsigned i = 0; i < numWorkers; i++)
+        m_workers.emplace_back(&AssetManager::workerThread, this);
+
+    logDebug("Started %u asset loader threads", numWorkers);
 
     g_debugManager->registerWindow(std::make_unique<AssetExplorerWindow>());
 }
 
 /** Destroy the asset manager. */
 AssetManager::~AssetManager() {
+    {
+        std::lock_guard<std::mutex> lock(m_queueLock);
+        m_exiting = true;
+    }
+
+    m_workCond.notify_all();
+
+    for (std::thread &worker : m_workers)
+        worker.join();
+
     // TODO: Destroy assets.
 }
 
@@ -85,6 +172,10 @@ AssetManager::~AssetManager() {
  * manager maintains its own namespace which maps into locations within the
  * filesystem. Asset paths must be relative.
  *
+ * The asset is loaded synchronously on the calling thread, unless it is
+ * already being loaded asynchronously, in which case this waits for that load
+ * to complete.
+ *
  * @param path          Path to the asset to load.
  *
  * @return              Pointer to loaded asset, or null if asset not found.
@@ -95,96 +186,231 @@ AssetPtr AssetManager::load(const Path &path) {
     if (exist)
         return exist;
 
-    /* Turn the asset path into a filesystem path. */
-    auto searchPath = m_searchPaths.find(path.subset(0, 1).str());
-    if (searchPath == m_searchPaths.end()) {
-        logError("Could not find asset '%s'", path.c_str());
-        return nullptr;
+    AssetLoadRequestPtr request;
+
+    auto pending = m_pendingLoads.find(path.str());
+    if (pending != m_pendingLoads.end()) {
+        request = pending->second;
+        return request->wait();
     }
 
-    Path fsPath = Path(searchPath->second) / path.subset(1);
-    Path directoryPath = fsPath.directoryName();
-    std::string assetName = fsPath.baseFileName();
+    request = new AssetLoadRequest(path);
+    m_pendingLoads.insert(std::make_pair(path.str(), request));
 
-    /* Open the directory. */
-    std::unique_ptr<Directory> directory(Filesystem::openDirectory(directoryPath));
-    if (!directory) {
-        logError("Could not find asset '%s'", path.c_str());
-        return nullptr;
+    bool succeeded =
+        openAsset(request) &&
+        createLoader(request) &&
+        prepareAsset(request) &&
+        finishAsset(request);
+
+    completeRequest(request, succeeded);
+    return request->m_asset;
+}
+
+/**
+ * Load an asset asynchronously.
+ *
+ * Begins loading an asset in the background. File I/O and any CPU-side
+ * processing of the asset data by its loader are performed on worker threads,
+ * while creation of the asset itself (including any GPU resources it needs)
+ * happens on the main thread in update(). The returned request can be polled
+ * for completion or waited on.
+ *
+ * If the asset is already loaded, the returned request will already be
+ * complete. If the asset is already being loaded, the existing request for it
+ * is returned.
+ *
+ * @param path          Path to the asset to load.
+ *
+ * @return              Request for the asset load.
+ */
+AssetLoadRequestPtr AssetManager::loadAsync(const Path &path) {
+    auto pending = m_pendingLoads.find(path.str());
+    if (pending != m_pendingLoads.end())
+        return pending->second;
+
+    AssetLoadRequestPtr request(new AssetLoadRequest(path));
+
+    Asset *exist = lookupAsset(path);
+    if (exist) {
+        request->m_asset = exist;
+        request->m_stage = AssetLoadRequest::kComplete;
+        return request;
     }
 
-    /* Iterate over entries to try to find the asset data and a corresponding
-     * loader. */
-    std::unique_ptr<DataStream> data;
-    std::unique_ptr<DataStream> loaderData;
-    std::string type;
-    Directory::Entry entry;
-    while (directory->next(entry)) {
-        if (entry.type != FileType::kFile)
-            continue;
-
-        if (entry.name.baseFileName() == assetName) {
-            std::string entryExt = entry.name.extension();
-            Path filePath = directoryPath / entry.name;
-
-            if (entryExt == kLoaderFileExtension) {
-                loaderData.reset(Filesystem::openFile(filePath));
-                if (!loaderData) {
-                    logError("Failed to open '%s'", filePath.c_str());
-                    return nullptr;
-                }
-            } else if (entryExt.length()) {
-                if (data) {
-                    logError("Asset '%s' has multiple data streams", path.c_str());
-                    return nullptr;
-                }
-
-                data.reset(Filesystem::openFile(filePath));
-                if (!data) {
-                    logError("Failed to open '%s'", filePath.c_str());
-                    return nullptr;
-                }
-
-                type = entryExt;
-            }
+    m_pendingLoads.insert(std::make_pair(path.str(), request));
+    queueWork(request);
+    return request;
+}
+
+/**
+ * Handle asynchronous loads.
+ *
+ * Progresses any asynchronous loads which have completed a stage on a worker
+ * thread and now need work to be done on the main thread. This is called by
+ * the engine once per frame.
+ */
+void AssetManager::update() {
+    while (true) {
+        AssetLoadRequestPtr request;
+
+        {
+            std::lock_guard<std::mutex> lock(m_queueLock);
+
+            if (m_completeQueue.empty())
+                return;
+
+            request = m_completeQueue.front();
+            m_completeQueue.pop_front();
         }
+
+        advanceRequest(request);
     }
+}
 
-    /* Succeeded if we have either stream. */
-    if (!data && !loaderData) {
-        logError("Could not find asset '%s'", path.c_str());
-        return nullptr;
+/**
+ * Locate and read an asset's files.
+ *
+ * Finds the data and loader files for an asset using the asset index, and
+ * opens them. Serialised data (objects and loaders) is read into memory. This
+ * is safe to call from worker threads.
+ *
+ * @param request       Request for the asset.
+ *
+ * @return              Whether the asset was found.
+ */
+bool AssetManager::openAsset(AssetLoadRequest *request) const {
+    const char *pathString = request->m_path.c_str();
+
+    AssetIndex::Entry entry;
+    AssetIndex *index = lookupIndex(request->m_path, entry);
+    if (!index) {
+        logError("Could not find asset '%s'", pathString);
+        return false;
+    } else if (entry.multipleData) {
+        logError("Asset '%s' has multiple data streams", pathString);
+        return false;
+    }
+
+    std::unique_ptr<DataStream> loaderData;
+    if (!entry.loader.empty()) {
+        Path filePath = index->root() / entry.loader;
+        loaderData.reset(Filesystem::openFile(filePath));
+        if (!loaderData) {
+            logError("Failed to open '%s'", filePath.c_str());
+            return false;
+        }
     }
 
-    AssetPtr asset;
+    if (!entry.data.empty()) {
+        Path filePath = index->root() / entry.data;
+        request->m_data.reset(Filesystem::openFile(filePath));
+        if (!request->m_data) {
+            logError("Failed to open '%s'", filePath.c_str());
+            return false;
+        }
 
-    /* Helper function used on both paths below to mark the asset as managed
-     * and cache it. */
-    auto addAsset =
-        [&] (Object *object) {
-            Asset *asset = static_cast<Asset *>(object);
-            asset->m_path = path.str();
-            m_assets.insert(std::make_pair(path.str(), asset));
-        };
+        request->m_type = filePath.extension();
+    }
 
-    if (type == kObjectFileExtension) {
-        type.clear();
+    /* Succeeded if we have either stream. */
+    if (!request->m_data && !loaderData) {
+        logError("Could not find asset '%s'", pathString);
+        return false;
+    }
 
-        /* This is a serialised object. */
+    /* Get serialised data now so that the main thread does not need to do any
+     * I/O. Binary data is not modified by deserialisation, so where possible we
+     * use the stream's mapped data directly rather than copying it, in which
+     * case the stream must be kept open until it has been deserialised. JSON is
+     * parsed in-situ, so that is read into a null-terminated buffer which the
+     * serialiser is allowed to modify, copying only if the stream is mapped. */
+    DataStream *serialisedStream = nullptr;
+    if (request->m_type == kObjectFileExtension) {
         if (loaderData) {
-            logError("%s: Serialised object cannot have a loader", path.c_str());
-            return nullptr;
+            logError("%s: Serialised object cannot have a loader", pathString);
+            return false;
         }
 
-        assert(data);
+        serialisedStream = request->m_data.get();
+    } else if (loaderData) {
+        request->m_loaderData = std::move(loaderData);
+        serialisedStream = request->m_loaderData.get();
+        request->m_hasLoader = true;
+    }
+
+    if (serialisedStream) {
+        size_t size = serialisedStream->size();
+        const void *mapped = serialisedStream->data();
+
+        request->m_serialisedSize = size;
 
-        std::vector<uint8_t> serialisedData(data->size());
-        if (!data->read(&serialisedData[0], data->size())) {
-            logError("%s: Failed to read asset data", path.c_str());
-            return nullptr;
+        if (mapped && isBinarySerialised(mapped, size)) {
+            request->m_serialisedData = mapped;
+        } else {
+            request->m_serialisedBuffer.resize(size + 1);
+
+            if (mapped) {
+                memcpy(request->m_serialisedBuffer.data(), mapped, size);
+            } else if (!serialisedStream->read(request->m_serialisedBuffer.data(), size)) {
+                logError("%s: Failed to read %s data", pathString, (request->m_hasLoader) ? "loader" : "asset");
+                return false;
+            }
+
+            request->m_serialisedBuffer[size] = 0;
+            request->m_serialisedData = request->m_serialisedBuffer.data();
         }
+    }
+
+    return true;
+}
+
+/**
+ * Open an asset's data stream.
+ *
+ * Opens the data file of an asset, for loaders which need to read parts of the
+ * data again after the asset has been loaded (e.g. to stream in texture mip
+ * levels). This is safe to call from any thread.
+ *
+ * @param path          Path to the asset.
+ *
+ * @return              Opened data stream, or null on failure.
+ */
+DataStream *AssetManager::openData(const Path &path) const {
+    AssetIndex::Entry entry;
+    AssetIndex *index = lookupIndex(path, entry);
+    if (!index || entry.data.empty() || entry.multipleData) {
+        logError("Could not find data for asset '%s'", path.c_str());
+        return nullptr;
+    }
+
+    Path filePath = index->root() / entry.data;
+    DataStream *data = Filesystem::openFile(filePath);
+    if (!data)
+        logError("Failed to open '%s'", filePath.c_str());
+
+    return data;
+}
+
+/**
+ * Create the loader for an asset.
+ *
+ * Creates the loader for an asset which has been opened by openAsset(). For
+ * serialised objects, there is no loader and the object is deserialised
+ * immediately. Since deserialisation may load other assets, this must be
+ * called on the main thread.
+ *
+ * @param request       Request for the asset.
+ *
+ * @return              Whether successful.
+ */
+bool AssetManager::createLoader(AssetLoadRequest *request) {
+    const char *pathString = request->m_path.c_str();
 
-        JSONSerialiser serialiser;
+    if (request->m_type == kObjectFileExtension) {
+        /* This is a serialised object. */
+        std::unique_ptr<Serialiser> serialiser =
+            createSerialiser(request->m_serialisedData, request->m_serialisedSize);
 
         /* We make the asset managed prior to calling its deserialise() method.
          * This is done for 2 reasons. Firstly, it makes the path available to
@@ -192,70 +418,248 @@ AssetPtr AssetManager::load(const Path &path) {
          * back to the asset by itself or child objects will correctly be
          * resolved to it, rather than causing a recursive attempt to load the
          * asset. */
-        serialiser.postConstructFunction = addAsset;
-
-        asset = serialiser.deserialise<Asset>(serialisedData);
-        if (!asset) {
-            logError("%s: Error during object deserialisation", path.c_str());
-            return nullptr;
+        serialiser->postConstructFunction =
+            [&] (Object *object) {
+                addAsset(static_cast<Asset *>(object), request->m_path);
+            };
+
+        request->m_asset = (request->m_serialisedBuffer.empty())
+            ? serialiser->deserialise<Asset>(request->m_serialisedData, request->m_serialisedSize)
+            : serialiser->deserialiseInSitu<Asset>(request->m_serialisedBuffer.data(), request->m_serialisedSize);
+        if (!request->m_asset) {
+            logError("%s: Error during object deserialisation", pathString);
+            return false;
         }
-    } else {
-        /* Get a loader for the asset. Use a serialised one if it exists, else
-         * get a default one based on the file type. */
-        ObjectPtr<AssetLoader> loader;
-        if (loaderData) {
-            std::vector<uint8_t> serialisedData(loaderData->size());
-            if (!loaderData->read(&serialisedData[0], loaderData->size())) {
-                logError("%s: Failed to read loader data", path.c_str());
-                return nullptr;
-            }
 
-            JSONSerialiser serialiser;
-            loader = serialiser.deserialise<AssetLoader>(serialisedData);
-            if (!loader) {
-                logError("%s: Error during loader deserialisation", path.c_str());
-                return nullptr;
-            }
+        return true;
+    }
 
-            if (data) {
-                if (!loader->requireData()) {
-                    logError("%s: Asset '%s' has data but loader does not need it", path.c_str());
-                    return nullptr;
-                } else if (type != loader->extension()) {
-                    logError("%s: Asset '%s' has loader but is for a different file type", path.c_str());
-                    return nullptr;
-                }
-            } else {
-                if (loader->requireData()) {
-                    logError("%s: Asset '%s' has loader but missing data", path.c_str());
-                    return nullptr;
-                }
+    /* Get a loader for the asset. Use a serialised one if it exists, else get
+     * a default one based on the file type. */
+    if (request->m_hasLoader) {
+        std::unique_ptr<Serialiser> serialiser =
+            createSerialiser(request->m_serialisedData, request->m_serialisedSize);
+        request->m_loader = (request->m_serialisedBuffer.empty())
+            ? serialiser->deserialise<AssetLoader>(request->m_serialisedData, request->m_serialisedSize)
+            : serialiser->deserialiseInSitu<AssetLoader>(request->m_serialisedBuffer.data(), request->m_serialisedSize);
+
+        /* Loader data is no longer needed. */
+        request->m_serialisedData = nullptr;
+        request->m_serialisedBuffer.clear();
+        request->m_serialisedBuffer.shrink_to_fit();
+        request->m_loaderData.reset();
+        if (!request->m_loader) {
+            logError("%s: Error during loader deserialisation", pathString);
+            return false;
+        }
+
+        if (request->m_data) {
+            if (!request->m_loader->requireData()) {
+                logError("%s: Asset has data but loader does not need it", pathString);
+                return false;
+            } else if (request->m_type != request->m_loader->extension()) {
+                logError("%s: Asset has loader but is for a different file type", pathString);
+                return false;
             }
         } else {
-            assert(data);
+            if (request->m_loader->requireData()) {
+                logError("%s: Asset has loader but missing data", pathString);
+                return false;
+            }
+        }
+    } else {
+        assert(request->m_data);
+
+        request->m_loader = AssetLoader::create(request->m_type);
+        if (!request->m_loader) {
+            logError("%s: Unknown file type '%s'", pathString, request->m_type.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Prepare an asset's data.
+ *
+ * Calls the loader to perform CPU-side preparation of the asset data. This is
+ * safe to call from worker threads.
+ *
+ * @param request       Request for the asset.
+ *
+ * @return              Whether successful.
+ */
+bool AssetManager::prepareAsset(AssetLoadRequest *request) const {
+    if (!request->m_loader)
+        return true;
+
+    /* The loader should log an error if it fails. */
+    return request->m_loader->prepare(request->m_data.get(), request->m_path.c_str());
+}
+
+/**
+ * Finish loading an asset.
+ *
+ * Calls the loader to create the asset from its prepared data, and adds the
+ * asset to the cache. Must be called on the main thread.
+ *
+ * @param request       Request for the asset.
+ *
+ * @return              Whether successful.
+ */
+bool AssetManager::finishAsset(AssetLoadRequest *request) {
+    if (!request->m_loader)
+        return true;
+
+    /* Create the asset. The loader should log an error if it fails. */
+    request->m_asset = request->m_loader->finish();
+    if (!request->m_asset)
+        return false;
+
+    addAsset(request->m_asset, request->m_path);
+    return true;
+}
 
-            loader = AssetLoader::create(type);
-            if (!loader) {
-                logError("%s: Unknown file type '%s'", path.c_str(), type.c_str());
-                return nullptr;
+/** Mark an asset as managed and add it to the cache.
+ * @param asset         Asset to add.
+ * @param path          Path to the asset. */
+void AssetManager::addAsset(Asset *asset, const std::string &path) {
+    asset->m_path = path;
+    m_assets.insert(std::make_pair(path, asset));
+}
+
+/**
+ * Mark a request as complete.
+ *
+ * Marks a request as complete, and releases the manager's reference to it. The
+ * caller must hold a reference to the request.
+ *
+ * @param request       Request to complete.
+ * @param succeeded     Whether the load succeeded.
+ */
+void AssetManager::completeRequest(AssetLoadRequest *request, bool succeeded) {
+    const char *pathString = request->m_path.c_str();
+
+    if (!succeeded) {
+        request->m_asset = nullptr;
+    } else if (request->m_type != kObjectFileExtension && !request->m_type.empty()) {
+        logDebug("Loaded asset '%s' from source file type '%s'", pathString, request->m_type.c_str());
+    } else {
+        logDebug("Loaded asset '%s'", pathString);
+    }
+
+    /* Free up data that is no longer needed. */
+    request->m_data.reset();
+    request->m_loaderData.reset();
+    request->m_serialisedData = nullptr;
+    request->m_serialisedBuffer.clear();
+    request->m_serialisedBuffer.shrink_to_fit();
+    request->m_loader = nullptr;
+
+    request->m_stage = AssetLoadRequest::kComplete;
+
+    m_pendingLoads.erase(request->m_path);
+}
+
+/**
+ * Advance an asynchronous request.
+ *
+ * Handles a request which has finished a stage on a worker thread, performing
+ * the main thread work for the next stage and then queuing it for further
+ * worker processing if required.
+ *
+ * @param request       Request to advance.
+ */
+void AssetManager::advanceRequest(AssetLoadRequest *request) {
+    bool succeeded = request->m_succeeded;
+
+    if (succeeded) {
+        if (request->m_stage == AssetLoadRequest::kOpenStage) {
+            succeeded = createLoader(request);
+
+            if (succeeded && request->m_loader) {
+                request->m_stage = AssetLoadRequest::kPrepareStage;
+                queueWork(request);
+                return;
             }
+        } else {
+            succeeded = finishAsset(request);
         }
+    }
+
+    completeRequest(request, succeeded);
+}
+
+/** Queue a request for processing by a worker thread.
+ * @param request       Request to queue. */
+void AssetManager::queueWork(AssetLoadRequest *request) {
+    {
+        std::lock_guard<std::mutex> lock(m_queueLock);
+        m_workQueue.push_back(request);
+    }
 
-        /* Create the asset. The loader should log an error if it fails. */
-        asset = loader->load(data.get(), path.c_str());
-        if (!asset)
-            return nullptr;
+    m_workCond.notify_one();
+}
 
-        addAsset(asset);
+/** Wait for a worker thread to complete a stage and then handle it. */
+void AssetManager::waitForCompletion() {
+    {
+        std::unique_lock<std::mutex> lock(m_queueLock);
+        m_completeCond.wait(lock, [this] () { return !m_completeQueue.empty(); });
     }
 
-    if (!type.empty()) {
-        logDebug("Loaded asset '%s' from source file type '%s'", path.c_str(), type.c_str());
-    } else {
-        logDebug("Loaded asset '%s'", path.c_str());
+    update();
+}
+
+/**
+ * Asset loader worker thread.
+ *
+ * Performs the worker stages of asynchronous load requests. Requests are kept
+ * alive by m_pendingLoads while they are being worked on, so it is safe to
+ * use raw pointers here.
+ */
+void AssetManager::workerThread() {
+    while (true) {
+        AssetLoadRequest *request;
+
+        {
+            std::unique_lock<std::mutex> lock(m_queueLock);
+            m_workCond.wait(lock, [this] () { return m_exiting || !m_workQueue.empty(); });
+
+            if (m_exiting)
+                return;
+
+            request = m_workQueue.front();
+            m_workQueue.pop_front();
+        }
+
+        bool succeeded = (request->m_stage == AssetLoadRequest::kOpenStage)
+            ? openAsset(request)
+            : prepareAsset(request);
+
+        {
+            std::lock_guard<std::mutex> lock(m_queueLock);
+            request->m_succeeded = succeeded;
+            m_completeQueue.push_back(request);
+        }
+
+        m_completeCond.notify_one();
     }
+}
+
+/** Look up an asset in the index of its search path.
+ * @param path          Path to the asset.
+ * @param entry         Where to store the index entry for the asset.
+ * @return              Index that the asset was found in, or null if not
+ *                      found. */
+AssetIndex *AssetManager::lookupIndex(const Path &path, AssetIndex::Entry &entry) const {
+    auto searchPath = m_searchPaths.find(path.subset(0, 1).str());
+    if (searchPath == m_searchPaths.end())
+        return nullptr;
 
-    return asset;
+    AssetIndex *index = searchPath->second.get();
+    return (index->lookup(path.subset(1), entry)) ? index : nullptr;
 }
 
 /** Look up an asset in the cache.
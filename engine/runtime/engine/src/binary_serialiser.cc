@@ -0,0 +1,1104 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               Binary serialisation class.
+ *
+ * TODO:
+ *  - The format is little-endian, we currently assume that the host is also
+ *    little-endian.
+ */
+
+#include "engine/asset_manager.h"
+#include "engine/binary_format.h"
+#include "engine/binary_serialiser.h"
+
+#include <deque>
+#include <limits>
+#include <list>
+
+/** Value for an empty slot in a deserialisation index. */
+static const uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+/** Maximum nesting depth followed when prefetching asset references. */
+static const unsigned kMaxPrefetchDepth = 64;
+
+/** Internal state used during (de)serialisation. */
+struct BinarySerialiser::State {
+    bool writing;                           /**< Whether we are currently writing or reading. */
+
+    /** Output data (serialising). */
+    std::vector<uint8_t> output;
+
+    /** String table and map of strings to indices (serialising). */
+    std::string strings;
+    HashMap<std::string, uint32_t> stringToIndexMap;
+
+    /** Object array, and objects which are yet to be written (serialising). */
+    std::vector<BinaryObject> objects;
+    std::deque<const Object *> pendingObjects;
+
+    /** Map of object addresses to pre-existing IDs (serialising). */
+    HashMap<const Object *, uint32_t> objectToIDMap;
+
+    /** Input data (deserialising). */
+    const uint8_t *input;
+    size_t inputSize;
+
+    /** String table and object array (deserialising). */
+    std::vector<const char *> inputStrings;
+
+    /**
+     * String index (deserialising).
+     *
+     * This is an open-addressed hash table of indices into the string table,
+     * keyed by the string. Empty slots are kInvalidIndex. Its size is a power
+     * of 2. It allows the name of a member being looked up to be resolved to
+     * a string index, so that member tables only need to compare indices.
+     */
+    std::vector<uint32_t> stringIndex;
+    uint32_t objectsOffset;
+    uint32_t numObjects;
+
+    /** Map of IDs to pre-existing objects (deserialising). */
+    HashMap<uint32_t, ObjectPtr<Object>> idToObjectMap;
+
+    /** Asynchronous loads of referenced assets (deserialising). */
+    std::vector<AssetLoadRequestPtr> assetLoads;
+
+    /** Structure representing a scope. */
+    struct Scope {
+        enum Type {
+            kObject,
+            kGroup,
+            kArray,
+        };
+
+        Type type;                          /**< Type of the scope. */
+
+        /**
+         * Offset of the scope.
+         *
+         * When serialising, this is the offset of the scope's value. When
+         * deserialising, this is the offset of its member/element table.
+         */
+        uint32_t offset;
+
+        uint32_t count;                     /**< Number of members/elements (deserialising). */
+        uint32_t nextIndex;                 /**< Next array index (deserialising). */
+
+        /** Members/elements written so far (serialising). */
+        std::vector<BinaryMember> members;
+
+        /**
+         * Member index (deserialising objects/groups).
+         *
+         * This is an open-addressed hash table of the members of the scope,
+         * keyed by name string index. Empty slots have a name of
+         * kInvalidIndex. Its size is a power of 2.
+         */
+        std::vector<BinaryMember> index;
+
+        Scope(Type inType, uint32_t inOffset, uint32_t inCount = 0) :
+            type      (inType),
+            offset    (inOffset),
+            count     (inCount),
+            nextIndex (0)
+        {}
+    };
+
+    /**
+     * Scope stack.
+     *
+     * This is used to keep track of which value we are currently reading from
+     * or writing to. read() and write() operate on the scope at the end of the
+     * list.
+     */
+    std::list<Scope> scopes;
+
+    /** Get the current scope and check its type.
+     * @param name          Name of the member to be accessed.
+     * @return              Reference to current scope. */
+    Scope &currentScope(const char *name) {
+        Scope &scope = this->scopes.back();
+
+        if (name) {
+            check(scope.type != Scope::kArray);
+        } else {
+            check(scope.type == Scope::kArray);
+        }
+
+        return scope;
+    }
+
+    /**
+     * Serialisation helpers.
+     */
+
+    /** Append data to the output.
+     * @param data          Data to append.
+     * @param size          Size of the data. */
+    void put(const void *data, size_t size) {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+        this->output.insert(this->output.end(), bytes, bytes + size);
+    }
+
+    /** Append a value to the output.
+     * @param value         Value to append. */
+    template <typename T>
+    void put(const T &value) {
+        put(&value, sizeof(value));
+    }
+
+    /** Overwrite a value previously written to the output.
+     * @param offset        Offset to write at.
+     * @param value         Value to write. */
+    template <typename T>
+    void patch(uint32_t offset, const T &value) {
+        memcpy(&this->output[offset], &value, sizeof(value));
+    }
+
+    /** Get the index of a string, adding it to the string table if needed.
+     * @param str           String to add.
+     * @return              Index of the string. */
+    uint32_t addString(const std::string &str) {
+        auto ret = this->stringToIndexMap.insert(std::make_pair(str, this->stringToIndexMap.size()));
+        if (ret.second)
+            this->strings.append(str.c_str(), str.size() + 1);
+
+        return ret.first->second;
+    }
+
+    /** Add a member to the current scope at the current output offset.
+     * @param name          Name of the member (null if array). */
+    void addMember(const char *name) {
+        Scope &scope = currentScope(name);
+
+        BinaryMember member;
+        member.name   = (name) ? addString(name) : 0;
+        member.offset = this->output.size();
+        scope.members.push_back(member);
+    }
+
+    /** Begin writing a value in the current scope.
+     * @param name          Name of the value (null if array).
+     * @param type          Type tag of the value. */
+    void beginValue(const char *name, BinaryValueType type) {
+        addMember(name);
+        put(type);
+    }
+
+    /** Write the header of a group or array and make it the current scope.
+     * @param type          Type of the scope. */
+    void putScope(Scope::Type type) {
+        uint32_t offset = this->output.size();
+
+        put((type == Scope::kArray) ? kBinaryArray : kBinaryGroup);
+        put(static_cast<uint32_t>(0));
+        put(static_cast<uint32_t>(0));
+
+        this->scopes.emplace_back(type, offset);
+    }
+
+    /**
+     * Deserialisation helpers.
+     */
+
+    /** Read data from the input.
+     * @param offset        Offset to read from.
+     * @param data          Where to store data read.
+     * @param size          Size of the data.
+     * @return              Whether the data is within the input. */
+    bool get(uint64_t offset, void *data, size_t size) const {
+        if (offset + size > this->inputSize)
+            return false;
+
+        memcpy(data, this->input + offset, size);
+        return true;
+    }
+
+    /** Read a value from the input.
+     * @param offset        Offset to read from.
+     * @param value         Where to store value read.
+     * @return              Whether the value is within the input. */
+    template <typename T>
+    bool get(uint64_t offset, T &value) const {
+        return get(offset, &value, sizeof(value));
+    }
+
+    /** Read a string by index.
+     * @param offset        Offset of the string index.
+     * @param str           Where to store pointer to string.
+     * @return              Whether the string index is valid. */
+    bool getString(uint64_t offset, const char *&str) const {
+        uint32_t index;
+        if (!get(offset, index) || index >= this->inputStrings.size())
+            return false;
+
+        str = this->inputStrings[index];
+        return true;
+    }
+
+    /** Build the string index. */
+    void buildStringIndex() {
+        size_t size = 4;
+        while (size < this->inputStrings.size() * 2)
+            size <<= 1;
+
+        this->stringIndex.assign(size, kInvalidIndex);
+
+        for (uint32_t i = 0; i < this->inputStrings.size(); i++) {
+            const char *str = this->inputStrings[i];
+            size_t slot = hashMem(str, std::strlen(str)) & (size - 1);
+
+            /* Duplicate strings are not written, but if there are any, the
+             * first is found. */
+            while (this->stringIndex[slot] != kInvalidIndex)
+                slot = (slot + 1) & (size - 1);
+
+            this->stringIndex[slot] = i;
+        }
+    }
+
+    /** Find the index of a string in the string table.
+     * @param str           String to find.
+     * @return              Index of the string, or kInvalidIndex if not found. */
+    uint32_t findString(const char *str) const {
+        size_t length = std::strlen(str);
+        size_t mask = this->stringIndex.size() - 1;
+        size_t slot = hashMem(str, length) & mask;
+
+        while (this->stringIndex[slot] != kInvalidIndex) {
+            uint32_t index = this->stringIndex[slot];
+            if (std::strcmp(this->inputStrings[index], str) == 0)
+                return index;
+
+            slot = (slot + 1) & mask;
+        }
+
+        return kInvalidIndex;
+    }
+
+    /** Push a new scope on to the scope stack (deserialising).
+     * @param type          Type of the scope.
+     * @param tableOffset   Offset of its member/element table.
+     * @param count         Number of members/elements. */
+    void pushScope(Scope::Type type, uint32_t tableOffset, uint32_t count) {
+        this->scopes.emplace_back(type, tableOffset, count);
+
+        if (type != Scope::kArray)
+            buildIndex(this->scopes.back());
+    }
+
+    /** Build the member index for a scope.
+     * @param scope         Scope to build for. */
+    void buildIndex(Scope &scope) {
+        size_t size = 4;
+        while (size < scope.count * 2)
+            size <<= 1;
+
+        BinaryMember empty;
+        empty.name   = kInvalidIndex;
+        empty.offset = 0;
+        scope.index.assign(size, empty);
+
+        for (uint32_t i = 0; i < scope.count; i++) {
+            BinaryMember member;
+            get(scope.offset + (i * sizeof(BinaryMember)), member);
+
+            if (member.name >= this->inputStrings.size())
+                continue;
+
+            size_t slot = hashValue(member.name) & (size - 1);
+
+            /* If names are duplicated, the first is found as with a linear
+             * search. */
+            while (scope.index[slot].name != kInvalidIndex)
+                slot = (slot + 1) & (size - 1);
+
+            scope.index[slot] = member;
+        }
+    }
+
+    /** Get a member from a scope.
+     * @param scope         Scope to get from.
+     * @param name          Name of the member to get (null if array).
+     * @param offset        Where to store offset of the member value.
+     * @return              Whether the member was found. */
+    bool getMember(Scope &scope, const char *name, uint32_t &offset) {
+        if (scope.type == Scope::kArray) {
+            if (scope.nextIndex >= scope.count)
+                return false;
+
+            return get(scope.offset + (scope.nextIndex++ * sizeof(uint32_t)), offset);
+        } else {
+            /* If the name is not in the string table, no member has it. */
+            uint32_t nameIndex = findString(name);
+            if (nameIndex == kInvalidIndex)
+                return false;
+
+            size_t mask = scope.index.size() - 1;
+            size_t slot = hashValue(nameIndex) & mask;
+
+            while (scope.index[slot].name != kInvalidIndex) {
+                if (scope.index[slot].name == nameIndex) {
+                    offset = scope.index[slot].offset;
+                    return true;
+                }
+
+                slot = (slot + 1) & mask;
+            }
+
+            return false;
+        }
+    }
+
+    /** Read the header of a group or array value.
+     * @param offset        Offset of the value.
+     * @param type          Type of the scope.
+     * @param count         Where to store number of members/elements.
+     * @param tableOffset   Where to store offset of the member/element table.
+     * @return              Whether the value is a valid group/array. */
+    bool getScope(uint32_t offset, Scope::Type type, uint32_t &count, uint32_t &tableOffset) const {
+        uint8_t tag;
+        if (!get(offset, tag) || tag != ((type == Scope::kArray) ? kBinaryArray : kBinaryGroup))
+            return false;
+
+        if (!get(offset + 1, count) || !get(offset + 5, tableOffset))
+            return false;
+
+        size_t entrySize = (type == Scope::kArray) ? sizeof(uint32_t) : sizeof(BinaryMember);
+        return static_cast<uint64_t>(tableOffset) + (static_cast<uint64_t>(count) * entrySize) <= this->inputSize;
+    }
+
+    /** Read an integer value, converting it to the requested type.
+     * @param offset        Offset of the value.
+     * @param value         Where to store value.
+     * @return              Whether the value is an integer representable in
+     *                      the requested type. */
+    template <typename T>
+    bool getInteger(uint32_t offset, T &value) const {
+        uint8_t tag;
+        if (!get(offset, tag))
+            return false;
+
+        switch (tag) {
+            case kBinaryInt32: {
+                int32_t raw;
+                return get(offset + 1, raw) && convertInteger(static_cast<int64_t>(raw), value);
+            }
+            case kBinaryUint32: {
+                uint32_t raw;
+                return get(offset + 1, raw) && convertInteger(static_cast<uint64_t>(raw), value);
+            }
+            case kBinaryInt64: {
+                int64_t raw;
+                return get(offset + 1, raw) && convertInteger(raw, value);
+            }
+            case kBinaryUint64: {
+                uint64_t raw;
+                return get(offset + 1, raw) && convertInteger(raw, value);
+            }
+            default:
+                return false;
+        }
+    }
+
+    /** Convert a signed integer value.
+     * @param raw           Raw value.
+     * @param value         Where to store converted value.
+     * @return              Whether the value is representable. */
+    template <typename T>
+    static bool convertInteger(int64_t raw, T &value) {
+        if (raw < 0) {
+            if (!std::is_signed<T>::value || raw < static_cast<int64_t>(std::numeric_limits<T>::min()))
+                return false;
+        } else if (static_cast<uint64_t>(raw) > static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+            return false;
+        }
+
+        value = static_cast<T>(raw);
+        return true;
+    }
+
+    /** Convert an unsigned integer value.
+     * @param raw           Raw value.
+     * @param value         Where to store converted value.
+     * @return              Whether the value is representable. */
+    template <typename T>
+    static bool convertInteger(uint64_t raw, T &value) {
+        if (raw > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+            return false;
+
+        value = static_cast<T>(raw);
+        return true;
+    }
+
+    /** Read a numeric value as a floating point value.
+     * @param offset        Offset of the value.
+     * @param value         Where to store value.
+     * @return              Whether the value is numeric. */
+    template <typename T>
+    bool getFloat(uint32_t offset, T &value) const {
+        uint8_t tag;
+        if (!get(offset, tag))
+            return false;
+
+        switch (tag) {
+            case kBinaryFloat: {
+                float raw;
+                if (!get(offset + 1, raw))
+                    return false;
+
+                value = raw;
+                return true;
+            }
+            case kBinaryDouble: {
+                double raw;
+                if (!get(offset + 1, raw))
+                    return false;
+
+                value = static_cast<T>(raw);
+                return true;
+            }
+            default: {
+                /* Allow integers, e.g. from hand-written source data. */
+                int64_t raw;
+                if (!getInteger(offset, raw)) {
+                    uint64_t uraw;
+                    if (!getInteger(offset, uraw))
+                        return false;
+
+                    value = static_cast<T>(uraw);
+                } else {
+                    value = static_cast<T>(raw);
+                }
+
+                return true;
+            }
+        }
+    }
+
+    /** Read an array of floats (vector/quaternion).
+     * @param offset        Offset of the value.
+     * @param values        Where to store values.
+     * @param count         Expected number of values.
+     * @return              Whether the value is an array of the expected size. */
+    bool getFloats(uint32_t offset, float *values, uint32_t count) const {
+        uint8_t tag;
+        uint32_t actualCount;
+        if (!get(offset, tag) || !get(offset + 1, actualCount) || actualCount != count)
+            return false;
+
+        if (tag == kBinaryFloatArray) {
+            return get(offset + 5, values, count * sizeof(float));
+        } else if (tag == kBinaryArray) {
+            /* Allow a generic array of numbers. */
+            uint32_t tableOffset;
+            if (!getScope(offset, Scope::kArray, actualCount, tableOffset))
+                return false;
+
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t elementOffset;
+                get(tableOffset + (i * sizeof(uint32_t)), elementOffset);
+                if (!getFloat(elementOffset, values[i]))
+                    return false;
+            }
+
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    /**
+     * Begin loading assets referenced by a value.
+     *
+     * Starts an asynchronous load of every asset referenced within a value,
+     * so that they are loaded in the background while deserialisation
+     * proceeds. References are still resolved with a synchronous load when
+     * they are read, which will only wait if the load has not yet completed.
+     *
+     * @param offset        Offset of the value.
+     * @param depth         Nesting depth of the value.
+     */
+    void prefetchAssets(uint32_t offset, unsigned depth = 0) {
+        uint8_t tag;
+        if (depth > kMaxPrefetchDepth || !get(offset, tag))
+            return;
+
+        if (tag == kBinaryAssetRef) {
+            const char *path;
+            if (getString(offset + 1, path))
+                this->assetLoads.emplace_back(g_assetManager->loadAsync(path));
+        } else if (tag == kBinaryGroup || tag == kBinaryArray) {
+            Scope::Type type = (tag == kBinaryArray) ? Scope::kArray : Scope::kGroup;
+
+            uint32_t count, tableOffset;
+            if (!getScope(offset, type, count, tableOffset))
+                return;
+
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t valueOffset;
+
+                if (type == Scope::kArray) {
+                    get(tableOffset + (i * sizeof(uint32_t)), valueOffset);
+                } else {
+                    BinaryMember member;
+                    get(tableOffset + (i * sizeof(BinaryMember)), member);
+                    valueOffset = member.offset;
+                }
+
+                prefetchAssets(valueOffset, depth + 1);
+            }
+        }
+    }
+
+    /**
+     * Common helpers.
+     */
+
+    /** Begin a new scope.
+     * @param name          Name of the scope.
+     * @param type          Type of the scope.
+     * @return              Whether the scope was found (for deserialisation). */
+    bool beginScope(const char *name, Scope::Type type) {
+        if (this->writing) {
+            addMember(name);
+            putScope(type);
+        } else {
+            uint32_t offset, count, tableOffset;
+            if (!getMember(currentScope(name), name, offset) || !getScope(offset, type, count, tableOffset))
+                return false;
+
+            pushScope(type, tableOffset, count);
+        }
+
+        return true;
+    }
+
+    /** End the current scope. When serialising, writes its member table. */
+    void endScope() {
+        Scope &scope = this->scopes.back();
+
+        if (this->writing) {
+            uint32_t tableOffset = this->output.size();
+
+            for (const BinaryMember &member : scope.members) {
+                if (scope.type == Scope::kArray) {
+                    put(member.offset);
+                } else {
+                    put(member);
+                }
+            }
+
+            patch(scope.offset + 1, static_cast<uint32_t>(scope.members.size()));
+            patch(scope.offset + 5, tableOffset);
+        }
+
+        this->scopes.pop_back();
+    }
+};
+
+BinarySerialiser::BinarySerialiser() :
+    m_state (nullptr)
+{}
+
+/** Serialise an object.
+ * @param object        Object to serialise.
+ * @return              Binary data array containing serialised object. */
+std::vector<uint8_t> BinarySerialiser::serialise(const Object *object) {
+    State state;
+    m_state = &state;
+    m_state->writing = true;
+
+    /* Header is filled in once everything else is known. */
+    m_state->output.resize(sizeof(BinaryHeader));
+
+    /* Serialise the object. Objects referred to by this object are added to
+     * the pending list rather than being serialised immediately, since we
+     * cannot nest them within the current object's data. */
+    addObject(object);
+
+    while (!m_state->pendingObjects.empty()) {
+        const Object *pending = m_state->pendingObjects.front();
+        m_state->pendingObjects.pop_front();
+
+        BinaryObject entry;
+        entry.className = m_state->addString(pending->metaClass().name());
+        entry.offset    = m_state->output.size();
+        m_state->objects.push_back(entry);
+
+        m_state->putScope(State::Scope::kObject);
+        serialiseObject(pending);
+        m_state->endScope();
+    }
+
+    /* Write the object array and string table. */
+    BinaryHeader header;
+    memcpy(header.magic, kBinaryMagic, sizeof(header.magic));
+    header.version       = kBinaryVersion;
+    header.numObjects    = m_state->objects.size();
+    header.objectsOffset = m_state->output.size();
+    m_state->put(m_state->objects.data(), m_state->objects.size() * sizeof(BinaryObject));
+    header.numStrings    = m_state->stringToIndexMap.size();
+    header.stringsOffset = m_state->output.size();
+    header.stringsSize   = m_state->strings.size();
+    m_state->put(m_state->strings.data(), m_state->strings.size());
+    m_state->patch(0, header);
+
+    std::vector<uint8_t> data = std::move(m_state->output);
+
+    m_state = nullptr;
+    return data;
+}
+
+/** Add an object to be serialised.
+ * @param object        Object to serialise. Must not already be added.
+ * @return              ID of object within file. */
+uint32_t BinarySerialiser::addObject(const Object *object) {
+    /* Objects are written in the order that they are added, so the ID is the
+     * number of objects added so far. */
+    uint32_t id = m_state->objectToIDMap.size();
+    m_state->objectToIDMap.insert(std::make_pair(object, id));
+    m_state->pendingObjects.push_back(object);
+    return id;
+}
+
+/** Deserialise an object.
+ * @param data          Serialised data.
+ * @param size          Size of the serialised data.
+ * @param metaClass     Expected type of the object.
+ * @return              Pointer to deserialised object, or null on failure. */
+ObjectPtr<Object> BinarySerialiser::deserialise(const void *data, size_t size, const MetaClass &metaClass) {
+    if (!isBinarySerialised(data, size)) {
+        logError("Serialised data is not in binary format");
+        return nullptr;
+    }
+
+    BinaryHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    if (header.version != kBinaryVersion) {
+        logError("Unsupported binary serialised data version %u", header.version);
+        return nullptr;
+    }
+
+    const uint8_t *input = reinterpret_cast<const uint8_t *>(data);
+
+    if (static_cast<uint64_t>(header.objectsOffset) + (static_cast<uint64_t>(header.numObjects) * sizeof(BinaryObject)) > size ||
+        static_cast<uint64_t>(header.stringsOffset) + header.stringsSize > size ||
+        (header.stringsSize && input[header.stringsOffset + header.stringsSize - 1] != 0))
+    {
+        logError("Binary serialised data is invalid");
+        return nullptr;
+    }
+
+    State state;
+    m_state = &state;
+    m_state->writing       = false;
+    m_state->input         = input;
+    m_state->inputSize     = size;
+    m_state->objectsOffset = header.objectsOffset;
+    m_state->numObjects    = header.numObjects;
+
+    /* Build the string table. The table is null-terminated so these will all
+     * be valid strings. */
+    m_state->inputStrings.reserve(header.numStrings);
+    const char *str = reinterpret_cast<const char *>(input + header.stringsOffset);
+    const char *end = str + header.stringsSize;
+    while (str < end && m_state->inputStrings.size() < header.numStrings) {
+        m_state->inputStrings.push_back(str);
+        str += std::strlen(str) + 1;
+    }
+
+    ObjectPtr<Object> object;
+
+    if (m_state->inputStrings.size() != header.numStrings) {
+        logError("Binary serialised data is invalid");
+    } else {
+        m_state->buildStringIndex();
+
+        /* Start loading all referenced assets up front, so that their file
+         * I/O and preparation overlaps with deserialisation. */
+        for (uint32_t id = 0; id < m_state->numObjects; id++) {
+            BinaryObject entry;
+            if (m_state->get(m_state->objectsOffset + (id * sizeof(BinaryObject)), entry))
+                m_state->prefetchAssets(entry.offset);
+        }
+
+        /* The object to return is the first object in the file. */
+        object = findObject(0, metaClass);
+    }
+
+    m_state = nullptr;
+    return object;
+}
+
+/** Deserialise an object or return an already existing object.
+ * @param id            ID of the object.
+ * @param metaClass     Expected type of the object.
+ * @return              Pointer to object, or null on failure. */
+ObjectPtr<Object> BinarySerialiser::findObject(uint32_t id, const MetaClass &metaClass) {
+    /* Check if it is already deserialised. */
+    auto existing = m_state->idToObjectMap.find(id);
+    if (existing != m_state->idToObjectMap.end())
+        return existing->second;
+
+    if (id >= m_state->numObjects) {
+        logError(
+            "Invalid serialised object ID %u (only %u objects available)",
+            id, m_state->numObjects);
+        return nullptr;
+    }
+
+    BinaryObject entry;
+    m_state->get(m_state->objectsOffset + (id * sizeof(BinaryObject)), entry);
+
+    uint32_t count, tableOffset;
+    if (entry.className >= m_state->inputStrings.size() ||
+        !m_state->getScope(entry.offset, State::Scope::kObject, count, tableOffset))
+    {
+        logError("Serialised object %u is invalid", id);
+        return nullptr;
+    }
+
+    const char *className = m_state->inputStrings[entry.className];
+
+    /* See JSONSerialiser::findObject() for why this is inserted before
+     * deserialising. */
+    auto inserted = m_state->idToObjectMap.insert(std::make_pair(id, nullptr));
+    check(inserted.second);
+
+    m_state->pushScope(State::Scope::kObject, tableOffset, count);
+    bool success = deserialiseObject(className, metaClass, id == 0, inserted.first->second);
+    m_state->scopes.pop_back();
+
+    if (success) {
+        return inserted.first->second;
+    } else {
+        m_state->idToObjectMap.erase(inserted.first);
+        return nullptr;
+    }
+}
+
+/** Begin a value group within the current scope.
+ * @param name          Name of the group.
+ * @return              Whether a group was found. */
+bool BinarySerialiser::beginGroup(const char *name) {
+    check(m_state);
+    return m_state->beginScope(name, State::Scope::kGroup);
+}
+
+/** End a value group. */
+void BinarySerialiser::endGroup() {
+    check(m_state);
+    check(m_state->scopes.back().type == State::Scope::kGroup);
+
+    m_state->endScope();
+}
+
+/** Begin a value array within the current scope.
+ * @param name          Name of the array.
+ * @return              Whether a group was found. */
+bool BinarySerialiser::beginArray(const char *name) {
+    check(m_state);
+    return m_state->beginScope(name, State::Scope::kArray);
+}
+
+/** End a value array. */
+void BinarySerialiser::endArray() {
+    check(m_state);
+    check(m_state->scopes.back().type == State::Scope::kArray);
+
+    m_state->endScope();
+}
+
+/** Write a value.
+ * @param name          Name for the value (null if array).
+ * @param type          Type of the value.
+ * @param value         Pointer to value. */
+void BinarySerialiser::write(const char *name, const MetaType &type, const void *value) {
+    check(m_state);
+    check(m_state->writing);
+
+    if (type.isPointer() && type.pointeeType().isObject()) {
+        /* Object references are written as the ID of the object within the
+         * file, the path to a managed asset, or a null reference. The same
+         * rules as JSONSerialiser are used to determine which. */
+        const Object *object = *reinterpret_cast<const Object *const *>(value);
+        if (object) {
+            const Asset *asset;
+
+            auto existing = m_state->objectToIDMap.find(object);
+            if (existing != m_state->objectToIDMap.end()) {
+                m_state->beginValue(name, kBinaryObjectRef);
+                m_state->put(existing->second);
+            } else if ((asset = object_cast<const Asset *>(object)) && asset->managed()) {
+                m_state->beginValue(name, kBinaryAssetRef);
+                m_state->put(m_state->addString(asset->path()));
+            } else {
+                m_state->beginValue(name, kBinaryObjectRef);
+                m_state->put(addObject(object));
+            }
+        } else {
+            m_state->beginValue(name, kBinaryNullRef);
+        }
+
+        return;
+    }
+
+    if (&type == &MetaType::lookup<bool>()) {
+        m_state->beginValue(name, kBinaryBool);
+        m_state->put(static_cast<uint8_t>(*reinterpret_cast<const bool *>(value)));
+    } else if (&type == &MetaType::lookup<int8_t>()) {
+        m_state->beginValue(name, kBinaryInt32);
+        m_state->put(static_cast<int32_t>(*reinterpret_cast<const int8_t *>(value)));
+    } else if (&type == &MetaType::lookup<uint8_t>()) {
+        m_state->beginValue(name, kBinaryUint32);
+        m_state->put(static_cast<uint32_t>(*reinterpret_cast<const uint8_t *>(value)));
+    } else if (&type == &MetaType::lookup<int16_t>()) {
+        m_state->beginValue(name, kBinaryInt32);
+        m_state->put(static_cast<int32_t>(*reinterpret_cast<const int16_t *>(value)));
+    } else if (&type == &MetaType::lookup<uint16_t>()) {
+        m_state->beginValue(name, kBinaryUint32);
+        m_state->put(static_cast<uint32_t>(*reinterpret_cast<const uint16_t *>(value)));
+    } else if (&type == &MetaType::lookup<int32_t>()) {
+        m_state->beginValue(name, kBinaryInt32);
+        m_state->put(*reinterpret_cast<const int32_t *>(value));
+    } else if (&type == &MetaType::lookup<uint32_t>()) {
+        m_state->beginValue(name, kBinaryUint32);
+        m_state->put(*reinterpret_cast<const uint32_t *>(value));
+    } else if (&type == &MetaType::lookup<int64_t>()) {
+        m_state->beginValue(name, kBinaryInt64);
+        m_state->put(*reinterpret_cast<const int64_t *>(value));
+    } else if (&type == &MetaType::lookup<uint64_t>()) {
+        m_state->beginValue(name, kBinaryUint64);
+        m_state->put(*reinterpret_cast<const uint64_t *>(value));
+    } else if (&type == &MetaType::lookup<float>()) {
+        m_state->beginValue(name, kBinaryFloat);
+        m_state->put(*reinterpret_cast<const float *>(value));
+    } else if (&type == &MetaType::lookup<double>()) {
+        m_state->beginValue(name, kBinaryDouble);
+        m_state->put(*reinterpret_cast<const double *>(value));
+    } else if (&type == &MetaType::lookup<std::string>()) {
+        m_state->beginValue(name, kBinaryString);
+        m_state->put(m_state->addString(*reinterpret_cast<const std::string *>(value)));
+    } else if (&type == &MetaType::lookup<glm::vec2>()) {
+        auto vec = reinterpret_cast<const glm::vec2 *>(value);
+        const float components[2] = { vec->x, vec->y };
+        m_state->beginValue(name, kBinaryFloatArray);
+        m_state->put(static_cast<uint32_t>(2));
+        m_state->put(components, sizeof(components));
+    } else if (&type == &MetaType::lookup<glm::vec3>()) {
+        auto vec = reinterpret_cast<const glm::vec3 *>(value);
+        const float components[3] = { vec->x, vec->y, vec->z };
+        m_state->beginValue(name, kBinaryFloatArray);
+        m_state->put(static_cast<uint32_t>(3));
+        m_state->put(components, sizeof(components));
+    } else if (&type == &MetaType::lookup<glm::vec4>()) {
+        auto vec = reinterpret_cast<const glm::vec4 *>(value);
+        const float components[4] = { vec->x, vec->y, vec->z, vec->w };
+        m_state->beginValue(name, kBinaryFloatArray);
+        m_state->put(static_cast<uint32_t>(4));
+        m_state->put(components, sizeof(components));
+    } else if (&type == &MetaType::lookup<glm::quat>()) {
+        auto quat = reinterpret_cast<const glm::quat *>(value);
+        const float components[4] = { quat->w, quat->x, quat->y, quat->z };
+        m_state->beginValue(name, kBinaryFloatArray);
+        m_state->put(static_cast<uint32_t>(4));
+        m_state->put(components, sizeof(components));
+    } else if (type.isEnum()) {
+        /* Enums are stored by name, like JSONSerialiser, so that serialised
+         * data is not invalidated by changes to the values of constants. */
+        // FIXME: Incorrect where enum size is not an int.
+        const MetaType::EnumConstantArray &constants = type.enumConstants();
+        auto constant = constants.begin();
+        while (constant != constants.end()) {
+            if (*reinterpret_cast<const int *>(value) == constant->second)
+                break;
+
+            ++constant;
+        }
+
+        check(constant != constants.end());
+
+        m_state->beginValue(name, kBinaryString);
+        m_state->put(m_state->addString(constant->first));
+    } else {
+        fatal("Type '%s' is unsupported for serialisation", type.name());
+    }
+}
+
+/** Read a value.
+ * @param name          Name for the value (null if array).
+ * @param type          Type of the value.
+ * @param value         Pointer to value.
+ * @return              Whether the value was found. */
+bool BinarySerialiser::read(const char *name, const MetaType &type, void *value) {
+    check(m_state);
+    check(!m_state->writing);
+
+    State::Scope &scope = m_state->currentScope(name);
+
+    uint32_t offset;
+    if (!m_state->getMember(scope, name, offset))
+        return false;
+
+    uint8_t tag;
+    if (!m_state->get(offset, tag))
+        return false;
+
+    if (type.isPointer() && type.pointeeType().isObject()) {
+        const MetaClass &metaClass = static_cast<const MetaClass &>(type.pointeeType());
+
+        ObjectPtr<Object> ret;
+
+        switch (tag) {
+            case kBinaryNullRef:
+                *reinterpret_cast<Object **>(value) = nullptr;
+                return true;
+            case kBinaryGroup: {
+                /* An empty group is a null reference, as in JSON. */
+                uint32_t count;
+                if (!m_state->get(offset + 1, count) || count != 0)
+                    return false;
+
+                *reinterpret_cast<Object **>(value) = nullptr;
+                return true;
+            }
+            case kBinaryAssetRef: {
+                const char *path;
+                if (!m_state->getString(offset + 1, path))
+                    return false;
+
+                ret = g_assetManager->load(path);
+                if (ret && !metaClass.isBaseOf(ret->metaClass())) {
+                    logError("Class mismatch in serialised data (expected '%s', have '%s')",
+                             metaClass.name(), ret->metaClass().name());
+                    ret.reset();
+                }
+
+                break;
+            }
+            case kBinaryObjectRef: {
+                uint32_t id;
+                if (!m_state->get(offset + 1, id))
+                    return false;
+
+                ret = findObject(id, metaClass);
+                break;
+            }
+            default:
+                return false;
+        }
+
+        if (ret) {
+            if (type.isRefcounted()) {
+                *reinterpret_cast<ObjectPtr<Object> *>(value) = std::move(ret);
+            } else {
+                *reinterpret_cast<Object **>(value) = ret;
+            }
+
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    if (&type == &MetaType::lookup<bool>()) {
+        uint8_t raw;
+        if (tag != kBinaryBool || !m_state->get(offset + 1, raw))
+            return false;
+
+        *reinterpret_cast<bool *>(value) = raw != 0;
+    } else if (&type == &MetaType::lookup<int8_t>()) {
+        return m_state->getInteger(offset, *reinterpret_cast<int8_t *>(value));
+    } else if (&type == &MetaType::lookup<uint8_t>()) {
+        return m_state->getInteger(offset, *reinterpret_cast<uint8_t *>(value));
+    } else if (&type == &MetaType::lookup<int16_t>()) {
+        return m_state->getInteger(offset, *reinterpret_cast<int16_t *>(value));
+    } else if (&type == &MetaType::lookup<uint16_t>()) {
+        return m_state->getInteger(offset, *reinterpret_cast<uint16_t *>(value));
+    } else if (&type == &MetaType::lookup<int32_t>()) {
+        return m_state->getInteger(offset, *reinterpret_cast<int32_t *>(value));
+    } else if (&type == &MetaType::lookup<uint32_t>()) {
+        return m_state->getInteger(offset, *reinterpret_cast<uint32_t *>(value));
+    } else if (&type == &MetaType::lookup<int64_t>()) {
+        return m_state->getInteger(offset, *reinterpret_cast<int64_t *>(value));
+    } else if (&type == &MetaType::lookup<uint64_t>()) {
+        return m_state->getInteger(offset, *reinterpret_cast<uint64_t *>(value));
+    } else if (&type == &MetaType::lookup<float>()) {
+        return m_state->getFloat(offset, *reinterpret_cast<float *>(value));
+    } else if (&type == &MetaType::lookup<double>()) {
+        return m_state->getFloat(offset, *reinterpret_cast<double *>(value));
+    } else if (&type == &MetaType::lookup<std::string>()) {
+        const char *str;
+        if (tag != kBinaryString || !m_state->getString(offset + 1, str))
+            return false;
+
+        *reinterpret_cast<std::string *>(value) = str;
+    } else if (&type == &MetaType::lookup<glm::vec2>()) {
+        float components[2];
+        if (!m_state->getFloats(offset, components, 2))
+            return false;
+
+        *reinterpret_cast<glm::vec2 *>(value) = glm::vec2(components[0], components[1]);
+    } else if (&type == &MetaType::lookup<glm::vec3>()) {
+        float components[3];
+        if (!m_state->getFloats(offset, components, 3))
+            return false;
+
+        *reinterpret_cast<glm::vec3 *>(value) = glm::vec3(components[0], components[1], components[2]);
+    } else if (&type == &MetaType::lookup<glm::vec4>()) {
+        float components[4];
+        if (!m_state->getFloats(offset, components, 4))
+            return false;
+
+        *reinterpret_cast<glm::vec4 *>(value) = glm::vec4(components[0], components[1], components[2], components[3]);
+    } else if (&type == &MetaType::lookup<glm::quat>()) {
+        float components[4];
+        if (!m_state->getFloats(offset, components, 4))
+            return false;
+
+        *reinterpret_cast<glm::quat *>(value) = glm::quat(components[0], components[1], components[2], components[3]);
+    } else if (type.isEnum()) {
+        const char *str;
+        if (tag != kBinaryString || !m_state->getString(offset + 1, str))
+            return false;
+
+        /* Match the string against a value. */
+        const MetaType::EnumConstantArray &constants = type.enumConstants();
+        auto constant = constants.begin();
+        while (constant != constants.end()) {
+            if (std::strcmp(str, constant->first) == 0) {
+                // FIXME: enum size
+                *reinterpret_cast<int *>(value) = constant->second;
+                break;
+            }
+
+            ++constant;
+        }
+
+        if (constant == constants.end())
+            return false;
+    } else {
+        fatal("Type '%s' is unsupported for deserialisation", type.name());
+    }
+
+    return true;
+}
@@ -27,6 +27,7 @@
 #include "engine/engine.h"
 #include "engine/game.h"
 #include "engine/profiler.h"
+#include "engine/texture_streaming.h"
 #include "engine/window.h"
 #include "engine/world.h"
 #include "engine/world_explorer.h"
@@ -110,6 +111,8 @@ Engine::Engine(int argc, char **argv) :
     /* Initialize other global systems. */
     g_inputManager = new InputManager;
     g_assetManager = new AssetManager;
+    if (m_config.textureStreamingBudget)
+        g_textureStreamingManager = new TextureStreamingManager(m_config.textureStreamingBudget);
     g_renderResources.init();
     g_renderTargetPool.init();
     g_debugManager->initResources();
@@ -133,6 +136,8 @@ Engine::~Engine() {
 
     /* Shut down global systems. */
     delete g_debugManager;
+    delete g_textureStreamingManager;
+    g_textureStreamingManager = nullptr;
     delete g_assetManager;
     delete g_inputManager;
     delete g_gpuManager;
@@ -153,13 +158,24 @@ void Engine::run() {
 
         g_debugManager->startFrame();
 
+        /* Progress any asynchronous asset loads, creating assets which are
+         * ready to be created. */
+        g_assetManager->update();
+
         /* Display statistics from the previous frame. */
         g_debugManager->writeText(String::format("FPS: %.1f\n", m_stats.fps));
         g_debugManager->writeText(String::format("Frame time: %.0f ms\n", m_stats.frameTime * 1000.0f));
-        g_debugManager->writeText(String::format("Draw calls: %u\n", m_stats.drawCalls));
+        g_debugManager->writeText(String::format("Draw calls: %u (%u instances)\n",
+                                                 m_stats.drawCalls, m_stats.drawInstances));
+
+        /* Update texture residency based on the textures used in the previous
+         * frame. */
+        if (g_textureStreamingManager)
+            g_textureStreamingManager->update();
 
         /* Reset frame statistics. */
         m_stats.drawCalls = 0;
+        m_stats.drawInstances = 0;
 
         /* Call frame start handlers. */
         m_frameNotifier.notify([] (FrameListener *listener) { listener->frameStarted(); });
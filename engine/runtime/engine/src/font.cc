@@ -18,11 +18,17 @@
  * @file
  * @brief               Font asset.
  *
- * TODO:
- *  - Unicode.
- *  - Can save space in the texture atlas by only using the individual glyph
- *    width rather than the maximum per glyph. Would need a lookup table for the
- *    X/Y coordinates in the atlas of each glyph.
+ * Glyphs are rasterised on demand and packed into texture atlas pages using a
+ * SkylinePacker. Pages start small and are enlarged as they fill up, until
+ * they reach a maximum size, after which a new page is added. Since a larger
+ * texture must be created when a page is enlarged, the CPU copy of each page
+ * is kept around. This also allows all glyphs added during a frame to be
+ * uploaded with a single update covering the changed area of each page.
+ *
+ * Distance field glyphs are generated by rendering the glyph at a higher
+ * resolution, computing the exact Euclidean distance transform of the glyph
+ * image and its inverse (using the algorithm by Felzenszwalb & Huttenlocher),
+ * and sampling the signed distance at the centre of each output pixel.
  */
 
 #include "engine/font.h"
@@ -57,13 +63,29 @@ private:
 /** DPI to render at. */
 static const size_t kFontDPI = 96;
 
+/** Initial size of texture atlas pages. */
+static const uint32_t kInitialPageSize = 256;
+
+/** Maximum size of texture atlas pages. */
+static const uint32_t kMaxPageSize = 1024;
+
+/** Space to leave between glyphs in the atlas, to avoid filtering artifacts. */
+static const uint32_t kGlyphPadding = 1;
+
+/** Factor to increase resolution by when rendering distance field glyphs. */
+static const int kDistanceFieldScale = 4;
+
+/** Value used for infinite distance in the distance transform. */
+static const float kDistanceInfinity = 1e20f;
+
 /** Global FreeType library instance. */
 static FreeTypeLibrary g_freeType;
 
 /** Initialise the font. */
 Font::Font() :
-    m_dataSize (0),
-    m_face     (nullptr)
+    m_dataSize     (0),
+    m_face         (nullptr),
+    m_sizedVariant (nullptr)
 {}
 
 /** Destroy the font. */
@@ -93,8 +115,10 @@ FontVariant *Font::getVariant(const FontVariantDesc &desc) {
         return it->second.get();
 
     std::unique_ptr<FontVariant> variant(new FontVariant(this, desc));
-    if (!variant->load())
+    if (!variant->load()) {
+        m_sizedVariant = nullptr;
         return nullptr;
+    }
 
     FontVariant *ret = variant.get();
     m_variants.insert(std::make_pair(desc, std::move(variant)));
@@ -140,6 +164,15 @@ bool Font::isFixedWidth() const {
     return FT_IS_FIXED_WIDTH(face);
 }
 
+/** Initialise an atlas page.
+ * @param size          Width and height of the page. */
+FontVariant::Page::Page(uint32_t size) :
+    texture (new Texture2D(size, size, PixelFormat::kR8, 1, 0)),
+    packer  (size, size),
+    pixels  (size * size, 0),
+    dirty   (0, 0, size, size)
+{}
+
 /** Initialise the variant (does not load font).
  * @param font          Font this variant belongs to.
  * @param desc          Descriptor containing variant properties. */
@@ -153,82 +186,421 @@ FontVariant::FontVariant(Font *font, const FontVariantDesc &desc) :
 {}
 
 /** Destroy the variant. */
-FontVariant::~FontVariant() {}
+FontVariant::~FontVariant() {
+    if (m_font->m_sizedVariant == this)
+        m_font->m_sizedVariant = nullptr;
+}
+
+/** Set the size of the font's face to that of this variant. */
+void FontVariant::setCharSize() {
+    if (m_font->m_sizedVariant == this)
+        return;
+
+    FT_Face face = reinterpret_cast<FT_Face>(m_font->m_face);
+
+    /* Size is given as 1/64th's of a point. Distance field glyphs are rendered
+     * at a higher resolution. */
+    unsigned scale = (isDistanceField()) ? kDistanceFieldScale : 1;
+    FT_Set_Char_Size(face, 0, pointSize() * scale * 64, kFontDPI, kFontDPI);
+
+    m_font->m_sizedVariant = this;
+}
 
 /** Load the font data (internal method called from Font::getVariant()).
  * @return              Whether the variant was successfully loaded. */
 bool FontVariant::load() {
     FT_Face face = reinterpret_cast<FT_Face>(m_font->m_face);
 
-    /* Set the point size of the font (size is given as 1/64th's of a point). */
-    FT_Set_Char_Size(face, 0, pointSize() * 64, kFontDPI, kFontDPI);
+    setCharSize();
+
+    /* Check that we can load the glyph that is substituted for missing ones. */
+    if (FT_Load_Char(face, '?', FT_LOAD_DEFAULT) != 0) {
+        logError("%s: Loading glyph '?' failed", m_font->path().c_str());
+        return false;
+    }
 
     /* Determine maximum font heights. Divide by 64 to get pixels. */
-    m_maxAscender = face->size->metrics.ascender / 64;
-    m_maxDescender = -(face->size->metrics.descender / 64);
+    unsigned scale = (isDistanceField()) ? kDistanceFieldScale : 1;
+    m_maxAscender = face->size->metrics.ascender / 64 / scale;
+    m_maxDescender = -(face->size->metrics.descender / 64) / scale;
     m_height = std::max(m_maxAscender + m_maxDescender,
-                        static_cast<unsigned>(face->size->metrics.height / 64));
-
-    /* Determine the maximum glyph width, which will be the spacing between
-     * glyphs in the texture atlas.. For this we have to check each glyph in
-     * turn. */
-    for (unsigned i = 0; i < 256; i++) {
-        if (FT_Load_Char(face, i, FT_LOAD_RENDER) != 0) {
-            /* If loading a glyph fails, load a question mark in its place. */
-            if (FT_Load_Char(face, '?', FT_LOAD_RENDER) != 0) {
-                logError("%s: Loading glyph %zu failed", m_font->path().c_str(), i);
-                return false;
-            }
-        }
-
-        /* Calculate the dimensions of the glyph. */
-        m_maxWidth = std::max(
-            m_maxWidth,
-            face->glyph->bitmap_left + face->glyph->bitmap.width);
-    }
+                        static_cast<unsigned>(face->size->metrics.height / 64 / scale));
+    m_maxWidth = face->size->metrics.max_advance / 64 / scale;
 
-    logDebug("%s: Loading point size %u", m_font->path().c_str(), pointSize());
+    logDebug("%s: Loading point size %u%s",
+             m_font->path().c_str(), pointSize(),
+             (isDistanceField()) ? " (distance field)" : "");
     logDebug("  height = %u", m_height);
     logDebug("  maxAscender = %u", m_maxAscender);
     logDebug("  maxDescender = %u", m_maxDescender);
     logDebug("  maxWidth = %u", m_maxWidth);
 
-    /* Create the texture atlas. */
-    m_texture = new Texture2D(m_maxWidth * 256, m_height, PixelFormat::kR8);
-    m_texture->clear();
-
-    /* Load glyph data into the atlas. */
-    m_glyphs.resize(256);
-    for (unsigned i = 0; i < 256; i++) {
-        if (FT_Load_Char(face, i, FT_LOAD_RENDER) != 0) {
-            if (FT_Load_Char(face, '?', FT_LOAD_RENDER) != 0) {
-                logError("%s: Loading glyph %zu failed", m_font->path().c_str(), i);
-                return false;
+    m_pages.emplace_back(new Page(kInitialPageSize));
+    return true;
+}
+
+/**
+ * Get information for a glyph.
+ *
+ * Gets metrics and atlas position information for a glyph. If the glyph has
+ * not previously been used, it is rasterised and added to the texture atlas.
+ * Its texture data will not be uploaded until the next call to flush(). If the
+ * font does not contain the glyph, a question mark is used in its place.
+ *
+ * @param codepoint     Unicode codepoint of the glyph.
+ *
+ * @return              Information for the specified glyph.
+ */
+const FontGlyph &FontVariant::getGlyph(uint32_t codepoint) {
+    auto ret = m_glyphs.insert(std::make_pair(codepoint, FontGlyph()));
+    if (ret.second)
+        loadGlyph(codepoint, ret.first->second);
+
+    return ret.first->second;
+}
+
+/**
+ * Upload new glyphs to the texture atlas.
+ *
+ * Uploads the texture data for all glyphs added since the last call. This
+ * should be called once per frame after all required glyphs have been
+ * obtained with getGlyph() and before drawing with the page textures. One
+ * update is performed for each page which has changed.
+ */
+void FontVariant::flush() {
+    for (auto &page : m_pages) {
+        if (page->dirty.width == 0 || page->dirty.height == 0)
+            continue;
+
+        uint32_t size = page->packer.width();
+        const uint8_t *data = &page->pixels[page->dirty.y * size];
+
+        /* Gather the area into a contiguous buffer if it does not cover the
+         * full width of the page. */
+        std::unique_ptr<uint8_t[]> area;
+        if (static_cast<uint32_t>(page->dirty.width) != size) {
+            area.reset(new uint8_t[page->dirty.width * page->dirty.height]);
+
+            for (int32_t y = 0; y < page->dirty.height; y++) {
+                memcpy(&area[y * page->dirty.width],
+                       &data[(y * size) + page->dirty.x],
+                       page->dirty.width);
             }
+
+            data = area.get();
+        }
+
+        page->texture->update(page->dirty, data, false);
+        page->dirty = IntRect();
+    }
+}
+
+/** Compute the 1D squared distance transform of a sampled function.
+ * @param f             Function values, with kDistanceInfinity for points
+ *                      outside the set.
+ * @param n             Number of values.
+ * @param d             Where to store squared distances.
+ * @param v             Temporary array of n parabola locations.
+ * @param z             Temporary array of n + 1 parabola boundaries. */
+static void distanceTransform(const float *f, int n, float *d, int *v, float *z) {
+    int k = 0;
+    v[0] = 0;
+    z[0] = -kDistanceInfinity;
+    z[1] = kDistanceInfinity;
+
+    for (int q = 1; q < n; q++) {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        while (s <= z[k]) {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
         }
 
-        /* Get glyph metrics. */
-        m_glyphs[i].width = face->glyph->bitmap.width;
-        m_glyphs[i].height = face->glyph->bitmap.rows;
-        m_glyphs[i].offsetX = face->glyph->bitmap_left;
-        m_glyphs[i].offsetY = m_maxAscender - face->glyph->bitmap_top;
-        m_glyphs[i].advance = face->glyph->metrics.horiAdvance / 64;
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = kDistanceInfinity;
+    }
 
-        /* Determine texture atlas position. We put all fonts on to one row for
-         * now so we just have Y position as Y offset. */
-        m_glyphs[i].x = (i * m_maxWidth) + m_glyphs[i].offsetX;
-        m_glyphs[i].y = m_glyphs[i].offsetY;
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q)
+            k++;
 
-        /* Some fonts have dodgy metrics that result in some glyphs' image areas
-         * being outside the defined maximum boundaries. Work around this by
-         * clipping them. */
-        if (m_glyphs[i].offsetY + m_glyphs[i].height > m_height)
-            m_glyphs[i].height = m_height - m_glyphs[i].offsetY;
+        int r = v[k];
+        d[q] = ((q - r) * (q - r)) + f[r];
+    }
+}
 
-        /* Load the texture data. FIXME: Correctly handle bitmap formats. */
-        IntRect area(m_glyphs[i].x, m_glyphs[i].y, m_glyphs[i].width, m_glyphs[i].height);
-        m_texture->update(area, face->glyph->bitmap.buffer);
+/** Compute the Euclidean distance to the nearest pixel set in a mask.
+ * @param mask          Mask image.
+ * @param width         Width of the image.
+ * @param height        Height of the image.
+ * @param value         Value of pixels in the set.
+ * @param outDistances  Where to store distance for each pixel. */
+static void distanceTransform(const std::vector<uint8_t> &mask,
+                              int width,
+                              int height,
+                              uint8_t value,
+                              std::vector<float> &outDistances)
+{
+    int n = std::max(width, height);
+    std::vector<float> f(n);
+    std::vector<float> d(n);
+    std::vector<int> v(n);
+    std::vector<float> z(n + 1);
+
+    outDistances.resize(width * height);
+
+    for (int i = 0; i < width * height; i++)
+        outDistances[i] = (mask[i] == value) ? 0.0f : kDistanceInfinity;
+
+    /* Transform columns, then rows. */
+    for (int x = 0; x < width; x++) {
+        for (int y = 0; y < height; y++)
+            f[y] = outDistances[(y * width) + x];
+
+        distanceTransform(&f[0], height, &d[0], &v[0], &z[0]);
+
+        for (int y = 0; y < height; y++)
+            outDistances[(y * width) + x] = d[y];
     }
 
+    for (int y = 0; y < height; y++) {
+        float *row = &outDistances[y * width];
+        std::copy(row, row + width, f.begin());
+
+        distanceTransform(&f[0], width, &d[0], &v[0], &z[0]);
+
+        for (int x = 0; x < width; x++)
+            row[x] = std::sqrt(d[x]);
+    }
+}
+
+/** Divide rounding towards negative infinity.
+ * @param a             Dividend.
+ * @param b             Divisor (positive).
+ * @return              Result of the division. */
+static inline int divideDown(int a, int b) {
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+/** Divide rounding towards positive infinity.
+ * @param a             Dividend.
+ * @param b             Divisor (positive).
+ * @return              Result of the division. */
+static inline int divideUp(int a, int b) {
+    return -divideDown(-a, b);
+}
+
+/** Load a glyph and add it to the atlas.
+ * @param codepoint     Unicode codepoint of the glyph.
+ * @param glyph         Glyph to fill in. */
+void FontVariant::loadGlyph(uint32_t codepoint, FontGlyph &glyph) {
+    FT_Face face = reinterpret_cast<FT_Face>(m_font->m_face);
+
+    setCharSize();
+
+    /* If the font does not have the glyph, load a question mark in its place.
+     * Index 0 is the font's own missing glyph, used as a last resort. */
+    FT_UInt index = FT_Get_Char_Index(face, codepoint);
+    if (index == 0)
+        index = FT_Get_Char_Index(face, '?');
+
+    if (FT_Load_Glyph(face, index, FT_LOAD_RENDER) != 0) {
+        logError("%s: Loading glyph 0x%x failed", m_font->path().c_str(), codepoint);
+        return;
+    }
+
+    const FT_Bitmap &bitmap = face->glyph->bitmap;
+    int width = bitmap.width;
+    int height = bitmap.rows;
+
+    /* Convert the bitmap to 8 bits per pixel without padding. Rows are stored
+     * bottom up if the pitch is negative. */
+    std::vector<uint8_t> image(width * height);
+    const uint8_t *row = bitmap.buffer;
+    if (bitmap.pitch < 0)
+        row -= bitmap.pitch * (height - 1);
+
+    for (int y = 0; y < height; y++, row += bitmap.pitch) {
+        uint8_t *dest = &image[y * width];
+
+        switch (bitmap.pixel_mode) {
+            case FT_PIXEL_MODE_GRAY:
+                memcpy(dest, row, width);
+                break;
+            case FT_PIXEL_MODE_MONO:
+                for (int x = 0; x < width; x++)
+                    dest[x] = (row[x / 8] & (0x80 >> (x % 8))) ? 255 : 0;
+
+                break;
+            default:
+                logError("%s: Glyph 0x%x has unsupported pixel mode %u",
+                         m_font->path().c_str(), codepoint, bitmap.pixel_mode);
+                return;
+        }
+    }
+
+    if (!isDistanceField()) {
+        glyph.width = width;
+        glyph.height = height;
+        glyph.offsetX = face->glyph->bitmap_left;
+        glyph.offsetY = static_cast<int>(m_maxAscender) - face->glyph->bitmap_top;
+        glyph.advance = face->glyph->metrics.horiAdvance / 64;
+
+        addImage(image.data(), width, height, glyph);
+        return;
+    }
+
+    const int scale = kDistanceFieldScale;
+    const int spread = kDistanceFieldSpread;
+
+    glyph.advance = (face->glyph->metrics.horiAdvance + (32 * scale)) / (64 * scale);
+
+    /* Nothing to draw for empty glyphs such as spaces. */
+    if (width == 0 || height == 0)
+        return;
+
+    /* Determine the output area, in output pixels relative to the origin with
+     * Y pointing up. This is aligned so that output pixels cover a whole number
+     * of rendered pixels, and extended by the spread on each side. */
+    int left = divideDown(face->glyph->bitmap_left, scale) - spread;
+    int right = divideUp(face->glyph->bitmap_left + width, scale) + spread;
+    int top = divideUp(face->glyph->bitmap_top, scale) + spread;
+    int bottom = divideDown(face->glyph->bitmap_top - height, scale) - spread;
+
+    int outWidth = right - left;
+    int outHeight = top - bottom;
+
+    /* Place the rendered glyph in the output area at full resolution. */
+    int fullWidth = outWidth * scale;
+    int fullHeight = outHeight * scale;
+    int imageX = face->glyph->bitmap_left - (left * scale);
+    int imageY = (top * scale) - face->glyph->bitmap_top;
+
+    std::vector<uint8_t> mask(fullWidth * fullHeight, 0);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++)
+            mask[((imageY + y) * fullWidth) + imageX + x] = image[(y * width) + x] >= 128;
+    }
+
+    /* Compute distance from each pixel outside the glyph to the nearest pixel
+     * inside it and vice versa. */
+    std::vector<float> outside;
+    std::vector<float> inside;
+    distanceTransform(mask, fullWidth, fullHeight, 1, outside);
+    distanceTransform(mask, fullWidth, fullHeight, 0, inside);
+
+    /* Sample at the centre of each output pixel, which lies between the middle
+     * 4 rendered pixels. The edge lies half way between pixels either side of
+     * it, hence the correction of half a pixel. */
+    std::vector<uint8_t> field(outWidth * outHeight);
+    for (int y = 0; y < outHeight; y++) {
+        for (int x = 0; x < outWidth; x++) {
+            float distance = 0.0f;
+
+            for (int sy = 0; sy < 2; sy++) {
+                for (int sx = 0; sx < 2; sx++) {
+                    int offset =
+                        (((y * scale) + (scale / 2) - 1 + sy) * fullWidth) +
+                        (x * scale) + (scale / 2) - 1 + sx;
+
+                    distance += (mask[offset])
+                        ? inside[offset] - 0.5f
+                        : 0.5f - outside[offset];
+                }
+            }
+
+            distance /= 4.0f * scale;
+
+            float value = 0.5f + (distance / (2.0f * spread));
+            value = glm::clamp(value, 0.0f, 1.0f);
+            field[(y * outWidth) + x] = static_cast<uint8_t>((value * 255.0f) + 0.5f);
+        }
+    }
+
+    glyph.width = outWidth;
+    glyph.height = outHeight;
+    glyph.offsetX = left;
+    glyph.offsetY = static_cast<int>(m_maxAscender) - top;
+
+    addImage(field.data(), outWidth, outHeight, glyph);
+}
+
+/** Add a glyph image to the atlas.
+ * @param image         Image data (8 bits per pixel).
+ * @param width         Width of the image.
+ * @param height        Height of the image.
+ * @param glyph         Glyph to set atlas position of.
+ * @return              Whether the image could be added. */
+bool FontVariant::addImage(const uint8_t *image, unsigned width, unsigned height, FontGlyph &glyph) {
+    if (width == 0 || height == 0)
+        return true;
+
+    uint32_t paddedWidth = width + kGlyphPadding;
+    uint32_t paddedHeight = height + kGlyphPadding;
+
+    if (paddedWidth > kMaxPageSize || paddedHeight > kMaxPageSize) {
+        logError("%s: Glyph of size %ux%u is too large for atlas", m_font->path().c_str(), width, height);
+        glyph.width = glyph.height = 0;
+        return false;
+    }
+
+    /* Try to fit in an existing page, enlarging the last page if needed. If it
+     * is already at the maximum size, start a new page. */
+    uint32_t x, y;
+    unsigned index = 0;
+    while (!m_pages[index]->packer.insert(paddedWidth, paddedHeight, x, y)) {
+        if (index + 1 < m_pages.size()) {
+            index++;
+        } else if (m_pages[index]->packer.width() < kMaxPageSize) {
+            growPage(*m_pages[index]);
+        } else {
+            m_pages.emplace_back(new Page(kInitialPageSize));
+            index++;
+        }
+    }
+
+    Page &page = *m_pages[index];
+    uint32_t size = page.packer.width();
+
+    for (unsigned row = 0; row < height; row++)
+        memcpy(&page.pixels[((y + row) * size) + x], &image[row * width], width);
+
+    /* Extend the area to upload on the next flush. */
+    IntRect area(x, y, width, height);
+    if (page.dirty.width == 0 || page.dirty.height == 0) {
+        page.dirty = area;
+    } else {
+        int32_t dirtyRight = std::max(page.dirty.x + page.dirty.width, area.x + area.width);
+        int32_t dirtyBottom = std::max(page.dirty.y + page.dirty.height, area.y + area.height);
+        page.dirty.x = std::min(page.dirty.x, area.x);
+        page.dirty.y = std::min(page.dirty.y, area.y);
+        page.dirty.width = dirtyRight - page.dirty.x;
+        page.dirty.height = dirtyBottom - page.dirty.y;
+    }
+
+    glyph.page = index;
+    glyph.x = x;
+    glyph.y = y;
     return true;
 }
+
+/** Double the size of an atlas page.
+ * @param page          Page to enlarge. */
+void FontVariant::growPage(Page &page) {
+    uint32_t size = page.packer.width();
+    uint32_t newSize = size * 2;
+
+    std::vector<uint8_t> pixels(newSize * newSize, 0);
+    for (uint32_t row = 0; row < size; row++)
+        memcpy(&pixels[row * newSize], &page.pixels[row * size], size);
+
+    page.pixels = std::move(pixels);
+    page.packer.grow(newSize, newSize);
+
+    /* Create a new texture. Existing glyphs remain at the same positions but
+     * everything must be uploaded again. */
+    page.texture = new Texture2D(newSize, newSize, PixelFormat::kR8, 1, 0);
+    page.dirty = IntRect(0, 0, newSize, newSize);
+}
@@ -17,6 +17,13 @@
 /**
  * @file
  * @brief               JSON serialisation class.
+ *
+ * Deserialisation parses in-situ, so that strings in the document refer to the
+ * input rather than each being allocated separately. Only data which cannot be
+ * modified (passed to deserialise() rather than deserialiseInSitu()) is copied
+ * first. The DOM is allocated from a memory pool sized based on the input size.
+ * Each group is indexed with a small hash table when it is entered, so that
+ * lookup of each property is not a linear search of the group's members.
  */
 
 #include "engine/asset_manager.h"
@@ -29,9 +36,16 @@
 
 #include <list>
 
+/** Minimum memory pool chunk size for deserialisation. */
+static const size_t kMinimumPoolChunkSize = 64 * 1024;
+
 /** Internal state used during (de)serialisation. */
 struct JSONSerialiser::State {
     bool writing;                           /**< Whether we are currently writing or reading. */
+
+    /** Allocator for the document. */
+    rapidjson::MemoryPoolAllocator<> allocator;
+
     rapidjson::Document document;           /**< Current document. */
 
     /** Map of object addresses to pre-existing IDs (serialising). */
@@ -40,6 +54,9 @@ struct JSONSerialiser::State {
     /** Map of IDs to pre-existing objects (deserialising). */
     HashMap<uint32_t, ObjectPtr<Object>> idToObjectMap;
 
+    /** Asynchronous loads of referenced assets (deserialising). */
+    std::vector<AssetLoadRequestPtr> assetLoads;
+
     /** Structure representing a scope. */
     struct Scope {
         enum Type {
@@ -52,13 +69,106 @@ struct JSONSerialiser::State {
         rapidjson::Value &value;            /**< Value that it refers to. */
         size_t nextIndex;                   /**< Next array index. */
 
+        /**
+         * Member index (deserialising objects/groups).
+         *
+         * This is an open-addressed hash table of the members of the value,
+         * keyed by name. Empty slots are null. Its size is a power of 2.
+         */
+        std::vector<rapidjson::Value::Member *> index;
+
         Scope(Type inType, rapidjson::Value &inValue) :
             type      (inType),
             value     (inValue),
             nextIndex (0)
         {}
+
+        /** Build the member index. */
+        void buildIndex() {
+            size_t size = 4;
+            while (size < this->value.MemberCount() * 2)
+                size <<= 1;
+
+            this->index.assign(size, nullptr);
+
+            for (auto it = this->value.MemberBegin(); it != this->value.MemberEnd(); ++it) {
+                size_t slot = hashMem(it->name.GetString(), it->name.GetStringLength()) & (size - 1);
+
+                /* If names are duplicated, the first is found as with
+                 * FindMember(). */
+                while (this->index[slot])
+                    slot = (slot + 1) & (size - 1);
+
+                this->index[slot] = &*it;
+            }
+        }
+
+        /** Find a member using the member index.
+         * @param name          Name of the member.
+         * @return              Pointer to member value, or null if not found. */
+        rapidjson::Value *findMember(const char *name) {
+            size_t length = std::strlen(name);
+            size_t slot = hashMem(name, length) & (this->index.size() - 1);
+
+            while (this->index[slot]) {
+                const rapidjson::Value &memberName = this->index[slot]->name;
+                if (memberName.GetStringLength() == length && std::memcmp(memberName.GetString(), name, length) == 0)
+                    return &this->index[slot]->value;
+
+                slot = (slot + 1) & (this->index.size() - 1);
+            }
+
+            return nullptr;
+        }
     };
 
+    /** Initialise the state.
+     * @param inputSize     Size of the input data (0 if serialising). This is
+     *                      used to size the memory pool for the document. The
+     *                      DOM is usually of a similar size to the text. */
+    explicit State(size_t inputSize = 0) :
+        allocator (std::max(inputSize, kMinimumPoolChunkSize)),
+        document  (&allocator)
+    {}
+
+    /** Push a new scope on to the scope stack.
+     * @param type          Type of the scope.
+     * @param value         Value that it refers to. */
+    void pushScope(Scope::Type type, rapidjson::Value &value) {
+        this->scopes.emplace_back(type, value);
+
+        if (!this->writing && type != Scope::kArray)
+            this->scopes.back().buildIndex();
+    }
+
+    /**
+     * Begin loading assets referenced by a value.
+     *
+     * Starts an asynchronous load of every asset referenced within a value
+     * (see JSONSerialiser::write() for the format of references). References
+     * are still resolved with a synchronous load when they are read, which
+     * will only wait if the load has not yet completed.
+     *
+     * @param value         Value to search for references.
+     */
+    void prefetchAssets(const rapidjson::Value &value) {
+        if (value.IsObject()) {
+            if (value.MemberCount() == 1) {
+                const rapidjson::Value::Member &member = *value.MemberBegin();
+                if (std::strcmp(member.name.GetString(), "asset") == 0 && member.value.IsString()) {
+                    this->assetLoads.emplace_back(g_assetManager->loadAsync(member.value.GetString()));
+                    return;
+                }
+            }
+
+            for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it)
+                prefetchAssets(it->value);
+        } else if (value.IsArray()) {
+            for (auto it = value.Begin(); it != value.End(); ++it)
+                prefetchAssets(*it);
+        }
+    }
+
     /**
      * Scope stack.
      *
@@ -106,7 +216,7 @@ struct JSONSerialiser::State {
                 return false;
         }
 
-        this->scopes.emplace_back(type, *value);
+        pushScope(type, *value);
         return true;
     }
 
@@ -123,7 +233,7 @@ struct JSONSerialiser::State {
         } else {
             check(!scope.value.HasMember(name));
             scope.value.AddMember(rapidjson::StringRef(name), value, this->document.GetAllocator());
-            rapidjson::Value &ret = scope.value[name];
+            rapidjson::Value &ret = (scope.value.MemberEnd() - 1)->value;
             return ret;
         }
     }
@@ -139,10 +249,7 @@ struct JSONSerialiser::State {
 
             return &scope.value[scope.nextIndex++];
         } else {
-            if (!scope.value.HasMember(name))
-                return nullptr;
-
-            return &scope.value[name];
+            return scope.findMember(name);
         }
     }
 };
@@ -194,7 +301,7 @@ uint32_t JSONSerialiser::addObject(const Object *object) {
     value.AddMember("objectID", id, m_state->document.GetAllocator());
 
     /* Serialise the object in a new scope. */
-    m_state->scopes.emplace_back(State::Scope::kObject, value);
+    m_state->pushScope(State::Scope::kObject, value);
     serialiseObject(object);
     m_state->scopes.pop_back();
 
@@ -202,22 +309,47 @@ uint32_t JSONSerialiser::addObject(const Object *object) {
 }
 
 /** Deserialise an object.
- * @param data          Serialised data array.
+ * @param data          Serialised data.
+ * @param size          Size of the serialised data.
  * @param metaClass     Expected type of the object.
  * @return              Pointer to deserialised object, or null on failure. */
-ObjectPtr<Object> JSONSerialiser::deserialise(const std::vector<uint8_t> &data, const MetaClass &metaClass) {
-    State state;
+ObjectPtr<Object> JSONSerialiser::deserialise(const void *data, size_t size, const MetaClass &metaClass) {
+    /* The document is parsed in-situ, so we must copy read-only data. */
+    std::unique_ptr<char[]> buffer(new char[size + 1]);
+    memcpy(buffer.get(), data, size);
+    buffer[size] = 0;
+
+    return deserialiseInSitu(buffer.get(), size, metaClass);
+}
+
+/** Deserialise an object from modifiable data.
+ * @param data          Serialised data, followed by a null byte.
+ * @param size          Size of the serialised data.
+ * @param metaClass     Expected type of the object.
+ * @return              Pointer to deserialised object, or null on failure. */
+ObjectPtr<Object> JSONSerialiser::deserialiseInSitu(void *data, size_t size, const MetaClass &metaClass) {
+    State state(size);
     m_state = &state;
     m_state->writing = false;
 
-    /* Parse the JSON stream. */
-    m_state->document.Parse(reinterpret_cast<const char *>(&data[0]), data.size());
+    m_state->document.ParseInsitu(reinterpret_cast<char *>(data));
     if (m_state->document.HasParseError()) {
         const char *msg = rapidjson::GetParseError_En(m_state->document.GetParseError());
         logError("Parse error in serialised data (at %zu): %s", m_state->document.GetErrorOffset(), msg);
+        m_state = nullptr;
         return nullptr;
     }
 
+    if (!m_state->document.IsArray()) {
+        logError("Serialised data is not an array of objects");
+        m_state = nullptr;
+        return nullptr;
+    }
+
+    /* Start loading all referenced assets up front, so that their file I/O
+     * and preparation overlaps with deserialisation. */
+    m_state->prefetchAssets(m_state->document);
+
     /* The object to return is the first object in the file. */
     ObjectPtr<Object> object = findObject(0, metaClass);
 
@@ -244,12 +376,16 @@ ObjectPtr<Object> JSONSerialiser::findObject(uint32_t id, const MetaClass &metaC
 
     rapidjson::Value &value = m_state->document[id];
 
-    if (!value.HasMember("objectClass")) {
+    rapidjson::Value::MemberIterator classMember;
+    if (!value.IsObject() ||
+        (classMember = value.FindMember("objectClass")) == value.MemberEnd() ||
+        !classMember->value.IsString())
+    {
         logError("Serialised object %zu does not have an 'objectClass' value", id);
         return nullptr;
     }
 
-    const char *className = value["objectClass"].GetString();
+    const char *className = classMember->value.GetString();
 
     /* The serialised object or any objects it refers to may contain references
      * back to itself. Therefore, to ensure that we don't deserialise the object
@@ -261,7 +397,7 @@ ObjectPtr<Object> JSONSerialiser::findObject(uint32_t id, const MetaClass &metaC
     auto inserted = m_state->idToObjectMap.insert(std::make_pair(id, nullptr));
     check(inserted.second);
 
-    m_state->scopes.emplace_back(State::Scope::kObject, value);
+    m_state->pushScope(State::Scope::kObject, value);
     bool success = deserialiseObject(className, metaClass, id == 0, inserted.first->second);
     m_state->scopes.pop_back();
 
@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               DDS texture file support.
+ */
+
+#include "core/log.h"
+
+#include "dds_file.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+/** DDS file magic number. */
+static const char kDDSMagic[4] = { 'D', 'D', 'S', ' ' };
+
+/** DDS header flags. */
+static const uint32_t kDDSDCaps         = 0x1;
+static const uint32_t kDDSDHeight       = 0x2;
+static const uint32_t kDDSDWidth        = 0x4;
+static const uint32_t kDDSDPixelFormat  = 0x1000;
+static const uint32_t kDDSDMipMapCount  = 0x20000;
+static const uint32_t kDDSDLinearSize   = 0x80000;
+static const uint32_t kDDSDDepth        = 0x800000;
+
+/** DDS pixel format flags. */
+static const uint32_t kDDPFFourCC       = 0x4;
+static const uint32_t kDDPFRGB          = 0x40;
+
+/** DDS capability flags. */
+static const uint32_t kDDSCapsComplex   = 0x8;
+static const uint32_t kDDSCapsTexture   = 0x1000;
+static const uint32_t kDDSCapsMipMap    = 0x400000;
+static const uint32_t kDDSCaps2CubeMap  = 0x200;
+static const uint32_t kDDSCaps2Volume   = 0x200000;
+
+/** DX10 extended header resource dimension for 2D textures. */
+static const uint32_t kDDSDimensionTexture2D = 3;
+
+/** Make a FourCC value. */
+#define DDS_FOURCC(a, b, c, d) \
+    (static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | \
+     (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24))
+
+#pragma pack(push, 1)
+
+/** DDS pixel format structure. */
+struct DDSPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+/** DDS file header (following the magic number). */
+struct DDSHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+/** DX10 extended header (following DDSHeader if the FourCC is "DX10"). */
+struct DDSHeaderDX10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(kDDSMagic) + sizeof(DDSHeader) + sizeof(DDSHeaderDX10) == kDDSMaxHeaderSize,
+              "DDS header size is incorrect");
+
+/** Mapping between DXGI formats and pixel formats. */
+static const struct {
+    uint32_t dxgiFormat;
+    PixelFormat format;
+} kDXGIFormats[] = {
+    { 28, PixelFormat::kR8G8B8A8 },
+    { 29, PixelFormat::kR8G8B8A8sRGB },
+    { 71, PixelFormat::kBC1 },
+    { 72, PixelFormat::kBC1sRGB },
+    { 77, PixelFormat::kBC3 },
+    { 78, PixelFormat::kBC3sRGB },
+    { 80, PixelFormat::kBC4 },
+    { 83, PixelFormat::kBC5 },
+    { 87, PixelFormat::kB8G8R8A8 },
+    { 91, PixelFormat::kB8G8R8A8sRGB },
+    { 98, PixelFormat::kBC7 },
+    { 99, PixelFormat::kBC7sRGB },
+};
+
+/** Get the pixel format for a legacy DDS pixel format.
+ * @param ddsFormat     DDS pixel format.
+ * @return              Pixel format, or PixelFormat::kUnknown. */
+static PixelFormat convertLegacyFormat(const DDSPixelFormat &ddsFormat) {
+    if (ddsFormat.flags & kDDPFFourCC) {
+        switch (ddsFormat.fourCC) {
+            case DDS_FOURCC('D', 'X', 'T', '1'):
+                return PixelFormat::kBC1;
+            case DDS_FOURCC('D', 'X', 'T', '5'):
+                return PixelFormat::kBC3;
+            case DDS_FOURCC('A', 'T', 'I', '1'):
+            case DDS_FOURCC('B', 'C', '4', 'U'):
+                return PixelFormat::kBC4;
+            case DDS_FOURCC('A', 'T', 'I', '2'):
+            case DDS_FOURCC('B', 'C', '5', 'U'):
+                return PixelFormat::kBC5;
+        }
+    } else if (ddsFormat.flags & kDDPFRGB && ddsFormat.rgbBitCount == 32) {
+        if (ddsFormat.rBitMask == 0x000000ff &&
+            ddsFormat.gBitMask == 0x0000ff00 &&
+            ddsFormat.bBitMask == 0x00ff0000)
+        {
+            return PixelFormat::kR8G8B8A8;
+        } else if (ddsFormat.rBitMask == 0x00ff0000 &&
+                   ddsFormat.gBitMask == 0x0000ff00 &&
+                   ddsFormat.bBitMask == 0x000000ff)
+        {
+            return PixelFormat::kB8G8R8A8;
+        }
+    }
+
+    return PixelFormat::kUnknown;
+}
+
+/** Check whether data is a DDS texture.
+ * @param data          Data to check (at least the start of the file).
+ * @param size          Size of the data.
+ * @return              Whether the data has a DDS header. */
+bool isDDSTexture(const void *data, size_t size) {
+    return size >= sizeof(kDDSMagic) + sizeof(DDSHeader) &&
+           memcmp(data, kDDSMagic, sizeof(kDDSMagic)) == 0;
+}
+
+/**
+ * Parse a DDS file header.
+ *
+ * Parses the header of a DDS file and determines the layout of the image data
+ * that follows it. The data for each mip level is stored consecutively from
+ * the largest, with the size of each given by PixelFormat::imageSize(). This
+ * does not check that the file is large enough to hold the image data.
+ *
+ * @param path          Path to the file (for error messages).
+ * @param data          Start of the file data (at least kDDSMaxHeaderSize
+ *                      bytes if available).
+ * @param size          Size of the data.
+ * @param maxSize       Maximum supported width and height of the texture.
+ * @param texture       Where to store texture description.
+ *
+ * @return              Whether the header is valid and supported.
+ */
+bool parseDDSHeader(const char *path, const void *data, size_t size, uint32_t maxSize, DDSTexture &texture) {
+    if (!isDDSTexture(data, size)) {
+        logError("%s: Data is not a DDS texture", path);
+        return false;
+    }
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+
+    DDSHeader header;
+    memcpy(&header, bytes + sizeof(kDDSMagic), sizeof(header));
+
+    if (header.size != sizeof(DDSHeader) || header.pixelFormat.size != sizeof(DDSPixelFormat)) {
+        logError("%s: DDS header is invalid", path);
+        return false;
+    } else if (header.caps2 & (kDDSCaps2CubeMap | kDDSCaps2Volume) || (header.flags & kDDSDDepth && header.depth > 1)) {
+        logError("%s: Cube map and volume DDS textures are not supported", path);
+        return false;
+    } else if (!header.width || !header.height) {
+        logError("%s: DDS texture has invalid dimensions", path);
+        return false;
+    } else if (header.width > maxSize || header.height > maxSize) {
+        logError("%s: DDS texture dimensions %ux%u exceed maximum of %u", path, header.width, header.height, maxSize);
+        return false;
+    }
+
+    texture.width      = header.width;
+    texture.height     = header.height;
+    texture.mips       = (header.flags & kDDSDMipMapCount) ? std::max(header.mipMapCount, 1u) : 1;
+    texture.dataOffset = sizeof(kDDSMagic) + sizeof(DDSHeader);
+
+    if (header.pixelFormat.flags & kDDPFFourCC && header.pixelFormat.fourCC == DDS_FOURCC('D', 'X', '1', '0')) {
+        if (size < kDDSMaxHeaderSize) {
+            logError("%s: DDS header is invalid", path);
+            return false;
+        }
+
+        DDSHeaderDX10 headerDX10;
+        memcpy(&headerDX10, bytes + texture.dataOffset, sizeof(headerDX10));
+        texture.dataOffset += sizeof(headerDX10);
+
+        if (headerDX10.resourceDimension != kDDSDimensionTexture2D || headerDX10.arraySize > 1 || headerDX10.miscFlag) {
+            logError("%s: Only single 2D DDS textures are supported", path);
+            return false;
+        }
+
+        texture.format         = PixelFormat::kUnknown;
+        texture.hasColourSpace = true;
+
+        for (const auto &entry : kDXGIFormats) {
+            if (entry.dxgiFormat == headerDX10.dxgiFormat) {
+                texture.format = entry.format;
+                break;
+            }
+        }
+
+        if (texture.format == PixelFormat::kUnknown) {
+            logError("%s: Unsupported DDS format (%u)", path, headerDX10.dxgiFormat);
+            return false;
+        }
+    } else {
+        texture.format         = convertLegacyFormat(header.pixelFormat);
+        texture.hasColourSpace = false;
+
+        if (texture.format == PixelFormat::kUnknown) {
+            logError("%s: Unsupported DDS format", path);
+            return false;
+        }
+    }
+
+    /* Mip levels down to 1x1 at most. */
+    uint32_t maxMips = 1;
+    while ((texture.width >> maxMips) || (texture.height >> maxMips))
+        maxMips++;
+
+    if (texture.mips > maxMips) {
+        logError("%s: DDS texture has too many mip levels (%u)", path, texture.mips);
+        return false;
+    }
+
+    texture.dataSize = 0;
+    for (uint32_t mip = 0; mip < texture.mips; mip++) {
+        uint32_t mipWidth  = std::max(texture.width >> mip, 1u);
+        uint32_t mipHeight = std::max(texture.height >> mip, 1u);
+        texture.dataSize += PixelFormat::imageSize(texture.format, mipWidth, mipHeight);
+    }
+
+    return true;
+}
+
+/**
+ * Write a DDS file header.
+ *
+ * Writes a DDS file header for a texture to the start of an output buffer.
+ * The DX10 extended header is always used, so that the colour space of the
+ * data is recorded. The data offset and size in the texture description are
+ * set, and the image data for each mip level should be appended to the output
+ * following the header.
+ *
+ * @param texture       Texture description (format, dimensions and mips).
+ * @param output        Output buffer (replaced with the header).
+ */
+void writeDDSHeader(DDSTexture &texture, std::vector<uint8_t> &output) {
+    uint32_t dxgiFormat = 0;
+    for (const auto &entry : kDXGIFormats) {
+        if (entry.format == texture.format) {
+            dxgiFormat = entry.dxgiFormat;
+            break;
+        }
+    }
+
+    check(dxgiFormat);
+
+    texture.hasColourSpace = true;
+    texture.dataOffset     = kDDSMaxHeaderSize;
+    texture.dataSize       = 0;
+
+    for (uint32_t mip = 0; mip < texture.mips; mip++) {
+        uint32_t mipWidth  = std::max(texture.width >> mip, 1u);
+        uint32_t mipHeight = std::max(texture.height >> mip, 1u);
+        texture.dataSize += PixelFormat::imageSize(texture.format, mipWidth, mipHeight);
+    }
+
+    DDSHeader header = {};
+    header.size                    = sizeof(header);
+    header.flags                   = kDDSDCaps | kDDSDHeight | kDDSDWidth | kDDSDPixelFormat | kDDSDMipMapCount;
+    header.height                  = texture.height;
+    header.width                   = texture.width;
+    header.mipMapCount             = texture.mips;
+    header.pixelFormat.size        = sizeof(header.pixelFormat);
+    header.pixelFormat.flags       = kDDPFFourCC;
+    header.pixelFormat.fourCC      = DDS_FOURCC('D', 'X', '1', '0');
+    header.caps                    = kDDSCapsTexture;
+
+    if (PixelFormat::isCompressed(texture.format)) {
+        header.flags             |= kDDSDLinearSize;
+        header.pitchOrLinearSize  = PixelFormat::imageSize(texture.format, texture.width, texture.height);
+    }
+
+    if (texture.mips > 1)
+        header.caps |= kDDSCapsComplex | kDDSCapsMipMap;
+
+    DDSHeaderDX10 headerDX10 = {};
+    headerDX10.dxgiFormat        = dxgiFormat;
+    headerDX10.resourceDimension = kDDSDimensionTexture2D;
+    headerDX10.arraySize         = 1;
+
+    output.resize(kDDSMaxHeaderSize);
+    memcpy(&output[0], kDDSMagic, sizeof(kDDSMagic));
+    memcpy(&output[sizeof(kDDSMagic)], &header, sizeof(header));
+    memcpy(&output[sizeof(kDDSMagic) + sizeof(header)], &headerDX10, sizeof(headerDX10));
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               DDS texture file support.
+ *
+ * DDS files are used to store textures with pre-built mip levels, usually in a
+ * block compressed format, so that they can be uploaded to the GPU without any
+ * processing. They are produced offline by the texcook tool, and loaded by any
+ * 2D texture loader (see Texture2DLoader).
+ *
+ * Only a subset of the format is supported: single 2D images with any number
+ * of mip levels, in the formats listed in dds_file.cc. Image rows are expected
+ * to be stored in the order that the engine uploads them, i.e. bottom row
+ * first, as with TGA. DDS files produced by other tools usually store the top
+ * row first, and so need to be flipped when they are exported.
+ *
+ * This is separate from the texture loaders so that it can be used by offline
+ * tools without depending on the engine.
+ */
+
+#pragma once
+
+#include "core/pixel_format.h"
+
+#include <vector>
+
+/** Description of a DDS texture. */
+struct DDSTexture {
+    uint32_t width;                     /**< Width of the top mip level. */
+    uint32_t height;                    /**< Height of the top mip level. */
+    uint32_t mips;                      /**< Number of mip levels. */
+    PixelFormat format;                 /**< Format of the image data. */
+
+    /**
+     * Whether the colour space is given by the file.
+     *
+     * Files with the DX10 extended header specify whether the data is sRGB.
+     * Older files do not, in which case format is not an sRGB format and the
+     * colour space must be decided by the user.
+     */
+    bool hasColourSpace;
+
+    size_t dataOffset;                  /**< Offset of the image data in the file. */
+    size_t dataSize;                    /**< Total size of all mip levels. */
+};
+
+/** Maximum size of a DDS file header, including the DX10 extended header. */
+static const size_t kDDSMaxHeaderSize = 148;
+
+extern bool isDDSTexture(const void *data, size_t size);
+extern bool parseDDSHeader(const char *path, const void *data, size_t size, uint32_t maxSize, DDSTexture &texture);
+extern void writeDDSHeader(DDSTexture &texture, std::vector<uint8_t> &output);
@@ -0,0 +1,1388 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Mesh builder class.
+ */
+
+#include "core/log.h"
+
+#include "engine/mesh_format.h"
+
+#include "gpu/index_data.h"
+
+#include "mesh_builder.h"
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <map>
+
+const uint32_t MeshBuilder::kVertexCacheSize;
+
+/** Initialise the mesh builder.
+ * @param path          Path to the mesh (for error messages). */
+MeshBuilder::MeshBuilder(const char *path) :
+    m_path (path)
+{}
+
+/**
+ * Add a vertex attribute.
+ *
+ * Adds a vertex attribute to the mesh. The data type is fixed for a given
+ * semantic.
+ *
+ * @param semantic      Attribute semantic.
+ * @param index         Attribute index.
+ */
+void MeshBuilder::addAttribute(VertexAttribute::Semantic semantic, unsigned index) {
+    m_attributes.emplace_back();
+    Attribute &attribute = m_attributes.back();
+    attribute.semantic   = semantic;
+    attribute.index      = index;
+}
+
+/** Check if the mesh has an attribute.
+ * @param semantic      Attribute semantic.
+ * @param index         Attribute index.
+ * @return              Whether the mesh has the attribute. */
+bool MeshBuilder::hasAttribute(VertexAttribute::Semantic semantic, unsigned index) const {
+    for (const Attribute &attribute : m_attributes) {
+        if (attribute.semantic == semantic && attribute.index == index)
+            return true;
+    }
+
+    return false;
+}
+
+/** Reserve space for vertices.
+ * @param count         Expected number of vertices. */
+void MeshBuilder::reserveVertices(size_t count) {
+    m_vertices.reserve(count);
+}
+
+/**
+ * Add a vertex.
+ *
+ * Adds a new vertex to the mesh. The vertex data must be filled into the
+ * returned structure by the caller. Vertices will be ordered in the order in
+ * which they are specified with this function.
+ *
+ * @param outIndex      Where to store vertex index.
+ */
+MeshBuilder::Vertex &MeshBuilder::addVertex(size_t &outIndex) {
+    outIndex = m_vertices.size();
+
+    m_vertices.emplace_back();
+    return m_vertices.back();
+}
+
+/**
+ * Add a sub-mesh.
+ *
+ * Adds a new sub-mesh to the mesh. The returned descriptor structure must be
+ * filled in with details of the sub-mesh.
+ */
+MeshBuilder::SubMeshDesc &MeshBuilder::addSubMesh() {
+    m_subMeshes.emplace_back();
+    return m_subMeshes.back();
+}
+
+/** Convert a float to half precision.
+ * @param value         Value to convert.
+ * @return              Half precision value, rounded to nearest even. */
+static uint16_t packHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign     = (bits >> 16) & 0x8000;
+    const uint32_t mantissa = bits & 0x7fffff;
+    const int32_t exponent  = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+
+    if (((bits >> 23) & 0xff) == 0xff) {
+        /* Infinity or NaN. */
+        return sign | 0x7c00 | ((mantissa) ? 0x200 : 0);
+    } else if (exponent >= 31) {
+        /* Too large, round to infinity. */
+        return sign | 0x7c00;
+    } else if (exponent <= 0) {
+        /* Too small for a normal half, produce a denormal or zero. */
+        if (exponent < -10)
+            return sign;
+
+        const uint32_t full      = mantissa | 0x800000;
+        const uint32_t shift     = 14 - exponent;
+        const uint32_t remainder = full & ((1u << shift) - 1);
+        const uint32_t halfway   = 1u << (shift - 1);
+
+        uint32_t half = full >> shift;
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+            half++;
+
+        return sign | half;
+    }
+
+    /* A carry from rounding propagates into the exponent, which gives the
+     * correct result (including overflow to infinity). */
+    uint32_t half = (exponent << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        half++;
+
+    return sign | half;
+}
+
+/** Convert a float to a signed normalised fixed-point value.
+ * @param value         Value to convert (clamped to [-1, 1]).
+ * @param bits          Number of bits in the result.
+ * @return              Converted value. */
+static int32_t packSnorm(float value, unsigned bits) {
+    const float scale = static_cast<float>((1 << (bits - 1)) - 1);
+    return static_cast<int32_t>(std::round(glm::clamp(value, -1.0f, 1.0f) * scale));
+}
+
+/** Pack a vector into a signed normalised 10:10:10:2 value.
+ * @param value         Vector to pack (components clamped to [-1, 1]).
+ * @return              Packed value. */
+static uint32_t packSnorm1010102(const glm::vec4 &value) {
+    return ((packSnorm(value.x, 10) & 0x3ff) << 0) |
+           ((packSnorm(value.y, 10) & 0x3ff) << 10) |
+           ((packSnorm(value.z, 10) & 0x3ff) << 20) |
+           ((packSnorm(value.w, 2) & 0x3) << 30);
+}
+
+/**
+ * Build cooked mesh data.
+ *
+ * This should be called once all details of the mesh have been filled in. It
+ * lays out all vertex attributes interleaved in a single vertex stream, and
+ * the indices for all submeshes and their levels of detail in a single index
+ * buffer, using 16-bit indices when the mesh is small enough. Bounding boxes
+ * are calculated for each submesh.
+ *
+ * By default, vertex attributes are stored as full precision floats. Flags can
+ * be specified to store them in more compact formats, reducing the size of the
+ * vertex data (and therefore memory usage and vertex fetch bandwidth) to half
+ * or less. Packed normals and tangents have around 3 decimal digits of
+ * precision, which is sufficient for lighting as they are renormalised in the
+ * fragment shader. Half float texture coordinates lose precision as their
+ * magnitude increases, so are not suitable for heavily tiled textures.
+ * Quantised positions are dequantised by the transformation given in the mesh
+ * header, so the precision is relative to the size of the whole mesh.
+ *
+ * @param output        Where to store cooked mesh data.
+ * @param flags         Flags controlling the vertex format (kPackAttributes
+ *                      and kQuantisePositions).
+ *
+ * @return              Whether the mesh was built successfully.
+ */
+bool MeshBuilder::build(std::vector<uint8_t> &output, uint32_t flags) const {
+    if (!m_attributes.size()) {
+        logError("%s: No attributes defined", m_path);
+        return false;
+    } else if (!m_vertices.size()) {
+        logError("%s: No vertices defined", m_path);
+        return false;
+    } else if (!m_subMeshes.size()) {
+        logError("%s: No sub-meshes defined", m_path);
+        return false;
+    }
+
+    MeshHeader header;
+    memcpy(header.magic, kMeshMagic, sizeof(header.magic));
+    header.version     = kMeshVersion;
+    header.numVertices = m_vertices.size();
+
+    /* Encodings of attribute data in the vertex stream. */
+    enum class Encoding {
+        kFloat,
+        kHalfFloat,
+        kSnorm16,
+        kSnorm1010102,
+    };
+
+    /* Lay out the attributes in the vertex stream, in the order in which they
+     * were added. */
+    std::vector<MeshAttribute> attributes;
+    std::vector<size_t> sourceOffsets;
+    std::vector<Encoding> encodings;
+    attributes.reserve(m_attributes.size());
+    sourceOffsets.reserve(m_attributes.size());
+    encodings.reserve(m_attributes.size());
+
+    const bool packAttributes    = flags & kPackAttributes;
+    const bool quantisePositions = flags & kQuantisePositions;
+
+    uint32_t stride = 0;
+    for (const Attribute &attribute : m_attributes) {
+        MeshAttribute desc;
+        desc.semantic   = attribute.semantic;
+        desc.index      = attribute.index;
+        desc.type       = VertexAttribute::kFloatType;
+        desc.normalised = false;
+        desc.offset     = stride;
+
+        Encoding encoding = Encoding::kFloat;
+
+        switch (attribute.semantic) {
+            case VertexAttribute::kPositionSemantic:
+                check(attribute.index == 0);
+
+                if (quantisePositions) {
+                    /* 4 components to keep the attribute 4 byte aligned, the
+                     * W component is unused. */
+                    desc.type       = VertexAttribute::kShortType;
+                    desc.normalised = true;
+                    desc.components = 4;
+                    encoding        = Encoding::kSnorm16;
+                } else {
+                    desc.components = 3;
+                }
+
+                sourceOffsets.push_back(offsetof(Vertex, position));
+                break;
+
+            case VertexAttribute::kNormalSemantic:
+                check(attribute.index == 0);
+
+                if (packAttributes) {
+                    desc.type       = VertexAttribute::kInt1010102Type;
+                    desc.normalised = true;
+                    desc.components = 4;
+                    encoding        = Encoding::kSnorm1010102;
+                } else {
+                    desc.components = 3;
+                }
+
+                sourceOffsets.push_back(offsetof(Vertex, normal));
+                break;
+
+            case VertexAttribute::kTexcoordSemantic:
+                check(attribute.index == 0);
+
+                if (packAttributes) {
+                    desc.type = VertexAttribute::kHalfFloatType;
+                    encoding  = Encoding::kHalfFloat;
+                }
+
+                desc.components = 2;
+                sourceOffsets.push_back(offsetof(Vertex, texcoord));
+                break;
+
+            case VertexAttribute::kTangentSemantic:
+                check(attribute.index == 0);
+
+                if (packAttributes) {
+                    desc.type       = VertexAttribute::kInt1010102Type;
+                    desc.normalised = true;
+                    encoding        = Encoding::kSnorm1010102;
+                }
+
+                desc.components = 4;
+                sourceOffsets.push_back(offsetof(Vertex, tangent));
+                break;
+
+            default:
+                fatal("Unhandled attribute semantic %d", attribute.semantic);
+
+        }
+
+        stride += VertexAttribute::size(static_cast<VertexAttribute::Type>(desc.type), desc.components);
+        attributes.push_back(desc);
+        encodings.push_back(encoding);
+    }
+
+    header.vertexStride  = stride;
+    header.numAttributes = attributes.size();
+
+    /* Quantised positions are relative to the centre of the mesh's bounding
+     * box, scaled uniformly by its largest half-extent so that normals and
+     * tangents are unaffected by the dequantisation transform. */
+    glm::vec3 positionOffset(0.0f);
+    float positionScale = 1.0f;
+
+    if (quantisePositions) {
+        glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+        for (const Vertex &vertex : m_vertices) {
+            minimum = glm::min(minimum, vertex.position);
+            maximum = glm::max(maximum, vertex.position);
+        }
+
+        const glm::vec3 extent = (maximum - minimum) * 0.5f;
+
+        positionOffset = (minimum + maximum) * 0.5f;
+        positionScale  = std::max(extent.x, std::max(extent.y, extent.z));
+
+        if (positionScale <= 0.0f)
+            positionScale = 1.0f;
+    }
+
+    memcpy(header.positionOffset, glm::value_ptr(positionOffset), sizeof(header.positionOffset));
+    header.positionScale = positionScale;
+
+    /* Use 16-bit indices if the mesh is small enough, to halve the index
+     * buffer size. */
+    const bool shortIndices = m_vertices.size() <= std::numeric_limits<uint16_t>::max() + 1;
+    header.indexType = (shortIndices)
+        ? GPUIndexData::kUnsignedShortType
+        : GPUIndexData::kUnsignedIntType;
+
+    const size_t indexSize = GPUIndexData::elementSize(static_cast<GPUIndexData::Type>(header.indexType));
+
+    /* Build the submesh, LOD and cluster arrays and material string table.
+     * Each submesh's LODs follow its full detail indices in the index data. */
+    std::vector<MeshSubMesh> subMeshes;
+    std::vector<MeshLOD> lods;
+    std::vector<MeshCluster> clusters;
+    subMeshes.reserve(m_subMeshes.size());
+
+    std::string strings;
+    std::map<std::string, uint32_t> materialOffsets;
+
+    size_t numIndices = 0;
+    for (const SubMeshDesc &desc : m_subMeshes) {
+        MeshSubMesh subMesh;
+
+        auto ret = materialOffsets.insert(std::make_pair(desc.material, strings.size()));
+        if (ret.second)
+            strings.append(desc.material.c_str(), desc.material.length() + 1);
+
+        subMesh.material   = ret.first->second;
+        subMesh.firstIndex = numIndices;
+        subMesh.numIndices = desc.indices.size();
+
+        BoundingBox boundingBox = calculateBoundingBox(desc.indices);
+        memcpy(subMesh.minimum, glm::value_ptr(boundingBox.minimum), sizeof(subMesh.minimum));
+        memcpy(subMesh.maximum, glm::value_ptr(boundingBox.maximum), sizeof(subMesh.maximum));
+
+        subMesh.firstCluster = clusters.size();
+        subMesh.numClusters  = desc.clusters.size();
+
+        for (const ClusterDesc &clusterDesc : desc.clusters) {
+            MeshCluster cluster;
+            cluster.firstIndex = subMesh.firstIndex + clusterDesc.firstIndex;
+            cluster.numIndices = clusterDesc.numIndices;
+            cluster.radius     = clusterDesc.bounds.radius;
+            cluster.coneCutoff = clusterDesc.coneCutoff;
+            memcpy(cluster.centre, glm::value_ptr(clusterDesc.bounds.centre), sizeof(cluster.centre));
+            memcpy(cluster.coneApex, glm::value_ptr(clusterDesc.coneApex), sizeof(cluster.coneApex));
+            memcpy(cluster.coneAxis, glm::value_ptr(clusterDesc.coneAxis), sizeof(cluster.coneAxis));
+
+            clusters.push_back(cluster);
+        }
+
+        numIndices += desc.indices.size();
+
+        subMesh.firstLOD = lods.size();
+        subMesh.numLODs  = desc.lods.size();
+
+        for (const LODDesc &lodDesc : desc.lods) {
+            MeshLOD lod;
+            lod.firstIndex = numIndices;
+            lod.numIndices = lodDesc.indices.size();
+            lod.error      = lodDesc.error;
+
+            lods.push_back(lod);
+            numIndices += lodDesc.indices.size();
+        }
+
+        subMeshes.push_back(subMesh);
+    }
+
+    header.numIndices   = numIndices;
+    header.numSubMeshes = subMeshes.size();
+    header.numLODs      = lods.size();
+    header.numClusters  = clusters.size();
+
+    /* Lay out the file. */
+    size_t size = sizeof(MeshHeader);
+    header.attributesOffset = size;
+    size += attributes.size() * sizeof(MeshAttribute);
+    size = Math::roundUp(size, kMeshVertexAlignment);
+    header.verticesOffset = size;
+    size += m_vertices.size() * stride;
+    size = Math::roundUp(size, 4);
+    header.indicesOffset = size;
+    size += numIndices * indexSize;
+    size = Math::roundUp(size, 4);
+    header.subMeshesOffset = size;
+    size += subMeshes.size() * sizeof(MeshSubMesh);
+    header.lodsOffset = size;
+    size += lods.size() * sizeof(MeshLOD);
+    header.clustersOffset = size;
+    size += clusters.size() * sizeof(MeshCluster);
+    header.stringsOffset = size;
+    header.stringsSize = strings.size();
+    size += strings.size();
+
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        logError("%s: Mesh is too large", m_path);
+        return false;
+    }
+
+    output.assign(size, 0);
+
+    memcpy(&output[0], &header, sizeof(header));
+    memcpy(&output[header.attributesOffset], attributes.data(), attributes.size() * sizeof(MeshAttribute));
+    memcpy(&output[header.subMeshesOffset], subMeshes.data(), subMeshes.size() * sizeof(MeshSubMesh));
+    memcpy(&output[header.lodsOffset], lods.data(), lods.size() * sizeof(MeshLOD));
+    memcpy(&output[header.clustersOffset], clusters.data(), clusters.size() * sizeof(MeshCluster));
+    memcpy(&output[header.stringsOffset], strings.data(), strings.size());
+
+    /* Interleave the vertex data, converting to the stored format. */
+    const float inverseScale = 1.0f / positionScale;
+
+    uint8_t *dest = &output[header.verticesOffset];
+    for (const Vertex &vertex : m_vertices) {
+        const uint8_t *source = reinterpret_cast<const uint8_t *>(&vertex);
+
+        for (size_t i = 0; i < attributes.size(); i++) {
+            const MeshAttribute &attribute = attributes[i];
+            const float *value = reinterpret_cast<const float *>(&source[sourceOffsets[i]]);
+            uint8_t *attribDest = &dest[attribute.offset];
+
+            switch (encodings[i]) {
+                case Encoding::kFloat:
+                    memcpy(attribDest, value, attribute.components * sizeof(float));
+                    break;
+
+                case Encoding::kHalfFloat:
+                    for (size_t j = 0; j < attribute.components; j++) {
+                        const uint16_t half = packHalf(value[j]);
+                        memcpy(&attribDest[j * sizeof(half)], &half, sizeof(half));
+                    }
+
+                    break;
+
+                case Encoding::kSnorm16:
+                {
+                    /* Only used for positions. */
+                    const glm::vec3 position = (vertex.position - positionOffset) * inverseScale;
+                    const int16_t packed[4] = {
+                        static_cast<int16_t>(packSnorm(position.x, 16)),
+                        static_cast<int16_t>(packSnorm(position.y, 16)),
+                        static_cast<int16_t>(packSnorm(position.z, 16)),
+                        0
+                    };
+
+                    memcpy(attribDest, packed, sizeof(packed));
+                    break;
+                }
+
+                case Encoding::kSnorm1010102:
+                {
+                    /* Normals have no W component, leave it as 0. */
+                    const glm::vec4 vector(value[0], value[1], value[2],
+                                           (attribute.semantic == VertexAttribute::kTangentSemantic)
+                                               ? value[3]
+                                               : 0.0f);
+
+                    const uint32_t packed = packSnorm1010102(vector);
+                    memcpy(attribDest, &packed, sizeof(packed));
+                    break;
+                }
+            }
+        }
+
+        dest += stride;
+    }
+
+    /* Write the index data. */
+    dest = &output[header.indicesOffset];
+
+    auto writeIndices =
+        [&] (const std::vector<uint32_t> &source) {
+            if (shortIndices) {
+                uint16_t *indices = reinterpret_cast<uint16_t *>(dest);
+                for (uint32_t index : source)
+                    *indices++ = index;
+            } else {
+                memcpy(dest, source.data(), source.size() * sizeof(uint32_t));
+            }
+
+            dest += source.size() * indexSize;
+        };
+
+    for (const SubMeshDesc &desc : m_subMeshes) {
+        writeIndices(desc.indices);
+
+        for (const LODDesc &lod : desc.lods)
+            writeIndices(lod.indices);
+    }
+
+    logDebug("%s: %u vertices, %u byte stride, %zu bytes of vertex data",
+             m_path, header.numVertices, stride, m_vertices.size() * stride);
+
+    return true;
+}
+
+/** Calculate a bounding box.
+ * @param indices       Indices of the sub-mesh.
+ * @return              Calculated bounding box. */
+BoundingBox MeshBuilder::calculateBoundingBox(const std::vector<uint32_t> &indices) const {
+    BoundingBox boundingBox(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+
+    for (uint32_t index : indices) {
+        check(index < m_vertices.size());
+        const Vertex &vertex = m_vertices[index];
+
+        boundingBox.minimum = glm::min(boundingBox.minimum, vertex.position);
+        boundingBox.maximum = glm::max(boundingBox.maximum, vertex.position);
+    }
+
+    return boundingBox;
+}
+
+/** Calculate tangents for the mesh if it does not already have them. */
+void MeshBuilder::calculateTangents() {
+    if (hasAttribute(VertexAttribute::kTangentSemantic, 0))
+        return;
+
+    /* Add an attribute for it. */
+    addAttribute(VertexAttribute::kTangentSemantic, 0);
+
+    /*
+     * Tangent/bitangent vector calculation based on Eric Lengyel's method.
+     * Original web page appears to have disappeared, copy here:
+     * https://fenix.tecnico.ulisboa.pt/downloadFile/845043405449073/Tangent%20Space%20Calculation.pdf
+     */
+
+    std::vector<glm::vec3> tangents(m_vertices.size(), glm::vec3(0.0));
+    std::vector<glm::vec3> bitangents(m_vertices.size(), glm::vec3(0.0));
+
+    for (const SubMeshDesc &subMesh : m_subMeshes) {
+        for (size_t i = 0; i < subMesh.indices.size(); i += 3) {
+            const uint32_t i0 = subMesh.indices[i + 0];
+            const uint32_t i1 = subMesh.indices[i + 1];
+            const uint32_t i2 = subMesh.indices[i + 2];
+
+            const glm::vec3 &p0  = m_vertices[i0].position;
+            const glm::vec3 &p1  = m_vertices[i1].position;
+            const glm::vec3 &p2  = m_vertices[i2].position;
+
+            const glm::vec2 &uv0 = m_vertices[i0].texcoord;
+            const glm::vec2 &uv1 = m_vertices[i1].texcoord;
+            const glm::vec2 &uv2 = m_vertices[i2].texcoord;
+
+            const float x1 = p1.x - p0.x;
+            const float x2 = p2.x - p0.x;
+            const float y1 = p1.y - p0.y;
+            const float y2 = p2.y - p0.y;
+            const float z1 = p1.z - p0.z;
+            const float z2 = p2.z - p0.z;
+
+            const float s1 = uv1.x - uv0.x;
+            const float s2 = uv2.x - uv0.x;
+            const float t1 = uv1.y - uv0.y;
+            const float t2 = uv2.y - uv0.y;
+
+            const float r = 1.0f / (s1 * t2 - s2 * t1);
+
+            const glm::vec3 sdir((t2 * x1 - t1 * x2) * r,
+                                 (t2 * y1 - t1 * y2) * r,
+                                 (t2 * z1 - t1 * z2) * r);
+            const glm::vec3 tdir((s1 * x2 - s2 * x1) * r,
+                                 (s1 * y2 - s2 * y1) * r,
+                                 (s1 * z2 - s2 * z1) * r);
+
+            tangents[i0] += sdir;
+            tangents[i1] += sdir;
+            tangents[i2] += sdir;
+
+            bitangents[i0] += tdir;
+            bitangents[i1] += tdir;
+            bitangents[i2] += tdir;
+        }
+    }
+
+    for (size_t i = 0; i < m_vertices.size(); i++) {
+        Vertex &vertex = m_vertices[i];
+
+        const glm::vec3 &n = vertex.normal;
+        const glm::vec3 &t = tangents[i];
+
+        /* Gram-Schmidt orthogonalize. */
+        const glm::vec3 tangent = glm::normalize(t - n * glm::dot(n, t));
+
+        /* Calculate handedness of the bitanget, stored in the W component of
+         * the tangent vector and is used to calculate the bitangent vector
+         * without having to store it separately. */
+        const float handedness = (glm::dot(glm::cross(n, t), bitangents[i]) < 0.0f) ? -1.0f : 1.0f;
+
+        vertex.tangent = glm::vec4(tangent, handedness);
+    }
+}
+
+/**
+ * Generate simplified levels of detail.
+ *
+ * Generates a chain of progressively simplified versions of each submesh using
+ * MeshSimplifier, each with approximately the given fraction of the triangles
+ * of the previous one. The simplified versions use a subset of the mesh's
+ * vertices, so only require additional index data. Generation stops early for
+ * a submesh if simplification cannot make significant progress, e.g. because
+ * the submesh is already very simple or is mostly made up of seams and
+ * borders, so some submeshes may have fewer levels of detail than requested.
+ *
+ * @param count         Maximum number of levels of detail to generate for each
+ *                      submesh (not including the full detail submesh).
+ * @param reduction     Fraction of the triangles of the previous level to
+ *                      target for each level.
+ */
+void MeshBuilder::generateLODs(unsigned count, float reduction) {
+    /* Minimum reduction in triangles for a new level to be worthwhile. */
+    static const float kMinReduction = 0.85f;
+
+    check(reduction > 0.0f && reduction < 1.0f);
+
+    for (SubMeshDesc &subMesh : m_subMeshes) {
+        subMesh.lods.clear();
+
+        MeshSimplifier simplifier(m_vertices, subMesh.indices);
+
+        size_t previous = subMesh.indices.size() / 3;
+        float target = previous;
+
+        for (unsigned i = 0; i < count; i++) {
+            target *= reduction;
+            simplifier.simplify(static_cast<size_t>(target));
+
+            const size_t numTriangles = simplifier.indices().size() / 3;
+            if (!numTriangles || numTriangles > previous * kMinReduction)
+                break;
+
+            subMesh.lods.emplace_back();
+            LODDesc &lod = subMesh.lods.back();
+            lod.indices  = simplifier.indices();
+            lod.error    = simplifier.error();
+
+            logDebug("%s: Submesh '%s' LOD %zu: %zu triangles, error %g",
+                     m_path, subMesh.material.c_str(), subMesh.lods.size(), numTriangles, lod.error);
+
+            previous = numTriangles;
+        }
+    }
+}
+
+/**
+ * Optimise the mesh for rendering.
+ *
+ * Reorders the triangles of each submesh for post-transform vertex cache
+ * locality, using the Tipsify algorithm ("Fast Triangle Reordering for Vertex
+ * Locality and Reduced Overdraw", Sander et al. 2007). The clusters of
+ * triangles produced are then sorted so that those facing outwards from the
+ * centre of the submesh are drawn first, which reduces overdraw from any view
+ * direction. Finally, vertices are reordered by first use to improve vertex
+ * fetch locality, and any unreferenced vertices are removed. Levels of detail
+ * are optimised in the same way, so this should be called after
+ * generateLODs(). Any existing clusters are discarded, as the triangle order
+ * is changed.
+ */
+void MeshBuilder::optimise() {
+    if (!m_vertices.size())
+        return;
+
+    VertexCacheStats before = analyseVertexCache();
+
+    for (SubMeshDesc &subMesh : m_subMeshes) {
+        subMesh.clusters.clear();
+
+        std::vector<uint32_t> clusters;
+        optimiseVertexCache(subMesh.indices, clusters);
+        optimiseOverdraw(subMesh.indices, clusters);
+
+        for (LODDesc &lod : subMesh.lods) {
+            optimiseVertexCache(lod.indices, clusters);
+            optimiseOverdraw(lod.indices, clusters);
+        }
+    }
+
+    optimiseVertexFetch();
+
+    VertexCacheStats after = analyseVertexCache();
+
+    logDebug("%s: Optimised vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+             m_path, before.acmr, after.acmr, before.atvr, after.atvr);
+}
+
+/**
+ * Divide large submeshes into clusters.
+ *
+ * Splits the full detail triangles of each submesh with at least
+ * kMinClusteredTriangles triangles into clusters, so that parts of the submesh
+ * which are outside the view frustum or facing away from the viewer can be
+ * culled individually. Clusters are grown greedily from a seed triangle by
+ * adding triangles connected to it (by position, so that attribute seams do
+ * not prevent growth), preferring those which add the fewest new
+ * vertices and then those which face closest to the cluster's average normal.
+ * They are limited to kClusterMaxTriangles triangles and kClusterMaxVertices
+ * unique vertices, and triangles facing too far from the average normal are
+ * not added, to keep the normal cones narrow enough for back-face culling to
+ * be effective.
+ *
+ * The triangles of each submesh are reordered so that each cluster is a
+ * contiguous range of the index data. Seeds are taken in the existing triangle
+ * order and triangles keep their relative order within a cluster, so this
+ * should be called after optimise() to retain most of its vertex cache
+ * locality.
+ */
+void MeshBuilder::generateClusters() {
+    /* Minimum cosine of the angle between a triangle's normal and the average
+     * normal of the cluster for it to be added. */
+    static const float kMinNormalCosine = 0.7f;
+
+    const uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+
+    /* Cluster that each vertex was last used in, and that each triangle was
+     * last made a candidate for. */
+    std::vector<uint32_t> vertexClusters(m_vertices.size(), kUnused);
+    std::vector<uint32_t> candidateClusters;
+    uint32_t cluster = 0;
+
+    std::vector<uint32_t> positionRemap;
+    calculatePositionRemap(positionRemap);
+
+    for (SubMeshDesc &subMesh : m_subMeshes) {
+        subMesh.clusters.clear();
+
+        const size_t numTriangles = subMesh.indices.size() / 3;
+        if (numTriangles < kMinClusteredTriangles)
+            continue;
+
+        /* Build a map of positions to the triangles using them. */
+        std::vector<uint32_t> adjacencyOffsets(m_vertices.size() + 1, 0);
+        for (uint32_t index : subMesh.indices)
+            adjacencyOffsets[positionRemap[index] + 1]++;
+        for (size_t i = 0; i < m_vertices.size(); i++)
+            adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+
+        std::vector<uint32_t> adjacency(subMesh.indices.size());
+        {
+            std::vector<uint32_t> counts(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < subMesh.indices.size(); i++)
+                adjacency[counts[positionRemap[subMesh.indices[i]]]++] = i / 3;
+        }
+
+        /* Unit normals of each triangle, zero for degenerate triangles. */
+        std::vector<glm::vec3> normals(numTriangles);
+        for (size_t triangle = 0; triangle < numTriangles; triangle++) {
+            const glm::vec3 &p0 = m_vertices[subMesh.indices[(triangle * 3) + 0]].position;
+            const glm::vec3 &p1 = m_vertices[subMesh.indices[(triangle * 3) + 1]].position;
+            const glm::vec3 &p2 = m_vertices[subMesh.indices[(triangle * 3) + 2]].position;
+
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float length = glm::length(normal);
+            if (length > 0.0f)
+                normals[triangle] = normal * (1.0f / length);
+        }
+
+        std::vector<bool> assigned(numTriangles, false);
+        candidateClusters.assign(numTriangles, kUnused);
+
+        std::vector<uint32_t> output;
+        output.reserve(subMesh.indices.size());
+
+        std::vector<uint32_t> triangles;
+        std::vector<uint32_t> candidates;
+
+        for (size_t seed = 0; seed < numTriangles; seed++) {
+            if (assigned[seed])
+                continue;
+
+            triangles.clear();
+            candidates.clear();
+
+            size_t numVertices = 0;
+            glm::vec3 clusterNormal(0.0f);
+
+            auto countNewVertices =
+                [&] (uint32_t triangle) {
+                    const uint32_t *indices = &subMesh.indices[triangle * 3];
+
+                    size_t count = 0;
+                    for (size_t j = 0; j < 3; j++) {
+                        if (vertexClusters[indices[j]] != cluster &&
+                            std::find(indices, indices + j, indices[j]) == indices + j)
+                        {
+                            count++;
+                        }
+                    }
+
+                    return count;
+                };
+
+            auto addTriangle =
+                [&] (uint32_t triangle) {
+                    assigned[triangle] = true;
+                    triangles.push_back(triangle);
+                    clusterNormal += normals[triangle];
+
+                    for (size_t j = 0; j < 3; j++) {
+                        const uint32_t index = subMesh.indices[(triangle * 3) + j];
+                        if (vertexClusters[index] == cluster)
+                            continue;
+
+                        vertexClusters[index] = cluster;
+                        numVertices++;
+
+                        const uint32_t position = positionRemap[index];
+                        for (uint32_t k = adjacencyOffsets[position]; k < adjacencyOffsets[position + 1]; k++) {
+                            const uint32_t candidate = adjacency[k];
+
+                            if (!assigned[candidate] && candidateClusters[candidate] != cluster) {
+                                candidateClusters[candidate] = cluster;
+                                candidates.push_back(candidate);
+                            }
+                        }
+                    }
+                };
+
+            addTriangle(seed);
+
+            while (triangles.size() < kClusterMaxTriangles) {
+                const float clusterNormalLength = glm::length(clusterNormal);
+
+                size_t best = candidates.size();
+                size_t bestNewVertices = 0;
+                float bestCosine = 0.0f;
+
+                for (size_t i = 0; i < candidates.size(); i++) {
+                    const uint32_t candidate = candidates[i];
+                    if (assigned[candidate])
+                        continue;
+
+                    const size_t newVertices = countNewVertices(candidate);
+                    if (numVertices + newVertices > kClusterMaxVertices)
+                        continue;
+
+                    /* Degenerate triangles can go anywhere. */
+                    const float cosine = (clusterNormalLength > 0.0f && normals[candidate] != glm::vec3(0.0f))
+                        ? glm::dot(normals[candidate], clusterNormal) / clusterNormalLength
+                        : 1.0f;
+                    if (cosine < kMinNormalCosine)
+                        continue;
+
+                    if (best == candidates.size() ||
+                        newVertices < bestNewVertices ||
+                        (newVertices == bestNewVertices && cosine > bestCosine))
+                    {
+                        best            = i;
+                        bestNewVertices = newVertices;
+                        bestCosine      = cosine;
+                    }
+                }
+
+                if (best == candidates.size())
+                    break;
+
+                addTriangle(candidates[best]);
+            }
+
+            /* Keep the existing order within the cluster. */
+            std::sort(triangles.begin(), triangles.end());
+
+            const size_t start = output.size() / 3;
+            for (uint32_t triangle : triangles)
+                output.insert(output.end(), &subMesh.indices[triangle * 3], &subMesh.indices[(triangle * 3) + 3]);
+
+            subMesh.clusters.push_back(calculateCluster(output, start, output.size() / 3));
+            cluster++;
+        }
+
+        subMesh.indices.swap(output);
+
+        logDebug("%s: Submesh '%s': %zu clusters, %.1f triangles per cluster",
+                 m_path, subMesh.material.c_str(), subMesh.clusters.size(),
+                 static_cast<float>(numTriangles) / subMesh.clusters.size());
+    }
+}
+
+/**
+ * Analyse post-transform vertex cache efficiency.
+ *
+ * Simulates a FIFO vertex cache of kVertexCacheSize entries over the mesh's
+ * submeshes (with the cache being flushed between submeshes, since they are
+ * drawn separately) to determine how many vertices will be transformed.
+ *
+ * @return              Vertex cache statistics. The ACMR is the number of
+ *                      vertices transformed per triangle, and ranges from 0.5
+ *                      (ideal for a large regular grid) to 3. The ATVR is the
+ *                      number of vertices transformed per vertex referenced,
+ *                      where 1 is ideal.
+ */
+MeshBuilder::VertexCacheStats MeshBuilder::analyseVertexCache() const {
+    /* A vertex is in the cache if fewer than kVertexCacheSize vertices have
+     * been added since it was. */
+    std::vector<uint32_t> timestamps(m_vertices.size(), 0);
+    std::vector<bool> referenced(m_vertices.size(), false);
+    uint32_t time = kVertexCacheSize + 1;
+
+    size_t misses = 0, numTriangles = 0, numReferenced = 0;
+
+    for (const SubMeshDesc &subMesh : m_subMeshes) {
+        for (uint32_t index : subMesh.indices) {
+            if (time - timestamps[index] > kVertexCacheSize) {
+                timestamps[index] = time++;
+                misses++;
+            }
+
+            if (!referenced[index]) {
+                referenced[index] = true;
+                numReferenced++;
+            }
+        }
+
+        numTriangles += subMesh.indices.size() / 3;
+        time += kVertexCacheSize + 1;
+    }
+
+    VertexCacheStats stats;
+    stats.acmr = (numTriangles) ? static_cast<float>(misses) / numTriangles : 0.0f;
+    stats.atvr = (numReferenced) ? static_cast<float>(misses) / numReferenced : 0.0f;
+    return stats;
+}
+
+/**
+ * Reorder triangles for vertex cache locality.
+ *
+ * Implements the Tipsify algorithm. This repeatedly chooses a fanning vertex
+ * and emits all of its remaining triangles. The next fanning vertex is chosen
+ * from the vertices of the triangles just emitted, preferring those that will
+ * still be in the cache after their remaining triangles are emitted. If there
+ * are none, recently used vertices with remaining triangles are tried, and
+ * failing that the next vertex with remaining triangles in input order. The
+ * latter breaks locality, so marks the start of a new cluster.
+ *
+ * @param indices       Indices to reorder (replaced with the new order).
+ * @param clusters      Where to store the index of the first triangle of each
+ *                      cluster.
+ */
+void MeshBuilder::optimiseVertexCache(std::vector<uint32_t> &indices, std::vector<uint32_t> &clusters) const {
+    const size_t numVertices  = m_vertices.size();
+    const size_t numTriangles = indices.size() / 3;
+
+    clusters.clear();
+    if (!numTriangles)
+        return;
+
+    /* Build vertex-triangle adjacency. liveCounts holds the number of
+     * triangles using each vertex that have not yet been emitted. */
+    std::vector<uint32_t> liveCounts(numVertices, 0);
+    for (uint32_t index : indices)
+        liveCounts[index]++;
+
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+    for (size_t i = 0; i < numVertices; i++)
+        adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveCounts[i];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    std::vector<uint32_t> timestamps(numVertices, 0);
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    deadEnd.reserve(indices.size());
+    output.reserve(indices.size());
+
+    uint32_t time   = kVertexCacheSize + 1;
+    size_t cursor   = 0;
+    int64_t fanning = indices[0];
+    bool newCluster = true;
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        /* Emit all remaining triangles around the fanning vertex. */
+        for (uint32_t i = adjacencyOffsets[fanning]; i < adjacencyOffsets[fanning + 1]; i++) {
+            const uint32_t triangle = adjacency[i];
+            if (emitted[triangle])
+                continue;
+
+            if (newCluster) {
+                clusters.push_back(output.size() / 3);
+                newCluster = false;
+            }
+
+            for (size_t j = 0; j < 3; j++) {
+                const uint32_t index = indices[(triangle * 3) + j];
+
+                output.push_back(index);
+                deadEnd.push_back(index);
+                candidates.push_back(index);
+                liveCounts[index]--;
+
+                if (time - timestamps[index] > kVertexCacheSize)
+                    timestamps[index] = time++;
+            }
+
+            emitted[triangle] = true;
+        }
+
+        /* Choose the candidate that has been in the cache the longest but
+         * will remain in it after emitting its remaining triangles. */
+        fanning = -1;
+        uint32_t bestPriority = 0;
+        for (uint32_t index : candidates) {
+            if (!liveCounts[index])
+                continue;
+
+            const uint32_t age = time - timestamps[index];
+            if (age + (2 * liveCounts[index]) <= kVertexCacheSize && age > bestPriority) {
+                bestPriority = age;
+                fanning      = index;
+            }
+        }
+
+        if (fanning < 0) {
+            /* Dead end, try recently used vertices. */
+            while (!deadEnd.empty()) {
+                const uint32_t index = deadEnd.back();
+                deadEnd.pop_back();
+
+                if (liveCounts[index]) {
+                    fanning = index;
+                    break;
+                }
+            }
+        }
+
+        if (fanning < 0) {
+            /* Fall back to the next vertex in input order. */
+            while (cursor < indices.size()) {
+                const uint32_t index = indices[cursor++];
+
+                if (liveCounts[index]) {
+                    fanning    = index;
+                    newCluster = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    check(output.size() == indices.size());
+    indices.swap(output);
+}
+
+/**
+ * Reorder triangle clusters to reduce overdraw.
+ *
+ * The clusters produced by optimiseVertexCache() are split further at points
+ * where doing so does not significantly increase the cache miss ratio, to give
+ * finer control over ordering. Clusters are then sorted so that those facing
+ * away from the centre of the submesh come first: these are the most likely to
+ * occlude the rest of the submesh, whatever the view direction.
+ *
+ * @param indices       Indices to reorder (replaced with the new order).
+ * @param clusters      Index of the first triangle of each cluster.
+ */
+void MeshBuilder::optimiseOverdraw(std::vector<uint32_t> &indices, std::vector<uint32_t> &clusters) const {
+    /* Allowed increase in ACMR when splitting clusters. */
+    static const float kThreshold = 1.05f;
+
+    const size_t numTriangles = indices.size() / 3;
+    if (clusters.empty())
+        return;
+
+    std::vector<uint32_t> timestamps(m_vertices.size(), 0);
+    uint32_t time = kVertexCacheSize + 1;
+
+    auto simulateTriangle =
+        [&] (size_t triangle) {
+            uint32_t misses = 0;
+            for (size_t j = 0; j < 3; j++) {
+                const uint32_t index = indices[(triangle * 3) + j];
+                if (time - timestamps[index] > kVertexCacheSize) {
+                    timestamps[index] = time++;
+                    misses++;
+                }
+            }
+
+            return misses;
+        };
+
+    /* Split clusters wherever the ACMR so far is within the threshold of that
+     * of the whole cluster. */
+    std::vector<uint32_t> splitClusters;
+    for (size_t i = 0; i < clusters.size(); i++) {
+        const size_t start = clusters[i];
+        const size_t end   = (i + 1 < clusters.size()) ? clusters[i + 1] : numTriangles;
+
+        time += kVertexCacheSize + 1;
+
+        size_t clusterMisses = 0;
+        for (size_t triangle = start; triangle < end; triangle++)
+            clusterMisses += simulateTriangle(triangle);
+
+        const float clusterACMR = static_cast<float>(clusterMisses) / (end - start);
+
+        time += kVertexCacheSize + 1;
+
+        size_t splitStart = start;
+        size_t misses     = 0;
+
+        splitClusters.push_back(start);
+
+        for (size_t triangle = start; triangle < end; triangle++) {
+            misses += simulateTriangle(triangle);
+
+            const float acmr = static_cast<float>(misses) / (triangle + 1 - splitStart);
+            if (triangle + 1 < end && acmr <= clusterACMR * kThreshold) {
+                splitClusters.push_back(triangle + 1);
+                splitStart = triangle + 1;
+                misses     = 0;
+                time += kVertexCacheSize + 1;
+            }
+        }
+    }
+
+    /* Calculate the centroid of the submesh. */
+    glm::vec3 meshCentroid(0.0f);
+    for (uint32_t index : indices)
+        meshCentroid += m_vertices[index].position;
+
+    meshCentroid = meshCentroid * (1.0f / indices.size());
+
+    /* Calculate a sort key for each cluster from its area-weighted centroid
+     * and normal. */
+    struct Cluster {
+        uint32_t start;
+        uint32_t end;
+        float key;
+    };
+
+    std::vector<Cluster> sorted(splitClusters.size());
+    for (size_t i = 0; i < splitClusters.size(); i++) {
+        Cluster &cluster = sorted[i];
+        cluster.start    = splitClusters[i];
+        cluster.end      = (i + 1 < splitClusters.size()) ? splitClusters[i + 1] : numTriangles;
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+
+        for (size_t triangle = cluster.start; triangle < cluster.end; triangle++) {
+            const glm::vec3 &p0 = m_vertices[indices[(triangle * 3) + 0]].position;
+            const glm::vec3 &p1 = m_vertices[indices[(triangle * 3) + 1]].position;
+            const glm::vec3 &p2 = m_vertices[indices[(triangle * 3) + 2]].position;
+
+            const glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+            const float triangleArea = glm::length(triangleNormal);
+
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal   += triangleNormal;
+            area     += triangleArea;
+        }
+
+        const float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f) {
+            centroid = centroid * (1.0f / area);
+            normal   = normal * (1.0f / normalLength);
+
+            cluster.key = glm::dot(centroid - meshCentroid, normal);
+        } else {
+            cluster.key = 0.0f;
+        }
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [] (const Cluster &a, const Cluster &b) { return a.key > b.key; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (const Cluster &cluster : sorted)
+        output.insert(output.end(), indices.begin() + (cluster.start * 3), indices.begin() + (cluster.end * 3));
+
+    indices.swap(output);
+}
+
+/**
+ * Reorder vertices for vertex fetch locality.
+ *
+ * Vertices are reordered by their first use in the index data, so that
+ * vertices used together are close together in memory. Vertices which are not
+ * referenced by any submesh are removed. Levels of detail only use vertices of
+ * their full detail submesh, so are remapped after all submeshes.
+ */
+void MeshBuilder::optimiseVertexFetch() {
+    const uint32_t kUnassigned = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> remap(m_vertices.size(), kUnassigned);
+    std::vector<Vertex> vertices;
+    vertices.reserve(m_vertices.size());
+
+    auto remapIndices =
+        [&] (std::vector<uint32_t> &indices) {
+            for (uint32_t &index : indices) {
+                if (remap[index] == kUnassigned) {
+                    remap[index] = vertices.size();
+                    vertices.push_back(m_vertices[index]);
+                }
+
+                index = remap[index];
+            }
+        };
+
+    for (SubMeshDesc &subMesh : m_subMeshes)
+        remapIndices(subMesh.indices);
+
+    for (SubMeshDesc &subMesh : m_subMeshes) {
+        for (LODDesc &lod : subMesh.lods)
+            remapIndices(lod.indices);
+    }
+
+    m_vertices.swap(vertices);
+}
+
+/**
+ * Calculate a map of vertices with identical positions.
+ *
+ * @param remap         Where to store the index of the first vertex with the
+ *                      same position as each vertex.
+ */
+void MeshBuilder::calculatePositionRemap(std::vector<uint32_t> &remap) const {
+    std::vector<uint32_t> sorted(m_vertices.size());
+    for (size_t i = 0; i < sorted.size(); i++)
+        sorted[i] = i;
+
+    auto lessThan =
+        [&] (uint32_t a, uint32_t b) {
+            const glm::vec3 &pa = m_vertices[a].position;
+            const glm::vec3 &pb = m_vertices[b].position;
+
+            if (pa.x != pb.x)
+                return pa.x < pb.x;
+            if (pa.y != pb.y)
+                return pa.y < pb.y;
+            if (pa.z != pb.z)
+                return pa.z < pb.z;
+
+            return a < b;
+        };
+
+    std::sort(sorted.begin(), sorted.end(), lessThan);
+
+    remap.resize(m_vertices.size());
+    for (size_t i = 0; i < sorted.size(); ) {
+        const uint32_t first = sorted[i];
+
+        for (; i < sorted.size() && m_vertices[sorted[i]].position == m_vertices[first].position; i++)
+            remap[sorted[i]] = first;
+    }
+}
+
+/**
+ * Calculate the bounds of a cluster.
+ *
+ * The bounding sphere is centred on the cluster's bounding box. The normal
+ * cone axis is the average of the triangle normals, and the cutoff is derived
+ * from the largest angle between the axis and any triangle normal. The apex is
+ * placed behind the planes of all triangles in the cluster along the axis, so
+ * that any view direction from the viewer to the apex within the cone implies
+ * that every triangle is back-facing. If the triangles face in too wide a
+ * range of directions for this to be possible, the cutoff is set to 1 so that
+ * the cluster is never culled.
+ *
+ * @param indices       Indices of the submesh.
+ * @param start         First triangle of the cluster.
+ * @param end           Triangle after the last in the cluster.
+ *
+ * @return              Cluster descriptor.
+ */
+MeshBuilder::ClusterDesc MeshBuilder::calculateCluster(const std::vector<uint32_t> &indices,
+                                                      size_t start,
+                                                      size_t end) const
+{
+    ClusterDesc cluster;
+    cluster.firstIndex = start * 3;
+    cluster.numIndices = (end - start) * 3;
+
+    glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+    for (size_t i = start * 3; i < end * 3; i++) {
+        minimum = glm::min(minimum, m_vertices[indices[i]].position);
+        maximum = glm::max(maximum, m_vertices[indices[i]].position);
+    }
+
+    cluster.bounds.centre = (minimum + maximum) * 0.5f;
+    cluster.bounds.radius = 0.0f;
+    for (size_t i = start * 3; i < end * 3; i++) {
+        cluster.bounds.radius = std::max(cluster.bounds.radius,
+                                         glm::distance(cluster.bounds.centre, m_vertices[indices[i]].position));
+    }
+
+    /* Unit normals of non-degenerate triangles, and their first vertex. */
+    std::vector<std::pair<glm::vec3, glm::vec3>> normals;
+    normals.reserve(end - start);
+
+    glm::vec3 axis(0.0f);
+    for (size_t triangle = start; triangle < end; triangle++) {
+        const glm::vec3 &p0 = m_vertices[indices[(triangle * 3) + 0]].position;
+        const glm::vec3 &p1 = m_vertices[indices[(triangle * 3) + 1]].position;
+        const glm::vec3 &p2 = m_vertices[indices[(triangle * 3) + 2]].position;
+
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(normal);
+        if (length > 0.0f) {
+            normals.emplace_back(normal * (1.0f / length), p0);
+            axis += normals.back().first;
+        }
+    }
+
+    cluster.coneApex   = cluster.bounds.centre;
+    cluster.coneAxis   = glm::vec3(0.0f, 0.0f, 1.0f);
+    cluster.coneCutoff = 1.0f;
+
+    const float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength <= 0.0f)
+        return cluster;
+
+    axis = axis * (1.0f / axisLength);
+
+    float minimumDot = 1.0f;
+    for (const auto &normal : normals)
+        minimumDot = std::min(minimumDot, glm::dot(normal.first, axis));
+
+    /* Normals spread over a hemisphere or more can't be bounded usefully. Add
+     * a little tolerance to the angle to be conservative. */
+    static const float kCutoffTolerance = 1e-3f;
+
+    minimumDot -= kCutoffTolerance;
+    if (minimumDot <= 0.0f)
+        return cluster;
+
+    float apexDistance = 0.0f;
+    for (const auto &normal : normals) {
+        const float distance = glm::dot(cluster.bounds.centre - normal.second, normal.first) /
+                               glm::dot(axis, normal.first);
+        apexDistance = std::max(apexDistance, distance);
+    }
+
+    cluster.coneApex   = cluster.bounds.centre - (axis * apexDistance);
+    cluster.coneAxis   = axis;
+    cluster.coneCutoff = std::sqrt(1.0f - (minimumDot * minimumDot));
+
+    return cluster;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Mesh builder class.
+ */
+
+#pragma once
+
+#include "core/math.h"
+
+#include "gpu/vertex_data.h"
+
+#include <list>
+#include <vector>
+
+/**
+ * Class which builds cooked mesh data.
+ *
+ * This class collects vertex and submesh data produced from a mesh source file
+ * and converts it to the cooked mesh format (see engine/mesh_format.h), which
+ * can be uploaded directly to the GPU. It is used both by MeshLoader when
+ * loading source data, and offline by the meshcook tool, therefore it must not
+ * depend on anything other than the core library.
+ */
+class MeshBuilder {
+public:
+    /**
+     * Structure containing vertex data.
+     *
+     * The fields of this structure which contain valid data depends on the
+     * attributes which have been added.
+     */
+    struct Vertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 texcoord;
+        glm::vec4 tangent;
+    };
+
+    /** Simplified level of detail of a submesh. */
+    struct LODDesc {
+        std::vector<uint32_t> indices;      /**< Array of vertex indices. */
+        float error;                        /**< Geometric error relative to the full detail submesh. */
+    };
+
+    /** Cluster of triangles within a submesh (see MeshCluster). */
+    struct ClusterDesc {
+        uint32_t firstIndex;                /**< First index within the submesh's indices. */
+        uint32_t numIndices;                /**< Number of indices. */
+        Sphere bounds;                      /**< Bounding sphere. */
+        glm::vec3 coneApex;                 /**< Normal cone apex. */
+        glm::vec3 coneAxis;                 /**< Normal cone axis. */
+        float coneCutoff;                   /**< Normal cone cutoff. */
+    };
+
+    /** Submesh descriptor. */
+    struct SubMeshDesc {
+        std::string material;               /**< Material name. */
+        std::vector<uint32_t> indices;      /**< Array of vertex indices to go into index buffer. */
+
+        /** Simplified levels of detail, in order of decreasing detail. */
+        std::vector<LODDesc> lods;
+
+        /** Clusters dividing the full detail indices, if generated. */
+        std::vector<ClusterDesc> clusters;
+    };
+
+    /** Post-transform vertex cache statistics. */
+    struct VertexCacheStats {
+        float acmr;                         /**< Average cache miss ratio (misses per triangle). */
+        float atvr;                         /**< Average transformed vertex ratio (misses per vertex). */
+    };
+
+    /** Post-transform vertex cache size assumed for optimisation. */
+    static const uint32_t kVertexCacheSize = 16;
+
+    /** Maximum number of triangles in a cluster. */
+    static const uint32_t kClusterMaxTriangles = 128;
+
+    /** Maximum number of unique vertices in a cluster. */
+    static const uint32_t kClusterMaxVertices = 64;
+
+    /** Minimum number of triangles in a submesh for it to be clustered. */
+    static const uint32_t kMinClusteredTriangles = 1024;
+
+    /** Flags controlling the vertex format used by build(). */
+    enum : uint32_t {
+        /**
+         * Pack normals and tangents into 10:10:10:2 normalised values, and
+         * texture coordinates into half floats.
+         */
+        kPackAttributes = (1 << 0),
+
+        /**
+         * Quantise positions to 16-bit normalised values relative to the
+         * bounding box of the mesh.
+         */
+        kQuantisePositions = (1 << 1),
+    };
+
+public:
+    explicit MeshBuilder(const char *path);
+
+    void addAttribute(VertexAttribute::Semantic semantic, unsigned index);
+    bool hasAttribute(VertexAttribute::Semantic semantic, unsigned index) const;
+    void reserveVertices(size_t count);
+    Vertex &addVertex(size_t &outIndex);
+    SubMeshDesc &addSubMesh();
+
+    void calculateTangents();
+    void generateLODs(unsigned count, float reduction);
+    void optimise();
+    void generateClusters();
+
+    VertexCacheStats analyseVertexCache() const;
+
+    /** @return             Array of vertices. */
+    const std::vector<Vertex> &vertices() const { return m_vertices; }
+
+    /** @return             List of submeshes. */
+    const std::list<SubMeshDesc> &subMeshes() const { return m_subMeshes; }
+
+    bool build(std::vector<uint8_t> &output, uint32_t flags = 0) const;
+
+private:
+    /** Attribute information. */
+    struct Attribute {
+        VertexAttribute::Semantic semantic;
+        unsigned index;
+    };
+
+private:
+    BoundingBox calculateBoundingBox(const std::vector<uint32_t> &indices) const;
+    void optimiseVertexCache(std::vector<uint32_t> &indices, std::vector<uint32_t> &clusters) const;
+    void optimiseOverdraw(std::vector<uint32_t> &indices, std::vector<uint32_t> &clusters) const;
+    void optimiseVertexFetch();
+    void calculatePositionRemap(std::vector<uint32_t> &remap) const;
+    ClusterDesc calculateCluster(const std::vector<uint32_t> &indices, size_t start, size_t end) const;
+
+private:
+    const char *m_path;                     /**< Path to the mesh (for error messages). */
+    std::list<Attribute> m_attributes;      /**< Array of attribute details. */
+    std::vector<Vertex> m_vertices;         /**< Array of vertices to go into the vertex buffer. */
+    std::list<SubMeshDesc> m_subMeshes;     /**< List of submeshes. */
+};
@@ -14,277 +14,318 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+
 /**
  * @file
  * @brief               Mesh loader class.
  */
 
+#include "engine/mesh_format.h"
+
+#include "gpu/gpu_manager.h"
+
 #include "mesh_loader.h"
 
+/**
+ * Base mesh loader.
+ */
+
 /** Construct the mesh loader. */
 MeshLoader::MeshLoader() :
-    generateTangents (false)
+    generateTangents  (false),
+    optimise          (true),
+    packVertices      (true),
+    quantisePositions (false),
+    numLODs           (3),
+    m_cookedData      (nullptr),
+    m_cookedSize      (0)
 {}
 
-/**
- * Add a vertex attribute.
- *
- * Adds a vertex attribute to the mesh. The data type is fixed for a given
- * semantic.
- *
- * @param semantic      Attribute semantic.
- * @param index         Attribute index.
- */
-void MeshLoader::addAttribute(VertexAttribute::Semantic semantic, unsigned index) {
-    m_attributes.emplace_back();
-    Attribute &attribute = m_attributes.back();
-    attribute.semantic   = semantic;
-    attribute.index      = index;
-}
+/** Get the cooked mesh data, building it from source data if necessary.
+ * @return              Whether successful. */
+bool MeshLoader::prepare() {
+    m_cookedSize = m_data->size();
 
-/**
- * Add a vertex.
- *
- * Adds a new vertex to the mesh. The vertex data must be filled into the
- * returned structure by the caller. Vertices will be ordered in the order in
- * which they are specified with this function.
- *
- * @param outIndex      Where to store vertex index.
- */
-MeshLoader::Vertex &MeshLoader::addVertex(size_t &outIndex) {
-    outIndex = m_vertices.size();
+    /* Use cooked data in place if it is available in memory. */
+    const void *data = m_data->data();
+    if (data && isCookedMesh(data, m_cookedSize)) {
+        m_cookedData = reinterpret_cast<const uint8_t *>(data);
+        return true;
+    }
 
-    m_vertices.emplace_back();
-    return m_vertices.back();
-}
+    MeshHeader header;
+    if (!data &&
+        m_cookedSize >= sizeof(header) &&
+        m_data->read(&header, sizeof(header), 0) &&
+        isCookedMesh(&header, sizeof(header)))
+    {
+        m_cookedBuffer.resize(m_cookedSize);
+        if (!m_data->read(&m_cookedBuffer[0], m_cookedSize, 0)) {
+            logError("%s: Failed to read asset data", m_path);
+            return false;
+        }
+    } else {
+        MeshBuilder builder(m_path);
+        if (!build(builder))
+            return false;
 
-/**
- * Add a sub-mesh.
- *
- * Adds a new sub-mesh to the mesh. The returned descriptor structure must be
- * filled in with details of the sub-mesh.
- */
-MeshLoader::SubMeshDesc &MeshLoader::addSubMesh() {
-    m_subMeshes.emplace_back();
-    return m_subMeshes.back();
-}
+        if (this->generateTangents)
+            builder.calculateTangents();
 
-/**
- * Create the mesh.
- *
- * This should be called once all details of the mesh have been filled in to
- * create the mesh and upload all of its data, and generate extra data (e.g.
- * tangents).
- *
- * @return              Created mesh.
- */
-MeshPtr MeshLoader::createMesh() {
-    if (!m_attributes.size()) {
-        logError("%s: No attributes defined", m_path);
-        return nullptr;
-    } else if (!m_vertices.size()) {
-        logError("%s: No vertices defined", m_path);
-        return nullptr;
-    } else if (!m_subMeshes.size()) {
-        logError("%s: No sub-meshes defined", m_path);
-        return nullptr;
-    }
+        /* Must be done before optimising so that the LODs are optimised too. */
+        if (this->numLODs)
+            builder.generateLODs(this->numLODs, 0.5f);
 
-    MeshPtr mesh(new Mesh());
+        if (this->optimise) {
+            builder.optimise();
+            builder.generateClusters();
+        }
 
-    mesh->setNumVertices(m_vertices.size());
+        uint32_t flags = 0;
+        if (this->packVertices)
+            flags |= MeshBuilder::kPackAttributes;
+        if (this->quantisePositions)
+            flags |= MeshBuilder::kQuantisePositions;
 
-    /* Calculate tangents if required and we do not have them. */
-    calculateTangents();
+        if (!builder.build(m_cookedBuffer, flags))
+            return false;
 
-    /* Add vertex attributes and upload data. */
-    for (Attribute &attribute : m_attributes) {
-        VertexAttribute::Type type;
-        size_t components;
-        bool normalised;
-        void *data;
+        m_cookedSize = m_cookedBuffer.size();
+    }
 
-        switch (attribute.semantic) {
-            case VertexAttribute::kPositionSemantic:
-                check(attribute.index == 0);
+    m_cookedData = &m_cookedBuffer[0];
+    return true;
+}
 
-                type       = VertexAttribute::kFloatType;
-                components = 3;
-                normalised = false;
-                data       = &m_vertices[0].position;
-                break;
+/** Create the mesh from the cooked mesh data.
+ * @return              Pointer to loaded asset, null on failure. */
+AssetPtr MeshLoader::load() {
+    MeshHeader header;
+    memcpy(&header, m_cookedData, sizeof(header));
 
-            case VertexAttribute::kNormalSemantic:
-                check(attribute.index == 0);
+    if (header.version != kMeshVersion) {
+        logError("%s: Unsupported cooked mesh version %u", m_path, header.version);
+        return nullptr;
+    }
 
-                type       = VertexAttribute::kFloatType;
-                components = 3;
-                normalised = false;
-                data       = &m_vertices[0].normal;
-                break;
+    /* Validate that everything is within the data. */
+    auto checkRange =
+        [&] (uint64_t offset, uint64_t count, uint64_t size) {
+            return offset <= m_cookedSize && count * size <= m_cookedSize - offset;
+        };
+
+    if (!header.numVertices || !header.numAttributes || !header.numSubMeshes ||
+        (header.indexType != GPUIndexData::kUnsignedShortType &&
+         header.indexType != GPUIndexData::kUnsignedIntType) ||
+        !checkRange(header.attributesOffset, header.numAttributes, sizeof(MeshAttribute)) ||
+        !checkRange(header.verticesOffset, header.numVertices, header.vertexStride) ||
+        !checkRange(header.indicesOffset, header.numIndices,
+                    GPUIndexData::elementSize(static_cast<GPUIndexData::Type>(header.indexType))) ||
+        !checkRange(header.subMeshesOffset, header.numSubMeshes, sizeof(MeshSubMesh)) ||
+        !checkRange(header.lodsOffset, header.numLODs, sizeof(MeshLOD)) ||
+        !checkRange(header.clustersOffset, header.numClusters, sizeof(MeshCluster)) ||
+        !checkRange(header.stringsOffset, header.stringsSize, 1) ||
+        !header.stringsSize || m_cookedData[header.stringsOffset + header.stringsSize - 1] != 0)
+    {
+        logError("%s: Cooked mesh data is invalid", m_path);
+        return nullptr;
+    }
 
-            case VertexAttribute::kTexcoordSemantic:
-                check(attribute.index == 0);
+    const MeshAttribute *attributes = reinterpret_cast<const MeshAttribute *>(&m_cookedData[header.attributesOffset]);
+    const MeshSubMesh *subMeshes    = reinterpret_cast<const MeshSubMesh *>(&m_cookedData[header.subMeshesOffset]);
+    const MeshLOD *lods             = reinterpret_cast<const MeshLOD *>(&m_cookedData[header.lodsOffset]);
+    const MeshCluster *clusters     = reinterpret_cast<const MeshCluster *>(&m_cookedData[header.clustersOffset]);
+    const char *strings             = reinterpret_cast<const char *>(&m_cookedData[header.stringsOffset]);
+
+    /* All attributes are interleaved in a single buffer. */
+    GPUVertexDataLayoutDesc layoutDesc(1, header.numAttributes);
+    layoutDesc.bindings[0].stride = header.vertexStride;
+
+    for (uint32_t i = 0; i < header.numAttributes; i++) {
+        const MeshAttribute &source = attributes[i];
+        VertexAttribute &attribute  = layoutDesc.attributes[i];
+
+        attribute.semantic   = static_cast<VertexAttribute::Semantic>(source.semantic);
+        attribute.index      = source.index;
+        attribute.type       = static_cast<VertexAttribute::Type>(source.type);
+        attribute.normalised = source.normalised;
+        attribute.components = source.components;
+        attribute.binding    = 0;
+        attribute.offset     = source.offset;
+
+        if (source.type >= VertexAttribute::kNumTypes ||
+            !source.components || source.components > 4 ||
+            (source.type == VertexAttribute::kInt1010102Type && source.components != 4) ||
+            attribute.offset + attribute.size() > header.vertexStride)
+        {
+            logError("%s: Cooked mesh attribute %u is invalid", m_path, i);
+            return nullptr;
+        }
+    }
 
-                type       = VertexAttribute::kFloatType;
-                components = 2;
-                normalised = false;
-                data       = &m_vertices[0].texcoord;
-                break;
+    for (uint32_t i = 0; i < header.numSubMeshes; i++) {
+        const MeshSubMesh &source = subMeshes[i];
+
+        if (source.firstIndex > header.numIndices ||
+            source.numIndices > header.numIndices - source.firstIndex ||
+            source.material >= header.stringsSize ||
+            source.firstLOD > header.numLODs ||
+            source.numLODs > header.numLODs - source.firstLOD ||
+            source.firstCluster > header.numClusters ||
+            source.numClusters > header.numClusters - source.firstCluster)
+        {
+            logError("%s: Cooked mesh submesh %u is invalid", m_path, i);
+            return nullptr;
+        }
 
-            case VertexAttribute::kTangentSemantic:
-                check(attribute.index == 0);
+        /* Errors must be increasing, as LOD selection relies on it. */
+        float previousError = 0.0f;
 
-                type       = VertexAttribute::kFloatType;
-                components = 4;
-                normalised = false;
-                data       = &m_vertices[0].tangent;
-                break;
+        for (uint32_t j = source.firstLOD; j < source.firstLOD + source.numLODs; j++) {
+            const MeshLOD &lod = lods[j];
 
-            default:
-                fatal("Unhandled attribute semantic %d", attribute.semantic);
+            if (lod.firstIndex > header.numIndices ||
+                lod.numIndices > header.numIndices - lod.firstIndex ||
+                !(lod.error >= previousError))
+            {
+                logError("%s: Cooked mesh submesh %u LOD %u is invalid", m_path, i, j - source.firstLOD + 1);
+                return nullptr;
+            }
 
+            previousError = lod.error;
         }
 
-        mesh->addAttribute(attribute.semantic,
-                           attribute.index,
-                           type,
-                           normalised,
-                           components,
-                           data,
-                           sizeof(m_vertices[0]));
-    }
+        for (uint32_t j = source.firstCluster; j < source.firstCluster + source.numClusters; j++) {
+            const MeshCluster &cluster = clusters[j];
 
-    /* Register all submeshes. */
-    for (const SubMeshDesc &desc : m_subMeshes) {
-        SubMesh &subMesh = mesh->addSubMesh();
+            if (cluster.firstIndex < source.firstIndex ||
+                cluster.firstIndex - source.firstIndex > source.numIndices ||
+                cluster.numIndices > source.numIndices - (cluster.firstIndex - source.firstIndex))
+            {
+                logError("%s: Cooked mesh submesh %u cluster %u is invalid", m_path, i, j - source.firstCluster);
+                return nullptr;
+            }
+        }
+    }
 
-        /* Add the material slot. If this name has already been added the
-         * existing index is returned. */
-        subMesh.material = mesh->addMaterial(desc.material);
+    MeshPtr mesh(new Mesh());
 
-        /* Create an index buffer. */
-        subMesh.setIndices(desc.indices);
+    /* Positions may be quantised, in which case the mesh needs to carry the
+     * transformation to get back to the original positions. */
+    const glm::vec3 positionOffset = glm::make_vec3(header.positionOffset);
+    if (positionOffset != glm::vec3(0.0f) || header.positionScale != 1.0f) {
+        mesh->setPositionTransform(glm::translate(glm::mat4(), positionOffset) *
+                                   glm::scale(glm::mat4(), glm::vec3(header.positionScale)));
+    }
 
-        /* Calculate the bounding box for the sub-mesh. */
-        subMesh.boundingBox = calculateBoundingBox(desc.indices);
+    /* Upload the vertex data. */
+    auto vertexBufferDesc = GPUBufferDesc().
+        setType  (GPUBuffer::kVertexBuffer).
+        setUsage (GPUBuffer::kStaticUsage).
+        setSize  (header.numVertices * header.vertexStride);
+    GPUBufferPtr vertexBuffer = g_gpuManager->createBuffer(vertexBufferDesc);
+    vertexBuffer->write(0, vertexBufferDesc.size, &m_cookedData[header.verticesOffset]);
 
-        logDebug("%s: Submesh %u: %u indices", m_path, mesh->numSubMeshes() - 1, desc.indices.size());
-    }
+    GPUVertexDataLayoutPtr layout = g_gpuManager->getVertexDataLayout(layoutDesc);
 
-    logDebug("%s: %u vertices, %u submeshes, %u materials",
-             m_path,
-             m_vertices.size(),
-             mesh->numSubMeshes(),
-             mesh->numMaterials());
+    auto vertexDataDesc = GPUVertexDataDesc().
+        setCount  (header.numVertices).
+        setLayout (layout);
+    vertexDataDesc.buffers[0] = std::move(vertexBuffer);
+    mesh->setVertices(g_gpuManager->createVertexData(std::move(vertexDataDesc)));
 
-    return mesh;
-}
+    /* Upload the index data, which is shared between all submeshes. */
+    const auto indexType = static_cast<GPUIndexData::Type>(header.indexType);
 
-/** Calculate a bounding box.
- * @param indices       Indices of the sub-mesh.
- * @return              Calculated bounding box. */
-BoundingBox MeshLoader::calculateBoundingBox(const std::vector<uint16_t> &indices) const {
-    BoundingBox boundingBox(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+    auto indexBufferDesc = GPUBufferDesc().
+        setType  (GPUBuffer::kIndexBuffer).
+        setUsage (GPUBuffer::kStaticUsage).
+        setSize  (header.numIndices * GPUIndexData::elementSize(indexType));
+    GPUBufferPtr indexBuffer = g_gpuManager->createBuffer(indexBufferDesc);
+    indexBuffer->write(0, indexBufferDesc.size, &m_cookedData[header.indicesOffset]);
 
-    for (uint16_t index : indices) {
-        check(index < m_vertices.size());
-        const Vertex &vertex = m_vertices[index];
+    /* Register all submeshes. */
+    for (uint32_t i = 0; i < header.numSubMeshes; i++) {
+        const MeshSubMesh &source = subMeshes[i];
+        SubMesh &subMesh = mesh->addSubMesh();
 
-        boundingBox.minimum = glm::min(boundingBox.minimum, vertex.position);
-        boundingBox.maximum = glm::max(boundingBox.maximum, vertex.position);
-    }
+        /* Add the material slot. If this name has already been added the
+         * existing index is returned. */
+        subMesh.material = mesh->addMaterial(&strings[source.material]);
+
+        auto indexDataDesc = GPUIndexDataDesc().
+            setBuffer (indexBuffer).
+            setType   (indexType).
+            setCount  (source.numIndices).
+            setOffset (source.firstIndex);
+        subMesh.setIndices(g_gpuManager->createIndexData(std::move(indexDataDesc)));
+
+        for (uint32_t j = source.firstLOD; j < source.firstLOD + source.numLODs; j++) {
+            const MeshLOD &lod = lods[j];
+
+            auto lodIndexDataDesc = GPUIndexDataDesc().
+                setBuffer (indexBuffer).
+                setType   (indexType).
+                setCount  (lod.numIndices).
+                setOffset (lod.firstIndex);
+            subMesh.addLOD(g_gpuManager->createIndexData(std::move(lodIndexDataDesc)), lod.error);
+        }
 
-    return boundingBox;
-}
+        if (source.numClusters) {
+            std::vector<SubMesh::Cluster> subMeshClusters(source.numClusters);
 
-/** Calculate tangents for the mesh if required and it does not have them. */
-void MeshLoader::calculateTangents() {
-    bool needTangents = this->generateTangents;
+            for (uint32_t j = 0; j < source.numClusters; j++) {
+                const MeshCluster &cluster = clusters[source.firstCluster + j];
+                SubMesh::Cluster &dest     = subMeshClusters[j];
 
-    if (needTangents) {
-        for (Attribute &attribute : m_attributes) {
-            if (attribute.semantic == VertexAttribute::kTangentSemantic) {
-                needTangents = false;
-                break;
+                dest.bounds     = Sphere(glm::make_vec3(cluster.centre), cluster.radius);
+                dest.coneApex   = glm::make_vec3(cluster.coneApex);
+                dest.coneAxis   = glm::make_vec3(cluster.coneAxis);
+                dest.coneCutoff = cluster.coneCutoff;
+                dest.firstIndex = cluster.firstIndex - source.firstIndex;
+                dest.numIndices = cluster.numIndices;
             }
-        }
-    }
 
-    if (!needTangents)
-        return;
-
-    /* Add an attribute for it. */
-    addAttribute(VertexAttribute::kTangentSemantic, 0);
-
-    /*
-     * Tangent/bitangent vector calculation based on Eric Lengyel's method.
-     * Original web page appears to have disappeared, copy here:
-     * https://fenix.tecnico.ulisboa.pt/downloadFile/845043405449073/Tangent%20Space%20Calculation.pdf
-     */
-
-    std::vector<glm::vec3> tangents(m_vertices.size(), glm::vec3(0.0));
-    std::vector<glm::vec3> bitangents(m_vertices.size(), glm::vec3(0.0));
-
-    for (const SubMeshDesc &subMesh : m_subMeshes) {
-        for (size_t i = 0; i < subMesh.indices.size(); i += 3) {
-            const uint16_t i0 = subMesh.indices[i + 0];
-            const uint16_t i1 = subMesh.indices[i + 1];
-            const uint16_t i2 = subMesh.indices[i + 2];
-
-            const glm::vec3 &p0  = m_vertices[i0].position;
-            const glm::vec3 &p1  = m_vertices[i1].position;
-            const glm::vec3 &p2  = m_vertices[i2].position;
-
-            const glm::vec2 &uv0 = m_vertices[i0].texcoord;
-            const glm::vec2 &uv1 = m_vertices[i1].texcoord;
-            const glm::vec2 &uv2 = m_vertices[i2].texcoord;
-
-            const float x1 = p1.x - p0.x;
-            const float x2 = p2.x - p0.x;
-            const float y1 = p1.y - p0.y;
-            const float y2 = p2.y - p0.y;
-            const float z1 = p1.z - p0.z;
-            const float z2 = p2.z - p0.z;
-
-            const float s1 = uv1.x - uv0.x;
-            const float s2 = uv2.x - uv0.x;
-            const float t1 = uv1.y - uv0.y;
-            const float t2 = uv2.y - uv0.y;
-
-            const float r = 1.0f / (s1 * t2 - s2 * t1);
-
-            const glm::vec3 sdir((t2 * x1 - t1 * x2) * r,
-                                 (t2 * y1 - t1 * y2) * r,
-                                 (t2 * z1 - t1 * z2) * r);
-            const glm::vec3 tdir((s1 * x2 - s2 * x1) * r,
-                                 (s1 * y2 - s2 * y1) * r,
-                                 (s1 * z2 - s2 * z1) * r);
-
-            tangents[i0] += sdir;
-            tangents[i1] += sdir;
-            tangents[i2] += sdir;
-
-            bitangents[i0] += tdir;
-            bitangents[i1] += tdir;
-            bitangents[i2] += tdir;
+            /* Culling needs a CPU copy of the indices to build index data for
+             * the visible clusters from. */
+            const size_t elementSize = GPUIndexData::elementSize(indexType);
+            const uint8_t *indexData = &m_cookedData[header.indicesOffset + (source.firstIndex * elementSize)];
+
+            subMesh.setClusters(std::move(subMeshClusters),
+                                std::vector<uint8_t>(indexData, indexData + (source.numIndices * elementSize)));
         }
+
+        subMesh.boundingBox = BoundingBox(glm::make_vec3(source.minimum), glm::make_vec3(source.maximum));
+
+        logDebug("%s: Submesh %u: %u indices, %u LODs, %u clusters",
+                 m_path, i, source.numIndices, source.numLODs, source.numClusters);
     }
 
-    for (size_t i = 0; i < m_vertices.size(); i++) {
-        Vertex &vertex = m_vertices[i];
+    logDebug("%s: %u vertices (%zu bytes), %u indices (%zu bytes), %u submeshes, %u materials",
+             m_path,
+             header.numVertices,
+             vertexBufferDesc.size,
+             header.numIndices,
+             indexBufferDesc.size,
+             mesh->numSubMeshes(),
+             mesh->numMaterials());
 
-        const glm::vec3 &n = vertex.normal;
-        const glm::vec3 &t = tangents[i];
+    /* Free the data now that it has been uploaded. */
+    m_cookedData = nullptr;
+    m_cookedBuffer.clear();
+    m_cookedBuffer.shrink_to_fit();
 
-        /* Gram-Schmidt orthogonalize. */
-        const glm::vec3 tangent = glm::normalize(t - n * glm::dot(n, t));
+    return mesh;
+}
 
-        /* Calculate handedness of the bitanget, stored in the W component of
-         * the tangent vector and is used to calculate the bitangent vector
-         * without having to store it separately. */
-        const float handedness = (glm::dot(glm::cross(n, t), bitangents[i]) < 0.0f) ? -1.0f : 1.0f;
+/**
+ * Cooked mesh loader.
+ */
 
-        vertex.tangent = glm::vec4(tangent, handedness);
-    }
+/** Handle data that is not a cooked mesh.
+ * @param builder       Builder (unused).
+ * @return              Always false. */
+bool CookedMeshLoader::build(MeshBuilder &builder) {
+    logError("%s: Asset data is not a cooked mesh", m_path);
+    return false;
 }
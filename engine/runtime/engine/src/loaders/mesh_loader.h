@@ -24,10 +24,19 @@
 #include "engine/asset_loader.h"
 #include "engine/mesh.h"
 
-#include <list>
+#include "mesh_builder.h"
+
 #include <vector>
 
-/** Mesh loader base class. */
+/**
+ * Mesh loader base class.
+ *
+ * Meshes are loaded from the cooked mesh format (see engine/mesh_format.h),
+ * which is uploaded directly to the GPU. Derived classes convert their source
+ * format to a cooked mesh using MeshBuilder. If the data for the asset is
+ * already a cooked mesh (e.g. produced offline by the meshcook tool), it is
+ * used as is and the derived class is not involved.
+ */
 class MeshLoader : public AssetLoader {
 public:
     // FIXME: objgen can't detect that a class has unimplemented pure virtuals.
@@ -36,47 +45,87 @@ public:
     /** Whether to automatically generate tangents. */
     PROPERTY() bool generateTangents;
 
-protected:
-    /** Attribute information. */
-    struct Attribute {
-        VertexAttribute::Semantic semantic;
-        unsigned index;
-    };
+    /**
+     * Whether to optimise the mesh.
+     *
+     * When enabled (the default), triangles and vertices are reordered for
+     * vertex cache efficiency, reduced overdraw and vertex fetch locality (see
+     * MeshBuilder::optimise()), and large submeshes are divided into clusters
+     * which are culled individually (see MeshBuilder::generateClusters()).
+     * This does not apply to meshes that are already cooked, which are
+     * optimised by meshcook.
+     */
+    PROPERTY() bool optimise;
+
+    /**
+     * Whether to pack vertex attributes.
+     *
+     * When enabled (the default), normals and tangents are stored as packed
+     * 10:10:10:2 values and texture coordinates as half floats, rather than
+     * as full precision floats.
+     */
+    PROPERTY() bool packVertices;
+
+    /**
+     * Whether to quantise vertex positions.
+     *
+     * When enabled, positions are stored as 16-bit fixed-point values relative
+     * to the bounding box of the mesh. This gives a precision of 1/65535 of the
+     * mesh's largest dimension, which is sufficient for most meshes but may
+     * cause cracks between large meshes that are meant to join seamlessly, so
+     * is disabled by default.
+     */
+    PROPERTY() bool quantisePositions;
 
     /**
-     * Structure containing loaded vertex data.
+     * Number of levels of detail to generate.
      *
-     * The fields of this structure which contain valid data depends on the
-     * attributes which have been added.
+     * Simplified versions of each submesh are generated, each with around half
+     * the triangles of the previous level (see MeshBuilder::generateLODs()).
+     * These are selected when rendering based on the size of the mesh on
+     * screen. Setting this to 0 disables level of detail generation. This does
+     * not apply to meshes that are already cooked.
      */
-    struct Vertex {
-        glm::vec3 position;
-        glm::vec3 normal;
-        glm::vec2 texcoord;
-        glm::vec4 tangent;
-    };
-
-    /** Submesh descriptor. */
-    struct SubMeshDesc {
-        std::string material;               /**< Material name. */
-        std::vector<uint16_t> indices;      /**< Array of vertex indices to go into index buffer. */
-    };
+    PROPERTY() uint32_t numLODs;
 
+    bool prepare() override;
+    AssetPtr load() override;
 protected:
     MeshLoader();
 
-    void addAttribute(VertexAttribute::Semantic semantic, unsigned index);
-    Vertex &addVertex(size_t &outIndex);
-    SubMeshDesc &addSubMesh();
+    /**
+     * Build the mesh from source data.
+     *
+     * Parse the source data and add the mesh data to the given builder. This
+     * is called from prepare() when the asset data is not already a cooked
+     * mesh, so may be run on an asset manager worker thread. Tangents are
+     * generated afterwards if requested.
+     *
+     * @param builder       Builder to add mesh data to.
+     *
+     * @return              Whether the source data was valid.
+     */
+    virtual bool build(MeshBuilder &builder) = 0;
+private:
+    const uint8_t *m_cookedData;            /**< Cooked mesh data. */
+    size_t m_cookedSize;                    /**< Size of cooked mesh data. */
 
-    MeshPtr createMesh();
+    /** Buffer holding the cooked mesh if it is not mapped. */
+    std::vector<uint8_t> m_cookedBuffer;
+};
 
-private:
-    BoundingBox calculateBoundingBox(const std::vector<uint16_t> &indices) const;
-    void calculateTangents();
+/**
+ * Cooked mesh loader class.
+ *
+ * Loads meshes that have been cooked offline (with the meshcook tool) and
+ * stored in files with a ".mesh" extension.
+ */
+class CookedMeshLoader : public MeshLoader {
+public:
+    CLASS();
 
-private:
-    std::list<Attribute> m_attributes;      /**< Array of attribute details. */
-    std::vector<Vertex> m_vertices;         /**< Array of vertices to go into the vertex buffer. */
-    std::list<SubMeshDesc> m_subMeshes;     /**< List of submeshes. */
+    /** @return             File extension which this loader handles. */
+    const char *extension() const override { return "mesh"; }
+protected:
+    bool build(MeshBuilder &builder) override;
 };
@@ -0,0 +1,620 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Mesh simplification class.
+ *
+ * Simplification works in passes. Each pass finds the cheapest collapse for
+ * every vertex that can be removed, then performs as many of those as possible
+ * in order of increasing cost, skipping any that would touch a neighbourhood
+ * already changed in the same pass. This avoids having to maintain a priority
+ * queue of collapses whose costs change as the mesh is modified, and each pass
+ * removes a large fraction of the remaining vertices.
+ *
+ * A collapse is rejected if it would flip or severely distort a triangle, or
+ * if it would make the mesh non-manifold (the two vertices have neighbours in
+ * common other than those opposite the collapsed edge).
+ *
+ * Attribute seams are handled by requiring that every vertex at the source
+ * position has a triangle along the collapsed edge, which gives the vertex at
+ * the target position that it should be replaced with. This is only possible
+ * when the seam runs along the edge, so vertices are only collapsed along
+ * seams, and the ends and junctions of seams are preserved.
+ */
+
+#include "mesh_simplifier.h"
+
+#include <cmath>
+#include <limits>
+
+/** Value indicating no vertex. */
+static const uint32_t kInvalidVertex = std::numeric_limits<uint32_t>::max();
+
+/**
+ * Minimum cosine of the angle through which a collapse can rotate a triangle.
+ * Larger rotations are rejected, which also rejects flipped triangles.
+ */
+static const float kMinNormalCosine = 0.25f;
+
+/** Initialise the simplifier.
+ * @param vertices      Vertex array. Must remain valid while the simplifier
+ *                      exists.
+ * @param indices       Triangle indices for the mesh to simplify. */
+MeshSimplifier::MeshSimplifier(const std::vector<MeshBuilder::Vertex> &vertices,
+                               const std::vector<uint32_t> &indices) :
+    m_vertices (vertices),
+    m_error    (0.0f)
+{
+    const size_t numVertices = m_vertices.size();
+
+    /* Find referenced vertices with the same position by sorting them. The
+     * first vertex in each group (the lowest index) becomes the position
+     * vertex for the group. Unreferenced vertices are left alone. */
+    std::vector<bool> referenced(numVertices, false);
+    for (uint32_t index : indices)
+        referenced[index] = true;
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(numVertices);
+
+    m_positionRemap.resize(numVertices);
+    for (size_t i = 0; i < numVertices; i++) {
+        m_positionRemap[i] = i;
+
+        if (referenced[i])
+            sorted.push_back(i);
+    }
+
+    auto lessThan =
+        [&] (uint32_t a, uint32_t b) {
+            const glm::vec3 &pa = position(a);
+            const glm::vec3 &pb = position(b);
+
+            if (pa.x != pb.x)
+                return pa.x < pb.x;
+            if (pa.y != pb.y)
+                return pa.y < pb.y;
+            if (pa.z != pb.z)
+                return pa.z < pb.z;
+
+            return a < b;
+        };
+
+    std::sort(sorted.begin(), sorted.end(), lessThan);
+
+    for (size_t i = 0; i < sorted.size(); ) {
+        const uint32_t first = sorted[i++];
+
+        while (i < sorted.size() && position(sorted[i]) == position(first))
+            m_positionRemap[sorted[i++]] = first;
+    }
+
+    /* Drop any triangles that are degenerate to begin with. */
+    m_indices.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const uint32_t p0 = m_positionRemap[indices[i + 0]];
+        const uint32_t p1 = m_positionRemap[indices[i + 1]];
+        const uint32_t p2 = m_positionRemap[indices[i + 2]];
+
+        if (p0 != p1 && p0 != p2 && p1 != p2)
+            m_indices.insert(m_indices.end(), &indices[i], &indices[i] + 3);
+    }
+
+    /* Accumulate the plane of each triangle into the quadrics of its vertices,
+     * weighted by area so that the error of a vertex is the average squared
+     * distance to its planes. Border edges additionally get a plane
+     * perpendicular to the triangle, which penalises moving the border. */
+    m_quadrics.resize(numVertices, Quadric{});
+
+    Topology topology;
+    calculateTopology(topology);
+
+    for (size_t i = 0; i < m_indices.size(); i += 3) {
+        const uint32_t p[3] = {
+            m_positionRemap[m_indices[i + 0]],
+            m_positionRemap[m_indices[i + 1]],
+            m_positionRemap[m_indices[i + 2]]
+        };
+
+        glm::vec3 normal = glm::cross(position(p[1]) - position(p[0]), position(p[2]) - position(p[0]));
+        const float length = glm::length(normal);
+        if (length == 0.0f)
+            continue;
+
+        normal = normal * (1.0f / length);
+
+        for (uint32_t vertex : p)
+            addQuadric(vertex, normal, position(p[0]), length * 0.5);
+
+        for (size_t j = 0; j < 3; j++) {
+            const uint32_t a = p[j];
+            const uint32_t b = p[(j + 1) % 3];
+
+            if (!isBorderEdge(topology, a, b))
+                continue;
+
+            const glm::vec3 edge = position(b) - position(a);
+            const float edgeLength = glm::length(edge);
+            if (edgeLength == 0.0f)
+                continue;
+
+            const glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+
+            addQuadric(a, edgeNormal, position(a), edgeLength * edgeLength);
+            addQuadric(b, edgeNormal, position(a), edgeLength * edgeLength);
+        }
+    }
+}
+
+/** Add a plane to a vertex's quadric.
+ * @param vertex        Position vertex to add to.
+ * @param normal        Normal of the plane.
+ * @param point         Point on the plane.
+ * @param weight        Weight of the plane. */
+void MeshSimplifier::addQuadric(uint32_t vertex, const glm::vec3 &normal, const glm::vec3 &point, double weight) {
+    Quadric &quadric = m_quadrics[vertex];
+
+    const double d = -glm::dot(normal, point);
+
+    quadric.a00    += weight * normal.x * normal.x;
+    quadric.a01    += weight * normal.x * normal.y;
+    quadric.a02    += weight * normal.x * normal.z;
+    quadric.a11    += weight * normal.y * normal.y;
+    quadric.a12    += weight * normal.y * normal.z;
+    quadric.a22    += weight * normal.z * normal.z;
+    quadric.b0     += weight * normal.x * d;
+    quadric.b1     += weight * normal.y * d;
+    quadric.b2     += weight * normal.z * d;
+    quadric.c      += weight * d * d;
+    quadric.weight += weight;
+}
+
+/**
+ * Calculate mesh topology.
+ *
+ * Builds vertex-triangle adjacency for the position vertices, and classifies
+ * edges and vertices. An interior edge is used by exactly 2 triangles, once in
+ * each direction, and a border edge by a single triangle. Vertices on any
+ * other (non-manifold) edges, and vertices on other than 2 border edges (where
+ * borders meet), are locked.
+ *
+ * @param topology      Topology structure to fill in.
+ */
+void MeshSimplifier::calculateTopology(Topology &topology) const {
+    const size_t numVertices = m_vertices.size();
+
+    topology.adjacencyOffsets.assign(numVertices + 1, 0);
+    for (uint32_t index : m_indices)
+        topology.adjacencyOffsets[m_positionRemap[index] + 1]++;
+
+    for (size_t i = 0; i < numVertices; i++)
+        topology.adjacencyOffsets[i + 1] += topology.adjacencyOffsets[i];
+
+    topology.adjacency.resize(m_indices.size());
+    {
+        std::vector<uint32_t> fill(topology.adjacencyOffsets.begin(), topology.adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < m_indices.size(); i++)
+            topology.adjacency[fill[m_positionRemap[m_indices[i]]]++] = i / 3;
+    }
+
+    std::vector<std::pair<uint64_t, bool>> edges;
+    edges.reserve(m_indices.size());
+
+    for (size_t i = 0; i < m_indices.size(); i += 3) {
+        for (size_t j = 0; j < 3; j++) {
+            const uint32_t a = m_positionRemap[m_indices[i + j]];
+            const uint32_t b = m_positionRemap[m_indices[i + ((j + 1) % 3)]];
+
+            edges.emplace_back(edgeKey(a, b), a < b);
+        }
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    std::vector<uint8_t> borderCounts(numVertices, 0);
+    topology.kinds.assign(numVertices, VertexKind::kInterior);
+    topology.borderEdges.clear();
+
+    for (size_t i = 0; i < edges.size(); ) {
+        size_t end = i + 1;
+        while (end < edges.size() && edges[end].first == edges[i].first)
+            end++;
+
+        const uint32_t a = edges[i].first >> 32;
+        const uint32_t b = edges[i].first & 0xffffffff;
+
+        if (end - i == 1) {
+            topology.borderEdges.push_back(edges[i].first);
+            borderCounts[a] = std::min(borderCounts[a] + 1, 255);
+            borderCounts[b] = std::min(borderCounts[b] + 1, 255);
+        } else if (end - i != 2 || edges[i].second == edges[i + 1].second) {
+            topology.kinds[a] = VertexKind::kLocked;
+            topology.kinds[b] = VertexKind::kLocked;
+        }
+
+        i = end;
+    }
+
+    for (size_t i = 0; i < numVertices; i++) {
+        if (topology.kinds[i] == VertexKind::kLocked || !borderCounts[i])
+            continue;
+
+        topology.kinds[i] = (borderCounts[i] == 2) ? VertexKind::kBorder : VertexKind::kLocked;
+    }
+}
+
+/** Check whether an edge is on a border.
+ * @param topology      Topology information.
+ * @param a             First position vertex.
+ * @param b             Second position vertex.
+ * @return              Whether the edge is a border edge. */
+bool MeshSimplifier::isBorderEdge(const Topology &topology, uint32_t a, uint32_t b) const {
+    return std::binary_search(topology.borderEdges.begin(), topology.borderEdges.end(), edgeKey(a, b));
+}
+
+/**
+ * Simplify the mesh.
+ *
+ * Collapses edges until the mesh has no more than the given number of
+ * triangles, or no more edges can be collapsed. The result is available from
+ * indices(), and can be simplified further by calling this again with a lower
+ * target.
+ *
+ * @param targetTriangles Target number of triangles.
+ */
+void MeshSimplifier::simplify(size_t targetTriangles) {
+    while (m_indices.size() / 3 > targetTriangles) {
+        if (!collapseEdges(targetTriangles))
+            break;
+    }
+}
+
+/** Perform a pass of edge collapses.
+ * @param targetTriangles Target number of triangles.
+ * @return              Number of collapses performed. */
+size_t MeshSimplifier::collapseEdges(size_t targetTriangles) {
+    const size_t numVertices  = m_vertices.size();
+    const size_t numTriangles = m_indices.size() / 3;
+
+    Topology topology;
+    calculateTopology(topology);
+
+    /* Find the cheapest collapse for each vertex that can be removed. */
+    std::vector<Collapse> best(numVertices, Collapse{ kInvalidVertex, kInvalidVertex, 0.0f });
+    std::vector<std::pair<uint32_t, uint32_t>> vertexMap;
+
+    auto consider =
+        [&] (uint32_t source, uint32_t target, bool border) {
+            if (topology.kinds[source] == VertexKind::kLocked ||
+                (topology.kinds[source] == VertexKind::kBorder && !border))
+            {
+                return;
+            }
+
+            Collapse candidate;
+            candidate.source = source;
+            candidate.target = target;
+            candidate.cost   = collapseCost(source, target);
+
+            Collapse &collapse = best[source];
+            if (collapse.target != kInvalidVertex && collapse.cost <= candidate.cost)
+                return;
+
+            size_t removed;
+            if (mapVertices(candidate, topology, vertexMap, removed))
+                collapse = candidate;
+        };
+
+    for (size_t i = 0; i < m_indices.size(); i += 3) {
+        for (size_t j = 0; j < 3; j++) {
+            const uint32_t a = m_positionRemap[m_indices[i + j]];
+            const uint32_t b = m_positionRemap[m_indices[i + ((j + 1) % 3)]];
+
+            const bool border = isBorderEdge(topology, a, b);
+
+            consider(a, b, border);
+            consider(b, a, border);
+        }
+    }
+
+    std::vector<Collapse> collapses;
+    for (const Collapse &collapse : best) {
+        if (collapse.target != kInvalidVertex)
+            collapses.push_back(collapse);
+    }
+
+    std::sort(collapses.begin(), collapses.end(),
+              [] (const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+    /* Perform the collapses. Vertices in the neighbourhood of a collapse are
+     * marked as touched, and not considered again until the next pass, as
+     * the validity checks are made against the mesh at the start of the pass. */
+    std::vector<bool> touched(numVertices, false);
+    std::vector<uint32_t> remap(numVertices);
+    for (size_t i = 0; i < numVertices; i++)
+        remap[i] = i;
+
+    size_t remaining = numTriangles;
+    size_t numCollapses = 0;
+
+    for (const Collapse &collapse : collapses) {
+        if (remaining <= targetTriangles)
+            break;
+
+        if (touched[collapse.source] || touched[collapse.target])
+            continue;
+
+        if (!isValidCollapse(collapse, topology))
+            continue;
+
+        size_t removed;
+        if (!mapVertices(collapse, topology, vertexMap, removed))
+            continue;
+
+        for (const auto &entry : vertexMap)
+            remap[entry.first] = entry.second;
+
+        Quadric &target       = m_quadrics[collapse.target];
+        const Quadric &source = m_quadrics[collapse.source];
+        target.a00    += source.a00;
+        target.a01    += source.a01;
+        target.a02    += source.a02;
+        target.a11    += source.a11;
+        target.a12    += source.a12;
+        target.a22    += source.a22;
+        target.b0     += source.b0;
+        target.b1     += source.b1;
+        target.b2     += source.b2;
+        target.c      += source.c;
+        target.weight += source.weight;
+
+        m_error = std::max(m_error, collapse.cost);
+
+        for (uint32_t i = topology.adjacencyOffsets[collapse.source]; i < topology.adjacencyOffsets[collapse.source + 1]; i++) {
+            const uint32_t triangle = topology.adjacency[i];
+
+            for (size_t j = 0; j < 3; j++)
+                touched[m_positionRemap[m_indices[(triangle * 3) + j]]] = true;
+        }
+
+        remaining = (removed < remaining) ? remaining - removed : 0;
+        numCollapses++;
+    }
+
+    /* Apply the collapses, removing triangles that are now degenerate. */
+    if (numCollapses) {
+        size_t count = 0;
+
+        for (size_t i = 0; i < m_indices.size(); i += 3) {
+            const uint32_t i0 = remap[m_indices[i + 0]];
+            const uint32_t i1 = remap[m_indices[i + 1]];
+            const uint32_t i2 = remap[m_indices[i + 2]];
+
+            const uint32_t p0 = m_positionRemap[i0];
+            const uint32_t p1 = m_positionRemap[i1];
+            const uint32_t p2 = m_positionRemap[i2];
+
+            if (p0 != p1 && p0 != p2 && p1 != p2) {
+                m_indices[count++] = i0;
+                m_indices[count++] = i1;
+                m_indices[count++] = i2;
+            }
+        }
+
+        m_indices.resize(count);
+    }
+
+    return numCollapses;
+}
+
+/**
+ * Determine the vertex replacements for a collapse.
+ *
+ * Each vertex at the source position is replaced with the vertex at the target
+ * position that it shares a triangle along the collapsed edge with. This fails
+ * if a vertex at the source position does not share any triangle with the
+ * target, or shares triangles with different vertices at the target position,
+ * as then the collapse would not preserve attribute seams.
+ *
+ * @param collapse      Collapse to map.
+ * @param topology      Topology information.
+ * @param vertexMap     Where to store pairs of vertex and replacement.
+ * @param outRemoved    Where to store number of triangles that will be removed.
+ *
+ * @return              Whether a mapping exists for every vertex.
+ */
+bool MeshSimplifier::mapVertices(const Collapse &collapse,
+                                 const Topology &topology,
+                                 std::vector<std::pair<uint32_t, uint32_t>> &vertexMap,
+                                 size_t &outRemoved) const
+{
+    const uint32_t begin = topology.adjacencyOffsets[collapse.source];
+    const uint32_t end   = topology.adjacencyOffsets[collapse.source + 1];
+
+    auto findSource =
+        [&] (uint32_t vertex) {
+            return std::find_if(vertexMap.begin(), vertexMap.end(),
+                                [&] (const std::pair<uint32_t, uint32_t> &entry) {
+                                    return entry.first == vertex;
+                                });
+        };
+
+    vertexMap.clear();
+    outRemoved = 0;
+
+    for (uint32_t i = begin; i < end; i++) {
+        const uint32_t triangle = topology.adjacency[i];
+
+        uint32_t sourceVertex = kInvalidVertex;
+        uint32_t targetVertex = kInvalidVertex;
+
+        for (size_t j = 0; j < 3; j++) {
+            const uint32_t index = m_indices[(triangle * 3) + j];
+
+            if (m_positionRemap[index] == collapse.source) {
+                sourceVertex = index;
+            } else if (m_positionRemap[index] == collapse.target) {
+                targetVertex = index;
+            }
+        }
+
+        if (targetVertex == kInvalidVertex)
+            continue;
+
+        outRemoved++;
+
+        auto existing = findSource(sourceVertex);
+        if (existing == vertexMap.end()) {
+            vertexMap.emplace_back(sourceVertex, targetVertex);
+        } else if (existing->second != targetVertex) {
+            /* Attributes are discontinuous across the edge. */
+            return false;
+        }
+    }
+
+    for (uint32_t i = begin; i < end; i++) {
+        const uint32_t triangle = topology.adjacency[i];
+
+        for (size_t j = 0; j < 3; j++) {
+            const uint32_t index = m_indices[(triangle * 3) + j];
+
+            if (m_positionRemap[index] == collapse.source && findSource(index) == vertexMap.end())
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Check whether an edge collapse is valid.
+ *
+ * A collapse is invalid if it would rotate any of the remaining triangles
+ * around the source vertex too far (including flipping it), or if the source
+ * and target have more neighbours in common than the vertices opposite the
+ * collapsed edge, in which case the collapse would produce a non-manifold
+ * edge.
+ *
+ * @param collapse      Collapse to check.
+ * @param topology      Topology information.
+ *
+ * @return              Whether the collapse is valid.
+ */
+bool MeshSimplifier::isValidCollapse(const Collapse &collapse, const Topology &topology) const {
+    std::vector<uint32_t> sourceNeighbours;
+    std::vector<uint32_t> targetNeighbours;
+    size_t edgeTriangles = 0;
+
+    const glm::vec3 &sourcePosition = position(collapse.source);
+    const glm::vec3 &targetPosition = position(collapse.target);
+
+    for (uint32_t i = topology.adjacencyOffsets[collapse.source]; i < topology.adjacencyOffsets[collapse.source + 1]; i++) {
+        const uint32_t triangle = topology.adjacency[i];
+
+        uint32_t p[3];
+        size_t sourceCorner = 0;
+        bool hasTarget = false;
+
+        for (size_t j = 0; j < 3; j++) {
+            p[j] = m_positionRemap[m_indices[(triangle * 3) + j]];
+
+            if (p[j] == collapse.source) {
+                sourceCorner = j;
+            } else {
+                sourceNeighbours.push_back(p[j]);
+                hasTarget |= p[j] == collapse.target;
+            }
+        }
+
+        /* Triangles containing the edge are removed. */
+        if (hasTarget) {
+            edgeTriangles++;
+            continue;
+        }
+
+        const glm::vec3 &p1 = position(p[(sourceCorner + 1) % 3]);
+        const glm::vec3 &p2 = position(p[(sourceCorner + 2) % 3]);
+
+        const glm::vec3 before = glm::cross(p1 - sourcePosition, p2 - sourcePosition);
+        const glm::vec3 after  = glm::cross(p1 - targetPosition, p2 - targetPosition);
+
+        const float lengths = glm::length(before) * glm::length(after);
+        if (lengths == 0.0f || glm::dot(before, after) < kMinNormalCosine * lengths)
+            return false;
+    }
+
+    for (uint32_t i = topology.adjacencyOffsets[collapse.target]; i < topology.adjacencyOffsets[collapse.target + 1]; i++) {
+        const uint32_t triangle = topology.adjacency[i];
+
+        for (size_t j = 0; j < 3; j++) {
+            const uint32_t vertex = m_positionRemap[m_indices[(triangle * 3) + j]];
+
+            if (vertex != collapse.target)
+                targetNeighbours.push_back(vertex);
+        }
+    }
+
+    std::sort(sourceNeighbours.begin(), sourceNeighbours.end());
+    sourceNeighbours.erase(std::unique(sourceNeighbours.begin(), sourceNeighbours.end()), sourceNeighbours.end());
+    std::sort(targetNeighbours.begin(), targetNeighbours.end());
+    targetNeighbours.erase(std::unique(targetNeighbours.begin(), targetNeighbours.end()), targetNeighbours.end());
+
+    size_t common = 0;
+    auto source = sourceNeighbours.begin();
+    auto target = targetNeighbours.begin();
+    while (source != sourceNeighbours.end() && target != targetNeighbours.end()) {
+        if (*source < *target) {
+            ++source;
+        } else if (*target < *source) {
+            ++target;
+        } else {
+            common++;
+            ++source;
+            ++target;
+        }
+    }
+
+    return common == edgeTriangles;
+}
+
+/** Calculate the cost of collapsing one vertex onto another.
+ * @param source        Vertex to remove.
+ * @param target        Vertex to collapse onto.
+ * @return              Error introduced by the collapse, as the RMS distance
+ *                      of the target from the planes of both vertices. */
+float MeshSimplifier::collapseCost(uint32_t source, uint32_t target) const {
+    const Quadric &a = m_quadrics[source];
+    const Quadric &b = m_quadrics[target];
+
+    const double weight = a.weight + b.weight;
+    if (weight <= 0.0)
+        return 0.0f;
+
+    const glm::vec3 &p = position(target);
+    const double x = p.x, y = p.y, z = p.z;
+
+    const double error =
+        (a.a00 + b.a00) * x * x +
+        (a.a11 + b.a11) * y * y +
+        (a.a22 + b.a22) * z * z +
+        2.0 * ((a.a01 + b.a01) * x * y + (a.a02 + b.a02) * x * z + (a.a12 + b.a12) * y * z) +
+        2.0 * ((a.b0 + b.b0) * x + (a.b1 + b.b1) * y + (a.b2 + b.b2) * z) +
+        (a.c + b.c);
+
+    return static_cast<float>(std::sqrt(std::max(error, 0.0) / weight));
+}
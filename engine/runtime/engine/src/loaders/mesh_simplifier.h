@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Mesh simplification class.
+ */
+
+#pragma once
+
+#include "mesh_builder.h"
+
+#include <algorithm>
+
+/**
+ * Class which simplifies a mesh.
+ *
+ * This class reduces the number of triangles in a mesh by collapsing edges,
+ * choosing the collapses which introduce the least error according to the
+ * quadric error metric ("Surface Simplification Using Quadric Error Metrics",
+ * Garland and Heckbert 1997). Vertices are only ever collapsed onto existing
+ * vertices, so the simplified mesh uses a subset of the original vertices and
+ * can share the same vertex data.
+ *
+ * Attribute seams (where multiple vertices share the same position, e.g. at UV
+ * discontinuities or hard edges) and mesh borders are preserved: vertices on
+ * them can only be collapsed along them, and vertices where they meet or
+ * branch are never removed. The simplifier keeps its state between calls to
+ * simplify(), so a chain of progressively simpler meshes can be generated by
+ * calling it repeatedly with decreasing targets.
+ *
+ * Like MeshBuilder, this must not depend on anything other than the core
+ * library.
+ */
+class MeshSimplifier {
+public:
+    MeshSimplifier(const std::vector<MeshBuilder::Vertex> &vertices, const std::vector<uint32_t> &indices);
+
+    void simplify(size_t targetTriangles);
+
+    /** @return             Current simplified indices. */
+    const std::vector<uint32_t> &indices() const { return m_indices; }
+
+    /**
+     * Get the error of the simplified mesh.
+     *
+     * Gets the largest error introduced by any collapse so far. This is
+     * approximately the largest distance between the simplified surface and
+     * the original surface, in the same units as the vertex positions.
+     *
+     * @return              Error of the simplified mesh.
+     */
+    float error() const { return m_error; }
+private:
+    /** Error quadric, a symmetric 4x4 matrix weighted by triangle area. */
+    struct Quadric {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+        double weight;
+    };
+
+    /** Candidate edge collapse. */
+    struct Collapse {
+        uint32_t source;                    /**< Vertex to remove. */
+        uint32_t target;                    /**< Vertex to collapse onto. */
+        float cost;                         /**< Error introduced by the collapse. */
+    };
+
+    /** Topological classification of a vertex. */
+    enum class VertexKind : uint8_t {
+        kInterior,                          /**< Can be collapsed along any edge. */
+        kBorder,                            /**< Can only be collapsed along a border edge. */
+        kLocked,                            /**< Cannot be collapsed. */
+    };
+
+    /** Mesh topology information, calculated at the start of each pass. */
+    struct Topology {
+        /** Offsets into the adjacency array for each vertex. */
+        std::vector<uint32_t> adjacencyOffsets;
+
+        /** Triangles using each vertex. */
+        std::vector<uint32_t> adjacency;
+
+        /** Classification of each vertex. */
+        std::vector<VertexKind> kinds;
+
+        /** Sorted keys of border edges. */
+        std::vector<uint64_t> borderEdges;
+    };
+private:
+    void addQuadric(uint32_t vertex, const glm::vec3 &normal, const glm::vec3 &point, double weight);
+    void calculateTopology(Topology &topology) const;
+    bool isBorderEdge(const Topology &topology, uint32_t a, uint32_t b) const;
+    size_t collapseEdges(size_t targetTriangles);
+    bool mapVertices(const Collapse &collapse,
+                     const Topology &topology,
+                     std::vector<std::pair<uint32_t, uint32_t>> &vertexMap,
+                     size_t &outRemoved) const;
+    bool isValidCollapse(const Collapse &collapse, const Topology &topology) const;
+    float collapseCost(uint32_t source, uint32_t target) const;
+
+    /** Get a key identifying an edge between two position vertices. */
+    static uint64_t edgeKey(uint32_t a, uint32_t b) {
+        return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+    }
+
+    /** Get the position of a vertex. */
+    const glm::vec3 &position(uint32_t index) const { return m_vertices[index].position; }
+private:
+    const std::vector<MeshBuilder::Vertex> &m_vertices;
+
+    std::vector<uint32_t> m_indices;        /**< Current indices. */
+
+    /**
+     * Position remapping table.
+     *
+     * Maps each vertex to the first vertex with the same position. Quadrics
+     * and topology operate on these position vertices, so that vertices split
+     * for attribute seams are treated as one.
+     */
+    std::vector<uint32_t> m_positionRemap;
+
+    std::vector<Quadric> m_quadrics;        /**< Quadric for each position vertex. */
+    float m_error;                          /**< Largest error introduced so far. */
+};
@@ -0,0 +1,544 @@
+/*
+ * Copyright (C) 2015-2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               Wavefront mesh parser.
+ *
+ * The parser works directly on the file content in memory, and tokenises lines
+ * in-place without allocating. Vertices are deduplicated with an open-addressed
+ * hash table of vertex keys.
+ */
+
+#include "core/log.h"
+
+#include "obj_parser.h"
+
+#include <algorithm>
+#include <cstring>
+
+/** Check whether a character is whitespace within a line.
+ * @param ch            Character to check.
+ * @return              Whether the character is whitespace. */
+static inline bool isSpace(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+/** Skip over whitespace.
+ * @param pos           Current position, updated past whitespace.
+ * @param end           End of the line. */
+static inline void skipSpace(const char *&pos, const char *end) {
+    while (pos < end && isSpace(*pos))
+        pos++;
+}
+
+/** Get the next whitespace-separated token on a line.
+ * @param pos           Current position, updated past the token.
+ * @param end           End of the line.
+ * @param tokenStart    Where to store start of the token.
+ * @param tokenEnd      Where to store end of the token.
+ * @return              Whether a token was found. */
+static inline bool nextToken(const char *&pos, const char *end, const char *&tokenStart, const char *&tokenEnd) {
+    skipSpace(pos, end);
+
+    tokenStart = pos;
+    while (pos < end && !isSpace(*pos))
+        pos++;
+
+    tokenEnd = pos;
+    return tokenStart != tokenEnd;
+}
+
+/** Compare a token against a string.
+ * @param start         Start of the token.
+ * @param end           End of the token.
+ * @param str           String to compare against.
+ * @return              Whether the token matches the string. */
+static inline bool tokenEquals(const char *start, const char *end, const char *str) {
+    size_t length = end - start;
+    return strncmp(start, str, length) == 0 && str[length] == 0;
+}
+
+/**
+ * Parse a floating point value.
+ *
+ * Parses a decimal floating point value, with optional sign, fraction and
+ * exponent. This handles the values found in OBJ files without the overhead of
+ * strtof() (locale handling, and needing a null-terminated string). Up to 19
+ * significant digits are used, which is more than enough for a float.
+ *
+ * @param pos           Current position, updated past the value.
+ * @param end           End of the line.
+ * @param value         Where to store parsed value.
+ *
+ * @return              Whether a value was parsed.
+ */
+static bool parseFloat(const char *&pos, const char *end, float &value) {
+    static const double kPowersOf10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+        1e22,
+    };
+
+    static const int kMaxExactPower = 22;
+    static const unsigned kMaxDigits = 19;
+
+    const char *str = pos;
+
+    bool negative = false;
+    if (str < end && (*str == '-' || *str == '+')) {
+        negative = *str == '-';
+        str++;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    unsigned digits = 0;
+    bool haveDigits = false;
+
+    /* Integer part. Leading zeros are not counted as significant digits. */
+    while (str < end && *str >= '0' && *str <= '9') {
+        if (digits < kMaxDigits) {
+            mantissa = (mantissa * 10) + (*str - '0');
+            if (mantissa)
+                digits++;
+        } else {
+            exponent++;
+        }
+
+        haveDigits = true;
+        str++;
+    }
+
+    /* Fractional part. */
+    if (str < end && *str == '.') {
+        str++;
+
+        while (str < end && *str >= '0' && *str <= '9') {
+            if (digits < kMaxDigits) {
+                mantissa = (mantissa * 10) + (*str - '0');
+                if (mantissa)
+                    digits++;
+
+                exponent--;
+            }
+
+            haveDigits = true;
+            str++;
+        }
+    }
+
+    if (!haveDigits)
+        return false;
+
+    /* Exponent. */
+    if (str < end && (*str == 'e' || *str == 'E')) {
+        str++;
+
+        bool negativeExponent = false;
+        if (str < end && (*str == '-' || *str == '+')) {
+            negativeExponent = *str == '-';
+            str++;
+        }
+
+        if (str == end || *str < '0' || *str > '9')
+            return false;
+
+        int explicitExponent = 0;
+        while (str < end && *str >= '0' && *str <= '9') {
+            if (explicitExponent < 10000)
+                explicitExponent = (explicitExponent * 10) + (*str - '0');
+
+            str++;
+        }
+
+        exponent += (negativeExponent) ? -explicitExponent : explicitExponent;
+    }
+
+    /* Scale by the exponent. Powers of 10 up to 22 are exactly representable
+     * as doubles, so in the common case this is a single exact operation. */
+    double result = static_cast<double>(mantissa);
+    if (mantissa) {
+        while (exponent > kMaxExactPower) {
+            result *= kPowersOf10[kMaxExactPower];
+            exponent -= kMaxExactPower;
+        }
+
+        while (exponent < -kMaxExactPower) {
+            result /= kPowersOf10[kMaxExactPower];
+            exponent += kMaxExactPower;
+        }
+
+        if (exponent > 0) {
+            result *= kPowersOf10[exponent];
+        } else if (exponent < 0) {
+            result /= kPowersOf10[-exponent];
+        }
+    }
+
+    value = static_cast<float>((negative) ? -result : result);
+    pos = str;
+    return true;
+}
+
+/** Parse an integer value.
+ * @param pos           Current position, updated past the value.
+ * @param end           End of the line.
+ * @param value         Where to store parsed value.
+ * @return              Whether a value was parsed. */
+static bool parseInteger(const char *&pos, const char *end, int64_t &value) {
+    const char *str = pos;
+
+    bool negative = false;
+    if (str < end && *str == '-') {
+        negative = true;
+        str++;
+    }
+
+    if (str == end || *str < '0' || *str > '9')
+        return false;
+
+    int64_t result = 0;
+    while (str < end && *str >= '0' && *str <= '9') {
+        if (result < std::numeric_limits<int32_t>::max())
+            result = (result * 10) + (*str - '0');
+
+        str++;
+    }
+
+    value = (negative) ? -result : result;
+    pos = str;
+    return true;
+}
+
+const uint32_t OBJParser::kInvalidVertex;
+
+/** Initialise the OBJ parser.
+ * @param builder       Builder to add mesh data to.
+ * @param path          Path to the file (for error messages). */
+OBJParser::OBJParser(MeshBuilder &builder, const char *path) :
+    m_builder         (builder),
+    m_path            (path),
+    m_currentLine     (0),
+    m_currentMaterial ("default"),
+    m_currentSubMesh  (nullptr)
+{}
+
+/** Parse the file content.
+ * @param data          File content.
+ * @param size          Size of the file content.
+ * @return              Whether the file was parsed successfully. */
+bool OBJParser::parse(const char *data, size_t size) {
+    const char *const fileEnd = data + size;
+
+    /* Add attributes. FIXME: We can have models without some of these. */
+    m_builder.addAttribute(VertexAttribute::kPositionSemantic, 0);
+    m_builder.addAttribute(VertexAttribute::kNormalSemantic, 0);
+    m_builder.addAttribute(VertexAttribute::kTexcoordSemantic, 0);
+
+    /* Count the number of each element type so that we can allocate arrays up
+     * front. This is much cheaper than parsing, and avoids reallocating and
+     * copying large arrays repeatedly. */
+    size_t numPositions = 0, numTexcoords = 0, numNormals = 0, numFaces = 0;
+    for (const char *line = data; line < fileEnd; ) {
+        const char *lineEnd = reinterpret_cast<const char *>(memchr(line, '\n', fileEnd - line));
+        if (!lineEnd)
+            lineEnd = fileEnd;
+
+        if (lineEnd - line >= 2) {
+            if (line[0] == 'v') {
+                if (isSpace(line[1])) {
+                    numPositions++;
+                } else if (line[1] == 't') {
+                    numTexcoords++;
+                } else if (line[1] == 'n') {
+                    numNormals++;
+                }
+            } else if (line[0] == 'f' && isSpace(line[1])) {
+                numFaces++;
+            }
+        }
+
+        line = lineEnd + 1;
+    }
+
+    m_positions.reserve(numPositions);
+    m_texcoords.reserve(numTexcoords);
+    m_normals.reserve(numNormals);
+
+    /* Most meshes have somewhat more unique vertices than positions. */
+    size_t expectedVertices = std::max(numPositions, numFaces / 2);
+    m_builder.reserveVertices(expectedVertices);
+    m_vertexKeys.reserve(expectedVertices);
+
+    size_t tableSize = 64;
+    while (tableSize < expectedVertices * 2)
+        tableSize <<= 1;
+
+    resizeVertexTable(tableSize);
+
+    /* Parse the file content. */
+    for (const char *line = data; line < fileEnd; ) {
+        const char *lineEnd = reinterpret_cast<const char *>(memchr(line, '\n', fileEnd - line));
+        if (!lineEnd)
+            lineEnd = fileEnd;
+
+        m_currentLine++;
+
+        const char *pos = line;
+        line = lineEnd + 1;
+
+        const char *keyword, *keywordEnd;
+        if (!nextToken(pos, lineEnd, keyword, keywordEnd))
+            continue;
+
+        if (tokenEquals(keyword, keywordEnd, "v")) {
+            if (!addVertexElement(pos, lineEnd, m_positions))
+                return false;
+        } else if (tokenEquals(keyword, keywordEnd, "vt")) {
+            if (!addVertexElement(pos, lineEnd, m_texcoords))
+                return false;
+        } else if (tokenEquals(keyword, keywordEnd, "vn")) {
+            if (!addVertexElement(pos, lineEnd, m_normals))
+                return false;
+        } else if (tokenEquals(keyword, keywordEnd, "f")) {
+            if (!addFace(pos, lineEnd))
+                return false;
+        } else if (tokenEquals(keyword, keywordEnd, "usemtl")) {
+            const char *name, *nameEnd, *extra, *extraEnd;
+            if (!nextToken(pos, lineEnd, name, nameEnd) || nextToken(pos, lineEnd, extra, extraEnd)) {
+                logError("%s: %u: Expected single material name", m_path, m_currentLine);
+                return false;
+            }
+
+            if (m_currentMaterial.compare(0, std::string::npos, name, nameEnd - name) != 0) {
+                /* Begin a new submesh. */
+                m_currentMaterial.assign(name, nameEnd - name);
+                m_currentSubMesh = nullptr;
+            }
+        } else if (tokenEquals(keyword, keywordEnd, "g")) {
+            const char *name, *nameEnd, *extra, *extraEnd;
+            if (!nextToken(pos, lineEnd, name, nameEnd) || nextToken(pos, lineEnd, extra, extraEnd)) {
+                /* Note multiple group names can be specified to give shared
+                 * elements between groups but we  don't support this for now. */
+                logError("%s: %u: Expected single group name", m_path, m_currentLine);
+                return false;
+            }
+
+            /* Begin a new submesh. TODO: Should we bother trying to handle
+             * duplicate group names and bundling them together? Probably not
+             * worth the effort. */
+            m_currentSubMesh = nullptr;
+        } else {
+            /* Ignore unknown lines. Most of them are irrelevant to us. */
+        }
+    }
+
+    /* Free parsing data that is no longer needed. */
+    m_vertexTable.clear();
+    m_vertexTable.shrink_to_fit();
+    m_vertexKeys.clear();
+    m_vertexKeys.shrink_to_fit();
+
+    return true;
+}
+
+/** Handle a vertex element declaration.
+ * @param pos           Position after the keyword.
+ * @param end           End of the line.
+ * @param array         Array to add to.
+ * @return              Whether the declaration was valid. */
+template <typename VectorType>
+bool OBJParser::addVertexElement(const char *pos, const char *end, std::vector<VectorType> &array) {
+    VectorType value;
+
+    for (int i = 0; i < value.length(); i++) {
+        skipSpace(pos, end);
+
+        if (pos == end) {
+            logError("%s: %u: Expected %d values", m_path, m_currentLine, value.length());
+            return false;
+        }
+
+        if (!parseFloat(pos, end, value[i]) || (pos != end && !isSpace(*pos))) {
+            logError("%s: %u: Expected float value", m_path, m_currentLine);
+            return false;
+        }
+    }
+
+    array.push_back(value);
+    return true;
+}
+
+/** Parse a single face vertex.
+ * @param pos           Current position, updated past the vertex.
+ * @param end           End of the line.
+ * @param key           Where to store key for the vertex.
+ * @return              Whether the vertex was valid. */
+bool OBJParser::parseVertexKey(const char *&pos, const char *end, VertexKey &key) {
+    for (size_t j = 0; j < 3; j++) {
+        if (j > 0) {
+            if (pos == end || *pos != '/') {
+                logError("%s: %u: Expected v/vt/vn", m_path, m_currentLine);
+                return false;
+            }
+
+            pos++;
+        }
+
+        int64_t value;
+        if (!parseInteger(pos, end, value)) {
+            logError("%s: %u: Expected integer value", m_path, m_currentLine);
+            return false;
+        }
+
+        size_t count;
+        uint32_t *index;
+        const char *desc;
+
+        switch (j) {
+            case 0:
+                count = m_positions.size();
+                index = &key.position;
+                desc  = "position";
+                break;
+            case 1:
+                count = m_texcoords.size();
+                index = &key.texcoord;
+                desc  = "texture coordinate";
+                break;
+            default:
+                count = m_normals.size();
+                index = &key.normal;
+                desc  = "normal";
+                break;
+        }
+
+        /* Indices are 1 based. Negative indices are relative to the end of
+         * the elements declared so far. */
+        int64_t resolved = (value < 0) ? static_cast<int64_t>(count) + value : value - 1;
+        if (value == 0 || resolved < 0 || resolved >= static_cast<int64_t>(count)) {
+            logError("%s: %u: Invalid %s index %lld", m_path, m_currentLine, desc, static_cast<long long>(value));
+            return false;
+        }
+
+        *index = static_cast<uint32_t>(resolved);
+    }
+
+    if (pos != end && !isSpace(*pos)) {
+        logError("%s: %u: Expected v/vt/vn", m_path, m_currentLine);
+        return false;
+    }
+
+    return true;
+}
+
+/** Handle a face declaration.
+ * @param pos           Position after the keyword.
+ * @param end           End of the line.
+ * @return              Whether the declaration was valid. */
+bool OBJParser::addFace(const char *pos, const char *end) {
+    /* If we don't have a current submesh, we must begin a new one. */
+    if (!m_currentSubMesh) {
+        m_currentSubMesh = &m_builder.addSubMesh();
+        m_currentSubMesh->material = m_currentMaterial;
+    }
+
+    /* Each face gives 3 or more vertices as a set of indices into the sets of
+     * vertex elements that have been declared. Faces with more than 3 vertices
+     * are split into a triangle fan. */
+    std::vector<uint32_t> &indices = m_currentSubMesh->indices;
+    uint32_t first = 0, previous = 0;
+    size_t numVertices = 0;
+
+    while (true) {
+        skipSpace(pos, end);
+        if (pos == end)
+            break;
+
+        VertexKey key;
+        if (!parseVertexKey(pos, end, key))
+            return false;
+
+        uint32_t index = lookupVertex(key);
+
+        if (numVertices == 0) {
+            first = index;
+        } else if (numVertices >= 2) {
+            indices.push_back(first);
+            indices.push_back(previous);
+            indices.push_back(index);
+        }
+
+        previous = index;
+        numVertices++;
+    }
+
+    if (numVertices < 3) {
+        logError("%s: %u: Expected at least 3 vertices", m_path, m_currentLine);
+        return false;
+    }
+
+    return true;
+}
+
+/** Get the index of a vertex, adding it if it does not already exist.
+ * @param key           Key for the vertex.
+ * @return              Index of the vertex. */
+uint32_t OBJParser::lookupVertex(const VertexKey &key) {
+    if (m_vertexKeys.size() * 2 >= m_vertexTable.size())
+        resizeVertexTable(m_vertexTable.size() * 2);
+
+    size_t mask = m_vertexTable.size() - 1;
+    size_t slot = hashValue(key) & mask;
+
+    while (true) {
+        uint32_t index = m_vertexTable[slot];
+
+        if (index == kInvalidVertex) {
+            /* This is a new vertex. Add one. */
+            size_t vertexIndex;
+            MeshBuilder::Vertex &vertex = m_builder.addVertex(vertexIndex);
+            vertex.position = m_positions[key.position];
+            vertex.normal   = m_normals[key.normal];
+            vertex.texcoord = m_texcoords[key.texcoord];
+
+            index = vertexIndex;
+            m_vertexTable[slot] = index;
+            m_vertexKeys.push_back(key);
+            return index;
+        } else if (m_vertexKeys[index] == key) {
+            return index;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+}
+
+/** Resize the vertex deduplication table.
+ * @param size          New size of the table (must be a power of 2). */
+void OBJParser::resizeVertexTable(size_t size) {
+    m_vertexTable.assign(size, kInvalidVertex);
+
+    size_t mask = size - 1;
+    for (uint32_t index = 0; index < m_vertexKeys.size(); index++) {
+        size_t slot = hashValue(m_vertexKeys[index]) & mask;
+        while (m_vertexTable[slot] != kInvalidVertex)
+            slot = (slot + 1) & mask;
+
+        m_vertexTable[slot] = index;
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2015-2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               Wavefront mesh parser.
+ */
+
+#pragma once
+
+#include "core/hash.h"
+
+#include "mesh_builder.h"
+
+#include <limits>
+
+/**
+ * Wavefront .obj mesh parser.
+ *
+ * This is separate from OBJLoader so that it can be used by offline tools
+ * without depending on the engine. Parsed data is added to a MeshBuilder.
+ */
+class OBJParser {
+public:
+    OBJParser(MeshBuilder &builder, const char *path);
+
+    bool parse(const char *data, size_t size);
+
+private:
+    /** Indexes into the vertex element arrays for a single vertex. */
+    struct VertexKey {
+        uint32_t position;
+        uint32_t texcoord;
+        uint32_t normal;
+    public:
+        /** Compare this key with another. */
+        bool operator ==(const VertexKey &other) const {
+            return position == other.position && texcoord == other.texcoord && normal == other.normal;
+        }
+
+        /** Get the hash for a vertex key. */
+        friend size_t hashValue(const VertexKey &value) {
+            size_t hash = hashValue(value.position);
+            hash = hashCombine(hash, value.texcoord);
+            hash = hashCombine(hash, value.normal);
+            return hash;
+        }
+    };
+
+    /** Value for an empty slot in the vertex table. */
+    static const uint32_t kInvalidVertex = std::numeric_limits<uint32_t>::max();
+
+private:
+    template <typename VectorType>
+    bool addVertexElement(const char *pos, const char *end, std::vector<VectorType> &array);
+
+    bool addFace(const char *pos, const char *end);
+    bool parseVertexKey(const char *&pos, const char *end, VertexKey &key);
+    uint32_t lookupVertex(const VertexKey &key);
+    void resizeVertexTable(size_t size);
+
+private:
+    MeshBuilder &m_builder;             /**< Builder to add mesh data to. */
+    const char *m_path;                 /**< Path to the file (for error messages). */
+
+    /** Parser state. */
+    size_t m_currentLine;               /**< Current line of the file (for error messages). */
+    std::string m_currentMaterial;      /**< Current material name. */
+    MeshBuilder::SubMeshDesc *m_currentSubMesh; /**< Current submesh. */
+
+    /** Vertex elements. */
+    std::vector<glm::vec3> m_positions; /**< Positions ("v" declarations). */
+    std::vector<glm::vec2> m_texcoords; /**< UVs ("vt" declarations). */
+    std::vector<glm::vec3> m_normals;   /**< Normals ("vn" declarations). */
+
+    /** Keys of vertices that have been added, indexed by vertex index. */
+    std::vector<VertexKey> m_vertexKeys;
+
+    /**
+     * Vertex deduplication table.
+     *
+     * This is an open-addressed hash table (with linear probing) of indices
+     * into m_vertexKeys. Empty slots are kInvalidVertex. Its size is always a
+     * power of 2 and is kept at least twice the number of vertices.
+     */
+    std::vector<uint32_t> m_vertexTable;
+};
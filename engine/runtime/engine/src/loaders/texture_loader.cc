@@ -19,8 +19,11 @@
  * @brief               Texture loader classes.
  */
 
+#include "dds_file.h"
 #include "texture_loader.h"
 
+#include "engine/texture_streaming.h"
+
 #include "gpu/gpu_manager.h"
 
 /**
@@ -52,20 +55,115 @@ PixelFormat TextureLoader::getFinalFormat(PixelFormat format) const {
  * Base 2D texture loader.
  */
 
+/** Construct the 2D texture loader. */
+Texture2DLoader::Texture2DLoader() :
+    m_width          (0),
+    m_height         (0),
+    m_mips           (0),
+    m_baseMip        (0),
+    m_dataOffset     (0),
+    m_hasColourSpace (false)
+{}
+
+/** Load the 2D texture data.
+ * @return              Whether the data was loaded successfully. */
+bool Texture2DLoader::prepare() {
+    /* Use pre-built data if the asset is a DDS texture. */
+    uint8_t header[kDDSMaxHeaderSize];
+    size_t headerSize = std::min(m_data->size(), static_cast<uint64_t>(sizeof(header)));
+    if (m_data->read(header, headerSize, 0) && isDDSTexture(header, headerSize))
+        return loadDDS(header, headerSize);
+
+    return loadData();
+}
+
+/** Load DDS texture data.
+ * @param header        Start of the asset data.
+ * @param headerSize    Size of the header data.
+ * @return              Whether the data was loaded successfully. */
+bool Texture2DLoader::loadDDS(const void *header, size_t headerSize) {
+    DDSTexture texture;
+    if (!parseDDSHeader(m_path, header, headerSize, g_gpuManager->maxTextureSize(), texture))
+        return false;
+
+    if (texture.dataOffset + texture.dataSize > m_data->size()) {
+        logError("%s: DDS texture data is truncated", m_path);
+        return false;
+    }
+
+    m_width  = texture.width;
+    m_height = texture.height;
+    m_mips   = texture.mips;
+    m_format = texture.format;
+
+    /* If the file specifies the colour space, it overrides our sRGB
+     * attribute. */
+    m_hasColourSpace = texture.hasColourSpace;
+
+    /* If the texture can be streamed, only read the base levels. The rest are
+     * read by the streaming manager when needed. */
+    uint64_t offset = texture.dataOffset;
+    uint64_t size   = texture.dataSize;
+
+    if (g_textureStreamingManager) {
+        m_baseMip    = TextureStreamingManager::calculateBaseMip(m_width, m_height, m_mips);
+        m_dataOffset = texture.dataOffset;
+
+        for (uint32_t mip = 0; mip < m_baseMip; mip++) {
+            uint64_t mipSize = PixelFormat::imageSize(m_format,
+                                                      std::max(m_width >> mip, 1u),
+                                                      std::max(m_height >> mip, 1u));
+            offset += mipSize;
+            size   -= mipSize;
+        }
+    }
+
+    m_buffer.reset(new uint8_t[size]);
+
+    if (!m_data->read(m_buffer.get(), size, offset)) {
+        logError("%s: Failed to read asset data", m_path);
+        return false;
+    }
+
+    return true;
+}
+
 /** Load a 2D texture asset.
  * @return              Pointer to loaded asset, null on failure. */
 AssetPtr Texture2DLoader::load() {
-    if (!loadData())
-        return nullptr;
-
-    /* Create the texture, with mipmaps. TODO: Some formats will include
-     * mipmaps and therefore not need them creating here. */
-    Texture2DPtr texture = new Texture2D(m_width,
-                                         m_height,
-                                         getFinalFormat(m_format),
-                                         0,
-                                         GPUTexture::kAutoMipmap);
-    texture->update(m_buffer.get());
+    Texture2DPtr texture;
+
+    if (m_baseMip) {
+        PixelFormat format = (m_hasColourSpace) ? m_format : getFinalFormat(m_format);
+        texture = g_textureStreamingManager->createTexture(m_path,
+                                                           m_dataOffset,
+                                                           m_width,
+                                                           m_height,
+                                                           format,
+                                                           m_mips,
+                                                           m_buffer.get());
+    } else if (m_mips) {
+        /* Upload the supplied mip levels. */
+        PixelFormat format = (m_hasColourSpace) ? m_format : getFinalFormat(m_format);
+        texture = new Texture2D(m_width, m_height, format, m_mips, 0);
+
+        const uint8_t *data = m_buffer.get();
+        for (uint32_t mip = 0; mip < m_mips; mip++) {
+            uint32_t mipWidth  = std::max(m_width >> mip, 1u);
+            uint32_t mipHeight = std::max(m_height >> mip, 1u);
+
+            texture->update(mip, IntRect(0, 0, mipWidth, mipHeight), data);
+            data += PixelFormat::imageSize(m_format, mipWidth, mipHeight);
+        }
+    } else {
+        /* Create the texture, with mipmaps generated from the top level. */
+        texture = new Texture2D(m_width,
+                                m_height,
+                                getFinalFormat(m_format),
+                                0,
+                                GPUTexture::kAutoMipmap);
+        texture->update(m_buffer.get());
+    }
 
     /* Apply attributes. */
     applyAttributes(texture);
@@ -73,6 +171,17 @@ AssetPtr Texture2DLoader::load() {
     return texture;
 }
 
+/**
+ * DDS texture loader.
+ */
+
+/** Handle data that is not a DDS texture.
+ * @return              Always false. */
+bool DDSLoader::loadData() {
+    logError("%s: Asset data is not a DDS texture", m_path);
+    return false;
+}
+
 /**
  * Cube texture loader.
  */
@@ -100,6 +209,16 @@ AssetPtr TextureCubeLoader::load() {
             return nullptr;
         }
 
+        /* Faces are blitted into the cube texture, which cannot be done for
+         * compressed formats, or if only some levels are resident. */
+        if (PixelFormat::isCompressed(face->format())) {
+            logError("%s: Source texture '%s' is compressed", m_path, face->path().c_str());
+            return nullptr;
+        } else if (face->isStreamed()) {
+            logError("%s: Source texture '%s' is streamed", m_path, face->path().c_str());
+            return nullptr;
+        }
+
         /* Ensure dimensions are correct. */
         if (face->width() != face->height()) {
             logError("%s: Source texture '%s' is not square", m_path, face->path().c_str());
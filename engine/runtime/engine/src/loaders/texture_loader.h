@@ -42,31 +42,86 @@ protected:
     PixelFormat getFinalFormat(PixelFormat format) const;
 };
 
-/** 2D texture loader base class. */
+/**
+ * 2D texture loader base class.
+ *
+ * Derived classes load the top level of the texture from their source format,
+ * and the remaining mip levels are generated by the GPU at load time. If the
+ * data for the asset is a DDS texture (e.g. produced offline by the texcook
+ * tool), it is used instead and the derived class is not involved. This allows
+ * block compressed formats, and avoids generating mip levels at load time.
+ * Large DDS textures are also streamed (see TextureStreamingManager), in which
+ * case only their smallest levels are read here.
+ */
 class Texture2DLoader : public TextureLoader {
 public:
     CLASS();
 
+    bool prepare() override;
     AssetPtr load() override;
 protected:
+    Texture2DLoader();
+
     /**
      * Load the texture data.
      *
      * Load the texture data from the source file. This function is expected
-     * to set the m_width, m_height, m_format and m_data fields.
+     * to set the m_width, m_height, m_format and m_data fields. It is called
+     * from prepare(), so may be run on an asset manager worker thread.
      *
      * @return              Whether the texture data was loaded sucessfully.
      */
     virtual bool loadData() = 0;
+private:
+    bool loadDDS(const void *header, size_t headerSize);
 protected:
     uint32_t m_width;                   /**< Width of the texture. */
     uint32_t m_height;                  /**< Height of the texture. */
     PixelFormat m_format;               /**< Format of the texture. */
 
+    /**
+     * Number of mip levels in the buffer.
+     *
+     * If this is 0, the buffer contains only the top level and the remaining
+     * levels are generated. Otherwise, it contains each level consecutively
+     * from the largest.
+     */
+    uint32_t m_mips;
+
+    /**
+     * First level in the buffer, for streamed textures.
+     *
+     * If this is non-zero, the texture is streamed, and the buffer contains
+     * only the levels from this one to the smallest.
+     */
+    uint32_t m_baseMip;
+
+    /** Offset of the largest level in the asset data, for streamed textures. */
+    uint64_t m_dataOffset;
+
+    /** Whether the colour space of m_format overrides the sRGB attribute. */
+    bool m_hasColourSpace;
+
     /** Buffer containing texture data. */
     std::unique_ptr<uint8_t []> m_buffer;
 };
 
+/**
+ * DDS texture loader class.
+ *
+ * Loads textures that have been cooked offline (with the texcook tool) and
+ * stored in files with a ".dds" extension. See Texture2DLoader.
+ */
+class DDSLoader : public Texture2DLoader {
+public:
+    CLASS();
+
+    /** @return             File extension which this loader handles. */
+    const char *extension() const override { return "dds"; }
+protected:
+    bool loadData() override;
+};
+
 /** Cube texture loader class. */
 class TextureCubeLoader : public TextureLoader {
 public:
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2015-2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               TGA image parser.
+ *
+ * This is separate from TGALoader so that it can be used by offline tools
+ * without depending on the engine.
+ *
+ * TODO:
+ *  - Support 16bpp, greyscale and colour mapped images (need 16-bit packed
+ *    and single channel pixel formats).
+ */
+
+#include "core/log.h"
+
+#include "tga_parser.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define TGA_USE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define TGA_USE_NEON 1
+#endif
+
+/** TGA image types. */
+enum TGAImageType : uint8_t {
+    kTGATrueColour    = 2,
+    kTGATrueColourRLE = 10,
+};
+
+/** TGA image descriptor bit indicating that the top row is first. */
+static const uint8_t kTGATopToBottom = (1 << 5);
+
+/** TGA image file header. */
+#pragma pack(push, 1)
+struct TGAHeader {
+    uint8_t idLength;
+    uint8_t colourMapType;
+    uint8_t imageType;
+    uint16_t colourMapOrigin;
+    uint16_t colourMapLength;
+    uint8_t colourMapDepth;
+    uint16_t xOrigin;
+    uint16_t yOrigin;
+    uint16_t width;
+    uint16_t height;
+    uint8_t depth;
+    uint8_t imageDescriptor;
+};
+#pragma pack(pop)
+
+/**
+ * Expand BGR pixels to BGRA.
+ *
+ * Converts a row of 24-bit BGR pixels to 32-bit BGRA with opaque alpha. NVIDIA
+ * Vulkan doesn't support RGB/BGR formats so we have to convert to an alpha
+ * format. This is vectorised where possible since it touches every pixel of
+ * most textures. The source is never read past the last pixel, so this can be
+ * used on a row at the end of a buffer.
+ *
+ * @param source        Source pixels.
+ * @param dest          Destination pixels.
+ * @param count         Number of pixels.
+ */
+void expandBGRToBGRA(const uint8_t *__restrict source, uint8_t *__restrict dest, size_t count) {
+    size_t i = 0;
+
+    #if TGA_USE_SSE2
+        /* Gather 4 pixels at a time with unaligned 32-bit loads, each of which
+         * picks up one byte of the following pixel that is replaced by the
+         * alpha. The last load reads one byte past the 4th pixel, so stop
+         * while there is still a pixel after the group. */
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+
+        for (; i + 5 <= count; i += 4) {
+            const uint8_t *pixels = source + (i * 3);
+
+            int32_t p0, p1, p2, p3;
+            memcpy(&p0, pixels + 0, 4);
+            memcpy(&p1, pixels + 3, 4);
+            memcpy(&p2, pixels + 6, 4);
+            memcpy(&p3, pixels + 9, 4);
+
+            __m128i result = _mm_or_si128(_mm_set_epi32(p3, p2, p1, p0), alpha);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + (i * 4)), result);
+        }
+    #elif TGA_USE_NEON
+        /* Deinterleave 16 pixels into separate channels and reinterleave them
+         * with an alpha channel. */
+        const uint8x16_t alpha = vdupq_n_u8(255);
+
+        for (; i + 16 <= count; i += 16) {
+            uint8x16x3_t bgr = vld3q_u8(source + (i * 3));
+
+            uint8x16x4_t bgra;
+            bgra.val[0] = bgr.val[0];
+            bgra.val[1] = bgr.val[1];
+            bgra.val[2] = bgr.val[2];
+            bgra.val[3] = alpha;
+            vst4q_u8(dest + (i * 4), bgra);
+        }
+    #endif
+
+    for (; i < count; i++) {
+        dest[(i * 4) + 0] = source[(i * 3) + 0];
+        dest[(i * 4) + 1] = source[(i * 3) + 1];
+        dest[(i * 4) + 2] = source[(i * 3) + 2];
+        dest[(i * 4) + 3] = 255;
+    }
+}
+
+/**
+ * Decode RLE compressed TGA pixel data.
+ *
+ * Each packet starts with a byte giving the number of pixels it covers (the
+ * low 7 bits plus 1). If the top bit is set, this is followed by a single
+ * pixel value which is repeated, otherwise by the pixel values themselves.
+ * Packets may cross rows.
+ *
+ * @param path          Path to the file (for error messages).
+ * @param source        Start of the compressed data.
+ * @param sourceSize    Size of the compressed data available.
+ * @param pixelSize     Bytes per pixel.
+ * @param numPixels     Number of pixels in the image.
+ * @param dest          Where to store decoded pixels.
+ *
+ * @return              Whether the data was valid.
+ */
+bool decodeTGARLE(const char *path,
+                  const uint8_t *source,
+                  size_t sourceSize,
+                  size_t pixelSize,
+                  size_t numPixels,
+                  uint8_t *dest)
+{
+    const uint8_t *sourceEnd = source + sourceSize;
+    uint8_t *destEnd = dest + (numPixels * pixelSize);
+
+    while (dest < destEnd) {
+        if (source >= sourceEnd) {
+            logError("%s: TGA image data is truncated", path);
+            return false;
+        }
+
+        uint8_t packet = *source++;
+        size_t count = (packet & 0x7f) + 1;
+        size_t size = count * pixelSize;
+
+        if (size > static_cast<size_t>(destEnd - dest)) {
+            logError("%s: TGA RLE packet overflows the image", path);
+            return false;
+        }
+
+        if (packet & 0x80) {
+            if (pixelSize > static_cast<size_t>(sourceEnd - source)) {
+                logError("%s: TGA image data is truncated", path);
+                return false;
+            }
+
+            for (size_t i = 0; i < count; i++)
+                memcpy(dest + (i * pixelSize), source, pixelSize);
+
+            source += pixelSize;
+        } else {
+            if (size > static_cast<size_t>(sourceEnd - source)) {
+                logError("%s: TGA image data is truncated", path);
+                return false;
+            }
+
+            memcpy(dest, source, size);
+            source += size;
+        }
+
+        dest += size;
+    }
+
+    return true;
+}
+
+/**
+ * Parse a TGA image.
+ *
+ * Parses an uncompressed or RLE compressed true colour TGA image and converts
+ * it to PixelFormat::kB8G8R8A8, with the bottom row first.
+ *
+ * @param path          Path to the file (for error messages).
+ * @param data          File data.
+ * @param size          Size of the file data.
+ * @param outWidth      Where to store image width.
+ * @param outHeight     Where to store image height.
+ * @param outPixels     Where to store pixel data.
+ *
+ * @return              Whether the image was parsed successfully.
+ */
+bool parseTGA(const char *path,
+              const void *data,
+              size_t size,
+              uint32_t &outWidth,
+              uint32_t &outHeight,
+              std::unique_ptr<uint8_t []> &outPixels)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+
+    TGAHeader header;
+    if (size < sizeof(header)) {
+        logError("%s: TGA header is truncated", path);
+        return false;
+    }
+
+    memcpy(&header, bytes, sizeof(header));
+
+    if (header.imageType != kTGATrueColour && header.imageType != kTGATrueColourRLE) {
+        logError("%s: Unsupported image format (%u)", path, header.imageType);
+        return false;
+    }
+
+    if (header.depth != 24 && header.depth != 32) {
+        logError("%s: Unsupported depth (%u)", path, header.depth);
+        return false;
+    }
+
+    /* Determine image properties. */
+    outWidth = header.width;
+    outHeight = header.height;
+
+    /* Image data is after the ID and colour map. */
+    size_t pixelSize = header.depth / 8;
+    size_t numPixels = outWidth * outHeight;
+    size_t imageSize = numPixels * pixelSize;
+    size_t offset = sizeof(header) +
+                    header.idLength +
+                    (header.colourMapLength * (header.colourMapDepth / 8));
+
+    if (offset > size) {
+        logError("%s: TGA image data is truncated", path);
+        return false;
+    }
+
+    const uint8_t *source = bytes + offset;
+
+    std::unique_ptr<uint8_t []> decoded;
+    if (header.imageType == kTGATrueColourRLE) {
+        decoded.reset(new uint8_t[imageSize]);
+        if (!decodeTGARLE(path, source, size - offset, pixelSize, numPixels, decoded.get()))
+            return false;
+
+        source = decoded.get();
+    } else if (offset + imageSize > size) {
+        logError("%s: TGA image data is truncated", path);
+        return false;
+    }
+
+    /* Convert each row, flipping the image if the top row is first. */
+    bool flip = header.imageDescriptor & kTGATopToBottom;
+    size_t sourcePitch = outWidth * pixelSize;
+    size_t destPitch = outWidth * 4;
+
+    outPixels.reset(new uint8_t[numPixels * 4]);
+
+    for (uint32_t y = 0; y < outHeight; y++) {
+        const uint8_t *sourceRow = source + (y * sourcePitch);
+        uint8_t *destRow = &outPixels[((flip) ? outHeight - y - 1 : y) * destPitch];
+
+        if (pixelSize == 3) {
+            expandBGRToBGRA(sourceRow, destRow, outWidth);
+        } else {
+            memcpy(destRow, sourceRow, destPitch);
+        }
+    }
+
+    return true;
+}
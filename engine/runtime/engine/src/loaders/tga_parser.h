@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2015-2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               TGA image parser.
+ */
+
+#pragma once
+
+#include "core/core.h"
+
+#include <memory>
+
+extern void expandBGRToBGRA(const uint8_t *__restrict source, uint8_t *__restrict dest, size_t count);
+extern bool decodeTGARLE(const char *path,
+                         const uint8_t *source,
+                         size_t sourceSize,
+                         size_t pixelSize,
+                         size_t numPixels,
+                         uint8_t *dest);
+
+extern bool parseTGA(const char *path,
+                     const void *data,
+                     size_t size,
+                     uint32_t &outWidth,
+                     uint32_t &outHeight,
+                     std::unique_ptr<uint8_t []> &outPixels);
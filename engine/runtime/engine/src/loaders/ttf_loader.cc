@@ -30,22 +30,31 @@ public:
     /** @return             File extension which this loader handles. */
     const char *extension() const override { return "ttf"; }
 
+    bool prepare() override;
     AssetPtr load() override;
+private:
+    std::unique_ptr<char[]> m_fontData;     /**< Font file data. */
 };
 
 #include "ttf_loader.obj.cc"
 
-/** Load a TTF font asset.
- * @return              Pointer to loaded asset, null on failure. */
-AssetPtr TTFLoader::load() {
-    std::unique_ptr<char[]> data(new char[m_data->size()]);
-    if (!m_data->read(data.get(), m_data->size())) {
+/** Read the TTF font data.
+ * @return              Whether the data was read successfully. */
+bool TTFLoader::prepare() {
+    m_fontData.reset(new char[m_data->size()]);
+    if (!m_data->read(m_fontData.get(), m_data->size())) {
         logError("%s: Failed to read asset data", m_path);
-        return nullptr;
+        return false;
     }
 
+    return true;
+}
+
+/** Load a TTF font asset.
+ * @return              Pointer to loaded asset, null on failure. */
+AssetPtr TTFLoader::load() {
     FontPtr font(new Font);
-    if (!font->setData(std::move(data), m_data->size()))
+    if (!font->setData(std::move(m_fontData), m_data->size()))
         return nullptr;
 
     return font;
@@ -25,6 +25,9 @@
  */
 
 #include "engine/mesh.h"
+#include "engine/mesh_format.h"
+
+#include "gpu/gpu_manager.h"
 
 #include "render_core/utility.h"
 
@@ -66,6 +69,122 @@ void SubMesh::setIndices(const std::vector<uint32_t> &indices) {
     setIndices(g_gpuManager->createIndexData(std::move(indexDataDesc)));
 }
 
+/**
+ * Add a level of detail to the sub-mesh.
+ *
+ * Adds a simplified version of the sub-mesh, which uses the same vertex data
+ * as the full detail sub-mesh. Levels of detail must be added in order of
+ * increasing error, and the level of detail added will have an index equal to
+ * the previous value of numLODs().
+ *
+ * @param indices       Index data for the level of detail.
+ * @param error         Maximum deviation of the level of detail from the full
+ *                      detail geometry, in the mesh's local space.
+ */
+void SubMesh::addLOD(GPUIndexDataPtr indices, float error) {
+    check(m_lods.empty() || error >= m_lods.back().error);
+
+    m_lods.emplace_back();
+    LOD &lod    = m_lods.back();
+    lod.indices = std::move(indices);
+    lod.error   = error;
+}
+
+/**
+ * Set the clusters of the sub-mesh.
+ *
+ * Sets the clusters that the full detail sub-mesh is divided into. A CPU copy
+ * of the full detail index data (in the same format as the GPU index data) is
+ * needed to build index data for only the visible clusters.
+ *
+ * @param clusters      Clusters covering the sub-mesh's indices.
+ * @param indexData     Copy of the full detail index data.
+ */
+void SubMesh::setClusters(std::vector<Cluster> clusters, std::vector<uint8_t> indexData) {
+    check(indexData.size() == numIndices() * m_indices->elementSize());
+
+    m_clusters         = std::move(clusters);
+    m_clusterIndexData = std::move(indexData);
+}
+
+/**
+ * Determine the visible clusters of the sub-mesh.
+ *
+ * Culls each cluster against a frustum and tests whether it is entirely
+ * back-facing from the view position. Both must be given in the mesh's local
+ * space: since plane tests are preserved by affine transformations, this is
+ * correct even if the mesh's transformation has a non-uniform scale.
+ *
+ * @param frustum       Frustum in local space.
+ * @param viewPosition  View position in local space, or viewing direction
+ *                      with a W of 0 for an orthographic view (see
+ *                      isMeshClusterVisible()).
+ * @param outVisible    Where to store indices of visible clusters.
+ */
+void SubMesh::cullClusters(const Frustum &frustum,
+                           const glm::vec4 &viewPosition,
+                           std::vector<uint32_t> &outVisible) const
+{
+    outVisible.clear();
+
+    for (size_t i = 0; i < m_clusters.size(); i++) {
+        const Cluster &cluster = m_clusters[i];
+
+        if (isMeshClusterVisible(cluster.bounds,
+                                 cluster.coneApex,
+                                 cluster.coneAxis,
+                                 cluster.coneCutoff,
+                                 frustum,
+                                 viewPosition))
+        {
+            outVisible.push_back(i);
+        }
+    }
+}
+
+/**
+ * Build index data for a subset of clusters.
+ *
+ * Copies the indices of the given clusters into a transient index buffer,
+ * which is only valid for use within the current frame.
+ *
+ * @param clusters      Indices of clusters to include.
+ *
+ * @return              Index data for the clusters.
+ */
+GPUIndexDataPtr SubMesh::buildClusterIndices(const std::vector<uint32_t> &clusters) const {
+    const size_t elementSize = m_indices->elementSize();
+
+    size_t count = 0;
+    for (uint32_t index : clusters)
+        count += m_clusters[index].numIndices;
+
+    auto bufferDesc = GPUBufferDesc().
+        setType  (GPUBuffer::kIndexBuffer).
+        setUsage (GPUBuffer::kTransientUsage).
+        setSize  (count * elementSize);
+    GPUBufferPtr buffer = g_gpuManager->createBuffer(bufferDesc);
+
+    uint8_t *data = reinterpret_cast<uint8_t *>(
+        buffer->map(0, bufferDesc.size, GPUBuffer::kMapInvalidateBuffer, GPUBuffer::kWriteAccess));
+
+    for (uint32_t index : clusters) {
+        const Cluster &cluster = m_clusters[index];
+        const size_t size = cluster.numIndices * elementSize;
+
+        memcpy(data, &m_clusterIndexData[cluster.firstIndex * elementSize], size);
+        data += size;
+    }
+
+    buffer->unmap();
+
+    auto indexDataDesc = GPUIndexDataDesc().
+        setBuffer (buffer).
+        setType   (m_indices->type()).
+        setCount  (count);
+    return g_gpuManager->createIndexData(std::move(indexDataDesc));
+}
+
 /**
  * Create a mesh.
  *
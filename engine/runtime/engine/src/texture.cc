@@ -29,6 +29,7 @@
 
 #include "engine/debug_window.h"
 #include "engine/texture.h"
+#include "engine/texture_streaming.h"
 
 #include "gpu/gpu_manager.h"
 
@@ -212,7 +213,10 @@ Texture2D::Texture2D(uint32_t width,
                      PixelFormat format,
                      unsigned mips,
                      uint32_t flags) :
-    m_renderTexture (nullptr)
+    m_width         (width),
+    m_height        (height),
+    m_renderTexture (nullptr),
+    m_stream        (nullptr)
 {
     auto desc = GPUTextureDesc().
         setType   (GPUTexture::kTexture2D).
@@ -229,14 +233,32 @@ Texture2D::Texture2D(uint32_t width,
         m_renderTexture = new RenderTexture(this, 0);
 }
 
+/**
+ * Create a streamed 2D texture.
+ *
+ * Private constructor used by TextureStreamingManager. This does not create
+ * the GPU texture, the manager creates it with the resident levels.
+ *
+ * @param stream        Streaming state for the texture.
+ */
+Texture2D::Texture2D(TextureStream *stream) :
+    m_width         (stream->width),
+    m_height        (stream->height),
+    m_renderTexture (nullptr),
+    m_stream        (stream)
+{}
+
 /** Destroy the texture. */
 Texture2D::~Texture2D() {
+    if (m_stream)
+        g_textureStreamingManager->removeTexture(this);
+
     delete m_renderTexture;
 }
 
 /** Clear the entire texture contents to 0. */
 void Texture2D::clear() {
-    size_t size = m_gpu->width() * m_gpu->height() * PixelFormat::bytesPerPixel(m_gpu->format());
+    size_t size = PixelFormat::imageSize(m_gpu->format(), m_gpu->width(), m_gpu->height());
     std::unique_ptr<char[]> data(new char[size]);
     memset(data.get(), 0, size);
     update(data.get());
@@ -320,6 +342,21 @@ RenderTexture *Texture2D::renderTexture() {
     return m_renderTexture;
 }
 
+/**
+ * Request a resolution for the texture.
+ *
+ * For streamed textures, records that the texture is being displayed at
+ * approximately the given size in pixels in the current frame, so that the
+ * levels needed for that size can be made resident. Does nothing for other
+ * textures.
+ *
+ * @param size          Size in pixels.
+ */
+void Texture2D::requestResolution(float size) {
+    if (m_stream)
+        g_textureStreamingManager->requestResolution(m_stream, size);
+}
+
 /**
  * Cube texture implementation.
  */
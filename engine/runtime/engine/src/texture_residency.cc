@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Texture mip residency calculation.
+ */
+
+#include "engine/texture_residency.h"
+
+#include <algorithm>
+
+/** Level which could be made resident for a texture. */
+struct ResidencyCandidate {
+    TextureResidency *texture;          /**< Texture that the level is for. */
+    size_t index;                       /**< Index of the texture in the array. */
+    unsigned mip;                       /**< Level to make resident. */
+};
+
+/** Initialise the residency state.
+ * @param inMipSizes    Size of each mip level in bytes.
+ * @param inBaseMip     First of the levels which are always resident. This is
+ *                      also the level which is initially resident. */
+TextureResidency::TextureResidency(std::vector<uint64_t> inMipSizes, unsigned inBaseMip) :
+    mipSizes     (std::move(inMipSizes)),
+    baseMip      (inBaseMip),
+    residentMip  (inBaseMip),
+    requestedMip (inBaseMip),
+    requestFrame (0),
+    targetMip    (inBaseMip)
+{
+    check(baseMip < numMips());
+}
+
+/**
+ * Record a request for a mip level.
+ *
+ * Records that the texture is used at a resolution which needs the given level
+ * to be resident. All requests made in the same frame are combined, and a
+ * request in a new frame replaces those from earlier frames.
+ *
+ * @param mip           Largest level needed.
+ * @param frame         Current frame number.
+ */
+void TextureResidency::request(unsigned mip, uint64_t frame) {
+    mip = std::min(mip, numMips() - 1);
+
+    if (frame != requestFrame) {
+        requestFrame = frame;
+        requestedMip = mip;
+    } else {
+        requestedMip = std::min(requestedMip, mip);
+    }
+}
+
+/** Get the memory needed for a range of levels.
+ * @param mip           Largest level in the range, which extends to the
+ *                      smallest level.
+ * @return              Total size of the levels in bytes. */
+uint64_t TextureResidency::size(unsigned mip) const {
+    uint64_t total = 0;
+    for (unsigned i = mip; i < numMips(); i++)
+        total += mipSizes[i];
+
+    return total;
+}
+
+/**
+ * Calculate which mip levels should be resident.
+ *
+ * Sets the target level of each texture so that the total size of the target
+ * levels of all textures fits within a memory budget. Each texture's base
+ * levels are always included, even if they exceed the budget on their own.
+ * Each remaining requested level is then added in order of priority, as long
+ * as it fits in the budget and the next smaller level of the same texture has
+ * already been added.
+ *
+ * Levels of textures which have been used most recently take priority, so
+ * that textures which have gone out of view are the first to be evicted when
+ * memory is short, but keep their levels while there is memory to spare.
+ * Within those, smaller levels take priority, so that memory is shared evenly
+ * between textures rather than given entirely to the largest.
+ *
+ * This does not change the resident level of any texture, it is up to the
+ * caller to load or evict levels to reach the target.
+ *
+ * @param textures      Textures to calculate for.
+ * @param budget        Memory budget in bytes.
+ * @param outStats      Where to store statistics.
+ */
+void calculateTextureResidency(const std::vector<TextureResidency *> &textures,
+                               uint64_t budget,
+                               TextureResidencyStats &outStats)
+{
+    outStats = TextureResidencyStats();
+
+    std::vector<ResidencyCandidate> candidates;
+    uint64_t used = 0;
+
+    for (size_t i = 0; i < textures.size(); i++) {
+        TextureResidency *texture = textures[i];
+
+        texture->targetMip = texture->baseMip;
+        used += texture->size(texture->baseMip);
+
+        unsigned wanted = std::min(texture->requestedMip, texture->baseMip);
+        outStats.requestedSize += texture->size(wanted);
+
+        for (unsigned mip = wanted; mip < texture->baseMip; mip++)
+            candidates.push_back({texture, i, mip});
+    }
+
+    std::sort(
+        candidates.begin(), candidates.end(),
+        [] (const ResidencyCandidate &a, const ResidencyCandidate &b) {
+            if (a.texture->requestFrame != b.texture->requestFrame)
+                return a.texture->requestFrame > b.texture->requestFrame;
+
+            uint64_t aSize = a.texture->mipSizes[a.mip];
+            uint64_t bSize = b.texture->mipSizes[b.mip];
+            if (aSize != bSize)
+                return aSize < bSize;
+
+            /* Keep the order stable between calculations, and make sure that
+             * smaller levels of the same texture come first. */
+            return (a.index != b.index) ? a.index < b.index : a.mip > b.mip;
+        });
+
+    for (const ResidencyCandidate &candidate : candidates) {
+        TextureResidency *texture = candidate.texture;
+
+        /* Levels must be contiguous, so this can only be added if the next
+         * smaller level was. */
+        if (candidate.mip + 1 != texture->targetMip)
+            continue;
+
+        uint64_t size = texture->mipSizes[candidate.mip];
+        if (used + size > budget)
+            continue;
+
+        used += size;
+        texture->targetMip = candidate.mip;
+    }
+
+    for (TextureResidency *texture : textures) {
+        if (texture->targetMip > std::min(texture->requestedMip, texture->baseMip))
+            outStats.numLimited++;
+    }
+
+    outStats.targetSize = used;
+}
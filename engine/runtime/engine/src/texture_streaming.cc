@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Texture streaming manager.
+ */
+
+#include "core/data_stream.h"
+#include "core/string.h"
+
+#include "engine/asset_manager.h"
+#include "engine/debug_manager.h"
+#include "engine/debug_window.h"
+#include "engine/texture.h"
+#include "engine/texture_streaming.h"
+
+#include "gpu/gpu_manager.h"
+
+#include <algorithm>
+#include <cmath>
+
+/** Global texture streaming manager instance. */
+TextureStreamingManager *g_textureStreamingManager;
+
+/** Size (of the largest dimension) at and below which levels are always resident. */
+static const uint32_t kStreamingBaseSize = 64;
+
+/**
+ * Maximum number of loads in progress at once.
+ *
+ * This limits the amount of memory used for data which has been read but not
+ * yet uploaded, and the number of textures which are replaced in one frame.
+ */
+static const unsigned kMaxPendingLoads = 8;
+
+/** Texture streaming debug window. */
+class TextureStreamingWindow : public DebugWindow {
+public:
+    TextureStreamingWindow() : DebugWindow("Texture Streaming") {}
+    void render() override {
+        ImGui::SetNextWindowSize(ImVec2(600, 400), ImGuiSetCond_Once);
+        ImGui::SetNextWindowPosCenter(ImGuiSetCond_Once);
+
+        if (begin())
+            g_textureStreamingManager->explore();
+
+        ImGui::End();
+    }
+};
+
+/** Convert a size in bytes to MiB for display.
+ * @param size          Size in bytes.
+ * @return              Size in MiB. */
+static inline float toMiB(uint64_t size) {
+    return static_cast<float>(size) / (1024.0f * 1024.0f);
+}
+
+/** Initialise a texture stream.
+ * @param mipSizes      Size of each mip level in bytes.
+ * @param baseMip       First of the levels which are always resident. */
+TextureStream::TextureStream(std::vector<uint64_t> mipSizes, unsigned baseMip) :
+    texture       (nullptr),
+    dataOffset    (0),
+    width         (0),
+    height        (0),
+    format        (PixelFormat::kUnknown),
+    residency     (std::move(mipSizes), baseMip),
+    loading       (false),
+    loadSucceeded (false),
+    loadMip       (0),
+    loadEndMip    (0)
+{}
+
+/** Initialise the texture streaming manager.
+ * @param budget        Memory budget for streamed textures in bytes. */
+TextureStreamingManager::TextureStreamingManager(uint64_t budget) :
+    m_budget       (budget),
+    m_frame        (1),
+    m_residentSize (0),
+    m_numLoading   (0),
+    m_exiting      (false)
+{
+    m_worker = std::thread(&TextureStreamingManager::workerThread, this);
+
+    g_debugManager->registerWindow(std::make_unique<TextureStreamingWindow>());
+}
+
+/** Destroy the texture streaming manager. */
+TextureStreamingManager::~TextureStreamingManager() {
+    {
+        std::lock_guard<std::mutex> lock(m_queueLock);
+        m_exiting = true;
+    }
+
+    m_workCond.notify_all();
+    m_worker.join();
+
+    /* Streams of textures destroyed while loading are only referred to by the
+     * queues. The worker finishes the load it is working on before exiting,
+     * so all remaining loads are in one of them. */
+    for (std::deque<TextureStream *> *queue : { &m_workQueue, &m_completeQueue }) {
+        for (TextureStream *stream : *queue) {
+            if (!stream->texture)
+                delete stream;
+        }
+    }
+
+    /* Remaining textures keep their current levels. */
+    for (TextureStream *stream : m_streams) {
+        stream->texture->m_stream = nullptr;
+        delete stream;
+    }
+}
+
+/**
+ * Calculate the base level of a streamed texture.
+ *
+ * Calculates the first of the levels of a texture which are always resident.
+ * These are loaded up front with the texture, and the texture can be streamed
+ * if there are any levels above them. This is safe to call from any thread.
+ *
+ * @param width         Width of the largest level.
+ * @param height        Height of the largest level.
+ * @param mips          Number of mip levels.
+ *
+ * @return              Base level of the texture.
+ */
+unsigned TextureStreamingManager::calculateBaseMip(uint32_t width, uint32_t height, unsigned mips) {
+    unsigned mip = 0;
+    while (mip + 1 < mips && std::max(width >> mip, height >> mip) > kStreamingBaseSize)
+        mip++;
+
+    return mip;
+}
+
+/**
+ * Create a streamed texture.
+ *
+ * Creates a texture whose levels will be streamed from an asset's data. Only
+ * the base levels (see calculateBaseMip()) are resident initially. The data
+ * for all levels must be stored consecutively from the largest in the asset
+ * data, with no padding.
+ *
+ * @param path          Path to the asset to read data from.
+ * @param dataOffset    Offset of the largest level in the asset data.
+ * @param width         Width of the largest level.
+ * @param height        Height of the largest level.
+ * @param format        Pixel format of the texture.
+ * @param mips          Number of mip levels.
+ * @param data          Data for the base levels.
+ *
+ * @return              Created texture.
+ */
+Texture2D *TextureStreamingManager::createTexture(const std::string &path,
+                                                  uint64_t dataOffset,
+                                                  uint32_t width,
+                                                  uint32_t height,
+                                                  PixelFormat format,
+                                                  unsigned mips,
+                                                  const void *data)
+{
+    std::vector<uint64_t> mipSizes(mips);
+    for (unsigned i = 0; i < mips; i++) {
+        mipSizes[i] = PixelFormat::imageSize(format,
+                                             std::max(width >> i, 1u),
+                                             std::max(height >> i, 1u));
+    }
+
+    auto stream = new TextureStream(std::move(mipSizes), calculateBaseMip(width, height, mips));
+    stream->path       = path;
+    stream->dataOffset = dataOffset;
+    stream->width      = width;
+    stream->height     = height;
+    stream->format     = format;
+
+    Texture2D *texture = new Texture2D(stream);
+    stream->texture = texture;
+
+    setResidentMip(stream, stream->residency.baseMip, data);
+
+    m_streams.push_back(stream);
+    return texture;
+}
+
+/** Stop streaming a texture that is being destroyed.
+ * @param texture       Texture being destroyed. */
+void TextureStreamingManager::removeTexture(Texture2D *texture) {
+    TextureStream *stream = texture->m_stream;
+
+    m_streams.erase(std::remove(m_streams.begin(), m_streams.end(), stream), m_streams.end());
+
+    /* If a load is in progress, the stream is freed once it completes. */
+    if (stream->loading) {
+        stream->texture = nullptr;
+    } else {
+        delete stream;
+    }
+}
+
+/**
+ * Request a resolution for a streamed texture.
+ *
+ * Records that a texture is being displayed at approximately the given size
+ * in the current frame, and so needs the level closest to that size to be
+ * resident.
+ *
+ * @param stream        Stream for the texture.
+ * @param size          Size in pixels.
+ */
+void TextureStreamingManager::requestResolution(TextureStream *stream, float size) {
+    const float ratio = static_cast<float>(std::max(stream->width, stream->height)) / size;
+
+    const unsigned mip = (ratio > 1.0f)
+                             ? static_cast<unsigned>(std::min(std::log2(ratio), 31.0f))
+                             : 0;
+
+    stream->residency.request(mip, m_frame);
+}
+
+/**
+ * Update texture residency.
+ *
+ * Completes any loads which have finished reading their data, and then starts
+ * loads for textures whose resident levels do not match those calculated from
+ * the requests made in the last frame. This is called by the engine once per
+ * frame.
+ */
+void TextureStreamingManager::update() {
+    while (true) {
+        TextureStream *stream;
+
+        {
+            std::lock_guard<std::mutex> lock(m_queueLock);
+
+            if (m_completeQueue.empty())
+                break;
+
+            stream = m_completeQueue.front();
+            m_completeQueue.pop_front();
+        }
+
+        completeLoad(stream);
+    }
+
+    std::vector<TextureResidency *> textures;
+    textures.reserve(m_streams.size());
+    for (TextureStream *stream : m_streams)
+        textures.push_back(&stream->residency);
+
+    calculateTextureResidency(textures, m_budget, m_stats);
+
+    /* Evictions need no data to be read, the remaining levels are copied from
+     * the current GPU texture, so they are done straight away rather than
+     * taking up one of the pending loads. */
+    for (TextureStream *stream : m_streams) {
+        const TextureResidency &residency = stream->residency;
+
+        if (stream->loading) {
+            continue;
+        } else if (residency.targetMip > residency.residentMip) {
+            setResidentMip(stream, residency.targetMip, nullptr);
+        } else if (residency.targetMip < residency.residentMip && m_numLoading < kMaxPendingLoads) {
+            queueLoad(stream, residency.targetMip);
+        }
+    }
+
+    m_residentSize = 0;
+    for (TextureStream *stream : m_streams)
+        m_residentSize += stream->residency.size(stream->residency.residentMip);
+
+    g_debugManager->writeText(
+        String::format("Texture memory: %.1f / %.1f MiB\n", toMiB(m_residentSize), toMiB(m_budget)));
+
+    m_frame++;
+}
+
+/**
+ * Set the resident levels of a streamed texture.
+ *
+ * Replaces the texture's GPU texture with one containing only the given range
+ * of levels. Levels which are already resident are copied from the current GPU
+ * texture, so data only needs to be supplied for levels being added. This is
+ * used both to add and to evict levels. Materials using the texture will pick
+ * up the new GPU texture when they are next used.
+ *
+ * @param stream        Stream for the texture.
+ * @param mip           New largest resident level.
+ * @param data          Data for the levels from the new largest up to the
+ *                      current largest resident level (all levels if the
+ *                      texture has no GPU texture yet), or null if evicting.
+ */
+void TextureStreamingManager::setResidentMip(TextureStream *stream, unsigned mip, const void *data) {
+    TextureResidency &residency = stream->residency;
+    GPUTexture *current = stream->texture->m_gpu;
+
+    /* First level to copy from the current texture. */
+    const unsigned copyMip = (current) ? std::max(mip, residency.residentMip) : residency.numMips();
+
+    auto desc = GPUTextureDesc().
+        setType   (GPUTexture::kTexture2D).
+        setWidth  (std::max(stream->width >> mip, 1u)).
+        setHeight (std::max(stream->height >> mip, 1u)).
+        setFormat (stream->format).
+        setMips   (residency.numMips() - mip).
+        setFlags  (0);
+
+    GPUTexturePtr gpu = g_gpuManager->createTexture(desc);
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    for (unsigned i = mip; i < copyMip; i++) {
+        IntRect area(0, 0, std::max(stream->width >> i, 1u), std::max(stream->height >> i, 1u));
+        gpu->update(area, bytes, i - mip);
+        bytes += residency.mipSizes[i];
+    }
+
+    for (unsigned i = copyMip; i < residency.numMips(); i++) {
+        glm::ivec2 size(std::max(stream->width >> i, 1u), std::max(stream->height >> i, 1u));
+        g_gpuManager->blit(GPUTextureImageRef(current, 0, i - residency.residentMip),
+                           GPUTextureImageRef(gpu, 0, i - mip),
+                           glm::ivec2(0, 0),
+                           glm::ivec2(0, 0),
+                           size);
+    }
+
+    stream->texture->m_gpu = std::move(gpu);
+    residency.residentMip  = mip;
+}
+
+/** Queue a load of additional levels for a streamed texture.
+ * @param stream        Stream for the texture.
+ * @param mip           New largest resident level. */
+void TextureStreamingManager::queueLoad(TextureStream *stream, unsigned mip) {
+    check(mip < stream->residency.residentMip);
+
+    stream->loading    = true;
+    stream->loadMip    = mip;
+    stream->loadEndMip = stream->residency.residentMip;
+    m_numLoading++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_queueLock);
+        m_workQueue.push_back(stream);
+    }
+
+    m_workCond.notify_one();
+}
+
+/** Complete a load whose data has been read.
+ * @param stream        Stream for the texture. */
+void TextureStreamingManager::completeLoad(TextureStream *stream) {
+    stream->loading = false;
+    m_numLoading--;
+
+    if (!stream->texture) {
+        delete stream;
+    } else if (stream->loadSucceeded) {
+        setResidentMip(stream, stream->loadMip, stream->loadData.get());
+        stream->loadData.reset();
+    } else {
+        /* Stop streaming the texture, leaving it with its current levels,
+         * rather than repeatedly trying to read it. */
+        Texture2D *texture = stream->texture;
+        removeTexture(texture);
+        texture->m_stream = nullptr;
+    }
+}
+
+/** Thread reading texture data for loads. */
+void TextureStreamingManager::workerThread() {
+    while (true) {
+        TextureStream *stream;
+
+        {
+            std::unique_lock<std::mutex> lock(m_queueLock);
+            m_workCond.wait(lock, [this] () { return m_exiting || !m_workQueue.empty(); });
+
+            if (m_exiting)
+                return;
+
+            stream = m_workQueue.front();
+            m_workQueue.pop_front();
+        }
+
+        /* Only the immutable parts of the stream are accessed here. Levels
+         * which are already resident are not read, they are copied from the
+         * current GPU texture when the load completes. */
+        const TextureResidency &residency = stream->residency;
+
+        uint64_t offset = stream->dataOffset;
+        for (unsigned i = 0; i < stream->loadMip; i++)
+            offset += residency.mipSizes[i];
+
+        uint64_t size = residency.size(stream->loadMip) - residency.size(stream->loadEndMip);
+        stream->loadData.reset(new uint8_t[size]);
+
+        std::unique_ptr<DataStream> data(g_assetManager->openData(stream->path));
+        stream->loadSucceeded = data && data->read(stream->loadData.get(), size, offset);
+
+        if (data && !stream->loadSucceeded)
+            logError("%s: Failed to read texture data", stream->path.c_str());
+
+        {
+            std::lock_guard<std::mutex> lock(m_queueLock);
+            m_completeQueue.push_back(stream);
+        }
+    }
+}
+
+/** Render the texture streaming debug window. */
+void TextureStreamingManager::explore() {
+    int budget = m_budget / (1024 * 1024);
+    if (ImGui::SliderInt("Budget (MiB)", &budget, 16, 4096))
+        m_budget = static_cast<uint64_t>(budget) * 1024 * 1024;
+
+    ImGui::Text("Resident: %.1f MiB", toMiB(m_residentSize));
+    ImGui::Text("Target: %.1f MiB", toMiB(m_stats.targetSize));
+    ImGui::Text("Requested: %.1f MiB", toMiB(m_stats.requestedSize));
+    ImGui::Text("Limited by budget: %u / %zu textures", m_stats.numLimited, m_streams.size());
+    ImGui::Text("Loading: %u", m_numLoading);
+
+    ImGui::Separator();
+
+    ImGui::Columns(4);
+    ImGui::Text("Texture"); ImGui::NextColumn();
+    ImGui::Text("Resident"); ImGui::NextColumn();
+    ImGui::Text("Target"); ImGui::NextColumn();
+    ImGui::Text("Requested"); ImGui::NextColumn();
+    ImGui::Separator();
+
+    for (TextureStream *stream : m_streams) {
+        const TextureResidency &residency = stream->residency;
+
+        ImGui::Text("%s", stream->path.c_str());
+        ImGui::NextColumn();
+
+        for (unsigned mip : { residency.residentMip, residency.targetMip, residency.requestedMip }) {
+            ImGui::Text("%ux%u", std::max(stream->width >> mip, 1u), std::max(stream->height >> mip, 1u));
+            ImGui::NextColumn();
+        }
+    }
+
+    ImGui::Columns(1);
+}
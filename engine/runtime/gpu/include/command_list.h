@@ -138,11 +138,26 @@ public:
      * Commands.
      */
 
-    /** Draw primitives.
+    /**
+     * Draw primitives.
+     *
+     * Draws primitives from the given vertex and index data. If an instance
+     * count greater than 1 is given, the primitives are drawn that many times
+     * in a single draw call. Attributes from bindings of the vertex data which
+     * are marked as instanced advance once per instance, starting from the
+     * element given by the first instance index.
+     *
      * @param type          Primitive type to render.
      * @param vertices      Vertex data to use.
-     * @param indices       Index data to use (can be null). */
-    virtual void draw(PrimitiveType type, GPUVertexData *vertices, GPUIndexData *indices) = 0;
+     * @param indices       Index data to use (can be null).
+     * @param instances     Number of instances to draw.
+     * @param firstInstance Index of the first instance to draw.
+     */
+    virtual void draw(PrimitiveType type,
+                      GPUVertexData *vertices,
+                      GPUIndexData *indices,
+                      unsigned instances = 1,
+                      unsigned firstInstance = 0) = 0;
 
     /** Begin a query.
      * @param queryPool     Query pool the query is in.
@@ -205,7 +220,11 @@ public:
     GPUCommandList *createChild(uint32_t inherit) override;
     void submitChild(GPUCommandList *cmdList) override;
 
-    void draw(PrimitiveType type, GPUVertexData *vertices, GPUIndexData *indices) override;
+    void draw(PrimitiveType type,
+              GPUVertexData *vertices,
+              GPUIndexData *indices,
+              unsigned instances,
+              unsigned firstInstance) override;
     void endQuery(GPUQueryPool *queryPool, uint32_t index) override;
 
     void beginDebugGroup(const std::string &str) override;
@@ -221,7 +240,11 @@ public:
         virtual void setRasterizerState(GPURasterizerState *state) = 0;
         virtual void setViewport(const IntRect &viewport) = 0;
         virtual void setScissor(bool enable, const IntRect &scissor) = 0;
-        virtual void draw(PrimitiveType type, GPUVertexData *vertices, GPUIndexData *indices) = 0;
+        virtual void draw(PrimitiveType type,
+                          GPUVertexData *vertices,
+                          GPUIndexData *indices,
+                          unsigned instances,
+                          unsigned firstInstance) = 0;
         virtual void endQuery(GPUQueryPool *queryPool, uint32_t index) = 0;
         virtual void beginDebugGroup(const std::string &str) = 0;
         virtual void endDebugGroup() = 0;
@@ -299,6 +322,8 @@ private:
         PrimitiveType type;
         GPUVertexDataPtr vertices;
         GPUIndexDataPtr indices;
+        unsigned instances;
+        unsigned firstInstance;
 
         CommandDraw() : Command(kDraw) {}
     };
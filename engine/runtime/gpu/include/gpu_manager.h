@@ -113,6 +113,13 @@ public:
      * @return              Pointer to created program. */
     virtual GPUProgramPtr createProgram(GPUProgramDesc &&desc) = 0;
 
+    /**
+     * Capability methods.
+     */
+
+    /** @return             Maximum width and height of a 2D texture. */
+    virtual uint32_t maxTextureSize() const = 0;
+
     /**
      * Frame methods.
      */
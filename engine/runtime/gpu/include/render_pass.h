@@ -42,17 +42,33 @@ enum class GPURenderLoadOp {
     kDontCare,                          /**< Don't care about the existing value, will be undefined. */
 };
 
+/**
+ * Possible ways to treat attachment contents at end of pass.
+ *
+ * This is a hint: if the contents are not needed after the pass, some
+ * implementations can avoid writing them back to memory. Implementations which
+ * cannot make use of this always store the contents.
+ */
+enum class GPURenderStoreOp {
+    kStore,                             /**< Preserve the contents written by the pass. */
+    kDontCare,                          /**< Contents are not needed after the pass, will be undefined. */
+};
+
 /** Structure describing a render pass attachment. */
 struct GPURenderAttachmentDesc {
     PixelFormat format;                 /**< Pixel format of the attachment. */
     GPURenderLoadOp loadOp;             /**< How to treat existing colour/depth target contents at start of pass. */
     GPURenderLoadOp stencilLoadOp;      /**< How to treat existing stencil target contents at start of pass. */
+    GPURenderStoreOp storeOp;           /**< How to treat colour/depth target contents at end of pass. */
+    GPURenderStoreOp stencilStoreOp;    /**< How to treat stencil target contents at end of pass. */
 
     /** Initialise as an unused attachment. */
     GPURenderAttachmentDesc() :
-        format        (PixelFormat::kUnknown),
-        loadOp        (GPURenderLoadOp::kDontCare),
-        stencilLoadOp (GPURenderLoadOp::kDontCare)
+        format         (PixelFormat::kUnknown),
+        loadOp         (GPURenderLoadOp::kDontCare),
+        stencilLoadOp  (GPURenderLoadOp::kDontCare),
+        storeOp        (GPURenderStoreOp::kStore),
+        stencilStoreOp (GPURenderStoreOp::kStore)
     {}
 
     /** @return             Whether this is a used attachment. */
@@ -62,7 +78,12 @@ struct GPURenderAttachmentDesc {
 
     /** Compare this descriptor with another. */
     bool operator ==(const GPURenderAttachmentDesc &other) const {
-        return format == other.format && loadOp == other.loadOp && stencilLoadOp == other.stencilLoadOp;
+        return
+            format == other.format &&
+            loadOp == other.loadOp &&
+            stencilLoadOp == other.stencilLoadOp &&
+            storeOp == other.storeOp &&
+            stencilStoreOp == other.stencilStoreOp;
     }
 
     /** Get a hash from a render pass attachment descriptor. */
@@ -70,6 +91,8 @@ struct GPURenderAttachmentDesc {
         size_t hash = hashValue(desc.format);
         hash = hashCombine(hash, desc.loadOp);
         hash = hashCombine(hash, desc.stencilLoadOp);
+        hash = hashCombine(hash, desc.storeOp);
+        hash = hashCombine(hash, desc.stencilStoreOp);
         return hash;
     }
 };
@@ -87,6 +110,25 @@ struct GPURenderPassDesc {
     explicit GPURenderPassDesc(size_t numColour = 0) :
         colourAttachments(numColour)
     {}
+
+    /** Compare this descriptor with another. */
+    bool operator ==(const GPURenderPassDesc &other) const {
+        return
+            colourAttachments == other.colourAttachments &&
+            depthStencilAttachment == other.depthStencilAttachment;
+    }
+
+    /** Get a hash from a render pass descriptor. */
+    friend size_t hashValue(const GPURenderPassDesc &desc) {
+        size_t hash = hashValue(desc.colourAttachments.size());
+
+        for (const GPURenderAttachmentDesc &attachment : desc.colourAttachments)
+            hash = hashCombine(hash, attachment);
+
+        hash = hashCombine(hash, desc.depthStencilAttachment);
+
+        return hash;
+    }
 };
 
 /**
@@ -30,20 +30,36 @@
  * Structure describing a vertex buffer binding.
  *
  * This structure describes layout information for a buffer to be used with a
- * vertex format. Currently it only defines the stride between each vertex,
- * everything else is described by the attributes.
+ * vertex format. It defines the stride between each element and whether the
+ * buffer is indexed per-vertex or per-instance, everything else is described
+ * by the attributes.
  */
 struct VertexBinding {
     size_t stride;                  /**< Offset between each vertex. */
 
+    /**
+     * Whether the binding is indexed per-instance.
+     *
+     * If true, attributes in the binding advance once per instance of an
+     * instanced draw rather than once per vertex.
+     */
+    bool instanced;
+
+    VertexBinding() :
+        stride    (0),
+        instanced (false)
+    {}
+
     /** Compare this descriptor with another. */
     bool operator ==(const VertexBinding &other) const {
-        return stride == other.stride;
+        return stride == other.stride && instanced == other.instanced;
     }
 
     /** Get a hash from a vertex binding descriptor. */
     friend size_t hashValue(const VertexBinding &desc) {
-        return hashValue(desc.stride);
+        size_t hash = hashValue(desc.stride);
+        hash = hashCombine(hash, desc.instanced);
+        return hash;
     }
 };
 
@@ -65,6 +81,7 @@ struct VertexAttribute {
         kTexcoordSemantic,          /**< Texture coordinates. */
         kDiffuseSemantic,           /**< Diffuse colour. */
         kSpecularSemantic,          /**< Specular colour. */
+        kTransformSemantic,         /**< Per-instance transformation matrix row. */
     };
 
     /** Enumeration of attribute data types. */
@@ -77,6 +94,8 @@ struct VertexAttribute {
         kUnsignedIntType,           /**< Unsigned 32-bit integer. */
         kFloatType,                 /**< Single-precision floating point. */
         kDoubleType,                /**< Double-precision floating point. */
+        kHalfFloatType,             /**< Half-precision floating point. */
+        kInt1010102Type,            /**< Packed signed 10:10:10:2 integer (4 components only). */
         kNumTypes,
     };
 
@@ -109,6 +128,10 @@ struct VertexAttribute {
                 return sizeof(float) * components;
             case kDoubleType:
                 return sizeof(double) * components;
+            case kHalfFloatType:
+                return sizeof(uint16_t) * components;
+            case kInt1010102Type:
+                return sizeof(uint32_t);
             default:
                 return 0;
         }
@@ -330,8 +330,15 @@ void GPUGenericCommandList::submitChild(GPUCommandList *cmdList) {
 /** Draw primitives.
  * @param type          Primitive type to render.
  * @param vertices      Vertex data to use.
- * @param indices       Index data to use (can be null). */
-void GPUGenericCommandList::draw(PrimitiveType type, GPUVertexData *vertices, GPUIndexData *indices) {
+ * @param indices       Index data to use (can be null).
+ * @param instances     Number of instances to draw.
+ * @param firstInstance Index of the first instance to draw. */
+void GPUGenericCommandList::draw(PrimitiveType type,
+                                 GPUVertexData *vertices,
+                                 GPUIndexData *indices,
+                                 unsigned instances,
+                                 unsigned firstInstance)
+{
     check(m_state.pipeline);
 
     /* Generate commands to apply state. This is delayed until it is actually
@@ -398,6 +405,8 @@ void GPUGenericCommandList::draw(PrimitiveType type, GPUVertexData *vertices, GP
     command->type = type;
     command->vertices = vertices;
     command->indices = indices;
+    command->instances = instances;
+    command->firstInstance = firstInstance;
     m_commands.push_back(command);
 }
 
@@ -482,7 +491,11 @@ void GPUGenericCommandList::execute(Context *context) {
             case Command::kDraw:
             {
                 auto command = static_cast<CommandDraw *>(baseCommand);
-                context->draw(command->type, command->vertices, command->indices);
+                context->draw(command->type,
+                              command->vertices,
+                              command->indices,
+                              command->instances,
+                              command->firstInstance);
                 break;
             }
 
@@ -62,7 +62,6 @@ void GLGPUManager::blit(const GPUTextureImageRef &source,
     check(source && dest);
     check(!m_currentRenderPass);
 
-    // TODO: use ARB_copy_image where supported.
     // TODO: validate dimensions? against correct mip level
 
     /* If copying a depth texture, both formats must match. */
@@ -79,6 +78,20 @@ void GLGPUManager::blit(const GPUTextureImageRef &source,
      * sRGB conversion won't be done on reads. */
     check(!destTexture->isMainWindow() || !PixelFormat::isSRGB(source.texture->format()));
 
+    /* Copy directly between textures of the same format. This also works for
+     * compressed formats, which cannot be attached to a framebuffer. */
+    if (!sourceTexture->isMainWindow() &&
+        !destTexture->isMainWindow() &&
+        source.texture->format() == dest.texture->format())
+    {
+        glCopyImageSubData(sourceTexture->texture(), sourceTexture->glTarget(),
+                           source.mip, sourcePos.x, sourcePos.y, source.layer,
+                           destTexture->texture(), destTexture->glTarget(),
+                           dest.mip, destPos.x, destPos.y, dest.layer,
+                           size.x, size.y, 1);
+        return;
+    }
+
     /* Preserve current framebuffer state. */
     GLuint prevDrawFBO = this->state.boundDrawFramebuffer;
     GLuint prevReadFBO = this->state.boundReadFramebuffer;
@@ -287,8 +300,15 @@ void GLGPUManager::setScissor(bool enable, const IntRect &scissor) {
 /** Draw primitives.
  * @param type          Primitive type to render.
  * @param _vertices     Vertex data to use.
- * @param indices       Index data to use (can be null). */
-void GLGPUManager::draw(PrimitiveType type, GPUVertexData *vertices, GPUIndexData *indices) {
+ * @param indices       Index data to use (can be null).
+ * @param instances     Number of instances to draw.
+ * @param firstInstance Index of the first instance to draw. */
+void GLGPUManager::draw(PrimitiveType type,
+                        GPUVertexData *vertices,
+                        GPUIndexData *indices,
+                        unsigned instances,
+                        unsigned firstInstance)
+{
     GLVertexData *glVertices = static_cast<GLVertexData *>(vertices);
 
     /* Bind the VAO and the index buffer (if any). */
@@ -314,15 +334,18 @@ void GLGPUManager::draw(PrimitiveType type, GPUVertexData *vertices, GPUIndexDat
     GLenum mode = GLUtil::convertPrimitiveType(type);
     if (indices) {
         /* FIXME: Check whether index type is supported (in generic code?) */
-        glDrawElements(mode,
-                       indices->count(),
-                       GLUtil::convertIndexType(indices->type()),
-                       reinterpret_cast<void *>(indices->offset() * indices->elementSize()));
+        glDrawElementsInstancedBaseInstance(mode,
+                                            indices->count(),
+                                            GLUtil::convertIndexType(indices->type()),
+                                            reinterpret_cast<void *>(indices->offset() * indices->elementSize()),
+                                            instances,
+                                            firstInstance);
     } else {
-        glDrawArrays(mode, 0, vertices->count());
+        glDrawArraysInstancedBaseInstance(mode, 0, vertices->count(), instances, firstInstance);
     }
 
     g_engine->stats().drawCalls++;
+    g_engine->stats().drawInstances += instances;
 }
 
 /**
@@ -35,9 +35,13 @@ static const int kGLMaxMinorVersion = 5;
 
 /** Required OpenGL extensions. */
 static const char *g_requiredGLExtensions[] = {
+    "GL_ARB_base_instance",
+    "GL_ARB_copy_image",
     "GL_ARB_separate_shader_objects",
+    "GL_ARB_texture_compression_bptc",
     "GL_ARB_texture_storage",
     "GL_ARB_texture_view",
+    "GL_EXT_texture_compression_s3tc",
     "GL_EXT_texture_filter_anisotropic",
 };
 
@@ -232,6 +236,7 @@ void GLGPUManager::initFeatures() {
     glGetIntegerv(GL_MINOR_VERSION, &features.versionMinor);
     glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &features.maxAnisotropy);
     glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &features.maxTextureUnits);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &features.maxTextureSize);
 }
 
 /** Initialize the supported pixel format conversion table. */
@@ -258,6 +263,14 @@ void GLGPUManager::initPixelFormats() {
     f[PixelFormat::kFloatR32G32B32]    = { GL_RGB32F,             GL_RGB,             GL_FLOAT };
     f[PixelFormat::kFloatR32G32]       = { GL_RG32F,              GL_RG,              GL_FLOAT };
     f[PixelFormat::kFloatR32]          = { GL_R32F,               GL_RED,             GL_FLOAT };
+    f[PixelFormat::kBC1]               = { GL_COMPRESSED_RGB_S3TC_DXT1_EXT };
+    f[PixelFormat::kBC1sRGB]           = { GL_COMPRESSED_SRGB_S3TC_DXT1_EXT };
+    f[PixelFormat::kBC3]               = { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
+    f[PixelFormat::kBC3sRGB]           = { GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT };
+    f[PixelFormat::kBC4]               = { GL_COMPRESSED_RED_RGTC1 };
+    f[PixelFormat::kBC5]               = { GL_COMPRESSED_RG_RGTC2 };
+    f[PixelFormat::kBC7]               = { GL_COMPRESSED_RGBA_BPTC_UNORM };
+    f[PixelFormat::kBC7sRGB]           = { GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM };
     f[PixelFormat::kDepth16]           = { GL_DEPTH_COMPONENT16,  GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT };
     f[PixelFormat::kDepth32]           = { GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT };
     f[PixelFormat::kDepth32Stencil8]   = { GL_DEPTH32F_STENCIL8,  GL_DEPTH_STENCIL,   GL_FLOAT_32_UNSIGNED_INT_24_8_REV };
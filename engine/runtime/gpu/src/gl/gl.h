@@ -68,6 +68,7 @@ struct GLFeatures {
     /** Cached glGet* parameters. */
     GLfloat maxAnisotropy;              /**< GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT */
     GLint maxTextureUnits;              /**< GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS */
+    GLint maxTextureSize;               /**< GL_MAX_TEXTURE_SIZE */
 
     /** Check whether an extension is supported.
      * @param extension     Extension to check for.
@@ -87,8 +88,8 @@ struct GLFeatures {
 /** Structure mapping PixelFormat to GL types. */
 struct GLPixelFormat {
     GLenum internalFormat;              /**< Internal texture format. */
-    GLenum format;                      /**< Pixel data format. */
-    GLenum type;                        /**< Pixel data type. */
+    GLenum format;                      /**< Pixel data format (none if compressed). */
+    GLenum type;                        /**< Pixel data type (none if compressed). */
 public:
     GLPixelFormat(GLenum i = GL_NONE, GLenum f = GL_NONE, GLenum t = GL_NONE) :
         internalFormat(i),
@@ -122,6 +123,8 @@ public:
     GPUResourceSetLayoutPtr createResourceSetLayout(GPUResourceSetLayoutDesc &&desc) override;
     GPUProgramPtr createProgram(GPUProgramDesc &&desc) override;
 
+    uint32_t maxTextureSize() const override { return this->features.maxTextureSize; }
+
     void endFrame() override;
 
     void blit(const GPUTextureImageRef &source,
@@ -145,7 +148,11 @@ public:
     void setViewport(const IntRect &viewport) override;
     void setScissor(bool enable, const IntRect &scissor) override;
 
-    void draw(PrimitiveType type, GPUVertexData *vertices, GPUIndexData *indices) override;
+    void draw(PrimitiveType type,
+              GPUVertexData *vertices,
+              GPUIndexData *indices,
+              unsigned instances,
+              unsigned firstInstance) override;
 
     void endQuery(GPUQueryPool *queryPool, uint32_t index) override;
 
@@ -227,6 +234,10 @@ namespace GLUtil {
                 return GL_FLOAT;
             case VertexAttribute::kDoubleType:
                 return GL_DOUBLE;
+            case VertexAttribute::kHalfFloatType:
+                return GL_HALF_FLOAT;
+            case VertexAttribute::kInt1010102Type:
+                return GL_INT_2_10_10_10_REV;
             default:
                 return 0;
         }
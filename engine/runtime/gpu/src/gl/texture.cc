@@ -156,24 +156,47 @@ void GLTexture::update(const IntRect &area, const void *data, unsigned mip, unsi
 
     bindForModification();
 
+    /* Block compressed data must be supplied with the compressed variants,
+     * which take the data size rather than a format and type. */
+    const bool isCompressed = PixelFormat::isCompressed(m_format);
+    const GLsizei dataSize = PixelFormat::imageSize(m_format, area.width, area.height);
+
     if (m_type == kTexture2DArray) {
-        glTexSubImage3D(m_glTarget, 
-                        mip,
-                        area.x, area.y, layer, area.width, area.height, 1,
-                        g_opengl->pixelFormats[m_format].format,
-                        g_opengl->pixelFormats[m_format].type,
-                        data);
+        if (isCompressed) {
+            glCompressedTexSubImage3D(m_glTarget,
+                                      mip,
+                                      area.x, area.y, layer, area.width, area.height, 1,
+                                      g_opengl->pixelFormats[m_format].internalFormat,
+                                      dataSize,
+                                      data);
+        } else {
+            glTexSubImage3D(m_glTarget, 
+                            mip,
+                            area.x, area.y, layer, area.width, area.height, 1,
+                            g_opengl->pixelFormats[m_format].format,
+                            g_opengl->pixelFormats[m_format].type,
+                            data);
+        }
     } else {
         GLenum target = (m_type == kTextureCube)
                             ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer
                             : m_glTarget;
 
-        glTexSubImage2D(target, 
-                        mip,
-                        area.x, area.y, area.width, area.height,
-                        g_opengl->pixelFormats[m_format].format,
-                        g_opengl->pixelFormats[m_format].type,
-                        data);
+        if (isCompressed) {
+            glCompressedTexSubImage2D(target,
+                                      mip,
+                                      area.x, area.y, area.width, area.height,
+                                      g_opengl->pixelFormats[m_format].internalFormat,
+                                      dataSize,
+                                      data);
+        } else {
+            glTexSubImage2D(target, 
+                            mip,
+                            area.x, area.y, area.width, area.height,
+                            g_opengl->pixelFormats[m_format].format,
+                            g_opengl->pixelFormats[m_format].type,
+                            data);
+        }
     }
 }
 
@@ -184,6 +207,7 @@ void GLTexture::update(const IntRect &area, const void *data, unsigned mip, unsi
 void GLTexture::update(const IntBox &area, const void *data, unsigned mip) {
     check(m_type == kTexture3D);
     check(mip < m_mips);
+    check(!PixelFormat::isCompressed(m_format));
 
     if (!area.width || !area.height || !area.depth)
         return;
@@ -58,6 +58,7 @@ GLVertexData::GLVertexData(GPUVertexDataDesc &&desc) :
 
         glEnableVertexAttribArray(index);
         glVertexAttribPointer(index, attribute.components, type, attribute.normalised, binding.stride, offset);
+        glVertexAttribDivisor(index, (binding.instanced) ? 1 : 0);
     }
 }
 
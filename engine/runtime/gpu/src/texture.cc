@@ -45,6 +45,11 @@ GPUTexture::GPUTexture(const GPUTextureDesc &desc) :
     if (m_type == kTextureCube)
         check(m_width == m_height);
 
+    /* Block compressed textures cannot be rendered to, so all of their mip
+     * levels must be supplied with update(). */
+    if (PixelFormat::isCompressed(m_format))
+        check(!(m_flags & (kAutoMipmap | kRenderTarget)));
+
     /* Clamp number of mip levels to a valid range. */
     uint32_t width = m_width;
     uint32_t height = m_height;
@@ -54,14 +54,18 @@ unsigned VertexAttribute::glslIndex(Semantic semantic, unsigned index) {
             checkMsg(index < 2, "Exceeded maximum number of tangent attributes");
             return 4 + index;
         case kTexcoordSemantic:
-            checkMsg(index < 6, "Exceeded maximum number of texture coordinate attributes");
+            checkMsg(index < 4, "Exceeded maximum number of texture coordinate attributes");
             return 6 + index;
         case kDiffuseSemantic:
             checkMsg(index < 2, "Exceeded maximum number of diffuse colour attributes");
-            return 12 + index;
+            return 10 + index;
         case kSpecularSemantic:
-            checkMsg(index < 2, "Exceeded maximum number of specular colour attributes");
-            return 14 + index;
+            checkMsg(index < 1, "Exceeded maximum number of specular colour attributes");
+            return 12 + index;
+        case kTransformSemantic:
+            /* 3 rows of an affine transformation. */
+            checkMsg(index < 3, "Exceeded maximum number of transform attributes");
+            return 13 + index;
         default:
             unreachable();
     }
@@ -123,8 +123,15 @@ void VulkanCommandList::prepareCmdBuf() {
 /** Draw primitives.
  * @param type          Primitive type to render.
  * @param vertices      Vertex data to use.
- * @param indices       Index data to use (can be null). */
-void VulkanCommandList::draw(PrimitiveType type, GPUVertexData *vertices, GPUIndexData *indices) {
+ * @param indices       Index data to use (can be null).
+ * @param instances     Number of instances to draw.
+ * @param firstInstance Index of the first instance to draw. */
+void VulkanCommandList::draw(PrimitiveType type,
+                             GPUVertexData *vertices,
+                             GPUIndexData *indices,
+                             unsigned instances,
+                             unsigned firstInstance)
+{
     check(m_cmdState.pending.pipeline);
 
     prepareCmdBuf();
@@ -237,12 +244,18 @@ void VulkanCommandList::draw(PrimitiveType type, GPUVertexData *vertices, GPUInd
 
     /* Perform the draw! */
     if (indices) {
-        vkCmdDrawIndexed(m_cmdState.cmdBuf->handle(), indices->count(), 1, indices->offset(), 0, 0);
+        vkCmdDrawIndexed(m_cmdState.cmdBuf->handle(),
+                         indices->count(),
+                         instances,
+                         indices->offset(),
+                         0,
+                         firstInstance);
     } else {
-        vkCmdDraw(m_cmdState.cmdBuf->handle(), vertices->count(), 1, 0, 0);
+        vkCmdDraw(m_cmdState.cmdBuf->handle(), vertices->count(), instances, 0, firstInstance);
     }
 
     g_engine->stats().drawCalls++;
+    g_engine->stats().drawInstances += instances;
 }
 
 /** End a query.
@@ -67,7 +67,11 @@ public:
     GPUCommandList *createChild(uint32_t inherit) override;
     void submitChild(GPUCommandList *cmdList) override;
 
-    void draw(PrimitiveType type, GPUVertexData *vertices, GPUIndexData *indices) override;
+    void draw(PrimitiveType type,
+              GPUVertexData *vertices,
+              GPUIndexData *indices,
+              unsigned instances,
+              unsigned firstInstance) override;
     void endQuery(GPUQueryPool *queryPool, uint32_t index) override;
 
     void beginDebugGroup(const std::string &str) override;
@@ -361,6 +361,14 @@ void VulkanGPUManager::initFeatures() {
     initFormat(PixelFormat::kFloatR32G32B32,    VK_FORMAT_R32G32B32_SFLOAT);
     initFormat(PixelFormat::kFloatR32G32,       VK_FORMAT_R32G32_SFLOAT);
     initFormat(PixelFormat::kFloatR32,          VK_FORMAT_R32_SFLOAT);
+    initFormat(PixelFormat::kBC1,               VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+    initFormat(PixelFormat::kBC1sRGB,           VK_FORMAT_BC1_RGB_SRGB_BLOCK);
+    initFormat(PixelFormat::kBC3,               VK_FORMAT_BC3_UNORM_BLOCK);
+    initFormat(PixelFormat::kBC3sRGB,           VK_FORMAT_BC3_SRGB_BLOCK);
+    initFormat(PixelFormat::kBC4,               VK_FORMAT_BC4_UNORM_BLOCK);
+    initFormat(PixelFormat::kBC5,               VK_FORMAT_BC5_UNORM_BLOCK);
+    initFormat(PixelFormat::kBC7,               VK_FORMAT_BC7_UNORM_BLOCK);
+    initFormat(PixelFormat::kBC7sRGB,           VK_FORMAT_BC7_SRGB_BLOCK);
     initFormat(PixelFormat::kDepth16,           VK_FORMAT_D16_UNORM);
     initFormat(PixelFormat::kDepth32,           VK_FORMAT_D32_SFLOAT);
     initFormat(PixelFormat::kDepth32Stencil8,   VK_FORMAT_D32_SFLOAT_S8_UINT);
@@ -424,6 +432,11 @@ void VulkanGPUManager::cleanupFrames(bool shutdown) {
     }
 }
 
+/** @return             Maximum width and height of a 2D texture. */
+uint32_t VulkanGPUManager::maxTextureSize() const {
+    return m_device->limits().maxImageDimension2D;
+}
+
 /** End a frame and present it on screen. */
 void VulkanGPUManager::endFrame() {
     VulkanFrame &completedFrame = currentFrame();
@@ -105,6 +105,8 @@ public:
     GPUResourceSetPtr createResourceSet(GPUResourceSetLayout *layout) override;
     GPUProgramPtr createProgram(GPUProgramDesc &&desc) override;
 
+    uint32_t maxTextureSize() const override;
+
     void endFrame() override;
 
     void blit(const GPUTextureImageRef &source,
@@ -355,6 +355,20 @@ static const VkFormat kAttributeFormats[VertexAttribute::kNumTypes][4][2] = {
         { VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_UNDEFINED },
         { VK_FORMAT_R64G64B64A64_SFLOAT, VK_FORMAT_UNDEFINED },
     },
+    /* kHalfFloatType */
+    {
+        { VK_FORMAT_R16_SFLOAT, VK_FORMAT_UNDEFINED },
+        { VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_UNDEFINED },
+        { VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_UNDEFINED },
+        { VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_UNDEFINED },
+    },
+    /* kInt1010102Type */
+    {
+        { VK_FORMAT_UNDEFINED, VK_FORMAT_UNDEFINED },
+        { VK_FORMAT_UNDEFINED, VK_FORMAT_UNDEFINED },
+        { VK_FORMAT_UNDEFINED, VK_FORMAT_UNDEFINED },
+        { VK_FORMAT_A2B10G10R10_SINT_PACK32, VK_FORMAT_A2B10G10R10_SNORM_PACK32 },
+    },
 };
 
 /** Initialise the vertex data layout.
@@ -367,8 +381,9 @@ VulkanVertexDataLayout::VulkanVertexDataLayout(const GPUVertexDataLayoutDesc &de
     for (size_t i = 0; i < m_bindings.size(); i++) {
         m_bindings[i].binding = i;
         m_bindings[i].stride = m_desc.bindings[i].stride;
-        // TODO: instancing
-        m_bindings[i].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        m_bindings[i].inputRate = (m_desc.bindings[i].instanced)
+                                      ? VK_VERTEX_INPUT_RATE_INSTANCE
+                                      : VK_VERTEX_INPUT_RATE_VERTEX;
     }
 
     m_attributes.resize(m_desc.attributes.size());
@@ -49,6 +49,18 @@ VulkanRenderPass::VulkanRenderPass(VulkanGPUManager *manager, GPURenderPassDesc
             }
         };
 
+    auto convertStoreOp =
+        [&] (GPURenderStoreOp inStoreOp) -> VkAttachmentStoreOp {
+            switch (inStoreOp) {
+                case GPURenderStoreOp::kStore:
+                    return VK_ATTACHMENT_STORE_OP_STORE;
+                case GPURenderStoreOp::kDontCare:
+                    return VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                default:
+                    unreachable();
+            }
+        };
+
     auto addAttachment =
         [&] (const GPURenderAttachmentDesc &inAttachment, bool depthStencil) {
             attachments.emplace_back();
@@ -67,9 +79,9 @@ VulkanRenderPass::VulkanRenderPass(VulkanGPUManager *manager, GPURenderPassDesc
 
             attachment.samples = VK_SAMPLE_COUNT_1_BIT;
             attachment.loadOp = convertLoadOp(inAttachment.loadOp);
-            attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            attachment.storeOp = convertStoreOp(inAttachment.storeOp);
             attachment.stencilLoadOp = convertLoadOp(inAttachment.stencilLoadOp);
-            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+            attachment.stencilStoreOp = convertStoreOp(inAttachment.stencilStoreOp);
 
             if (depthStencil) {
                 attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
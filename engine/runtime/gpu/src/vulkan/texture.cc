@@ -252,7 +252,7 @@ void VulkanTexture::update(const IntRect &area, const void *data, unsigned mip,
     auto stagingCmdBuf = memoryManager->getStagingCmdBuf();
 
     /* Allocate a staging buffer large enough and copy to it. */
-    VkDeviceSize dataSize = areaWidth * areaHeight * PixelFormat::bytesPerPixel(m_format);
+    VkDeviceSize dataSize = PixelFormat::imageSize(m_format, areaWidth, areaHeight);
     VulkanMemoryManager::StagingMemory *staging = memoryManager->allocateStagingMemory(dataSize);
     memcpy(staging->map(), data, dataSize);
 
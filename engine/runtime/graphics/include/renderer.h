@@ -44,6 +44,21 @@ public:
 
     /** @return             Whether the rendered object casts a shadow. */
     bool castsShadow() const { return m_castsShadow; }
+
+    /**
+     * Whether the rendered object is an occluder.
+     *
+     * Occluders hide other objects behind them from rendering. The bounding
+     * box of the object is used as its occluder geometry, so this should only
+     * be enabled for solid objects which fill their bounding box, such as
+     * walls, floors and boxes.
+     */
+    VPROPERTY(bool, occluder);
+
+    void setOccluder(bool occluder);
+
+    /** @return             Whether the rendered object is an occluder. */
+    bool occluder() const { return m_occluder; }
 protected:
     /** Type of a renderer entity list. */
     using RenderEntityList = std::list<RenderEntity *>;
@@ -66,8 +81,11 @@ protected:
      * @param entities      List to populate.
      */
     virtual void createRenderEntities(RenderEntityList &entities) = 0;
+private:
+    void updateOccluder(RenderEntity *renderEntity) const;
 private:
     bool m_castsShadow;            /**< Whether the object casts a shadow. */
+    bool m_occluder;               /**< Whether the object is an occluder. */
 
     /** List of renderer entities. */
     RenderEntityList m_renderEntities;
@@ -28,6 +28,7 @@
 #include "graphics/mesh_renderer.h"
 
 #include "render/render_entity.h"
+#include "render/render_view.h"
 
 #include "render_core/geometry.h"
 
@@ -36,11 +37,15 @@ class SubMeshRenderEntity : public RenderEntity {
 public:
     SubMeshRenderEntity(Mesh &mesh, size_t index, MeshRenderer &parent);
 
-    Geometry geometry() const override;
+    bool cullClusters(RenderView &view, unsigned lod, GPUIndexDataPtr &outIndices) override;
+    Geometry geometry(unsigned lod) const override;
     Material *material() const override;
 private:
     SubMesh &m_subMesh;             /**< Submesh to render. */
     MeshRenderer &m_parent;         /**< Parent mesh renderer. */
+
+    /** Visible clusters, kept to avoid reallocating on each cull. */
+    std::vector<uint32_t> m_visibleClusters;
 };
 
 /** Initialize the entity.
@@ -52,19 +57,60 @@ SubMeshRenderEntity::SubMeshRenderEntity(Mesh &mesh, size_t index, MeshRenderer
     m_parent  (parent)
 {
     setBoundingBox(m_subMesh.boundingBox);
+    setVertexTransform(mesh.positionTransform());
+
+    std::vector<float> lodErrors;
+    for (size_t i = 1; i < m_subMesh.numLODs(); i++)
+        lodErrors.push_back(m_subMesh.lodError(i));
+
+    setLODs(lodErrors);
 
     this->name = String::format("MeshRenderer '%s' SubMesh %zu",
                                 m_parent.entity()->path().c_str(),
                                 index);
 }
 
+/** Cull clusters of the submesh.
+ * @param view          View to cull against.
+ * @param lod           Level of detail that will be drawn.
+ * @param outIndices    Where to store index data for visible clusters.
+ * @return              False if nothing of the entity is visible. */
+bool SubMeshRenderEntity::cullClusters(RenderView &view, unsigned lod, GPUIndexDataPtr &outIndices) {
+    /* Only the full detail submesh is clustered. Lower levels are used when
+     * the mesh is small on screen, where culling is less worthwhile. */
+    if (lod != 0 || m_subMesh.clusters().empty())
+        return true;
+
+    /* Cull in the mesh's local space. An orthographic view (e.g. a shadow
+     * cascade) sees everything from the same direction, rather than from its
+     * position, so pass its direction as a position at infinity. */
+    const glm::mat4 &matrix     = transform().matrix();
+    const glm::mat4 localMatrix = view.viewProjection() * matrix;
+    const Frustum frustum(localMatrix, glm::inverse(localMatrix));
+    const glm::vec4 position    = (view.isOrthographic())
+                                      ? glm::vec4(view.orientation() * glm::vec3(0.0f, 0.0f, -1.0f), 0.0f)
+                                      : glm::vec4(view.position(), 1.0f);
+    const glm::vec4 localPosition = glm::inverse(matrix) * position;
+
+    m_subMesh.cullClusters(frustum, localPosition, m_visibleClusters);
+
+    if (m_visibleClusters.empty())
+        return false;
+
+    if (m_visibleClusters.size() < m_subMesh.clusters().size())
+        outIndices = m_subMesh.buildClusterIndices(m_visibleClusters);
+
+    return true;
+}
+
 /** Get the geometry for the entity.
+ * @param lod           Level of detail to get geometry for.
  * @return              Geometry for the entity. */
-Geometry SubMeshRenderEntity::geometry() const {
+Geometry SubMeshRenderEntity::geometry(unsigned lod) const {
     Geometry geometry;
 
     geometry.vertices      = m_subMesh.parent().vertices();
-    geometry.indices       = m_subMesh.indices();
+    geometry.indices       = m_subMesh.indices(lod);
     geometry.primitiveType = PrimitiveType::kTriangleList;
 
     return geometry;
@@ -29,7 +29,8 @@
 
 /** Initialise the component. */
 Renderer::Renderer() :
-    m_castsShadow(true)
+    m_castsShadow(true),
+    m_occluder(false)
 {}
 
 /** Destory the component. */
@@ -57,6 +58,27 @@ void Renderer::setCastsShadow(bool castsShadow) {
     }
 }
 
+/** Set whether the rendered object is an occluder.
+ * @param occluder      Whether the object is an occluder. */
+void Renderer::setOccluder(bool occluder) {
+    if (occluder != m_occluder) {
+        m_occluder = occluder;
+
+        for (RenderEntity *renderEntity : m_renderEntities)
+            updateOccluder(renderEntity);
+    }
+}
+
+/** Update the occluder geometry of a renderer entity.
+ * @param renderEntity  Entity to set for. */
+void Renderer::updateOccluder(RenderEntity *renderEntity) const {
+    if (m_occluder) {
+        renderEntity->setOccluder(renderEntity->boundingBox());
+    } else {
+        renderEntity->setOccluder(std::vector<glm::vec3>(), std::vector<uint16_t>());
+    }
+}
+
 /** Called when the entity's transformation is updated.
  * @param changed       Flags indicating changes made. */
 void Renderer::transformed(unsigned changed) {
@@ -78,6 +100,7 @@ void Renderer::activated() {
     for (RenderEntity *renderEntity : m_renderEntities) {
         renderEntity->setTransform(worldTransform());
         renderEntity->setFlags((m_castsShadow) ? RenderEntity::kCastsShadow : 0);
+        updateOccluder(renderEntity);
 
         renderEntity->setWorld(&system.renderWorld());
     }
@@ -35,7 +35,7 @@ class SkyboxRenderEntity : public RenderEntity {
 public:
     SkyboxRenderEntity(Skybox *parent);
 
-    Geometry geometry() const override;
+    Geometry geometry(unsigned lod) const override;
     Material *material() const override;
 private:
     Skybox *m_parent;               /**< Parent skybox. */
@@ -54,8 +54,9 @@ SkyboxRenderEntity::SkyboxRenderEntity(Skybox *parent) :
 }
 
 /** Get the geometry for the entity.
+ * @param lod           Level of detail (unused, there is only one).
  * @return              Geometry for the entity. */
-Geometry SkyboxRenderEntity::geometry() const {
+Geometry SkyboxRenderEntity::geometry(unsigned lod) const {
     /* Skybox is rendered as a quad. The transformation is ignored by the
      * shader. */
     return g_renderResources->quadGeometry();
@@ -21,12 +21,16 @@
 
 #pragma once
 
+#include "core/hash_table.h"
+
 #include "engine/global_resource.h"
 
 #include "render/draw_list.h"
+#include "render/light_clusters.h"
 #include "render/render_light.h"
 #include "render/render_pipeline.h"
 #include "render/render_world.h"
+#include "render/shadow_atlas.h"
 
 #include "render_core/material.h"
 #include "render_core/render_target_pool.h"
@@ -64,9 +68,68 @@ public:
     DeferredRenderPipeline();
     ~DeferredRenderPipeline();
 
-    /** Resolution to use for shadow maps. */
+    /**
+     * Resolution of the shadow map atlas.
+     *
+     * Shadow maps for all lights are rendered into tiles of a single texture
+     * of this size (rounded up to a power of 2). Tiles are kept across frames
+     * and only re-rendered when something affecting them has changed.
+     */
+    PROPERTY() uint16_t shadowAtlasResolution;
+
+    /**
+     * Maximum resolution of point and spot light shadow maps (per face for
+     * point lights). Lights are given a resolution up to this according to
+     * their size on screen.
+     */
     PROPERTY() uint16_t shadowMapResolution;
 
+    /** Number of shadow cascades for directional lights. */
+    PROPERTY() uint16_t shadowCascades;
+
+    /** Resolution of each directional light shadow cascade. */
+    PROPERTY() uint16_t shadowCascadeResolution;
+
+    /** Maximum distance from the view to render directional light shadows. */
+    PROPERTY() float shadowDistance;
+
+    /**
+     * Whether to use clustered lighting.
+     *
+     * When enabled, point and spot lights which do not cast shadows are binned
+     * into a view space cluster grid, and are all rendered in a single
+     * full-screen pass rather than with individual light volumes.
+     */
+    PROPERTY() bool clusteredLighting;
+
+    /**
+     * Whether to use occlusion culling.
+     *
+     * When enabled, entities which are hidden behind occluders in the main
+     * view are culled on the CPU (see RenderEntity::setOccluder()).
+     */
+    PROPERTY() bool occlusionCulling;
+
+    /**
+     * Whether to render a depth pre-pass.
+     *
+     * When enabled, the depth of opaque entities is rendered first using their
+     * shadow caster pass, and the G-Buffer is then rendered with an equal depth
+     * test so that only the visible surface of each pixel is shaded and written
+     * to the G-Buffer. Entities without a shadow caster pass are rendered to
+     * the G-Buffer afterwards with a normal depth test.
+     */
+    PROPERTY() bool depthPrePass;
+
+    /**
+     * Whether to sort opaque draws front-to-back.
+     *
+     * When enabled, the depth pre-pass and G-Buffer draws are sorted by their
+     * distance from the view, so that early depth testing can reject hidden
+     * fragments.
+     */
+    PROPERTY() bool sortFrontToBack;
+
     #if ORION_BUILD_DEBUG
 
     /** Debug options. */
@@ -81,20 +144,55 @@ private:
         /** Deferred light shader. */
         ShaderPtr lightShader;
 
-        /** Render passes. */
-        GPURenderPassPtr shadowMapPass;         /**< Shadow map pass. */
-        GPURenderPassPtr gBufferPass;           /**< G-Buffer render pass. */
-        GPURenderPassPtr lightPass;             /**< Deferred light render pass. */
-        GPURenderPassPtr basicPass;             /**< Basic render pass. */
+        /** Sampler for G-Buffer and light cluster textures. */
+        GPUSamplerStatePtr defaultSampler;
+
+        /** Sampler for the shadow map atlas. */
+        GPUSamplerStatePtr shadowMapSampler;
     public:
         Resources();
     };
 
+    /** Persistent shadow map state for a light. */
+    struct ShadowState {
+        /** State of a shadow view when its tile was last rendered. */
+        struct View {
+            bool valid;                         /**< Whether the tile has been rendered. */
+            glm::mat4 viewProjection;           /**< View-projection transformation. */
+            uint64_t casterStamp;               /**< Highest change stamp of the casters. */
+            size_t casterHash;                  /**< Hash of the set of casters. */
+        public:
+            View() : valid(false) {}
+        };
+
+        uint16_t requestedTileSize;             /**< Tile size last requested. */
+        uint16_t tileSize;                      /**< Size of the tiles (0 if none allocated). */
+        unsigned numTiles;                      /**< Number of tiles allocated. */
+        bool used;                              /**< Whether the light is being rendered. */
+
+        /** Atlas tiles for each shadow view. */
+        IntRect tiles[RenderLight::kMaxShadowViews];
+
+        /** Cached state for each shadow view. */
+        View views[RenderLight::kMaxShadowViews];
+    public:
+        ShadowState() : requestedTileSize(0), tileSize(0), numTiles(0), used(false) {}
+    };
+
     /** Per-light state. */
     struct Light {
         RenderLight *renderLight;               /**< Light object. */
         GPUResourceSet *resources;              /**< Resources for the light. */
-        RenderTargetPool::Handle shadowMap;     /**< Shadow map for the light. */
+        bool clustered;                         /**< Whether rendered by the clustered pass. */
+
+        /** Desired shadow map resolution (0 if the light casts no shadows). */
+        float shadowMapSize;
+
+        /** Shadow map state, null if the light is rendered without shadows. */
+        ShadowState *shadowState;
+
+        /** Whether each shadow view needs to be rendered. */
+        bool shadowMapOutdated[RenderLight::kMaxShadowViews];
 
         /** Shadow map culling results per view. */
         RenderWorld::CullResults shadowMapCullResults[RenderLight::kMaxShadowViews];
@@ -109,17 +207,17 @@ private:
         IntRect renderArea;
 
         /** Main output textures. */
-        RenderTargetPool::Handle colourBuffer;
-        RenderTargetPool::Handle depthBuffer;
+        RenderGraph::ResourceHandle colourBuffer;
+        RenderGraph::ResourceHandle depthBuffer;
 
         /** G-Buffer textures. */
-        RenderTargetPool::Handle deferredBufferA;
-        RenderTargetPool::Handle deferredBufferB;
-        RenderTargetPool::Handle deferredBufferC;
-        RenderTargetPool::Handle deferredBufferD;
+        RenderGraph::ResourceHandle deferredBufferA;
+        RenderGraph::ResourceHandle deferredBufferB;
+        RenderGraph::ResourceHandle deferredBufferC;
+        RenderGraph::ResourceHandle deferredBufferD;
 
-        /** Light material. */
-        MaterialPtr lightMaterial;
+        /** Shadow map atlas (kInvalidResource if there is none). */
+        RenderGraph::ResourceHandle shadowAtlas;
 
         /** Culling results. */
         RenderWorld::CullResults cullResults;
@@ -127,9 +225,24 @@ private:
         /** Per-light state. */
         std::vector<Light> lights;
 
+        /** Clustered lighting state. */
+        LightClusters lightClusters;
+        RenderTargetPool::Handle lightClusterGrid;
+        RenderTargetPool::Handle lightClusterIndices;
+        RenderTargetPool::Handle lightClusterData;
+
+        /** List of draw calls for the depth pre-pass. */
+        DrawList depthDrawList;
+
         /** List of draw calls for entities with deferred passes. */
         DrawList deferredDrawList;
 
+        /**
+         * List of draw calls for entities with deferred passes which are not
+         * included in the depth pre-pass.
+         */
+        DrawList lateDeferredDrawList;
+
         /** List of draw calls for entities with basic passes. */
         DrawList basicDrawList;
     public:
@@ -139,15 +252,44 @@ private:
     void allocateResources(Context &context) const;
 
     void prepareLights(Context &context) const;
-    void allocateShadowMap(Light &light) const;
+    void allocateShadowMaps(Context &context) const;
+    bool allocateShadowTiles(ShadowState &state, uint16_t tileSize, unsigned numTiles) const;
+    void freeShadowTiles(ShadowState &state) const;
+    bool evictShadowTiles(const std::vector<Light *> &lights, size_t index) const;
+    void prepareShadowMap(Context &context, Light &light) const;
+    void prepareLightClusters(Context &context) const;
 
     void prepareEntities(Context &context) const;
 
     void renderShadowMaps(Context &context) const;
     void renderDeferred(Context &context) const;
+    void renderDepthPrePass(Context &context) const;
     void renderDeferredGBuffer(Context &context) const;
     void renderDeferredLights(Context &context) const;
+    void drawDeferredLights(Context &context, const RenderGraph &graph, GPUCommandList *cmdList) const;
     void renderBasic(Context &context) const;
 
     static GlobalResource<Resources> m_resources;
+
+    /**
+     * Light material.
+     *
+     * This persists across frames. Textures and parameters are set on it
+     * every frame, but resource bindings are only updated when they actually
+     * change, which is rare since render target pool textures are reused.
+     */
+    MaterialPtr m_lightMaterial;
+
+    /**
+     * Shadow map atlas state.
+     *
+     * This persists across frames so that shadow maps which have not changed
+     * do not need to be re-rendered, hence it is modified while rendering.
+     * Lights are only used as keys here and are never dereferenced, so stale
+     * entries for destroyed lights are harmless: they are validated in the
+     * same way as any other, and are evicted when space is needed.
+     */
+    mutable ShadowAtlas m_shadowAtlas;
+    mutable GPUTexturePtr m_shadowAtlasTexture;
+    mutable HashMap<RenderLight *, ShadowState> m_shadowStates;
 };
@@ -32,23 +32,49 @@ class RenderEntity;
  * Class maintaining a list of draws.
  *
  * This class builds up a list of draw calls to perform for a set of entities.
- * For now it is just a simple list, but later it will handle sorting of draw
- * calls.
+ * Draws which use the same geometry, material and pass are merged into a
+ * single instanced draw call. Per-entity transformations are supplied to
+ * shaders as per-instance vertex attributes (see entity.h in the shader
+ * directory). The entity resource set bound for an instanced draw is that of
+ * the first entity in it, so shaders must not rely on per-entity uniforms
+ * differing between instances.
+ *
+ * Instance data for all draws in the list is written to a single buffer, which
+ * is taken from a pool shared by all draw lists and returned to it when the
+ * list is destroyed. Vertex data objects combining a mesh's vertex data with
+ * the instance buffer are cached with the buffer, so drawing does not need to
+ * create any GPU objects once a buffer has been used to draw the same meshes
+ * before.
  */
-class DrawList {
+class DrawList : Noncopyable {
 public:
     DrawList();
+    DrawList(DrawList &&other);
     ~DrawList();
 
-    void add(RenderEntity *entity, const std::string &passType);
+    void add(RenderEntity *entity,
+             const std::string &passType,
+             unsigned lod = 0,
+             GPUIndexData *indices = nullptr);
+
+    void sortFrontToBack(const glm::vec3 &viewPosition);
 
     void draw(GPUCommandList *cmdList, const ShaderKeywordSet &variation);
+
+    /** Pooled buffer containing instance data (internal to the implementation). */
+    struct InstanceBuffer;
 private:
     /** Structure containing details of a single draw. */
     struct Draw {
         RenderEntity *entity;
         const Pass *pass;
+        unsigned lod;
+        GPUIndexDataPtr indices;
+        float distance;
     };
 
     std::deque<Draw> m_draws;           /**< List of draws. */
+
+    /** Instance buffer taken from the pool (null until first drawn). */
+    InstanceBuffer *m_instanceBuffer;
 };
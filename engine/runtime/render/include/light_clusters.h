@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Clustered light binning.
+ */
+
+#pragma once
+
+#include "core/math/sphere.h"
+
+#include <vector>
+
+/**
+ * Class binning lights into a view space cluster grid.
+ *
+ * The view frustum is divided into a grid of clusters: the X and Y axes are
+ * divided evenly in normalised device coordinates, and the Z axis is divided
+ * exponentially between the near and far planes, so that clusters remain
+ * roughly cubic with increasing distance. Each point or spot light is
+ * assigned to the clusters that its volume intersects.
+ *
+ * Lights are described by LightDesc rather than RenderLight, and the view by
+ * its matrices, so that binning does not depend on anything outside the core
+ * library and can be tested on its own.
+ *
+ * The result is a list of light data, an index list, and for each cluster an
+ * offset into the index list and a count of the lights affecting it. These
+ * are laid out for upload to textures, so that a single full-screen pass can
+ * look up the lights affecting each pixel.
+ */
+class LightClusters {
+public:
+    /** Cluster grid dimensions. */
+    static const uint32_t kGridWidth = 16;
+    static const uint32_t kGridHeight = 9;
+    static const uint32_t kGridDepth = 24;
+    static const uint32_t kNumClusters = kGridWidth * kGridHeight * kGridDepth;
+
+    /** Maximum number of lights that can be binned. */
+    static const uint32_t kMaxLights = 1024;
+
+    /** Number of texels of light data per light. */
+    static const uint32_t kLightDataTexels = 4;
+
+    /** Width of the index list texture. */
+    static const uint32_t kIndexTextureWidth = 1024;
+
+    /** Maximum number of entries in the index list. */
+    static const uint32_t kMaxIndices = kIndexTextureWidth * 64;
+
+    /** Entry in the cluster grid. */
+    struct Cluster {
+        float offset;               /**< Offset of the cluster's lights in the index list. */
+        float count;                /**< Number of lights in the cluster. */
+    };
+
+    /** Description of a light to bin (world space). */
+    struct LightDesc {
+        bool spot;                  /**< Whether this is a spot light (else point). */
+        glm::vec3 position;         /**< Position of the light. */
+        glm::vec3 direction;        /**< Direction of the light (spot). */
+        glm::vec3 colour;           /**< Colour multiplied by intensity. */
+        float range;                /**< Range of the light. */
+        float cutoff;               /**< Cutoff angle in degrees, at most 45 (spot). */
+        float attenuationConstant;  /**< Constant attenuation factor. */
+        float attenuationLinear;    /**< Linear attenuation factor. */
+        float attenuationExp;       /**< Exponential attenuation factor. */
+    };
+
+    LightClusters();
+    ~LightClusters();
+
+    bool add(const LightDesc &desc);
+    void build(const glm::mat4 &view, const glm::mat4 &projection, float zNear, float zFar);
+
+    /** @return             Number of lights added. */
+    uint32_t numLights() const { return m_lights.size(); }
+    /** @return             Number of entries in the index list. */
+    uint32_t numIndices() const { return m_indices.size(); }
+
+    /**
+     * Get the cluster grid.
+     *
+     * Gets the cluster grid, laid out as a 2D image with kGridDepth rows, each
+     * containing one slice of the grid. Values are stored as floats so that
+     * they can be uploaded to a floating point texture, which is exact for the
+     * range of values used.
+     *
+     * @return              Pointer to cluster grid.
+     */
+    const Cluster *grid() const { return m_grid.data(); }
+
+    /** @return             Index list (light indices stored as floats). */
+    const float *indices() const { return m_indices.data(); }
+
+    /**
+     * Get the light data.
+     *
+     * Gets the light data, laid out as a 2D image with one row of
+     * kLightDataTexels RGBA texels per light, containing:
+     *
+     *  0. Position, range.
+     *  1. Direction, cosine of cutoff angle.
+     *  2. Colour multiplied by intensity, 1 for spot lights (else 0).
+     *  3. Constant, linear and exponential attenuation factors.
+     *
+     * @return              Pointer to light data.
+     */
+    const glm::vec4 *lightData() const { return m_lightData.data(); }
+
+    /** @return             Scale and bias to calculate a slice from log depth. */
+    const glm::vec2 &depthParameters() const { return m_depthParameters; }
+private:
+    /** Per-light binning state. */
+    struct Light {
+        LightDesc desc;             /**< Description of the light. */
+        Sphere bounds;              /**< View space bounding sphere. */
+        glm::vec3 position;         /**< View space position. */
+        glm::vec3 direction;        /**< View space direction (spot). */
+        float cosCutoff;            /**< Cosine of cutoff angle (spot). */
+        float sinCutoff;            /**< Sine of cutoff angle (spot). */
+    };
+
+    /** Cluster index list allocation. */
+    struct Bin {
+        uint32_t offset;            /**< Offset in the index list. */
+        uint32_t count;             /**< Number of entries allocated. */
+        uint32_t used;              /**< Number of entries filled in. */
+    };
+
+    uint32_t depthSlice(float depth) const;
+    bool intersects(const Light &light, const glm::vec3 &min, const glm::vec3 &max) const;
+private:
+    std::vector<Light> m_lights;            /**< Lights to bin. */
+    std::vector<Cluster> m_grid;            /**< Cluster grid. */
+    std::vector<Bin> m_bins;                /**< Index list allocations. */
+    std::vector<float> m_indices;           /**< Index list. */
+    std::vector<glm::vec4> m_lightData;     /**< Light data. */
+    glm::vec2 m_depthParameters;            /**< Depth slice parameters. */
+
+    /** Temporary list of (cluster, light) pairs, kept to avoid reallocation. */
+    std::vector<std::pair<uint32_t, uint32_t>> m_pairs;
+};
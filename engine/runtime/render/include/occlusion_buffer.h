@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2016 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               Software occlusion buffer.
+ */
+
+#pragma once
+
+#include "core/core.h"
+
+#include <vector>
+
+/**
+ * Software occlusion buffer.
+ *
+ * This class implements occlusion culling entirely on the CPU. Designated
+ * occluders (simple triangle meshes or boxes) are rasterised into a low
+ * resolution depth buffer, from which a hierarchical-Z (HiZ) pyramid is built
+ * holding the furthest depth in each region. Bounding boxes can then be tested
+ * against the pyramid to determine whether they are completely hidden behind
+ * the occluders.
+ *
+ * Occluders are rasterised with the furthest depth they have within each
+ * pixel, and boxes are tested with their nearest depth, so depth comparisons
+ * are conservative. Coverage is sampled at pixel centres though, so an object
+ * peeking out from behind an occluder's silhouette by less than a pixel of the
+ * buffer may be culled. Since nothing depends on the GPU and rasterisation is
+ * done with plain floating point arithmetic, results are deterministic for the
+ * same input.
+ *
+ * Usage is to call begin() with the view-projection matrix of the view,
+ * add all occluders, call finish() to build the pyramid, and then test boxes
+ * with isOccluded().
+ */
+class OcclusionBuffer {
+public:
+    /** Dimensions of the depth buffer (must be powers of 2). */
+    static const uint32_t kWidth  = 256;
+    static const uint32_t kHeight = 128;
+
+    /**
+     * Triangle indices of a box occluder.
+     *
+     * Corner i of the box has its X, Y and Z coordinates taken from the
+     * maximum of the box if bit 0, 1 and 2 of i are set respectively, and the
+     * minimum otherwise.
+     */
+    static const uint16_t kBoxIndices[36];
+
+    OcclusionBuffer();
+    ~OcclusionBuffer();
+
+    void begin(const glm::mat4 &viewProjection);
+    void addOccluder(const glm::mat4 &transform,
+                     const glm::vec3 *vertices,
+                     const uint16_t *indices,
+                     size_t numIndices);
+    void addOccluder(const BoundingBox &box);
+    void finish();
+
+    bool isOccluded(const BoundingBox &box) const;
+
+    /** @return             Number of levels in the HiZ pyramid. */
+    unsigned numLevels() const { return m_levels.size(); }
+
+    /** Get the depth of a pixel in the HiZ pyramid.
+     * @param level         Level to get from (0 is the full resolution depth
+     *                      buffer).
+     * @param x             X coordinate (from the left) in the level.
+     * @param y             Y coordinate (from the bottom) in the level.
+     * @return              Furthest depth within the pixel. */
+    float depth(unsigned level, uint32_t x, uint32_t y) const {
+        return m_levels[level][(y * (kWidth >> level)) + x];
+    }
+private:
+    void rasteriseTriangle(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2);
+private:
+    glm::mat4 m_viewProjection;         /**< View-projection matrix. */
+
+    /**
+     * HiZ pyramid levels.
+     *
+     * Level 0 is the depth buffer that occluders are rasterised into, and
+     * each subsequent level is half the size of the previous, down to 1x1.
+     * Each pixel holds the furthest depth of the pixels it covers in level 0.
+     */
+    std::vector<std::vector<float>> m_levels;
+};
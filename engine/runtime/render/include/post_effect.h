@@ -28,8 +28,10 @@
 
 #include "render/render_pipeline.h"
 
+#include "render_core/material.h"
+
 class GPUTexture;
-class Material;
+class Pass;
 
 /**
  * Post-processing effect class.
@@ -41,6 +43,21 @@ class PostEffect : public Object {
 public:
     CLASS();
 
+    /**
+     * Stages of the fused post-processing shader.
+     *
+     * Effects which only operate on the pixel being shaded can be fused
+     * together into a single pass by the pipeline. The fused shader applies
+     * each enabled stage in the order given here, so a run of effects can only
+     * be fused if their stages appear in increasing order.
+     */
+    enum class FusedStage {
+        kNone,              /**< Effect cannot be fused. */
+        kTonemap,           /**< Tonemapping. */
+        kGammaCorrection,   /**< Gamma correction. */
+        kNumStages,
+    };
+
     /** Destroy the effect. */
     ~PostEffect() {}
 
@@ -84,14 +101,51 @@ public:
      * @param area          Area to render to on the target.
      */
     virtual void render(GPUTexture *source, const GPURenderTargetDesc &target, const IntRect &area) const = 0;
+
+    /**
+     * Get the stage of the fused shader implementing the effect.
+     *
+     * Effects which are purely per-pixel (they only sample the source texture
+     * at the pixel being shaded) can return a stage here to allow them to be
+     * fused with neighbouring effects. Effects which sample neighbouring pixels
+     * (e.g. FXAA) must return kNone, which is the default, and act as a barrier
+     * between fused passes.
+     *
+     * @return              Fused shader stage.
+     */
+    virtual FusedStage fusedStage() const { return FusedStage::kNone; }
+
+    /**
+     * Set parameters for the effect on a fused material.
+     *
+     * Called when the effect is being rendered as part of a fused pass, to set
+     * the parameters for the effect's stage on the fused material.
+     *
+     * @param material      Fused material.
+     */
+    virtual void setFusedParameters(Material *material) const {}
+
+    static void renderFused(const std::vector<const PostEffect *> &effects,
+                            GPUTexture *source,
+                            const GPURenderTargetDesc &target,
+                            const IntRect &area,
+                            Material *material);
 protected:
     /** Initialise the effect. */
     PostEffect() {}
 
-    void blit(GPUTexture *source,
-              const GPURenderTargetDesc &target,
-              const IntRect &area,
-              Material *material,
-              size_t passIndex = 0,
-              GPUSamplerState *samplerState = nullptr) const;
+    static void blit(GPUTexture *source,
+                     const GPURenderTargetDesc &target,
+                     const IntRect &area,
+                     Material *material,
+                     size_t passIndex = 0,
+                     GPUSamplerState *samplerState = nullptr);
+private:
+    static void blitPass(GPUTexture *source,
+                         const GPURenderTargetDesc &target,
+                         const IntRect &area,
+                         Material *material,
+                         const Pass *pass,
+                         const ShaderKeywordSet &variation,
+                         GPUSamplerState *samplerState);
 };
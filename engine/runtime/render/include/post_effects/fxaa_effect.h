@@ -38,4 +38,5 @@ public:
     void render(GPUTexture *source, const GPURenderTargetDesc &target, const IntRect &area) const override;
 private:
     MaterialPtr m_material;             /**< FXAA material. */
+    GPUSamplerStatePtr m_samplerState;  /**< Sampler for the source texture. */
 };
@@ -45,6 +45,9 @@ public:
     RenderPipeline::ImageType outputImageType() const override;
 
     void render(GPUTexture *source, const GPURenderTargetDesc &target, const IntRect &area) const override;
+
+    FusedStage fusedStage() const override;
+    void setFusedParameters(Material *material) const override;
 private:
     MaterialPtr m_material;             /**< Gamma correction material. */
 };
@@ -23,6 +23,7 @@
 
 #include "core/core.h"
 
+#include "render/render_graph.h"
 #include "render/render_world.h"
 
 class RenderTarget;
@@ -34,7 +35,8 @@ class RenderView;
  * This class manages per-frame rendering state for a RenderPipeline. The
  * pipeline should create an instance of this class (or a derived class which
  * includes extra pipeline-specific state) and then use methods on it to perform
- * its rendering.
+ * its rendering. Rendering work is added as passes to the context's render
+ * graph, which is then compiled and executed at the end of the frame.
  */
 class RenderContext {
 public:
@@ -47,6 +49,10 @@ public:
     RenderView &view() const { return m_view; }
     /** @return             Target that is being rendered to. */
     RenderTarget &target() const { return m_target; }
+    /** @return             Render graph for the frame. */
+    RenderGraph &graph() { return m_graph; }
+    /** @return             Render graph resource for the render target. */
+    RenderGraph::ResourceHandle targetResource() const { return m_targetResource; }
 
     /**
      * Cull the world against the primary view.
@@ -84,4 +90,9 @@ private:
     const RenderWorld &m_world;         /**< World that the context is rendering. */
     RenderView &m_view;                 /**< View that is being rendered from. */
     RenderTarget &m_target;             /**< Target that is being rendered to. */
+
+    RenderGraph m_graph;                /**< Render graph for the frame. */
+
+    /** Render graph resource for the render target. */
+    RenderGraph::ResourceHandle m_targetResource;
 };
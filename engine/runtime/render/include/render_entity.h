@@ -21,13 +21,17 @@
 
 #pragma once
 
+#include "gpu/index_data.h"
 #include "gpu/resource.h"
 
 #include "render_core/uniform_buffer.h"
 
+#include <vector>
+
 struct Geometry;
 
 class Material;
+class RenderView;
 class RenderWorld;
 
 /** Per-entity uniform buffer structure. */
@@ -57,11 +61,12 @@ public:
     void setWorld(RenderWorld *world);
 
     void setTransform(const Transform &transform);
+    void setVertexTransform(const glm::mat4 &transform);
     void setBoundingBox(const BoundingBox &boundingBox);
-
-    /** Set the flags for the entity.
-     * @param flags         New flags. */
-    void setFlags(uint32_t flags) { m_flags = flags; }
+    void setLODs(const std::vector<float> &errors);
+    void setFlags(uint32_t flags);
+    void setOccluder(const std::vector<glm::vec3> &vertices, const std::vector<uint16_t> &indices);
+    void setOccluder(const BoundingBox &box);
 
     /** @return             Current transformation. */
     const Transform &transform() const { return m_transform; }
@@ -71,6 +76,10 @@ public:
     const glm::quat &orientation() const { return m_transform.orientation(); }
     /** @return             Current scale. */
     const glm::vec3 &scale() const { return m_transform.scale(); }
+    /** @return             Transformation applied to vertices when drawing,
+     *                      combining the vertex transformation and the
+     *                      entity's transformation. */
+    const glm::mat4 &drawTransform() const { return m_drawTransform; }
     /** @return             Local-space bounding box. */
     const BoundingBox &boundingBox() const { return m_boundingBox; }
     /** @return             World-space bounding box. */
@@ -81,11 +90,41 @@ public:
     /** @return             Whether the entity casts a shadow. */
     bool castsShadow() const { return (m_flags & kCastsShadow) != 0; }
 
+    /** @return             Whether the entity is an occluder. */
+    bool isOccluder() const { return !m_occluderIndices.empty(); }
+    /** @return             Occluder vertex positions, in local space. */
+    const std::vector<glm::vec3> &occluderVertices() const { return m_occluderVertices; }
+    /** @return             Occluder triangle indices. */
+    const std::vector<uint16_t> &occluderIndices() const { return m_occluderIndices; }
+
+    /**
+     * Get the change stamp of the entity.
+     *
+     * This is updated to a value greater than that of any other entity
+     * whenever anything affecting the entity's appearance in shadow maps
+     * changes, i.e. its transformation, bounding box or geometry. Users which
+     * cache rendering results can compare stamps to determine whether an
+     * entity has changed since they were rendered.
+     *
+     * @return              Change stamp of the entity.
+     */
+    uint64_t changeStamp() const { return m_changeStamp; }
+
+    /** @return             Number of levels of detail, including full detail. */
+    unsigned numLODs() const { return m_lodSizes.size() + 1; }
+
+    unsigned selectLOD(RenderView &view, bool hysteresis);
+    void requestTextures(RenderView &view);
+
+    virtual bool cullClusters(RenderView &view, unsigned lod, GPUIndexDataPtr &outIndices);
+
     GPUResourceSet *getResources();
 
     /** Get the geometry for the entity.
+     * @param lod           Level of detail to get geometry for (0 is full
+     *                      detail), less than numLODs().
      * @return              Geometry structure to fill in. */
-    virtual Geometry geometry() const = 0;
+    virtual Geometry geometry(unsigned lod) const = 0;
 
     /** Get the material for the entity.
      * @return              Material for the entity. */
@@ -96,13 +135,38 @@ protected:
     RenderEntity();
 
     void updateWorld();
+    void updateChangeStamp();
+private:
+    void updateLODSizes();
 private:
     RenderWorld *m_world;               /**< World that this entity belongs to. */
 
     Transform m_transform;              /**< Transformation of the entity. */
+    glm::mat4 m_vertexTransform;        /**< Transformation applied to vertex positions. */
+    glm::mat4 m_drawTransform;          /**< Combined transformation for drawing. */
     BoundingBox m_boundingBox;          /**< Local-space bounding box. */
     BoundingBox m_worldBoundingBox;     /**< World-space bounding box. */
     uint32_t m_flags;                   /**< Behaviour flags for the entity. */
+    uint64_t m_changeStamp;             /**< Change stamp (see changeStamp()). */
+
+    /** Occluder geometry (see setOccluder()). */
+    std::vector<glm::vec3> m_occluderVertices;
+    std::vector<uint16_t> m_occluderIndices;
+
+    /** Errors of each simplified level of detail, in local space. */
+    std::vector<float> m_lodErrors;
+
+    /**
+     * Projected sizes below which each simplified level of detail is used.
+     *
+     * These are in terms of the projected radius (in pixels) of the entity's
+     * bounding sphere, and are calculated so that the error of each level of
+     * detail is below kLODPixelError pixels when it is used.
+     */
+    std::vector<float> m_lodSizes;
+
+    /** Level of detail last selected for the primary view. */
+    unsigned m_lod;
 
     /** Uniform buffer containing per-entity parameters. */
     UniformBuffer<EntityUniforms> m_uniforms;
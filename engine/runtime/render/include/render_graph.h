@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2016 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               Frame render graph.
+ */
+
+#pragma once
+
+#include "gpu/render_pass.h"
+
+#include "render_core/render_target_pool.h"
+
+#include <functional>
+#include <memory>
+
+class GPUCommandList;
+
+/**
+ * Frame render graph.
+ *
+ * A render graph is built each frame to describe the passes needed to render
+ * it. Each pass declares the resources that it reads and writes, and a
+ * function to record its commands. Passes are added in the order that they
+ * should execute. Once the whole frame has been declared, the graph is
+ * compiled, which:
+ *
+ *  - Culls passes whose results are never used. Imported resources (e.g. the
+ *    final render target) persist beyond the frame, so passes which write
+ *    them, and all passes they depend on, are kept. A pass which writes
+ *    nothing (no attachments or outputs) is always culled, so a pass with an
+ *    effect outside the graph must declare what it writes with addOutput().
+ *  - Computes the lifetime of each transient resource, from the first to the
+ *    last pass which uses it.
+ *  - Assigns transient resources to physical textures, with resources which
+ *    have identical descriptors and non-overlapping lifetimes sharing the
+ *    same texture.
+ *  - Derives the load and store operations of each attachment: an attachment
+ *    declared to be loaded is not loaded if nothing has been written to it
+ *    earlier in the frame, and its contents are not stored if nothing later
+ *    reads them.
+ *
+ * The graph is then executed, which allocates the physical textures from the
+ * render target pool and runs each remaining pass in order. Barriers between
+ * passes are handled by the GPU layer, which transitions attachments at the
+ * start and end of each render pass, so only the order matters here.
+ *
+ * Compilation does not touch the GPU, so it can be done (and the results
+ * examined) without a GPU present.
+ */
+class RenderGraph : Noncopyable {
+public:
+    /** Handle to a resource in the graph. */
+    using ResourceHandle = uint32_t;
+
+    /** Invalid resource handle value. */
+    static const ResourceHandle kInvalidResource = 0xffffffff;
+
+    /**
+     * Type of a function to execute a pass.
+     *
+     * @param graph         Graph being executed, to get the textures for
+     *                      resources from.
+     * @param cmdList       Command list for the render pass if the pass has
+     *                      attachments, otherwise null, in which case the
+     *                      function must record its own commands.
+     */
+    using PassFunction = std::function<void (const RenderGraph &graph, GPUCommandList *cmdList)>;
+
+    /** Details of a pass attachment. */
+    struct Attachment {
+        ResourceHandle resource;        /**< Resource to render to. */
+
+        /**
+         * How to treat existing contents at the start of the pass.
+         *
+         * This is as declared until the graph is compiled, after which kLoad
+         * is replaced with kDontCare if there are no existing contents.
+         */
+        GPURenderLoadOp loadOp;
+
+        /** How to treat contents at end of pass (determined by compilation). */
+        GPURenderStoreOp storeOp;
+
+        glm::vec4 clearColour;          /**< Clear value for colour attachments. */
+        float clearDepth;               /**< Clear value for depth attachments. */
+        uint32_t clearStencil;          /**< Clear value for stencil attachments. */
+    public:
+        Attachment() :
+            resource     (kInvalidResource),
+            loadOp       (GPURenderLoadOp::kDontCare),
+            storeOp      (GPURenderStoreOp::kStore),
+            clearColour  (0.0f, 0.0f, 0.0f, 0.0f),
+            clearDepth   (1.0f),
+            clearStencil (0)
+        {}
+    };
+
+    /** Class describing a pass in the graph. */
+    class Pass : Noncopyable {
+    public:
+        void setColourAttachment(unsigned index,
+                                 ResourceHandle resource,
+                                 GPURenderLoadOp loadOp = GPURenderLoadOp::kLoad,
+                                 const glm::vec4 &clearColour = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f));
+        void setDepthStencilAttachment(ResourceHandle resource,
+                                       GPURenderLoadOp loadOp = GPURenderLoadOp::kLoad,
+                                       float clearDepth = 1.0f,
+                                       uint32_t clearStencil = 0);
+        void addInput(ResourceHandle resource);
+        void addOutput(ResourceHandle resource);
+
+        /** Set the area affected by the pass.
+         * @param area          Render area (defaults to the whole size of
+         *                      the attachments). */
+        void setRenderArea(const IntRect &area) { m_renderArea = area; }
+
+        /** Set the function to execute the pass.
+         * @param function      Function to execute the pass. */
+        void setFunction(PassFunction function) { m_function = std::move(function); }
+
+        /** @return             Name of the pass. */
+        const std::string &name() const { return m_name; }
+        /** @return             Whether the pass has been culled. */
+        bool culled() const { return m_culled; }
+        /** @return             Colour attachments of the pass. */
+        const std::vector<Attachment> &colourAttachments() const { return m_colourAttachments; }
+        /** @return             Depth/stencil attachment of the pass. */
+        const Attachment &depthStencilAttachment() const { return m_depthStencilAttachment; }
+
+        /** @return             Whether the pass has any attachments. */
+        bool hasAttachments() const {
+            return !m_colourAttachments.empty() || m_depthStencilAttachment.resource != kInvalidResource;
+        }
+    private:
+        explicit Pass(const std::string &name);
+
+        void getReads(std::vector<ResourceHandle> &outReads) const;
+        void getWrites(std::vector<ResourceHandle> &outWrites) const;
+    private:
+        std::string m_name;             /**< Name of the pass. */
+        IntRect m_renderArea;           /**< Render area (zero size for default). */
+        PassFunction m_function;        /**< Function to execute the pass. */
+        bool m_culled;                  /**< Whether the pass has been culled. */
+
+        /** Attachments. */
+        std::vector<Attachment> m_colourAttachments;
+        Attachment m_depthStencilAttachment;
+
+        /** Resources read by the pass other than through attachments. */
+        std::vector<ResourceHandle> m_inputs;
+
+        /** Resources written by the pass other than through attachments. */
+        std::vector<ResourceHandle> m_outputs;
+
+        friend class RenderGraph;
+    };
+
+    RenderGraph();
+    ~RenderGraph();
+
+    ResourceHandle createTexture(const std::string &name, const GPUTextureDesc &desc);
+    ResourceHandle importTexture(const std::string &name, const GPUTextureImageRef &image);
+
+    Pass &addPass(const std::string &name);
+
+    void compile();
+    void execute();
+
+    GPUTexture *texture(ResourceHandle resource) const;
+    GPUTextureImageRef textureImage(ResourceHandle resource) const;
+
+    /** @return             Number of passes in the graph. */
+    size_t numPasses() const { return m_passes.size(); }
+    /** @return             Pass at the given index. */
+    const Pass &pass(size_t index) const { return *m_passes[index]; }
+
+    /** @return             Number of physical textures used by transient
+     *                      resources (valid after compilation). */
+    size_t numPhysicalTextures() const { return m_physicalDescs.size(); }
+
+    /** Get the physical texture index assigned to a transient resource.
+     * @param resource      Resource to get for.
+     * @return              Index of the physical texture, or -1 if the
+     *                      resource is imported or unused (valid after
+     *                      compilation). */
+    int physicalTexture(ResourceHandle resource) const { return m_resources[resource].physical; }
+private:
+    /** Details of a resource in the graph. */
+    struct Resource {
+        std::string name;               /**< Name of the resource. */
+        bool imported;                  /**< Whether the resource is imported. */
+        GPUTextureDesc desc;            /**< Texture descriptor (for transient resources). */
+        GPUTextureImageRef image;       /**< Image (imported, or once allocated). */
+        int firstPass;                  /**< First pass using the resource (-1 if unused). */
+        int lastPass;                   /**< Last pass using the resource. */
+        int physical;                   /**< Physical texture index (-1 if none). */
+    };
+
+    GPUCommandList *beginRenderPass(const Pass &pass) const;
+private:
+    std::vector<Resource> m_resources;  /**< Resources in the graph. */
+
+    /** Passes in the graph, in execution order. */
+    std::vector<std::unique_ptr<Pass>> m_passes;
+
+    /** Descriptors of physical textures for transient resources. */
+    std::vector<GPUTextureDesc> m_physicalDescs;
+
+    /** Physical textures, allocated when the graph is executed. */
+    std::vector<RenderTargetPool::Handle> m_physicalTextures;
+
+    bool m_compiled;                    /**< Whether the graph has been compiled. */
+};
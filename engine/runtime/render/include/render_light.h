@@ -39,11 +39,22 @@ UNIFORM_STRUCT_BEGIN(LightUniforms)
     UNIFORM_STRUCT_MEMBER(float, range);
     UNIFORM_STRUCT_MEMBER(glm::mat4, volumeTransform);
     UNIFORM_STRUCT_MEMBER(glm::mat4, shadowSpace);
-    UNIFORM_STRUCT_MEMBER(float, shadowZNear);
     UNIFORM_STRUCT_MEMBER(float, attenuationConstant);
     UNIFORM_STRUCT_MEMBER(float, attenuationLinear);
     UNIFORM_STRUCT_MEMBER(float, attenuationExp);
     UNIFORM_STRUCT_MEMBER(float, shadowBiasConstant);
+
+    /** Shadow space transformations for shadow views after the first, which
+     *  uses shadowSpace (point faces/directional cascades). */
+    UNIFORM_STRUCT_MEMBER(glm::mat4, shadowSpace1);
+    UNIFORM_STRUCT_MEMBER(glm::mat4, shadowSpace2);
+    UNIFORM_STRUCT_MEMBER(glm::mat4, shadowSpace3);
+    UNIFORM_STRUCT_MEMBER(glm::mat4, shadowSpace4);
+    UNIFORM_STRUCT_MEMBER(glm::mat4, shadowSpace5);
+
+    /** View space depth at the far end of each cascade (directional). */
+    UNIFORM_STRUCT_MEMBER(glm::vec4, shadowCascadeSplits);
+    UNIFORM_STRUCT_MEMBER(int32_t, shadowCascadeCount);
 UNIFORM_STRUCT_END;
 
 /** Renderer representation of a light source. */
@@ -67,6 +78,9 @@ public:
     /** Maximum number of shadow views. */
     static const size_t kMaxShadowViews = CubeFace::kNumFaces;
 
+    /** Maximum number of shadow cascades (directional). */
+    static const unsigned kMaxShadowCascades = 4;
+
     explicit RenderLight(Type type);
     ~RenderLight();
 
@@ -115,9 +129,19 @@ public:
 
     /** @return             Number of shadow views for this light. */
     unsigned numShadowViews() const {
-        return (m_type == kPointLight) ? CubeFace::kNumFaces : 1;
+        switch (m_type) {
+            case kPointLight:
+                return CubeFace::kNumFaces;
+            case kDirectionalLight:
+                return m_numShadowCascades;
+            default:
+                return 1;
+        }
     }
 
+    void updateShadowCascades(RenderView &view, unsigned numCascades, float distance, uint16_t resolution);
+    void setShadowTile(unsigned index, const IntRect &tile, uint16_t atlasSize);
+
     /** Get the shadow view at the specified index.
      * @param index         Index to get at.
      * @return              Pointer to shadow view. */
@@ -126,6 +150,7 @@ public:
     }
 
     bool cull(RenderView &view) const;
+    bool shadowVisible(const Sphere &caster, const Frustum &frustum) const;
 
     std::string name;               /**< Name of the light (used for debugging). */
 private:
@@ -149,8 +174,8 @@ private:
     uint32_t m_flags;               /**< Behaviour flags for the light. */
     float m_shadowBiasConstant;     /**< Constant shadow bias. */
 
-    /** Bounding box (for spot lights). */
-    BoundingBox m_boundingBox;
+    /** Apex and base corners of a pyramid bounding the light's cone (spot). */
+    glm::vec3 m_conePoints[5];
 
     /** Deferred light volume transformation. */
     Transform m_volumeTransform;
@@ -163,4 +188,7 @@ private:
 
     /** Views for shadow map rendering. */
     RenderView m_shadowViews[kMaxShadowViews];
+
+    /** Number of shadow cascades currently in use (directional). */
+    unsigned m_numShadowCascades;
 };
@@ -25,6 +25,7 @@
 
 #include "render/render_context.h"
 
+#include "render_core/material.h"
 #include "render_core/render_target_pool.h"
 
 class PostEffect;
@@ -58,10 +59,22 @@ public:
     /** Global resources for all pipelines. */
     struct BaseResources {
         HashMap<GPURenderAttachmentDesc, GPURenderPassPtr> renderPasses;
+        ShaderPtr fusedPostEffectShader;
+
+        BaseResources();
     };
 
     static const BaseResources &resources();
 
+    /**
+     * Whether to fuse post-processing effects.
+     *
+     * When enabled, consecutive per-pixel post-processing effects (see
+     * PostEffect::fusedStage()) are rendered together in a single pass, rather
+     * than each effect reading and writing a full-screen texture.
+     */
+    PROPERTY() bool fusePostEffects;
+
     /**
      * Render a world.
      *
@@ -87,11 +100,20 @@ protected:
     void deserialise(Serialiser &serialiser) override;
 
     void renderPostEffects(RenderContext &context,
-                           const RenderTargetPool::Handle &input,
+                           RenderGraph::ResourceHandle input,
                            ImageType imageType) const;
 
     void renderDebug(RenderContext &context) const;
 private:
     /** List of post processing effects. */
     std::list<ObjectPtr<PostEffect>> m_postEffects;
+
+    /**
+     * Materials for fused post-processing passes.
+     *
+     * Each fused pass in the chain needs its own material, since they hold
+     * different parameter values. These are created as needed when adding the
+     * passes to the render graph.
+     */
+    mutable std::vector<MaterialPtr> m_fusedMaterials;
 };
@@ -50,6 +50,7 @@ public:
 
     void setTransform(const glm::vec3 &position, const glm::quat &orientation);
     void perspective(float fov, float zNear, float zFar);
+    void orthographic(float left, float right, float bottom, float top, float zNear, float zFar);
     void setViewport(const IntRect &viewport);
 
     /** @return             Current position. */
@@ -59,7 +60,9 @@ public:
 
     const glm::mat4 &view();
 
-    /** @return             Horizontal field of view. */
+    /** @return             Whether the view uses an orthographic projection. */
+    bool isOrthographic() const { return m_orthographic; }
+    /** @return             Horizontal field of view (perspective). */
     float fov() const { return m_fov; }
     /** @return             Near clipping plane. */
     float zNear() const { return m_zNear; }
@@ -77,6 +80,8 @@ public:
     const glm::mat4 &inverseViewProjection();
     const Frustum &frustum();
 
+    float projectedRadius(const Sphere &sphere);
+
     GPUResourceSet *getResources();
 private:
     void updateMatrices();
@@ -86,7 +91,9 @@ private:
     glm::mat4 m_view;                   /**< World-to-view matrix. */
     bool m_viewOutdated;                /**< Whether the view matrix needs updating. */
 
-    float m_fov;                        /**< Horizontal field of view. */
+    bool m_orthographic;                /**< Whether the projection is orthographic. */
+    glm::vec4 m_orthographicBounds;     /**< Left, right, bottom and top (orthographic). */
+    float m_fov;                        /**< Horizontal field of view (perspective). */
     float m_zNear;                      /**< Near clipping plane. */
     float m_zFar;                       /**< Far clipping plane. */
     glm::mat4 m_projection;             /**< View-to-projection matrix. */
@@ -23,6 +23,8 @@
 
 #include "core/core.h"
 
+#include "gpu/index_data.h"
+
 #include <list>
 
 class RenderEntity;
@@ -43,12 +45,69 @@ public:
     enum CullFlags : uint32_t {
         /** Whether to include visible lights in the results. */
         kCullLights = (1 << 0),
+
+        /**
+         * Whether to apply hysteresis to level of detail selection.
+         *
+         * This should only be used when culling for the primary view, as the
+         * previous selection for it is stored in each entity.
+         */
+        kLODHysteresis = (1 << 1),
+
+        /**
+         * Whether to cull clusters of visible entities.
+         *
+         * For entities that support it, parts which are outside the view or
+         * facing away from it are culled, and index data for the remainder
+         * is built for the current frame. Entities for which all clusters are
+         * culled are not included in the results. This assumes that entities
+         * are drawn with back-face culling.
+         */
+        kCullClusters = (1 << 2),
+
+        /**
+         * Whether to request textures of visible entities for streaming.
+         *
+         * The resolution at which the textures of each visible entity are
+         * needed in the view is recorded for texture streaming. This should
+         * only be used for views which are actually displayed.
+         */
+        kStreamTextures = (1 << 3),
+
+        /**
+         * Whether to cull entities which are hidden behind occluders.
+         *
+         * Entities which have occluder geometry set (see
+         * RenderEntity::setOccluder()) and are within the view are rasterised
+         * into a software depth buffer, and entities which are entirely
+         * hidden behind them are not included in the results. Occluders
+         * themselves are never culled this way. This is only useful for views
+         * which render the entities themselves, as e.g. shadows of hidden
+         * entities may still be visible.
+         */
+        kCullOcclusion = (1 << 4),
+    };
+
+    /** Details of a visible entity. */
+    struct VisibleEntity {
+        RenderEntity *entity;           /**< Entity that is visible. */
+        unsigned lod;                   /**< Level of detail to draw the entity with. */
+
+        /** Index data for visible clusters to draw instead of the entity's
+         *  own, if cluster culling was performed. */
+        GPUIndexDataPtr indices;
+
+        VisibleEntity(RenderEntity *inEntity, unsigned inLOD, GPUIndexDataPtr inIndices = nullptr) :
+            entity  (inEntity),
+            lod     (inLOD),
+            indices (std::move(inIndices))
+        {}
     };
 
     /** Structure containing the results of culling. */
     struct CullResults {
         /** List of visible entities. */
-        std::list<RenderEntity *> entities;
+        std::list<VisibleEntity> entities;
 
         /** List of visible lights. */
         std::list<RenderLight *> lights;
@@ -60,7 +119,8 @@ public:
      * Cull the world against the given view.
      *
      * Given a view, obtains lists of all the entities visible from it, as well
-     * as all the lights visible if the kCullLights flag is passed.
+     * as all the lights visible if the kCullLights flag is passed. The level
+     * of detail to use for each visible entity is selected for the view.
      *
      * @param view          View to cull against.
      * @param outResults    Results structure to fill in.
@@ -70,6 +130,30 @@ public:
                       CullResults &outResults,
                       uint32_t flags = kCullLights) const = 0;
 
+    /**
+     * Cull shadow casters for a light.
+     *
+     * Obtains lists of the shadow casting entities visible from each of a
+     * light's shadow views, for rendering its shadow map. Only entities which
+     * cast shadows are considered. Casters whose shadow cannot fall anywhere
+     * within the main view being rendered are excluded (see
+     * RenderLight::shadowVisible()). The level of detail to use for each
+     * caster is selected for each shadow view.
+     *
+     * Only the kCullClusters flag is meaningful here.
+     *
+     * @param light         Light to cull for. Its shadow views must be up to
+     *                      date.
+     * @param view          Main view being rendered.
+     * @param outResults    Array of results structures to fill in, with an
+     *                      entry for each of the light's shadow views.
+     * @param flags         Culling behaviour flags.
+     */
+    virtual void cullShadowCasters(RenderLight *light,
+                                   RenderView &view,
+                                   CullResults *outResults,
+                                   uint32_t flags = 0) const = 0;
+
     /** Add an entity to the world.
      * @param entity        Entity to add. */
     virtual void addEntity(RenderEntity *entity) = 0;
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Shadow map atlas allocator.
+ */
+
+#pragma once
+
+#include "core/core.h"
+
+#include <vector>
+
+/**
+ * Allocator for tiles of a shadow map atlas.
+ *
+ * Shadow maps for all lights are rendered into tiles of a single large depth
+ * texture. This class manages the space in the atlas, which is divided into
+ * square tiles with power of 2 sizes using a buddy allocation scheme: a tile
+ * is allocated by repeatedly splitting a larger free tile into quarters, and
+ * when a tile is freed it is merged back together with its siblings if they
+ * are all free.
+ *
+ * Allocations are persistent across frames, so that the contents of a tile can
+ * be kept if nothing affecting it has changed.
+ */
+class ShadowAtlas {
+public:
+    /** Minimum size of a tile. */
+    static const uint16_t kMinTileSize = 64;
+
+    ShadowAtlas();
+    ~ShadowAtlas();
+
+    void reset(uint16_t size);
+
+    bool allocate(uint16_t size, IntRect &outTile);
+    void free(const IntRect &tile);
+
+    /** @return             Size of the atlas (0 if not yet set). */
+    uint16_t size() const { return m_size; }
+private:
+    unsigned level(uint16_t size) const;
+private:
+    uint16_t m_size;                    /**< Size of the atlas. */
+
+    /**
+     * Free tiles at each level.
+     *
+     * Level 0 is a single tile covering the whole atlas, and the tile size
+     * halves at each subsequent level down to kMinTileSize.
+     */
+    std::vector<std::vector<glm::ivec2>> m_freeTiles;
+};
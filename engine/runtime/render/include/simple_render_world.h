@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include "render/occlusion_buffer.h"
 #include "render/render_world.h"
 
 /**
@@ -28,7 +29,9 @@
  *
  * This is a simple implementation of RenderWorld that just stores lists of
  * all the entities and lights in the world and iterates over the whole lists
- * and culls them individually.
+ * and culls them individually. Shadow casters and occluders are additionally
+ * kept in their own lists so that culling for shadow maps and rasterising
+ * occluders does not need to consider other entities.
  */
 class SimpleRenderWorld : public RenderWorld {
 public:
@@ -36,6 +39,10 @@ public:
     ~SimpleRenderWorld();
 
     void cull(RenderView &view, CullResults &outResults, uint32_t flags) const override;
+    void cullShadowCasters(RenderLight *light,
+                           RenderView &view,
+                           CullResults *outResults,
+                           uint32_t flags) const override;
 
     void addEntity(RenderEntity *entity) override;
     void updateEntity(RenderEntity *entity) override;
@@ -48,6 +55,15 @@ private:
     /** List of entities in the world. */
     std::list<RenderEntity *> m_entities;
 
+    /** List of entities which cast shadows. */
+    std::list<RenderEntity *> m_shadowCasters;
+
+    /** List of entities which are occluders. */
+    std::list<RenderEntity *> m_occluders;
+
     /** List of registered lights. */
     std::list<RenderLight *> m_lights;
+
+    /** Occlusion buffer used when culling (kept to avoid reallocating it). */
+    mutable OcclusionBuffer m_occlusionBuffer;
 };
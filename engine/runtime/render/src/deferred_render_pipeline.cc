@@ -27,6 +27,9 @@
 #include "render/render_light.h"
 
 #include "render_core/geometry.h"
+#include "render_core/render_resources.h"
+
+#include <algorithm>
 
 /** Pass type names. */
 static const std::string kDeferredPassType      ("Deferred");
@@ -44,8 +47,30 @@ static const std::string kLightVariations[RenderLight::kNumTypes] = {
 /** Name of the shadow variation. */
 static const std::string kShadowVariation("SHADOW");
 
-/** Default shadow map resolution. */
-static const uint16_t kDefaultShadowMapResolution = 512;
+/** Name of the clustered lighting variation. */
+static const std::string kClusteredVariation("CLUSTERED");
+
+/** Default shadow map resolutions. */
+static const uint16_t kDefaultShadowAtlasResolution = 4096;
+static const uint16_t kDefaultShadowMapResolution   = 512;
+
+/** Default shadow cascade settings. */
+static const uint16_t kDefaultShadowCascades          = 4;
+static const uint16_t kDefaultShadowCascadeResolution = 1024;
+static const float kDefaultShadowDistance             = 100.0f;
+
+/** Maximum shadow map atlas resolution. */
+static const uint16_t kMaxShadowAtlasResolution = 16384;
+
+/**
+ * Shadow map tile shrink threshold.
+ *
+ * A light's shadow map tile is only replaced with a smaller one once its
+ * desired resolution is this factor of the current tile size or less. This
+ * avoids repeatedly reallocating (and so re-rendering) the shadow map when the
+ * desired resolution is hovering around the threshold between two sizes.
+ */
+static const float kShadowTileShrinkThreshold = 0.4f;
 
 /* Register the deferred pass type. */
 DEFINE_PASS_TYPE(kDeferredPassType, {});
@@ -61,7 +86,8 @@ DEFINE_PASS_TYPE(kDeferredLightPassType, {
     { kLightVariations[RenderLight::kPointLight] },
     { kLightVariations[RenderLight::kPointLight], kShadowVariation },
     { kLightVariations[RenderLight::kSpotLight] },
-    { kLightVariations[RenderLight::kSpotLight], kShadowVariation }
+    { kLightVariations[RenderLight::kSpotLight], kShadowVariation },
+    { kClusteredVariation }
 });
 
 /** Global resources for the deferred pipeline. */
@@ -72,60 +98,35 @@ DeferredRenderPipeline::Resources::Resources() {
     /* Load the light shader. */
     this->lightShader = g_assetManager->load<Shader>("engine/shaders/internal/deferred_light");
 
-    GPURenderPassDesc passDesc;
-
-    /* Create the shadow map pass. */
-    passDesc.colourAttachments.resize(0);
-    passDesc.depthStencilAttachment               = GPURenderAttachmentDesc();
-    passDesc.depthStencilAttachment.format        = kShadowMapFormat;
-    passDesc.depthStencilAttachment.loadOp        = GPURenderLoadOp::kClear;
-    passDesc.depthStencilAttachment.stencilLoadOp = GPURenderLoadOp::kDontCare;
-
-    this->shadowMapPass = g_gpuManager->createRenderPass(std::move(passDesc));
-
-    /* Create the G-Buffer pass. */
-    passDesc.colourAttachments.resize(3);
-    passDesc.colourAttachments[0].format          = kDeferredBufferAFormat;
-    passDesc.colourAttachments[0].loadOp          = GPURenderLoadOp::kClear;
-    passDesc.colourAttachments[1].format          = kDeferredBufferBFormat;
-    passDesc.colourAttachments[1].loadOp          = GPURenderLoadOp::kClear;
-    passDesc.colourAttachments[2].format          = kDeferredBufferCFormat;
-    passDesc.colourAttachments[2].loadOp          = GPURenderLoadOp::kClear;
-    passDesc.depthStencilAttachment               = GPURenderAttachmentDesc();
-    passDesc.depthStencilAttachment.format        = kDepthBufferFormat;
-    passDesc.depthStencilAttachment.loadOp        = GPURenderLoadOp::kClear;
-    passDesc.depthStencilAttachment.stencilLoadOp = GPURenderLoadOp::kDontCare;
-
-    this->gBufferPass = g_gpuManager->createRenderPass(std::move(passDesc));
-
-    /* Create the lighting pass. */
-    passDesc.colourAttachments.resize(1);
-    passDesc.colourAttachments[0].format          = kHDRColourBufferFormat;
-    passDesc.colourAttachments[0].loadOp          = GPURenderLoadOp::kClear;
-    passDesc.depthStencilAttachment.format        = kDepthBufferFormat;
-    passDesc.depthStencilAttachment.loadOp        = GPURenderLoadOp::kLoad;
-    passDesc.depthStencilAttachment.stencilLoadOp = GPURenderLoadOp::kDontCare;
-
-    this->lightPass = g_gpuManager->createRenderPass(std::move(passDesc));
-
-    /* Create the basic material pass. */
-    passDesc.colourAttachments.resize(1);
-    passDesc.colourAttachments[0].format          = kHDRColourBufferFormat;
-    passDesc.colourAttachments[0].loadOp          = GPURenderLoadOp::kLoad;
-    passDesc.depthStencilAttachment.format        = kDepthBufferFormat;
-    passDesc.depthStencilAttachment.loadOp        = GPURenderLoadOp::kLoad;
-    passDesc.depthStencilAttachment.stencilLoadOp = GPURenderLoadOp::kDontCare;
-
-    this->basicPass = g_gpuManager->createRenderPass(std::move(passDesc));
+    this->defaultSampler = g_gpuManager->getSamplerState();
+    this->shadowMapSampler = g_gpuManager->getSamplerState(GPUSamplerStateDesc().
+        setFilterMode    (SamplerFilterMode::kBilinear).
+        setCompareEnable (true).
+        setCompareFunc   (ComparisonFunc::kLess));
 }
 
 /** Initialise the pipeline. */
 DeferredRenderPipeline::DeferredRenderPipeline() :
-    shadowMapResolution(kDefaultShadowMapResolution)
+    shadowAtlasResolution   (kDefaultShadowAtlasResolution),
+    shadowMapResolution     (kDefaultShadowMapResolution),
+    shadowCascades          (kDefaultShadowCascades),
+    shadowCascadeResolution (kDefaultShadowCascadeResolution),
+    shadowDistance          (kDefaultShadowDistance),
+    clusteredLighting       (true),
+    occlusionCulling        (true),
+    depthPrePass            (false),
+    sortFrontToBack         (true)
 {
     /* Ensure that global resources are initialised. */
     m_resources.init();
 
+    /* Create the light material. The G-Buffer textures are bound to it when
+     * the light pass is executed. */
+    m_lightMaterial = new Material(m_resources->lightShader);
+    m_lightMaterial->setValue("lightClusterGridSize", glm::ivec3(LightClusters::kGridWidth,
+                                                                 LightClusters::kGridHeight,
+                                                                 LightClusters::kGridDepth));
+
     #if ORION_BUILD_DEBUG
         this->debugDrawLights = false;
     #endif
@@ -144,9 +145,18 @@ void DeferredRenderPipeline::render(const RenderWorld &world, RenderView &view,
     allocateResources(context);
 
     /* Get lists of visible entities and lights. */
-    context.cull(context.cullResults);
+    uint32_t cullFlags =
+        RenderWorld::kCullLights |
+        RenderWorld::kLODHysteresis |
+        RenderWorld::kCullClusters |
+        RenderWorld::kStreamTextures;
+    if (this->occlusionCulling)
+        cullFlags |= RenderWorld::kCullOcclusion;
+
+    context.cull(context.cullResults, cullFlags);
 
     prepareLights(context);
+    prepareLightClusters(context);
     prepareEntities(context);
 
     renderShadowMaps(context);
@@ -159,6 +169,9 @@ void DeferredRenderPipeline::render(const RenderWorld &world, RenderView &view,
 
     /* Render debug primitives. */
     renderDebug(context);
+
+    context.graph().compile();
+    context.graph().execute();
 }
 
 /** Allocate rendering resources.
@@ -173,30 +186,38 @@ void DeferredRenderPipeline::allocateResources(Context &context) const {
         setMips   (1).
         setFlags  (GPUTexture::kRenderTarget);
 
-    /* Allocate the main output textures. */
+    RenderGraph &graph = context.graph();
+
+    /* Declare the main output textures. */
     textureDesc.format      = kHDRColourBufferFormat;
-    context.colourBuffer    = g_renderTargetPool->allocate(textureDesc);
+    context.colourBuffer    = graph.createTexture("Colour Buffer", textureDesc);
     textureDesc.format      = kDepthBufferFormat;
-    context.depthBuffer     = g_renderTargetPool->allocate(textureDesc);
+    context.depthBuffer     = graph.createTexture("Depth Buffer", textureDesc);
 
-    /* Allocate the G-Buffer textures. */
+    /* Declare the G-Buffer textures. */
     textureDesc.format      = kDeferredBufferAFormat;
-    context.deferredBufferA = g_renderTargetPool->allocate(textureDesc);
+    context.deferredBufferA = graph.createTexture("G-Buffer A", textureDesc);
     textureDesc.format      = kDeferredBufferBFormat;
-    context.deferredBufferB = g_renderTargetPool->allocate(textureDesc);
+    context.deferredBufferB = graph.createTexture("G-Buffer B", textureDesc);
     textureDesc.format      = kDeferredBufferCFormat;
-    context.deferredBufferC = g_renderTargetPool->allocate(textureDesc);
+    context.deferredBufferC = graph.createTexture("G-Buffer C", textureDesc);
     textureDesc.format      = kDeferredBufferDFormat;
-    context.deferredBufferD = g_renderTargetPool->allocate(textureDesc);
+    context.deferredBufferD = graph.createTexture("G-Buffer D", textureDesc);
 
-    /* Create a material to refer to the render targets. */
-    context.lightMaterial = new Material(m_resources->lightShader);
+    context.shadowAtlas = RenderGraph::kInvalidResource;
+}
 
-    GPUSamplerStatePtr sampler = g_gpuManager->getSamplerState();
-    context.lightMaterial->setGPUTexture("deferredBufferA", context.deferredBufferA, sampler);
-    context.lightMaterial->setGPUTexture("deferredBufferB", context.deferredBufferB, sampler);
-    context.lightMaterial->setGPUTexture("deferredBufferC", context.deferredBufferC, sampler);
-    context.lightMaterial->setGPUTexture("deferredBufferD", context.deferredBufferD, sampler);
+/** Get the tile size to use for a shadow map.
+ * @param resolution    Desired resolution.
+ * @param atlasSize     Size of the atlas.
+ * @return              Smallest tile size of at least the given resolution,
+ *                      limited to the atlas size. */
+static uint16_t shadowTileSize(float resolution, uint16_t atlasSize) {
+    uint16_t size = ShadowAtlas::kMinTileSize;
+    while (size < resolution && size < atlasSize)
+        size *= 2;
+
+    return size;
 }
 
 /** Prepare light state.
@@ -204,6 +225,8 @@ void DeferredRenderPipeline::allocateResources(Context &context) const {
 void DeferredRenderPipeline::prepareLights(Context &context) const {
     context.lights.reserve(context.cullResults.lights.size());
 
+    const uint16_t atlasSize = shadowTileSize(this->shadowAtlasResolution, kMaxShadowAtlasResolution);
+
     for (RenderLight *renderLight : context.cullResults.lights) {
         /* Debug light rendering. */
         #if ORION_BUILD_DEBUG
@@ -239,199 +262,598 @@ void DeferredRenderPipeline::prepareLights(Context &context) const {
         context.lights.emplace_back();
         Light &light = context.lights.back();
 
-        light.renderLight = renderLight;
-
-        /* Flush resource updates. */
-        light.resources = renderLight->getResources();
-
-        if (renderLight->castsShadows()) {
-            allocateShadowMap(light);
-
-            /* Update the shadow map resource binding. */
-            GPUSamplerStatePtr sampler = g_gpuManager->getSamplerState(GPUSamplerStateDesc().
-                setFilterMode    (SamplerFilterMode::kBilinear).
-                setCompareEnable (true).
-                setCompareFunc   (ComparisonFunc::kLess));
-            light.resources->bindTexture(ResourceSlots::kShadowMap, light.shadowMap, sampler);
-
-            /* Now find all shadow casting entities which are affected by this
-             * light. */
-            const unsigned numShadowViews = renderLight->numShadowViews();
-            for (unsigned i = 0; i < numShadowViews; i++) {
-                RenderView &shadowView = renderLight->shadowView(i);
-
-                /* Update the viewport for the current shadow map resolution. */
-                IntRect viewport(0, 0, this->shadowMapResolution, this->shadowMapResolution);
-                shadowView.setViewport(viewport);
-
-                /* TODO: Could maybe exclude non-shadow casting entities during
-                 * the cull process? */
-                auto &cullResults = light.shadowMapCullResults[i];
-                context.world().cull(shadowView, cullResults, 0);
-
-                for (RenderEntity *entity : cullResults.entities) {
-                    if (entity->castsShadow()) {
-                        Shader *shader = entity->material()->shader();
-
-                        if (shader->numPasses(kShadowCasterPassType) > 0) {
-                            light.shadowMapDrawLists[i].add(entity, kShadowCasterPassType);
-                        } else {
-                            logWarning("Shader for shadow casting entity '%s' lacks shadow caster pass",
-                                       entity->name.c_str());
-                        }
-                    }
+        light.renderLight   = renderLight;
+        light.clustered     = false;
+        light.shadowMapSize = 0.0f;
+        light.shadowState   = nullptr;
+
+        /* Lights without shadows other than ambient/directional lights can be
+         * handled by the clustered pass, up to the maximum number that it
+         * supports. The rest are rendered individually. */
+        if (this->clusteredLighting &&
+            !renderLight->castsShadows() &&
+            (renderLight->type() == RenderLight::kPointLight || renderLight->type() == RenderLight::kSpotLight))
+        {
+            LightClusters::LightDesc desc;
+            desc.spot                = renderLight->type() == RenderLight::kSpotLight;
+            desc.position            = renderLight->position();
+            desc.direction           = renderLight->direction();
+            desc.colour              = renderLight->colour() * renderLight->intensity();
+            desc.range               = renderLight->range();
+            desc.cutoff              = renderLight->cutoff();
+            desc.attenuationConstant = renderLight->attenuationConstant();
+            desc.attenuationLinear   = renderLight->attenuationLinear();
+            desc.attenuationExp      = renderLight->attenuationExp();
+
+            light.clustered = context.lightClusters.add(desc);
+            if (light.clustered)
+                continue;
+        }
+
+        if (!renderLight->castsShadows())
+            continue;
+
+        switch (renderLight->type()) {
+            case RenderLight::kDirectionalLight:
+            {
+                light.shadowMapSize = this->shadowCascadeResolution;
+
+                /* Directional light shadow views must be fitted to the view.
+                 * This must be done before allocating shadow maps. */
+                const unsigned numCascades = glm::clamp(static_cast<unsigned>(this->shadowCascades),
+                                                        1u,
+                                                        RenderLight::kMaxShadowCascades);
+                renderLight->updateShadowCascades(context.view(),
+                                                  numCascades,
+                                                  this->shadowDistance,
+                                                  shadowTileSize(light.shadowMapSize, atlasSize));
+                break;
+            }
+
+            case RenderLight::kPointLight:
+            case RenderLight::kSpotLight:
+            {
+                /* Give lights a resolution according to the size of their
+                 * area of effect on screen. */
+                const Sphere sphere(renderLight->position(), renderLight->range());
+                light.shadowMapSize = std::min(context.view().projectedRadius(sphere) * 2.0f,
+                                               static_cast<float>(this->shadowMapResolution));
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    allocateShadowMaps(context);
+
+    for (Light &light : context.lights) {
+        if (light.clustered)
+            continue;
+
+        /* Flush resource updates. Must be done after allocating shadow maps as
+         * that sets the shadow space transformations. */
+        light.resources = light.renderLight->getResources();
+
+        if (light.shadowState)
+            prepareShadowMap(context, light);
+    }
+}
+
+/**
+ * Allocate shadow maps for lights.
+ *
+ * Allocates atlas tiles for the shadow views of all shadow casting lights.
+ * Lights keep their tiles from previous frames if their tile size has not
+ * changed. When there is not enough space, tiles are taken from lights which
+ * are not being rendered, then from less important lights, and then smaller
+ * tiles are used. Lights which cannot be given any space are rendered without
+ * shadows.
+ *
+ * @param context       Rendering context.
+ */
+void DeferredRenderPipeline::allocateShadowMaps(Context &context) const {
+    /* Recreate the atlas if its resolution has changed. This discards all
+     * existing shadow maps. */
+    const uint16_t atlasSize = shadowTileSize(this->shadowAtlasResolution, kMaxShadowAtlasResolution);
+    if (atlasSize != m_shadowAtlas.size()) {
+        m_shadowAtlas.reset(atlasSize);
+        m_shadowStates.clear();
+
+        auto desc = GPUTextureDesc().
+            setType   (GPUTexture::kTexture2D).
+            setWidth  (atlasSize).
+            setHeight (atlasSize).
+            setMips   (1).
+            setFlags  (GPUTexture::kRenderTarget).
+            setFormat (kShadowMapFormat);
+
+        m_shadowAtlasTexture = g_gpuManager->createTexture(desc);
+    }
+
+    for (auto &it : m_shadowStates)
+        it.second.used = false;
+
+    std::vector<Light *> lights;
+    for (Light &light : context.lights) {
+        if (light.shadowMapSize > 0.0f) {
+            light.shadowState       = &m_shadowStates[light.renderLight];
+            light.shadowState->used = true;
+
+            lights.push_back(&light);
+        }
+    }
+
+    /* Sort lights in order of importance. Directional lights affect the whole
+     * view so come first, others are ordered by their size on screen. */
+    std::stable_sort(
+        lights.begin(), lights.end(),
+        [] (const Light *a, const Light *b) {
+            const bool aDirectional = a->renderLight->type() == RenderLight::kDirectionalLight;
+            const bool bDirectional = b->renderLight->type() == RenderLight::kDirectionalLight;
+
+            if (aDirectional != bDirectional)
+                return aDirectional;
+
+            return a->shadowMapSize > b->shadowMapSize;
+        });
+
+    for (size_t i = 0; i < lights.size(); i++) {
+        Light &light = *lights[i];
+        ShadowState &state = *light.shadowState;
+        RenderLight *renderLight = light.renderLight;
+
+        const unsigned numTiles = renderLight->numShadowViews();
+        uint16_t tileSize = shadowTileSize(light.shadowMapSize, atlasSize);
+
+        /* Avoid reallocating and re-rendering when the desired resolution is
+         * hovering around the threshold between two tile sizes. */
+        if (renderLight->type() != RenderLight::kDirectionalLight &&
+            tileSize < state.requestedTileSize &&
+            light.shadowMapSize > state.requestedTileSize * kShadowTileShrinkThreshold &&
+            state.requestedTileSize <= shadowTileSize(this->shadowMapResolution, atlasSize))
+        {
+            tileSize = state.requestedTileSize;
+        }
+
+        /* Tiles are kept while the requested size is unchanged, even if they
+         * are smaller than requested due to lack of space, so that they are
+         * not reallocated every frame. */
+        if (!state.tileSize || state.numTiles != numTiles || state.requestedTileSize != tileSize) {
+            freeShadowTiles(state);
+            state.requestedTileSize = tileSize;
+
+            while (!allocateShadowTiles(state, tileSize, numTiles)) {
+                if (!evictShadowTiles(lights, i)) {
+                    if (tileSize <= ShadowAtlas::kMinTileSize)
+                        break;
+
+                    tileSize /= 2;
                 }
             }
+
+            if (!state.tileSize) {
+                light.shadowState = nullptr;
+                continue;
+            }
+        }
+
+        /* Views may have changed even if the tiles have not, so this must be
+         * done every frame. */
+        for (unsigned j = 0; j < numTiles; j++)
+            renderLight->setShadowTile(j, state.tiles[j], atlasSize);
+    }
+
+    /* Discard states that have nothing worth keeping. */
+    for (auto it = m_shadowStates.begin(); it != m_shadowStates.end(); ) {
+        if (!it->second.used && !it->second.tileSize) {
+            it = m_shadowStates.erase(it);
+        } else {
+            ++it;
         }
     }
 }
 
-/** Allocate a shadow map for a light.
- * @param light         Light to allocate for. */
-void DeferredRenderPipeline::allocateShadowMap(Light &light) const {
-    GPUTexture::Type type;
-    switch (light.renderLight->type()) {
-        case RenderLight::kSpotLight:
-            type = GPUTexture::kTexture2D;
-            break;
-        case RenderLight::kPointLight:
-            type = GPUTexture::kTextureCube;
-            break;
-        default:
-            fatal("TODO");
-            break;
+/** Allocate shadow map tiles for a light.
+ * @param state         Shadow state for the light (with no tiles allocated).
+ * @param tileSize      Size of the tiles.
+ * @param numTiles      Number of tiles to allocate.
+ * @return              Whether there was space for all of the tiles. */
+bool DeferredRenderPipeline::allocateShadowTiles(ShadowState &state, uint16_t tileSize, unsigned numTiles) const {
+    for (unsigned i = 0; i < numTiles; i++) {
+        if (!m_shadowAtlas.allocate(tileSize, state.tiles[i])) {
+            while (i > 0)
+                m_shadowAtlas.free(state.tiles[--i]);
+
+            return false;
+        }
+
+        /* New tiles must be rendered. */
+        state.views[i].valid = false;
     }
 
-    auto desc = GPUTextureDesc().
-        setType   (type).
-        setWidth  (this->shadowMapResolution).
-        setHeight (this->shadowMapResolution).
-        setMips   (1).
-        setFlags  (GPUTexture::kRenderTarget).
-        setFormat (kShadowMapFormat);
+    state.tileSize = tileSize;
+    state.numTiles = numTiles;
+    return true;
+}
+
+/** Free a light's shadow map tiles.
+ * @param state         Shadow state for the light. */
+void DeferredRenderPipeline::freeShadowTiles(ShadowState &state) const {
+    for (unsigned i = 0; i < state.numTiles; i++)
+        m_shadowAtlas.free(state.tiles[i]);
+
+    state.tileSize = 0;
+    state.numTiles = 0;
+}
+
+/**
+ * Evict shadow map tiles to make space for a light.
+ *
+ * Frees the tiles of a light which is not being rendered if there is one, or
+ * otherwise the least important light after the one being allocated for that
+ * has any.
+ *
+ * @param lights        Lights being rendered, in order of importance.
+ * @param index         Index of the light being allocated for.
+ *
+ * @return              Whether any tiles were freed.
+ */
+bool DeferredRenderPipeline::evictShadowTiles(const std::vector<Light *> &lights, size_t index) const {
+    for (auto &it : m_shadowStates) {
+        if (!it.second.used && it.second.tileSize) {
+            freeShadowTiles(it.second);
+            return true;
+        }
+    }
+
+    for (size_t i = lights.size() - 1; i > index; i--) {
+        ShadowState &state = *lights[i]->shadowState;
+
+        if (state.tileSize) {
+            freeShadowTiles(state);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Prepare a light's shadow map for rendering.
+ *
+ * Finds the shadow casting entities in each of the light's shadow views, and
+ * determines whether the view needs to be rendered. Views are only rendered
+ * if the view itself or the set of casters within it has changed since its
+ * tile was last rendered, so for static lights and entities the shadow map is
+ * only rendered once. Casters are detected as changed using their change
+ * stamps (see RenderEntity::changeStamp()). Casters whose shadows are not
+ * visible in the main view are excluded, so moving the main view can also
+ * require a view to be rendered again.
+ *
+ * @param context       Rendering context.
+ * @param light         Light to prepare.
+ */
+void DeferredRenderPipeline::prepareShadowMap(Context &context, Light &light) const {
+    RenderLight *renderLight = light.renderLight;
+    ShadowState &state = *light.shadowState;
+
+    /* Update the shadow map resource binding. This does nothing if the light
+     * already has the atlas bound. */
+    light.resources->bindTexture(ResourceSlots::kShadowMap,
+                                 m_shadowAtlasTexture,
+                                 m_resources->shadowMapSampler);
+
+    /* Now find all shadow casting entities which are affected by this
+     * light. */
+    context.world().cullShadowCasters(renderLight,
+                                      context.view(),
+                                      light.shadowMapCullResults,
+                                      RenderWorld::kCullClusters);
+
+    const unsigned numShadowViews = renderLight->numShadowViews();
+    for (unsigned i = 0; i < numShadowViews; i++) {
+        RenderView &shadowView = renderLight->shadowView(i);
+        auto &cullResults = light.shadowMapCullResults[i];
+
+        uint64_t casterStamp = 0;
+        size_t casterHash = 0;
+
+        for (const RenderWorld::VisibleEntity &visible : cullResults.entities) {
+            casterStamp = std::max(casterStamp, visible.entity->changeStamp());
+            casterHash = hashCombine(casterHash, visible.entity);
+            casterHash = hashCombine(casterHash, visible.lod);
+        }
+
+        ShadowState::View &cached = state.views[i];
+        const glm::mat4 &viewProjection = shadowView.viewProjection();
+
+        light.shadowMapOutdated[i] =
+            !cached.valid ||
+            cached.viewProjection != viewProjection ||
+            cached.casterStamp != casterStamp ||
+            cached.casterHash != casterHash;
+
+        if (!light.shadowMapOutdated[i])
+            continue;
 
-    light.shadowMap = g_renderTargetPool->allocate(desc);
+        cached.valid          = true;
+        cached.viewProjection = viewProjection;
+        cached.casterStamp    = casterStamp;
+        cached.casterHash     = casterHash;
+
+        for (const RenderWorld::VisibleEntity &visible : cullResults.entities) {
+            RenderEntity *entity = visible.entity;
+            Shader *shader = entity->material()->shader();
+
+            if (shader->numPasses(kShadowCasterPassType) > 0) {
+                light.shadowMapDrawLists[i].add(entity, kShadowCasterPassType, visible.lod, visible.indices);
+            } else {
+                logWarning("Shader for shadow casting entity '%s' lacks shadow caster pass",
+                           entity->name.c_str());
+            }
+        }
+    }
+}
+
+/** Bin lights for clustered lighting and upload the results.
+ * @param context       Rendering context. */
+void DeferredRenderPipeline::prepareLightClusters(Context &context) const {
+    if (!context.lightClusters.numLights())
+        return;
+
+    LightClusters &clusters = context.lightClusters;
+    RenderView &view = context.view();
+    clusters.build(view.view(), view.projection(), view.zNear(), view.zFar());
+
+    auto textureDesc = GPUTextureDesc().
+        setType (GPUTexture::kTexture2D).
+        setMips (1);
+
+    /* Cluster grid, one row per depth slice. */
+    textureDesc.width           = LightClusters::kGridWidth * LightClusters::kGridHeight;
+    textureDesc.height          = LightClusters::kGridDepth;
+    textureDesc.format          = PixelFormat::kFloatR32G32;
+    context.lightClusterGrid    = g_renderTargetPool->allocate(textureDesc);
+    context.lightClusterGrid->update(IntRect(0, 0, textureDesc.width, textureDesc.height), clusters.grid());
+
+    /* Index list, filled row by row. Only upload the used part. */
+    textureDesc.width           = LightClusters::kIndexTextureWidth;
+    textureDesc.height          = LightClusters::kMaxIndices / LightClusters::kIndexTextureWidth;
+    textureDesc.format          = PixelFormat::kFloatR32;
+    context.lightClusterIndices = g_renderTargetPool->allocate(textureDesc);
+
+    const uint32_t fullRows  = clusters.numIndices() / textureDesc.width;
+    const uint32_t remainder = clusters.numIndices() % textureDesc.width;
+    if (fullRows > 0)
+        context.lightClusterIndices->update(IntRect(0, 0, textureDesc.width, fullRows), clusters.indices());
+    if (remainder > 0) {
+        context.lightClusterIndices->update(IntRect(0, fullRows, remainder, 1),
+                                            clusters.indices() + (fullRows * textureDesc.width));
+    }
+
+    /* Light data, one row per light. */
+    textureDesc.width           = LightClusters::kLightDataTexels;
+    textureDesc.height          = LightClusters::kMaxLights;
+    textureDesc.format          = PixelFormat::kFloatR32G32B32A32;
+    context.lightClusterData    = g_renderTargetPool->allocate(textureDesc);
+    context.lightClusterData->update(IntRect(0, 0, textureDesc.width, clusters.numLights()), clusters.lightData());
+
+    GPUSamplerState *sampler = m_resources->defaultSampler;
+    m_lightMaterial->setGPUTexture("lightClusterGrid", context.lightClusterGrid, sampler);
+    m_lightMaterial->setGPUTexture("lightClusterIndices", context.lightClusterIndices, sampler);
+    m_lightMaterial->setGPUTexture("lightClusterData", context.lightClusterData, sampler);
+
+    /* Setting a value always causes the material uniforms to be uploaded, so
+     * avoid doing so unless the view depth range has changed. */
+    glm::vec2 depthParameters;
+    m_lightMaterial->getValue("lightClusterDepth", depthParameters);
+    if (depthParameters != clusters.depthParameters())
+        m_lightMaterial->setValue("lightClusterDepth", clusters.depthParameters());
 }
 
 /** Prepare entity state.
  * @param context       Rendering context. */
 void DeferredRenderPipeline::prepareEntities(Context &context) const {
-    for (RenderEntity *entity : context.cullResults.entities) {
+    for (const RenderWorld::VisibleEntity &visible : context.cullResults.entities) {
+        RenderEntity *entity = visible.entity;
         Shader *shader = entity->material()->shader();
 
         if (shader->numPasses(kDeferredPassType) > 0) {
-            context.deferredDrawList.add(entity, kDeferredPassType);
+            if (!this->depthPrePass) {
+                context.deferredDrawList.add(entity, kDeferredPassType, visible.lod, visible.indices);
+            } else if (shader->numPasses(kShadowCasterPassType) > 0) {
+                /* The shadow caster pass outputs only depth, so it can be used
+                 * to render the depth pre-pass. */
+                context.depthDrawList.add(entity, kShadowCasterPassType, visible.lod, visible.indices);
+                context.deferredDrawList.add(entity, kDeferredPassType, visible.lod, visible.indices);
+            } else {
+                context.lateDeferredDrawList.add(entity, kDeferredPassType, visible.lod, visible.indices);
+            }
         } else if (shader->numPasses(Pass::kBasicType) > 0) {
-            context.basicDrawList.add(entity, Pass::kBasicType);
+            context.basicDrawList.add(entity, Pass::kBasicType, visible.lod, visible.indices);
         } else {
             logWarning("Don't know how to draw entity '%s'", entity->name.c_str());
         }
     }
+
+    if (this->sortFrontToBack) {
+        const glm::vec3 &viewPosition = context.view().position();
+
+        context.depthDrawList.sortFrontToBack(viewPosition);
+        context.deferredDrawList.sortFrontToBack(viewPosition);
+        context.lateDeferredDrawList.sortFrontToBack(viewPosition);
+    }
 }
 
-/** Render shadow maps.
+/** Add passes to render shadow maps.
  * @param context       Rendering context. */
 void DeferredRenderPipeline::renderShadowMaps(Context &context) const {
-    GPU_DEBUG_GROUP("Shadow Maps");
+    if (!m_shadowAtlasTexture)
+        return;
+
+    RenderGraph &graph = context.graph();
+    context.shadowAtlas = graph.importTexture("Shadow Atlas", GPUTextureImageRef(m_shadowAtlasTexture));
 
     for (Light &light : context.lights) {
-        if (!light.shadowMap)
+        if (!light.shadowState)
             continue;
 
         RenderLight *renderLight = light.renderLight;
 
-        GPU_DEBUG_GROUP("Light '%s'", renderLight->name.c_str());
-
         const unsigned numShadowViews = renderLight->numShadowViews();
         for (unsigned i = 0; i < numShadowViews; i++) {
-            GPU_DEBUG_GROUP("View %u", i);
+            /* Keep the previous contents of the tile if nothing has changed. */
+            if (!light.shadowMapOutdated[i])
+                continue;
 
             RenderView &shadowView = renderLight->shadowView(i);
 
-            GPURenderPassInstanceDesc passDesc(m_resources->shadowMapPass);
-            passDesc.targets.depthStencil.texture = light.shadowMap;
-            passDesc.targets.depthStencil.layer   = i;
-            passDesc.clearDepth                   = 1.0;
-            passDesc.renderArea                   = shadowView.viewport();
-
-            GPUCommandList *cmdList = g_gpuManager->beginRenderPass(passDesc);
-
-            /* Bind resources. */
-            cmdList->bindResourceSet(ResourceSets::kLightResources, light.resources);
-            cmdList->bindResourceSet(ResourceSets::kViewResources, shadowView.getResources());
-
-            /* Render the shadow map. Default state is what we want here:
-             * blending disabled, depth test/write enabled. */
-            light.shadowMapDrawLists[i].draw(cmdList, ShaderKeywordSet());
-
-            g_gpuManager->submitRenderPass(cmdList);
+            /* The render area is the view's tile, so only that is cleared. */
+            RenderGraph::Pass &pass = graph.addPass(String::format("Shadow Map '%s' View %u",
+                                                                   renderLight->name.c_str(),
+                                                                   i));
+            pass.setDepthStencilAttachment(context.shadowAtlas, GPURenderLoadOp::kClear, 1.0f);
+            pass.setRenderArea(shadowView.viewport());
+            pass.setFunction(
+                [&light, &shadowView, i] (const RenderGraph &graph, GPUCommandList *cmdList) {
+                    /* Bind resources. */
+                    cmdList->bindResourceSet(ResourceSets::kLightResources, light.resources);
+                    cmdList->bindResourceSet(ResourceSets::kViewResources, shadowView.getResources());
+
+                    /* Render the shadow map. Default state is what we want
+                     * here: blending disabled, depth test/write enabled. */
+                    light.shadowMapDrawLists[i].draw(cmdList, ShaderKeywordSet());
+                });
         }
     }
 }
 
-/** Perform deferred rendering.
+/** Add passes to perform deferred rendering.
  * @param context       Rendering context. */
 void DeferredRenderPipeline::renderDeferred(Context &context) const {
-    GPU_DEBUG_GROUP("Deferred Rendering");
+    if (this->depthPrePass)
+        renderDepthPrePass(context);
 
     renderDeferredGBuffer(context);
     renderDeferredLights(context);
 }
 
-/** Render the G-Buffer.
+/** Add a pass to render the depth pre-pass.
  * @param context       Rendering context. */
-void DeferredRenderPipeline::renderDeferredGBuffer(Context &context) const {
-    GPU_DEBUG_GROUP("G-Buffer Pass");
-
-    GPURenderPassInstanceDesc passDesc(m_resources->gBufferPass);
-    passDesc.targets.colour[0].texture    = context.deferredBufferA;
-    passDesc.targets.colour[1].texture    = context.deferredBufferB;
-    passDesc.targets.colour[2].texture    = context.deferredBufferC;
-    passDesc.targets.depthStencil.texture = context.depthBuffer;
-    passDesc.clearColours[0]              = glm::vec4(0.0, 0.0, 0.0, 0.0);
-    passDesc.clearColours[1]              = glm::vec4(0.0, 0.0, 0.0, 0.0);
-    passDesc.clearColours[2]              = glm::vec4(0.0, 0.0, 0.0, 0.0);
-    passDesc.clearDepth                   = 1.0;
-    passDesc.clearStencil                 = 0;
-    passDesc.renderArea                   = context.renderArea;
-
-    GPUCommandList *cmdList = g_gpuManager->beginRenderPass(passDesc);
-
-    /* Bind view resources. */
-    cmdList->bindResourceSet(ResourceSets::kViewResources, context.view().getResources());
+void DeferredRenderPipeline::renderDepthPrePass(Context &context) const {
+    RenderGraph::Pass &pass = context.graph().addPass("Depth Pre-Pass");
+    pass.setDepthStencilAttachment(context.depthBuffer, GPURenderLoadOp::kClear, 1.0f, 0);
+    pass.setRenderArea(context.renderArea);
+    pass.setFunction(
+        [&context] (const RenderGraph &graph, GPUCommandList *cmdList) {
+            /* Bind view resources. */
+            cmdList->bindResourceSet(ResourceSets::kViewResources, context.view().getResources());
+
+            /* Default state is what we want here: blending disabled, depth
+             * test/write enabled. */
+            context.depthDrawList.draw(cmdList, ShaderKeywordSet());
+        });
+}
 
-    /* Render everything to the G-Buffer. Default state is what we want,
-     * blending disabled, depth test/write enabled. */
-    context.deferredDrawList.draw(cmdList, ShaderKeywordSet());
+/** Add passes to render the G-Buffer.
+ * @param context       Rendering context. */
+void DeferredRenderPipeline::renderDeferredGBuffer(Context &context) const {
+    RenderGraph &graph = context.graph();
+
+    /* Keep the depth buffer contents from the pre-pass if there is one. */
+    const GPURenderLoadOp depthLoadOp = (this->depthPrePass)
+                                            ? GPURenderLoadOp::kLoad
+                                            : GPURenderLoadOp::kClear;
+
+    RenderGraph::Pass &pass = graph.addPass("G-Buffer Pass");
+    pass.setColourAttachment(0, context.deferredBufferA, GPURenderLoadOp::kClear, glm::vec4(0.0, 0.0, 0.0, 0.0));
+    pass.setColourAttachment(1, context.deferredBufferB, GPURenderLoadOp::kClear, glm::vec4(0.0, 0.0, 0.0, 0.0));
+    pass.setColourAttachment(2, context.deferredBufferC, GPURenderLoadOp::kClear, glm::vec4(0.0, 0.0, 0.0, 0.0));
+    pass.setDepthStencilAttachment(context.depthBuffer, depthLoadOp, 1.0f, 0);
+    pass.setRenderArea(context.renderArea);
+    pass.setFunction(
+        [this, &context] (const RenderGraph &graph, GPUCommandList *cmdList) {
+            /* Bind view resources. */
+            cmdList->bindResourceSet(ResourceSets::kViewResources, context.view().getResources());
+
+            /* If the depth pre-pass has been rendered, the depth buffer
+             * already holds the visible surface, so only shade fragments
+             * which match it. Otherwise, default state is what we want,
+             * blending disabled, depth test/write enabled. */
+            if (this->depthPrePass) {
+                cmdList->setDepthStencilState(GPUDepthStencilStateDesc().
+                    setDepthFunc  (ComparisonFunc::kEqual).
+                    setDepthWrite (false));
+            }
 
-    g_gpuManager->submitRenderPass(cmdList);
+            context.deferredDrawList.draw(cmdList, ShaderKeywordSet());
 
-    /* Make a copy of the depth buffer. We need to do this as we want to
-     * keep the same depth buffer while rendering light volumes, but the
-     * light shaders need to read the depth buffer. */
-    g_gpuManager->blit(GPUTextureImageRef(context.depthBuffer),
-                       GPUTextureImageRef(context.deferredBufferD),
-                       context.renderArea.pos(),
-                       context.renderArea.pos(),
-                       context.renderArea.size());
+            /* Render entities which were not in the pre-pass. */
+            if (this->depthPrePass) {
+                cmdList->setDepthStencilState();
+                context.lateDeferredDrawList.draw(cmdList, ShaderKeywordSet());
+            }
+        });
+
+    /* Make a copy of the depth buffer. We need to do this as we want to keep
+     * the same depth buffer while rendering light volumes, but the light
+     * shaders need to read the depth buffer. */
+    RenderGraph::Pass &copyPass = graph.addPass("Depth Copy");
+    copyPass.addInput(context.depthBuffer);
+    copyPass.addOutput(context.deferredBufferD);
+    copyPass.setFunction(
+        [&context] (const RenderGraph &graph, GPUCommandList *cmdList) {
+            g_gpuManager->blit(graph.textureImage(context.depthBuffer),
+                               graph.textureImage(context.deferredBufferD),
+                               context.renderArea.pos(),
+                               context.renderArea.pos(),
+                               context.renderArea.size());
+        });
 }
 
-/** Perform deferred light rendering.
+/** Add a pass to perform deferred light rendering.
  * @param context       Rendering context. */
 void DeferredRenderPipeline::renderDeferredLights(Context &context) const {
-    GPU_DEBUG_GROUP("Light Pass");
-
-    /* Begin the light pass on the primary render target. */
-    GPURenderPassInstanceDesc passDesc(m_resources->lightPass);
-    passDesc.targets.colour[0].texture    = context.colourBuffer;
-    passDesc.targets.depthStencil.texture = context.depthBuffer;
-    passDesc.clearColours[0]              = glm::vec4(0.0, 0.0, 0.0, 1.0);
-    passDesc.renderArea                   = context.renderArea;
+    RenderGraph::Pass &pass = context.graph().addPass("Light Pass");
+
+    /* Render onto the primary render target, keeping the depth buffer from the
+     * G-Buffer pass for testing against light volumes. */
+    pass.setColourAttachment(0, context.colourBuffer, GPURenderLoadOp::kClear, glm::vec4(0.0, 0.0, 0.0, 1.0));
+    pass.setDepthStencilAttachment(context.depthBuffer);
+    pass.setRenderArea(context.renderArea);
+
+    pass.addInput(context.deferredBufferA);
+    pass.addInput(context.deferredBufferB);
+    pass.addInput(context.deferredBufferC);
+    pass.addInput(context.deferredBufferD);
+    if (context.shadowAtlas != RenderGraph::kInvalidResource)
+        pass.addInput(context.shadowAtlas);
+
+    pass.setFunction(
+        [this, &context] (const RenderGraph &graph, GPUCommandList *cmdList) {
+            drawDeferredLights(context, graph, cmdList);
+        });
+}
 
-    GPUCommandList *cmdList = g_gpuManager->beginRenderPass(passDesc);
+/** Draw deferred lights.
+ * @param context       Rendering context.
+ * @param graph         Render graph being executed.
+ * @param cmdList       Command list for the light pass. */
+void DeferredRenderPipeline::drawDeferredLights(Context &context,
+                                                const RenderGraph &graph,
+                                                GPUCommandList *cmdList) const
+{
+    /* Bind the G-Buffer textures. */
+    GPUSamplerState *sampler = m_resources->defaultSampler;
+    m_lightMaterial->setGPUTexture("deferredBufferA", graph.texture(context.deferredBufferA), sampler);
+    m_lightMaterial->setGPUTexture("deferredBufferB", graph.texture(context.deferredBufferB), sampler);
+    m_lightMaterial->setGPUTexture("deferredBufferC", graph.texture(context.deferredBufferC), sampler);
+    m_lightMaterial->setGPUTexture("deferredBufferD", graph.texture(context.deferredBufferD), sampler);
 
     /* Set up state for the light material. */
-    context.lightMaterial->setDrawState(cmdList);
+    m_lightMaterial->setDrawState(cmdList);
 
     /* Bind view resources. */
     cmdList->bindResourceSet(ResourceSets::kViewResources, context.view().getResources());
@@ -445,7 +867,30 @@ void DeferredRenderPipeline::renderDeferredLights(Context &context) const {
         setSourceAlphaFactor (BlendFactor::kOne).
         setDestAlphaFactor   (BlendFactor::kZero));
 
+    /* Render all clustered lights in a single full-screen pass. */
+    if (context.lightClusters.numLights()) {
+        GPU_CMD_DEBUG_GROUP(cmdList, "Clustered Lights");
+
+        cmdList->setDepthStencilState(GPUDepthStencilStateDesc().
+            setDepthFunc  (ComparisonFunc::kAlways).
+            setDepthWrite (false));
+
+        cmdList->setRasterizerState();
+
+        ShaderKeywordSet variation;
+        variation.insert(kClusteredVariation);
+
+        const Pass *pass = m_resources->lightShader->getPass(kDeferredLightPassType, 0);
+        pass->setDrawState(cmdList, variation);
+
+        Geometry geometry = g_renderResources->quadGeometry();
+        cmdList->draw(geometry.primitiveType, geometry.vertices, geometry.indices);
+    }
+
     for (Light &light : context.lights) {
+        if (light.clustered)
+            continue;
+
         GPU_CMD_DEBUG_GROUP(cmdList, "Light '%s'", light.renderLight->name.c_str());
 
         /* Set up rasterizer/depth testing state. No depth writes here, the
@@ -484,7 +929,7 @@ void DeferredRenderPipeline::renderDeferredLights(Context &context) const {
         /* Set up the appropriate pass from the light shader. */
         ShaderKeywordSet variation;
         variation.insert(kLightVariations[light.renderLight->type()]);
-        if (light.renderLight->castsShadows())
+        if (light.shadowState)
             variation.insert(kShadowVariation);
 
         const Pass *pass = m_resources->lightShader->getPass(kDeferredLightPassType, 0);
@@ -497,26 +942,20 @@ void DeferredRenderPipeline::renderDeferredLights(Context &context) const {
         Geometry geometry = light.renderLight->volumeGeometry();
         cmdList->draw(geometry.primitiveType, geometry.vertices, geometry.indices);
     }
-
-    g_gpuManager->submitRenderPass(cmdList);
 }
 
-/** Render basic materials.
+/** Add a pass to render basic materials.
  * @param context       Rendering context. */
 void DeferredRenderPipeline::renderBasic(Context &context) const {
-    GPU_DEBUG_GROUP("Basic");
-
-    GPURenderPassInstanceDesc passDesc(m_resources->basicPass);
-    passDesc.targets.colour[0].texture    = context.colourBuffer;
-    passDesc.targets.depthStencil.texture = context.depthBuffer;
-    passDesc.renderArea                   = context.renderArea;
-
-    GPUCommandList *cmdList = g_gpuManager->beginRenderPass(passDesc);
-
-    /* Bind view resources. */
-    cmdList->bindResourceSet(ResourceSets::kViewResources, context.view().getResources());
-
-    context.basicDrawList.draw(cmdList, ShaderKeywordSet());
-
-    g_gpuManager->submitRenderPass(cmdList);
+    RenderGraph::Pass &pass = context.graph().addPass("Basic");
+    pass.setColourAttachment(0, context.colourBuffer);
+    pass.setDepthStencilAttachment(context.depthBuffer);
+    pass.setRenderArea(context.renderArea);
+    pass.setFunction(
+        [&context] (const RenderGraph &graph, GPUCommandList *cmdList) {
+            /* Bind view resources. */
+            cmdList->bindResourceSet(ResourceSets::kViewResources, context.view().getResources());
+
+            context.basicDrawList.draw(cmdList, ShaderKeywordSet());
+        });
 }
@@ -19,6 +19,8 @@
  * @brief               Draw list class.
  */
 
+#include "gpu/gpu_manager.h"
+
 #include "render/draw_list.h"
 #include "render/render_entity.h"
 
@@ -26,13 +28,161 @@
 #include "render_core/material.h"
 #include "render_core/shader.h"
 
-DrawList::DrawList() {}
-DrawList::~DrawList() {}
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/** Number of rows of the per-instance transformation matrix. */
+static const unsigned kInstanceTransformRows = 3;
+
+/** Per-instance data supplied for entity draws. */
+struct InstanceData {
+    /** Rows of the affine transformation applied to vertices. */
+    glm::vec4 transform[kInstanceTransformRows];
+};
+
+/** Key identifying draws which can be merged into one instanced draw. */
+struct BatchKey {
+    const Pass *pass;
+    Material *material;
+    GPUVertexData *vertices;
+    GPUIndexData *indices;
+    PrimitiveType primitiveType;
+
+    /** Compare this key with another. */
+    bool operator ==(const BatchKey &other) const {
+        return pass == other.pass &&
+               material == other.material &&
+               vertices == other.vertices &&
+               indices == other.indices &&
+               primitiveType == other.primitiveType;
+    }
+
+    /** Get a hash from a batch key. */
+    friend size_t hashValue(const BatchKey &key) {
+        size_t hash = hashValue(key.pass);
+        hash = hashCombine(hash, key.material);
+        hash = hashCombine(hash, key.vertices);
+        hash = hashCombine(hash, key.indices);
+        hash = hashCombine(hash, key.primitiveType);
+        return hash;
+    }
+};
+
+/** Draws merged into one instanced draw. */
+struct Batch {
+    RenderEntity *entity;                   /**< First entity in the batch. */
+    const Pass *pass;                       /**< Pass to draw with. */
+    Geometry geometry;                      /**< Geometry to draw. */
+    uint32_t firstInstance;                 /**< Index of first instance in the instance buffer. */
+    uint32_t numInstances;                  /**< Number of instances. */
+};
+
+/** Minimum number of instances that an instance buffer can hold. */
+static const size_t kMinInstanceBufferSize = 256;
+
+/** Number of uses of an instance buffer after which unused cache entries are freed. */
+static const uint32_t kInstanceCacheLifetime = 64;
+
+/** Instanced vertex data cached with an instance buffer. */
+struct InstancedVertexData {
+    GPUVertexDataPtr source;                /**< Source vertex data. */
+    GPUVertexDataPtr instanced;             /**< Vertex data with the instance binding. */
+    uint32_t lastUse;                       /**< Use count of the buffer when last used. */
+};
+
+/** Instance buffer shared between draw lists. */
+struct DrawList::InstanceBuffer {
+    GPUBufferPtr buffer;                    /**< Buffer containing instance data. */
+    size_t size;                            /**< Number of instances the buffer can hold. */
+    uint32_t useCount;                      /**< Number of times the buffer has been used. */
+
+    /** Cached instanced vertex data, keyed by source vertex data. */
+    HashMap<GPUVertexData *, InstancedVertexData> vertexData;
+
+    InstanceBuffer() : size(0), useCount(0) {}
+};
+
+/** Pool of instance buffers not currently in use by a draw list. */
+struct DrawListResources {
+    std::vector<std::unique_ptr<DrawList::InstanceBuffer>> freeBuffers;
+};
+
+static GlobalResource<DrawListResources> g_drawListResources;
+
+/** Create vertex data with an instance buffer binding appended.
+ * @param vertices      Vertex data to draw.
+ * @param buffer        Instance buffer.
+ * @return              Vertex data with an additional instanced binding. */
+static GPUVertexDataPtr createInstancedVertexData(GPUVertexData *vertices, GPUBuffer *buffer) {
+    GPUVertexDataLayoutDesc layoutDesc = vertices->layout()->desc();
+
+    const unsigned binding = layoutDesc.bindings.size();
+    layoutDesc.bindings.emplace_back();
+    layoutDesc.bindings[binding].stride    = sizeof(InstanceData);
+    layoutDesc.bindings[binding].instanced = true;
+
+    for (unsigned i = 0; i < kInstanceTransformRows; i++) {
+        layoutDesc.attributes.emplace_back();
+
+        VertexAttribute &attribute = layoutDesc.attributes.back();
+        attribute.semantic   = VertexAttribute::kTransformSemantic;
+        attribute.index      = i;
+        attribute.type       = VertexAttribute::kFloatType;
+        attribute.normalised = false;
+        attribute.components = 4;
+        attribute.binding    = binding;
+        attribute.offset     = offsetof(InstanceData, transform) + (i * sizeof(glm::vec4));
+    }
+
+    auto vertexDataDesc = GPUVertexDataDesc().
+        setCount  (vertices->count()).
+        setLayout (g_gpuManager->getVertexDataLayout(layoutDesc));
+    for (size_t i = 0; i < binding; i++)
+        vertexDataDesc.buffers[i] = vertices->buffers()[i];
+    vertexDataDesc.buffers[binding] = buffer;
+
+    return g_gpuManager->createVertexData(std::move(vertexDataDesc));
+}
+
+DrawList::DrawList() :
+    m_instanceBuffer (nullptr)
+{}
+
+/** Move a draw list.
+ * @param other         Draw list to move from. */
+DrawList::DrawList(DrawList &&other) :
+    m_draws          (std::move(other.m_draws)),
+    m_instanceBuffer (other.m_instanceBuffer)
+{
+    other.m_instanceBuffer = nullptr;
+}
+
+/** Destroy the draw list, returning its instance buffer to the pool. */
+DrawList::~DrawList() {
+    if (m_instanceBuffer) {
+        /* Drop cached vertex data which has not been used recently, so that we
+         * do not keep destroyed meshes' vertex data alive forever. */
+        auto &cache = m_instanceBuffer->vertexData;
+        for (auto it = cache.begin(); it != cache.end(); ) {
+            if (m_instanceBuffer->useCount - it->second.lastUse > kInstanceCacheLifetime) {
+                it = cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        g_drawListResources->freeBuffers.emplace_back(m_instanceBuffer);
+    }
+}
 
 /** Add draw calls for an entity to the list.
  * @param entity        Entity to add.
- * @param passType      Pass type to add. */
-void DrawList::add(RenderEntity *entity, const std::string &passType) {
+ * @param passType      Pass type to add.
+ * @param lod           Level of detail to draw.
+ * @param indices       If not null, index data to draw instead of that of the
+ *                      entity's geometry. */
+void DrawList::add(RenderEntity *entity, const std::string &passType, unsigned lod, GPUIndexData *indices) {
     Shader *shader = entity->material()->shader();
 
     for (size_t i = 0; i < shader->numPasses(passType); i++) {
@@ -41,23 +191,165 @@ void DrawList::add(RenderEntity *entity, const std::string &passType) {
 
         draw.entity = entity;
         draw.pass = shader->getPass(passType, i);
+        draw.lod = lod;
+        draw.indices = indices;
+        draw.distance = 0.0f;
+    }
+}
+
+/**
+ * Sort the list front-to-back.
+ *
+ * Sorts draws by the (squared) distance from the view position to the closest
+ * point on their entity's bounding box, nearest first. Since draws are merged into
+ * instanced draws at the position of the first of them, each merged draw
+ * (i.e. each set of state) is then performed in order of its nearest entity,
+ * and its instances are in front-to-back order. This allows early depth
+ * testing to reject more of the fragments of later draws.
+ *
+ * @param viewPosition  World space position of the view.
+ */
+void DrawList::sortFrontToBack(const glm::vec3 &viewPosition) {
+    for (Draw &draw : m_draws) {
+        const BoundingBox &box = draw.entity->worldBoundingBox();
+        const glm::vec3 offset = glm::clamp(viewPosition, box.minimum, box.maximum) - viewPosition;
+        draw.distance = glm::dot(offset, offset);
     }
+
+    std::stable_sort(m_draws.begin(),
+                     m_draws.end(),
+                     [] (const Draw &a, const Draw &b) {
+                         return a.distance < b.distance;
+                     });
 }
 
-/** Perform all draw calls in the list.
+/**
+ * Perform all draw calls in the list.
+ *
+ * Draws with the same geometry, material and pass are merged into a single
+ * instanced draw call. Merged draws are performed at the position of the first
+ * of them in the list.
+ *
  * @param cmdList       GPU command list to draw on.
- * @param variation     Shader variation to use. */
+ * @param variation     Shader variation to use.
+ */
 void DrawList::draw(GPUCommandList *cmdList, const ShaderKeywordSet &variation) {
-    /* TODO: Track current pass/material/entity/etc, minimize the state changes. */
-    for (const Draw &draw : m_draws) {
-        GPU_CMD_DEBUG_GROUP(cmdList, "%s", draw.entity->name.c_str());
+    if (m_draws.empty())
+        return;
+
+    std::vector<Batch> batches;
+    std::vector<uint32_t> drawBatches(m_draws.size());
+    HashMap<BatchKey, uint32_t> batchMap;
+
+    /* Determine the batch for each draw. */
+    for (size_t i = 0; i < m_draws.size(); i++) {
+        const Draw &draw = m_draws[i];
+
+        Geometry geometry = draw.entity->geometry(draw.lod);
+        if (draw.indices)
+            geometry.indices = draw.indices;
+
+        BatchKey key;
+        key.pass          = draw.pass;
+        key.material      = draw.entity->material();
+        key.vertices      = geometry.vertices;
+        key.indices       = geometry.indices;
+        key.primitiveType = geometry.primitiveType;
+
+        auto ret = batchMap.insert(std::make_pair(key, batches.size()));
+        if (ret.second) {
+            batches.emplace_back();
+            Batch &batch = batches.back();
+
+            batch.entity       = draw.entity;
+            batch.pass         = draw.pass;
+            batch.geometry     = geometry;
+            batch.numInstances = 0;
+        }
+
+        drawBatches[i] = ret.first->second;
+        batches[drawBatches[i]].numInstances++;
+    }
+
+    /* Lay out each batch's instances contiguously in the instance buffer. */
+    uint32_t numInstances = 0;
+    for (Batch &batch : batches) {
+        batch.firstInstance = numInstances;
+        numInstances += batch.numInstances;
+        batch.numInstances = 0;
+    }
+
+    /* Get an instance buffer large enough for all instances. */
+    if (!m_instanceBuffer) {
+        g_drawListResources.init();
+        auto &freeBuffers = g_drawListResources->freeBuffers;
+
+        if (!freeBuffers.empty()) {
+            m_instanceBuffer = freeBuffers.back().release();
+            freeBuffers.pop_back();
+        } else {
+            m_instanceBuffer = new InstanceBuffer;
+        }
+    }
+
+    m_instanceBuffer->useCount++;
+
+    if (m_instanceBuffer->size < numInstances) {
+        size_t size = std::max(m_instanceBuffer->size, kMinInstanceBufferSize);
+        while (size < numInstances)
+            size *= 2;
+
+        auto bufferDesc = GPUBufferDesc().
+            setType  (GPUBuffer::kVertexBuffer).
+            setUsage (GPUBuffer::kDynamicUsage).
+            setSize  (size * sizeof(InstanceData));
+
+        m_instanceBuffer->buffer = g_gpuManager->createBuffer(bufferDesc);
+        m_instanceBuffer->size = size;
+        m_instanceBuffer->vertexData.clear();
+    }
+
+    /* Write the instance data. Matrices are column-major, store rows. */
+    auto instances = reinterpret_cast<InstanceData *>(
+        m_instanceBuffer->buffer->map(0,
+                                      numInstances * sizeof(InstanceData),
+                                      GPUBuffer::kMapInvalidateBuffer,
+                                      GPUBuffer::kWriteAccess));
+
+    for (size_t i = 0; i < m_draws.size(); i++) {
+        Batch &batch = batches[drawBatches[i]];
+        InstanceData &instance = instances[batch.firstInstance + batch.numInstances++];
+
+        const glm::mat4 &transform = m_draws[i].entity->drawTransform();
+        for (unsigned j = 0; j < kInstanceTransformRows; j++)
+            instance.transform[j] = glm::vec4(transform[0][j], transform[1][j], transform[2][j], transform[3][j]);
+    }
+
+    m_instanceBuffer->buffer->unmap();
+
+    for (const Batch &batch : batches) {
+        GPU_CMD_DEBUG_GROUP(cmdList, "%s (%u instances)", batch.entity->name.c_str(), batch.numInstances);
+
+        cmdList->bindResourceSet(ResourceSets::kEntityResources, batch.entity->getResources());
+
+        batch.entity->material()->setDrawState(cmdList);
+        batch.pass->setDrawState(cmdList, variation);
 
-        cmdList->bindResourceSet(ResourceSets::kEntityResources, draw.entity->getResources());
+        /* Get vertex data with the instance buffer bound. */
+        auto ret = m_instanceBuffer->vertexData.emplace(batch.geometry.vertices, InstancedVertexData());
+        InstancedVertexData &vertexData = ret.first->second;
+        if (ret.second) {
+            vertexData.source    = batch.geometry.vertices;
+            vertexData.instanced = createInstancedVertexData(batch.geometry.vertices,
+                                                             m_instanceBuffer->buffer);
+        }
 
-        draw.entity->material()->setDrawState(cmdList);
-        draw.pass->setDrawState(cmdList, variation);
+        vertexData.lastUse = m_instanceBuffer->useCount;
 
-        Geometry geometry = draw.entity->geometry();
-        cmdList->draw(geometry.primitiveType, geometry.vertices, geometry.indices);
+        cmdList->draw(batch.geometry.primitiveType,
+                      vertexData.instanced,
+                      batch.geometry.indices,
+                      batch.numInstances,
+                      batch.firstInstance);
     }
 }
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Clustered light binning.
+ *
+ * Reference:
+ *  - Clustered Deferred and Forward Shading (Olsson, Billeter, Assarsson)
+ *  - Cull that cone! (Wronski)
+ */
+
+#include "core/log.h"
+
+#include "render/light_clusters.h"
+
+/** Initialise the cluster grid. */
+LightClusters::LightClusters() :
+    m_grid (kNumClusters),
+    m_bins (kNumClusters)
+{}
+
+/** Destroy the cluster grid. */
+LightClusters::~LightClusters() {}
+
+/** Add a light to be binned.
+ * @param desc          Description of the light.
+ * @return              Whether the light was added, false if the maximum
+ *                      number of lights has been reached. */
+bool LightClusters::add(const LightDesc &desc) {
+    check(!desc.spot || desc.cutoff <= 45.0f);
+
+    if (m_lights.size() >= kMaxLights)
+        return false;
+
+    m_lights.emplace_back();
+    m_lights.back().desc = desc;
+    return true;
+}
+
+/** Get the depth slice containing a view space depth.
+ * @param depth         Depth (positive distance along the view direction).
+ * @return              Index of the slice. */
+uint32_t LightClusters::depthSlice(float depth) const {
+    float slice = (logf(depth) * m_depthParameters.x) + m_depthParameters.y;
+    return glm::clamp(static_cast<int32_t>(slice), 0, static_cast<int32_t>(kGridDepth - 1));
+}
+
+/** Check whether a light affects a cluster.
+ * @param light         Light to check.
+ * @param min           Minimum point of the cluster's view space bounding box.
+ * @param max           Maximum point of the cluster's view space bounding box.
+ * @return              Whether the light intersects the cluster. */
+bool LightClusters::intersects(const Light &light, const glm::vec3 &min, const glm::vec3 &max) const {
+    /* Test the bounding sphere against the box. */
+    glm::vec3 closest = glm::clamp(light.bounds.centre, min, max) - light.bounds.centre;
+    if (glm::dot(closest, closest) > light.bounds.radius * light.bounds.radius)
+        return false;
+
+    if (!light.desc.spot)
+        return true;
+
+    /* For spot lights the bounding sphere is loose, additionally test the
+     * cone against a sphere around the cluster. */
+    glm::vec3 centre = (min + max) * 0.5f;
+    float radius = glm::length(max - centre);
+    float range = light.desc.range;
+
+    glm::vec3 toCentre = centre - light.position;
+    float distanceSq = glm::dot(toCentre, toCentre);
+    float axisDistance = glm::dot(toCentre, light.direction);
+    float closestDistance =
+        (light.cosCutoff * sqrtf(std::max(distanceSq - (axisDistance * axisDistance), 0.0f))) -
+        (axisDistance * light.sinCutoff);
+
+    return closestDistance <= radius &&
+           axisDistance <= range + radius &&
+           axisDistance >= -radius;
+}
+
+/**
+ * Bin lights into the cluster grid.
+ *
+ * Assigns each light added with add() to the clusters it affects within the
+ * given view, and generates the light data.
+ *
+ * @param viewMatrix    View matrix.
+ * @param projection    Projection matrix (must be a perspective projection).
+ * @param zNear         Near clipping plane.
+ * @param zFar          Far clipping plane.
+ */
+void LightClusters::build(const glm::mat4 &viewMatrix, const glm::mat4 &projection, float zNear, float zFar) {
+
+    /* Slices are distributed exponentially, so the slice for a depth is given
+     * by log(depth / near) * (slices / log(far / near)). Precalculate this as
+     * a scale and bias on log(depth), which is what shaders use. */
+    const float logDepthRange = logf(zFar / zNear);
+    m_depthParameters.x = static_cast<float>(kGridDepth) / logDepthRange;
+    m_depthParameters.y = -logf(zNear) * m_depthParameters.x;
+
+    float sliceDepths[kGridDepth + 1];
+    for (uint32_t z = 0; z <= kGridDepth; z++)
+        sliceDepths[z] = zNear * powf(zFar / zNear, static_cast<float>(z) / kGridDepth);
+
+    /* Tile boundaries are evenly spaced in NDC. Convert these to view space
+     * X/Y values at a depth of 1, which are scaled by depth to get the bounds
+     * at a given depth. */
+    float tileX[kGridWidth + 1];
+    for (uint32_t x = 0; x <= kGridWidth; x++)
+        tileX[x] = ((2.0f * x / kGridWidth) - 1.0f) / projection[0][0];
+
+    float tileY[kGridHeight + 1];
+    for (uint32_t y = 0; y <= kGridHeight; y++)
+        tileY[y] = ((2.0f * y / kGridHeight) - 1.0f) / projection[1][1];
+
+    /* Convert a value at depth 1 to a tile index. */
+    auto toTile = [] (float value, float scale, uint32_t count) {
+        float tile = ((value * scale) + 1.0f) * 0.5f * count;
+        return glm::clamp(static_cast<int32_t>(floorf(tile)), 0, static_cast<int32_t>(count - 1));
+    };
+
+    m_lightData.resize(m_lights.size() * kLightDataTexels);
+    m_pairs.clear();
+
+    for (uint32_t index = 0; index < m_lights.size(); index++) {
+        Light &light = m_lights[index];
+        const LightDesc &desc = light.desc;
+
+        /* Generate light data. This is in world space as the G-Buffer gives
+         * world space positions. */
+        glm::vec4 *data = &m_lightData[index * kLightDataTexels];
+        const float cutoff = glm::radians(desc.cutoff);
+        light.cosCutoff = cosf(cutoff);
+        light.sinCutoff = sinf(cutoff);
+        data[0] = glm::vec4(desc.position, desc.range);
+        data[1] = glm::vec4(desc.direction, light.cosCutoff);
+        data[2] = glm::vec4(desc.colour, (desc.spot) ? 1.0f : 0.0f);
+        data[3] = glm::vec4(desc.attenuationConstant, desc.attenuationLinear, desc.attenuationExp, 0.0f);
+
+        /* Calculate a view space bounding sphere. A spot light affects a
+         * spherical sector, which is bounded by the sphere passing through its
+         * apex and the edge of its base (cutoff is at most 45 degrees). */
+        glm::vec3 centre = desc.position;
+        float radius = desc.range;
+        if (desc.spot) {
+            radius /= 2.0f * light.cosCutoff;
+            centre += desc.direction * radius;
+        }
+
+        light.bounds = Sphere(glm::vec3(viewMatrix * glm::vec4(centre, 1.0f)), radius);
+        light.position = glm::vec3(viewMatrix * glm::vec4(desc.position, 1.0f));
+        light.direction = glm::normalize(glm::mat3(viewMatrix) * desc.direction);
+
+        /* Determine the range of clusters that could be affected. The view
+         * looks down negative Z. */
+        const glm::vec3 &viewCentre = light.bounds.centre;
+        float minDepth = std::max(-viewCentre.z - radius, zNear);
+        float maxDepth = std::min(-viewCentre.z + radius, zFar);
+        if (minDepth > maxDepth)
+            continue;
+
+        /* The projected extent of the sphere is bounded by the extent of its
+         * bounding box at the nearest and furthest depths. */
+        float minX = std::min((viewCentre.x - radius) / minDepth, (viewCentre.x - radius) / maxDepth);
+        float maxX = std::max((viewCentre.x + radius) / minDepth, (viewCentre.x + radius) / maxDepth);
+        float minY = std::min((viewCentre.y - radius) / minDepth, (viewCentre.y - radius) / maxDepth);
+        float maxY = std::max((viewCentre.y + radius) / minDepth, (viewCentre.y + radius) / maxDepth);
+        if (maxX < tileX[0] || minX > tileX[kGridWidth] || maxY < tileY[0] || minY > tileY[kGridHeight])
+            continue;
+
+        const int32_t startX = toTile(minX, projection[0][0], kGridWidth);
+        const int32_t endX   = toTile(maxX, projection[0][0], kGridWidth);
+        const int32_t startY = toTile(minY, projection[1][1], kGridHeight);
+        const int32_t endY   = toTile(maxY, projection[1][1], kGridHeight);
+        const uint32_t startZ = depthSlice(minDepth);
+        const uint32_t endZ   = depthSlice(maxDepth);
+
+        for (uint32_t z = startZ; z <= endZ; z++) {
+            const float near = sliceDepths[z];
+            const float far = sliceDepths[z + 1];
+
+            for (int32_t y = startY; y <= endY; y++) {
+                for (int32_t x = startX; x <= endX; x++) {
+                    glm::vec3 min(
+                        std::min(tileX[x] * near, tileX[x] * far),
+                        std::min(tileY[y] * near, tileY[y] * far),
+                        -far);
+                    glm::vec3 max(
+                        std::max(tileX[x + 1] * near, tileX[x + 1] * far),
+                        std::max(tileY[y + 1] * near, tileY[y + 1] * far),
+                        -near);
+
+                    if (intersects(light, min, max)) {
+                        uint32_t cluster = (((z * kGridHeight) + y) * kGridWidth) + x;
+                        m_pairs.emplace_back(cluster, index);
+                    }
+                }
+            }
+        }
+    }
+
+    /* Allocate space in the index list for each cluster. If we run out of
+     * space, lights are dropped from the remaining clusters. */
+    for (Bin &bin : m_bins)
+        bin.count = bin.used = 0;
+    for (const auto &pair : m_pairs)
+        m_bins[pair.first].count++;
+
+    uint32_t numIndices = 0;
+    for (Bin &bin : m_bins) {
+        bin.offset = numIndices;
+        bin.count = std::min(bin.count, kMaxIndices - numIndices);
+        numIndices += bin.count;
+    }
+
+    if (numIndices < m_pairs.size())
+        logWarning("Light cluster index list overflow, dropped %zu entries", m_pairs.size() - numIndices);
+
+    /* Fill in the index list. Pairs are in light order, so this keeps each
+     * cluster's lights in the order they were added. */
+    m_indices.resize(numIndices);
+    for (const auto &pair : m_pairs) {
+        Bin &bin = m_bins[pair.first];
+        if (bin.used < bin.count)
+            m_indices[bin.offset + bin.used++] = static_cast<float>(pair.second);
+    }
+
+    for (uint32_t cluster = 0; cluster < kNumClusters; cluster++) {
+        m_grid[cluster].offset = static_cast<float>(m_bins[cluster].offset);
+        m_grid[cluster].count = static_cast<float>(m_bins[cluster].count);
+    }
+}
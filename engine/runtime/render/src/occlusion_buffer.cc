@@ -0,0 +1,449 @@
+/*
+ * Copyright (C) 2016 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               Software occlusion buffer.
+ *
+ * The loops over rows of pixels, which rasterisation and building the HiZ
+ * pyramid spend nearly all of their time in, are vectorised with SSE2 or NEON
+ * where available. Each vector path does exactly the same arithmetic as the
+ * scalar loop that follows it, which handles the remaining pixels, so results
+ * do not depend on which path is taken.
+ */
+
+#include "render/occlusion_buffer.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define OCCLUSION_USE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define OCCLUSION_USE_NEON 1
+#endif
+
+/** Triangle indices of a box occluder, wound counter-clockwise from outside. */
+const uint16_t OcclusionBuffer::kBoxIndices[36] = {
+    0, 4, 6, 0, 6, 2,       /* -X */
+    1, 3, 7, 1, 7, 5,       /* +X */
+    0, 1, 5, 0, 5, 4,       /* -Y */
+    2, 6, 7, 2, 7, 3,       /* +Y */
+    0, 2, 3, 0, 3, 1,       /* -Z */
+    4, 5, 7, 4, 7, 6,       /* +Z */
+};
+
+/**
+ * Rasterise a row of a triangle.
+ *
+ * Evaluates the edge functions and depth at the centre of each pixel in a
+ * range of a row, and writes the depth to the pixels which are inside all 3
+ * edges and nearer than the current depth.
+ *
+ * @param row           Depth buffer row.
+ * @param x0            First pixel to rasterise.
+ * @param x1            Last pixel to rasterise (inclusive).
+ * @param a             X coefficients of the edge functions.
+ * @param rowEdge       Edge functions at X = 0 on the row.
+ * @param dzdx          Depth gradient in X.
+ * @param rowDepth      Depth at X = 0 on the row.
+ */
+static void rasteriseRow(float *__restrict row,
+                         int32_t x0,
+                         int32_t x1,
+                         const glm::vec3 &a,
+                         const glm::vec3 &rowEdge,
+                         float dzdx,
+                         float rowDepth)
+{
+    int32_t x = x0;
+
+    #if OCCLUSION_USE_SSE2
+        const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        const __m128 zero    = _mm_setzero_ps();
+        const __m128 a0      = _mm_set1_ps(a.x);
+        const __m128 a1      = _mm_set1_ps(a.y);
+        const __m128 a2      = _mm_set1_ps(a.z);
+        const __m128 edge0   = _mm_set1_ps(rowEdge.x);
+        const __m128 edge1   = _mm_set1_ps(rowEdge.y);
+        const __m128 edge2   = _mm_set1_ps(rowEdge.z);
+        const __m128 dz      = _mm_set1_ps(dzdx);
+        const __m128 z       = _mm_set1_ps(rowDepth);
+
+        for (; x + 3 <= x1; x += 4) {
+            const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+
+            const __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), edge0);
+            const __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), edge1);
+            const __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), edge2);
+            const __m128 pixelDepth = _mm_add_ps(_mm_mul_ps(dz, px), z);
+            const __m128 current = _mm_loadu_ps(&row[x]);
+
+            __m128 write = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero));
+            write = _mm_and_ps(write, _mm_cmpge_ps(e2, zero));
+            write = _mm_and_ps(write, _mm_cmplt_ps(pixelDepth, current));
+
+            const __m128 result = _mm_or_ps(_mm_and_ps(write, pixelDepth), _mm_andnot_ps(write, current));
+            _mm_storeu_ps(&row[x], result);
+        }
+    #elif OCCLUSION_USE_NEON
+        static const float kOffsets[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+
+        const float32x4_t offsets = vld1q_f32(kOffsets);
+        const float32x4_t zero    = vdupq_n_f32(0.0f);
+        const float32x4_t a0      = vdupq_n_f32(a.x);
+        const float32x4_t a1      = vdupq_n_f32(a.y);
+        const float32x4_t a2      = vdupq_n_f32(a.z);
+        const float32x4_t edge0   = vdupq_n_f32(rowEdge.x);
+        const float32x4_t edge1   = vdupq_n_f32(rowEdge.y);
+        const float32x4_t edge2   = vdupq_n_f32(rowEdge.z);
+        const float32x4_t dz      = vdupq_n_f32(dzdx);
+        const float32x4_t z       = vdupq_n_f32(rowDepth);
+
+        for (; x + 3 <= x1; x += 4) {
+            const float32x4_t px = vaddq_f32(vdupq_n_f32(static_cast<float>(x)), offsets);
+
+            /* Separate multiply and add rather than vmlaq_f32(), which may be
+             * fused and so round differently to the scalar loop. */
+            const float32x4_t e0 = vaddq_f32(vmulq_f32(a0, px), edge0);
+            const float32x4_t e1 = vaddq_f32(vmulq_f32(a1, px), edge1);
+            const float32x4_t e2 = vaddq_f32(vmulq_f32(a2, px), edge2);
+            const float32x4_t pixelDepth = vaddq_f32(vmulq_f32(dz, px), z);
+            const float32x4_t current = vld1q_f32(&row[x]);
+
+            uint32x4_t write = vandq_u32(vcgeq_f32(e0, zero), vcgeq_f32(e1, zero));
+            write = vandq_u32(write, vcgeq_f32(e2, zero));
+            write = vandq_u32(write, vcltq_f32(pixelDepth, current));
+
+            vst1q_f32(&row[x], vbslq_f32(write, pixelDepth, current));
+        }
+    #endif
+
+    for (; x <= x1; x++) {
+        const float px = static_cast<float>(x) + 0.5f;
+
+        const float e0 = (a.x * px) + rowEdge.x;
+        const float e1 = (a.y * px) + rowEdge.y;
+        const float e2 = (a.z * px) + rowEdge.z;
+        const float pixelDepth = (dzdx * px) + rowDepth;
+
+        const bool write = (e0 >= 0.0f) & (e1 >= 0.0f) & (e2 >= 0.0f) & (pixelDepth < row[x]);
+        row[x] = (write) ? pixelDepth : row[x];
+    }
+}
+
+/**
+ * Downsample a row of the HiZ pyramid.
+ *
+ * Each destination pixel is the furthest depth of the 2x2 source pixels that
+ * it covers. Source coordinates are clamped to the source size, for levels
+ * where one dimension has already reached 1 pixel.
+ *
+ * @param row0          First source row.
+ * @param row1          Second source row (may be the same as the first).
+ * @param dest          Destination row.
+ * @param width         Width of the destination.
+ * @param srcWidth      Width of the source.
+ */
+static void downsampleRow(const float *row0,
+                          const float *row1,
+                          float *__restrict dest,
+                          uint32_t width,
+                          uint32_t srcWidth)
+{
+    uint32_t x = 0;
+
+    /* The vector paths read 8 source pixels for every 4 destination pixels,
+     * which only needs clamping once the source is 1 pixel wide. */
+    #if OCCLUSION_USE_SSE2
+        if (srcWidth == width * 2) {
+            for (; x + 4 <= width; x += 4) {
+                const __m128 left  = _mm_max_ps(_mm_loadu_ps(&row0[x * 2]), _mm_loadu_ps(&row1[x * 2]));
+                const __m128 right = _mm_max_ps(_mm_loadu_ps(&row0[(x * 2) + 4]), _mm_loadu_ps(&row1[(x * 2) + 4]));
+
+                const __m128 even = _mm_shuffle_ps(left, right, _MM_SHUFFLE(2, 0, 2, 0));
+                const __m128 odd  = _mm_shuffle_ps(left, right, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(&dest[x], _mm_max_ps(even, odd));
+            }
+        }
+    #elif OCCLUSION_USE_NEON
+        if (srcWidth == width * 2) {
+            for (; x + 4 <= width; x += 4) {
+                const float32x4_t left  = vmaxq_f32(vld1q_f32(&row0[x * 2]), vld1q_f32(&row1[x * 2]));
+                const float32x4_t right = vmaxq_f32(vld1q_f32(&row0[(x * 2) + 4]), vld1q_f32(&row1[(x * 2) + 4]));
+
+                const float32x4x2_t pairs = vuzpq_f32(left, right);
+                vst1q_f32(&dest[x], vmaxq_f32(pairs.val[0], pairs.val[1]));
+            }
+        }
+    #endif
+
+    for (; x < width; x++) {
+        const uint32_t sx0 = std::min(x * 2, srcWidth - 1);
+        const uint32_t sx1 = std::min((x * 2) + 1, srcWidth - 1);
+
+        dest[x] = std::max(std::max(row0[sx0], row0[sx1]),
+                           std::max(row1[sx0], row1[sx1]));
+    }
+}
+
+/** Initialise the occlusion buffer. */
+OcclusionBuffer::OcclusionBuffer() {
+    static_assert(Math::isPow2(kWidth) && Math::isPow2(kHeight), "Occlusion buffer size must be a power of 2");
+
+    uint32_t width  = kWidth;
+    uint32_t height = kHeight;
+
+    while (true) {
+        m_levels.emplace_back(width * height, 1.0f);
+
+        if (width == 1 && height == 1)
+            break;
+
+        width  = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+}
+
+/** Destroy the occlusion buffer. */
+OcclusionBuffer::~OcclusionBuffer() {}
+
+/** Begin rasterising occluders for a view.
+ * @param viewProjection View-projection matrix of the view. */
+void OcclusionBuffer::begin(const glm::mat4 &viewProjection) {
+    m_viewProjection = viewProjection;
+
+    std::fill(m_levels[0].begin(), m_levels[0].end(), 1.0f);
+}
+
+/**
+ * Add an occluder mesh.
+ *
+ * Rasterises a triangle mesh into the depth buffer. The mesh should be closed
+ * and its triangles wound counter-clockwise when viewed from outside, as
+ * back-facing triangles are skipped. Occluders must lie entirely within the
+ * geometry that they represent, otherwise objects which are visible may be
+ * culled.
+ *
+ * @param transform     Transformation from the mesh's space to world space.
+ * @param vertices      Vertex positions.
+ * @param indices       Triangle indices into the vertex array.
+ * @param numIndices    Number of indices (3 per triangle).
+ */
+void OcclusionBuffer::addOccluder(const glm::mat4 &transform,
+                                  const glm::vec3 *vertices,
+                                  const uint16_t *indices,
+                                  size_t numIndices)
+{
+    const glm::mat4 matrix = m_viewProjection * transform;
+
+    for (size_t i = 0; i + 2 < numIndices; i += 3) {
+        glm::vec4 clip[3];
+        for (unsigned j = 0; j < 3; j++)
+            clip[j] = matrix * glm::vec4(vertices[indices[i + j]], 1.0f);
+
+        /* Clip against the near plane (the depth range is 0 to 1, so that is
+         * z >= 0). A triangle crossing it becomes a quad. Other planes are
+         * handled by clamping to the buffer when rasterising. */
+        glm::vec4 polygon[4];
+        unsigned count = 0;
+        for (unsigned j = 0; j < 3; j++) {
+            const glm::vec4 &a = clip[j];
+            const glm::vec4 &b = clip[(j + 1) % 3];
+
+            if (a.z >= 0.0f)
+                polygon[count++] = a;
+
+            if ((a.z >= 0.0f) != (b.z >= 0.0f))
+                polygon[count++] = glm::mix(a, b, a.z / (a.z - b.z));
+        }
+
+        if (count < 3)
+            continue;
+
+        /* Convert to pixel coordinates, with Y going up from the bottom of
+         * the buffer to match NDC. */
+        glm::vec3 screen[4];
+        for (unsigned j = 0; j < count; j++) {
+            const glm::vec3 ndc = glm::vec3(polygon[j]) / polygon[j].w;
+
+            screen[j] = glm::vec3((ndc.x * 0.5f + 0.5f) * kWidth,
+                                  (ndc.y * 0.5f + 0.5f) * kHeight,
+                                  ndc.z);
+        }
+
+        rasteriseTriangle(screen[0], screen[1], screen[2]);
+        if (count == 4)
+            rasteriseTriangle(screen[0], screen[2], screen[3]);
+    }
+}
+
+/** Add a box occluder.
+ * @param box           World-space box. */
+void OcclusionBuffer::addOccluder(const BoundingBox &box) {
+    glm::vec3 corners[8];
+    for (unsigned i = 0; i < 8; i++) {
+        corners[i] = glm::vec3((i & 1) ? box.maximum.x : box.minimum.x,
+                               (i & 2) ? box.maximum.y : box.minimum.y,
+                               (i & 4) ? box.maximum.z : box.minimum.z);
+    }
+
+    addOccluder(glm::mat4(), corners, kBoxIndices, arraySize(kBoxIndices));
+}
+
+/**
+ * Rasterise a triangle into the depth buffer.
+ *
+ * Pixels whose centre is inside the triangle are written with the furthest
+ * depth that the triangle has within the pixel, so that depth is never nearer
+ * than the occluder really is anywhere in the pixel. Requiring pixels to be
+ * entirely covered would be fully conservative, but would leave gaps along
+ * the shared edges of adjacent triangles.
+ *
+ * @param v0            First vertex (pixel coordinates and depth).
+ * @param v1            Second vertex.
+ * @param v2            Third vertex.
+ */
+void OcclusionBuffer::rasteriseTriangle(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2) {
+    /* Twice the signed area, positive for front-facing triangles. This also
+     * rejects degenerate triangles. */
+    const float area = ((v1.x - v0.x) * (v2.y - v0.y)) - ((v2.x - v0.x) * (v1.y - v0.y));
+    if (!(area > 0.0f))
+        return;
+
+    /* Clamp the bounds in floating point before converting them, as vertices
+     * close to the near plane can be very far outside the buffer. */
+    const float minX = std::max(std::min({ v0.x, v1.x, v2.x }), 0.0f);
+    const float minY = std::max(std::min({ v0.y, v1.y, v2.y }), 0.0f);
+    const float maxX = std::min(std::max({ v0.x, v1.x, v2.x }), static_cast<float>(kWidth));
+    const float maxY = std::min(std::max({ v0.y, v1.y, v2.y }), static_cast<float>(kHeight));
+    if (minX >= maxX || minY >= maxY)
+        return;
+
+    const int32_t x0 = static_cast<int32_t>(minX);
+    const int32_t y0 = static_cast<int32_t>(minY);
+    const int32_t x1 = static_cast<int32_t>(std::ceil(maxX)) - 1;
+    const int32_t y1 = static_cast<int32_t>(std::ceil(maxY)) - 1;
+
+    /* Edge functions, E(x, y) = a * x + b * y + c, which are positive inside
+     * the triangle. Edge i is opposite vertex i, at which it equals the area,
+     * so the depth plane is the sum of each vertex depth weighted by its edge
+     * function divided by the area. */
+    const glm::vec3 a(v1.y - v2.y, v2.y - v0.y, v0.y - v1.y);
+    const glm::vec3 b(v2.x - v1.x, v0.x - v2.x, v1.x - v0.x);
+    const glm::vec3 c((v1.x * v2.y) - (v1.y * v2.x),
+                (v2.x * v0.y) - (v2.y * v0.x),
+                (v0.x * v1.y) - (v0.y * v1.x));
+
+    const glm::vec3 z(v0.z, v1.z, v2.z);
+    const float dzdx = glm::dot(z, a) / area;
+    const float dzdy = glm::dot(z, b) / area;
+    float zBase      = glm::dot(z, c) / area;
+
+    /* Functions are evaluated at pixel centres. Offset the depth so that it
+     * is the furthest that the triangle has within the pixel. */
+    zBase += (std::abs(dzdx) + std::abs(dzdy)) * 0.5f;
+
+    float *depth = m_levels[0].data();
+
+    for (int32_t y = y0; y <= y1; y++) {
+        const float py = static_cast<float>(y) + 0.5f;
+        const glm::vec3 rowEdge = (b * py) + c;
+        const float rowDepth = (dzdy * py) + zBase;
+
+        rasteriseRow(&depth[y * kWidth], x0, x1, a, rowEdge, dzdx, rowDepth);
+    }
+}
+
+/** Finish rasterising occluders and build the HiZ pyramid. */
+void OcclusionBuffer::finish() {
+    for (unsigned level = 1; level < m_levels.size(); level++) {
+        const uint32_t srcWidth  = std::max(kWidth >> (level - 1), 1u);
+        const uint32_t srcHeight = std::max(kHeight >> (level - 1), 1u);
+        const uint32_t width     = std::max(kWidth >> level, 1u);
+        const uint32_t height    = std::max(kHeight >> level, 1u);
+
+        const float *src = m_levels[level - 1].data();
+        float *dest = m_levels[level].data();
+
+        for (uint32_t y = 0; y < height; y++) {
+            const float *row0 = &src[std::min(y * 2, srcHeight - 1) * srcWidth];
+            const float *row1 = &src[std::min((y * 2) + 1, srcHeight - 1) * srcWidth];
+
+            downsampleRow(row0, row1, &dest[y * width], width, srcWidth);
+        }
+    }
+}
+
+/**
+ * Test whether a box is occluded.
+ *
+ * Tests whether a box is completely hidden behind the occluders added to the
+ * buffer. The box's projected rectangle and nearest depth are compared
+ * against the level of the HiZ pyramid at which the rectangle covers at most
+ * 4x4 pixels. Boxes which cross the near plane or lie outside the view are
+ * never considered occluded (the latter should be rejected by frustum culling
+ * instead).
+ *
+ * @param box           World-space box to test.
+ *
+ * @return              Whether the box is occluded.
+ */
+bool OcclusionBuffer::isOccluded(const BoundingBox &box) const {
+    glm::vec3 minimum(std::numeric_limits<float>::max());
+    glm::vec3 maximum(-std::numeric_limits<float>::max());
+
+    for (unsigned i = 0; i < 8; i++) {
+        const glm::vec3 corner((i & 1) ? box.maximum.x : box.minimum.x,
+                               (i & 2) ? box.maximum.y : box.minimum.y,
+                               (i & 4) ? box.maximum.z : box.minimum.z);
+        const glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+
+        if (clip.z < 0.0f)
+            return false;
+
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        minimum = glm::min(minimum, ndc);
+        maximum = glm::max(maximum, ndc);
+    }
+
+    const float minX = (minimum.x * 0.5f + 0.5f) * kWidth;
+    const float minY = (minimum.y * 0.5f + 0.5f) * kHeight;
+    const float maxX = (maximum.x * 0.5f + 0.5f) * kWidth;
+    const float maxY = (maximum.y * 0.5f + 0.5f) * kHeight;
+    if (maxX <= 0.0f || maxY <= 0.0f || minX >= kWidth || minY >= kHeight)
+        return false;
+
+    const uint32_t x0 = static_cast<uint32_t>(std::max(minX, 0.0f));
+    const uint32_t y0 = static_cast<uint32_t>(std::max(minY, 0.0f));
+    const uint32_t x1 = static_cast<uint32_t>(std::min(maxX, static_cast<float>(kWidth - 1)));
+    const uint32_t y1 = static_cast<uint32_t>(std::min(maxY, static_cast<float>(kHeight - 1)));
+
+    unsigned level = 0;
+    while ((x1 >> level) - (x0 >> level) >= 4 || (y1 >> level) - (y0 >> level) >= 4)
+        level++;
+
+    for (uint32_t y = y0 >> level; y <= y1 >> level; y++) {
+        for (uint32_t x = x0 >> level; x <= x1 >> level; x++) {
+            if (depth(level, x, y) >= minimum.z)
+                return false;
+        }
+    }
+
+    return true;
+}
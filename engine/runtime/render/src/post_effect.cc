@@ -33,6 +33,42 @@
 static const std::string kPostEffectPassType("PostEffect");
 DEFINE_PASS_TYPE(kPostEffectPassType, {});
 
+/** Keywords enabling each fused shader stage (indexed by FusedStage). */
+static const char *kFusedStageKeywords[] = {
+    nullptr,
+    "TONEMAP",
+    "GAMMA_CORRECTION",
+};
+
+static_assert(
+    arraySize(kFusedStageKeywords) == static_cast<size_t>(PostEffect::FusedStage::kNumStages),
+    "Fused stage keyword array does not match FusedStage");
+
+/** Get the list of fused shader variations.
+ * @return              Variations for all combinations of fused stages. */
+static PassType::VariationList getFusedVariations() {
+    const size_t numStages = arraySize(kFusedStageKeywords) - 1;
+
+    PassType::VariationList variations;
+
+    for (size_t mask = 1; mask < (1u << numStages); mask++) {
+        ShaderKeywordSet variation;
+
+        for (size_t i = 0; i < numStages; i++) {
+            if (mask & (1u << i))
+                variation.insert(kFusedStageKeywords[i + 1]);
+        }
+
+        variations.emplace_back(std::move(variation));
+    }
+
+    return variations;
+}
+
+/** FusedPostEffect pass type. */
+static const std::string kFusedPostEffectPassType("FusedPostEffect");
+DEFINE_PASS_TYPE(kFusedPostEffectPassType, getFusedVariations());
+
 /**
  * Blit from a source to a destination texture using a material.
  *
@@ -52,7 +88,65 @@ void PostEffect::blit(GPUTexture *source,
                       const IntRect &area,
                       Material *material,
                       size_t passIndex,
-                      GPUSamplerState *samplerState) const
+                      GPUSamplerState *samplerState)
+{
+    const Pass *pass = material->shader()->getPass(kPostEffectPassType, passIndex);
+    blitPass(source, target, area, material, pass, ShaderKeywordSet(), samplerState);
+}
+
+/**
+ * Render a fused pass for a sequence of effects.
+ *
+ * Renders a sequence of per-pixel effects in a single pass using the fused
+ * post-processing shader, with the stage for each effect enabled. The stages
+ * of the effects must be in increasing order (see FusedStage).
+ *
+ * @param effects       Effects to render.
+ * @param source        Source texture.
+ * @param target        Render target.
+ * @param area          Area to render to on the target.
+ * @param material      Material using the fused shader to render with. The
+ *                      effects' parameters are set on this.
+ */
+void PostEffect::renderFused(const std::vector<const PostEffect *> &effects,
+                             GPUTexture *source,
+                             const GPURenderTargetDesc &target,
+                             const IntRect &area,
+                             Material *material)
+{
+    check(!effects.empty());
+
+    ShaderKeywordSet variation;
+    FusedStage lastStage = FusedStage::kNone;
+
+    for (const PostEffect *effect : effects) {
+        const FusedStage stage = effect->fusedStage();
+        check(stage > lastStage && stage < FusedStage::kNumStages);
+        lastStage = stage;
+
+        variation.insert(kFusedStageKeywords[static_cast<size_t>(stage)]);
+        effect->setFusedParameters(material);
+    }
+
+    const Pass *pass = material->shader()->getPass(kFusedPostEffectPassType, 0);
+    blitPass(source, target, area, material, pass, variation, nullptr);
+}
+
+/** Blit from a source to a destination texture using a shader pass.
+ * @param source        Source texture.
+ * @param target        Render target.
+ * @param area          Area to render to on the target.
+ * @param material      Material to draw with.
+ * @param pass          Pass from the material's shader to draw with.
+ * @param variation     Shader variation to use.
+ * @param samplerState  Sampler state for sampling the source texture. */
+void PostEffect::blitPass(GPUTexture *source,
+                          const GPURenderTargetDesc &target,
+                          const IntRect &area,
+                          Material *material,
+                          const Pass *pass,
+                          const ShaderKeywordSet &variation,
+                          GPUSamplerState *samplerState)
 {
     /* Bind the source texture. */
     GPUSamplerStatePtr defaultSampler = g_gpuManager->getSamplerState();
@@ -75,8 +169,7 @@ void PostEffect::blit(GPUTexture *source,
 
     /* Set rendering state. */
     material->setDrawState(cmdList);
-    const Pass *pass = material->shader()->getPass(kPostEffectPassType, passIndex);
-    pass->setDrawState(cmdList, ShaderKeywordSet());
+    pass->setDrawState(cmdList, variation);
 
     /* Draw a full-screen quad. */
     Geometry geometry = g_renderResources->quadGeometry();
@@ -27,6 +27,12 @@
 FXAAEffect::FXAAEffect() {
     ShaderPtr shader = g_assetManager->load<Shader>("engine/shaders/post_effects/fxaa_effect");
     m_material = new Material(shader);
+
+    /* Use bilinear filtering. */
+    auto samplerDesc = GPUSamplerStateDesc().
+        setFilterMode    (SamplerFilterMode::kBilinear).
+        setMaxAnisotropy (1);
+    m_samplerState = g_gpuManager->getSamplerState(samplerDesc);
 }
 
 /** Destroy the effect. */
@@ -44,11 +50,5 @@ RenderPipeline::ImageType FXAAEffect::inputImageType() const {
  * @param target        Render target.
  * @param area          Area to render to on the target. */
 void FXAAEffect::render(GPUTexture *source, const GPURenderTargetDesc &target, const IntRect &area) const {
-    /* Use bilinear filtering. */
-    auto samplerDesc = GPUSamplerStateDesc().
-        setFilterMode    (SamplerFilterMode::kBilinear).
-        setMaxAnisotropy (1);
-    GPUSamplerStatePtr samplerState = g_gpuManager->getSamplerState(samplerDesc);
-
-    blit(source, target, area, m_material, 0, samplerState);
+    blit(source, target, area, m_material, 0, m_samplerState);
 }
@@ -49,7 +49,18 @@ RenderPipeline::ImageType GammaCorrectionEffect::outputImageType() const {
  * @param target        Render target.
  * @param area          Area to render to on the target. */
 void GammaCorrectionEffect::render(GPUTexture *source, const GPURenderTargetDesc &target, const IntRect &area) const {
-    m_material->setValue("gamma", this->gamma);
+    setFusedParameters(m_material);
 
     blit(source, target, area, m_material);
 }
+
+/** @return             Fused shader stage. */
+PostEffect::FusedStage GammaCorrectionEffect::fusedStage() const {
+    return FusedStage::kGammaCorrection;
+}
+
+/** Set parameters for the effect on a material.
+ * @param material      Material to set on. */
+void GammaCorrectionEffect::setFusedParameters(Material *material) const {
+    material->setValue("gamma", this->gamma);
+}
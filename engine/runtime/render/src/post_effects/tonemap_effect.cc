@@ -53,8 +53,19 @@ void TonemapEffect::render(GPUTexture *source,
                            const GPURenderTargetDesc &target,
                            const IntRect &area) const
 {
-    m_material->setValue("exposure", this->exposure);
-    m_material->setValue("whitePoint", this->whitePoint);
+    setFusedParameters(m_material);
 
     blit(source, target, area, m_material);
 }
+
+/** @return             Fused shader stage. */
+PostEffect::FusedStage TonemapEffect::fusedStage() const {
+    return FusedStage::kTonemap;
+}
+
+/** Set parameters for the effect on a material.
+ * @param material      Material to set on. */
+void TonemapEffect::setFusedParameters(Material *material) const {
+    material->setValue("exposure", this->exposure);
+    material->setValue("whitePoint", this->whitePoint);
+}
@@ -19,6 +19,8 @@
  * @brief               Rendering context class.
  */
 
+#include "engine/render_target.h"
+
 #include "render/render_context.h"
 
 /** Initialise the rendering context.
@@ -29,7 +31,11 @@ RenderContext::RenderContext(const RenderWorld &world, RenderView &view, RenderT
     m_world(world),
     m_view(view),
     m_target(target)
-{}
+{
+    GPUTextureImageRef image;
+    m_target.getTextureImageRef(image);
+    m_targetResource = m_graph.importTexture("Render Target", image);
+}
 
 /** Destroy the rendering context. */
 RenderContext::~RenderContext() {}
@@ -21,13 +21,42 @@
 
 #include "gpu/gpu_manager.h"
 
+#include "render/occlusion_buffer.h"
 #include "render/render_entity.h"
+#include "render/render_view.h"
 #include "render/render_world.h"
 
+#include "render_core/material.h"
 #include "render_core/render_resources.h"
 
+#include <limits>
+
 IMPLEMENT_UNIFORM_STRUCT(EntityUniforms, "entity", ResourceSets::kEntityResources);
 
+/** Maximum projected error of a level of detail, in pixels. */
+static const float kLODPixelError = 1.0f;
+
+/**
+ * Level of detail hysteresis factor.
+ *
+ * When selecting with hysteresis, a coarser level of detail than the previous
+ * one is only selected once the projected size is this factor below the size
+ * at which it would normally be selected. This prevents rapid switching
+ * between levels when the size hovers around a threshold.
+ */
+static const float kLODHysteresis = 0.85f;
+
+/** Counter used to generate entity change stamps. */
+static uint64_t g_entityChangeCounter = 0;
+
+/** Get the bounding sphere of a bounding box.
+ * @param box           Bounding box.
+ * @return              Sphere enclosing the box. */
+static inline Sphere boundingSphere(const BoundingBox &box) {
+    const glm::vec3 extent = box.maximum - box.minimum;
+    return Sphere((box.minimum + box.maximum) * 0.5f, glm::length(extent) * 0.5f);
+}
+
 /**
  * Initialize the entity.
  *
@@ -36,7 +65,9 @@ IMPLEMENT_UNIFORM_STRUCT(EntityUniforms, "entity", ResourceSets::kEntityResource
  */
 RenderEntity::RenderEntity() :
     m_world(nullptr),
-    m_flags(0)
+    m_flags(0),
+    m_changeStamp(++g_entityChangeCounter),
+    m_lod(0)
 {
     m_resources = g_gpuManager->createResourceSet(g_renderResources->entityResourceSetLayout());
     m_resources->bindUniformBuffer(ResourceSlots::kUniforms, m_uniforms.gpu());
@@ -59,26 +90,228 @@ void RenderEntity::setWorld(RenderWorld *world) {
         m_world->addEntity(this);
 }
 
+/** Set the flags for the entity.
+ * @param flags         New flags. */
+void RenderEntity::setFlags(uint32_t flags) {
+    const bool changedShadow = (m_flags & kCastsShadow) != (flags & kCastsShadow);
+
+    /* The world may index shadow casters separately, re-add the entity to it
+     * if that has changed. */
+    if (changedShadow && m_world)
+        m_world->removeEntity(this);
+
+    m_flags = flags;
+
+    if (changedShadow) {
+        updateChangeStamp();
+
+        if (m_world)
+            m_world->addEntity(this);
+    }
+}
+
+/**
+ * Set the occluder geometry of the entity.
+ *
+ * Sets a triangle mesh which is used to hide other entities behind this one
+ * when culling with occlusion culling enabled. This should be a simple,
+ * closed mesh with triangles wound counter-clockwise when viewed from outside,
+ * lying entirely within the entity's real geometry. Empty arrays make the
+ * entity no longer be an occluder.
+ *
+ * @param vertices      Vertex positions, in local space (after the vertex
+ *                      transformation).
+ * @param indices       Triangle indices into the vertex array.
+ */
+void RenderEntity::setOccluder(const std::vector<glm::vec3> &vertices, const std::vector<uint16_t> &indices) {
+    const bool changed = isOccluder() != !indices.empty();
+
+    /* The world may index occluders separately, re-add the entity to it if
+     * that has changed. */
+    if (changed && m_world)
+        m_world->removeEntity(this);
+
+    m_occluderVertices = vertices;
+    m_occluderIndices  = indices;
+
+    if (changed && m_world)
+        m_world->addEntity(this);
+}
+
+/**
+ * Set a box as the occluder geometry of the entity.
+ *
+ * This is suitable for entities which are solid and fill the box, e.g. walls
+ * or floors given their own bounding box.
+ *
+ * @param box           Local-space box (after the vertex transformation).
+ */
+void RenderEntity::setOccluder(const BoundingBox &box) {
+    std::vector<glm::vec3> vertices(8);
+    for (unsigned i = 0; i < 8; i++) {
+        vertices[i] = glm::vec3((i & 1) ? box.maximum.x : box.minimum.x,
+                                (i & 2) ? box.maximum.y : box.minimum.y,
+                                (i & 4) ? box.maximum.z : box.minimum.z);
+    }
+
+    std::vector<uint16_t> indices(std::begin(OcclusionBuffer::kBoxIndices),
+                                  std::end(OcclusionBuffer::kBoxIndices));
+
+    setOccluder(vertices, indices);
+}
+
 /** Set the transformation of the entity.
  * @param transform     New transformation. */
 void RenderEntity::setTransform(const Transform &transform) {
     m_transform = transform;
+    m_drawTransform = m_transform.matrix() * m_vertexTransform;
 
     EntityUniforms *uniforms = m_uniforms.write();
-    uniforms->transform = m_transform.matrix();
+    uniforms->transform = m_drawTransform;
     uniforms->position = m_transform.position();
 
     updateWorld();
 }
 
+/**
+ * Set the vertex transformation of the entity.
+ *
+ * Sets a transformation to apply to vertex positions before the entity's
+ * transformation, e.g. to dequantise positions stored in a compact format.
+ * This is combined into the transformation matrix passed to shaders, so must
+ * not contain non-uniform scaling, as normals are transformed by the same
+ * matrix. The bounding box is not affected, it should be specified in the
+ * space after this transformation has been applied.
+ *
+ * @param transform     New vertex transformation.
+ */
+void RenderEntity::setVertexTransform(const glm::mat4 &transform) {
+    m_vertexTransform = transform;
+    m_drawTransform = m_transform.matrix() * m_vertexTransform;
+
+    EntityUniforms *uniforms = m_uniforms.write();
+    uniforms->transform = m_drawTransform;
+
+    updateChangeStamp();
+}
+
 /** Set the bounding box of the entity.
  * @param boundingBox   New bounding box. */
 void RenderEntity::setBoundingBox(const BoundingBox &boundingBox) {
     m_boundingBox = boundingBox;
 
+    updateLODSizes();
     updateWorld();
 }
 
+/**
+ * Set the levels of detail of the entity.
+ *
+ * Sets the errors of the simplified levels of detail available for the entity,
+ * which are used to select the level of detail to use based on its projected
+ * size. The geometry() method must accept any level of detail up to the number
+ * of errors given.
+ *
+ * @param errors        Maximum deviation of each simplified level of detail
+ *                      from the full detail geometry, in local space (after
+ *                      the vertex transformation). Must be increasing.
+ */
+void RenderEntity::setLODs(const std::vector<float> &errors) {
+    m_lodErrors = errors;
+    m_lod       = 0;
+
+    updateLODSizes();
+    updateChangeStamp();
+}
+
+/** Update level of detail selection thresholds. */
+void RenderEntity::updateLODSizes() {
+    const float radius = glm::length(m_boundingBox.maximum - m_boundingBox.minimum) * 0.5f;
+
+    m_lodSizes.resize(m_lodErrors.size());
+    for (size_t i = 0; i < m_lodErrors.size(); i++) {
+        m_lodSizes[i] = (m_lodErrors[i] > 0.0f)
+                            ? kLODPixelError * radius / m_lodErrors[i]
+                            : std::numeric_limits<float>::max();
+    }
+}
+
+/**
+ * Select the level of detail to use for a view.
+ *
+ * Selects the coarsest level of detail which has an error of at most
+ * kLODPixelError pixels when projected into the given view. As errors scale
+ * with the entity in the same way as its bounding sphere, this only needs the
+ * projected size of the world-space bounding sphere, making it cheap enough to
+ * do while culling.
+ *
+ * If hysteresis is enabled, the selection is stored and a switch to a coarser
+ * level than the previously selected one requires the entity to be somewhat
+ * smaller than the threshold for it. This should only be used for a single
+ * view (the primary view) per frame, since there is only one stored level.
+ *
+ * @param view          View to select for.
+ * @param hysteresis    Whether to apply hysteresis.
+ *
+ * @return              Selected level of detail.
+ */
+unsigned RenderEntity::selectLOD(RenderView &view, bool hysteresis) {
+    if (m_lodSizes.empty())
+        return 0;
+
+    const float size = view.projectedRadius(boundingSphere(m_worldBoundingBox));
+
+    /* Thresholds are decreasing with level. */
+    unsigned lod = 0;
+    while (lod < m_lodSizes.size() && size <= m_lodSizes[lod])
+        lod++;
+
+    if (hysteresis) {
+        while (lod > m_lod && size > m_lodSizes[lod - 1] * kLODHysteresis)
+            lod--;
+
+        m_lod = lod;
+    }
+
+    return lod;
+}
+
+/**
+ * Request the resolution needed for the entity's textures.
+ *
+ * Records the resolution at which the textures of the entity's material are
+ * needed when drawn in a view, for texture streaming. This assumes that each
+ * texture is mapped once across the entity, so that it is displayed at the
+ * projected diameter of the entity's bounding sphere. Textures repeated across
+ * the entity will be given less detail than they could use, but this is cheap
+ * enough to do while culling, and does not need any extra mesh data.
+ *
+ * @param view          View that the entity is visible in.
+ */
+void RenderEntity::requestTextures(RenderView &view) {
+    const float size = view.projectedRadius(boundingSphere(m_worldBoundingBox)) * 2.0f;
+    material()->requestTextureResolution(size);
+}
+
+/**
+ * Cull clusters of the entity.
+ *
+ * Entities whose geometry is divided into clusters (see SubMesh::Cluster) can
+ * override this to cull the clusters against a view and build index data for
+ * those that remain. The default implementation does nothing.
+ *
+ * @param view          View to cull against.
+ * @param lod           Level of detail that will be drawn.
+ * @param outIndices    Where to store index data for visible clusters, to be
+ *                      used instead of the geometry's own index data. Left
+ *                      null if the entity's geometry should be used as is.
+ *
+ * @return              False if nothing of the entity is visible.
+ */
+bool RenderEntity::cullClusters(RenderView &view, unsigned lod, GPUIndexDataPtr &outIndices) {
+    return true;
+}
+
 /** Flush pending updates and get resources.
  * @return              Resource set containing per-entity resources. */
 GPUResourceSet *RenderEntity::getResources() {
@@ -92,6 +325,19 @@ void RenderEntity::updateWorld() {
      * box. */
     m_worldBoundingBox = m_boundingBox.transform(m_transform.matrix());
 
+    updateChangeStamp();
+
     if (m_world)
         m_world->updateEntity(this);
 }
+
+/**
+ * Update the change stamp of the entity.
+ *
+ * This is done automatically when the transformation or bounding box changes.
+ * Derived classes must call it if anything else affecting the entity's
+ * appearance changes, e.g. its geometry.
+ */
+void RenderEntity::updateChangeStamp() {
+    m_changeStamp = ++g_entityChangeCounter;
+}
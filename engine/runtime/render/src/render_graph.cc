@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2016 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               Frame render graph.
+ *
+ * This file contains graph construction and compilation, which do not depend
+ * on the GPU. Execution is in render_graph_execute.cc.
+ */
+
+#include "render/render_graph.h"
+
+#include <algorithm>
+
+/** Initialise a pass.
+ * @param name          Name of the pass. */
+RenderGraph::Pass::Pass(const std::string &name) :
+    m_name       (name),
+    m_renderArea (0, 0, 0, 0),
+    m_culled     (false)
+{}
+
+/**
+ * Set a colour attachment of the pass.
+ *
+ * Sets a resource to be rendered to by the pass. If the load operation is
+ * kLoad, the existing contents of the resource are preserved and the resource
+ * is considered to be read by the pass as well as written. Otherwise, the pass
+ * is assumed to overwrite the whole resource.
+ *
+ * @param index         Index of the attachment. Attachments must be set
+ *                      in order from 0.
+ * @param resource      Resource to render to.
+ * @param loadOp        How to treat the existing contents.
+ * @param clearColour   Clear value if the load operation is kClear.
+ */
+void RenderGraph::Pass::setColourAttachment(unsigned index,
+                                            ResourceHandle resource,
+                                            GPURenderLoadOp loadOp,
+                                            const glm::vec4 &clearColour)
+{
+    check(index <= m_colourAttachments.size());
+
+    if (index == m_colourAttachments.size())
+        m_colourAttachments.emplace_back();
+
+    Attachment &attachment = m_colourAttachments[index];
+    attachment.resource    = resource;
+    attachment.loadOp      = loadOp;
+    attachment.clearColour = clearColour;
+}
+
+/**
+ * Set the depth/stencil attachment of the pass.
+ *
+ * See setColourAttachment() for details of how the load operation affects
+ * dependencies.
+ *
+ * @param resource      Resource to render to.
+ * @param loadOp        How to treat the existing contents.
+ * @param clearDepth    Depth clear value if the load operation is kClear.
+ * @param clearStencil  Stencil clear value if the load operation is kClear.
+ */
+void RenderGraph::Pass::setDepthStencilAttachment(ResourceHandle resource,
+                                                  GPURenderLoadOp loadOp,
+                                                  float clearDepth,
+                                                  uint32_t clearStencil)
+{
+    m_depthStencilAttachment.resource     = resource;
+    m_depthStencilAttachment.loadOp       = loadOp;
+    m_depthStencilAttachment.clearDepth   = clearDepth;
+    m_depthStencilAttachment.clearStencil = clearStencil;
+}
+
+/** Add a resource read by the pass other than as an attachment.
+ * @param resource      Resource to add (e.g. a texture sampled by the pass,
+ *                      or the source of a blit). */
+void RenderGraph::Pass::addInput(ResourceHandle resource) {
+    m_inputs.emplace_back(resource);
+}
+
+/**
+ * Add a resource written by the pass other than as an attachment.
+ *
+ * This is for resources written by passes which record their own commands,
+ * e.g. the destination of a blit. The whole resource is assumed to be
+ * overwritten. Passes which write nothing are culled when the graph is
+ * compiled.
+ *
+ * @param resource      Resource to add.
+ */
+void RenderGraph::Pass::addOutput(ResourceHandle resource) {
+    m_outputs.emplace_back(resource);
+}
+
+/** Get the resources read by the pass.
+ * @param outReads      Array to fill in. */
+void RenderGraph::Pass::getReads(std::vector<ResourceHandle> &outReads) const {
+    outReads = m_inputs;
+
+    for (const Attachment &attachment : m_colourAttachments) {
+        if (attachment.loadOp == GPURenderLoadOp::kLoad)
+            outReads.emplace_back(attachment.resource);
+    }
+
+    if (m_depthStencilAttachment.resource != kInvalidResource &&
+        m_depthStencilAttachment.loadOp == GPURenderLoadOp::kLoad)
+    {
+        outReads.emplace_back(m_depthStencilAttachment.resource);
+    }
+}
+
+/** Get the resources written by the pass.
+ * @param outWrites     Array to fill in. */
+void RenderGraph::Pass::getWrites(std::vector<ResourceHandle> &outWrites) const {
+    outWrites = m_outputs;
+
+    for (const Attachment &attachment : m_colourAttachments)
+        outWrites.emplace_back(attachment.resource);
+
+    if (m_depthStencilAttachment.resource != kInvalidResource)
+        outWrites.emplace_back(m_depthStencilAttachment.resource);
+}
+
+/** Initialise an empty graph. */
+RenderGraph::RenderGraph() :
+    m_compiled (false)
+{}
+
+/** Destroy the graph, releasing its physical textures. */
+RenderGraph::~RenderGraph() {}
+
+/**
+ * Create a transient texture.
+ *
+ * Declares a texture which is only used within the frame. Its contents are
+ * undefined before the first pass which writes it, and it may share memory
+ * with other transient textures whose lifetimes do not overlap with it.
+ *
+ * @param name          Name of the resource (for debugging).
+ * @param desc          Descriptor for the texture.
+ *
+ * @return              Handle to the resource.
+ */
+RenderGraph::ResourceHandle RenderGraph::createTexture(const std::string &name, const GPUTextureDesc &desc) {
+    m_resources.emplace_back();
+
+    Resource &resource = m_resources.back();
+    resource.name      = name;
+    resource.imported  = false;
+    resource.desc      = desc;
+    resource.firstPass = -1;
+    resource.lastPass  = -1;
+    resource.physical  = -1;
+
+    return m_resources.size() - 1;
+}
+
+/**
+ * Import an existing texture.
+ *
+ * Declares a texture which exists outside of the graph, such as the render
+ * target or a texture persisting across frames. Its contents are preserved
+ * before the first pass, and are assumed to be needed after the frame.
+ *
+ * @param name          Name of the resource (for debugging).
+ * @param image         Image to import.
+ *
+ * @return              Handle to the resource.
+ */
+RenderGraph::ResourceHandle RenderGraph::importTexture(const std::string &name, const GPUTextureImageRef &image) {
+    m_resources.emplace_back();
+
+    Resource &resource = m_resources.back();
+    resource.name      = name;
+    resource.imported  = true;
+    resource.image     = image;
+    resource.firstPass = -1;
+    resource.lastPass  = -1;
+    resource.physical  = -1;
+
+    return m_resources.size() - 1;
+}
+
+/** Add a pass to the end of the graph.
+ * @param name          Name of the pass (used as its debug group name).
+ * @return              Reference to the pass, valid for the lifetime of the
+ *                      graph. */
+RenderGraph::Pass &RenderGraph::addPass(const std::string &name) {
+    check(!m_compiled);
+
+    m_passes.emplace_back(new Pass(name));
+    return *m_passes.back();
+}
+
+/** Compile the graph. See the class description for details. */
+void RenderGraph::compile() {
+    check(!m_compiled);
+
+    std::vector<ResourceHandle> reads;
+    std::vector<ResourceHandle> writes;
+
+    /* Work backwards from the end of the frame to determine which passes are
+     * needed, tracking which resources have contents that are still needed.
+     * Imported resources are needed after the frame. Writes to them are not
+     * treated as overwriting them since passes may only write part of them,
+     * e.g. a tile of an atlas. */
+    std::vector<bool> live(m_resources.size());
+    for (size_t i = 0; i < m_resources.size(); i++)
+        live[i] = m_resources[i].imported;
+
+    for (size_t i = m_passes.size(); i-- > 0; ) {
+        Pass &pass = *m_passes[i];
+
+        pass.getReads(reads);
+        pass.getWrites(writes);
+
+        /* This always culls passes with no writes. */
+        pass.m_culled = std::none_of(writes.begin(), writes.end(),
+                                     [&] (ResourceHandle resource) { return live[resource]; });
+        if (pass.m_culled)
+            continue;
+
+        /* Contents written by attachments are only stored if they are still
+         * needed after the pass. */
+        for (Attachment &attachment : pass.m_colourAttachments)
+            attachment.storeOp = (live[attachment.resource]) ? GPURenderStoreOp::kStore : GPURenderStoreOp::kDontCare;
+
+        Attachment &depthStencil = pass.m_depthStencilAttachment;
+        if (depthStencil.resource != kInvalidResource)
+            depthStencil.storeOp = (live[depthStencil.resource]) ? GPURenderStoreOp::kStore : GPURenderStoreOp::kDontCare;
+
+        for (ResourceHandle resource : writes) {
+            if (!m_resources[resource].imported)
+                live[resource] = false;
+        }
+
+        for (ResourceHandle resource : reads)
+            live[resource] = true;
+    }
+
+    /* Compute resource lifetimes, and don't load attachments which have not
+     * been written yet. */
+    for (size_t i = 0; i < m_passes.size(); i++) {
+        Pass &pass = *m_passes[i];
+
+        if (pass.m_culled)
+            continue;
+
+        auto deriveLoadOp =
+            [&] (Attachment &attachment) {
+                const Resource &resource = m_resources[attachment.resource];
+
+                if (attachment.loadOp == GPURenderLoadOp::kLoad && !resource.imported && resource.firstPass < 0)
+                    attachment.loadOp = GPURenderLoadOp::kDontCare;
+            };
+
+        for (Attachment &attachment : pass.m_colourAttachments)
+            deriveLoadOp(attachment);
+
+        if (pass.m_depthStencilAttachment.resource != kInvalidResource)
+            deriveLoadOp(pass.m_depthStencilAttachment);
+
+        pass.getReads(reads);
+        pass.getWrites(writes);
+        reads.insert(reads.end(), writes.begin(), writes.end());
+
+        for (ResourceHandle handle : reads) {
+            Resource &resource = m_resources[handle];
+
+            if (resource.firstPass < 0)
+                resource.firstPass = i;
+
+            resource.lastPass = i;
+        }
+    }
+
+    /* Assign physical textures to transient resources, in order of first use.
+     * A texture can be reused once the last pass using its previous resource
+     * has finished. */
+    std::vector<ResourceHandle> order;
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        if (!m_resources[i].imported && m_resources[i].firstPass >= 0)
+            order.emplace_back(i);
+    }
+
+    std::stable_sort(order.begin(), order.end(),
+                     [&] (ResourceHandle a, ResourceHandle b) {
+                         return m_resources[a].firstPass < m_resources[b].firstPass;
+                     });
+
+    std::vector<int> physicalLastPass;
+
+    for (ResourceHandle handle : order) {
+        Resource &resource = m_resources[handle];
+
+        for (size_t i = 0; i < m_physicalDescs.size(); i++) {
+            if (physicalLastPass[i] < resource.firstPass && m_physicalDescs[i] == resource.desc) {
+                resource.physical = i;
+                break;
+            }
+        }
+
+        if (resource.physical < 0) {
+            resource.physical = m_physicalDescs.size();
+            m_physicalDescs.emplace_back(resource.desc);
+            physicalLastPass.emplace_back(0);
+        }
+
+        physicalLastPass[resource.physical] = resource.lastPass;
+    }
+
+    m_compiled = true;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               Frame render graph execution.
+ */
+
+#include "gpu/gpu_manager.h"
+
+#include "render/render_graph.h"
+
+/** Cache of render passes created for graphs. */
+static GlobalResource<HashMap<GPURenderPassDesc, GPURenderPassPtr>> g_renderGraphPasses;
+
+/** Execute the graph. It must have been compiled. */
+void RenderGraph::execute() {
+    check(m_compiled);
+
+    m_physicalTextures.reserve(m_physicalDescs.size());
+    for (const GPUTextureDesc &desc : m_physicalDescs)
+        m_physicalTextures.emplace_back(g_renderTargetPool->allocate(desc));
+
+    for (Resource &resource : m_resources) {
+        if (resource.physical >= 0)
+            resource.image = GPUTextureImageRef(m_physicalTextures[resource.physical]);
+    }
+
+    for (const std::unique_ptr<Pass> &pass : m_passes) {
+        if (pass->m_culled)
+            continue;
+
+        GPU_DEBUG_GROUP("%s", pass->m_name.c_str());
+
+        if (pass->hasAttachments()) {
+            GPUCommandList *cmdList = beginRenderPass(*pass);
+
+            if (pass->m_function)
+                pass->m_function(*this, cmdList);
+
+            g_gpuManager->submitRenderPass(cmdList);
+        } else if (pass->m_function) {
+            pass->m_function(*this, nullptr);
+        }
+    }
+}
+
+/** Begin the render pass for a pass.
+ * @param pass          Pass to begin.
+ * @return              Command list for the render pass. */
+GPUCommandList *RenderGraph::beginRenderPass(const Pass &pass) const {
+    GPURenderPassDesc passDesc(pass.m_colourAttachments.size());
+    GPURenderTargetDesc targets(pass.m_colourAttachments.size());
+
+    for (size_t i = 0; i < pass.m_colourAttachments.size(); i++) {
+        const Attachment &attachment = pass.m_colourAttachments[i];
+
+        targets.colour[i] = m_resources[attachment.resource].image;
+
+        passDesc.colourAttachments[i].format  = targets.colour[i].texture->format();
+        passDesc.colourAttachments[i].loadOp  = attachment.loadOp;
+        passDesc.colourAttachments[i].storeOp = attachment.storeOp;
+    }
+
+    const Attachment &depthStencil = pass.m_depthStencilAttachment;
+    if (depthStencil.resource != kInvalidResource) {
+        targets.depthStencil = m_resources[depthStencil.resource].image;
+
+        GPURenderAttachmentDesc &attachmentDesc = passDesc.depthStencilAttachment;
+        attachmentDesc.format  = targets.depthStencil.texture->format();
+        attachmentDesc.loadOp  = depthStencil.loadOp;
+        attachmentDesc.storeOp = depthStencil.storeOp;
+
+        if (PixelFormat::isDepthStencil(attachmentDesc.format)) {
+            attachmentDesc.stencilLoadOp  = depthStencil.loadOp;
+            attachmentDesc.stencilStoreOp = depthStencil.storeOp;
+        } else {
+            attachmentDesc.stencilLoadOp  = GPURenderLoadOp::kDontCare;
+            attachmentDesc.stencilStoreOp = GPURenderStoreOp::kDontCare;
+        }
+    }
+
+    /* Get a render pass object matching the attachments. */
+    g_renderGraphPasses.init();
+
+    auto it = g_renderGraphPasses->find(passDesc);
+    if (it == g_renderGraphPasses->end()) {
+        GPURenderPassDesc createDesc(passDesc);
+        GPURenderPassPtr renderPass = g_gpuManager->createRenderPass(std::move(createDesc));
+        it = g_renderGraphPasses->emplace(std::move(passDesc), std::move(renderPass)).first;
+    }
+
+    GPURenderPassInstanceDesc instanceDesc(it->second);
+    instanceDesc.targets      = std::move(targets);
+    instanceDesc.clearDepth   = depthStencil.clearDepth;
+    instanceDesc.clearStencil = depthStencil.clearStencil;
+
+    for (size_t i = 0; i < pass.m_colourAttachments.size(); i++)
+        instanceDesc.clearColours[i] = pass.m_colourAttachments[i].clearColour;
+
+    /* Default to the whole size of the attachments. */
+    if (pass.m_renderArea.width > 0 && pass.m_renderArea.height > 0) {
+        instanceDesc.renderArea = pass.m_renderArea;
+    } else {
+        const GPURenderTargetDesc &desc = instanceDesc.targets;
+        const GPUTextureImageRef &image = (desc.colour.empty()) ? desc.depthStencil : desc.colour[0];
+        instanceDesc.renderArea = IntRect(0,
+                                          0,
+                                          std::max(image.texture->width() >> image.mip, 1u),
+                                          std::max(image.texture->height() >> image.mip, 1u));
+    }
+
+    return g_gpuManager->beginRenderPass(instanceDesc);
+}
+
+/** Get the texture for a resource.
+ * @param resource      Resource to get.
+ * @return              Texture for the resource (only valid while the graph
+ *                      is being executed). */
+GPUTexture *RenderGraph::texture(ResourceHandle resource) const {
+    return m_resources[resource].image.texture;
+}
+
+/** Get the image for a resource.
+ * @param resource      Resource to get.
+ * @return              Image for the resource (only valid while the graph is
+ *                      being executed). */
+GPUTextureImageRef RenderGraph::textureImage(ResourceHandle resource) const {
+    return m_resources[resource].image;
+}
@@ -17,9 +17,6 @@
 /**
  * @file
  * @brief               Renderer light class.
- *
- * TODO:
- *  - Use a frustum rather than a bounding box for spot light culling.
  */
 
 #include "render/render_light.h"
@@ -29,6 +26,26 @@
 
 IMPLEMENT_UNIFORM_STRUCT(LightUniforms, "light", ResourceSets::kLightResources);
 
+/**
+ * Border around point light shadow map faces, in texels.
+ *
+ * Each face of a point light shadow map is rendered to a separate atlas tile,
+ * so PCF samples near the edge of a face would read from whatever is next to
+ * it in the atlas. The field of view of each face is widened so that it
+ * includes a border of this size beyond the edge of the face, which is enough
+ * for the 3x3 bilinear PCF used by shaders.
+ */
+static const float kPointShadowBorder = 2.0f;
+
+/**
+ * Weighting of logarithmic versus uniform cascade splits.
+ *
+ * Logarithmic splits give the best distribution of shadow map resolution, but
+ * result in very small cascades close to the viewer. The practical split
+ * scheme blends between the two.
+ */
+static const float kShadowCascadeSplitLambda = 0.75f;
+
 /**
  * Construct the light.
  *
@@ -38,9 +55,10 @@ IMPLEMENT_UNIFORM_STRUCT(LightUniforms, "light", ResourceSets::kLightResources);
  * @param type          Type of the light.
  */
 RenderLight::RenderLight(Type type) :
-    m_world (nullptr),
-    m_type  (type),
-    m_flags (0)
+    m_world             (nullptr),
+    m_type              (type),
+    m_flags             (0),
+    m_numShadowCascades (1)
 {
     m_resources = g_gpuManager->createResourceSet(g_renderResources->lightResourceSetLayout());
     m_resources->bindUniformBuffer(ResourceSlots::kUniforms, m_uniforms.gpu());
@@ -201,7 +219,103 @@ bool RenderLight::cull(RenderView &view) const {
         }
 
         case kSpotLight:
-            return !Math::intersect(view.frustum(), m_boundingBox);
+        {
+            /* Test the pyramid around the cone against the frustum. The light
+             * is culled if the pyramid is entirely outside any plane. */
+            const Frustum &frustum = view.frustum();
+            for (unsigned i = 0; i < Frustum::kNumPlanes; i++) {
+                const Plane &plane = frustum.plane(i);
+
+                bool outside = true;
+                for (const glm::vec3 &point : m_conePoints) {
+                    if (plane.distanceTo(point) >= 0.0f) {
+                        outside = false;
+                        break;
+                    }
+                }
+
+                if (outside)
+                    return true;
+            }
+
+            return false;
+        }
+
+        default:
+            return true;
+    }
+}
+
+/**
+ * Determine if the shadow of a caster may be visible in a view.
+ *
+ * Tests whether the volume that a shadow caster can cast a shadow into could
+ * intersect a view frustum. Casters for which this is false cannot affect
+ * anything visible in the view, so do not need to be rendered into the
+ * light's shadow map, even if they are within its shadow views.
+ *
+ * For directional lights, the shadow volume is the caster's bounding sphere
+ * swept infinitely along the light direction. For point and spot lights, it
+ * is the part of the cone from the light through the bounding sphere which is
+ * within the light's range, which is bounded by the convex hull of the sphere
+ * and the cone's cross section at the range of the light.
+ *
+ * @param caster        Bounding sphere of the caster.
+ * @param frustum       Frustum of the view.
+ *
+ * @return              Whether the shadow may be visible.
+ */
+bool RenderLight::shadowVisible(const Sphere &caster, const Frustum &frustum) const {
+    switch (m_type) {
+        case kDirectionalLight:
+            for (unsigned i = 0; i < Frustum::kNumPlanes; i++) {
+                const Plane &plane = frustum.plane(i);
+
+                /* Sweeping towards the inside of the plane always reaches it. */
+                if (plane.distanceTo(caster.centre) < -caster.radius &&
+                    glm::dot(plane.normal(), m_direction) <= 0.0f)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+
+        case kPointLight:
+        case kSpotLight:
+        {
+            const glm::vec3 toCaster = caster.centre - m_position;
+            const float distance = glm::length(toCaster);
+
+            /* Can't say anything about casters around the light. */
+            if (distance <= caster.radius)
+                return true;
+
+            /* Cone cross section at the light's range. */
+            const glm::vec3 axis = toCaster / distance;
+            const float sinAngle = caster.radius / distance;
+            const float tanAngle = sinAngle / sqrtf(1.0f - (sinAngle * sinAngle));
+            const glm::vec3 discCentre = m_position + (axis * m_range);
+            const float discRadius = m_range * tanAngle;
+
+            for (unsigned i = 0; i < Frustum::kNumPlanes; i++) {
+                const Plane &plane = frustum.plane(i);
+                const glm::vec3 normal = plane.normal();
+
+                /* Furthest extent of the sphere and the disc towards the
+                 * inside of the plane. */
+                const float cosNormal = glm::dot(normal, axis);
+                const float sphereExtent = plane.distanceTo(caster.centre) + caster.radius;
+                const float discExtent =
+                    plane.distanceTo(discCentre) +
+                    (discRadius * sqrtf(std::max(1.0f - (cosNormal * cosNormal), 0.0f)));
+
+                if (sphereExtent < 0.0f && discExtent < 0.0f)
+                    return false;
+            }
+
+            return true;
+        }
 
         default:
             return true;
@@ -241,11 +355,13 @@ void RenderLight::updateVolumeTransform() {
             m_volumeTransform.set(m_position, orientation, scale);
             m_uniforms.write()->volumeTransform = m_volumeTransform.matrix();
 
-            /* Fit a bounding box around the light's cone. */
-            BoundingBox base(
-                glm::vec3(-1.0f, -1.0f, -1.0f),
-                glm::vec3(1.0f, 1.0f, 0.0f));
-            m_boundingBox = base.transform(m_volumeTransform.matrix());
+            /* Fit a pyramid around the light's cone for culling. */
+            const glm::mat4 &matrix = m_volumeTransform.matrix();
+            m_conePoints[0] = m_position;
+            m_conePoints[1] = glm::vec3(matrix * glm::vec4(-1.0f, -1.0f, -1.0f, 1.0f));
+            m_conePoints[2] = glm::vec3(matrix * glm::vec4(1.0f, -1.0f, -1.0f, 1.0f));
+            m_conePoints[3] = glm::vec3(matrix * glm::vec4(-1.0f, 1.0f, -1.0f, 1.0f));
+            m_conePoints[4] = glm::vec3(matrix * glm::vec4(1.0f, 1.0f, -1.0f, 1.0f));
             break;
         }
 
@@ -271,23 +387,6 @@ void RenderLight::updateShadowViews() {
 
             /* Projection is a perspective projection covering the light's range. */
             m_shadowViews[0].perspective(m_cutoff * 2, 0.1f, m_range);
-
-            /* Shader shadow calculation for a spot light requires transformation
-             * of the world space position of the pixel being lit into shadow
-             * space, i.e. the view-projection transformation. We don't make the
-             * shadow view uniforms available to shaders rendering with the
-             * shadow map, so we need a copy of it in the light uniforms. We
-             * apply a bias to this matrix to map the X and Y coordinates into
-             * the [0, 1] range for shadow map sampling, as just the VP
-             * transformation yields NDC coordinates, i.e. in the range [-1, 1].
-             * Z is already in the [0, 1] range in NDC. */
-            const glm::mat4 shadowBiasMatrix(
-                0.5, 0.0, 0.0, 0.0,
-                0.0, 0.5, 0.0, 0.0,
-                0.0, 0.0, 1.0, 0.0,
-                0.5, 0.5, 0.0, 1.0);
-            m_uniforms.write()->shadowSpace
-                = shadowBiasMatrix * m_shadowViews[0].projection() * m_shadowViews[0].view();
             break;
         }
 
@@ -315,22 +414,168 @@ void RenderLight::updateShadowViews() {
                                                                cubeFaces[i].up));
 
                 /* Perspective projection covering the whole face, limited to
-                 * the light's range. */
+                 * the light's range. This is widened to include a border in
+                 * setShadowTile(). */
                 m_shadowViews[i].perspective(90.0f, 0.1f, m_range);
             }
 
-            /* Shadow calculation in shader requires the near plane value used
-             * in our projection. */
-            m_uniforms.write()->shadowZNear = 0.1f;
             break;
         }
 
         default:
-            /* TODO. */
+            /* Directional light views depend on the view being rendered, and
+             * are updated by updateShadowCascades(). */
             break;
     }
 }
 
+/**
+ * Update shadow cascades for a directional light.
+ *
+ * Directional light shadows are rendered as a set of cascades, each covering
+ * a slice of the view frustum, with the slices getting larger with distance.
+ * This updates the shadow views and uniforms for the cascades to cover the
+ * given view. Each cascade is fitted to a bounding sphere around its slice,
+ * and its position is snapped to whole shadow map texels, so that the
+ * projection is stable as the view moves and rotates. The shadow space
+ * transformations must then be set with setShadowTile().
+ *
+ * @param view          View being rendered (must be a perspective view).
+ * @param numCascades   Number of cascades (at most kMaxShadowCascades).
+ * @param distance      Maximum distance from the view to render shadows for.
+ *                      Casters are also included up to this distance beyond
+ *                      each cascade towards the light.
+ * @param resolution    Resolution of each cascade's shadow map.
+ */
+void RenderLight::updateShadowCascades(RenderView &view, unsigned numCascades, float distance, uint16_t resolution) {
+    check(m_type == kDirectionalLight);
+    check(numCascades > 0 && numCascades <= kMaxShadowCascades);
+
+    m_numShadowCascades = numCascades;
+
+    const float zNear = view.zNear();
+    const float zFar = std::min(view.zFar(), distance);
+
+    /* Squared distance from the view axis to the corner of the frustum, at a
+     * depth of 1. */
+    const float tanX = tanf(glm::radians(view.fov()) * 0.5f);
+    const float tanY = tanX / view.aspect();
+    const float cornerSq = (tanX * tanX) + (tanY * tanY);
+
+    /* Avoid a degenerate up vector if the light is pointing straight up or
+     * down. */
+    const glm::vec3 up = (fabsf(m_direction.y) > 0.99f)
+        ? glm::vec3(0.0f, 0.0f, 1.0f)
+        : glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::quat orientation = Math::quatLookAt(m_direction, up);
+    const glm::quat inverseOrientation = glm::inverse(orientation);
+
+    LightUniforms *uniforms = m_uniforms.write();
+
+    float splitNear = zNear;
+    for (unsigned i = 0; i < numCascades; i++) {
+        const float fraction = static_cast<float>(i + 1) / numCascades;
+        const float splitFar =
+            (kShadowCascadeSplitLambda * zNear * powf(zFar / zNear, fraction)) +
+            ((1.0f - kShadowCascadeSplitLambda) * (zNear + ((zFar - zNear) * fraction)));
+
+        /* Find the smallest sphere centred on the view axis which contains
+         * the corners of the slice. This is equidistant from the near and far
+         * corners, unless that would place it beyond the far plane. This does
+         * not depend on the view orientation, so the cascade size is fixed. */
+        const float centreDepth = std::min((splitNear + splitFar) * (1.0f + cornerSq) * 0.5f, splitFar);
+        const float farOffset = splitFar - centreDepth;
+        float radius = sqrtf((splitFar * splitFar * cornerSq) + (farOffset * farOffset));
+
+        /* Round up the radius so that precision errors do not change it. */
+        radius = ceilf(radius * 16.0f) / 16.0f;
+
+        /* Snap the centre to texel increments in light space. Depth is also
+         * snapped, so that the cascade does not change at all (and cached
+         * shadow maps remain valid) while the view moves by less than a
+         * texel. The far plane is extended by a texel to compensate. */
+        const float texelSize = (2.0f * radius) / resolution;
+        glm::vec3 centre = view.position() + (view.orientation() * glm::vec3(0.0f, 0.0f, -centreDepth));
+        glm::vec3 lightCentre = inverseOrientation * centre;
+        lightCentre.x = floorf(lightCentre.x / texelSize) * texelSize;
+        lightCentre.y = floorf(lightCentre.y / texelSize) * texelSize;
+        lightCentre.z = floorf(lightCentre.z / texelSize) * texelSize;
+        centre = orientation * lightCentre;
+
+        /* Pull the view back towards the light so that casters outside of the
+         * slice still cast shadows into it. */
+        RenderView &shadowView = m_shadowViews[i];
+        shadowView.setTransform(centre - (m_direction * (radius + distance)), orientation);
+        shadowView.orthographic(-radius, radius, -radius, radius, 0.0f, (2.0f * radius) + distance + texelSize);
+
+        uniforms->shadowCascadeSplits[i] = splitFar;
+
+        splitNear = splitFar;
+    }
+
+    uniforms->shadowCascadeCount = numCascades;
+}
+
+/**
+ * Set the shadow map atlas tile for a shadow view.
+ *
+ * Shadow maps for all lights are rendered into tiles of a single atlas
+ * texture. This sets the viewport of the shadow view to the tile that it
+ * should be rendered to, and updates the shadow space transformation for the
+ * view accordingly. It must be called for each shadow view whenever the view
+ * or the tile changes.
+ *
+ * @param index         Index of the shadow view.
+ * @param tile          Area of the atlas to render the view to.
+ * @param atlasSize     Size of the atlas texture.
+ */
+void RenderLight::setShadowTile(unsigned index, const IntRect &tile, uint16_t atlasSize) {
+    check(index < numShadowViews());
+
+    RenderView &shadowView = m_shadowViews[index];
+    shadowView.setViewport(tile);
+
+    if (m_type == kPointLight) {
+        const float size = tile.width;
+        const float fov = glm::degrees(2.0f * atanf(size / (size - (2.0f * kPointShadowBorder))));
+
+        if (fov != shadowView.fov())
+            shadowView.perspective(fov, 0.1f, m_range);
+    }
+
+    /* Shader shadow calculations require transformation of the world space
+     * position of the pixel being lit into shadow space, i.e. the view-
+     * projection transformation. We don't make the shadow view uniforms
+     * available to shaders rendering with the shadow map, so we need a copy
+     * of it in the light uniforms. This yields NDC coordinates, so we apply a
+     * transformation to map the X and Y coordinates from the [-1, 1] range
+     * into the tile's texture coordinates. Render areas are specified from
+     * the top of the target, while texture coordinates start at the bottom.
+     * Z is already in the [0, 1] range in NDC. */
+    const float texelSize = 1.0f / atlasSize;
+    const glm::mat4 tileMatrix(
+        0.5f * tile.width * texelSize, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.5f * tile.height * texelSize, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        (tile.x + (0.5f * tile.width)) * texelSize, (atlasSize - tile.y - (0.5f * tile.height)) * texelSize, 0.0f, 1.0f);
+
+    static glm::mat4 LightUniforms::*const kShadowSpaces[kMaxShadowViews] = {
+        &LightUniforms::shadowSpace,
+        &LightUniforms::shadowSpace1,
+        &LightUniforms::shadowSpace2,
+        &LightUniforms::shadowSpace3,
+        &LightUniforms::shadowSpace4,
+        &LightUniforms::shadowSpace5,
+    };
+
+    /* This is called every frame, so only write the uniforms if the
+     * transformation has changed to avoid uploading them again for lights
+     * which have not moved. */
+    const glm::mat4 shadowSpace = tileMatrix * shadowView.projection() * shadowView.view();
+    if (m_uniforms.read()->*kShadowSpaces[index] != shadowSpace)
+        m_uniforms.write()->*kShadowSpaces[index] = shadowSpace;
+}
+
 /** Update the light in the world. */
 void RenderLight::updateWorld() {
     if (m_world)
@@ -19,6 +19,7 @@
  * @brief               Rendering pipeline class.
  */
 
+#include "engine/asset_manager.h"
 #include "engine/debug_manager.h"
 #include "engine/serialiser.h"
 #include "engine/window.h"
@@ -33,8 +34,15 @@
 /** Global resources for all pipelines. */
 static GlobalResource<RenderPipeline::BaseResources> g_renderPipelineResources;
 
+/** Initialise global resources for all pipelines. */
+RenderPipeline::BaseResources::BaseResources() {
+    this->fusedPostEffectShader = g_assetManager->load<Shader>("engine/shaders/post_effects/fused_post_effect");
+}
+
 /** Construct the pipeline. */
-RenderPipeline::RenderPipeline() {
+RenderPipeline::RenderPipeline() :
+    fusePostEffects (true)
+{
     /* Ensure global resources are initialised. */
     g_renderPipelineResources.init();
 
@@ -90,17 +98,17 @@ void RenderPipeline::addPostEffect(ObjectPtr<PostEffect> effect) {
 }
 
 /**
- * Render all post-processing effects.
+ * Add passes for all post-processing effects.
  *
- * Renders all post-processing effects (if any) and outputs the final image to
- * the render target.
+ * Adds passes to the render graph to render all post-processing effects (if
+ * any) and output the final image to the render target.
  *
  * @param context       Rendering context.
- * @param input         Input texture.
+ * @param input         Input texture resource.
  * @param imageType     Type of the input image.
  */
 void RenderPipeline::renderPostEffects(RenderContext &context,
-                                       const RenderTargetPool::Handle &input,
+                                       RenderGraph::ResourceHandle input,
                                        ImageType imageType) const
 {
     /* Helper to check that the render target format is suitable for the output
@@ -129,48 +137,63 @@ void RenderPipeline::renderPostEffects(RenderContext &context,
             #endif
         };
 
+    RenderGraph &graph = context.graph();
+    const RenderGraph::ResourceHandle output = context.targetResource();
+    const IntRect viewport = context.view().viewport();
+
     if (m_postEffects.empty()) {
         validateTargetImageType(imageType);
 
         /* Just blit to the output. */
-        GPUTextureImageRef dest;
-        context.target().getTextureImageRef(dest);
-        g_gpuManager->blit(GPUTextureImageRef(input),
-                           dest,
-                           glm::ivec2(0, 0),
-                           context.view().viewport().pos(),
-                           context.view().viewport().size());
+        RenderGraph::Pass &pass = graph.addPass("Output");
+        pass.addInput(input);
+        pass.addOutput(output);
+        pass.setFunction(
+            [input, output, viewport] (const RenderGraph &graph, GPUCommandList *cmdList) {
+                g_gpuManager->blit(graph.textureImage(input),
+                                   graph.textureImage(output),
+                                   glm::ivec2(0, 0),
+                                   viewport.pos(),
+                                   viewport.size());
+            });
+
         return;
     }
 
-    GPU_DEBUG_GROUP("Post Processing");
-
-    /* We bounce between up to 2 temporary render targets. These are allocated
-     * below when needed. TODO: Maybe we should have these allocated up front
-     * when the render pipeline is created, based on requirements of the whole
-     * effect chain. */
-    RenderTargetPool::Handle dest;
-    RenderTargetPool::Handle source = input;
-
-    for (PostEffect *effect : m_postEffects) {
-        GPU_DEBUG_GROUP("%s", effect->metaClass().name());
+    /* Split the chain into passes. Consecutive effects which can be fused are
+     * rendered in a single pass, as long as their stages are in the order the
+     * fused shader applies them. */
+    std::vector<std::vector<const PostEffect *>> passEffects;
+    PostEffect::FusedStage lastStage = PostEffect::FusedStage::kNone;
+
+    for (const PostEffect *effect : m_postEffects) {
+        const PostEffect::FusedStage stage = effect->fusedStage();
+
+        if (this->fusePostEffects &&
+            stage != PostEffect::FusedStage::kNone &&
+            lastStage != PostEffect::FusedStage::kNone &&
+            stage > lastStage)
+        {
+            passEffects.back().emplace_back(effect);
+        } else {
+            passEffects.emplace_back(1, effect);
+        }
 
-        const bool isLast = effect == m_postEffects.back();
+        lastStage = stage;
+    }
 
-        ImageType outputImageType = effect->outputImageType();
-        if (outputImageType == ImageType::kDontCare)
-            outputImageType = imageType;
+    /* Each pass other than the last outputs to a new transient texture. The
+     * render graph shares textures between those which do not overlap, so
+     * this only needs as many textures as the chain really requires. */
+    RenderGraph::ResourceHandle source = input;
+    size_t numFusedPasses = 0;
 
-        GPURenderTargetDesc targetDesc(1);
-        IntRect targetArea;
+    for (const std::vector<const PostEffect *> &effects : passEffects) {
+        const bool isLast = &effects == &passEffects.back();
 
-        if (isLast) {
-            validateTargetImageType(outputImageType);
+        std::string name;
 
-            /* The final effect outputs onto the real render target. */
-            context.target().getRenderTargetDesc(targetDesc);
-            targetArea = context.view().viewport();
-        } else {
+        for (const PostEffect *effect : effects) {
             #if ORION_BUILD_DEBUG
                 const ImageType expectedImageType = effect->inputImageType();
                 if (expectedImageType != ImageType::kDontCare && expectedImageType != imageType) {
@@ -181,72 +204,98 @@ void RenderPipeline::renderPostEffects(RenderContext &context,
                 }
             #endif
 
-            if (!dest || imageType != outputImageType) {
-                PixelFormat format;
+            const ImageType outputImageType = effect->outputImageType();
+            if (outputImageType != ImageType::kDontCare)
+                imageType = outputImageType;
+
+            if (!name.empty())
+                name += " + ";
+            name += effect->metaClass().name();
+        }
 
-                switch (outputImageType) {
-                    case ImageType::kHDR:
-                        format = kHDRColourBufferFormat;
-                        break;
+        RenderGraph::ResourceHandle dest;
+        IntRect targetArea;
 
-                    case ImageType::kLinearLDR:
-                        format = kLinearLDRColourBufferFormat;
-                        break;
+        if (isLast) {
+            validateTargetImageType(imageType);
 
-                    case ImageType::kNonLinearLDR:
-                        format = kNonLinearLDRColourBufferFormat;
-                        break;
+            /* The final pass outputs onto the real render target. */
+            dest = output;
+            targetArea = viewport;
+        } else {
+            PixelFormat format;
 
-                    default:
-                        unreachable();
+            switch (imageType) {
+                case ImageType::kHDR:
+                    format = kHDRColourBufferFormat;
+                    break;
 
-                }
+                case ImageType::kLinearLDR:
+                    format = kLinearLDRColourBufferFormat;
+                    break;
+
+                case ImageType::kNonLinearLDR:
+                    format = kNonLinearLDRColourBufferFormat;
+                    break;
 
-                auto textureDesc = GPUTextureDesc().
-                    setType   (GPUTexture::kTexture2D).
-                    setWidth  (input->width()).
-                    setHeight (input->height()).
-                    setMips   (1).
-                    setFlags  (GPUTexture::kRenderTarget).
-                    setFormat (format);
+                default:
+                    unreachable();
 
-                dest = g_renderTargetPool->allocate(textureDesc);
             }
 
-            targetDesc.colour[0].texture = dest;
-            targetArea = IntRect(0, 0, input->width(), input->height());
+            auto textureDesc = GPUTextureDesc().
+                setType   (GPUTexture::kTexture2D).
+                setWidth  (viewport.width).
+                setHeight (viewport.height).
+                setMips   (1).
+                setFlags  (GPUTexture::kRenderTarget).
+                setFormat (format);
+
+            dest = graph.createTexture(name, textureDesc);
+            targetArea = IntRect(0, 0, viewport.width, viewport.height);
         }
 
-        effect->render(source, targetDesc, targetArea);
+        /* Get a material for fused passes. */
+        Material *fusedMaterial = nullptr;
+        if (effects.size() > 1) {
+            if (numFusedPasses == m_fusedMaterials.size())
+                m_fusedMaterials.emplace_back(new Material(resources().fusedPostEffectShader));
 
-        /* Switch the output to be the source for the next effect. */
-        std::swap(dest, source);
+            fusedMaterial = m_fusedMaterials[numFusedPasses++];
+        }
 
-        /* Changing image type will invalidate the other target we have as well,
-         * need to change the format. */
-        if (outputImageType != imageType || dest == input)
-            dest = nullptr;
+        /* Effects begin their own render passes. */
+        RenderGraph::Pass &pass = graph.addPass(name);
+        pass.addInput(source);
+        pass.addOutput(dest);
+        pass.setFunction(
+            [effects, source, dest, targetArea, fusedMaterial] (const RenderGraph &graph, GPUCommandList *cmdList) {
+                GPURenderTargetDesc targetDesc(1);
+                targetDesc.colour[0] = graph.textureImage(dest);
+
+                if (fusedMaterial) {
+                    PostEffect::renderFused(effects, graph.texture(source), targetDesc, targetArea, fusedMaterial);
+                } else {
+                    effects.front()->render(graph.texture(source), targetDesc, targetArea);
+                }
+            });
 
-        imageType = outputImageType;
+        /* Switch the output to be the source for the next pass. */
+        source = dest;
     }
 }
 
-/** Render debug primitives.
+/** Add a pass to render debug primitives.
  * @param context       Rendering context. */
 void RenderPipeline::renderDebug(RenderContext &context) const {
-    GPU_DEBUG_GROUP("Debug");
-
-    GPURenderTargetDesc targetDesc;
-    context.target().getRenderTargetDesc(targetDesc);
-
-    GPUCommandList *cmdList = beginSimpleRenderPass(targetDesc,
-                                                    context.view().viewport(),
-                                                    GPURenderLoadOp::kLoad);
-
-    /* Draw debug primitives onto the view. */
-    g_debugManager->renderView(cmdList, context.view().getResources());
-
-    g_gpuManager->submitRenderPass(cmdList);
+    RenderGraph::Pass &pass = context.graph().addPass("Debug");
+    pass.setColourAttachment(0, context.targetResource());
+    pass.setRenderArea(context.view().viewport());
+    pass.setFunction(
+        [&context] (const RenderGraph &graph, GPUCommandList *cmdList) {
+            /* Draw debug primitives onto the view. */
+            g_debugManager->renderView(cmdList, context.view().getResources());
+        });
 }
 
 /**
@@ -25,6 +25,8 @@
 
 #include "render_core/render_resources.h"
 
+#include <limits>
+
 IMPLEMENT_UNIFORM_STRUCT(ViewUniforms, "view", ResourceSets::kViewResources);
 
 /**
@@ -35,6 +37,7 @@ IMPLEMENT_UNIFORM_STRUCT(ViewUniforms, "view", ResourceSets::kViewResources);
  */
 RenderView::RenderView() :
     m_viewOutdated       (true),
+    m_orthographic       (false),
     m_projectionOutdated (true),
     m_aspect             (1.0f)
 {
@@ -62,6 +65,7 @@ void RenderView::setTransform(const glm::vec3 &position, const glm::quat &orient
  * @param zNear         Distance to near clipping plane.
  * @param zFar          Distance to far clipping plane. */
 void RenderView::perspective(float fov, float zNear, float zFar) {
+    m_orthographic = false;
     m_fov = fov;
     m_zNear = zNear;
     m_zFar = zFar;
@@ -69,6 +73,28 @@ void RenderView::perspective(float fov, float zNear, float zFar) {
     m_projectionOutdated = true;
 }
 
+/**
+ * Set an orthographic projection.
+ *
+ * Sets an orthographic projection. The bounds are given in view space and are
+ * not adjusted to match the viewport's aspect ratio.
+ *
+ * @param left          Left clipping plane.
+ * @param right         Right clipping plane.
+ * @param bottom        Bottom clipping plane.
+ * @param top           Top clipping plane.
+ * @param zNear         Distance to near clipping plane.
+ * @param zFar          Distance to far clipping plane.
+ */
+void RenderView::orthographic(float left, float right, float bottom, float top, float zNear, float zFar) {
+    m_orthographic = true;
+    m_orthographicBounds = glm::vec4(left, right, bottom, top);
+    m_zNear = zNear;
+    m_zFar = zFar;
+
+    m_projectionOutdated = true;
+}
+
 /** Set the viewport.
  * @param viewport      Viewport rectangle in pixels. */
 void RenderView::setViewport(const IntRect &viewport) {
@@ -89,6 +115,35 @@ void RenderView::setViewport(const IntRect &viewport) {
     }
 }
 
+/**
+ * Get the projected radius of a sphere.
+ *
+ * Gets the approximate radius in pixels of a sphere when projected into the
+ * view's viewport. This does not take into account whether the sphere is
+ * within the view frustum.
+ *
+ * @param sphere        Sphere to project.
+ *
+ * @return              Projected radius in pixels, or the maximum float value
+ *                      if the view position is within the sphere.
+ */
+float RenderView::projectedRadius(const Sphere &sphere) {
+    updateMatrices();
+
+    /* Size is independent of distance for orthographic projections. */
+    if (m_orthographic)
+        return sphere.radius * m_projection[1][1] * 0.5f * static_cast<float>(m_viewport.height);
+
+    const float distance = glm::distance(m_position, sphere.centre);
+    if (distance <= sphere.radius)
+        return std::numeric_limits<float>::max();
+
+    /* Projection [1][1] is the cotangent of half the vertical field of view,
+     * giving the size in normalised device coordinates, which span 2 units
+     * across the viewport. */
+    return sphere.radius / distance * m_projection[1][1] * 0.5f * static_cast<float>(m_viewport.height);
+}
+
 /** Flush pending updates and get resources.
  * @return              Resource set containing per-view resources. */
 GPUResourceSet *RenderView::getResources() {
@@ -115,11 +170,18 @@ void RenderView::updateMatrices() {
     }
 
     if (m_projectionOutdated) {
-        /* Convert horizontal field of view to vertical. */
-        float fov = glm::radians(m_fov);
-        float verticalFOV = 2.0f * atanf(tanf(fov * 0.5f) / m_aspect);
+        if (m_orthographic) {
+            m_projection = glm::ortho(m_orthographicBounds.x, m_orthographicBounds.y,
+                                      m_orthographicBounds.z, m_orthographicBounds.w,
+                                      m_zNear, m_zFar);
+        } else {
+            /* Convert horizontal field of view to vertical. */
+            float fov = glm::radians(m_fov);
+            float verticalFOV = 2.0f * atanf(tanf(fov * 0.5f) / m_aspect);
+
+            m_projection = glm::perspective(verticalFOV, m_aspect, m_zNear, m_zFar);
+        }
 
-        m_projection = glm::perspective(verticalFOV, m_aspect, m_zNear, m_zFar);
         uniforms->projection = m_projection;
         m_projectionOutdated = false;
     }
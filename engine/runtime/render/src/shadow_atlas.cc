@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Shadow map atlas allocator.
+ */
+
+#include "render/shadow_atlas.h"
+
+/** Initialise the allocator. The atlas must be reset() before use. */
+ShadowAtlas::ShadowAtlas() :
+    m_size (0)
+{}
+
+/** Destroy the allocator. */
+ShadowAtlas::~ShadowAtlas() {}
+
+/**
+ * Reset the atlas.
+ *
+ * Resets the atlas to the given size, with all of it free. Any previous
+ * allocations are discarded.
+ *
+ * @param size          Size of the atlas. Must be a power of 2 at least
+ *                      kMinTileSize.
+ */
+void ShadowAtlas::reset(uint16_t size) {
+    check(Math::isPow2(size) && size >= kMinTileSize);
+
+    m_size = size;
+
+    unsigned numLevels = 1;
+    while ((size >> numLevels) >= kMinTileSize)
+        numLevels++;
+
+    m_freeTiles.clear();
+    m_freeTiles.resize(numLevels);
+    m_freeTiles[0].emplace_back(0, 0);
+}
+
+/** Get the level for a tile size.
+ * @param size          Tile size.
+ * @return              Level containing tiles of that size. */
+unsigned ShadowAtlas::level(uint16_t size) const {
+    unsigned level = 0;
+    while ((m_size >> level) > size)
+        level++;
+
+    return level;
+}
+
+/** Allocate a tile.
+ * @param size          Size of the tile. Must be a power of 2 between
+ *                      kMinTileSize and the atlas size.
+ * @param outTile       Where to store allocated area.
+ * @return              Whether there was space for the tile. */
+bool ShadowAtlas::allocate(uint16_t size, IntRect &outTile) {
+    check(Math::isPow2(size) && size >= kMinTileSize && size <= m_size);
+
+    const unsigned target = level(size);
+
+    /* Find the smallest free tile that is large enough. */
+    unsigned current = target + 1;
+    while (current > 0 && m_freeTiles[current - 1].empty())
+        current--;
+
+    if (current == 0)
+        return false;
+
+    current--;
+
+    glm::ivec2 pos = m_freeTiles[current].back();
+    m_freeTiles[current].pop_back();
+
+    /* Split it down to the required size, keeping the first quarter each time
+     * and freeing the others. */
+    while (current < target) {
+        current++;
+
+        const int32_t half = m_size >> current;
+        m_freeTiles[current].emplace_back(pos.x + half, pos.y);
+        m_freeTiles[current].emplace_back(pos.x, pos.y + half);
+        m_freeTiles[current].emplace_back(pos.x + half, pos.y + half);
+    }
+
+    outTile = IntRect(pos.x, pos.y, size, size);
+    return true;
+}
+
+/** Free a tile.
+ * @param tile          Tile previously returned by allocate(). */
+void ShadowAtlas::free(const IntRect &tile) {
+    unsigned current = level(tile.width);
+    glm::ivec2 pos = tile.pos();
+
+    /* Merge with the tile's siblings while they are all free. */
+    while (current > 0) {
+        const int32_t parentSize = m_size >> (current - 1);
+        const glm::ivec2 parent(pos.x & ~(parentSize - 1), pos.y & ~(parentSize - 1));
+        const int32_t half = parentSize / 2;
+
+        std::vector<glm::ivec2> &freeTiles = m_freeTiles[current];
+        size_t siblings[3];
+        size_t numSiblings = 0;
+
+        for (size_t i = 0; i < freeTiles.size() && numSiblings < 3; i++) {
+            const glm::ivec2 offset = freeTiles[i] - parent;
+
+            if ((offset.x == 0 || offset.x == half) &&
+                (offset.y == 0 || offset.y == half) &&
+                freeTiles[i] != pos)
+            {
+                siblings[numSiblings++] = i;
+            }
+        }
+
+        if (numSiblings < 3)
+            break;
+
+        /* Remove in reverse order so that indices remain valid. */
+        for (size_t i = 3; i > 0; i--) {
+            freeTiles[siblings[i - 1]] = freeTiles.back();
+            freeTiles.pop_back();
+        }
+
+        pos = parent;
+        current--;
+    }
+
+    m_freeTiles[current].push_back(pos);
+}
@@ -35,9 +35,48 @@ SimpleRenderWorld::~SimpleRenderWorld() {}
  * @param outResults    Results structure to fill in.
  * @param flags         Culling behaviour flags. */
 void SimpleRenderWorld::cull(RenderView &view, CullResults &outResults, uint32_t flags) const {
+    const bool cullOcclusion = (flags & kCullOcclusion) && !m_occluders.empty();
+
+    if (cullOcclusion) {
+        m_occlusionBuffer.begin(view.viewProjection());
+
+        for (RenderEntity *entity : m_occluders) {
+            if (!Math::intersect(view.frustum(), entity->worldBoundingBox()))
+                continue;
+
+            const std::vector<uint16_t> &indices = entity->occluderIndices();
+            m_occlusionBuffer.addOccluder(entity->transform().matrix(),
+                                          entity->occluderVertices().data(),
+                                          indices.data(),
+                                          indices.size());
+        }
+
+        m_occlusionBuffer.finish();
+    }
+
     for (RenderEntity *entity : m_entities) {
-        if (Math::intersect(view.frustum(), entity->worldBoundingBox()))
-            outResults.entities.emplace_back(entity);
+        if (!Math::intersect(view.frustum(), entity->worldBoundingBox()))
+            continue;
+
+        /* Occluders lie within their entity's bounds, so could appear to
+         * hide the entity itself. They are never culled. */
+        if (cullOcclusion &&
+            !entity->isOccluder() &&
+            m_occlusionBuffer.isOccluded(entity->worldBoundingBox()))
+        {
+            continue;
+        }
+
+        const unsigned lod = entity->selectLOD(view, flags & kLODHysteresis);
+
+        GPUIndexDataPtr indices;
+        if ((flags & kCullClusters) && !entity->cullClusters(view, lod, indices))
+            continue;
+
+        if (flags & kStreamTextures)
+            entity->requestTextures(view);
+
+        outResults.entities.emplace_back(entity, lod, std::move(indices));
     }
 
     if (flags & kCullLights) {
@@ -48,10 +87,59 @@ void SimpleRenderWorld::cull(RenderView &view, CullResults &outResults, uint32_t
     }
 }
 
+/** Cull shadow casters for a light.
+ * @param light         Light to cull for.
+ * @param view          Main view being rendered.
+ * @param outResults    Array of results structures, one per shadow view.
+ * @param flags         Culling behaviour flags. */
+void SimpleRenderWorld::cullShadowCasters(RenderLight *light,
+                                          RenderView &view,
+                                          CullResults *outResults,
+                                          uint32_t flags) const
+{
+    const unsigned numShadowViews = light->numShadowViews();
+    const Sphere lightSphere(light->position(), light->range());
+
+    for (RenderEntity *entity : m_shadowCasters) {
+        const BoundingBox &box = entity->worldBoundingBox();
+
+        /* The faces of a point light together cover its whole range, so test
+         * against that once, and only then classify against each face. */
+        if (light->type() == RenderLight::kPointLight && !Math::intersect(lightSphere, box))
+            continue;
+
+        const glm::vec3 extent = box.maximum - box.minimum;
+        const Sphere sphere((box.minimum + box.maximum) * 0.5f, glm::length(extent) * 0.5f);
+        if (!light->shadowVisible(sphere, view.frustum()))
+            continue;
+
+        for (unsigned i = 0; i < numShadowViews; i++) {
+            RenderView &shadowView = light->shadowView(i);
+
+            if (!Math::intersect(shadowView.frustum(), box))
+                continue;
+
+            const unsigned lod = entity->selectLOD(shadowView, false);
+
+            GPUIndexDataPtr indices;
+            if ((flags & kCullClusters) && !entity->cullClusters(shadowView, lod, indices))
+                continue;
+
+            outResults[i].entities.emplace_back(entity, lod, std::move(indices));
+        }
+    }
+}
+
 /** Add an entity to the world.
  * @param entity        Entity to add. */
 void SimpleRenderWorld::addEntity(RenderEntity *entity) {
     m_entities.push_back(entity);
+
+    if (entity->castsShadow())
+        m_shadowCasters.push_back(entity);
+
+    if (entity->isOccluder())
+        m_occluders.push_back(entity);
 }
 
 /** Update an entity in the world.
@@ -64,6 +152,12 @@ void SimpleRenderWorld::updateEntity(RenderEntity *entity) {
  * @param entity        Entity to update. */
 void SimpleRenderWorld::removeEntity(RenderEntity *entity) {
     m_entities.remove(entity);
+
+    if (entity->castsShadow())
+        m_shadowCasters.remove(entity);
+
+    if (entity->isOccluder())
+        m_occluders.remove(entity);
 }
 
 /** Add a light to the world.
@@ -77,6 +77,8 @@ public:
     }
 
     void setGPUTexture(const char *name, GPUTexture *texture, GPUSamplerState *sampler);
+
+    void requestTextureResolution(float size) const;
 protected:
     Material();
     ~Material();
@@ -155,6 +155,14 @@ void Material::setDrawState(GPUCommandList *cmdList) const {
     if (m_uniforms)
         m_uniforms->flush();
 
+    /* Streamed textures replace their GPU texture when their resident levels
+     * change, so rebind any which have changed. */
+    for (size_t i = 0; i < m_resourceAssets.size(); i++) {
+        const TextureBase *texture = static_cast<const TextureBase *>(m_resourceAssets[i].get());
+        if (texture && m_resources->slots()[i].object != texture->gpu())
+            m_resources->bindTexture(i, texture->gpu(), texture->sampler());
+    }
+
     cmdList->bindResourceSet(ResourceSets::kMaterialResources, m_resources);
 }
 
@@ -278,3 +286,19 @@ void Material::setGPUTexture(const char *name, GPUTexture *texture, GPUSamplerSt
 
     m_resources->bindTexture(parameter->resourceSlot, texture, sampler);
 }
+
+/**
+ * Request a resolution for the material's textures.
+ *
+ * Records the size at which the material's textures are being displayed in the
+ * current frame, for texture streaming. See Texture2D::requestResolution().
+ *
+ * @param size          Size in pixels.
+ */
+void Material::requestTextureResolution(float size) const {
+    for (const AssetPtr &asset : m_resourceAssets) {
+        Texture2D *texture = object_cast<Texture2D *>(asset.get());
+        if (texture)
+            texture->requestResolution(size);
+    }
+}
@@ -113,8 +113,10 @@ static std::string generateSource(const ShaderCompiler::Options &options) {
                                  VertexAttribute::glslIndex(VertexAttribute::kTexcoordSemantic, 0));
         source += String::format("#define kDiffuseSemantic %u\n",
                                  VertexAttribute::glslIndex(VertexAttribute::kDiffuseSemantic, 0));
-        source += String::format("#define kSpecularSemantic %u\n\n",
+        source += String::format("#define kSpecularSemantic %u\n",
                                  VertexAttribute::glslIndex(VertexAttribute::kSpecularSemantic, 0));
+        source += String::format("#define kTransformSemantic %u\n\n",
+                                 VertexAttribute::glslIndex(VertexAttribute::kTransformSemantic, 0));
     }
 
     /* Add resource set/slot definitions. */
@@ -71,11 +71,78 @@ void decodeGBuffer(out LightingData data) {
     data.position = homogeneousPosition.xyz / homogeneousPosition.w;
 }
 
+#ifdef CLUSTERED
+
+/** Calculate the contribution of all lights in the fragment's cluster.
+ * @param data          Lighting calculation data.
+ * @return              Calculated pixel colour. */
+vec3 calcClusteredLights(LightingData data) {
+    /* Find the cluster. X/Y are divided evenly in NDC, Z is divided
+     * exponentially in view space depth (see LightClusters). */
+    vec2 ndcPosition = (((gl_FragCoord.xy - view.viewportPosition) / view.viewportSize) * 2.0) - 1.0;
+    float depth = -(view.view * vec4(data.position, 1.0)).z;
+    ivec3 cluster = clamp(
+        ivec3(
+            ivec2(((ndcPosition * 0.5) + 0.5) * vec2(lightClusterGridSize.xy)),
+            int((log(depth) * lightClusterDepth.x) + lightClusterDepth.y)),
+        ivec3(0),
+        lightClusterGridSize - 1);
+
+    vec2 entry = texelFetch(
+        lightClusterGrid,
+        ivec2((cluster.y * lightClusterGridSize.x) + cluster.x, cluster.z),
+        0).rg;
+    int offset = int(entry.x);
+    int count = int(entry.y);
+
+    int indexWidth = textureSize(lightClusterIndices, 0).x;
+
+    vec3 colour = vec3(0.0);
+    for (int i = 0; i < count; i++) {
+        int index = offset + i;
+        int lightIndex = int(texelFetch(lightClusterIndices, ivec2(index % indexWidth, index / indexWidth), 0).r);
+
+        vec4 positionRange = texelFetch(lightClusterData, ivec2(0, lightIndex), 0);
+        vec4 directionCutoff = texelFetch(lightClusterData, ivec2(1, lightIndex), 0);
+        vec4 radianceSpot = texelFetch(lightClusterData, ivec2(2, lightIndex), 0);
+        vec3 attenuationFactors = texelFetch(lightClusterData, ivec2(3, lightIndex), 0).xyz;
+
+        /* Calculate distance to light and direction to the fragment. */
+        vec3 lightToFragment = data.position - positionRange.xyz;
+        float distance = length(lightToFragment);
+        vec3 direction = normalize(lightToFragment);
+
+        /* Ignore pixels out of range, as in calcLight(). */
+        float attenuation = clamp(floor(positionRange.w / distance), 0.0, 1.0);
+
+        /* Soften the cone edge for spot lights. */
+        if (radianceSpot.w != 0.0) {
+            float spotFactor = max(dot(direction, directionCutoff.xyz), directionCutoff.w);
+            attenuation *= 1.0 - ((1.0 - spotFactor) / (1.0 - directionCutoff.w));
+        }
+
+        attenuation /=
+            attenuationFactors.x +
+            (attenuationFactors.y * distance) +
+            (attenuationFactors.z * distance * distance);
+
+        colour += calcLightBlinnPhong(data, direction, radianceSpot.rgb) * attenuation;
+    }
+
+    return colour;
+}
+
+#endif
+
 void main() {
     /* Decode the G-Buffer data. */
     LightingData data;
     decodeGBuffer(data);
 
     /* Calculate fragment colour. */
-    fragColour = calcLight(data);
+    #ifdef CLUSTERED
+        fragColour = vec4(calcClusteredLights(data), 1.0);
+    #else
+        fragColour = calcLight(data);
+    #endif
 }
@@ -22,9 +22,9 @@
 layout(location = kPositionSemantic) in vec3 attribPosition;
 
 void main() {
-    #if defined(AMBIENT_LIGHT) || defined(DIRECTIONAL_LIGHT)
-        /* Ambient and deferred lights are rendered as fullscreen quads. Use
-         * an identity transformation. */
+    #if defined(AMBIENT_LIGHT) || defined(DIRECTIONAL_LIGHT) || defined(CLUSTERED)
+        /* Ambient and deferred lights, and the clustered light pass, are
+         * rendered as fullscreen quads. Use an identity transformation. */
         gl_Position = vec4(attribPosition, 1.0);
     #else
         /* Other light volumes are rendered as geometry in world space. */
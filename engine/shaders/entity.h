@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Entity vertex shader definitions.
+ *
+ * Entities are drawn with instancing, so per-entity data which varies between
+ * instances is supplied through per-instance vertex attributes rather than the
+ * entity uniforms.
+ */
+
+#ifndef __ENTITY_H
+#define __ENTITY_H
+
+/** Rows of the entity's transformation. */
+layout(location = kTransformSemantic + 0) in vec4 attribTransform0;
+layout(location = kTransformSemantic + 1) in vec4 attribTransform1;
+layout(location = kTransformSemantic + 2) in vec4 attribTransform2;
+
+/**
+ * Entity positions must be calculated identically by all passes. The depth
+ * pre-pass uses the shadow caster pass, and the G-Buffer is then rendered with
+ * an equal depth test against its output.
+ */
+invariant gl_Position;
+
+/** Get the transformation of the entity being drawn.
+ * @return              Transformation from vertex positions to world space. */
+mat4 entityTransform() {
+    return transpose(mat4(attribTransform0,
+                          attribTransform1,
+                          attribTransform2,
+                          vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+#endif /* __ENTITY_H */
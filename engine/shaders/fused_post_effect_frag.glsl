@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               Fused post-processing fragment shader.
+ *
+ * This shader applies a sequence of per-pixel post-processing effects in a
+ * single pass. Each effect is enabled by a keyword, and the enabled effects are
+ * applied in the order given here, which must match PostEffect::FusedStage.
+ */
+
+#include "gamma_correction.h"
+#include "post_effect.h"
+#include "tonemap.h"
+
+layout(location = 0) out vec4 fragColour;
+
+void main() {
+    vec4 sourceColour = sampleSourceTexture();
+    vec3 colour = sourceColour.rgb;
+
+    #ifdef TONEMAP
+        colour = tonemap(colour);
+    #endif
+
+    #ifdef GAMMA_CORRECTION
+        colour = gammaCorrect(colour);
+    #endif
+
+    fragColour = vec4(colour, sourceColour.a);
+}
@@ -19,13 +19,12 @@
  * @brief               Gamma correction fragment shader.
  */
 
+#include "gamma_correction.h"
 #include "post_effect.h"
 
 layout(location = 0) out vec4 fragColour;
 
 void main() {
     vec4 sourceColour = sampleSourceTexture();
-    fragColour = vec4(
-        pow(sourceColour.rgb, vec3(1.0 / gamma)),
-        sourceColour.a);
+    fragColour = vec4(gammaCorrect(sourceColour.rgb), sourceColour.a);
 }
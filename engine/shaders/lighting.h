@@ -23,11 +23,12 @@
 #define __LIGHTING_H
 
 #ifdef SHADOW
-    /** Shadow sampler. */
-    #if defined(SPOT_LIGHT)
-        layout(set = kLightResources, binding = kShadowMap) uniform sampler2DShadow shadowMap;
-    #elif defined(POINT_LIGHT)
-        layout(set = kLightResources, binding = kShadowMap) uniform samplerCubeShadow shadowMap;
+    /** Shadow map atlas sampler. */
+    layout(set = kLightResources, binding = kShadowMap) uniform sampler2DShadow shadowMap;
+
+    #ifdef DIRECTIONAL_LIGHT
+        /** Fraction of each cascade over which to blend into the next. */
+        const float kShadowCascadeBlend = 0.1;
     #endif
 #endif
 
@@ -40,99 +41,117 @@ struct LightingData {
     float shininess;                /**< Specular exponent. */
 };
 
+#ifdef SHADOW
+
+/** Get the shadow space transformation for a shadow view.
+ * @param index         Index of the shadow view.
+ * @return              Shadow space transformation. */
+mat4 getShadowSpace(int index) {
+    if (index == 0) {
+        return light.shadowSpace;
+    } else if (index == 1) {
+        return light.shadowSpace1;
+    } else if (index == 2) {
+        return light.shadowSpace2;
+    } else if (index == 3) {
+        return light.shadowSpace3;
+    } else if (index == 4) {
+        return light.shadowSpace4;
+    } else {
+        return light.shadowSpace5;
+    }
+}
+
+/** Sample the shadow map for a shadow view.
+ * @param data          Lighting calculation data.
+ * @param index         Index of the shadow view.
+ * @return              Shadow attenuation factor. */
+float sampleShadowMap(LightingData data, int index) {
+    /* Calculate shadow space coordinates (mapped to the view's tile in the
+     * atlas for texture lookup). */
+    vec4 shadowPos = getShadowSpace(index) * vec4(data.position, 1.0);
+
+    /* Calculate texture coordinate in X/Y and reference depth value (depth of
+     * this pixel from light point of view). */
+    vec3 uvDepth = shadowPos.xyz / shadowPos.w;
+
+    /* Apply bias. */
+    uvDepth.z += light.shadowBiasConstant;
+
+    /* 3x3 PCF. Point light faces are rendered with a border so that this does
+     * not sample outside of the face's tile. For other lights, the area that
+     * the view needs to cover is a sphere or cone inscribed in the tile,
+     * which keeps samples within it. */
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            vec3 p = vec3(
+                uvDepth.xy + (vec2(x, y) * texelSize),
+                uvDepth.z);
+
+            /* Sample the shadow map. Returns [0, 1] where 0 is fully
+             * shadowed and 1 is unshadowed. */
+            shadow += texture(shadowMap, p);
+        }
+    }
+
+    return shadow / 9.0;
+}
+
+#endif
+
 /** Calculate the shadow factor for the light.
  * @param data          Lighting calculation data.
  * @return              Shadow attenuation factor. */
 float calcShadow(LightingData data) {
     #ifdef SHADOW
         #if defined(SPOT_LIGHT)
-            /* Calculate shadow space coordinates (biased to [0, 1] range for
-             * texture lookup). */
-            vec4 shadowPos = light.shadowSpace * vec4(data.position, 1.0);
-
-            /* Calculate texture coordinate in X/Y and reference depth value
-             * (depth of this pixel from light point of view). */
-            vec3 uvDepth = shadowPos.xyz / shadowPos.w;
-
-            /* Apply bias. */
-            uvDepth.z += light.shadowBiasConstant;
-
-            /* 3x3 PCF. */
-            float shadow = 0.0;
-            vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-            for (int x = -1; x <= 1; x++) {
-                for (int y = -1; y <= 1; y++) {
-                    vec3 p = vec3(
-                        uvDepth.xy + (vec2(x, y) * texelSize),
-                        uvDepth.z);
-
-                    /* Sample the shadow map. Returns [0, 1] where 0 is fully
-                     * shadowed and 1 is unshadowed. */
-                    shadow += texture(shadowMap, p);
-                }
-            }
-
-            shadow /= 9.0;
-
-            return shadow;
+            return sampleShadowMap(data, 0);
         #elif defined(POINT_LIGHT)
-            /* Cube map face is selected by the highest magnitude component in
-             * the light to fragment vector. This component defines the depth
-             * of the pixel. Also choose the offset directions to use for PCF
-             * based on this (we want to vary the other 2 components). */
+            /* Each cube face is rendered as a separate view. The face is
+             * selected by the highest magnitude component in the light to
+             * fragment vector. Views are in the order +X, -X, +Y, -Y, +Z, -Z. */
             vec3 direction = data.position - light.position;
             vec3 absDirection = abs(direction);
 
-            float localDepth;
-            vec3 offsetA, offsetB;
-
+            int face;
             if (absDirection.x >= absDirection.y && absDirection.x >= absDirection.z) {
-                localDepth = absDirection.x;
-                offsetA = vec3(0.0, 1.0, 0.0);
-                offsetB = vec3(0.0, 0.0, 1.0);
-            } else if (absDirection.y >= absDirection.x && absDirection.y >= absDirection.z) {
-                localDepth = absDirection.y;
-                offsetA = vec3(1.0, 0.0, 0.0);
-                offsetB = vec3(0.0, 0.0, 1.0);
+                face = (direction.x >= 0.0) ? 0 : 1;
+            } else if (absDirection.y >= absDirection.z) {
+                face = (direction.y >= 0.0) ? 2 : 3;
             } else {
-                localDepth = absDirection.z;
-                offsetA = vec3(1.0, 0.0, 0.0);
-                offsetB = vec3(0.0, 1.0, 0.0);
+                face = (direction.z >= 0.0) ? 4 : 5;
             }
 
-            /* Convert this value to a depth value. */
-            float far = light.range;
-            float near = light.shadowZNear;
-            float depth = -(far / (near - far)) - ((far * near) / (far - near) / localDepth);
-
-            /* Determine the offsets to use for PCF (a single texel). Multiply
-             * by 2 since cube texture coordinates are remapped from the [-1, 1]
-             * range to [0, 1]. */
-            float texelSize = (1.0 / textureSize(shadowMap, 0).x);
-            offsetA = offsetA * texelSize * 2.0;
-            offsetB = offsetB * texelSize * 2.0;
-
-            /* Base texture coordinates, with depth comparison value in last
-             * component. Normalize the direction here so that the offset should
-             * correspond to a single texel. */
-            vec4 directionDepth = vec4(normalize(direction), depth + light.shadowBiasConstant);
-
-            /* 3x3 PCF. */
-            float shadow = 0.0;
-            for (int a = -1; a <= 1; a++) {
-                for (int b = -1; b <= 1; b++) {
-                    vec4 p = vec4(
-                        directionDepth.xyz + (offsetA * a) + (offsetB * b),
-                        directionDepth.w);
-
-                    /* Sample the shadow map. Returns [0, 1] where 0 is fully
-                     * shadowed and 1 is unshadowed. */
-                    shadow += texture(shadowMap, p);
+            return sampleShadowMap(data, face);
+        #elif defined(DIRECTIONAL_LIGHT)
+            /* Select the cascade based on view space depth. Pixels beyond the
+             * last cascade are unshadowed. */
+            float depth = -(view.view * vec4(data.position, 1.0)).z;
+            int lastCascade = light.shadowCascadeCount - 1;
+            if (depth > light.shadowCascadeSplits[lastCascade])
+                return 1.0;
+
+            int cascade = 0;
+            while (cascade < lastCascade && depth > light.shadowCascadeSplits[cascade])
+                cascade++;
+
+            float shadow = sampleShadowMap(data, cascade);
+
+            /* Blend into the next cascade towards the end of this one to hide
+             * the transition between resolutions. */
+            if (cascade < lastCascade) {
+                float cascadeStart = (cascade > 0) ? light.shadowCascadeSplits[cascade - 1] : 0.0;
+                float cascadeEnd = light.shadowCascadeSplits[cascade];
+                float blendStart = cascadeEnd - ((cascadeEnd - cascadeStart) * kShadowCascadeBlend);
+
+                if (depth > blendStart) {
+                    float factor = (depth - blendStart) / (cascadeEnd - blendStart);
+                    shadow = mix(shadow, sampleShadowMap(data, cascade + 1), factor);
                 }
             }
 
-            shadow /= 9.0;
-
             return shadow;
         #else
             return 1.0;
@@ -145,8 +164,9 @@ float calcShadow(LightingData data) {
 /** Calculate the Blinn-Phong lighting contribution for a light.
  * @param data          Lighting calculation data.
  * @param direction     Direction from the light to the fragment.
+ * @param radiance      Light colour multiplied by intensity.
  * @return              Calculated pixel colour. */
-vec3 calcLightBlinnPhong(LightingData data, vec3 direction) {
+vec3 calcLightBlinnPhong(LightingData data, vec3 direction, vec3 radiance) {
     vec3 toLight = -direction;
     vec3 toView = normalize(view.position - data.position);
 
@@ -155,13 +175,13 @@ vec3 calcLightBlinnPhong(LightingData data, vec3 direction) {
     float angle = max(dot(data.normal, toLight), 0.0);
 
     /* Calculate the diffuse contribution. */
-    vec3 colour = (data.diffuseColour * light.colour) * (light.intensity * angle);
+    vec3 colour = data.diffuseColour * radiance * angle;
 
     /* Do specular reflection using Blinn-Phong. Calculate the cosine of the
      * angle between the normal and the half vector. */
     vec3 halfVector = normalize(toLight + toView);
     float specularAngle = max(dot(data.normal, halfVector), 0.0);
-    colour += (data.specularColour * light.colour) * (light.intensity * pow(specularAngle, data.shininess));
+    colour += data.specularColour * radiance * pow(specularAngle, data.shininess);
 
     return colour;
 }
@@ -206,7 +226,7 @@ vec4 calcLight(LightingData data) {
         /* Apply shadows. */
         attenuation *= calcShadow(data);
 
-        return vec4(calcLightBlinnPhong(data, direction) * attenuation, 1.0);
+        return vec4(calcLightBlinnPhong(data, direction, light.colour * light.intensity) * attenuation, 1.0);
     #endif
 }
 
@@ -19,6 +19,8 @@
  * @brief               Lit vertex shader.
  */
 
+#include "entity.h"
+
 layout(location = kPositionSemantic) in vec3 attribPosition;
 layout(location = kNormalSemantic) in vec3 attribNormal;
 layout(location = kTexcoordSemantic) in vec2 attribTexcoord;
@@ -37,8 +39,10 @@ layout(location = 4) out vec3 vtxBitangent;
 #endif
 
 void main() {
-    vtxPosition = vec3(entity.transform * vec4(attribPosition, 1.0));
-    vtxNormal   = vec3(entity.transform * vec4(attribNormal, 0.0));
+    mat4 transform = entityTransform();
+
+    vtxPosition = vec3(transform * vec4(attribPosition, 1.0));
+    vtxNormal   = vec3(transform * vec4(attribNormal, 0.0));
     vtxTexcoord = attribTexcoord;
 
     #ifdef NORMALMAP
@@ -48,9 +52,9 @@ void main() {
          * directly from tangent space to world space in the fragment shader.
          * Bitangent is reconstructed from normal and tangent, handedness is
          * stored in W component of the attribute. */
-        vtxTangent   = vec3(entity.transform * vec4(tangent, 0.0));
+        vtxTangent   = vec3(transform * vec4(tangent, 0.0));
         vtxBitangent = cross(vtxNormal, vtxTangent) * attribTangent.w;
     #endif
 
-    gl_Position = view.viewProjection * entity.transform * vec4(attribPosition, 1.0);
+    gl_Position = view.viewProjection * transform * vec4(attribPosition, 1.0);
 }
@@ -19,8 +19,10 @@
  * @brief               Shadow map vertex shader.
  */
 
+#include "entity.h"
+
 layout(location = kPositionSemantic) in vec3 attribPosition;
 
 void main() {
-    gl_Position = view.viewProjection * entity.transform * vec4(attribPosition, 1.0);
+    gl_Position = view.viewProjection * entityTransform() * vec4(attribPosition, 1.0);
 }
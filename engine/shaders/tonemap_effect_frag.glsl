@@ -20,52 +20,11 @@
  */
 
 #include "post_effect.h"
+#include "tonemap.h"
 
 layout(location = 0) out vec4 fragColour;
 
-/** Simple Reinhard operator. */
-vec3 tonemapReinhard(vec3 x) {
-    return x / (x + 1.0);
-}
-
-vec3 tonemapUncharted2Internal(vec3 x) {
-    const float A = 0.15;
-    const float B = 0.50;
-    const float C = 0.10;
-    const float D = 0.20;
-    const float E = 0.02;
-    const float F = 0.30;
-
-    return ((x*(A*x+C*B)+D*E)/(x*(A*x+B)+D*F))-E/F;
-}
-
-/**
- * Uncharted 2 tonemapping operator.
- *
- * As detailed in the following:
- *  - https://www.slideshare.net/ozlael/hable-john-uncharted2-hdr-lighting
- *  - http://filmicworlds.com/blog/filmic-tonemapping-operators/
- */
-vec3 tonemapUncharted2(vec3 x) {
-    const float exposureBias = 2.0;
-    x *= exposureBias;
-
-    return tonemapUncharted2Internal(x) / tonemapUncharted2Internal(vec3(whitePoint));
-}
-
 void main() {
     vec4 sourceColour = sampleSourceTexture();
-
-    vec3 colour = sourceColour.rgb;
-    colour *= exposure;
-
-    #if 0
-        colour = tonemapReinhard(colour);
-    #endif
-
-    #if 1
-        colour = tonemapUncharted2(colour);
-    #endif
-
-    fragColour = vec4(colour, sourceColour.a);
+    fragColour = vec4(tonemap(sourceColour.rgb), sourceColour.a);
 }
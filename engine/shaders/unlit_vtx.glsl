@@ -19,6 +19,8 @@
  * @brief               Unlit vertex shader.
  */
 
+#include "entity.h"
+
 layout(location = kPositionSemantic) in vec3 attribPosition;
 layout(location = kTexcoordSemantic) in vec2 attribTexcoord;
 
@@ -27,5 +29,5 @@ layout(location = 0) out vec2 vtxTexcoord;
 void main() {
     vtxTexcoord = attribTexcoord;
 
-    gl_Position = view.viewProjection * entity.transform * vec4(attribPosition, 1.0);
+    gl_Position = view.viewProjection * entityTransform() * vec4(attribPosition, 1.0);
 }
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Mesh cooking tool.
+ *
+ * This tool converts a mesh source file to the cooked mesh format (see
+ * engine/mesh_format.h), using the same code as the engine's mesh loaders.
+ * Cooked meshes are loaded by the engine without any processing, either by
+ * CookedMeshLoader from a ".mesh" file, or by any other mesh loader if the
+ * source file is replaced with the cooked data.
+ *
+ * Meshes are optimised for vertex cache efficiency, overdraw and vertex fetch
+ * locality, and large submeshes are divided into clusters for culling, unless
+ * disabled with -n. The vertex cache statistics (ACMR and ATVR, see
+ * MeshBuilder::analyseVertexCache()) of the mesh before and after this are
+ * printed. Normals, tangents and texture coordinates are packed into compact
+ * formats unless disabled with -f, and positions can additionally be quantised
+ * with -q. Simplified levels of detail are generated for each submesh, the
+ * number of which can be changed with -l (0 disables).
+ */
+
+#include "core/filesystem.h"
+#include "core/log.h"
+
+#include "../../runtime/engine/src/loaders/mesh_builder.h"
+#include "../../runtime/engine/src/loaders/obj_parser.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Parse a mesh source file.
+ * @param path          Path to the source file.
+ * @param builder       Builder to add mesh data to.
+ * @return              Whether successful. */
+static bool parseMesh(const char *path, MeshBuilder &builder) {
+    std::unique_ptr<File> input(Filesystem::openFile(path));
+    if (!input) {
+        fprintf(stderr, "Failed to open '%s'\n", path);
+        return false;
+    }
+
+    uint64_t size = input->size();
+
+    const char *data = reinterpret_cast<const char *>(input->data());
+    std::unique_ptr<char[]> buffer;
+    if (!data && size) {
+        buffer.reset(new char[size]);
+        if (!input->read(buffer.get(), size)) {
+            fprintf(stderr, "Failed to read '%s'\n", path);
+            return false;
+        }
+
+        data = buffer.get();
+    }
+
+    std::string extension = Path(path).extension();
+    if (extension == "obj") {
+        OBJParser parser(builder, path);
+        return parser.parse(data, size);
+    } else {
+        fprintf(stderr, "Unsupported mesh format '%s'\n", extension.c_str());
+        return false;
+    }
+}
+
+/** Print usage information.
+ * @param argv0         Program name. */
+static void usage(const char *argv0) {
+    printf("Usage: %s [options...] <input> <output>\n", argv0);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -f            Store full precision vertex attributes\n");
+    printf("  -h            Display this help\n");
+    printf("  -l <count>    Number of levels of detail to generate (default: 3)\n");
+    printf("  -n            Do not optimise the mesh\n");
+    printf("  -q            Quantise vertex positions\n");
+    printf("  -t            Generate tangents\n");
+}
+
+/** Main function of the mesh cooking tool.
+ * @param argc          Argument count.
+ * @param argv          Argument array.
+ * @return              EXIT_SUCCESS or EXIT_FAILURE. */
+int main(int argc, char **argv) {
+    bool generateTangents = false;
+    bool optimise = true;
+    unsigned numLODs = 3;
+    uint32_t flags = MeshBuilder::kPackAttributes;
+
+    /* Parse arguments. */
+    int opt;
+    while ((opt = getopt(argc, argv, "fhl:nqt")) != -1) {
+        switch (opt) {
+            case 'f':
+                flags &= ~MeshBuilder::kPackAttributes;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            case 'l':
+                numLODs = strtoul(optarg, nullptr, 10);
+                break;
+            case 'n':
+                optimise = false;
+                break;
+            case 'q':
+                flags |= MeshBuilder::kQuantisePositions;
+                break;
+            case 't':
+                generateTangents = true;
+                break;
+            default:
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *inputPath  = argv[optind];
+    const char *outputPath = argv[optind + 1];
+
+    /* The shared mesh code reports errors through the log. */
+    g_logManager = new LogManager;
+
+    MeshBuilder builder(inputPath);
+    if (!parseMesh(inputPath, builder))
+        return EXIT_FAILURE;
+
+    if (generateTangents)
+        builder.calculateTangents();
+
+    /* Must be done before optimising so that the LODs are optimised too. */
+    if (numLODs)
+        builder.generateLODs(numLODs, 0.5f);
+
+    /* Clusters depend on the optimised triangle order so must be generated
+     * afterwards. */
+    if (optimise) {
+        MeshBuilder::VertexCacheStats before = builder.analyseVertexCache();
+
+        builder.optimise();
+        builder.generateClusters();
+
+        MeshBuilder::VertexCacheStats after = builder.analyseVertexCache();
+
+        printf("%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+               outputPath, before.acmr, after.acmr, before.atvr, after.atvr);
+    }
+
+    std::vector<uint8_t> output;
+    if (!builder.build(output, flags))
+        return EXIT_FAILURE;
+
+    std::unique_ptr<File> file(Filesystem::openFile(outputPath, File::kWrite | File::kCreate | File::kTruncate));
+    if (!file) {
+        fprintf(stderr, "%s: Failed to open '%s'\n", argv[0], outputPath);
+        return EXIT_FAILURE;
+    }
+
+    if (!file->write(output.data(), output.size())) {
+        fprintf(stderr, "%s: Failed to write '%s'\n", argv[0], outputPath);
+        file.reset();
+        remove(outputPath);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %zu bytes\n", outputPath, output.size());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief               Serialised object cooking.
+ *
+ * This converts serialised objects from the JSON format produced by
+ * JSONSerialiser to the binary format read by BinarySerialiser (see
+ * engine/binary_format.h). This is done directly on the JSON structure rather
+ * than by deserialising the objects, so that it does not require the engine.
+ *
+ * Since the JSON does not carry type information, values are converted based
+ * on their JSON type. BinarySerialiser converts between numeric types when
+ * reading, so the result deserialises identically. Arrays containing only
+ * floating point values are stored packed, which covers vectors. Groups
+ * containing only an "objectID" or an "asset" member are object references,
+ * and are stored as such.
+ */
+
+#include "core/hash_table.h"
+
+#include "engine/binary_format.h"
+
+#include "cook.h"
+
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+
+/** Class converting a JSON document to binary format. */
+class Cooker {
+public:
+    explicit Cooker(std::vector<uint8_t> &output) : m_output(output) {}
+
+    bool cook(const rapidjson::Document &document, std::string &error);
+private:
+    void put(const void *data, size_t size);
+    template <typename T> void put(const T &value) { put(&value, sizeof(value)); }
+    template <typename T> void patch(uint32_t offset, const T &value);
+    uint32_t addString(const char *str);
+
+    bool writeValue(const rapidjson::Value &value, std::string &error);
+    bool writeGroup(const rapidjson::Value &value, bool isObject, std::string &error);
+    bool writeArray(const rapidjson::Value &value, std::string &error);
+private:
+    std::vector<uint8_t> &m_output;     /**< Output data. */
+    std::string m_strings;              /**< String table. */
+
+    /** Map of strings to indices. */
+    HashMap<std::string, uint32_t> m_stringToIndexMap;
+};
+
+/** Append data to the output.
+ * @param data          Data to append.
+ * @param size          Size of the data. */
+void Cooker::put(const void *data, size_t size) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    m_output.insert(m_output.end(), bytes, bytes + size);
+}
+
+/** Overwrite a value previously written to the output.
+ * @param offset        Offset to write at.
+ * @param value         Value to write. */
+template <typename T>
+void Cooker::patch(uint32_t offset, const T &value) {
+    memcpy(&m_output[offset], &value, sizeof(value));
+}
+
+/** Get the index of a string, adding it to the string table if needed.
+ * @param str           String to add.
+ * @return              Index of the string. */
+uint32_t Cooker::addString(const char *str) {
+    auto ret = m_stringToIndexMap.insert(std::make_pair(str, m_stringToIndexMap.size()));
+    if (ret.second)
+        m_strings.append(str, strlen(str) + 1);
+
+    return ret.first->second;
+}
+
+/** Check whether a JSON value is exactly representable as a float.
+ * @param value         Value to check.
+ * @return              Whether the value is a float. */
+static bool isFloat(const rapidjson::Value &value) {
+    if (!value.IsDouble())
+        return false;
+
+    double d = value.GetDouble();
+    return static_cast<double>(static_cast<float>(d)) == d;
+}
+
+/** Write a value.
+ * @param value         Value to write.
+ * @param error         Where to store error message.
+ * @return              Whether successful. */
+bool Cooker::writeValue(const rapidjson::Value &value, std::string &error) {
+    if (value.IsBool()) {
+        put(kBinaryBool);
+        put(static_cast<uint8_t>(value.GetBool()));
+    } else if (value.IsInt()) {
+        put(kBinaryInt32);
+        put(static_cast<int32_t>(value.GetInt()));
+    } else if (value.IsUint()) {
+        put(kBinaryUint32);
+        put(static_cast<uint32_t>(value.GetUint()));
+    } else if (value.IsInt64()) {
+        put(kBinaryInt64);
+        put(static_cast<int64_t>(value.GetInt64()));
+    } else if (value.IsUint64()) {
+        put(kBinaryUint64);
+        put(static_cast<uint64_t>(value.GetUint64()));
+    } else if (isFloat(value)) {
+        put(kBinaryFloat);
+        put(static_cast<float>(value.GetDouble()));
+    } else if (value.IsDouble()) {
+        put(kBinaryDouble);
+        put(value.GetDouble());
+    } else if (value.IsString()) {
+        put(kBinaryString);
+        put(addString(value.GetString()));
+    } else if (value.IsArray()) {
+        return writeArray(value, error);
+    } else if (value.IsObject()) {
+        if (value.MemberCount() == 1 && value.HasMember("objectID") && value["objectID"].IsUint()) {
+            put(kBinaryObjectRef);
+            put(static_cast<uint32_t>(value["objectID"].GetUint()));
+        } else if (value.MemberCount() == 1 && value.HasMember("asset") && value["asset"].IsString()) {
+            put(kBinaryAssetRef);
+            put(addString(value["asset"].GetString()));
+        } else {
+            return writeGroup(value, false, error);
+        }
+    } else {
+        error = "Unsupported null value";
+        return false;
+    }
+
+    return true;
+}
+
+/** Write a group.
+ * @param value         Value to write.
+ * @param isObject      Whether this is an object's property group, in which
+ *                      case the object class and ID are not included.
+ * @param error         Where to store error message.
+ * @return              Whether successful. */
+bool Cooker::writeGroup(const rapidjson::Value &value, bool isObject, std::string &error) {
+    uint32_t offset = m_output.size();
+
+    put(kBinaryGroup);
+    put(static_cast<uint32_t>(0));
+    put(static_cast<uint32_t>(0));
+
+    std::vector<BinaryMember> members;
+    members.reserve(value.MemberCount());
+
+    for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it) {
+        const char *name = it->name.GetString();
+
+        if (isObject && (!strcmp(name, "objectClass") || !strcmp(name, "objectID")))
+            continue;
+
+        BinaryMember member;
+        member.name   = addString(name);
+        member.offset = m_output.size();
+        members.push_back(member);
+
+        if (!writeValue(it->value, error)) {
+            error = std::string(name) + ": " + error;
+            return false;
+        }
+    }
+
+    patch(offset + 1, static_cast<uint32_t>(members.size()));
+    patch(offset + 5, static_cast<uint32_t>(m_output.size()));
+    put(members.data(), members.size() * sizeof(BinaryMember));
+    return true;
+}
+
+/** Write an array.
+ * @param value         Value to write.
+ * @param error         Where to store error message.
+ * @return              Whether successful. */
+bool Cooker::writeArray(const rapidjson::Value &value, std::string &error) {
+    bool allFloats = !value.Empty();
+    for (auto it = value.Begin(); it != value.End() && allFloats; ++it)
+        allFloats = isFloat(*it);
+
+    /* Store arrays of floats (e.g. vectors) packed. */
+    if (allFloats) {
+        put(kBinaryFloatArray);
+        put(static_cast<uint32_t>(value.Size()));
+
+        for (auto it = value.Begin(); it != value.End(); ++it)
+            put(static_cast<float>(it->GetDouble()));
+
+        return true;
+    }
+
+    uint32_t offset = m_output.size();
+
+    put(kBinaryArray);
+    put(static_cast<uint32_t>(value.Size()));
+    put(static_cast<uint32_t>(0));
+
+    std::vector<uint32_t> elements;
+    elements.reserve(value.Size());
+
+    for (auto it = value.Begin(); it != value.End(); ++it) {
+        elements.push_back(m_output.size());
+
+        if (!writeValue(*it, error))
+            return false;
+    }
+
+    patch(offset + 5, static_cast<uint32_t>(m_output.size()));
+    put(elements.data(), elements.size() * sizeof(uint32_t));
+    return true;
+}
+
+/** Convert a JSON document to binary format.
+ * @param document      Document to convert.
+ * @param error         Where to store error message.
+ * @return              Whether successful. */
+bool Cooker::cook(const rapidjson::Document &document, std::string &error) {
+    if (!document.IsArray() || document.Empty()) {
+        error = "Document is not an array of objects";
+        return false;
+    }
+
+    m_output.resize(sizeof(BinaryHeader));
+
+    std::vector<BinaryObject> objects;
+    objects.reserve(document.Size());
+
+    for (auto it = document.Begin(); it != document.End(); ++it) {
+        const rapidjson::Value &value = *it;
+
+        if (!value.IsObject() || !value.HasMember("objectClass") || !value["objectClass"].IsString()) {
+            error = "Object " + std::to_string(objects.size()) + " does not have an 'objectClass' value";
+            return false;
+        }
+
+        BinaryObject object;
+        object.className = addString(value["objectClass"].GetString());
+        object.offset    = m_output.size();
+        objects.push_back(object);
+
+        if (!writeGroup(value, true, error)) {
+            error = "Object " + std::to_string(objects.size() - 1) + ": " + error;
+            return false;
+        }
+    }
+
+    BinaryHeader header;
+    memcpy(header.magic, kBinaryMagic, sizeof(header.magic));
+    header.version       = kBinaryVersion;
+    header.numObjects    = objects.size();
+    header.objectsOffset = m_output.size();
+    put(objects.data(), objects.size() * sizeof(BinaryObject));
+    header.numStrings    = m_stringToIndexMap.size();
+    header.stringsOffset = m_output.size();
+    header.stringsSize   = m_strings.size();
+    put(m_strings.data(), m_strings.size());
+    patch(0, header);
+
+    return true;
+}
+
+/**
+ * Cook a serialised object.
+ *
+ * Converts a serialised object in JSON format to the binary format. Data that
+ * is already in binary format is copied unchanged.
+ *
+ * @param data          Serialised object data.
+ * @param size          Size of the data.
+ * @param output        Where to store cooked data.
+ * @param error         Where to store error message on failure.
+ *
+ * @return              Whether successful.
+ */
+bool cookObject(const void *data, size_t size, std::vector<uint8_t> &output, std::string &error) {
+    output.clear();
+
+    if (isBinarySerialised(data, size)) {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+        output.assign(bytes, bytes + size);
+        return true;
+    }
+
+    rapidjson::Document document;
+    document.Parse(reinterpret_cast<const char *>(data), size);
+    if (document.HasParseError()) {
+        error = std::string("Parse error (at ") + std::to_string(document.GetErrorOffset()) + "): " +
+                rapidjson::GetParseError_En(document.GetParseError());
+        return false;
+    }
+
+    Cooker cooker(output);
+    return cooker.cook(document, error);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Asset index generation.
+ *
+ * This generates an asset index (see engine/asset_index.h) for an asset
+ * directory being added to a package, so that the engine does not need to
+ * scan the package's directory tree to build its index at startup. The rules
+ * for which files make up each asset must match AssetIndex::scanDirectory().
+ */
+
+#include "core/path.h"
+
+#include "index.h"
+
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <map>
+
+#include <stdio.h>
+
+/** Name of the index file in the root of an asset directory. */
+static const char *const kIndexFileName = "asset_index.json";
+
+/** Special file extension for loaders. */
+static const char *const kLoaderFileExtension = "loader";
+
+/** Files making up an asset. */
+struct IndexEntry {
+    std::string data;                   /**< Path to the data file. */
+    std::string loader;                 /**< Path to the loader file. */
+    bool multipleData;                  /**< Whether multiple data files were found. */
+public:
+    IndexEntry() : multipleData(false) {}
+};
+
+/**
+ * Build an asset index.
+ *
+ * Builds an index of the assets made up by a set of files within an asset
+ * directory. Assets with multiple data files are left out of the index, so
+ * that the engine falls back to scanning their directory and reports the
+ * error when they are loaded.
+ *
+ * @param root          Root directory of the assets, as a package path.
+ * @param paths         Package paths of the files within the root directory.
+ *
+ * @return              Serialised index, to be stored at kIndexFileName
+ *                      within the root directory.
+ */
+std::vector<uint8_t> buildAssetIndex(const std::string &root, const std::vector<std::string> &paths) {
+    std::map<std::string, IndexEntry> entries;
+
+    for (const std::string &path : paths) {
+        Path relative(path.substr(root.size() + 1));
+
+        std::string extension = relative.extension();
+        if (extension.empty() || relative.str() == kIndexFileName)
+            continue;
+
+        std::string assetPath = (relative.directoryName() / relative.baseFileName()).str();
+        IndexEntry &entry = entries[assetPath];
+
+        if (extension == kLoaderFileExtension) {
+            entry.loader = relative.str();
+        } else {
+            if (!entry.data.empty()) {
+                fprintf(stderr, "Warning: Asset '%s/%s' has multiple data files, not indexing\n",
+                        root.c_str(), assetPath.c_str());
+                entry.multipleData = true;
+            }
+
+            entry.data = relative.str();
+        }
+    }
+
+    rapidjson::Document document;
+    document.SetObject();
+
+    for (const auto &it : entries) {
+        if (it.second.multipleData)
+            continue;
+
+        rapidjson::Value value(rapidjson::kObjectType);
+
+        if (!it.second.data.empty())
+            value.AddMember("data", rapidjson::StringRef(it.second.data.c_str()), document.GetAllocator());
+        if (!it.second.loader.empty())
+            value.AddMember("loader", rapidjson::StringRef(it.second.loader.c_str()), document.GetAllocator());
+
+        document.AddMember(rapidjson::StringRef(it.first.c_str()), value, document.GetAllocator());
+    }
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    document.Accept(writer);
+
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(buffer.GetString());
+    return std::vector<uint8_t>(data, data + buffer.GetSize());
+}
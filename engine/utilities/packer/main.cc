@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Package file builder.
+ *
+ * This tool builds a package file (see core/package.h) from a set of files
+ * and directories. Paths are stored in the package as they are given on the
+ * command line, so it should be run from the engine base directory.
+ *
+ * Serialised objects and loaders are cooked into the binary serialisation
+ * format as they are added, unless disabled with -r.
+ *
+ * For each directory given, an asset index is generated and added to the
+ * package in the root of that directory, so that the engine can use it rather
+ * than scanning the directory tree when the package is mounted.
+ */
+
+#include "core/filesystem.h"
+#include "core/lz4.h"
+#include "core/package.h"
+
+#include "cook.h"
+#include "index.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** File to be added to the package. */
+struct InputFile {
+    std::string path;                   /**< Path to the file. */
+    PackageEntry entry;                 /**< Entry for the file. */
+    bool generated;                     /**< Whether the file is generated. */
+    std::vector<uint8_t> data;          /**< Generated file data. */
+public:
+    InputFile() : generated(false) {}
+};
+
+/** Name of the asset index file generated for directories. */
+static const char *const kIndexFileName = "asset_index.json";
+
+/** Collect files to add to the package.
+ * @param path          Path to file or directory to add.
+ * @param outFiles      Array to add files to.
+ * @return              Whether the path was valid. */
+static bool collectFiles(const Path &path, std::vector<InputFile> &outFiles) {
+    if (Filesystem::isType(path, FileType::kDirectory)) {
+        std::unique_ptr<Directory> directory(Filesystem::openDirectory(path));
+        if (!directory) {
+            fprintf(stderr, "Failed to open directory '%s'\n", path.c_str());
+            return false;
+        }
+
+        Directory::Entry entry;
+        while (directory->next(entry)) {
+            if (entry.type == FileType::kOther)
+                continue;
+
+            if (!collectFiles(path / entry.name, outFiles))
+                return false;
+        }
+    } else if (Filesystem::isType(path, FileType::kFile)) {
+        /* Don't include other packages, or stale asset indices (these are
+         * regenerated). */
+        if (path.extension() == "pkg" || path.fileName().str() == kIndexFileName)
+            return true;
+
+        outFiles.emplace_back();
+        outFiles.back().path = path.str();
+    } else {
+        fprintf(stderr, "Path '%s' does not exist\n", path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+/** Write padding to align the output offset.
+ * @param output        Output file.
+ * @param alignment     Alignment to pad to.
+ * @return              Whether successful. */
+static bool writePadding(File *output, uint64_t alignment) {
+    static const uint8_t zeros[256] = {};
+
+    uint64_t offset = output->offset();
+    uint64_t padding = Math::roundUp(offset, alignment) - offset;
+    while (padding) {
+        size_t size = std::min(padding, static_cast<uint64_t>(sizeof(zeros)));
+        if (!output->write(zeros, size))
+            return false;
+
+        padding -= size;
+    }
+
+    return true;
+}
+
+/** Add a file's data to the package.
+ * @param output        Output file.
+ * @param file          File to add.
+ * @param alignment     Alignment of data.
+ * @param compress      Whether to try to compress the data.
+ * @param cook          Whether to cook serialised objects.
+ * @return              Whether successful. */
+static bool writeFile(File *output, InputFile &file, uint32_t alignment, bool compress, bool cook) {
+    std::unique_ptr<File> input;
+    std::unique_ptr<uint8_t[]> buffer;
+    const void *data;
+    uint64_t size;
+
+    if (file.generated) {
+        data = file.data.data();
+        size = file.data.size();
+    } else {
+        input.reset(Filesystem::openFile(file.path));
+        if (!input) {
+            fprintf(stderr, "Failed to open '%s'\n", file.path.c_str());
+            return false;
+        }
+
+        size = input->size();
+
+        data = input->data();
+        if (!data && size) {
+            buffer.reset(new uint8_t[size]);
+            if (!input->read(buffer.get(), size)) {
+                fprintf(stderr, "Failed to read '%s'\n", file.path.c_str());
+                return false;
+            }
+
+            data = buffer.get();
+        }
+    }
+
+    /* Convert serialised objects to binary format. */
+    std::vector<uint8_t> cooked;
+    std::string extension = Path(file.path).extension();
+    if (cook && (extension == "object" || extension == "loader")) {
+        std::string error;
+        if (!cookObject(data, size, cooked, error)) {
+            fprintf(stderr, "Failed to cook '%s': %s\n", file.path.c_str(), error.c_str());
+            return false;
+        }
+
+        data = cooked.data();
+        size = cooked.size();
+    }
+
+    file.entry.size        = size;
+    file.entry.storedSize  = size;
+    file.entry.compression = kPackageCompressionNone;
+
+    /* Only keep compressed data if it is a worthwhile reduction in size. Data
+     * which is compressed cannot be accessed in place from the package. */
+    std::unique_ptr<uint8_t[]> compressed;
+    if (compress && size) {
+        size_t bound = LZ4::compressBound(size);
+        compressed.reset(new uint8_t[bound]);
+
+        size_t compressedSize = LZ4::compress(data, size, compressed.get(), bound);
+        if (compressedSize && compressedSize < size - (size / 8)) {
+            data = compressed.get();
+            file.entry.storedSize  = compressedSize;
+            file.entry.compression = kPackageCompressionLZ4;
+        }
+    }
+
+    if (!writePadding(output, alignment))
+        return false;
+
+    file.entry.offset = output->offset();
+
+    if (file.entry.storedSize && !output->write(data, file.entry.storedSize))
+        return false;
+
+    return true;
+}
+
+/** Print usage information.
+ * @param argv0         Program name. */
+static void usage(const char *argv0) {
+    printf("Usage: %s [options...] <output> <path>...\n", argv0);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -h            Display this help\n");
+    printf("  -a <align>    Alignment of file data (default %u)\n", kPackageDefaultAlignment);
+    printf("  -c            Compress file data where it reduces size\n");
+    printf("  -r            Store serialised objects raw rather than cooking them\n");
+    printf("  -v            Print files as they are added\n");
+}
+
+/** Main function of the package builder.
+ * @param argc          Argument count.
+ * @param argv          Argument array.
+ * @return              EXIT_SUCCESS or EXIT_FAILURE. */
+int main(int argc, char **argv) {
+    uint32_t alignment = kPackageDefaultAlignment;
+    bool compress = false;
+    bool cook = true;
+    bool verbose = false;
+
+    /* Parse arguments. */
+    int opt;
+    while ((opt = getopt(argc, argv, "ha:crv")) != -1) {
+        switch (opt) {
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            case 'a':
+                alignment = strtoul(optarg, nullptr, 0);
+                if (!Math::isPow2(alignment)) {
+                    fprintf(stderr, "%s: Alignment must be a power of 2\n", argv[0]);
+                    return EXIT_FAILURE;
+                }
+
+                break;
+            case 'c':
+                compress = true;
+                break;
+            case 'r':
+                cook = false;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - optind < 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *outputPath = argv[optind];
+
+    /* Collect the files to add. Sort them so that the output is deterministic
+     * and files in the same directory are kept together. */
+    std::vector<InputFile> files;
+    for (int i = optind + 1; i < argc; i++) {
+        Path path(argv[i]);
+
+        size_t start = files.size();
+        if (!collectFiles(path, files))
+            return EXIT_FAILURE;
+
+        /* Generate an asset index for directories. */
+        if (Filesystem::isType(path, FileType::kDirectory)) {
+            std::vector<std::string> paths;
+            for (size_t j = start; j < files.size(); j++)
+                paths.emplace_back(files[j].path);
+
+            InputFile index;
+            index.path      = (path / kIndexFileName).str();
+            index.generated = true;
+            index.data      = buildAssetIndex(path.str(), paths);
+            files.emplace_back(std::move(index));
+        }
+    }
+
+    std::sort(files.begin(), files.end(),
+              [] (const InputFile &a, const InputFile &b) { return a.path < b.path; });
+
+    std::unique_ptr<File> output(Filesystem::openFile(outputPath, File::kWrite | File::kCreate | File::kTruncate));
+    if (!output) {
+        fprintf(stderr, "%s: Failed to open '%s'\n", argv[0], outputPath);
+        return EXIT_FAILURE;
+    }
+
+    /* Remove the output if we fail. */
+    auto guard = makeScopeGuard(
+        [&] () {
+            output.reset();
+            remove(outputPath);
+        });
+
+    /* Header is written once everything else is known. */
+    PackageHeader header;
+    memset(&header, 0, sizeof(header));
+    if (!output->write(&header, sizeof(header)))
+        return EXIT_FAILURE;
+
+    /* Write file data and build the string table. */
+    std::string strings;
+    uint64_t totalSize = 0;
+    uint64_t totalStoredSize = 0;
+    for (InputFile &file : files) {
+        if (!writeFile(output.get(), file, alignment, compress, cook)) {
+            fprintf(stderr, "%s: Failed to add '%s'\n", argv[0], file.path.c_str());
+            return EXIT_FAILURE;
+        }
+
+        file.entry.pathOffset = strings.size();
+        strings.append(file.path);
+        strings.push_back(0);
+
+        totalSize += file.entry.size;
+        totalStoredSize += file.entry.storedSize;
+
+        if (verbose) {
+            printf("%s: %llu -> %llu bytes\n",
+                   file.path.c_str(),
+                   static_cast<unsigned long long>(file.entry.size),
+                   static_cast<unsigned long long>(file.entry.storedSize));
+        }
+    }
+
+    /* Write the entry array and string table. */
+    if (!writePadding(output.get(), alignof(PackageEntry)))
+        return EXIT_FAILURE;
+
+    header.entriesOffset = output->offset();
+    for (const InputFile &file : files) {
+        if (!output->write(&file.entry, sizeof(file.entry)))
+            return EXIT_FAILURE;
+    }
+
+    header.stringsOffset = output->offset();
+    header.stringsSize   = strings.size();
+    if (!output->write(strings.data(), strings.size()))
+        return EXIT_FAILURE;
+
+    memcpy(header.magic, kPackageMagic, sizeof(header.magic));
+    header.version    = kPackageVersion;
+    header.numEntries = files.size();
+    header.alignment  = alignment;
+
+    if (!output->write(&header, sizeof(header), 0))
+        return EXIT_FAILURE;
+
+    guard.cancel();
+
+    printf("%s: %zu files, %llu bytes (%llu stored)\n",
+           outputPath,
+           files.size(),
+           static_cast<unsigned long long>(totalSize),
+           static_cast<unsigned long long>(totalStoredSize));
+
+    return EXIT_SUCCESS;
+}
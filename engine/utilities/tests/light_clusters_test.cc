@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Light cluster tests.
+ *
+ * Binning is checked in two ways: point lights are compared against a brute
+ * force test of every cluster in the grid, and both point and spot lights are
+ * checked by sampling points within the light volume and making sure that the
+ * light is in the cluster that the lighting shader would look up for each
+ * point.
+ */
+
+#include "test.h"
+
+#include "render/light_clusters.h"
+
+#include <algorithm>
+#include <random>
+
+/** Parameters of the view used for tests. */
+static const float kFOV    = 75.0f;
+static const float kAspect = 16.0f / 9.0f;
+static const float kZNear  = 0.1f;
+static const float kZFar   = 500.0f;
+
+/** Test view. */
+struct TestView {
+    glm::mat4 view;                     /**< View matrix. */
+    glm::mat4 projection;               /**< Projection matrix. */
+
+    TestView() :
+        view       (glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.3f, 1.5f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f))),
+        projection (glm::perspective(glm::radians(kFOV), kAspect, kZNear, kZFar))
+    {}
+};
+
+/** Generate a random light in front of the test view.
+ * @param spot          Whether to generate a spot light.
+ * @param random        Random number generator.
+ * @return              Generated light. */
+static LightClusters::LightDesc generateLight(bool spot, std::mt19937 &random) {
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> range(0.5f, 20.0f);
+    std::uniform_real_distribution<float> cutoff(5.0f, 45.0f);
+
+    LightClusters::LightDesc desc;
+    desc.spot                = spot;
+    desc.position            = glm::vec3(unit(random) * 40.0f, unit(random) * 10.0f, (unit(random) * 50.0f) - 45.0f);
+    desc.direction           = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 0.01f));
+    desc.colour              = glm::vec3(1.0f);
+    desc.range               = range(random);
+    desc.cutoff              = (spot) ? cutoff(random) : 0.0f;
+    desc.attenuationConstant = 1.0f;
+    desc.attenuationLinear   = 0.0f;
+    desc.attenuationExp      = 0.0f;
+    return desc;
+}
+
+/** Get the lights in a cluster.
+ * @param clusters      Built clusters.
+ * @param cluster       Index of the cluster.
+ * @return              Indices of the lights in the cluster. */
+static std::vector<uint32_t> getClusterLights(const LightClusters &clusters, uint32_t cluster) {
+    const LightClusters::Cluster &entry = clusters.grid()[cluster];
+
+    std::vector<uint32_t> lights;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(entry.count); i++)
+        lights.push_back(static_cast<uint32_t>(clusters.indices()[static_cast<uint32_t>(entry.offset) + i]));
+
+    return lights;
+}
+
+/**
+ * Get the cluster containing a point.
+ *
+ * Gets the cluster containing a view space point in the same way as the
+ * clustered lighting shader, from the point's normalised device coordinates
+ * and log depth.
+ *
+ * @param clusters      Built clusters.
+ * @param projection    Projection matrix.
+ * @param point         View space point.
+ * @param outCluster    Where to store the cluster index.
+ *
+ * @return              Whether the point is inside the view.
+ */
+static bool getPointCluster(const LightClusters &clusters,
+                            const glm::mat4 &projection,
+                            const glm::vec3 &point,
+                            uint32_t &outCluster)
+{
+    float depth = -point.z;
+    if (depth <= kZNear || depth >= kZFar)
+        return false;
+
+    glm::vec4 clip = projection * glm::vec4(point, 1.0f);
+    glm::vec2 ndc = glm::vec2(clip) / clip.w;
+    if (std::abs(ndc.x) >= 1.0f || std::abs(ndc.y) >= 1.0f)
+        return false;
+
+    int32_t x = static_cast<int32_t>((ndc.x + 1.0f) * 0.5f * LightClusters::kGridWidth);
+    int32_t y = static_cast<int32_t>((ndc.y + 1.0f) * 0.5f * LightClusters::kGridHeight);
+    int32_t z = static_cast<int32_t>((logf(depth) * clusters.depthParameters().x) + clusters.depthParameters().y);
+
+    x = glm::clamp(x, 0, static_cast<int32_t>(LightClusters::kGridWidth - 1));
+    y = glm::clamp(y, 0, static_cast<int32_t>(LightClusters::kGridHeight - 1));
+    z = glm::clamp(z, 0, static_cast<int32_t>(LightClusters::kGridDepth - 1));
+
+    outCluster = (((z * LightClusters::kGridHeight) + y) * LightClusters::kGridWidth) + x;
+    return true;
+}
+
+/** Check the layout of the index list of built clusters.
+ * @param clusters      Built clusters. */
+static void checkIndexLayout(const LightClusters &clusters) {
+    uint32_t nextOffset = 0;
+
+    for (uint32_t cluster = 0; cluster < LightClusters::kNumClusters; cluster++) {
+        const LightClusters::Cluster &entry = clusters.grid()[cluster];
+
+        expect(static_cast<uint32_t>(entry.offset) == nextOffset);
+        nextOffset += static_cast<uint32_t>(entry.count);
+
+        /* Lights in each cluster are in the order that they were added. */
+        std::vector<uint32_t> lights = getClusterLights(clusters, cluster);
+        expect(std::is_sorted(lights.begin(), lights.end()));
+        expect(std::adjacent_find(lights.begin(), lights.end()) == lights.end());
+
+        for (uint32_t light : lights)
+            expect(light < clusters.numLights());
+    }
+
+    expect(nextOffset == clusters.numIndices());
+    expect(clusters.numIndices() <= LightClusters::kMaxIndices);
+}
+
+TEST(LightClustersPointBruteForce) {
+    static const unsigned kNumLights = 64;
+
+    TestView view;
+    std::mt19937 random(1);
+
+    LightClusters clusters;
+    std::vector<LightClusters::LightDesc> lights;
+    for (unsigned i = 0; i < kNumLights; i++) {
+        lights.push_back(generateLight(false, random));
+        expect(clusters.add(lights.back()));
+    }
+
+    clusters.build(view.view, view.projection, kZNear, kZFar);
+    checkIndexLayout(clusters);
+
+    /* Test every light against every cluster. A cluster is a frustum shaped
+     * cell: lights which contain a point of the cell (its corners and centre,
+     * pulled slightly inwards to allow for rounding) must be binned in it, and
+     * lights which miss the cell's bounding box must not be. */
+    const float logRange = logf(kZFar / kZNear);
+
+    size_t numRequired = 0;
+    for (uint32_t z = 0; z < LightClusters::kGridDepth; z++) {
+        const float near = kZNear * expf(logRange * z / LightClusters::kGridDepth);
+        const float far  = kZNear * expf(logRange * (z + 1) / LightClusters::kGridDepth);
+
+        for (uint32_t y = 0; y < LightClusters::kGridHeight; y++) {
+            const float minY = ((2.0f * y / LightClusters::kGridHeight) - 1.0f) / view.projection[1][1];
+            const float maxY = ((2.0f * (y + 1) / LightClusters::kGridHeight) - 1.0f) / view.projection[1][1];
+
+            for (uint32_t x = 0; x < LightClusters::kGridWidth; x++) {
+                const float minX = ((2.0f * x / LightClusters::kGridWidth) - 1.0f) / view.projection[0][0];
+                const float maxX = ((2.0f * (x + 1) / LightClusters::kGridWidth) - 1.0f) / view.projection[0][0];
+
+                glm::vec3 min(std::min(minX * near, minX * far), std::min(minY * near, minY * far), -far);
+                glm::vec3 max(std::max(maxX * near, maxX * far), std::max(maxY * near, maxY * far), -near);
+
+                const float midDepth = (near + far) * 0.5f;
+                const glm::vec3 cellCentre(((minX + maxX) * 0.5f) * midDepth, ((minY + maxY) * 0.5f) * midDepth, -midDepth);
+
+                glm::vec3 cellPoints[9];
+                cellPoints[8] = cellCentre;
+                for (uint32_t corner = 0; corner < 8; corner++) {
+                    const float depth = (corner & 4) ? far : near;
+                    glm::vec3 point(((corner & 1) ? maxX : minX) * depth, ((corner & 2) ? maxY : minY) * depth, -depth);
+                    cellPoints[corner] = glm::mix(point, cellCentre, 0.001f);
+                }
+
+                uint32_t cluster = (((z * LightClusters::kGridHeight) + y) * LightClusters::kGridWidth) + x;
+                std::vector<uint32_t> binned = getClusterLights(clusters, cluster);
+
+                for (uint32_t i = 0; i < lights.size(); i++) {
+                    glm::vec3 centre = glm::vec3(view.view * glm::vec4(lights[i].position, 1.0f));
+                    bool isBinned = std::find(binned.begin(), binned.end(), i) != binned.end();
+
+                    bool required = false;
+                    for (const glm::vec3 &point : cellPoints)
+                        required |= glm::distance(point, centre) < lights[i].range * 0.999f;
+
+                    if (required) {
+                        numRequired++;
+                        expectMsg(isBinned, "Light %u missing from cluster (%u, %u, %u)", i, x, y, z);
+                    }
+
+                    float boxDistance = glm::distance(glm::clamp(centre, min, max), centre);
+                    if (boxDistance > lights[i].range * 1.001f)
+                        expectMsg(!isBinned, "Light %u incorrectly in cluster (%u, %u, %u)", i, x, y, z);
+                }
+            }
+        }
+    }
+
+    printf("  %u lights, %u indices (%zu required)\n", clusters.numLights(), clusters.numIndices(), numRequired);
+
+    expect(numRequired > 0);
+}
+
+TEST(LightClustersSampled) {
+    static const unsigned kNumLights  = 128;
+    static const unsigned kNumSamples = 2000;
+
+    TestView view;
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    LightClusters clusters;
+    std::vector<LightClusters::LightDesc> lights;
+    for (unsigned i = 0; i < kNumLights; i++) {
+        lights.push_back(generateLight((i % 2) != 0, random));
+        expect(clusters.add(lights.back()));
+    }
+
+    clusters.build(view.view, view.projection, kZNear, kZFar);
+    checkIndexLayout(clusters);
+
+    size_t numSamples = 0;
+    size_t spotClusters = 0, spotBoundsClusters = 0;
+
+    for (uint32_t i = 0; i < lights.size(); i++) {
+        const LightClusters::LightDesc &light = lights[i];
+        const float cosCutoff = cosf(glm::radians(light.cutoff) * 0.99f);
+
+        std::vector<bool> sampledClusters(LightClusters::kNumClusters, false);
+
+        /* Sample points within the light volume, slightly inside its edges so
+         * that rounding in the cluster bounds does not matter. */
+        for (unsigned sample = 0; sample < kNumSamples; sample++) {
+            glm::vec3 offset(unit(random), unit(random), unit(random));
+            if (glm::length(offset) > 0.99f)
+                continue;
+
+            offset *= light.range;
+            if (light.spot && glm::dot(glm::normalize(offset), light.direction) < cosCutoff)
+                continue;
+
+            glm::vec3 point = glm::vec3(view.view * glm::vec4(light.position + offset, 1.0f));
+
+            uint32_t cluster;
+            if (!getPointCluster(clusters, view.projection, point, cluster))
+                continue;
+
+            numSamples++;
+            sampledClusters[cluster] = true;
+
+            std::vector<uint32_t> binned = getClusterLights(clusters, cluster);
+            expectMsg(std::find(binned.begin(), binned.end(), i) != binned.end(),
+                      "Light %u (%s) missing from cluster %u containing a lit point",
+                      i, (light.spot) ? "spot" : "point", cluster);
+        }
+
+        if (light.spot) {
+            for (uint32_t cluster = 0; cluster < LightClusters::kNumClusters; cluster++) {
+                std::vector<uint32_t> binned = getClusterLights(clusters, cluster);
+                if (std::find(binned.begin(), binned.end(), i) != binned.end())
+                    spotClusters++;
+            }
+        }
+    }
+
+    /* Bin the spot lights again as point lights covering their bounding
+     * spheres, to check that the cone test actually reduces the clusters that
+     * spot lights are assigned to. */
+    LightClusters boundsClusters;
+    for (const LightClusters::LightDesc &light : lights) {
+        if (!light.spot)
+            continue;
+
+        float radius = light.range / (2.0f * cosf(glm::radians(light.cutoff)));
+
+        LightClusters::LightDesc bounds = light;
+        bounds.spot     = false;
+        bounds.position = light.position + (light.direction * radius);
+        bounds.range    = radius;
+        boundsClusters.add(bounds);
+    }
+
+    boundsClusters.build(view.view, view.projection, kZNear, kZFar);
+    spotBoundsClusters = boundsClusters.numIndices();
+
+    printf("  %zu samples checked, spot lights in %zu clusters (%zu for bounding spheres)\n",
+           numSamples, spotClusters, spotBoundsClusters);
+
+    expect(numSamples > 0);
+    expect(spotClusters < spotBoundsClusters);
+}
+
+TEST(LightClustersOutsideView) {
+    TestView view;
+    LightClusters clusters;
+
+    /* Behind the camera. */
+    LightClusters::LightDesc behind = {};
+    behind.spot     = false;
+    behind.position = glm::vec3(0.0f, 2.0f, 10.0f);
+    behind.range    = 5.0f;
+    behind.cutoff   = 0.0f;
+    clusters.add(behind);
+
+    /* Beyond the far plane. */
+    LightClusters::LightDesc far = behind;
+    far.position = glm::vec3(0.0f, 2.0f, -kZFar - 10.0f);
+    clusters.add(far);
+
+    /* Spot light in front of the camera pointing away from the view. */
+    LightClusters::LightDesc spot = behind;
+    spot.spot      = true;
+    spot.position  = glm::vec3(0.0f, 2.0f, 0.5f);
+    spot.direction = glm::vec3(0.0f, 0.0f, 1.0f);
+    spot.cutoff    = 30.0f;
+    clusters.add(spot);
+
+    clusters.build(view.view, view.projection, kZNear, kZFar);
+
+    expect(clusters.numLights() == 3);
+    expect(clusters.numIndices() == 0);
+    checkIndexLayout(clusters);
+}
+
+TEST(LightClustersLimits) {
+    TestView view;
+    LightClusters clusters;
+
+    /* Lights covering the whole view overflow the index list. */
+    LightClusters::LightDesc light = {};
+    light.spot     = false;
+    light.position = glm::vec3(0.0f, 2.0f, 0.0f);
+    light.range    = kZFar * 2.0f;
+    light.cutoff   = 0.0f;
+
+    for (uint32_t i = 0; i < LightClusters::kMaxLights; i++)
+        expect(clusters.add(light));
+
+    expect(!clusters.add(light));
+    expect(clusters.numLights() == LightClusters::kMaxLights);
+
+    clusters.build(view.view, view.projection, kZNear, kZFar);
+
+    expect(clusters.numIndices() == LightClusters::kMaxIndices);
+    checkIndexLayout(clusters);
+}
+
+BENCHMARK(LightClustersBuild) {
+    TestView view;
+    std::mt19937 random(3);
+
+    for (uint32_t numLights : { 128u, LightClusters::kMaxLights }) {
+        std::vector<LightClusters::LightDesc> lights;
+        for (uint32_t i = 0; i < numLights; i++)
+            lights.push_back(generateLight((i % 2) != 0, random));
+
+        benchmarkLoop(
+            (numLights == 128) ? "LightClusters::build (128 lights)" : "LightClusters::build (1024 lights)",
+            [&] () {
+                LightClusters clusters;
+                for (const LightClusters::LightDesc &light : lights)
+                    clusters.add(light);
+
+                clusters.build(view.view, view.projection, kZNear, kZFar);
+            });
+    }
+}
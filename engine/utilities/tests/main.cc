@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Engine test program.
+ *
+ * This program runs tests of the parts of the engine which can be exercised
+ * without a GPU or window, and optionally benchmarks of them. Tests are run by
+ * default, and benchmarks are run instead with -b. Either can be limited to
+ * those whose names contain a string given as an argument.
+ *
+ * Run "scons test" to build and run the tests.
+ */
+
+#include "test.h"
+
+#include "core/log.h"
+
+#include <chrono>
+
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Minimum time to run each benchmark for. */
+static const double kBenchmarkMinTime = 0.5;
+
+/** Number of failures in the current test. */
+static unsigned g_numFailures = 0;
+
+/** @return             List of registered tests. */
+std::vector<TestCase> &testCases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+/** @return             List of registered benchmarks. */
+std::vector<TestCase> &benchmarkCases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+/** Record a failure in the current test.
+ * @param file          File the failure occurred in.
+ * @param line          Line the failure occurred on.
+ * @param fmt           Failure message format string.
+ * @param ...           Arguments to substitute into format. */
+void testFailure(const char *file, int line, const char *fmt, ...) {
+    fprintf(stderr, "  %s:%d: ", file, line);
+
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+
+    fprintf(stderr, "\n");
+    g_numFailures++;
+}
+
+/**
+ * Time a piece of code.
+ *
+ * Runs a function repeatedly, doubling the number of iterations until the
+ * total time taken reaches a minimum so that timer resolution and one-off
+ * costs do not dominate, then prints the average time per iteration.
+ *
+ * @param name          Name of the measurement to print.
+ * @param function      Function to time.
+ */
+void benchmarkLoop(const char *name, const std::function<void ()> &function) {
+    using Clock = std::chrono::steady_clock;
+
+    /* Warm up caches and any lazily initialised state. */
+    function();
+
+    uint64_t iterations = 1;
+    double elapsed;
+    while (true) {
+        Clock::time_point start = Clock::now();
+
+        for (uint64_t i = 0; i < iterations; i++)
+            function();
+
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if (elapsed >= kBenchmarkMinTime)
+            break;
+
+        iterations *= 2;
+    }
+
+    double perIteration = elapsed / static_cast<double>(iterations);
+    printf("  %-40s %12.3f us (%llu iterations)\n",
+           name,
+           perIteration * 1000000.0,
+           static_cast<unsigned long long>(iterations));
+}
+
+/** Print usage information.
+ * @param argv0         Program name. */
+static void usage(const char *argv0) {
+    printf("Usage: %s [options...] [filter]\n", argv0);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -b            Run benchmarks instead of tests\n");
+    printf("  -h            Display this help\n");
+    printf("  -l            List tests (or benchmarks with -b) without running them\n");
+}
+
+/** Main function of the test program.
+ * @param argc          Argument count.
+ * @param argv          Argument array.
+ * @return              EXIT_SUCCESS if all tests passed, EXIT_FAILURE if not. */
+int main(int argc, char **argv) {
+    bool benchmark = false;
+    bool list = false;
+
+    /* Parse arguments. */
+    int opt;
+    while ((opt = getopt(argc, argv, "bhl")) != -1) {
+        switch (opt) {
+            case 'b':
+                benchmark = true;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            case 'l':
+                list = true;
+                break;
+            default:
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - optind > 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *filter = (optind < argc) ? argv[optind] : nullptr;
+
+    /* The code under test reports errors through the log. */
+    g_logManager = new LogManager;
+
+    const std::vector<TestCase> &cases = (benchmark) ? benchmarkCases() : testCases();
+
+    unsigned numRun    = 0;
+    unsigned numFailed = 0;
+
+    for (const TestCase &testCase : cases) {
+        if (filter && !strstr(testCase.name, filter))
+            continue;
+
+        if (list) {
+            printf("%s\n", testCase.name);
+            continue;
+        }
+
+        printf("%s\n", testCase.name);
+
+        g_numFailures = 0;
+        testCase.function();
+
+        numRun++;
+        if (g_numFailures) {
+            fprintf(stderr, "%s: FAILED (%u failures)\n", testCase.name, g_numFailures);
+            numFailed++;
+        }
+    }
+
+    if (!list && !benchmark)
+        printf("%u tests run, %u failed\n", numRun, numFailed);
+
+    return (numFailed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Mesh builder tests.
+ */
+
+#include "test.h"
+
+#include "../../runtime/engine/src/loaders/mesh_builder.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+/** Triangle given by vertex positions, used to compare meshes. */
+using TrianglePositions = std::array<float, 9>;
+
+/**
+ * Add a grid to a mesh builder.
+ *
+ * Adds a flat grid of the given number of cells in each direction as a single
+ * submesh, with the triangles in a random order so that the vertex cache
+ * locality is poor, as it would be for a mesh exported without optimisation.
+ *
+ * @param builder       Builder to add to.
+ * @param size          Number of cells in each direction.
+ * @param seed          Seed for the triangle order.
+ */
+static void addShuffledGrid(MeshBuilder &builder, unsigned size, unsigned seed) {
+    builder.addAttribute(VertexAttribute::kPositionSemantic, 0);
+    builder.addAttribute(VertexAttribute::kNormalSemantic, 0);
+    builder.addAttribute(VertexAttribute::kTexcoordSemantic, 0);
+
+    for (unsigned y = 0; y <= size; y++) {
+        for (unsigned x = 0; x <= size; x++) {
+            size_t index;
+            MeshBuilder::Vertex &vertex = builder.addVertex(index);
+            vertex.position = glm::vec3(x, y, 0.0f);
+            vertex.normal   = glm::vec3(0.0f, 0.0f, 1.0f);
+            vertex.texcoord = glm::vec2(x, y) / static_cast<float>(size);
+        }
+    }
+
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (unsigned y = 0; y < size; y++) {
+        for (unsigned x = 0; x < size; x++) {
+            uint32_t a = (y * (size + 1)) + x;
+            uint32_t b = a + 1;
+            uint32_t c = b + size + 1;
+            uint32_t d = a + size + 1;
+
+            triangles.push_back({{a, b, c}});
+            triangles.push_back({{c, d, a}});
+        }
+    }
+
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+
+    MeshBuilder::SubMeshDesc &subMesh = builder.addSubMesh();
+    subMesh.material = "grid";
+    for (const std::array<uint32_t, 3> &triangle : triangles)
+        subMesh.indices.insert(subMesh.indices.end(), triangle.begin(), triangle.end());
+}
+
+/**
+ * Get the triangles of a submesh by position.
+ *
+ * Gets a sorted list of the triangles of a submesh, each given by the
+ * positions of its vertices starting from the smallest, so that the result
+ * does not depend on the order of vertices or triangles but does depend on
+ * winding.
+ *
+ * @param builder       Builder to get from.
+ * @param indices       Indices of the triangles.
+ *
+ * @return              Sorted list of triangles.
+ */
+static std::vector<TrianglePositions> getTriangles(const MeshBuilder &builder,
+                                                   const std::vector<uint32_t> &indices)
+{
+    std::vector<TrianglePositions> triangles;
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        std::array<TrianglePositions, 3> rotations;
+
+        for (size_t rotation = 0; rotation < 3; rotation++) {
+            for (size_t j = 0; j < 3; j++) {
+                const glm::vec3 &position = builder.vertices()[indices[i + ((rotation + j) % 3)]].position;
+                rotations[rotation][(j * 3) + 0] = position.x;
+                rotations[rotation][(j * 3) + 1] = position.y;
+                rotations[rotation][(j * 3) + 2] = position.z;
+            }
+        }
+
+        triangles.push_back(*std::min_element(rotations.begin(), rotations.end()));
+    }
+
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+TEST(MeshBuilderVertexCacheStats) {
+    MeshBuilder builder("test.mesh");
+
+    for (size_t i = 0; i < 6; i++) {
+        size_t index;
+        builder.addVertex(index);
+    }
+
+    /* A single triangle always transforms all 3 vertices. */
+    MeshBuilder::SubMeshDesc &subMesh = builder.addSubMesh();
+    subMesh.indices = {0, 1, 2};
+
+    MeshBuilder::VertexCacheStats stats = builder.analyseVertexCache();
+    expect(stats.acmr == 3.0f);
+    expect(stats.atvr == 1.0f);
+
+    /* A strip-like pair of triangles shares 2 vertices. */
+    subMesh.indices = {0, 1, 2, 2, 1, 3};
+    stats = builder.analyseVertexCache();
+    expect(stats.acmr == 2.0f);
+    expect(stats.atvr == 1.0f);
+
+    /* The cache is flushed between submeshes, so the same triangle in another
+     * submesh is transformed again. */
+    MeshBuilder::SubMeshDesc &other = builder.addSubMesh();
+    other.indices = {0, 1, 2};
+    stats = builder.analyseVertexCache();
+    expect(stats.acmr == 7.0f / 3.0f);
+    expect(stats.atvr == 7.0f / 4.0f);
+}
+
+TEST(MeshBuilderOptimise) {
+    static const unsigned kGridSize = 64;
+
+    MeshBuilder builder("test.mesh");
+    addShuffledGrid(builder, kGridSize, 1);
+
+    std::vector<TrianglePositions> before = getTriangles(builder, builder.subMeshes().front().indices);
+    MeshBuilder::VertexCacheStats beforeStats = builder.analyseVertexCache();
+
+    builder.optimise();
+
+    std::vector<TrianglePositions> after = getTriangles(builder, builder.subMeshes().front().indices);
+    MeshBuilder::VertexCacheStats afterStats = builder.analyseVertexCache();
+
+    printf("  ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+           beforeStats.acmr, afterStats.acmr, beforeStats.atvr, afterStats.atvr);
+
+    /* Triangles (including their winding) must be unchanged. */
+    expect(after == before);
+    expect(builder.vertices().size() == (kGridSize + 1) * (kGridSize + 1));
+
+    /* A random order gets almost no reuse. Tipsify should be well under 1
+     * vertex per triangle on a regular grid. */
+    expect(beforeStats.acmr > 2.0f);
+    expectMsg(afterStats.acmr < 0.8f, "ACMR after optimisation is %.3f", afterStats.acmr);
+    expectMsg(afterStats.atvr < 1.5f, "ATVR after optimisation is %.3f", afterStats.atvr);
+}
+
+TEST(MeshBuilderOptimiseRemovesUnused) {
+    MeshBuilder builder("test.mesh");
+    addShuffledGrid(builder, 4, 2);
+
+    /* Add a vertex which is not referenced. */
+    size_t unused;
+    builder.addVertex(unused).position = glm::vec3(-1.0f);
+
+    std::vector<TrianglePositions> before = getTriangles(builder, builder.subMeshes().front().indices);
+
+    builder.optimise();
+
+    expect(builder.vertices().size() == 25);
+    expect(getTriangles(builder, builder.subMeshes().front().indices) == before);
+
+    /* Vertices should be in order of first use. */
+    uint32_t next = 0;
+    for (uint32_t index : builder.subMeshes().front().indices) {
+        expectMsg(index <= next, "Vertex %u used before vertex %u", index, next);
+        if (index == next)
+            next++;
+    }
+}
+
+BENCHMARK(MeshBuilderOptimise) {
+    MeshBuilder source("benchmark.mesh");
+    addShuffledGrid(source, 256, 1);
+
+    benchmarkLoop(
+        "MeshBuilder::optimise (256x256 grid)",
+        [&] () {
+            MeshBuilder builder(source);
+            builder.optimise();
+        });
+}
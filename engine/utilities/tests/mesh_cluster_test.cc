@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Mesh cluster culling tests.
+ *
+ * These check the clusters generated by MeshBuilder, culled with the same
+ * function as SubMesh::cullClusters(), against a brute force test of each
+ * triangle, to make sure that no visible triangle is ever culled.
+ */
+
+#include "test.h"
+
+#include "engine/mesh_format.h"
+
+#include "../../runtime/engine/src/loaders/mesh_builder.h"
+
+#include <random>
+
+/** Add a vertex with a position to a mesh builder.
+ * @param builder       Builder to add to.
+ * @param position      Position of the vertex. */
+static void addPosition(MeshBuilder &builder, const glm::vec3 &position) {
+    size_t index;
+    MeshBuilder::Vertex &vertex = builder.addVertex(index);
+    vertex.position = position;
+}
+
+/**
+ * Generate a test mesh.
+ *
+ * Generates a torus, which has normals in all directions and concave regions,
+ * surrounded by a bumpy ground plane, which has large regions of similar
+ * normals that should give tight normal cones.
+ *
+ * @param builder       Builder to add to.
+ */
+static void generateTestMesh(MeshBuilder &builder) {
+    static const unsigned kMajorSegments = 64;
+    static const unsigned kMinorSegments = 24;
+    static const unsigned kGroundSize    = 48;
+    static const float kMajorRadius      = 1.0f;
+    static const float kMinorRadius      = 0.35f;
+
+    builder.addAttribute(VertexAttribute::kPositionSemantic, 0);
+
+    MeshBuilder::SubMeshDesc &subMesh = builder.addSubMesh();
+
+    for (unsigned i = 0; i < kMajorSegments; i++) {
+        float u = (i * 2.0f * glm::pi<float>()) / kMajorSegments;
+
+        for (unsigned j = 0; j < kMinorSegments; j++) {
+            float v = (j * 2.0f * glm::pi<float>()) / kMinorSegments;
+            float r = kMajorRadius + (kMinorRadius * std::cos(v));
+
+            addPosition(builder, glm::vec3(r * std::cos(u), kMinorRadius * std::sin(v), r * std::sin(u)));
+        }
+    }
+
+    for (unsigned i = 0; i < kMajorSegments; i++) {
+        for (unsigned j = 0; j < kMinorSegments; j++) {
+            uint32_t a = (i * kMinorSegments) + j;
+            uint32_t b = (((i + 1) % kMajorSegments) * kMinorSegments) + j;
+            uint32_t c = (((i + 1) % kMajorSegments) * kMinorSegments) + ((j + 1) % kMinorSegments);
+            uint32_t d = (i * kMinorSegments) + ((j + 1) % kMinorSegments);
+
+            subMesh.indices.insert(subMesh.indices.end(), {a, d, c, c, b, a});
+        }
+    }
+
+    const uint32_t groundBase = builder.vertices().size();
+
+    for (unsigned y = 0; y <= kGroundSize; y++) {
+        for (unsigned x = 0; x <= kGroundSize; x++) {
+            float fx = ((x * 8.0f) / kGroundSize) - 4.0f;
+            float fz = ((y * 8.0f) / kGroundSize) - 4.0f;
+
+            addPosition(builder, glm::vec3(fx, (0.2f * std::sin(fx * 2.0f) * std::cos(fz * 1.5f)) - 0.5f, fz));
+        }
+    }
+
+    for (unsigned y = 0; y < kGroundSize; y++) {
+        for (unsigned x = 0; x < kGroundSize; x++) {
+            uint32_t a = groundBase + (y * (kGroundSize + 1)) + x;
+            uint32_t b = a + 1;
+            uint32_t c = b + kGroundSize + 1;
+            uint32_t d = a + kGroundSize + 1;
+
+            subMesh.indices.insert(subMesh.indices.end(), {a, d, c, c, b, a});
+        }
+    }
+}
+
+/**
+ * Check whether a point is definitely inside a view.
+ *
+ * Checks whether a point is inside the clip volume of a view-projection
+ * matrix, by a small margin so that points on the boundary are excluded.
+ *
+ * @param viewProjection View-projection matrix.
+ * @param point         Point to test.
+ *
+ * @return              Whether the point is inside.
+ */
+static bool isInsideView(const glm::mat4 &viewProjection, const glm::vec3 &point) {
+    static const float kMargin = 0.999f;
+
+    glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+    float w = clip.w * kMargin;
+
+    return clip.w > 0.0f &&
+           std::abs(clip.x) < w &&
+           std::abs(clip.y) < w &&
+           clip.z > clip.w * (1.0f - kMargin) &&
+           clip.z < w;
+}
+
+/** Statistics gathered by checkClusterCulling(). */
+struct ClusterCullingStats {
+    size_t numTested = 0;               /**< Number of visible triangles checked. */
+    size_t numCulled = 0;               /**< Number of clusters culled. */
+    size_t numBackCulled = 0;           /**< Clusters culled only by their cone. */
+};
+
+/**
+ * Check culled clusters against a brute force test.
+ *
+ * Culls every cluster of a sub-mesh against a view, and checks that no
+ * triangle which is visible from the view belongs to a culled cluster. A
+ * triangle is counted as visible if it is front-facing and a vertex or its
+ * centre is inside the view, which is a subset of the truly visible triangles.
+ *
+ * @param builder       Builder containing the mesh.
+ * @param triangleClusters Cluster index of each triangle.
+ * @param viewProjection View-projection matrix.
+ * @param viewPosition  View position, or viewing direction with a W of 0 for
+ *                      an orthographic view.
+ * @param viewIndex     Index of the view, for failure messages.
+ * @param stats         Statistics to update.
+ */
+static void checkClusterCulling(const MeshBuilder &builder,
+                                const std::vector<uint32_t> &triangleClusters,
+                                const glm::mat4 &viewProjection,
+                                const glm::vec4 &viewPosition,
+                                unsigned viewIndex,
+                                ClusterCullingStats &stats)
+{
+    const MeshBuilder::SubMeshDesc &subMesh = builder.subMeshes().front();
+    const std::vector<MeshBuilder::Vertex> &vertices = builder.vertices();
+
+    const Frustum frustum(viewProjection, glm::inverse(viewProjection));
+
+    std::vector<bool> clusterVisible(subMesh.clusters.size());
+    for (size_t i = 0; i < subMesh.clusters.size(); i++) {
+        const MeshBuilder::ClusterDesc &cluster = subMesh.clusters[i];
+
+        clusterVisible[i] = isMeshClusterVisible(cluster.bounds,
+                                                 cluster.coneApex,
+                                                 cluster.coneAxis,
+                                                 cluster.coneCutoff,
+                                                 frustum,
+                                                 viewPosition);
+
+        if (!clusterVisible[i]) {
+            stats.numCulled++;
+
+            if (Math::intersect(frustum, cluster.bounds))
+                stats.numBackCulled++;
+        }
+    }
+
+    for (size_t i = 0; i < subMesh.indices.size(); i += 3) {
+        const glm::vec3 &p0 = vertices[subMesh.indices[i + 0]].position;
+        const glm::vec3 &p1 = vertices[subMesh.indices[i + 1]].position;
+        const glm::vec3 &p2 = vertices[subMesh.indices[i + 2]].position;
+
+        /* Direction from the triangle towards the viewer. */
+        const glm::vec3 toView = (viewPosition.w != 0.0f)
+                                     ? glm::normalize(glm::vec3(viewPosition) - p0)
+                                     : -glm::normalize(glm::vec3(viewPosition));
+
+        glm::vec3 normal = glm::normalize(glm::cross(p1 - p0, p2 - p0));
+        if (glm::dot(normal, toView) <= 1e-3f)
+            continue;
+
+        if (!isInsideView(viewProjection, p0) &&
+            !isInsideView(viewProjection, p1) &&
+            !isInsideView(viewProjection, p2) &&
+            !isInsideView(viewProjection, (p0 + p1 + p2) / 3.0f))
+        {
+            continue;
+        }
+
+        stats.numTested++;
+
+        uint32_t cluster = triangleClusters[i / 3];
+        expectMsg(clusterVisible[cluster],
+                  "View %u: visible triangle %zu culled with cluster %u",
+                  viewIndex, i / 3, cluster);
+    }
+}
+
+/** Generate clusters for the test mesh and check that they cover it.
+ * @param builder       Builder to generate into.
+ * @return              Cluster index of each triangle. */
+static std::vector<uint32_t> generateTestClusters(MeshBuilder &builder) {
+    generateTestMesh(builder);
+    builder.generateClusters();
+
+    const MeshBuilder::SubMeshDesc &subMesh = builder.subMeshes().front();
+    const std::vector<MeshBuilder::Vertex> &vertices = builder.vertices();
+
+    expect(subMesh.clusters.size() > 1);
+
+    /* Clusters must cover every triangle exactly once. */
+    std::vector<uint32_t> triangleClusters(subMesh.indices.size() / 3, std::numeric_limits<uint32_t>::max());
+    uint32_t nextIndex = 0;
+    for (uint32_t i = 0; i < subMesh.clusters.size(); i++) {
+        const MeshBuilder::ClusterDesc &cluster = subMesh.clusters[i];
+
+        expect(cluster.firstIndex == nextIndex);
+        expect(cluster.numIndices > 0 && cluster.numIndices % 3 == 0);
+        expect(cluster.numIndices / 3 <= MeshBuilder::kClusterMaxTriangles);
+
+        for (uint32_t j = cluster.firstIndex; j < cluster.firstIndex + cluster.numIndices; j += 3) {
+            triangleClusters[j / 3] = i;
+
+            /* The bounding sphere must contain the triangle. */
+            for (uint32_t k = 0; k < 3; k++) {
+                const glm::vec3 &position = vertices[subMesh.indices[j + k]].position;
+                expect(glm::distance(position, cluster.bounds.centre) <= cluster.bounds.radius * 1.0001f);
+            }
+        }
+
+        nextIndex = cluster.firstIndex + cluster.numIndices;
+    }
+
+    expect(nextIndex == subMesh.indices.size());
+    return triangleClusters;
+}
+
+TEST(MeshClusterCulling) {
+    MeshBuilder builder("test.mesh");
+    const std::vector<uint32_t> triangleClusters = generateTestClusters(builder);
+
+    /* Compare against the triangles visible from random views around the
+     * mesh. Views are both outside and within the bounds of the mesh,
+     * including close to the surface where the cone test is tightest. */
+    static const unsigned kNumViews = 500;
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    ClusterCullingStats stats;
+
+    for (unsigned view = 0; view < kNumViews; view++) {
+        glm::vec3 position(unit(random) * 5.0f, unit(random) * 2.0f + 0.5f, unit(random) * 5.0f);
+        glm::vec3 target(unit(random), unit(random) * 0.5f, unit(random));
+
+        const glm::mat4 viewMatrix     = glm::lookAt(position, target, glm::vec3(0.0f, 1.0f, 0.0f));
+        const glm::mat4 projection     = glm::perspective(glm::radians(75.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+        checkClusterCulling(builder,
+                            triangleClusters,
+                            projection * viewMatrix,
+                            glm::vec4(position, 1.0f),
+                            view,
+                            stats);
+    }
+
+    printf("  %zu visible triangles checked, %zu clusters culled (%zu back-facing)\n",
+           stats.numTested, stats.numCulled, stats.numBackCulled);
+
+    /* Make sure that the test is meaningful. */
+    expect(stats.numTested > 0);
+    expect(stats.numBackCulled > 0);
+}
+
+TEST(MeshClusterCullingOrthographic) {
+    MeshBuilder builder("test.mesh");
+    const std::vector<uint32_t> triangleClusters = generateTestClusters(builder);
+
+    /* Orthographic views like those of shadow cascades, which are placed some
+     * way back from the mesh along the light direction. Since every triangle
+     * is seen from the same direction, culling based on the direction to the
+     * view's position would wrongly cull clusters near the edge of the view. */
+    static const unsigned kNumViews = 500;
+
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    ClusterCullingStats stats;
+
+    for (unsigned view = 0; view < kNumViews; view++) {
+        glm::vec3 direction(unit(random), unit(random), unit(random));
+        if (glm::length(direction) < 0.1f)
+            direction = glm::vec3(0.0f, -1.0f, 0.0f);
+
+        direction = glm::normalize(direction);
+
+        /* Avoid a degenerate look-at matrix. */
+        const glm::vec3 up = (std::abs(direction.y) > 0.9f)
+                                 ? glm::vec3(1.0f, 0.0f, 0.0f)
+                                 : glm::vec3(0.0f, 1.0f, 0.0f);
+
+        glm::vec3 target(unit(random) * 2.0f, unit(random) * 0.5f, unit(random) * 2.0f);
+        glm::vec3 position = target - (direction * 10.0f);
+        float size = 1.0f + ((unit(random) + 1.0f) * 2.0f);
+
+        const glm::mat4 viewMatrix     = glm::lookAt(position, target, up);
+        const glm::mat4 projection     = glm::ortho(-size, size, -size, size, 0.1f, 20.0f);
+
+        checkClusterCulling(builder,
+                            triangleClusters,
+                            projection * viewMatrix,
+                            glm::vec4(direction, 0.0f),
+                            view,
+                            stats);
+    }
+
+    printf("  %zu visible triangles checked, %zu clusters culled (%zu back-facing)\n",
+           stats.numTested, stats.numCulled, stats.numBackCulled);
+
+    expect(stats.numTested > 0);
+    expect(stats.numBackCulled > 0);
+}
+
+TEST(MeshClusterNoCone) {
+    /* A cutoff of 1 or more means that the cluster can't be back-face culled,
+     * however the view position relates to the cone. */
+    const glm::mat4 viewProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    const Frustum frustum(viewProjection, glm::inverse(viewProjection));
+
+    const Sphere bounds(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f);
+
+    expect(isMeshClusterVisible(bounds,
+                                glm::vec3(0.0f, 0.0f, -10.0f),
+                                glm::vec3(0.0f, 0.0f, -1.0f),
+                                1.0f,
+                                frustum,
+                                glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+
+    /* The same cluster with a narrow cone facing away is culled. */
+    expect(!isMeshClusterVisible(bounds,
+                                 glm::vec3(0.0f, 0.0f, -10.0f),
+                                 glm::vec3(0.0f, 0.0f, -1.0f),
+                                 0.5f,
+                                 frustum,
+                                 glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+
+    /* Clusters outside the frustum are culled. */
+    expect(!isMeshClusterVisible(Sphere(glm::vec3(0.0f, 0.0f, 10.0f), 1.0f),
+                                 glm::vec3(0.0f, 0.0f, 10.0f),
+                                 glm::vec3(0.0f, 0.0f, 1.0f),
+                                 1.0f,
+                                 frustum,
+                                 glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+}
+
+BENCHMARK(MeshClusterGenerate) {
+    MeshBuilder source("benchmark.mesh");
+    generateTestMesh(source);
+
+    benchmarkLoop(
+        "MeshBuilder::generateClusters",
+        [&] () {
+            MeshBuilder builder(source);
+            builder.generateClusters();
+        });
+}
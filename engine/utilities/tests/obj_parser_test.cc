@@ -0,0 +1,696 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               OBJ parser tests.
+ *
+ * The benchmarks compare OBJParser against a copy of the line-based parser
+ * that it replaced, which is kept here as a baseline.
+ */
+
+#include "test.h"
+
+#include "core/data_stream.h"
+#include "core/hash_table.h"
+#include "core/string.h"
+
+#include "engine/mesh_format.h"
+
+#include "gpu/index_data.h"
+
+#include "../../runtime/engine/src/loaders/obj_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+/** Parse OBJ source text.
+ * @param source        Source text.
+ * @param builder       Builder to add mesh data to.
+ * @return              Whether successful. */
+static bool parseOBJ(const std::string &source, MeshBuilder &builder) {
+    OBJParser parser(builder, "test.obj");
+    return parser.parse(source.data(), source.size());
+}
+
+/**
+ * Generate OBJ source for a grid.
+ *
+ * Generates a flat grid of the given number of cells in each direction, with
+ * positions, texture coordinates and a single shared normal. Each cell is
+ * either a quad or 2 triangles.
+ *
+ * @param size          Number of cells in each direction.
+ * @param quads         Whether to output quads rather than triangles.
+ *
+ * @return              Generated source.
+ */
+static std::string generateGrid(unsigned size, bool quads) {
+    std::string source;
+    char line[128];
+
+    for (unsigned y = 0; y <= size; y++) {
+        for (unsigned x = 0; x <= size; x++) {
+            snprintf(line, sizeof(line), "v %.6f %.6f 0.000000\n", x / float(size), y / float(size));
+            source += line;
+        }
+    }
+
+    for (unsigned y = 0; y <= size; y++) {
+        for (unsigned x = 0; x <= size; x++) {
+            snprintf(line, sizeof(line), "vt %.6f %.6f\n", x / float(size), y / float(size));
+            source += line;
+        }
+    }
+
+    source += "vn 0.000000 0.000000 1.000000\n";
+    source += "usemtl grid\n";
+
+    for (unsigned y = 0; y < size; y++) {
+        for (unsigned x = 0; x < size; x++) {
+            unsigned a = (y * (size + 1)) + x + 1;
+            unsigned b = a + 1;
+            unsigned c = b + size + 1;
+            unsigned d = a + size + 1;
+
+            if (quads) {
+                snprintf(line, sizeof(line), "f %u/%u/1 %u/%u/1 %u/%u/1 %u/%u/1\n", a, a, b, b, c, c, d, d);
+                source += line;
+            } else {
+                snprintf(line, sizeof(line), "f %u/%u/1 %u/%u/1 %u/%u/1\n", a, a, b, b, c, c);
+                source += line;
+                snprintf(line, sizeof(line), "f %u/%u/1 %u/%u/1 %u/%u/1\n", c, c, d, d, a, a);
+                source += line;
+            }
+        }
+    }
+
+    return source;
+}
+
+/** Data stream reading from memory, for the baseline parser. */
+class MemoryDataStream : public DataStream {
+public:
+    /** Initialise the stream.
+     * @param data          Data to read.
+     * @param size          Size of the data. */
+    MemoryDataStream(const void *data, size_t size) :
+        m_data   (reinterpret_cast<const uint8_t *>(data)),
+        m_size   (size),
+        m_offset (0)
+    {}
+
+    uint64_t size() const override { return m_size; }
+    uint64_t offset() const override { return m_offset; }
+    const void *data() override { return m_data; }
+
+    bool read(void *buf, size_t size) override {
+        if (!read(buf, size, m_offset))
+            return false;
+
+        m_offset += size;
+        return true;
+    }
+
+    bool read(void *buf, size_t size, uint64_t offset) override {
+        if (offset > m_size || size > m_size - offset)
+            return false;
+
+        memcpy(buf, m_data + offset, size);
+        return true;
+    }
+
+    bool write(const void *buf, size_t size) override { return false; }
+    bool write(const void *buf, size_t size, uint64_t offset) override { return false; }
+
+    bool seek(SeekMode mode, int64_t offset) override {
+        switch (mode) {
+            case kSeekSet:
+                m_offset = offset;
+                break;
+            case kSeekCurrent:
+                m_offset += offset;
+                break;
+            case kSeekEnd:
+                m_offset = m_size + offset;
+                break;
+        }
+
+        return true;
+    }
+
+private:
+    const uint8_t *m_data;              /**< Data to read. */
+    size_t m_size;                      /**< Size of the data. */
+    uint64_t m_offset;                  /**< Current offset. */
+};
+
+/**
+ * Baseline OBJ parser.
+ *
+ * This is the OBJ parser as it was before OBJParser was rewritten to work on
+ * the file content in memory, without error messages. It reads the file a
+ * line at a time through a DataStream, tokenises lines into strings, and
+ * deduplicates vertices with a HashMap. It only supports triangles and quads
+ * with positive indices, and meshes with up to 65536 vertices.
+ */
+class BaselineOBJParser {
+public:
+    BaselineOBJParser(MeshBuilder &builder) :
+        m_builder         (builder),
+        m_currentLine     (0),
+        m_currentMaterial ("default"),
+        m_currentSubMesh  (nullptr)
+    {}
+
+    bool parse(DataStream *data);
+
+private:
+    /** Indexes into the vertex element arrays for a single vertex. */
+    struct VertexKey {
+        uint16_t position;
+        uint16_t texcoord;
+        uint16_t normal;
+    public:
+        /** Compare this key with another. */
+        bool operator ==(const VertexKey &other) const {
+            return position == other.position && texcoord == other.texcoord && normal == other.normal;
+        }
+
+        /** Get the hash for a vertex key. */
+        friend size_t hashValue(const VertexKey &value) {
+            size_t hash = hashValue(value.position);
+            hash = hashCombine(hash, value.texcoord);
+            hash = hashCombine(hash, value.normal);
+            return hash;
+        }
+    };
+
+private:
+    template <typename VectorType>
+    bool addVertexElement(const std::vector<std::string> &tokens, std::vector<VectorType> &array);
+
+    bool addFace(const std::vector<std::string> &tokens);
+
+private:
+    MeshBuilder &m_builder;
+
+    size_t m_currentLine;
+    std::string m_currentMaterial;
+    MeshBuilder::SubMeshDesc *m_currentSubMesh;
+
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::vec2> m_texcoords;
+    std::vector<glm::vec3> m_normals;
+
+    HashMap<VertexKey, size_t> m_vertexMap;
+};
+
+/** Parse an OBJ file.
+ * @param data          Stream to read from.
+ * @return              Whether the file was parsed successfully. */
+bool BaselineOBJParser::parse(DataStream *data) {
+    m_builder.addAttribute(VertexAttribute::kPositionSemantic, 0);
+    m_builder.addAttribute(VertexAttribute::kNormalSemantic, 0);
+    m_builder.addAttribute(VertexAttribute::kTexcoordSemantic, 0);
+
+    std::string line;
+    while (data->readLine(line)) {
+        m_currentLine++;
+
+        std::vector<std::string> tokens;
+        String::tokenize(line, tokens, " \r");
+        if (!tokens.size())
+            continue;
+
+        if (tokens[0] == "v") {
+            if (!addVertexElement(tokens, m_positions))
+                return false;
+        } else if (tokens[0] == "vt") {
+            if (!addVertexElement(tokens, m_texcoords))
+                return false;
+        } else if (tokens[0] == "vn") {
+            if (!addVertexElement(tokens, m_normals))
+                return false;
+        } else if (tokens[0] == "f") {
+            if (!addFace(tokens))
+                return false;
+        } else if (tokens[0] == "usemtl") {
+            if (tokens.size() != 2)
+                return false;
+
+            if (tokens[1] != m_currentMaterial) {
+                m_currentMaterial = tokens[1];
+                m_currentSubMesh = nullptr;
+            }
+        } else if (tokens[0] == "g") {
+            if (tokens.size() != 2)
+                return false;
+
+            m_currentSubMesh = nullptr;
+        }
+    }
+
+    return true;
+}
+
+/** Handle a vertex element declaration.
+ * @param tokens        Tokens from the current line.
+ * @param array         Array to add to.
+ * @return              Whether the declaration was valid. */
+template <typename VectorType>
+bool BaselineOBJParser::addVertexElement(const std::vector<std::string> &tokens,
+                                         std::vector<VectorType> &array)
+{
+    VectorType value;
+
+    if (tokens.size() < static_cast<size_t>(value.length()) + 1)
+        return false;
+
+    for (int i = 0; i < static_cast<int>(value.length()); i++) {
+        const char *str = tokens[i + 1].c_str(), *end;
+        value[i] = strtof(str, const_cast<char **>(&end));
+        if (end != str + tokens[i + 1].length())
+            return false;
+    }
+
+    array.push_back(value);
+    return true;
+}
+
+/** Handle a face declaration.
+ * @param tokens        Tokens from the current line.
+ * @return              Whether the declaration was valid. */
+bool BaselineOBJParser::addFace(const std::vector<std::string> &tokens) {
+    if (!m_currentSubMesh) {
+        m_currentSubMesh = &m_builder.addSubMesh();
+        m_currentSubMesh->material = m_currentMaterial;
+    }
+
+    size_t numVertices = tokens.size() - 1;
+    if (numVertices != 3 && numVertices != 4)
+        return false;
+
+    std::vector<uint16_t> indices(numVertices);
+    for (size_t i = 0; i < numVertices; i++) {
+        std::vector<std::string> subTokens;
+        String::tokenize(tokens[i + 1], subTokens, "/", -1, false);
+        if (subTokens.size() != 3)
+            return false;
+
+        VertexKey key;
+        for (size_t j = 0; j < 3; j++) {
+            const char *str = subTokens[j].c_str(), *end;
+            uint16_t value = strtoul(str, const_cast<char **>(&end), 10);
+            if (end != str + subTokens[j].length())
+                return false;
+
+            value -= 1;
+
+            switch (j) {
+                case 0:
+                    if (value >= m_positions.size())
+                        return false;
+
+                    key.position = value;
+                    break;
+                case 1:
+                    if (value >= m_texcoords.size())
+                        return false;
+
+                    key.texcoord = value;
+                    break;
+                case 2:
+                    if (value >= m_normals.size())
+                        return false;
+
+                    key.normal = value;
+                    break;
+            }
+        }
+
+        auto ret = m_vertexMap.emplace(key, 0);
+        if (ret.second) {
+            MeshBuilder::Vertex &vertex = m_builder.addVertex(ret.first->second);
+            vertex.position = m_positions[key.position];
+            vertex.normal   = m_normals[key.normal];
+            vertex.texcoord = m_texcoords[key.texcoord];
+        }
+
+        indices[i] = ret.first->second;
+    }
+
+    m_currentSubMesh->indices.push_back(indices[0]);
+    m_currentSubMesh->indices.push_back(indices[1]);
+    m_currentSubMesh->indices.push_back(indices[2]);
+    if (numVertices == 4) {
+        m_currentSubMesh->indices.push_back(indices[2]);
+        m_currentSubMesh->indices.push_back(indices[3]);
+        m_currentSubMesh->indices.push_back(indices[0]);
+    }
+
+    return true;
+}
+
+TEST(OBJParserTriangles) {
+    std::string source = generateGrid(4, false);
+
+    MeshBuilder builder("test.obj");
+    expect(parseOBJ(source, builder));
+
+    expect(builder.vertices().size() == 25);
+    expect(builder.subMeshes().size() == 1);
+
+    const MeshBuilder::SubMeshDesc &subMesh = builder.subMeshes().front();
+    expect(subMesh.material == "grid");
+    expect(subMesh.indices.size() == 4 * 4 * 6);
+
+    /* Results should match the baseline parser exactly for triangles. */
+    MeshBuilder baselineBuilder("test.obj");
+    MemoryDataStream stream(source.data(), source.size());
+    BaselineOBJParser baseline(baselineBuilder);
+    expect(baseline.parse(&stream));
+
+    const MeshBuilder::SubMeshDesc &baselineSubMesh = baselineBuilder.subMeshes().front();
+    expect(subMesh.indices == baselineSubMesh.indices);
+    expect(builder.vertices().size() == baselineBuilder.vertices().size());
+
+    for (size_t i = 0; i < builder.vertices().size(); i++) {
+        const MeshBuilder::Vertex &vertex = builder.vertices()[i];
+        const MeshBuilder::Vertex &baselineVertex = baselineBuilder.vertices()[i];
+
+        expectMsg(vertex.position == baselineVertex.position &&
+                      vertex.normal == baselineVertex.normal &&
+                      vertex.texcoord == baselineVertex.texcoord,
+                  "Vertex %zu differs from baseline", i);
+    }
+}
+
+TEST(OBJParserFloats) {
+    static const char *kSource =
+        "v 1 -2.5 +3e2\n"
+        "v 0.000001 -1.5E-3 1234567.875\n"
+        "v .5 2. -0\n"
+        "vt 0.25 0.75\n"
+        "vn 0 0 1\n"
+        "f 1/1/1 2/1/1 3/1/1\n";
+
+    MeshBuilder builder("test.obj");
+    expect(parseOBJ(kSource, builder));
+    expect(builder.vertices().size() == 3);
+
+    if (builder.vertices().size() == 3) {
+        expect(builder.vertices()[0].position == glm::vec3(1.0f, -2.5f, 300.0f));
+        expect(builder.vertices()[1].position == glm::vec3(strtof("0.000001", nullptr), -1.5e-3f, 1234567.875f));
+        expect(builder.vertices()[2].position == glm::vec3(0.5f, 2.0f, 0.0f));
+        expect(builder.vertices()[0].texcoord == glm::vec2(0.25f, 0.75f));
+    }
+
+    static const char *kInvalid[] = {
+        "v 1 2\n",
+        "v 1 2 x\n",
+        "v 1 2 3x\n",
+        "vt 1e 2\n",
+    };
+
+    for (const char *source : kInvalid) {
+        MeshBuilder invalidBuilder("test.obj");
+        expectMsg(!parseOBJ(source, invalidBuilder), "Accepted '%s'", source);
+    }
+}
+
+TEST(OBJParserNegativeIndices) {
+    static const char *kAbsolute =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "vt 0 0\n"
+        "vt 1 0\n"
+        "vt 1 1\n"
+        "vn 0 0 1\n"
+        "f 1/1/1 2/2/1 3/3/1\n"
+        "v 0 1 0\n"
+        "vt 0 1\n"
+        "f 1/1/1 3/3/1 4/4/1\n";
+
+    static const char *kRelative =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "vt 0 0\n"
+        "vt 1 0\n"
+        "vt 1 1\n"
+        "vn 0 0 1\n"
+        "f -3/-3/-1 -2/-2/-1 -1/-1/-1\n"
+        "v 0 1 0\n"
+        "vt 0 1\n"
+        "f -4/-4/-1 3/-2/1 -1/4/-1\n";
+
+    MeshBuilder absolute("absolute.obj");
+    MeshBuilder relative("relative.obj");
+    expect(parseOBJ(kAbsolute, absolute));
+    expect(parseOBJ(kRelative, relative));
+
+    expect(absolute.vertices().size() == 4);
+    expect(relative.vertices().size() == absolute.vertices().size());
+    expect(relative.subMeshes().size() == 1 && absolute.subMeshes().size() == 1);
+
+    if (relative.vertices().size() == absolute.vertices().size()) {
+        for (size_t i = 0; i < absolute.vertices().size(); i++) {
+            expect(relative.vertices()[i].position == absolute.vertices()[i].position);
+            expect(relative.vertices()[i].texcoord == absolute.vertices()[i].texcoord);
+        }
+    }
+
+    if (relative.subMeshes().size() == 1 && absolute.subMeshes().size() == 1)
+        expect(relative.subMeshes().front().indices == absolute.subMeshes().front().indices);
+
+    /* Indices outside the declared elements are rejected, including relative
+     * indices which go past the first element, 0, and an index one past the
+     * end. */
+    static const char *kInvalid[] = {
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1/1/1 1/1/1 -2/1/1\n",
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1/1/1 1/1/1 0/1/1\n",
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1/1/1 1/1/1 2/1/1\n",
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1/1/1 1/1/1 1/2/1\n",
+        "v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1/1/1 1/1/1 1/1/-2\n",
+    };
+
+    for (const char *source : kInvalid) {
+        MeshBuilder invalidBuilder("test.obj");
+        expectMsg(!parseOBJ(source, invalidBuilder), "Accepted invalid index in '%s'", source);
+    }
+}
+
+TEST(OBJParserFanTriangulation) {
+    /* A hexagon, which should be split into a fan of 4 triangles around the
+     * first vertex, with the winding of the polygon preserved. */
+    static const char *kSource =
+        "v 1 0 0\n"
+        "v 0.5 0.866 0\n"
+        "v -0.5 0.866 0\n"
+        "v -1 0 0\n"
+        "v -0.5 -0.866 0\n"
+        "v 0.5 -0.866 0\n"
+        "vt 0 0\n"
+        "vn 0 0 1\n"
+        "f 1/1/1 2/1/1 3/1/1 4/1/1 5/1/1 6/1/1\n"
+        "f 1/1/1 2/1/1 3/1/1 4/1/1\n"
+        "f 4/1/1 5/1/1 6/1/1\n";
+
+    MeshBuilder builder("test.obj");
+    expect(parseOBJ(kSource, builder));
+    expect(builder.vertices().size() == 6);
+    expect(builder.subMeshes().size() == 1);
+
+    if (builder.subMeshes().size() == 1) {
+        const std::vector<uint32_t> expected = {
+            0, 1, 2,  0, 2, 3,  0, 3, 4,  0, 4, 5,
+            0, 1, 2,  0, 2, 3,
+            3, 4, 5,
+        };
+
+        expect(builder.subMeshes().front().indices == expected);
+    }
+
+    /* Every triangle should face the same way as the polygon. */
+    if (builder.vertices().size() == 6 && builder.subMeshes().size() == 1) {
+        const std::vector<uint32_t> &indices = builder.subMeshes().front().indices;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            glm::vec3 a = builder.vertices()[indices[i]].position;
+            glm::vec3 b = builder.vertices()[indices[i + 1]].position;
+            glm::vec3 c = builder.vertices()[indices[i + 2]].position;
+
+            expectMsg(glm::cross(b - a, c - a).z > 0.0f, "Triangle %zu is flipped", i / 3);
+        }
+    }
+
+    /* Fewer than 3 vertices is an error. */
+    MeshBuilder invalidBuilder("test.obj");
+    expect(!parseOBJ("v 0 0 0\nvt 0 0\nvn 0 0 1\nf 1/1/1 1/1/1\n", invalidBuilder));
+}
+
+TEST(OBJParserSubMeshes) {
+    static const char *kSource =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "vt 0 0\n"
+        "vn 0 0 1\n"
+        "f 1/1/1 2/1/1 3/1/1\n"
+        "usemtl a\n"
+        "f 1/1/1 2/1/1 3/1/1\n"
+        "usemtl a\n"
+        "f 1/1/1 2/1/1 3/1/1\n"
+        "g group\n"
+        "f 1/1/1 2/1/1 3/1/1\n"
+        "usemtl b\r\n"
+        "f 1/1/1 2/1/1 3/1/1";
+
+    MeshBuilder builder("test.obj");
+    expect(parseOBJ(kSource, builder));
+    expect(builder.vertices().size() == 3);
+
+    std::vector<std::string> materials;
+    std::vector<size_t> sizes;
+    for (const MeshBuilder::SubMeshDesc &subMesh : builder.subMeshes()) {
+        materials.push_back(subMesh.material);
+        sizes.push_back(subMesh.indices.size());
+    }
+
+    expect(materials == std::vector<std::string>({"default", "a", "a", "b"}));
+    expect(sizes == std::vector<size_t>({3, 6, 3, 3}));
+}
+
+/**
+ * Check the indices of a cooked mesh.
+ *
+ * Builds a cooked mesh from a builder containing a single submesh, and checks
+ * that it uses the expected index type and that its indices match the
+ * builder's.
+ *
+ * @param builder       Builder to cook.
+ * @param indexType     Expected index type.
+ */
+static void checkCookedIndices(const MeshBuilder &builder, GPUIndexData::Type indexType) {
+    std::vector<uint8_t> data;
+    expect(builder.build(data));
+    expect(data.size() >= sizeof(MeshHeader));
+
+    MeshHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+
+    expect(header.indexType == indexType);
+    expect(header.numVertices == builder.vertices().size());
+
+    const std::vector<uint32_t> &indices = builder.subMeshes().front().indices;
+    expect(header.numIndices == indices.size());
+
+    const size_t indexSize = GPUIndexData::elementSize(indexType);
+    expect(header.indicesOffset + (header.numIndices * indexSize) <= data.size());
+
+    size_t numMismatched = 0;
+    for (size_t i = 0; i < indices.size(); i++) {
+        uint32_t index;
+        if (indexType == GPUIndexData::kUnsignedShortType) {
+            uint16_t shortIndex;
+            memcpy(&shortIndex, &data[header.indicesOffset + (i * indexSize)], sizeof(shortIndex));
+            index = shortIndex;
+        } else {
+            memcpy(&index, &data[header.indicesOffset + (i * indexSize)], sizeof(index));
+        }
+
+        if (index != indices[i])
+            numMismatched++;
+    }
+
+    expectMsg(numMismatched == 0, "%zu of %zu indices differ", numMismatched, indices.size());
+}
+
+TEST(OBJParserIndexType) {
+    /* A 255x255 grid has exactly 65536 unique vertices, the most that can be
+     * addressed with 16-bit indices. One more row and column needs 32-bit
+     * indices, including indices above 65535 which must not be truncated. */
+    for (unsigned size : { 255u, 256u }) {
+        std::string source = generateGrid(size, false);
+
+        MeshBuilder builder("test.obj");
+        expect(parseOBJ(source, builder));
+        expect(builder.vertices().size() == (size + 1) * (size + 1));
+
+        const std::vector<uint32_t> &indices = builder.subMeshes().front().indices;
+        expect(*std::max_element(indices.begin(), indices.end()) == builder.vertices().size() - 1);
+
+        checkCookedIndices(builder,
+                           (size == 255)
+                               ? GPUIndexData::kUnsignedShortType
+                               : GPUIndexData::kUnsignedIntType);
+    }
+}
+
+/** Size of the grid used for benchmarks (fits in 16-bit indices). */
+static const unsigned kBenchmarkGridSize = 200;
+
+BENCHMARK(OBJParse) {
+    for (bool quads : { false, true }) {
+        std::string source = generateGrid(kBenchmarkGridSize, quads);
+
+        benchmarkLoop(
+            (quads) ? "OBJParser (quads)" : "OBJParser (triangles)",
+            [&] () {
+                MeshBuilder builder("benchmark.obj");
+                parseOBJ(source, builder);
+            });
+
+        benchmarkLoop(
+            (quads) ? "BaselineOBJParser (quads)" : "BaselineOBJParser (triangles)",
+            [&] () {
+                MeshBuilder builder("benchmark.obj");
+                MemoryDataStream stream(source.data(), source.size());
+                BaselineOBJParser parser(builder);
+                parser.parse(&stream);
+            });
+    }
+}
+
+/** Size of the grid used for the large benchmark (2.88M triangles). */
+static const unsigned kLargeBenchmarkGridSize = 1200;
+
+BENCHMARK(OBJParseLarge) {
+    /* The baseline parser is too slow to be worth running at this size. This
+     * measures the whole import of a large mesh, including cooking it with
+     * 32-bit indices. */
+    std::string source = generateGrid(kLargeBenchmarkGridSize, false);
+
+    benchmarkLoop(
+        "OBJParser (large)",
+        [&] () {
+            MeshBuilder builder("benchmark.obj");
+            parseOBJ(source, builder);
+        });
+
+    MeshBuilder builder("benchmark.obj");
+    parseOBJ(source, builder);
+
+    std::vector<uint8_t> data;
+    benchmarkLoop(
+        "MeshBuilder::build (large)",
+        [&] () {
+            builder.build(data);
+        });
+}
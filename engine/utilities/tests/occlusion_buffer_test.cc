@@ -0,0 +1,446 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Occlusion buffer tests.
+ *
+ * Views look down negative Z from the origin. Rasterised depths are checked
+ * against depths calculated by casting a ray through each pixel centre, which
+ * must never be further than the depth in the buffer.
+ */
+
+#include "test.h"
+
+#include "render/occlusion_buffer.h"
+
+#include <random>
+
+/** Parameters of the view used for tests. */
+static const float kZNear = 0.1f;
+static const float kZFar  = 1000.0f;
+
+/** Get the test view-projection matrix.
+ * @param eye           Position of the view.
+ * @param target        Point to look at.
+ * @return              View-projection matrix. */
+static glm::mat4 getViewProjection(const glm::vec3 &eye = glm::vec3(0.0f),
+                                   const glm::vec3 &target = glm::vec3(0.0f, 0.0f, -1.0f))
+{
+    const float aspect = static_cast<float>(OcclusionBuffer::kWidth) / OcclusionBuffer::kHeight;
+
+    return glm::perspective(glm::radians(60.0f), aspect, kZNear, kZFar) *
+           glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+/**
+ * Get the ray through the centre of a pixel.
+ *
+ * @param inverseViewProjection Inverse of the view-projection matrix.
+ * @param x             X coordinate of the pixel.
+ * @param y             Y coordinate of the pixel (from the bottom).
+ * @param outOrigin     Where to store the ray origin (on the near plane).
+ * @param outDirection  Where to store the ray direction.
+ */
+static void getPixelRay(const glm::mat4 &inverseViewProjection,
+                        uint32_t x,
+                        uint32_t y,
+                        glm::vec3 &outOrigin,
+                        glm::vec3 &outDirection)
+{
+    const glm::vec2 ndc(((x + 0.5f) / OcclusionBuffer::kWidth) * 2.0f - 1.0f,
+                        ((y + 0.5f) / OcclusionBuffer::kHeight) * 2.0f - 1.0f);
+
+    glm::vec4 near = inverseViewProjection * glm::vec4(ndc, 0.0f, 1.0f);
+    glm::vec4 far  = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+
+    outOrigin    = glm::vec3(near) / near.w;
+    outDirection = glm::normalize((glm::vec3(far) / far.w) - outOrigin);
+}
+
+/** Get the depth buffer value of a world space point.
+ * @param viewProjection View-projection matrix.
+ * @param point         Point to get depth of.
+ * @return              Depth of the point. */
+static float getDepth(const glm::mat4 &viewProjection, const glm::vec3 &point) {
+    glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+    return clip.z / clip.w;
+}
+
+/**
+ * Check rasterised depths against a horizontal plane.
+ *
+ * Checks every pixel of the depth buffer against a rectangle on a horizontal
+ * plane. Every pixel whose centre sees the rectangle must be written, with a
+ * depth no nearer than the depth at the pixel centre, and every other pixel
+ * must be clear.
+ *
+ * @param buffer        Buffer to check.
+ * @param viewProjection View-projection matrix.
+ * @param height        Height of the plane.
+ * @param minimum       Minimum X/Z coordinate of the rectangle.
+ * @param maximum       Maximum X/Z coordinate of the rectangle.
+ *
+ * @return              Number of pixels covered.
+ */
+static size_t checkPlaneDepth(const OcclusionBuffer &buffer,
+                              const glm::mat4 &viewProjection,
+                              float height,
+                              const glm::vec2 &minimum,
+                              const glm::vec2 &maximum)
+{
+    const glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+
+    size_t numCovered = 0;
+    for (uint32_t y = 0; y < OcclusionBuffer::kHeight; y++) {
+        for (uint32_t x = 0; x < OcclusionBuffer::kWidth; x++) {
+            glm::vec3 origin, direction;
+            getPixelRay(inverseViewProjection, x, y, origin, direction);
+
+            const float depth = buffer.depth(0, x, y);
+
+            /* Ignore pixels whose centre is too close to the edge of the
+             * rectangle or the horizon to say whether it is covered. */
+            float t = (height - origin.y) / direction.y;
+            glm::vec3 hit = origin + (direction * t);
+            const float kMargin = 0.01f;
+            if (t <= 0.0f ||
+                hit.x < minimum.x - kMargin || hit.x > maximum.x + kMargin ||
+                hit.z < minimum.y - kMargin || hit.z > maximum.y + kMargin)
+            {
+                expectMsg(depth == 1.0f, "Pixel (%u, %u) written outside occluder", x, y);
+            } else if (hit.x > minimum.x + kMargin && hit.x < maximum.x - kMargin &&
+                       hit.z > minimum.y + kMargin && hit.z < maximum.y - kMargin &&
+                       getDepth(viewProjection, hit) < 0.9999f)
+            {
+                numCovered++;
+
+                const float expected = getDepth(viewProjection, hit);
+                expectMsg(depth >= expected * 0.99999f,
+                          "Pixel (%u, %u) depth %.7f nearer than occluder %.7f",
+                          x, y, depth, expected);
+                expectMsg(depth < 1.0f, "Pixel (%u, %u) not covered", x, y);
+            }
+        }
+    }
+
+    return numCovered;
+}
+
+/** Add a horizontal rectangle occluder, facing upwards.
+ * @param buffer        Buffer to add to.
+ * @param height        Height of the plane.
+ * @param minimum       Minimum X/Z coordinate of the rectangle.
+ * @param maximum       Maximum X/Z coordinate of the rectangle. */
+static void addPlane(OcclusionBuffer &buffer, float height, const glm::vec2 &minimum, const glm::vec2 &maximum) {
+    const glm::vec3 vertices[] = {
+        glm::vec3(minimum.x, height, minimum.y),
+        glm::vec3(minimum.x, height, maximum.y),
+        glm::vec3(maximum.x, height, maximum.y),
+        glm::vec3(maximum.x, height, minimum.y),
+    };
+    const uint16_t indices[] = { 0, 1, 2, 0, 2, 3 };
+
+    buffer.addOccluder(glm::mat4(), vertices, indices, arraySize(indices));
+}
+
+TEST(OcclusionBufferEmpty) {
+    OcclusionBuffer buffer;
+    buffer.begin(getViewProjection());
+    buffer.finish();
+
+    expect(buffer.numLevels() == 9);
+    expect(buffer.depth(buffer.numLevels() - 1, 0, 0) == 1.0f);
+    expect(!buffer.isOccluded(BoundingBox(glm::vec3(-1.0f, -1.0f, -20.0f), glm::vec3(1.0f, 1.0f, -18.0f))));
+}
+
+TEST(OcclusionBufferNearPlane) {
+    /* A ground plane extending from behind the view, looking slightly down,
+     * so that its triangles cross the near plane. */
+    const glm::mat4 viewProjection = getViewProjection(glm::vec3(0.0f), glm::vec3(0.0f, -0.3f, -1.0f));
+    const glm::vec2 minimum(-200.0f, -300.0f);
+    const glm::vec2 maximum(200.0f, 50.0f);
+
+    OcclusionBuffer buffer;
+    buffer.begin(viewProjection);
+    addPlane(buffer, -1.0f, minimum, maximum);
+    buffer.finish();
+
+    size_t numCovered = checkPlaneDepth(buffer, viewProjection, -1.0f, minimum, maximum);
+    printf("  %zu pixels covered by ground plane\n", numCovered);
+    expect(numCovered > (OcclusionBuffer::kWidth * OcclusionBuffer::kHeight) / 2);
+
+    /* Every level of the pyramid holds the furthest depth below it. */
+    for (unsigned level = 1; level < buffer.numLevels(); level++) {
+        for (uint32_t y = 0; y < std::max(OcclusionBuffer::kHeight >> level, 1u); y++) {
+            for (uint32_t x = 0; x < std::max(OcclusionBuffer::kWidth >> level, 1u); x++) {
+                float furthest = 0.0f;
+                for (uint32_t sy = y << level; sy < std::min((y + 1) << level, OcclusionBuffer::kHeight); sy++) {
+                    for (uint32_t sx = x << level; sx < std::min((x + 1) << level, OcclusionBuffer::kWidth); sx++)
+                        furthest = std::max(furthest, buffer.depth(0, sx, sy));
+                }
+
+                expect(buffer.depth(level, x, y) == furthest);
+            }
+        }
+    }
+
+    /* Boxes just above the plane are never occluded. Boxes below it within
+     * the plane's extent and in view should be, as long as they are far
+     * enough below that the plane covers their projected rectangle at a
+     * nearer depth (boxes only just below the plane at a grazing angle are
+     * conservatively kept). */
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unitX(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> unitZ(-150.0f, -2.0f);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+
+    const Frustum frustum(viewProjection, glm::inverse(viewProjection));
+
+    size_t numBelow = 0, numBelowOccluded = 0;
+    for (unsigned i = 0; i < 2000; i++) {
+        glm::vec3 position(unitX(random), 0.0f, unitZ(random));
+        glm::vec3 extent(size(random), size(random), size(random));
+
+        BoundingBox above(glm::vec3(position.x, -0.99f, position.z), glm::vec3(position.x, -0.99f, position.z) + extent);
+        expectMsg(!buffer.isOccluded(above), "Box above plane at (%g, %g) occluded", position.x, position.z);
+
+        BoundingBox below(glm::vec3(position.x, -5.0f, position.z) - extent, glm::vec3(position.x, -5.0f, position.z));
+        if (Math::intersect(frustum, below)) {
+            numBelow++;
+            if (buffer.isOccluded(below))
+                numBelowOccluded++;
+        }
+    }
+
+    printf("  %zu of %zu boxes below plane occluded\n", numBelowOccluded, numBelow);
+    expect(numBelow > 0);
+    expect(numBelowOccluded == numBelow);
+
+    /* Boxes crossing the near plane are never occluded. */
+    expect(!buffer.isOccluded(BoundingBox(glm::vec3(-1.0f, -3.0f, -1.0f), glm::vec3(1.0f, -1.5f, 1.0f))));
+}
+
+TEST(OcclusionBufferFullyCovered) {
+    const glm::mat4 viewProjection = getViewProjection();
+
+    /* A wall covering the entire view. */
+    OcclusionBuffer buffer;
+    buffer.begin(viewProjection);
+    buffer.addOccluder(BoundingBox(glm::vec3(-100.0f, -100.0f, -11.0f), glm::vec3(100.0f, 100.0f, -10.0f)));
+    buffer.finish();
+
+    bool allCovered = true;
+    for (uint32_t y = 0; y < OcclusionBuffer::kHeight; y++) {
+        for (uint32_t x = 0; x < OcclusionBuffer::kWidth; x++)
+            allCovered &= buffer.depth(0, x, y) < 1.0f;
+    }
+
+    expect(allCovered);
+    expect(buffer.depth(buffer.numLevels() - 1, 0, 0) >= getDepth(viewProjection, glm::vec3(0.0f, 0.0f, -10.0f)));
+
+    /* Boxes behind the wall are occluded, whatever their size on screen. */
+    expect(buffer.isOccluded(BoundingBox(glm::vec3(-0.1f, -0.1f, -20.1f), glm::vec3(0.1f, 0.1f, -20.0f))));
+    expect(buffer.isOccluded(BoundingBox(glm::vec3(-5.0f, -5.0f, -30.0f), glm::vec3(5.0f, 5.0f, -20.0f))));
+    expect(buffer.isOccluded(BoundingBox(glm::vec3(-50.0f, -50.0f, -30.0f), glm::vec3(50.0f, 50.0f, -12.0f))));
+    expect(buffer.isOccluded(BoundingBox(glm::vec3(20.0f, 5.0f, -60.0f), glm::vec3(25.0f, 8.0f, -50.0f))));
+
+    /* Boxes in front of or intersecting the wall are not. */
+    expect(!buffer.isOccluded(BoundingBox(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -5.0f))));
+    expect(!buffer.isOccluded(BoundingBox(glm::vec3(-1.0f, -1.0f, -12.0f), glm::vec3(1.0f, 1.0f, -9.5f))));
+    expect(!buffer.isOccluded(BoundingBox(glm::vec3(-1.0f, -1.0f, -9.99f), glm::vec3(1.0f, 1.0f, -9.9f))));
+
+    /* Boxes outside the view are left to frustum culling. */
+    expect(!buffer.isOccluded(BoundingBox(glm::vec3(-1.0f, -1.0f, 10.0f), glm::vec3(1.0f, 1.0f, 12.0f))));
+    expect(!buffer.isOccluded(BoundingBox(glm::vec3(500.0f, -1.0f, -20.0f), glm::vec3(502.0f, 1.0f, -18.0f))));
+}
+
+TEST(OcclusionBufferPartial) {
+    const glm::mat4 viewProjection = getViewProjection();
+
+    /* A wall covering the left half of the view, added as a transformed unit
+     * cube mesh. */
+    glm::vec3 corners[8];
+    for (unsigned i = 0; i < 8; i++)
+        corners[i] = glm::vec3((i & 1) ? 1.0f : 0.0f, (i & 2) ? 1.0f : 0.0f, (i & 4) ? 1.0f : 0.0f);
+
+    glm::mat4 transform = glm::translate(glm::mat4(), glm::vec3(-100.0f, -100.0f, -11.0f));
+    transform = glm::scale(transform, glm::vec3(100.0f, 200.0f, 1.0f));
+
+    OcclusionBuffer buffer;
+    buffer.begin(viewProjection);
+    buffer.addOccluder(transform, corners, OcclusionBuffer::kBoxIndices, arraySize(OcclusionBuffer::kBoxIndices));
+    buffer.finish();
+
+    /* Check the coverage of the wall's front face. */
+    const glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+    for (uint32_t y = 0; y < OcclusionBuffer::kHeight; y++) {
+        for (uint32_t x = 0; x < OcclusionBuffer::kWidth; x++) {
+            const bool covered = x < OcclusionBuffer::kWidth / 2;
+
+            if (covered) {
+                glm::vec3 origin, direction;
+                getPixelRay(inverseViewProjection, x, y, origin, direction);
+                glm::vec3 hit = origin + (direction * ((-10.0f - origin.z) / direction.z));
+
+                expectMsg(buffer.depth(0, x, y) >= getDepth(viewProjection, hit) * 0.99999f,
+                          "Pixel (%u, %u) nearer than occluder", x, y);
+            }
+
+            expectMsg((buffer.depth(0, x, y) < 1.0f) == covered, "Pixel (%u, %u) coverage incorrect", x, y);
+        }
+    }
+
+    /* Behind the wall. */
+    expect(buffer.isOccluded(BoundingBox(glm::vec3(-4.0f, -1.0f, -21.0f), glm::vec3(-2.0f, 1.0f, -20.0f))));
+    expect(buffer.isOccluded(BoundingBox(glm::vec3(-40.0f, -10.0f, -80.0f), glm::vec3(-1.0f, 10.0f, -20.0f))));
+
+    /* Crossing the edge of the wall. */
+    expect(!buffer.isOccluded(BoundingBox(glm::vec3(-2.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -20.0f))));
+    expect(!buffer.isOccluded(BoundingBox(glm::vec3(-40.0f, -10.0f, -80.0f), glm::vec3(0.5f, 10.0f, -20.0f))));
+
+    /* In the uncovered half. */
+    expect(!buffer.isOccluded(BoundingBox(glm::vec3(2.0f, -1.0f, -21.0f), glm::vec3(4.0f, 1.0f, -20.0f))));
+}
+
+TEST(OcclusionBufferDeterministic) {
+    const glm::mat4 viewProjection = getViewProjection(glm::vec3(0.0f), glm::vec3(0.2f, -0.2f, -1.0f));
+
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<BoundingBox> boxes;
+    for (unsigned i = 0; i < 100; i++) {
+        glm::vec3 position(unit(random) * 30.0f, unit(random) * 10.0f, (unit(random) * 40.0f) - 45.0f);
+        glm::vec3 extent(std::abs(unit(random)) * 5.0f + 0.1f);
+        boxes.emplace_back(position - extent, position + extent);
+    }
+
+    OcclusionBuffer a, b;
+    for (OcclusionBuffer *buffer : { &a, &b }) {
+        buffer->begin(viewProjection);
+        for (const BoundingBox &box : boxes)
+            buffer->addOccluder(box);
+        buffer->finish();
+    }
+
+    bool matches = true;
+    for (unsigned level = 0; level < a.numLevels(); level++) {
+        for (uint32_t y = 0; y < std::max(OcclusionBuffer::kHeight >> level, 1u); y++) {
+            for (uint32_t x = 0; x < std::max(OcclusionBuffer::kWidth >> level, 1u); x++)
+                matches &= a.depth(level, x, y) == b.depth(level, x, y);
+        }
+    }
+
+    expect(matches);
+}
+
+/** Generate random boxes for benchmarks.
+ * @param count         Number of boxes.
+ * @param seed          Random seed.
+ * @return              Generated boxes. */
+static std::vector<BoundingBox> generateBoxes(unsigned count, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<BoundingBox> boxes;
+    for (unsigned i = 0; i < count; i++) {
+        glm::vec3 position(unit(random) * 50.0f, unit(random) * 10.0f, (unit(random) * 95.0f) - 100.0f);
+        glm::vec3 extent(std::abs(unit(random)) * 3.0f + 0.1f);
+        boxes.emplace_back(position - extent, position + extent);
+    }
+
+    return boxes;
+}
+
+BENCHMARK(OcclusionBufferRasterise) {
+    const glm::mat4 viewProjection = getViewProjection(glm::vec3(0.0f), glm::vec3(0.0f, -0.3f, -1.0f));
+    const std::vector<BoundingBox> occluders = generateBoxes(256, 1);
+
+    OcclusionBuffer buffer;
+
+    benchmarkLoop(
+        "addOccluder (256 boxes)",
+        [&] () {
+            buffer.begin(viewProjection);
+            for (const BoundingBox &box : occluders)
+                buffer.addOccluder(box);
+            buffer.finish();
+        });
+
+    /* A ground grid running from behind the view, with a row of triangles
+     * crossing the near plane. */
+    std::vector<glm::vec3> vertices;
+    std::vector<uint16_t> indices;
+    for (unsigned z = 0; z <= 32; z++) {
+        for (unsigned x = 0; x <= 32; x++)
+            vertices.emplace_back((x * 10.0f) - 160.0f, -1.0f, 10.0f - (z * 10.0f));
+    }
+
+    for (uint16_t z = 0; z < 32; z++) {
+        for (uint16_t x = 0; x < 32; x++) {
+            uint16_t a = (z * 33) + x;
+            indices.insert(indices.end(), { a, static_cast<uint16_t>(a + 1), static_cast<uint16_t>(a + 34) });
+            indices.insert(indices.end(), { a, static_cast<uint16_t>(a + 34), static_cast<uint16_t>(a + 33) });
+        }
+    }
+
+    benchmarkLoop(
+        "addOccluder (grid crossing near plane)",
+        [&] () {
+            buffer.begin(viewProjection);
+            buffer.addOccluder(glm::mat4(), vertices.data(), indices.data(), indices.size());
+            buffer.finish();
+        });
+
+    /* Building the pyramid alone, which does not depend on the content. */
+    benchmarkLoop(
+        "finish",
+        [&] () {
+            buffer.finish();
+        });
+}
+
+BENCHMARK(OcclusionBufferTest) {
+    const glm::mat4 viewProjection = getViewProjection();
+    const std::vector<BoundingBox> boxes = generateBoxes(10000, 2);
+
+    /* Fully covered, so that every test has to look at the pyramid. */
+    OcclusionBuffer buffer;
+    buffer.begin(viewProjection);
+    buffer.addOccluder(BoundingBox(glm::vec3(-1000.0f, -1000.0f, -3.0f), glm::vec3(1000.0f, 1000.0f, -2.0f)));
+    buffer.finish();
+
+    benchmarkLoop(
+        "isOccluded (10000 boxes, covered)",
+        [&] () {
+            for (const BoundingBox &box : boxes)
+                buffer.isOccluded(box);
+        });
+
+    /* Partially covered, so that some tests stop early. */
+    buffer.begin(viewProjection);
+    buffer.addOccluder(BoundingBox(glm::vec3(-1000.0f, -1000.0f, -3.0f), glm::vec3(0.0f, 1000.0f, -2.0f)));
+    buffer.finish();
+
+    benchmarkLoop(
+        "isOccluded (10000 boxes, half covered)",
+        [&] () {
+            for (const BoundingBox &box : boxes)
+                buffer.isOccluded(box);
+        });
+}
@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Render graph tests.
+ *
+ * Only compilation is tested, since it does not need a GPU. Imported textures
+ * are given null images, which is fine as nothing looks at them until the
+ * graph is executed.
+ */
+
+#include "test.h"
+
+#include "render/render_graph.h"
+
+#include <random>
+
+/** Get a 2D texture descriptor.
+ * @param width         Width of the texture.
+ * @param height        Height of the texture.
+ * @param format        Format of the texture.
+ * @return              Texture descriptor. */
+static GPUTextureDesc textureDesc(uint32_t width, uint32_t height, PixelFormat format = PixelFormat::kR8G8B8A8) {
+    return GPUTextureDesc().
+        setType   (GPUTexture::kTexture2D).
+        setWidth  (width).
+        setHeight (height).
+        setDepth  (1).
+        setMips   (1).
+        setFormat (format).
+        setFlags  (GPUTexture::kRenderTarget);
+}
+
+TEST(RenderGraphCulling) {
+    RenderGraph graph;
+
+    const GPUTextureDesc desc = textureDesc(64, 64);
+    RenderGraph::ResourceHandle target = graph.importTexture("target", GPUTextureImageRef());
+    RenderGraph::ResourceHandle a      = graph.createTexture("a", desc);
+    RenderGraph::ResourceHandle b      = graph.createTexture("b", desc);
+    RenderGraph::ResourceHandle c      = graph.createTexture("c", desc);
+    RenderGraph::ResourceHandle d      = graph.createTexture("d", desc);
+
+    /* 0: Writes a, which is used by 3. */
+    graph.addPass("writeA").setColourAttachment(0, a, GPURenderLoadOp::kClear);
+
+    /* 1, 2: Write b, then c from b, neither of which is used. */
+    graph.addPass("writeB").setColourAttachment(0, b, GPURenderLoadOp::kClear);
+    RenderGraph::Pass &writeC = graph.addPass("writeC");
+    writeC.setColourAttachment(0, c, GPURenderLoadOp::kClear);
+    writeC.addInput(b);
+
+    /* 3: Writes the target from a. */
+    RenderGraph::Pass &final = graph.addPass("final");
+    final.setColourAttachment(0, target);
+    final.addInput(a);
+
+    /* 4: Writes d after it has last been used. */
+    graph.addPass("writeD").setColourAttachment(0, d, GPURenderLoadOp::kClear);
+
+    graph.compile();
+
+    expect(!graph.pass(0).culled());
+    expect(graph.pass(1).culled());
+    expect(graph.pass(2).culled());
+    expect(!graph.pass(3).culled());
+    expect(graph.pass(4).culled());
+
+    /* Only a needs a texture. */
+    expect(graph.numPhysicalTextures() == 1);
+    expect(graph.physicalTexture(a) == 0);
+    expect(graph.physicalTexture(b) == -1);
+    expect(graph.physicalTexture(c) == -1);
+    expect(graph.physicalTexture(d) == -1);
+}
+
+TEST(RenderGraphOverwriteCulling) {
+    RenderGraph graph;
+
+    const GPUTextureDesc desc = textureDesc(64, 64);
+    RenderGraph::ResourceHandle target = graph.importTexture("target", GPUTextureImageRef());
+    RenderGraph::ResourceHandle a      = graph.createTexture("a", desc);
+
+    /* 1 overwrites the contents written by 0 without reading them, so 0 is
+     * not needed. 2 then adds to the contents of 1 before it is used. */
+    graph.addPass("clear0").setColourAttachment(0, a, GPURenderLoadOp::kClear);
+    graph.addPass("clear1").setColourAttachment(0, a, GPURenderLoadOp::kClear);
+    graph.addPass("add").setColourAttachment(0, a, GPURenderLoadOp::kLoad);
+
+    RenderGraph::Pass &final = graph.addPass("final");
+    final.setColourAttachment(0, target);
+    final.addInput(a);
+
+    graph.compile();
+
+    expect(graph.pass(0).culled());
+    expect(!graph.pass(1).culled());
+    expect(!graph.pass(2).culled());
+    expect(!graph.pass(3).culled());
+}
+
+TEST(RenderGraphNoWrites) {
+    RenderGraph graph;
+
+    const GPUTextureDesc desc = textureDesc(64, 64);
+    RenderGraph::ResourceHandle target = graph.importTexture("target", GPUTextureImageRef());
+    RenderGraph::ResourceHandle a      = graph.createTexture("a", desc);
+
+    graph.addPass("writeA").setColourAttachment(0, a, GPURenderLoadOp::kClear);
+
+    /* A pass with nothing declared, and one which only reads, are always
+     * culled, even though they come after resources they could use. */
+    graph.addPass("empty");
+    graph.addPass("readOnly").addInput(a);
+    graph.addPass("readTarget").addInput(target);
+
+    /* Declaring an output keeps it. */
+    RenderGraph::Pass &blit = graph.addPass("blit");
+    blit.addInput(a);
+    blit.addOutput(target);
+
+    graph.compile();
+
+    expect(!graph.pass(0).culled());
+    expect(graph.pass(1).culled());
+    expect(graph.pass(2).culled());
+    expect(graph.pass(3).culled());
+    expect(!graph.pass(4).culled());
+}
+
+TEST(RenderGraphImported) {
+    RenderGraph graph;
+
+    RenderGraph::ResourceHandle target = graph.importTexture("target", GPUTextureImageRef());
+    RenderGraph::ResourceHandle atlas  = graph.importTexture("atlas", GPUTextureImageRef());
+    RenderGraph::ResourceHandle unused = graph.importTexture("unused", GPUTextureImageRef());
+
+    /* Passes writing imported resources are kept even though nothing in the
+     * frame reads them, including earlier writes to the same resource since
+     * they may only write part of it. */
+    RenderGraph::Pass &tile0 = graph.addPass("tile0");
+    tile0.setDepthStencilAttachment(atlas, GPURenderLoadOp::kClear);
+    tile0.setRenderArea(IntRect(0, 0, 32, 32));
+    RenderGraph::Pass &tile1 = graph.addPass("tile1");
+    tile1.setDepthStencilAttachment(atlas, GPURenderLoadOp::kClear);
+    tile1.setRenderArea(IntRect(32, 0, 32, 32));
+    graph.addPass("clearTarget").setColourAttachment(0, target, GPURenderLoadOp::kClear);
+    graph.addPass("drawTarget").setColourAttachment(0, target, GPURenderLoadOp::kLoad);
+
+    graph.compile();
+
+    for (size_t i = 0; i < graph.numPasses(); i++)
+        expectMsg(!graph.pass(i).culled(), "Pass %s culled", graph.pass(i).name().c_str());
+
+    /* Imported resources keep their declared load operation, and are always
+     * stored. */
+    expect(graph.pass(0).depthStencilAttachment().loadOp == GPURenderLoadOp::kClear);
+    expect(graph.pass(0).depthStencilAttachment().storeOp == GPURenderStoreOp::kStore);
+    expect(graph.pass(1).depthStencilAttachment().storeOp == GPURenderStoreOp::kStore);
+    expect(graph.pass(2).colourAttachments()[0].loadOp == GPURenderLoadOp::kClear);
+    expect(graph.pass(2).colourAttachments()[0].storeOp == GPURenderStoreOp::kStore);
+    expect(graph.pass(3).colourAttachments()[0].loadOp == GPURenderLoadOp::kLoad);
+    expect(graph.pass(3).colourAttachments()[0].storeOp == GPURenderStoreOp::kStore);
+
+    /* Imported resources never get a physical texture. */
+    expect(graph.numPhysicalTextures() == 0);
+    expect(graph.physicalTexture(target) == -1);
+    expect(graph.physicalTexture(atlas) == -1);
+    expect(graph.physicalTexture(unused) == -1);
+}
+
+TEST(RenderGraphLoadStoreOps) {
+    RenderGraph graph;
+
+    RenderGraph::ResourceHandle target = graph.importTexture("target", GPUTextureImageRef());
+    RenderGraph::ResourceHandle colour = graph.createTexture("colour", textureDesc(64, 64));
+    RenderGraph::ResourceHandle depth  = graph.createTexture("depth", textureDesc(64, 64, PixelFormat::kDepth32Stencil8));
+    RenderGraph::ResourceHandle never  = graph.createTexture("never", textureDesc(64, 64));
+
+    /* 0: Depth pre-pass. Declared as loading, but nothing has been written
+     * yet, so there is nothing to load. */
+    graph.addPass("depth").setDepthStencilAttachment(depth, GPURenderLoadOp::kLoad);
+
+    /* 1: Main pass, uses the depth buffer but does not need it after. */
+    RenderGraph::Pass &main = graph.addPass("main");
+    main.setColourAttachment(0, colour, GPURenderLoadOp::kClear);
+    main.setDepthStencilAttachment(depth, GPURenderLoadOp::kLoad);
+
+    /* 2: Composite onto the target, with a scratch attachment that is never
+     * written before or read after. */
+    RenderGraph::Pass &composite = graph.addPass("composite");
+    composite.setColourAttachment(0, target, GPURenderLoadOp::kLoad);
+    composite.setColourAttachment(1, never, GPURenderLoadOp::kLoad);
+    composite.addInput(colour);
+
+    graph.compile();
+
+    for (size_t i = 0; i < graph.numPasses(); i++)
+        expectMsg(!graph.pass(i).culled(), "Pass %s culled", graph.pass(i).name().c_str());
+
+    const RenderGraph::Attachment &depthPrePass = graph.pass(0).depthStencilAttachment();
+    expect(depthPrePass.loadOp == GPURenderLoadOp::kDontCare);
+    expect(depthPrePass.storeOp == GPURenderStoreOp::kStore);
+
+    const RenderGraph::Attachment &mainColour = graph.pass(1).colourAttachments()[0];
+    expect(mainColour.loadOp == GPURenderLoadOp::kClear);
+    expect(mainColour.storeOp == GPURenderStoreOp::kStore);
+
+    const RenderGraph::Attachment &mainDepth = graph.pass(1).depthStencilAttachment();
+    expect(mainDepth.loadOp == GPURenderLoadOp::kLoad);
+    expect(mainDepth.storeOp == GPURenderStoreOp::kDontCare);
+
+    const RenderGraph::Attachment &compositeTarget = graph.pass(2).colourAttachments()[0];
+    expect(compositeTarget.loadOp == GPURenderLoadOp::kLoad);
+    expect(compositeTarget.storeOp == GPURenderStoreOp::kStore);
+
+    const RenderGraph::Attachment &compositeNever = graph.pass(2).colourAttachments()[1];
+    expect(compositeNever.loadOp == GPURenderLoadOp::kDontCare);
+    expect(compositeNever.storeOp == GPURenderStoreOp::kDontCare);
+}
+
+TEST(RenderGraphAliasing) {
+    RenderGraph graph;
+
+    const GPUTextureDesc descA = textureDesc(64, 64);
+    const GPUTextureDesc descB = textureDesc(32, 32);
+
+    RenderGraph::ResourceHandle target = graph.importTexture("target", GPUTextureImageRef());
+    RenderGraph::ResourceHandle a0     = graph.createTexture("a0", descA);
+    RenderGraph::ResourceHandle a1     = graph.createTexture("a1", descA);
+    RenderGraph::ResourceHandle a2     = graph.createTexture("a2", descA);
+    RenderGraph::ResourceHandle b0     = graph.createTexture("b0", descB);
+    RenderGraph::ResourceHandle unused = graph.createTexture("unused", descA);
+
+    /* Lifetimes:
+     *   a0: 0-1
+     *   b0: 1-2 (different descriptor to a0)
+     *   a1: 2-3 (can reuse a0's texture)
+     *   a2: 3-4 (overlaps a1, which now has a0's texture, so needs another)
+     */
+    graph.addPass("0").setColourAttachment(0, a0, GPURenderLoadOp::kClear);
+
+    RenderGraph::Pass &pass1 = graph.addPass("1");
+    pass1.setColourAttachment(0, b0, GPURenderLoadOp::kClear);
+    pass1.addInput(a0);
+
+    RenderGraph::Pass &pass2 = graph.addPass("2");
+    pass2.setColourAttachment(0, a1, GPURenderLoadOp::kClear);
+    pass2.addInput(b0);
+
+    RenderGraph::Pass &pass3 = graph.addPass("3");
+    pass3.setColourAttachment(0, a2, GPURenderLoadOp::kClear);
+    pass3.addInput(a1);
+
+    RenderGraph::Pass &pass4 = graph.addPass("4");
+    pass4.setColourAttachment(0, target);
+    pass4.addInput(a2);
+
+    graph.compile();
+
+    expect(graph.numPhysicalTextures() == 3);
+    expect(graph.physicalTexture(a1) == graph.physicalTexture(a0));
+    expect(graph.physicalTexture(b0) != graph.physicalTexture(a0));
+    expect(graph.physicalTexture(a2) != graph.physicalTexture(a1));
+    expect(graph.physicalTexture(a2) != graph.physicalTexture(b0));
+    expect(graph.physicalTexture(unused) == -1);
+}
+
+/**
+ * Build a random graph.
+ *
+ * Builds a graph of passes which each write to one or two random resources,
+ * and read from some resources written earlier, with the last pass writing to
+ * an imported target.
+ *
+ * @param graph         Graph to build.
+ * @param numPasses     Number of passes.
+ * @param numResources  Number of transient resources.
+ * @param seed          Random seed.
+ * @param outDescs      Where to store the descriptor of each resource.
+ * @param outInputs     Where to store the inputs of each pass.
+ */
+static void buildRandomGraph(RenderGraph &graph,
+                             unsigned numPasses,
+                             unsigned numResources,
+                             unsigned seed,
+                             std::vector<GPUTextureDesc> &outDescs,
+                             std::vector<std::vector<RenderGraph::ResourceHandle>> &outInputs)
+{
+    std::mt19937 random(seed);
+
+    const GPUTextureDesc descs[] = {
+        textureDesc(64, 64),
+        textureDesc(32, 32),
+        textureDesc(64, 64, PixelFormat::kFloatR16G16B16A16),
+    };
+
+    RenderGraph::ResourceHandle target = graph.importTexture("target", GPUTextureImageRef());
+    outDescs.emplace_back();
+
+    std::vector<RenderGraph::ResourceHandle> resources;
+    for (unsigned i = 0; i < numResources; i++) {
+        outDescs.emplace_back(descs[random() % arraySize(descs)]);
+        resources.emplace_back(graph.createTexture("resource", outDescs.back()));
+    }
+
+    const GPURenderLoadOp loadOps[] = { GPURenderLoadOp::kLoad, GPURenderLoadOp::kClear, GPURenderLoadOp::kDontCare };
+
+    for (unsigned i = 0; i < numPasses; i++) {
+        RenderGraph::Pass &pass = graph.addPass("pass");
+
+        unsigned numWrites = 1 + (random() % 2);
+        for (unsigned j = 0; j < numWrites; j++)
+            pass.setColourAttachment(j, resources[random() % resources.size()], loadOps[random() % 3]);
+
+        outInputs.emplace_back();
+
+        unsigned numReads = random() % 3;
+        for (unsigned j = 0; j < numReads; j++) {
+            outInputs.back().emplace_back(resources[random() % resources.size()]);
+            pass.addInput(outInputs.back().back());
+        }
+    }
+
+    RenderGraph::Pass &final = graph.addPass("final");
+    final.setColourAttachment(0, target);
+    outInputs.emplace_back();
+    for (unsigned j = 0; j < 4; j++) {
+        outInputs.back().emplace_back(resources[random() % resources.size()]);
+        final.addInput(outInputs.back().back());
+    }
+}
+
+TEST(RenderGraphRandom) {
+    /* Check invariants on random graphs: only resources used by passes which
+     * are kept get a physical texture, and resources sharing a physical
+     * texture have the same descriptor and never have overlapping lifetimes. */
+    size_t numAliased = 0, numCulled = 0;
+
+    for (unsigned seed = 0; seed < 100; seed++) {
+        RenderGraph graph;
+        std::vector<GPUTextureDesc> descs;
+        std::vector<std::vector<RenderGraph::ResourceHandle>> inputs;
+        buildRandomGraph(graph, 40, 30, seed, descs, inputs);
+        graph.compile();
+
+        /* Calculate lifetimes from the passes that were kept. */
+        std::vector<int> firstPass(descs.size(), -1);
+        std::vector<int> lastPass(descs.size(), -1);
+
+        for (size_t i = 0; i < graph.numPasses(); i++) {
+            const RenderGraph::Pass &pass = graph.pass(i);
+            if (pass.culled()) {
+                numCulled++;
+                continue;
+            }
+
+            /* Nothing should be loaded before it has been written. */
+            for (const RenderGraph::Attachment &attachment : pass.colourAttachments()) {
+                if (attachment.loadOp == GPURenderLoadOp::kLoad && attachment.resource != 0)
+                    expect(firstPass[attachment.resource] >= 0);
+            }
+
+            auto use = [&] (RenderGraph::ResourceHandle resource) {
+                if (firstPass[resource] < 0)
+                    firstPass[resource] = i;
+                lastPass[resource] = i;
+            };
+
+            for (const RenderGraph::Attachment &attachment : pass.colourAttachments())
+                use(attachment.resource);
+            for (RenderGraph::ResourceHandle resource : inputs[i])
+                use(resource);
+        }
+
+        expect(!graph.pass(graph.numPasses() - 1).culled());
+
+        for (size_t a = 1; a < descs.size(); a++) {
+            const int physicalA = graph.physicalTexture(a);
+            expect((physicalA >= 0) == (firstPass[a] >= 0));
+
+            if (physicalA < 0)
+                continue;
+
+            expect(static_cast<size_t>(physicalA) < graph.numPhysicalTextures());
+
+            for (size_t b = a + 1; b < descs.size(); b++) {
+                if (graph.physicalTexture(b) != physicalA)
+                    continue;
+
+                numAliased++;
+                expect(descs[a] == descs[b]);
+                expectMsg(lastPass[a] < firstPass[b] || lastPass[b] < firstPass[a],
+                          "Seed %u: resources %zu and %zu overlap but share a texture", seed, a, b);
+            }
+        }
+    }
+
+    printf("  %zu aliased pairs, %zu passes culled\n", numAliased, numCulled);
+
+    expect(numAliased > 0);
+    expect(numCulled > 0);
+}
+
+BENCHMARK(RenderGraphCompile) {
+    benchmarkLoop(
+        "build and compile (500 passes, 200 resources)",
+        [&] () {
+            RenderGraph graph;
+            std::vector<GPUTextureDesc> descs;
+            std::vector<std::vector<RenderGraph::ResourceHandle>> inputs;
+            buildRandomGraph(graph, 500, 200, 1, descs, inputs);
+            graph.compile();
+        });
+}
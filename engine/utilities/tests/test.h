@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Test and benchmark framework.
+ *
+ * Tests and benchmarks are functions defined with the TEST() and BENCHMARK()
+ * macros, which register themselves with the test program so that they are
+ * run without needing to be listed anywhere else. Tests use expect() to check
+ * conditions: unlike check(), a failure is recorded and the test continues,
+ * so that all failures in a test are reported at once.
+ *
+ * Benchmarks use benchmarkLoop() to time a piece of code, which runs the code
+ * repeatedly until enough time has passed to give a stable measurement, and
+ * reports the average time per iteration.
+ */
+
+#pragma once
+
+#include "core/core.h"
+
+#include <functional>
+#include <vector>
+
+/** Registered test or benchmark. */
+struct TestCase {
+    const char *name;                   /**< Name of the test. */
+    void (*function)();                 /**< Function implementing the test. */
+};
+
+extern std::vector<TestCase> &testCases();
+extern std::vector<TestCase> &benchmarkCases();
+
+extern void testFailure(const char *file, int line, const char *fmt, ...);
+extern void benchmarkLoop(const char *name, const std::function<void ()> &function);
+
+/** Helper to register a test case from a static initialiser. */
+struct TestRegistration {
+    TestRegistration(std::vector<TestCase> &cases, const char *name, void (*function)()) {
+        cases.push_back({name, function});
+    }
+};
+
+/**
+ * Define a test.
+ *
+ * Defines a test function, which should be followed by the function body. The
+ * test passes if no expect() within it fails.
+ *
+ * @param name          Name of the test (must be a valid identifier).
+ */
+#define TEST(name) \
+    static void test_##name(); \
+    static TestRegistration g_testRegistration_##name(testCases(), #name, test_##name); \
+    static void test_##name()
+
+/**
+ * Define a benchmark.
+ *
+ * Defines a benchmark function, which should be followed by the function
+ * body. Benchmarks are only run when requested on the command line, and
+ * should time the code they measure with benchmarkLoop().
+ *
+ * @param name          Name of the benchmark (must be a valid identifier).
+ */
+#define BENCHMARK(name) \
+    static void benchmark_##name(); \
+    static TestRegistration g_benchmarkRegistration_##name(benchmarkCases(), #name, benchmark_##name); \
+    static void benchmark_##name()
+
+/**
+ * Check a condition in a test.
+ *
+ * If the condition is false, a failure is recorded for the current test and
+ * the test continues.
+ *
+ * @param cond          Condition to check.
+ */
+#define expect(cond) \
+    do { \
+        if (!(cond)) \
+            testFailure(__FILE__, __LINE__, "Expected: %s", #cond); \
+    } while (0)
+
+/**
+ * Check a condition in a test, with a message.
+ *
+ * @param cond          Condition to check.
+ * @param fmt           Failure message format string.
+ * @param ...           Arguments to substitute into format.
+ */
+#define expectMsg(cond, fmt, ...) \
+    do { \
+        if (!(cond)) \
+            testFailure(__FILE__, __LINE__, fmt, ##__VA_ARGS__); \
+    } while (0)
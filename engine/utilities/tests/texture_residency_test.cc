@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Texture residency tests.
+ */
+
+#include "test.h"
+
+#include "engine/texture_residency.h"
+
+#include <algorithm>
+
+/** Mip sizes of a 4 level texture with 4:1 ratios between levels. */
+static const std::vector<uint64_t> kMipSizes = {1024, 256, 64, 16};
+
+TEST(TextureResidencyRequest) {
+    TextureResidency texture(kMipSizes, 2);
+
+    expect(texture.residentMip == 2);
+    expect(texture.targetMip == 2);
+    expect(texture.size(0) == 1360);
+    expect(texture.size(3) == 16);
+
+    /* Requests within a frame are combined. */
+    texture.request(2, 1);
+    texture.request(1, 1);
+    texture.request(3, 1);
+    expect(texture.requestedMip == 1);
+    expect(texture.requestFrame == 1);
+
+    /* A new frame replaces earlier requests. */
+    texture.request(3, 2);
+    expect(texture.requestedMip == 3);
+
+    /* Out of range requests are clamped to the smallest level. */
+    texture.request(10, 3);
+    expect(texture.requestedMip == 3);
+}
+
+TEST(TextureResidencyFitsBudget) {
+    TextureResidency a(kMipSizes, 2);
+    TextureResidency b(kMipSizes, 2);
+    a.request(0, 1);
+    b.request(1, 1);
+
+    TextureResidencyStats stats;
+    calculateTextureResidency({&a, &b}, 1000000, stats);
+
+    expect(a.targetMip == 0);
+    expect(b.targetMip == 1);
+    expect(stats.requestedSize == 1360 + 336);
+    expect(stats.targetSize == stats.requestedSize);
+    expect(stats.numLimited == 0);
+
+    /* The resident level is left for the caller to change. */
+    expect(a.residentMip == 2);
+    expect(b.residentMip == 2);
+}
+
+TEST(TextureResidencyBaseAlwaysResident) {
+    TextureResidency texture(kMipSizes, 2);
+    texture.request(0, 1);
+
+    /* The base levels exceed the budget but must still be kept. */
+    TextureResidencyStats stats;
+    calculateTextureResidency({&texture}, 0, stats);
+
+    expect(texture.targetMip == 2);
+    expect(stats.targetSize == 80);
+    expect(stats.requestedSize == 1360);
+    expect(stats.numLimited == 1);
+
+    /* Requesting a smaller level than the base does not evict it. */
+    texture.request(3, 2);
+    calculateTextureResidency({&texture}, 1000000, stats);
+
+    expect(texture.targetMip == 2);
+    expect(stats.requestedSize == 80);
+    expect(stats.numLimited == 0);
+}
+
+TEST(TextureResidencyBudgetRespected) {
+    std::vector<TextureResidency> textures(8, TextureResidency(kMipSizes, 2));
+    std::vector<TextureResidency *> pointers;
+    for (TextureResidency &texture : textures) {
+        texture.request(0, 1);
+        pointers.push_back(&texture);
+    }
+
+    for (uint64_t budget = 0; budget < 8 * 1360 + 100; budget += 37) {
+        TextureResidencyStats stats;
+        calculateTextureResidency(pointers, budget, stats);
+
+        uint64_t total = 0;
+        for (const TextureResidency &texture : textures)
+            total += texture.size(texture.targetMip);
+
+        expect(stats.targetSize == total);
+        expectMsg(total <= std::max(budget, uint64_t(8 * 80)),
+                  "Budget %llu exceeded (%llu)",
+                  static_cast<unsigned long long>(budget),
+                  static_cast<unsigned long long>(total));
+    }
+}
+
+TEST(TextureResidencyContiguous) {
+    /* Level 1 does not fit but level 0 would on its own: it must not be
+     * added, since that would leave a gap. */
+    TextureResidency texture({8, 1000, 4}, 2);
+    texture.request(0, 1);
+
+    TextureResidencyStats stats;
+    calculateTextureResidency({&texture}, 100, stats);
+
+    expect(texture.targetMip == 2);
+    expect(stats.targetSize == 4);
+    expect(stats.numLimited == 1);
+}
+
+TEST(TextureResidencyRecentFirst) {
+    TextureResidency old(kMipSizes, 2);
+    TextureResidency recent(kMipSizes, 2);
+    old.request(0, 1);
+    recent.request(0, 2);
+
+    /* Only enough for one texture's levels beyond the base. */
+    TextureResidencyStats stats;
+    calculateTextureResidency({&old, &recent}, 80 + 1360, stats);
+
+    expect(recent.targetMip == 0);
+    expect(old.targetMip == 2);
+    expect(stats.numLimited == 1);
+
+    /* With memory to spare the old texture keeps its levels. */
+    calculateTextureResidency({&old, &recent}, 2 * 1360, stats);
+
+    expect(recent.targetMip == 0);
+    expect(old.targetMip == 0);
+    expect(stats.numLimited == 0);
+}
+
+TEST(TextureResidencySmallerFirst) {
+    TextureResidency a(kMipSizes, 2);
+    TextureResidency b(kMipSizes, 2);
+    a.request(0, 1);
+    b.request(0, 1);
+
+    /* There is enough for one texture to have level 0, but memory should be
+     * shared so that both get level 1 instead. */
+    TextureResidencyStats stats;
+    calculateTextureResidency({&a, &b}, 80 + 1360, stats);
+
+    expect(a.targetMip == 1);
+    expect(b.targetMip == 1);
+    expect(stats.targetSize == 2 * 336);
+    expect(stats.numLimited == 2);
+
+    /* Calculating again with the same inputs gives the same result. */
+    calculateTextureResidency({&a, &b}, 80 + 1360, stats);
+
+    expect(a.targetMip == 1);
+    expect(b.targetMip == 1);
+}
@@ -0,0 +1,421 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               TGA parser tests.
+ *
+ * The vectorised BGR expansion is compared against a scalar implementation at
+ * every row width up to a few times the vector width, with the source placed
+ * directly before an inaccessible page (where supported) so that any read
+ * past the end of the row crashes the test.
+ */
+
+#include "test.h"
+
+#include "../../runtime/engine/src/loaders/tga_parser.h"
+
+#include <random>
+#include <vector>
+
+#include <string.h>
+
+#ifdef ORION_PLATFORM_LINUX
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+/**
+ * Buffer which cannot be read past the end.
+ *
+ * Allocates a buffer which is immediately followed by an inaccessible page,
+ * so that reading past the end faults rather than silently reading other
+ * data. On platforms where this is not supported, this is a normal buffer.
+ */
+class GuardedBuffer : Noncopyable {
+public:
+    /** Allocate the buffer.
+     * @param size          Size of the buffer. */
+    explicit GuardedBuffer(size_t size) : m_size(size) {
+        #ifdef ORION_PLATFORM_LINUX
+            size_t pageSize = sysconf(_SC_PAGESIZE);
+            m_mappingSize = (((size + pageSize - 1) / pageSize) + 1) * pageSize;
+
+            void *mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            check(mapping != MAP_FAILED);
+
+            m_mapping = reinterpret_cast<uint8_t *>(mapping);
+            mprotect(m_mapping + m_mappingSize - pageSize, pageSize, PROT_NONE);
+
+            m_data = m_mapping + m_mappingSize - pageSize - size;
+        #else
+            m_mapping = new uint8_t[size];
+            m_data    = m_mapping;
+        #endif
+    }
+
+    /** Free the buffer. */
+    ~GuardedBuffer() {
+        #ifdef ORION_PLATFORM_LINUX
+            munmap(m_mapping, m_mappingSize);
+        #else
+            delete[] m_mapping;
+        #endif
+    }
+
+    /** @return             Pointer to the buffer. */
+    uint8_t *data() const { return m_data; }
+
+    /** @return             Size of the buffer. */
+    size_t size() const { return m_size; }
+
+private:
+    uint8_t *m_mapping;                 /**< Allocation containing the buffer. */
+    uint8_t *m_data;                    /**< Start of the buffer. */
+    size_t m_size;                      /**< Size of the buffer. */
+
+    #ifdef ORION_PLATFORM_LINUX
+        size_t m_mappingSize;           /**< Size of the mapping. */
+    #endif
+};
+
+/** Scalar BGR to BGRA expansion to compare against.
+ * @param source        Source pixels.
+ * @param dest          Destination pixels.
+ * @param count         Number of pixels. */
+static void referenceExpandBGRToBGRA(const uint8_t *source, uint8_t *dest, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dest[(i * 4) + 0] = source[(i * 3) + 0];
+        dest[(i * 4) + 1] = source[(i * 3) + 1];
+        dest[(i * 4) + 2] = source[(i * 3) + 2];
+        dest[(i * 4) + 3] = 255;
+    }
+}
+
+/** Fill a buffer with random bytes.
+ * @param data          Buffer to fill.
+ * @param size          Size of the buffer.
+ * @param random        Random number generator. */
+static void fillRandom(uint8_t *data, size_t size, std::mt19937 &random) {
+    for (size_t i = 0; i < size; i++)
+        data[i] = static_cast<uint8_t>(random());
+}
+
+/**
+ * Encode pixels with TGA RLE compression.
+ *
+ * Encodes runs of at least a minimum length as run-length packets and
+ * everything else as raw packets. Packets are allowed to cross rows.
+ *
+ * @param pixels        Pixels to encode.
+ * @param pixelSize     Bytes per pixel.
+ * @param numPixels     Number of pixels.
+ * @param minRun        Minimum length of a run to encode as a run packet.
+ *
+ * @return              Encoded data.
+ */
+static std::vector<uint8_t> encodeRLE(const uint8_t *pixels, size_t pixelSize, size_t numPixels, size_t minRun) {
+    std::vector<uint8_t> output;
+
+    auto samePixel = [&] (size_t a, size_t b) {
+        return memcmp(pixels + (a * pixelSize), pixels + (b * pixelSize), pixelSize) == 0;
+    };
+
+    size_t i = 0;
+    while (i < numPixels) {
+        size_t run = 1;
+        while (i + run < numPixels && run < 128 && samePixel(i, i + run))
+            run++;
+
+        if (run >= minRun) {
+            output.push_back(static_cast<uint8_t>(0x80 | (run - 1)));
+            output.insert(output.end(), pixels + (i * pixelSize), pixels + ((i + 1) * pixelSize));
+            i += run;
+        } else {
+            /* Raw packet up to the start of the next run. */
+            size_t count = 1;
+            while (i + count < numPixels && count < 128) {
+                size_t next = 1;
+                while (i + count + next < numPixels && next < minRun && samePixel(i + count, i + count + next))
+                    next++;
+
+                if (next >= minRun)
+                    break;
+
+                count++;
+            }
+
+            output.push_back(static_cast<uint8_t>(count - 1));
+            output.insert(output.end(), pixels + (i * pixelSize), pixels + ((i + count) * pixelSize));
+            i += count;
+        }
+    }
+
+    return output;
+}
+
+/**
+ * Generate pixels with runs of repeated values.
+ *
+ * Generates random pixels where each pixel has a chance of repeating the
+ * previous one, giving a mix of runs and unique pixels like typical
+ * compressible image content.
+ *
+ * @param pixelSize     Bytes per pixel.
+ * @param numPixels     Number of pixels.
+ * @param repeat        Probability of a pixel repeating the previous one.
+ * @param random        Random number generator.
+ *
+ * @return              Generated pixels.
+ */
+static std::vector<uint8_t> generatePixels(size_t pixelSize, size_t numPixels, float repeat, std::mt19937 &random) {
+    std::vector<uint8_t> pixels(pixelSize * numPixels);
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+    for (size_t i = 0; i < numPixels; i++) {
+        if (i > 0 && chance(random) < repeat) {
+            memcpy(&pixels[i * pixelSize], &pixels[(i - 1) * pixelSize], pixelSize);
+        } else {
+            fillRandom(&pixels[i * pixelSize], pixelSize, random);
+        }
+    }
+
+    return pixels;
+}
+
+/**
+ * Build a TGA file.
+ *
+ * @param width         Image width.
+ * @param height        Image height.
+ * @param depth         Bits per pixel (24 or 32).
+ * @param topToBottom   Whether the top row is first.
+ * @param rle           Whether to RLE compress the pixels.
+ * @param pixels        Pixel data, in file row order.
+ *
+ * @return              File data.
+ */
+static std::vector<uint8_t> buildTGA(uint16_t width,
+                                     uint16_t height,
+                                     uint8_t depth,
+                                     bool topToBottom,
+                                     bool rle,
+                                     const std::vector<uint8_t> &pixels)
+{
+    std::vector<uint8_t> file(18, 0);
+    file[2]  = (rle) ? 10 : 2;
+    file[12] = width & 0xff;
+    file[13] = width >> 8;
+    file[14] = height & 0xff;
+    file[15] = height >> 8;
+    file[16] = depth;
+    file[17] = (topToBottom) ? (1 << 5) : 0;
+
+    if (rle) {
+        std::vector<uint8_t> encoded = encodeRLE(pixels.data(), depth / 8, width * height, 2);
+        file.insert(file.end(), encoded.begin(), encoded.end());
+    } else {
+        file.insert(file.end(), pixels.begin(), pixels.end());
+    }
+
+    return file;
+}
+
+TEST(TGAExpandBGRToBGRA) {
+    std::mt19937 random(1);
+
+    /* Cover every remainder of a few vector widths, for each of which the
+     * source row ends exactly at an inaccessible page. */
+    for (size_t width = 0; width <= 67; width++) {
+        GuardedBuffer source(width * 3);
+        fillRandom(source.data(), source.size(), random);
+
+        /* Check that destination writes stay within the row too. */
+        std::vector<uint8_t> dest((width * 4) + 16, 0xcd);
+        std::vector<uint8_t> expected((width * 4) + 16, 0xcd);
+
+        expandBGRToBGRA(source.data(), dest.data(), width);
+        referenceExpandBGRToBGRA(source.data(), expected.data(), width);
+
+        expectMsg(dest == expected, "Output differs from scalar at width %zu", width);
+    }
+}
+
+TEST(TGADecodeRLE) {
+    std::mt19937 random(2);
+
+    for (size_t pixelSize : { 3, 4 }) {
+        for (float repeat : { 0.0f, 0.5f, 0.95f, 1.0f }) {
+            for (size_t numPixels : { 1, 7, 127, 128, 129, 1000 }) {
+                std::vector<uint8_t> pixels = generatePixels(pixelSize, numPixels, repeat, random);
+                std::vector<uint8_t> encoded = encodeRLE(pixels.data(), pixelSize, numPixels, 2);
+
+                /* Place the data at the end of a guarded buffer so that reading
+                 * past the end of the last packet faults. */
+                GuardedBuffer source(encoded.size());
+                memcpy(source.data(), encoded.data(), encoded.size());
+
+                std::vector<uint8_t> decoded(pixels.size());
+                bool result = decodeTGARLE("test.tga", source.data(), source.size(), pixelSize, numPixels, decoded.data());
+
+                expectMsg(result && decoded == pixels,
+                          "Decoding failed (pixel size %zu, repeat %g, %zu pixels)",
+                          pixelSize, repeat, numPixels);
+            }
+        }
+    }
+
+    /* Truncated data and packets overflowing the image are rejected. */
+    const uint8_t kRawTruncated[] = { 0x02, 1, 2, 3, 4, 5, 6 };
+    const uint8_t kRunTruncated[] = { 0x81, 1, 2 };
+    const uint8_t kMissingPacket[] = { 0x80, 1, 2, 3 };
+    const uint8_t kOverflow[] = { 0x82, 1, 2, 3 };
+
+    uint8_t dest[3 * 3];
+
+    expect(!decodeTGARLE("test.tga", kRawTruncated, sizeof(kRawTruncated), 3, 3, dest));
+    expect(!decodeTGARLE("test.tga", kRunTruncated, sizeof(kRunTruncated), 3, 2, dest));
+    expect(!decodeTGARLE("test.tga", kMissingPacket, sizeof(kMissingPacket), 3, 2, dest));
+    expect(!decodeTGARLE("test.tga", kOverflow, sizeof(kOverflow), 3, 2, dest));
+}
+
+TEST(TGAParse) {
+    std::mt19937 random(3);
+
+    for (uint8_t depth : { 24, 32 }) {
+        const size_t pixelSize = depth / 8;
+
+        for (bool rle : { false, true }) {
+            for (bool topToBottom : { false, true }) {
+                for (uint16_t width : { 1, 3, 5, 17, 33 }) {
+                    const uint16_t height = 3;
+
+                    std::vector<uint8_t> pixels = generatePixels(pixelSize, width * height, 0.5f, random);
+                    std::vector<uint8_t> file = buildTGA(width, height, depth, topToBottom, rle, pixels);
+
+                    /* Uncompressed data ends exactly at the end of the file. */
+                    GuardedBuffer data(file.size());
+                    memcpy(data.data(), file.data(), file.size());
+
+                    uint32_t outWidth, outHeight;
+                    std::unique_ptr<uint8_t []> outPixels;
+                    bool result = parseTGA("test.tga", data.data(), data.size(), outWidth, outHeight, outPixels);
+
+                    expect(result);
+                    if (!result)
+                        continue;
+
+                    expect(outWidth == width && outHeight == height);
+
+                    /* Output is BGRA with the bottom row first. */
+                    bool matches = true;
+                    for (uint32_t y = 0; y < height; y++) {
+                        uint32_t sourceY = (topToBottom) ? height - y - 1 : y;
+
+                        for (uint32_t x = 0; x < width; x++) {
+                            const uint8_t *source = &pixels[((sourceY * width) + x) * pixelSize];
+                            const uint8_t *dest   = &outPixels[((y * width) + x) * 4];
+
+                            if (memcmp(source, dest, 3) != 0 || dest[3] != ((depth == 24) ? 255 : source[3]))
+                                matches = false;
+                        }
+                    }
+
+                    expectMsg(matches,
+                              "Pixels differ (depth %u, RLE %d, top to bottom %d, width %u)",
+                              depth, rle, topToBottom, width);
+                }
+            }
+        }
+    }
+
+    /* Truncated uncompressed data is rejected. */
+    std::vector<uint8_t> pixels(4 * 4 * 3, 0);
+    std::vector<uint8_t> file = buildTGA(4, 4, 24, false, false, pixels);
+    file.pop_back();
+
+    uint32_t outWidth, outHeight;
+    std::unique_ptr<uint8_t []> outPixels;
+    expect(!parseTGA("test.tga", file.data(), file.size(), outWidth, outHeight, outPixels));
+}
+
+/** Size of images used for benchmarks. */
+static const uint16_t kBenchmarkSize = 2048;
+
+BENCHMARK(TGAExpandBGRToBGRA) {
+    std::mt19937 random(1);
+
+    const size_t numPixels = kBenchmarkSize * kBenchmarkSize;
+    std::vector<uint8_t> source(numPixels * 3);
+    std::vector<uint8_t> dest(numPixels * 4);
+    fillRandom(source.data(), source.size(), random);
+
+    benchmarkLoop(
+        "expandBGRToBGRA (2048x2048)",
+        [&] () {
+            for (size_t y = 0; y < kBenchmarkSize; y++) {
+                expandBGRToBGRA(&source[y * kBenchmarkSize * 3],
+                                &dest[y * kBenchmarkSize * 4],
+                                kBenchmarkSize);
+            }
+        });
+
+    benchmarkLoop(
+        "scalar (2048x2048)",
+        [&] () {
+            for (size_t y = 0; y < kBenchmarkSize; y++) {
+                referenceExpandBGRToBGRA(&source[y * kBenchmarkSize * 3],
+                                         &dest[y * kBenchmarkSize * 4],
+                                         kBenchmarkSize);
+            }
+        });
+}
+
+BENCHMARK(TGADecodeRLE) {
+    std::mt19937 random(2);
+
+    const size_t numPixels = kBenchmarkSize * kBenchmarkSize;
+    std::vector<uint8_t> dest(numPixels * 3);
+
+    for (float repeat : { 0.5f, 0.95f }) {
+        std::vector<uint8_t> pixels = generatePixels(3, numPixels, repeat, random);
+        std::vector<uint8_t> encoded = encodeRLE(pixels.data(), 3, numPixels, 2);
+
+        benchmarkLoop(
+            (repeat < 0.9f) ? "decodeTGARLE (2048x2048, 50% repeats)" : "decodeTGARLE (2048x2048, 95% repeats)",
+            [&] () {
+                decodeTGARLE("benchmark.tga", encoded.data(), encoded.size(), 3, numPixels, dest.data());
+            });
+    }
+}
+
+BENCHMARK(TGAParse) {
+    std::mt19937 random(3);
+
+    for (bool rle : { false, true }) {
+        std::vector<uint8_t> pixels = generatePixels(3, kBenchmarkSize * kBenchmarkSize, 0.9f, random);
+        std::vector<uint8_t> file = buildTGA(kBenchmarkSize, kBenchmarkSize, 24, false, rle, pixels);
+
+        benchmarkLoop(
+            (rle) ? "parseTGA (2048x2048 24bpp RLE)" : "parseTGA (2048x2048 24bpp)",
+            [&] () {
+                uint32_t width, height;
+                std::unique_ptr<uint8_t []> outPixels;
+                parseTGA("benchmark.tga", file.data(), file.size(), width, height, outPixels);
+            });
+    }
+}
@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Block compression encoder.
+ *
+ * This implements encoders for the BC1, BC3, BC4 and BC5 formats. Colour
+ * endpoints are chosen by fitting a line through the block's colours along
+ * their principal axis, and then refined with a least squares fit to the
+ * chosen indices. Single channel endpoints are the channel's range within the
+ * block. This is fast and gives reasonable quality, but is not as good as an
+ * exhaustive search.
+ *
+ * BC7 is not implemented: its mode and partition search is considerably more
+ * involved. BC7 textures produced by other tools can still be loaded.
+ */
+
+#include "bc_encoder.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <string.h>
+
+/** Number of pixels in a block. */
+static const size_t kBlockPixels = 16;
+
+/** Expand a 5 or 6 bit value to 8 bits.
+ * @param value         Value to expand.
+ * @param bits          Number of bits in the value. */
+static inline float expandBits(unsigned value, unsigned bits) {
+    return static_cast<float>((value << (8 - bits)) | (value >> (2 * bits - 8)));
+}
+
+/** Quantise a colour to 5:6:5.
+ * @param colour        Colour to quantise (0-255 per component).
+ * @return              Quantised colour. */
+static uint16_t quantise565(const glm::vec3 &colour) {
+    glm::vec3 clamped = glm::clamp(colour, glm::vec3(0.0f), glm::vec3(255.0f));
+    unsigned r = static_cast<unsigned>(clamped.x * (31.0f / 255.0f) + 0.5f);
+    unsigned g = static_cast<unsigned>(clamped.y * (63.0f / 255.0f) + 0.5f);
+    unsigned b = static_cast<unsigned>(clamped.z * (31.0f / 255.0f) + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+/** Expand a 5:6:5 colour to 0-255 components.
+ * @param value         Quantised colour.
+ * @return              Expanded colour. */
+static glm::vec3 expand565(uint16_t value) {
+    return glm::vec3(expandBits((value >> 11) & 0x1f, 5),
+                     expandBits((value >> 5) & 0x3f, 6),
+                     expandBits(value & 0x1f, 5));
+}
+
+/** Choose indices for a colour block given its endpoints.
+ * @param colours       Colours of the block.
+ * @param endpoints     Quantised endpoints (first must be greater).
+ * @param indices       Where to store the palette index for each pixel.
+ * @return              Total squared error. */
+static float chooseColourIndices(const glm::vec3 *colours, const uint16_t *endpoints, uint8_t *indices) {
+    glm::vec3 palette[4];
+    palette[0] = expand565(endpoints[0]);
+    palette[1] = expand565(endpoints[1]);
+    palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+    palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+
+    float totalError = 0.0f;
+
+    for (size_t i = 0; i < kBlockPixels; i++) {
+        float bestError = std::numeric_limits<float>::max();
+
+        for (uint8_t j = 0; j < 4; j++) {
+            glm::vec3 diff = colours[i] - palette[j];
+            float error = glm::dot(diff, diff);
+            if (error < bestError) {
+                bestError = error;
+                indices[i] = j;
+            }
+        }
+
+        totalError += bestError;
+    }
+
+    return totalError;
+}
+
+/** Calculate endpoints which best fit a set of indices.
+ * @param colours       Colours of the block.
+ * @param indices       Palette index for each pixel.
+ * @param outEndpoints  Where to store endpoint colours.
+ * @return              Whether a fit was found (false if all indices refer to
+ *                      the same endpoint weight). */
+static bool fitColourEndpoints(const glm::vec3 *colours, const uint8_t *indices, glm::vec3 *outEndpoints) {
+    /* Weight of the first endpoint for each palette entry. */
+    static const float kWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    /* Solve the normal equations for colour = a * first + b * second. */
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    glm::vec3 ax(0.0f), bx(0.0f);
+
+    for (size_t i = 0; i < kBlockPixels; i++) {
+        float a = kWeights[indices[i]];
+        float b = 1.0f - a;
+
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        ax += a * colours[i];
+        bx += b * colours[i];
+    }
+
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f)
+        return false;
+
+    outEndpoints[0] = (ax * bb - bx * ab) / det;
+    outEndpoints[1] = (bx * aa - ax * ab) / det;
+    return true;
+}
+
+/** Encode a block of colours in BC1 format (4 colour mode).
+ * @param pixels        RGBA pixels of the block.
+ * @param output        Where to write the 8 byte block. */
+static void encodeColourBlock(const uint8_t *pixels, uint8_t *output) {
+    glm::vec3 colours[kBlockPixels];
+    glm::vec3 mean(0.0f);
+    glm::vec3 minColour(255.0f), maxColour(0.0f);
+
+    for (size_t i = 0; i < kBlockPixels; i++) {
+        colours[i] = glm::vec3(pixels[i * 4 + 0], pixels[i * 4 + 1], pixels[i * 4 + 2]);
+        mean += colours[i];
+        minColour = glm::min(minColour, colours[i]);
+        maxColour = glm::max(maxColour, colours[i]);
+    }
+
+    mean /= static_cast<float>(kBlockPixels);
+
+    /* Find the principal axis of the colours by power iteration on their
+     * covariance matrix, starting from the diagonal of their bounding box. */
+    glm::mat3 covariance(0.0f);
+    for (size_t i = 0; i < kBlockPixels; i++) {
+        glm::vec3 diff = colours[i] - mean;
+        covariance += glm::outerProduct(diff, diff);
+    }
+
+    glm::vec3 axis = maxColour - minColour;
+    for (unsigned i = 0; i < 8; i++) {
+        glm::vec3 next = covariance * axis;
+        float length = glm::length(next);
+        if (length < 1e-6f)
+            break;
+
+        axis = next / length;
+    }
+
+    /* Endpoints are the extreme colours along the axis, inset slightly since
+     * the extremes are rarely hit exactly. */
+    glm::vec3 endpoints[2];
+    if (glm::dot(axis, axis) > 1e-6f) {
+        float minProj = std::numeric_limits<float>::max();
+        float maxProj = -std::numeric_limits<float>::max();
+
+        for (size_t i = 0; i < kBlockPixels; i++) {
+            float proj = glm::dot(colours[i] - mean, axis);
+            minProj = std::min(minProj, proj);
+            maxProj = std::max(maxProj, proj);
+        }
+
+        float inset = (maxProj - minProj) / 16.0f;
+        endpoints[0] = mean + axis * (maxProj - inset);
+        endpoints[1] = mean + axis * (minProj + inset);
+    } else {
+        endpoints[0] = endpoints[1] = mean;
+    }
+
+    uint16_t quantised[2] = { quantise565(endpoints[0]), quantise565(endpoints[1]) };
+    if (quantised[0] < quantised[1])
+        std::swap(quantised[0], quantised[1]);
+
+    uint8_t indices[kBlockPixels];
+
+    if (quantised[0] == quantised[1]) {
+        memset(indices, 0, sizeof(indices));
+    } else {
+        float error = chooseColourIndices(colours, quantised, indices);
+
+        /* Refine the endpoints to best fit the chosen indices, keeping the
+         * result if it improves the error. */
+        for (unsigned iteration = 0; iteration < 2; iteration++) {
+            glm::vec3 fitted[2];
+            if (!fitColourEndpoints(colours, indices, fitted))
+                break;
+
+            uint16_t refined[2] = { quantise565(fitted[0]), quantise565(fitted[1]) };
+            if (refined[0] < refined[1])
+                std::swap(refined[0], refined[1]);
+            if (refined[0] == refined[1])
+                break;
+
+            uint8_t refinedIndices[kBlockPixels];
+            float refinedError = chooseColourIndices(colours, refined, refinedIndices);
+            if (refinedError >= error)
+                break;
+
+            error = refinedError;
+            quantised[0] = refined[0];
+            quantised[1] = refined[1];
+            memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    uint32_t indexBits = 0;
+    for (size_t i = 0; i < kBlockPixels; i++)
+        indexBits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+
+    output[0] = quantised[0] & 0xff;
+    output[1] = quantised[0] >> 8;
+    output[2] = quantised[1] & 0xff;
+    output[3] = quantised[1] >> 8;
+    output[4] = indexBits & 0xff;
+    output[5] = (indexBits >> 8) & 0xff;
+    output[6] = (indexBits >> 16) & 0xff;
+    output[7] = (indexBits >> 24) & 0xff;
+}
+
+/** Encode a block of a single channel in BC4 format (8 value mode).
+ * @param pixels        RGBA pixels of the block.
+ * @param channel       Channel to encode.
+ * @param output        Where to write the 8 byte block. */
+static void encodeChannelBlock(const uint8_t *pixels, unsigned channel, uint8_t *output) {
+    uint8_t minValue = 255, maxValue = 0;
+    for (size_t i = 0; i < kBlockPixels; i++) {
+        minValue = std::min(minValue, pixels[i * 4 + channel]);
+        maxValue = std::max(maxValue, pixels[i * 4 + channel]);
+    }
+
+    uint64_t indexBits = 0;
+
+    if (maxValue != minValue) {
+        float scale = 7.0f / static_cast<float>(maxValue - minValue);
+
+        for (size_t i = 0; i < kBlockPixels; i++) {
+            /* Position between the endpoints, 0 (minimum) to 7 (maximum). The
+             * first two palette entries are the endpoints, followed by the
+             * interpolated values from the maximum to the minimum. */
+            unsigned step = static_cast<unsigned>((pixels[i * 4 + channel] - minValue) * scale + 0.5f);
+            uint64_t index;
+            if (step == 7) {
+                index = 0;
+            } else if (step == 0) {
+                index = 1;
+            } else {
+                index = 8 - step;
+            }
+
+            indexBits |= index << (i * 3);
+        }
+    }
+
+    output[0] = maxValue;
+    output[1] = minValue;
+    for (size_t i = 0; i < 6; i++)
+        output[2 + i] = (indexBits >> (i * 8)) & 0xff;
+}
+
+/**
+ * Compress an image.
+ *
+ * Compresses an image to a block compressed format. Blocks at the edges of
+ * images whose dimensions are not a multiple of 4 are padded by repeating the
+ * edge pixels.
+ *
+ * @param format        Format to compress to (BC1, BC3, BC4 or BC5).
+ * @param width         Width of the image.
+ * @param height        Height of the image.
+ * @param pixels        Pixel data, in PixelFormat::kR8G8B8A8 format.
+ * @param output        Where to write compressed data (must be
+ *                      PixelFormat::imageSize() bytes).
+ */
+void compressImage(PixelFormat format,
+                   uint32_t width,
+                   uint32_t height,
+                   const uint8_t *pixels,
+                   uint8_t *output)
+{
+    const size_t blockSize = PixelFormat::bytesPerBlock(format);
+
+    for (uint32_t blockY = 0; blockY < height; blockY += 4) {
+        for (uint32_t blockX = 0; blockX < width; blockX += 4) {
+            uint8_t block[kBlockPixels * 4];
+
+            for (uint32_t y = 0; y < 4; y++) {
+                uint32_t sourceY = std::min(blockY + y, height - 1);
+
+                for (uint32_t x = 0; x < 4; x++) {
+                    uint32_t sourceX = std::min(blockX + x, width - 1);
+                    memcpy(&block[(y * 4 + x) * 4], &pixels[(sourceY * width + sourceX) * 4], 4);
+                }
+            }
+
+            switch (format) {
+                case PixelFormat::kBC1:
+                case PixelFormat::kBC1sRGB:
+                    encodeColourBlock(block, output);
+                    break;
+                case PixelFormat::kBC3:
+                case PixelFormat::kBC3sRGB:
+                    encodeChannelBlock(block, 3, output);
+                    encodeColourBlock(block, output + 8);
+                    break;
+                case PixelFormat::kBC4:
+                    encodeChannelBlock(block, 0, output);
+                    break;
+                case PixelFormat::kBC5:
+                    encodeChannelBlock(block, 0, output);
+                    encodeChannelBlock(block, 1, output + 8);
+                    break;
+                default:
+                    unreachable();
+            }
+
+            output += blockSize;
+        }
+    }
+}
@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2017 Alex Smith
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * @brief               Texture cooking tool.
+ *
+ * This tool converts a texture source file to a DDS texture (see
+ * loaders/dds_file.h) with a full chain of pre-built mip levels, usually in a
+ * block compressed format. Cooked textures are loaded by the engine without
+ * any processing, either by DDSLoader from a ".dds" file, or by any other 2D
+ * texture loader if the source file is replaced with the cooked data.
+ *
+ * By default, images without alpha are compressed to BC1, and images with
+ * alpha to BC3. Another format can be chosen with -f: BC4 and BC5 are suited
+ * to single channel images and normal maps respectively, and "rgba" stores the
+ * image uncompressed. Colour data is assumed to be sRGB, which is taken into
+ * account when generating mip levels and recorded in the output, unless -l is
+ * given. BC4 and BC5 are always linear.
+ */
+
+#include "core/filesystem.h"
+#include "core/log.h"
+
+#include "../../runtime/engine/src/loaders/dds_file.h"
+#include "../../runtime/engine/src/loaders/tga_parser.h"
+
+#include "bc_encoder.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Parse a texture source file.
+ * @param path          Path to the source file.
+ * @param width         Where to store image width.
+ * @param height        Where to store image height.
+ * @param pixels        Where to store pixel data (PixelFormat::kR8G8B8A8).
+ * @return              Whether successful. */
+static bool parseTexture(const char *path, uint32_t &width, uint32_t &height, std::unique_ptr<uint8_t []> &pixels) {
+    std::unique_ptr<File> input(Filesystem::openFile(path));
+    if (!input) {
+        fprintf(stderr, "Failed to open '%s'\n", path);
+        return false;
+    }
+
+    uint64_t size = input->size();
+
+    const void *data = input->data();
+    std::unique_ptr<uint8_t []> buffer;
+    if (!data && size) {
+        buffer.reset(new uint8_t[size]);
+        if (!input->read(buffer.get(), size)) {
+            fprintf(stderr, "Failed to read '%s'\n", path);
+            return false;
+        }
+
+        data = buffer.get();
+    }
+
+    std::string extension = Path(path).extension();
+    if (extension == "tga") {
+        if (!parseTGA(path, data, size, width, height, pixels))
+            return false;
+
+        /* The parser gives BGRA, swap to RGBA for the encoder. */
+        for (size_t i = 0; i < width * height; i++)
+            std::swap(pixels[(i * 4) + 0], pixels[(i * 4) + 2]);
+
+        return true;
+    } else {
+        fprintf(stderr, "Unsupported texture format '%s'\n", extension.c_str());
+        return false;
+    }
+}
+
+/** Convert an sRGB value to linear.
+ * @param value         Value to convert (0-255).
+ * @return              Linear value (0-1). */
+static float sRGBToLinear(uint8_t value) {
+    float v = static_cast<float>(value) / 255.0f;
+    return (v <= 0.04045f) ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+/** Convert a linear value to sRGB.
+ * @param value         Value to convert (0-1).
+ * @return              sRGB value (0-1). */
+static float linearToSRGB(float value) {
+    return (value <= 0.0031308f) ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+/**
+ * Generate the next mip level of an image.
+ *
+ * Each pixel of the result is the average of a 2x2 block of pixels of the
+ * source. If the source has an odd dimension, the last row or column is
+ * folded into the previous one. Colour values are averaged in linear space if
+ * the data is sRGB.
+ *
+ * @param source        Source pixels (RGBA).
+ * @param width         Source width, updated to the result width.
+ * @param height        Source height, updated to the result height.
+ * @param sRGB          Whether the colour values are sRGB.
+ * @param dest          Where to store result pixels.
+ */
+static void generateMip(const uint8_t *source,
+                        uint32_t &width,
+                        uint32_t &height,
+                        bool sRGB,
+                        std::unique_ptr<uint8_t []> &dest)
+{
+    float toLinear[256];
+    for (unsigned i = 0; i < 256; i++)
+        toLinear[i] = (sRGB) ? sRGBToLinear(i) : static_cast<float>(i) / 255.0f;
+
+    uint32_t destWidth  = std::max(width / 2, 1u);
+    uint32_t destHeight = std::max(height / 2, 1u);
+
+    dest.reset(new uint8_t[destWidth * destHeight * 4]);
+
+    for (uint32_t y = 0; y < destHeight; y++) {
+        uint32_t y0 = std::min(y * 2, height - 1);
+        uint32_t y1 = (y == destHeight - 1) ? height - 1 : y * 2 + 1;
+
+        for (uint32_t x = 0; x < destWidth; x++) {
+            uint32_t x0 = std::min(x * 2, width - 1);
+            uint32_t x1 = (x == destWidth - 1) ? width - 1 : x * 2 + 1;
+
+            float sum[4] = {};
+            unsigned count = 0;
+
+            for (uint32_t sy = y0; sy <= y1; sy++) {
+                for (uint32_t sx = x0; sx <= x1; sx++) {
+                    const uint8_t *pixel = &source[(sy * width + sx) * 4];
+
+                    for (unsigned c = 0; c < 3; c++)
+                        sum[c] += toLinear[pixel[c]];
+
+                    sum[3] += static_cast<float>(pixel[3]) / 255.0f;
+                    count++;
+                }
+            }
+
+            uint8_t *pixel = &dest[(y * destWidth + x) * 4];
+
+            for (unsigned c = 0; c < 4; c++) {
+                float value = sum[c] / static_cast<float>(count);
+                if (sRGB && c < 3)
+                    value = linearToSRGB(value);
+
+                pixel[c] = static_cast<uint8_t>(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    width = destWidth;
+    height = destHeight;
+}
+
+/** Print usage information.
+ * @param argv0         Program name. */
+static void usage(const char *argv0) {
+    printf("Usage: %s [options...] <input> <output>\n", argv0);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -f <format>   Output format (bc1, bc3, bc4, bc5 or rgba, default: bc1 or bc3)\n");
+    printf("  -h            Display this help\n");
+    printf("  -l            Image data is linear rather than sRGB\n");
+    printf("  -m            Do not generate mip levels\n");
+}
+
+/** Main function of the texture cooking tool.
+ * @param argc          Argument count.
+ * @param argv          Argument array.
+ * @return              EXIT_SUCCESS or EXIT_FAILURE. */
+int main(int argc, char **argv) {
+    const char *formatName = nullptr;
+    bool sRGB = true;
+    bool generateMips = true;
+
+    /* Parse arguments. */
+    int opt;
+    while ((opt = getopt(argc, argv, "f:hlm")) != -1) {
+        switch (opt) {
+            case 'f':
+                formatName = optarg;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            case 'l':
+                sRGB = false;
+                break;
+            case 'm':
+                generateMips = false;
+                break;
+            default:
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *inputPath  = argv[optind];
+    const char *outputPath = argv[optind + 1];
+
+    /* The shared texture code reports errors through the log. */
+    g_logManager = new LogManager;
+
+    uint32_t width, height;
+    std::unique_ptr<uint8_t []> pixels;
+    if (!parseTexture(inputPath, width, height, pixels))
+        return EXIT_FAILURE;
+
+    /* Determine the output format. */
+    PixelFormat format;
+    if (!formatName) {
+        bool hasAlpha = false;
+        for (size_t i = 0; i < width * height && !hasAlpha; i++)
+            hasAlpha = pixels[(i * 4) + 3] != 255;
+
+        format = (hasAlpha) ? PixelFormat::kBC3 : PixelFormat::kBC1;
+    } else if (!strcmp(formatName, "bc1")) {
+        format = PixelFormat::kBC1;
+    } else if (!strcmp(formatName, "bc3")) {
+        format = PixelFormat::kBC3;
+    } else if (!strcmp(formatName, "bc4")) {
+        format = PixelFormat::kBC4;
+    } else if (!strcmp(formatName, "bc5")) {
+        format = PixelFormat::kBC5;
+    } else if (!strcmp(formatName, "rgba")) {
+        format = PixelFormat::kR8G8B8A8;
+    } else {
+        fprintf(stderr, "%s: Unknown format '%s'\n", argv[0], formatName);
+        return EXIT_FAILURE;
+    }
+
+    if (PixelFormat::getSRGBEquivalent(format) == format)
+        sRGB = false;
+
+    DDSTexture texture;
+    texture.width  = width;
+    texture.height = height;
+    texture.format = (sRGB) ? PixelFormat::getSRGBEquivalent(format) : format;
+    texture.mips   = 1;
+
+    if (generateMips) {
+        while ((width >> texture.mips) || (height >> texture.mips))
+            texture.mips++;
+    }
+
+    std::vector<uint8_t> output;
+    writeDDSHeader(texture, output);
+    output.resize(texture.dataOffset + texture.dataSize);
+
+    /* Write each mip level, generating the next from the previous. */
+    uint8_t *data = &output[texture.dataOffset];
+    for (uint32_t mip = 0; mip < texture.mips; mip++) {
+        if (mip > 0) {
+            std::unique_ptr<uint8_t []> next;
+            generateMip(pixels.get(), width, height, sRGB, next);
+            pixels = std::move(next);
+        }
+
+        size_t size = PixelFormat::imageSize(format, width, height);
+
+        if (PixelFormat::isCompressed(format)) {
+            compressImage(format, width, height, pixels.get(), data);
+        } else {
+            memcpy(data, pixels.get(), size);
+        }
+
+        data += size;
+    }
+
+    std::unique_ptr<File> file(Filesystem::openFile(outputPath, File::kWrite | File::kCreate | File::kTruncate));
+    if (!file) {
+        fprintf(stderr, "%s: Failed to open '%s'\n", argv[0], outputPath);
+        return EXIT_FAILURE;
+    }
+
+    if (!file->write(output.data(), output.size())) {
+        fprintf(stderr, "%s: Failed to write '%s'\n", argv[0], outputPath);
+        file.reset();
+        remove(outputPath);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %zu bytes (%u mip levels)\n", outputPath, output.size(), texture.mips);
+    return EXIT_SUCCESS;
+}